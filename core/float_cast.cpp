@@ -0,0 +1,588 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "core/float_cast.h"
+
+namespace mluop {
+
+namespace {
+inline uint32_t floatAsBits(float src) {
+  uint32_t bits;
+  memcpy(&bits, &src, sizeof(bits));
+  return bits;
+}
+
+inline float bitsAsFloat(uint32_t src) {
+  float value;
+  memcpy(&value, &src, sizeof(value));
+  return value;
+}
+
+// 0x477fe000 is 65504.f, the largest finite half
+constexpr uint32_t kHalfMaxAsFloatBits = 0x477fe000u;
+
+inline uint32_t halfNanAsFloatBits(uint32_t sign, uint32_t fraction,
+                                   halfToFloatMode_t mode) {
+  switch (mode) {
+    case HALF_TO_FLOAT_SATURATE_SOPA:
+      return sign | 0x7fffffffu;
+    case HALF_TO_FLOAT_SATURATE_QNAN:
+      return sign | 0x7fc00000u;
+    case HALF_TO_FLOAT_SATURATE_CORE:
+      return sign ^ 0xffffffffu;
+    default:
+      return sign | 0x7fc00000u | (fraction << 13);
+  }
+}
+}  // namespace
+
+uint16_t castFloat32ToHalfScalar(float src, floatToHalfMode_t mode) {
+  const uint32_t in = floatAsBits(src);
+  const uint32_t sign = (in >> 16) & 0x8000u;
+  const uint32_t abs = in & 0x7fffffffu;
+  const uint32_t exp = abs >> 23;
+  const uint32_t mant = (abs & 0x7fffffu) | 0x800000u;
+  uint32_t result = 0;
+  if (mode == FLOAT_TO_HALF_IEEE) {
+    if (abs > 0x7f800000u) {
+      result = 0x7e00u | ((abs >> 13) & 0x3ffu);
+    } else if (exp >= 143) {
+      result = 0x7c00u;
+    } else if (exp >= 113) {
+      result = (abs - (112u << 23) + 0xfffu + ((abs >> 13) & 1u)) >> 13;
+    } else if (exp >= 102) {
+      const uint32_t shift = 126 - exp;
+      result = (mant + (1u << (shift - 1)) - 1u + ((mant >> shift) & 1u)) >>
+               shift;
+    }
+    return static_cast<uint16_t>(sign | result);
+  }
+  if (mode == FLOAT_TO_HALF_CNRT_RM) {
+    if (abs > 0x7f800000u) {
+      result = 0x7e00u | ((abs >> 13) & 0x3ffu);
+    } else if (exp >= 143) {
+      result = 0x7c00u;
+    } else if (exp >= 113) {
+      // a carry out of the mantissa rounds 65520 and up to Inf
+      result = (abs - (112u << 23) + 0x1000u) >> 13;
+    } else if (exp >= 102) {
+      const uint32_t shift = 126 - exp;
+      result = (mant + (1u << (shift - 1))) >> shift;
+    }
+    return static_cast<uint16_t>(sign | result);
+  }
+
+  if (abs > 0x7f800000u) {
+    result = 0x7e00u;
+  } else if (abs == 0x7f800000u && mode == FLOAT_TO_HALF_SATURATE_RN) {
+    result = 0x7c00u;
+  } else if (exp >= 143) {
+    result = 0x7bffu;
+  } else if (exp >= 113) {
+    if (mode == FLOAT_TO_HALF_SATURATE_RN) {
+      result = (abs - (112u << 23) + 0xfffu + ((abs >> 13) & 1u)) >> 13;
+    } else {
+      result = (abs - (112u << 23) + 0x1000u) >> 13;
+    }
+  } else if (exp >= 103) {
+    // denormal result, only the first dropped bit takes part in rounding
+    const uint32_t shift = 126 - exp;
+    result = (mant >> shift) + ((mant >> (shift - 1)) & 1u);
+  } else {
+    // any non-zero value too small for half becomes the minimum denormal
+    result = abs ? 1u : 0u;
+  }
+  return static_cast<uint16_t>(sign | result);
+}
+
+float castHalfToFloat32Scalar(uint16_t src, halfToFloatMode_t mode) {
+  const uint32_t sign = static_cast<uint32_t>(src & 0x8000u) << 16;
+  const uint32_t exp = (src >> 10) & 0x1fu;
+  const uint32_t fraction = src & 0x3ffu;
+  if (exp == 0x1f) {
+    if (fraction != 0) {
+      return bitsAsFloat(halfNanAsFloatBits(sign, fraction, mode));
+    }
+    return bitsAsFloat(sign | (mode == HALF_TO_FLOAT_IEEE
+                                   ? 0x7f800000u
+                                   : kHalfMaxAsFloatBits));
+  }
+  if (exp == 0) {
+    // denormal (or zero), exact in float: fraction * 2^-24
+    const float value = static_cast<float>(fraction) * (1.0f / 16777216.0f);
+    return bitsAsFloat(sign | floatAsBits(value));
+  }
+  return bitsAsFloat(sign | ((exp + 112u) << 23) | (fraction << 13));
+}
+
+uint16_t castFloat32ToBfloat16Scalar(float src) {
+  const uint32_t in = floatAsBits(src);
+  if ((in & 0x7fffffffu) > 0x7f800000u) {
+    // XXX(zhaolianshui): loosing sign and quiet_nan/signaling_nan info
+    return 0x7fc0u;
+  }
+  const uint32_t rounding_bias = ((in >> 16) & 1u) + 0x7fffu;
+  return static_cast<uint16_t>((in + rounding_bias) >> 16);
+}
+
+float castBfloat16ToFloat32Scalar(uint16_t src) {
+  return bitsAsFloat(static_cast<uint32_t>(src) << 16);
+}
+
+namespace {
+typedef void (*FloatToHalfKernel)(const float *, uint16_t *, size_t,
+                                  floatToHalfMode_t);
+typedef void (*HalfToFloatKernel)(const uint16_t *, float *, size_t,
+                                  halfToFloatMode_t);
+typedef void (*FloatToBfloat16Kernel)(const float *, uint16_t *, size_t);
+typedef void (*Bfloat16ToFloatKernel)(const uint16_t *, float *, size_t);
+
+struct FloatCastKernels {
+  const char *name;
+  FloatToHalfKernel float_to_half;
+  HalfToFloatKernel half_to_float;
+  FloatToBfloat16Kernel float_to_bf16;
+  Bfloat16ToFloatKernel bf16_to_float;
+};
+
+void floatToHalfScalar(const float *src, uint16_t *dst, size_t num,
+                       floatToHalfMode_t mode) {
+  for (size_t i = 0; i < num; ++i) {
+    dst[i] = castFloat32ToHalfScalar(src[i], mode);
+  }
+}
+
+void halfToFloatScalar(const uint16_t *src, float *dst, size_t num,
+                       halfToFloatMode_t mode) {
+  for (size_t i = 0; i < num; ++i) {
+    dst[i] = castHalfToFloat32Scalar(src[i], mode);
+  }
+}
+
+void floatToBfloat16Scalar(const float *src, uint16_t *dst, size_t num) {
+  for (size_t i = 0; i < num; ++i) {
+    dst[i] = castFloat32ToBfloat16Scalar(src[i]);
+  }
+}
+
+void bfloat16ToFloatScalar(const uint16_t *src, float *dst, size_t num) {
+  for (size_t i = 0; i < num; ++i) {
+    dst[i] = castBfloat16ToFloat32Scalar(src[i]);
+  }
+}
+
+#if defined(__x86_64__)
+#define MLUOP_TARGET_AVX2 __attribute__((target("avx2,f16c")))
+#define MLUOP_TARGET_AVX512 __attribute__((target("avx512f,avx2,f16c")))
+
+/* AVX2 + F16C, 8 float lanes. The saturating modes (and cnrtRounding_rm, which
+ * only differs in overflow and NaN) are pure integer code that mirrors
+ * castFloat32ToHalfScalar branch by branch, every branch is computed and the
+ * right one is selected per lane by blend. */
+template <floatToHalfMode_t mode>
+MLUOP_TARGET_AVX2 inline __m256i floatToHalfSaturateAvx2(__m256i in) {
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i abs = _mm256_and_si256(in, _mm256_set1_epi32(0x7fffffff));
+  const __m256i sign = _mm256_and_si256(_mm256_srli_epi32(in, 16),
+                                        _mm256_set1_epi32(0x8000));
+  const __m256i exp = _mm256_srli_epi32(abs, 23);
+  const __m256i rebias = _mm256_sub_epi32(abs, _mm256_set1_epi32(112 << 23));
+  __m256i normal;
+  if (mode == FLOAT_TO_HALF_SATURATE_RN) {
+    const __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(abs, 13), one);
+    normal = _mm256_add_epi32(
+        rebias, _mm256_add_epi32(_mm256_set1_epi32(0xfff), lsb));
+  } else {
+    normal = _mm256_add_epi32(rebias, _mm256_set1_epi32(0x1000));
+  }
+  normal = _mm256_srli_epi32(normal, 13);
+  const __m256i mant = _mm256_or_si256(
+      _mm256_and_si256(abs, _mm256_set1_epi32(0x7fffff)),
+      _mm256_set1_epi32(0x800000));
+  const __m256i shift = _mm256_sub_epi32(_mm256_set1_epi32(126), exp);
+  const __m256i denorm = _mm256_add_epi32(
+      _mm256_srlv_epi32(mant, shift),
+      _mm256_and_si256(_mm256_srlv_epi32(mant, _mm256_sub_epi32(shift, one)),
+                       one));
+  __m256i result;
+  if (mode == FLOAT_TO_HALF_CNRT_RM) {
+    // shifts of 25 and more give 0, so exponents below 102 need no branch
+    result = denorm;
+  } else {
+    result = _mm256_andnot_si256(
+        _mm256_cmpeq_epi32(abs, _mm256_setzero_si256()), one);
+    result = _mm256_blendv_epi8(
+        result, denorm, _mm256_cmpgt_epi32(exp, _mm256_set1_epi32(102)));
+  }
+  result = _mm256_blendv_epi8(
+      result, normal, _mm256_cmpgt_epi32(exp, _mm256_set1_epi32(112)));
+  result = _mm256_blendv_epi8(
+      result,
+      _mm256_set1_epi32(mode == FLOAT_TO_HALF_CNRT_RM ? 0x7c00 : 0x7bff),
+      _mm256_cmpgt_epi32(exp, _mm256_set1_epi32(142)));
+  if (mode == FLOAT_TO_HALF_SATURATE_RN) {
+    result = _mm256_blendv_epi8(
+        result, _mm256_set1_epi32(0x7c00),
+        _mm256_cmpeq_epi32(abs, _mm256_set1_epi32(0x7f800000)));
+  }
+  __m256i nan = _mm256_set1_epi32(0x7e00);
+  if (mode == FLOAT_TO_HALF_CNRT_RM) {
+    nan = _mm256_or_si256(
+        nan, _mm256_and_si256(_mm256_srli_epi32(abs, 13),
+                              _mm256_set1_epi32(0x3ff)));
+  }
+  result = _mm256_blendv_epi8(
+      result, nan, _mm256_cmpgt_epi32(abs, _mm256_set1_epi32(0x7f800000)));
+  return _mm256_or_si256(result, sign);
+}
+
+// pack two vectors of 8 x u16-in-u32 into 16 x u16 in order
+MLUOP_TARGET_AVX2 inline __m256i packU32ToU16Avx2(__m256i lo, __m256i hi) {
+  return _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xd8);
+}
+
+template <floatToHalfMode_t mode>
+MLUOP_TARGET_AVX2 void floatToHalfSaturateLoopAvx2(const float *src,
+                                                   uint16_t *dst, size_t num) {
+  size_t i = 0;
+  for (; i + 16 <= num; i += 16) {
+    __m256i lo = floatToHalfSaturateAvx2<mode>(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i)));
+    __m256i hi = floatToHalfSaturateAvx2<mode>(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + 8)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+                        packU32ToU16Avx2(lo, hi));
+  }
+  floatToHalfScalar(src + i, dst + i, num - i, mode);
+}
+
+MLUOP_TARGET_AVX2 void floatToHalfAvx2(const float *src, uint16_t *dst,
+                                       size_t num, floatToHalfMode_t mode) {
+  if (mode == FLOAT_TO_HALF_SATURATE_RN) {
+    return floatToHalfSaturateLoopAvx2<FLOAT_TO_HALF_SATURATE_RN>(src, dst,
+                                                                  num);
+  } else if (mode == FLOAT_TO_HALF_SATURATE_RU) {
+    return floatToHalfSaturateLoopAvx2<FLOAT_TO_HALF_SATURATE_RU>(src, dst,
+                                                                  num);
+  } else if (mode == FLOAT_TO_HALF_CNRT_RM) {
+    return floatToHalfSaturateLoopAvx2<FLOAT_TO_HALF_CNRT_RM>(src, dst, num);
+  }
+  size_t i = 0;
+  for (; i + 8 <= num; i += 8) {
+    __m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(src + i),
+                                   _MM_FROUND_TO_NEAREST_INT |
+                                       _MM_FROUND_NO_EXC);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), half);
+  }
+  floatToHalfScalar(src + i, dst + i, num - i, mode);
+}
+
+MLUOP_TARGET_AVX2 void halfToFloatAvx2(const uint16_t *src, float *dst,
+                                       size_t num, halfToFloatMode_t mode) {
+  const __m256i abs_mask = _mm256_set1_epi32(0x7fff);
+  const __m256i inf = _mm256_set1_epi32(0x7c00);
+  size_t i = 0;
+  for (; i + 8 <= num; i += 8) {
+    __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    __m256 value = _mm256_cvtph_ps(half);
+    if (mode != HALF_TO_FLOAT_IEEE) {
+      __m256i bits = _mm256_cvtepu16_epi32(half);
+      __m256i abs = _mm256_and_si256(bits, abs_mask);
+      __m256i sign = _mm256_slli_epi32(_mm256_andnot_si256(abs_mask, bits), 16);
+      __m256i nan;
+      if (mode == HALF_TO_FLOAT_SATURATE_SOPA) {
+        nan = _mm256_or_si256(sign, _mm256_set1_epi32(0x7fffffff));
+      } else if (mode == HALF_TO_FLOAT_SATURATE_QNAN) {
+        nan = _mm256_or_si256(sign, _mm256_set1_epi32(0x7fc00000));
+      } else {
+        nan = _mm256_xor_si256(sign, _mm256_set1_epi32(-1));
+      }
+      __m256i result = _mm256_castps_si256(value);
+      result = _mm256_blendv_epi8(
+          result, _mm256_or_si256(sign, _mm256_set1_epi32(kHalfMaxAsFloatBits)),
+          _mm256_cmpeq_epi32(abs, inf));
+      result = _mm256_blendv_epi8(result, nan, _mm256_cmpgt_epi32(abs, inf));
+      value = _mm256_castsi256_ps(result);
+    }
+    _mm256_storeu_ps(dst + i, value);
+  }
+  halfToFloatScalar(src + i, dst + i, num - i, mode);
+}
+
+MLUOP_TARGET_AVX2 inline __m256i floatToBfloat16Avx2Lanes(__m256i in) {
+  const __m256i rounding_bias = _mm256_add_epi32(
+      _mm256_and_si256(_mm256_srli_epi32(in, 16), _mm256_set1_epi32(1)),
+      _mm256_set1_epi32(0x7fff));
+  __m256i result =
+      _mm256_srli_epi32(_mm256_add_epi32(in, rounding_bias), 16);
+  __m256i is_nan = _mm256_cmpgt_epi32(
+      _mm256_and_si256(in, _mm256_set1_epi32(0x7fffffff)),
+      _mm256_set1_epi32(0x7f800000));
+  return _mm256_blendv_epi8(result, _mm256_set1_epi32(0x7fc0), is_nan);
+}
+
+MLUOP_TARGET_AVX2 void floatToBfloat16Avx2(const float *src, uint16_t *dst,
+                                           size_t num) {
+  size_t i = 0;
+  for (; i + 16 <= num; i += 16) {
+    __m256i lo = floatToBfloat16Avx2Lanes(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i)));
+    __m256i hi = floatToBfloat16Avx2Lanes(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + 8)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+                        packU32ToU16Avx2(lo, hi));
+  }
+  floatToBfloat16Scalar(src + i, dst + i, num - i);
+}
+
+MLUOP_TARGET_AVX2 void bfloat16ToFloatAvx2(const uint16_t *src, float *dst,
+                                           size_t num) {
+  size_t i = 0;
+  for (; i + 8 <= num; i += 8) {
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+                        _mm256_slli_epi32(_mm256_cvtepu16_epi32(in), 16));
+  }
+  bfloat16ToFloatScalar(src + i, dst + i, num - i);
+}
+
+/* AVX-512F, 16 float lanes, same structure as the AVX2 kernels but with mask
+ * registers instead of blendv. */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+// false positive from _mm512_undefined_epi32() in avx512fintrin.h (gcc 12)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+template <floatToHalfMode_t mode>
+MLUOP_TARGET_AVX512 inline __m256i floatToHalfSaturateAvx512(__m512i in) {
+  const __m512i one = _mm512_set1_epi32(1);
+  const __m512i abs = _mm512_and_si512(in, _mm512_set1_epi32(0x7fffffff));
+  const __m512i sign = _mm512_and_si512(_mm512_srli_epi32(in, 16),
+                                        _mm512_set1_epi32(0x8000));
+  const __m512i exp = _mm512_srli_epi32(abs, 23);
+  const __m512i rebias = _mm512_sub_epi32(abs, _mm512_set1_epi32(112 << 23));
+  __m512i normal;
+  if (mode == FLOAT_TO_HALF_SATURATE_RN) {
+    const __m512i lsb = _mm512_and_si512(_mm512_srli_epi32(abs, 13), one);
+    normal = _mm512_add_epi32(
+        rebias, _mm512_add_epi32(_mm512_set1_epi32(0xfff), lsb));
+  } else {
+    normal = _mm512_add_epi32(rebias, _mm512_set1_epi32(0x1000));
+  }
+  normal = _mm512_srli_epi32(normal, 13);
+  const __m512i mant = _mm512_or_si512(
+      _mm512_and_si512(abs, _mm512_set1_epi32(0x7fffff)),
+      _mm512_set1_epi32(0x800000));
+  const __m512i shift = _mm512_sub_epi32(_mm512_set1_epi32(126), exp);
+  const __m512i denorm = _mm512_add_epi32(
+      _mm512_srlv_epi32(mant, shift),
+      _mm512_and_si512(_mm512_srlv_epi32(mant, _mm512_sub_epi32(shift, one)),
+                       one));
+  __m512i result;
+  if (mode == FLOAT_TO_HALF_CNRT_RM) {
+    result = denorm;
+  } else {
+    result = _mm512_maskz_mov_epi32(
+        _mm512_cmpneq_epi32_mask(abs, _mm512_setzero_si512()), one);
+    result = _mm512_mask_mov_epi32(
+        result, _mm512_cmpgt_epi32_mask(exp, _mm512_set1_epi32(102)), denorm);
+  }
+  result = _mm512_mask_mov_epi32(
+      result, _mm512_cmpgt_epi32_mask(exp, _mm512_set1_epi32(112)), normal);
+  result = _mm512_mask_mov_epi32(
+      result, _mm512_cmpgt_epi32_mask(exp, _mm512_set1_epi32(142)),
+      _mm512_set1_epi32(mode == FLOAT_TO_HALF_CNRT_RM ? 0x7c00 : 0x7bff));
+  if (mode == FLOAT_TO_HALF_SATURATE_RN) {
+    result = _mm512_mask_mov_epi32(
+        result, _mm512_cmpeq_epi32_mask(abs, _mm512_set1_epi32(0x7f800000)),
+        _mm512_set1_epi32(0x7c00));
+  }
+  __m512i nan = _mm512_set1_epi32(0x7e00);
+  if (mode == FLOAT_TO_HALF_CNRT_RM) {
+    nan = _mm512_or_si512(
+        nan, _mm512_and_si512(_mm512_srli_epi32(abs, 13),
+                              _mm512_set1_epi32(0x3ff)));
+  }
+  result = _mm512_mask_mov_epi32(
+      result, _mm512_cmpgt_epi32_mask(abs, _mm512_set1_epi32(0x7f800000)),
+      nan);
+  return _mm512_cvtepi32_epi16(_mm512_or_si512(result, sign));
+}
+
+template <floatToHalfMode_t mode>
+MLUOP_TARGET_AVX512 void floatToHalfSaturateLoopAvx512(const float *src,
+                                                       uint16_t *dst,
+                                                       size_t num) {
+  size_t i = 0;
+  for (; i + 16 <= num; i += 16) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+                        floatToHalfSaturateAvx512<mode>(_mm512_loadu_si512(
+                            reinterpret_cast<const void *>(src + i))));
+  }
+  floatToHalfScalar(src + i, dst + i, num - i, mode);
+}
+
+MLUOP_TARGET_AVX512 void floatToHalfAvx512(const float *src, uint16_t *dst,
+                                           size_t num,
+                                           floatToHalfMode_t mode) {
+  if (mode == FLOAT_TO_HALF_SATURATE_RN) {
+    return floatToHalfSaturateLoopAvx512<FLOAT_TO_HALF_SATURATE_RN>(src, dst,
+                                                                    num);
+  } else if (mode == FLOAT_TO_HALF_SATURATE_RU) {
+    return floatToHalfSaturateLoopAvx512<FLOAT_TO_HALF_SATURATE_RU>(src, dst,
+                                                                    num);
+  } else if (mode == FLOAT_TO_HALF_CNRT_RM) {
+    return floatToHalfSaturateLoopAvx512<FLOAT_TO_HALF_CNRT_RM>(src, dst, num);
+  }
+  size_t i = 0;
+  for (; i + 16 <= num; i += 16) {
+    __m256i half = _mm512_cvtps_ph(_mm512_loadu_ps(src + i),
+                                   _MM_FROUND_TO_NEAREST_INT |
+                                       _MM_FROUND_NO_EXC);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), half);
+  }
+  floatToHalfScalar(src + i, dst + i, num - i, mode);
+}
+
+MLUOP_TARGET_AVX512 void halfToFloatAvx512(const uint16_t *src, float *dst,
+                                           size_t num,
+                                           halfToFloatMode_t mode) {
+  const __m512i abs_mask = _mm512_set1_epi32(0x7fff);
+  const __m512i inf = _mm512_set1_epi32(0x7c00);
+  size_t i = 0;
+  for (; i + 16 <= num; i += 16) {
+    __m256i half =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    __m512 value = _mm512_cvtph_ps(half);
+    if (mode != HALF_TO_FLOAT_IEEE) {
+      __m512i bits = _mm512_cvtepu16_epi32(half);
+      __m512i abs = _mm512_and_si512(bits, abs_mask);
+      __m512i sign = _mm512_slli_epi32(_mm512_andnot_si512(abs_mask, bits), 16);
+      __m512i nan;
+      if (mode == HALF_TO_FLOAT_SATURATE_SOPA) {
+        nan = _mm512_or_si512(sign, _mm512_set1_epi32(0x7fffffff));
+      } else if (mode == HALF_TO_FLOAT_SATURATE_QNAN) {
+        nan = _mm512_or_si512(sign, _mm512_set1_epi32(0x7fc00000));
+      } else {
+        nan = _mm512_xor_si512(sign, _mm512_set1_epi32(-1));
+      }
+      __m512i result = _mm512_castps_si512(value);
+      result = _mm512_mask_mov_epi32(
+          result, _mm512_cmpeq_epi32_mask(abs, inf),
+          _mm512_or_si512(sign, _mm512_set1_epi32(kHalfMaxAsFloatBits)));
+      result = _mm512_mask_mov_epi32(result, _mm512_cmpgt_epi32_mask(abs, inf),
+                                     nan);
+      value = _mm512_castsi512_ps(result);
+    }
+    _mm512_storeu_ps(dst + i, value);
+  }
+  halfToFloatScalar(src + i, dst + i, num - i, mode);
+}
+
+MLUOP_TARGET_AVX512 void floatToBfloat16Avx512(const float *src,
+                                               uint16_t *dst, size_t num) {
+  const __m512i one = _mm512_set1_epi32(1);
+  size_t i = 0;
+  for (; i + 16 <= num; i += 16) {
+    __m512i in = _mm512_loadu_si512(reinterpret_cast<const void *>(src + i));
+    __m512i rounding_bias = _mm512_add_epi32(
+        _mm512_and_si512(_mm512_srli_epi32(in, 16), one),
+        _mm512_set1_epi32(0x7fff));
+    __m512i result =
+        _mm512_srli_epi32(_mm512_add_epi32(in, rounding_bias), 16);
+    result = _mm512_mask_mov_epi32(
+        result,
+        _mm512_cmpgt_epi32_mask(
+            _mm512_and_si512(in, _mm512_set1_epi32(0x7fffffff)),
+            _mm512_set1_epi32(0x7f800000)),
+        _mm512_set1_epi32(0x7fc0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+                        _mm512_cvtepi32_epi16(result));
+  }
+  floatToBfloat16Scalar(src + i, dst + i, num - i);
+}
+
+MLUOP_TARGET_AVX512 void bfloat16ToFloatAvx512(const uint16_t *src,
+                                               float *dst, size_t num) {
+  size_t i = 0;
+  for (; i + 16 <= num; i += 16) {
+    __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    _mm512_storeu_si512(reinterpret_cast<void *>(dst + i),
+                        _mm512_slli_epi32(_mm512_cvtepu16_epi32(in), 16));
+  }
+  bfloat16ToFloatScalar(src + i, dst + i, num - i);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#undef MLUOP_TARGET_AVX2
+#undef MLUOP_TARGET_AVX512
+#endif  // defined(__x86_64__)
+
+const FloatCastKernels &getFloatCastKernels() {
+  static const FloatCastKernels kernels = []() -> FloatCastKernels {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+      return {"avx512", floatToHalfAvx512, halfToFloatAvx512,
+              floatToBfloat16Avx512, bfloat16ToFloatAvx512};
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c")) {
+      return {"avx2", floatToHalfAvx2, halfToFloatAvx2, floatToBfloat16Avx2,
+              bfloat16ToFloatAvx2};
+    }
+#endif
+    return {"scalar", floatToHalfScalar, halfToFloatScalar,
+            floatToBfloat16Scalar, bfloat16ToFloatScalar};
+  }();
+  return kernels;
+}
+}  // namespace
+
+void castFloat32ToHalfArray(const float *src, uint16_t *dst, size_t num,
+                            floatToHalfMode_t mode) {
+  getFloatCastKernels().float_to_half(src, dst, num, mode);
+}
+
+void castHalfToFloat32Array(const uint16_t *src, float *dst, size_t num,
+                            halfToFloatMode_t mode) {
+  getFloatCastKernels().half_to_float(src, dst, num, mode);
+}
+
+void castFloat32ToBfloat16Array(const float *src, uint16_t *dst, size_t num) {
+  getFloatCastKernels().float_to_bf16(src, dst, num);
+}
+
+void castBfloat16ToFloat32Array(const uint16_t *src, float *dst, size_t num) {
+  getFloatCastKernels().bf16_to_float(src, dst, num);
+}
+
+const char *getFloatCastIsaName() { return getFloatCastKernels().name; }
+}  // namespace mluop
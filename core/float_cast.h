@@ -0,0 +1,90 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef CORE_FLOAT_CAST_H_
+#define CORE_FLOAT_CAST_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mluop {
+/**
+ * Host side float32 <-> float16/bfloat16 conversion.
+ *
+ * Array functions are dispatched at runtime to AVX-512, AVX2(+F16C) or scalar
+ * kernels. Every kernel produces exactly the same bits as the scalar
+ * reference of the selected mode, including NaN, Inf and denormal inputs.
+ */
+
+// Semantics of float32 -> float16.
+typedef enum {
+  // IEEE-754 round-to-nearest-even, overflow to Inf, quiet NaN keeps the high
+  // payload bits (same as x86 F16C / aarch64 fcvt).
+  FLOAT_TO_HALF_IEEE = 0,
+  // round-to-nearest-even for normal results, round-half-up for denormal
+  // results, finite overflow saturates to +-65504, NaN becomes +-0x7e00.
+  // (mluoptest::cvtFloatToHalf)
+  FLOAT_TO_HALF_SATURATE_RN = 1,
+  // same as FLOAT_TO_HALF_SATURATE_RN, but normal results are rounded half up
+  // and Inf saturates to +-65504 too. (mluop::castFloat32ToHalf)
+  FLOAT_TO_HALF_SATURATE_RU = 2,
+  // round-half-away-from-zero for normal and denormal results, overflow to
+  // Inf, quiet NaN keeps the high payload bits.
+  // (cnrtCastDataType_V2 with cnrtRounding_rm)
+  FLOAT_TO_HALF_CNRT_RM = 3,
+} floatToHalfMode_t;
+
+// Semantics of float16 -> float32, finite values are always exact.
+typedef enum {
+  // Inf and NaN are kept, NaN is quieted (same as x86 F16C).
+  HALF_TO_FLOAT_IEEE = 0,
+  // Inf saturates to +-65504, NaN becomes 0x7fffffff(+) or 0xffffffff(-).
+  // (mluoptest::cvtHalfToFloatImpl<SOPA>)
+  HALF_TO_FLOAT_SATURATE_SOPA = 1,
+  // Inf saturates to +-65504, NaN becomes 0x7fc00000(+) or 0xffc00000(-).
+  // (mluoptest::cvtHalfToFloatImpl<MLUOPGTEST2>)
+  HALF_TO_FLOAT_SATURATE_QNAN = 2,
+  // Inf saturates to +-65504, NaN becomes 0xffffffff(+) or 0x7fffffff(-).
+  // (mluop::castHalfToFloat32)
+  HALF_TO_FLOAT_SATURATE_CORE = 3,
+} halfToFloatMode_t;
+
+// scalar reference, one element
+uint16_t castFloat32ToHalfScalar(float src, floatToHalfMode_t mode);
+float castHalfToFloat32Scalar(uint16_t src, halfToFloatMode_t mode);
+// float32 -> bfloat16 rounds to nearest even, NaN becomes 0x7fc0.
+uint16_t castFloat32ToBfloat16Scalar(float src);
+float castBfloat16ToFloat32Scalar(uint16_t src);
+
+// array version, src and dst must not overlap
+void castFloat32ToHalfArray(const float *src, uint16_t *dst, size_t num,
+                            floatToHalfMode_t mode);
+void castHalfToFloat32Array(const uint16_t *src, float *dst, size_t num,
+                            halfToFloatMode_t mode);
+void castFloat32ToBfloat16Array(const float *src, uint16_t *dst, size_t num);
+void castBfloat16ToFloat32Array(const uint16_t *src, float *dst, size_t num);
+
+// name of the kernel picked by the runtime dispatcher, for logging only
+const char *getFloatCastIsaName();
+}  // namespace mluop
+
+#endif  // CORE_FLOAT_CAST_H_
@@ -26,6 +26,7 @@
 #include <string>
 
 #include "core/tool.h"
+#include "core/float_cast.h"
 #include "core/logging.h"
 
 #define INT31_BITWIDTH 31
@@ -321,81 +322,13 @@ int16_t castFloat32ToHalf(float src) {
    * @return:
    *  number of `int16_t`.
    * **/
-  const int fs_shift = 31;
-  const int fe_shift = 23;
-  const int fe_mark = 0xff;
-  const int hs_shift = 15;
-  const int he_shift = 10;
-  int *in1 = (int *)&src;
-  int in = *in1;
-  int sign = in >> fs_shift;
-  int exp = ((in >> fe_shift) & fe_mark) - 127;
-  int denorm = 0;
-  int eff = 0;
-  int g = 0;                              // for round
-  if ((exp == 128) && (in & 0x7fffff)) {  // NaN
-    exp = 0x1f - 15;
-    eff = 0x200;
-  } else if (exp >= 16) {
-    exp = 0xf;
-    eff = 0x3ff;
-  } else if (exp >= -14) {
-    g = (in >> 12) & 1;
-    eff = (in >> 13) & 0x3ff;
-  } else if (exp >= -24) {
-    g = (((in & 0x7fffff) | 0x800000) >> (-exp - 2)) & 1;
-    eff = (((in & 0x7fffff) | 0x800000) >> (-exp - 1)) & 0x3ff;
-    denorm = 1;
-    exp = 0;
-  } else {
-    exp = 0;
-    denorm = 1;
-    eff = (in & 0x7fffffff) ? 1 : 0;
-  }
-  eff += g;  // round
-  exp = (denorm == 1) ? exp : (exp + 15);
-  int result = (sign << hs_shift) + (exp << he_shift) + eff;
-  return result;
+  return static_cast<int16_t>(
+      castFloat32ToHalfScalar(src, FLOAT_TO_HALF_SATURATE_RU));
 }
 
 float castHalfToFloat32(int16_t src) {
-  if (sizeof(int16_t) == 2) {
-    int re = src;
-    float f = 0.;
-    int sign = (re >> 15) ? (-1) : 1;
-    int exp = (re >> 10) & 0x1f;
-    int eff = re & 0x3ff;
-    float half_max = 65504.;
-    float half_min = -65504.;  // or to be defined as infinity
-    if (exp == 0x1f && eff) {
-      // when half is nan, float also return nan, reserve sign bit
-      int tmp = (sign > 0) ? 0xffffffff : 0x7fffffff;
-      return *(float *)&tmp;
-    } else if (exp == 0x1f && sign == 1) {
-      // add upper bound of half. 0x7bff： 0 11110 1111111111 =  65504
-      return half_max;
-    } else if (exp == 0x1f && sign == -1) {
-      // add lower bound of half. 0xfbff： 1 11110 1111111111 = -65504
-      return half_min;
-    }
-    if (exp > 0) {
-      exp -= 15;
-      eff = eff | 0x400;
-    } else {
-      exp = -14;
-    }
-    int sft;
-    sft = exp - 10;
-    if (sft < 0) {
-      f = (float)sign * eff / (1 << (-sft));
-    } else {
-      f = ((float)sign) * (1 << sft) * eff;
-    }
-    return f;
-  } else if (sizeof(int16_t) == 4) {
-    // using float
-    return src;
-  }
+  return castHalfToFloat32Scalar(static_cast<uint16_t>(src),
+                                 HALF_TO_FLOAT_SATURATE_CORE);
 }
 
 int mkdirIfNotExist(const char *pathname) {
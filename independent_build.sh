@@ -22,6 +22,7 @@ export MLUOP_BUILD_BANG_MEMCHECK=${MLUOP_BUILD_BANG_MEMCHECK:-OFF} # ON/OFF bang
 export MLUOP_BUILD_PREPARE=${MLUOP_BUILD_PREPARE:-ON}
 export MLUOP_BUILD_GTEST=${MLUOP_BUILD_GTEST:-ON}
 export MLUOP_BUILD_STATIC=${MLUOP_BUILD_STATIC:-OFF}
+export MLUOP_BUILD_HOST_BENCH=${MLUOP_BUILD_HOST_BENCH:-OFF}
 export BUILD_JOBS="${BUILD_JOBS:-16}" # concurrent build jobs
 
 # import common method like `download_pkg`, `get_json_val`, `common_extract`, etc
@@ -56,6 +57,7 @@ long_args=(
   prepare
   disable-gtest
   enable-static
+  enable-host-bench
 )
 
 add_mlu_arch_support () {
@@ -113,6 +115,7 @@ usage () {
     echo "    --disable-gtest             Build mlu-ops without gtest"
     echo "    --enable-bang-memcheck      (Deprecated, use CNSanitizer instead) Build with cncc '-mllvm -enable-mlisa-sanitizer -Xbang-cnas -O0 -g' arg to enable memcheck"
     echo "    --enable-static             Build mlu-ops static library"
+    echo "    --enable-host-bench         Build mluops_host_bench, implies --enable-static"
     echo "    --mlu370                    Build for target product MLU370: __BANG_ARCH__ = 372"
     echo "                                                                 __MLU_NRAM_SIZE__ = 768KB"
     echo "                                                                 __MLU_WRAM_SIZE__ = 1024KB"
@@ -332,6 +335,11 @@ if [ $# != 0 ]; then
           shift
           export MLUOP_BUILD_STATIC="ON"
           ;;
+      --enable-host-bench)
+          shift
+          export MLUOP_BUILD_STATIC="ON"
+          export MLUOP_BUILD_HOST_BENCH="ON"
+          ;;
       --filter)
         shift
         export MLUOP_BUILD_SPECIFIC_OP=$1
@@ -477,7 +485,8 @@ pushd ${BUILD_PATH} > /dev/null
                 -DMLUOP_SYMBOL_VIS_FILE="${MLUOP_SYMBOL_VIS_FILE}" \
                 -DMLUOP_PACKAGE_INFO_SET="${MLUOP_PACKAGE_INFO_SET}" \
                 -DMLUOP_BUILD_GTEST="${MLUOP_BUILD_GTEST}" \
-                -DMLUOP_BUILD_STATIC="${MLUOP_BUILD_STATIC}"
+                -DMLUOP_BUILD_STATIC="${MLUOP_BUILD_STATIC}" \
+                -DMLUOP_BUILD_HOST_BENCH="${MLUOP_BUILD_HOST_BENCH}"
 
 popd > /dev/null
 ${CMAKE} --build ${BUILD_PATH} --  -j${BUILD_JOBS}
@@ -102,6 +102,10 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateTwiddlesLine(
   return MLUOP_STATUS_SUCCESS;
 }
 
+template mluOpStatus_t MLUOP_WIN_API fftGenerateTwiddlesLine<float>(
+    void *_twiddles, const int butterfly_num, const int section_num,
+    const int radix, const int nfft, const int dir);
+
 template <typename DT>
 mluOpStatus_t MLUOP_WIN_API fftGenerateR2CTwiddlesLine(
     void *_twiddles, const int butterfly_num, const int section_num,
@@ -408,6 +412,9 @@ mluOpStatus_t MLUOP_WIN_API fftGenerateDftMatrixKernel(DT *dft_matrix,
   return MLUOP_STATUS_SUCCESS;
 }
 
+template mluOpStatus_t MLUOP_WIN_API fftGenerateDftMatrixKernel<float>(
+    float *dft_matrix, const int radix, const int dir);
+
 template <typename DT>
 mluOpStatus_t MLUOP_WIN_API fftGenerateDftMatrixKernelNoPad(DT *dft_matrix,
                                                             const int radix,
@@ -319,6 +319,20 @@ mluOpStatus_t MLUOP_WIN_API fftTwoStepFactor(mluOpHandle_t handle,
                                              const int is_row_major,
                                              const int fft_type);
 
+// Generates one line of twiddle factors for a radix stage into host memory,
+// real parts first and then imaginary parts.
+template <typename DT>
+mluOpStatus_t MLUOP_WIN_API fftGenerateTwiddlesLine(
+    void *_twiddles, const int butterfly_num, const int section_num,
+    const int radix, const int nfft, const int dir);
+
+// Generates the radix x radix DFT matrix into host memory, with every row
+// padded to 64 bytes.
+template <typename DT>
+mluOpStatus_t MLUOP_WIN_API fftGenerateDftMatrixKernel(DT *dft_matrix,
+                                                       const int radix,
+                                                       const int dir);
+
 // Executes the 1D Butterfly FFT kernel for rows with the specified dimensions,
 // function type, queue, FFT plan, direction, and flag.
 mluOpStatus_t MLUOP_WIN_API kernelFFT1dButterflyRow(
@@ -99,6 +99,7 @@ void arrayCastHalfToInt8or16HalfUp(void *dst, int16_t *src, int pos, size_t num,
 bool getEnv(const std::string &env, bool default_ret);
 int getEnvInt(const std::string &env, int default_ret);
 size_t proc_usage_peak();
+size_t proc_rss_peak();
 std::unordered_map<std::string, std::vector<std::string>> readFileByLine(
     const std::string &file);
 
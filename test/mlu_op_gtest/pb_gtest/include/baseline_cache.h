@@ -0,0 +1,98 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_BASELINE_CACHE_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_BASELINE_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mluoptest {
+
+// 128-bit hash of a byte stream, for keys of BaselineCache.
+class BaselineHasher {
+ public:
+  void update(const void *data, size_t bytes);
+  void update(int64_t value) { update(&value, sizeof(value)); }
+  void update(const std::string &str) {
+    update((int64_t)str.size());
+    update(str.data(), str.size());
+  }
+  std::string hexDigest() const;  // 32 hex chars
+
+ private:
+  uint64_t h0_ = 0x9e3779b97f4a7c15ULL;
+  uint64_t h1_ = 0xc2b2ae3d27d4eb4fULL;
+  uint64_t length_ = 0;
+};
+
+// On-disk store of cpu baseline outputs, enabled by
+// MLUOP_GTEST_BASELINE_CACHE=<dir>.
+// Each entry is one file <dir>/<key>.bin holding all outputs of a case, the
+// key hashes everything cpuCompute depends on (see
+// Executor::getBaselineCacheKey), only executors that opt in with
+// Executor::cpuComputeVersion() >= 0 are cached. Files are written to a temp
+// name and renamed, so several gtest processes can share one dir. The least
+// recently used files are removed once the dir exceeds
+// MLUOP_GTEST_BASELINE_CACHE_MB.
+class BaselineCache {
+ public:
+  // empty dir disables the cache, getInstance() is the one used by cases.
+  BaselineCache(const std::string &dir, size_t limit_bytes);
+  BaselineCache(const BaselineCache &) = delete;
+  void operator=(const BaselineCache &) = delete;
+
+  static BaselineCache *getInstance();
+
+  inline bool enabled() const { return !dir_.empty(); }
+
+  // fill outputs (ptr, bytes) with the entry of key, false if missing or the
+  // sizes don't match.
+  bool load(const std::string &key,
+            const std::vector<std::pair<void *, size_t>> &outputs);
+  void store(const std::string &key,
+             const std::vector<std::pair<void *, size_t>> &outputs);
+
+  std::string getStats() const;
+
+ private:
+  std::string getPath(const std::string &key) const;
+  void evict(size_t bytes_needed);
+
+  std::string dir_;
+  size_t limit_bytes_ = 0;
+  std::mutex mtx_;  // guard dir_bytes_ and eviction
+  bool dir_scanned_ = false;
+  size_t dir_bytes_ = 0;
+  std::atomic<size_t> hit_num_{0};
+  std::atomic<size_t> miss_num_{0};
+  std::atomic<size_t> store_num_{0};
+  std::atomic<size_t> evict_num_{0};
+};
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_BASELINE_CACHE_H_
@@ -0,0 +1,85 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_BASELINE_INDEX_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_BASELINE_INDEX_H_
+
+#include <cstdint>
+#include <istream>
+#include <string>
+
+namespace mluoptest {
+
+// Baseline of one case, as recorded in the baseline xml.
+struct BaselineRecord {
+  bool has_perf = false;  // hardware_time_base and workspace_size_mlu found
+  double hw_time = 0;
+  double workspace_size = 0;
+  const double *errors = nullptr;  // *_error_diff* properties, in xml order
+  size_t error_num = 0;
+};
+
+// Read-only index of a baseline xml (MLUOP_BASELINE_XML_FILE or
+// MLUOP_ACC_BASELINE_XML_FILE), keyed by the file name of case_path.
+// The xml is parsed once into <xml>.idx: a header with the size and mtime of
+// the xml, an open addressing table of fixed-size slots, then the error
+// values and the case names the slots point to. Later runs mmap the index
+// and only parse the xml again when it changed. When <xml>.idx can't be
+// written, the index stays in memory for this run.
+class BaselineIndex {
+ public:
+  BaselineIndex() = default;
+  ~BaselineIndex();
+  BaselineIndex(const BaselineIndex &) = delete;
+  void operator=(const BaselineIndex &) = delete;
+
+  static BaselineIndex *getPerfInstance();
+  static BaselineIndex *getAccuracyInstance();
+
+  bool load(const std::string &xml_file);
+  inline bool loaded() const { return data_ != nullptr; }
+  inline size_t size() const { return entry_num_; }
+
+  // O(1), thread-safe once loaded.
+  bool find(const std::string &case_name, BaselineRecord *record) const;
+
+  // index image of the xml read from stream.
+  static std::string build(std::istream *xml, uint64_t xml_size,
+                           int64_t xml_mtime);
+
+ private:
+  bool attach(const char *data, size_t bytes, uint64_t xml_size,
+              int64_t xml_mtime);
+  bool mapFile(const std::string &path, uint64_t xml_size, int64_t xml_mtime);
+  void reset();
+
+  void *map_ = nullptr;  // mmap of the index file
+  size_t map_bytes_ = 0;
+  std::string image_;  // index kept in memory, if it was not written
+  const char *data_ = nullptr;
+  uint64_t slot_num_ = 0;
+  uint64_t entry_num_ = 0;
+};
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_BASELINE_INDEX_H_
@@ -0,0 +1,92 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_BOX_GRID_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_BOX_GRID_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace mluoptest {
+
+// Bird's-eye-view grid over rotated 3-d boxes [cx, cy, cz, dx, dy, dz, rz]
+// for the point-in-box tests of point-cloud cpu baselines. Every box is
+// registered in the cells its rotated footprint may touch, with a slack
+// that covers the margins and float rounding of the baselines, so a point
+// only needs to be tested against the candidates of its own cell.
+class BoxGrid {
+ public:
+  // Index num boxes, which must outlive the grid. The rotation terms of box
+  // i are cos(-rz) and sin(-rz) rounded to float; float_trig evaluates them
+  // with the float overloads of std::cos and std::sin instead of double.
+  void build(const float *boxes, int64_t num, bool float_trig = false);
+
+  // Call func(box) for the candidate boxes of (x, y) in increasing index
+  // order, stopping when func returns true. Boxes not visited never
+  // contain (x, y).
+  template <typename Func>
+  void forEachCandidate(float x, float y, Func func) const {
+    const int64_t cell = cellCoord(0, x) + cellCoord(1, y) * dims_[0];
+    const int32_t *a = cell_box_.data() + cell_start_[cell];
+    const int32_t *a_end = cell_box_.data() + cell_start_[cell + 1];
+    const int32_t *b = wide_.data();
+    const int32_t *b_end = b + wide_.size();
+    // merge the boxes of the cell with the ones checked everywhere.
+    while (a != a_end || b != b_end) {
+      int32_t box = (b == b_end || (a != a_end && *a < *b)) ? *a++ : *b++;
+      if (func(box)) return;
+    }
+  }
+
+  // Coordinates of (x, y) in the frame of box i:
+  //   local_x = (x - cx) * cos(-rz) - (y - cy) * sin(-rz)
+  //   local_y = (x - cx) * sin(-rz) + (y - cy) * cos(-rz)
+  void localCoords(int64_t i, float x, float y, float *local_x,
+                   float *local_y) const {
+    const float shift_x = x - boxes_[i * 7 + 0];
+    const float shift_y = y - boxes_[i * 7 + 1];
+    const float cosa = rotation_[i * 2], sina = rotation_[i * 2 + 1];
+    *local_x = shift_x * cosa + shift_y * (-sina);
+    *local_y = shift_x * sina + shift_y * cosa;
+  }
+
+ private:
+  int64_t cellCoord(int axis, double v) const {
+    double t = (v - lo_[axis]) * inv_cell_size_;
+    if (!(t >= 0.0)) return 0;
+    if (t >= (double)(dims_[axis] - 1)) return dims_[axis] - 1;
+    return (int64_t)t;
+  }
+
+  const float *boxes_ = nullptr;
+  std::vector<float> rotation_;      // cos(-rz), sin(-rz) per box
+  double lo_[2] = {0.0, 0.0};
+  double inv_cell_size_ = 1.0;
+  int64_t dims_[2] = {1, 1};
+  std::vector<int64_t> cell_start_;  // boxes of cell c: [start[c], start[c+1])
+  std::vector<int32_t> cell_box_;    // box indices, increasing in a cell
+  std::vector<int32_t> wide_;  // boxes with a huge or non-finite footprint
+};
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_BOX_GRID_H_
@@ -1,5 +1,5 @@
 /*************************************************************************
- * Copyright (C) [2022] by Cambricon, Inc.
+ * Copyright (C) [2024] by Cambricon, Inc.
  *
  * Permission is hereby granted, free of charge, to any person obtaining a
  * copy of this software and associated documentation files (the
@@ -20,15 +20,30 @@
  * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_BOX_IOU_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_BOX_IOU_H_
 
-#ifndef TEST_MLU_OP_GTEST_PB_GTEST_SRC_ZOO_POLY_NMS_PNMS_IMPL_H_
-#define TEST_MLU_OP_GTEST_PB_GTEST_SRC_ZOO_POLY_NMS_PNMS_IMPL_H_
+namespace mluoptest {
 
-#include <vector>
+// Axis aligned boxes [x1, y1, x2, y2] in structure-of-arrays layout, with
+// the area of every box computed by the caller.
+struct BoxIouSoA {
+  const float *x1;
+  const float *y1;
+  const float *x2;
+  const float *y2;
+  const float *area;
+};
 
-using namespace std;  // NOLINT
+// iou[i] = IoU of box m of boxes with box i, for i in [begin, end). The
+// area of box m is passed in, since the baselines compute it differently.
+// When add_offset, offset is added to the sides of the intersection like
+// for pixel coordinates. Negative sides are clamped to 0 and NaN is kept.
+// Same operations as the scalar formula lane by lane, so results are
+// bitwise equal with or without AVX2.
+void boxIouRange(const BoxIouSoA &boxes, int m, float m_area, bool add_offset,
+                 float offset, int begin, int end, float *iou);
 
-namespace PNMS {
-vector<int> PolyNmsImpl(vector<vector<float>> &p, const float thresh);
-}  // namespace PNMS
-#endif  // TEST_MLU_OP_GTEST_PB_GTEST_SRC_ZOO_POLY_NMS_PNMS_IMPL_H_
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_BOX_IOU_H_
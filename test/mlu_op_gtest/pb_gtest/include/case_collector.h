@@ -27,9 +27,11 @@
 #include <dirent.h>
 #include <string.h>
 #include <list>
+#include <memory>
 #include <string>
 #include <iostream>
 #include <vector>
+#include "case_stream.h"
 #include "tools.h"
 #include "variable.h"
 #include "gtest/gtest.h"
@@ -48,17 +50,17 @@ class Collector {
   explicit Collector(const std::string &name);
   virtual ~Collector() {}
   std::vector<std::string> list();
+  // find cases in background, so they can run before the search is done.
+  std::shared_ptr<mluoptest::CaseStream> stream();
   size_t num();  // return gtest repeat num NOT case number.
 
  private:
   std::string op_name_ = "";
-  std::vector<std::string> read_case(std::string file_name);
-  void grep_case(std::string dir, std::vector<std::string> &res);
-  void grep_dir(std::string dir, std::vector<std::string> &op_dirs);
   std::string current_dir();
 
-  std::vector<std::string> list_by_case_list(std::string);
-  std::vector<std::string> list_by_case_dir(std::string);
+  std::shared_ptr<mluoptest::CaseStream> start();
+  std::shared_ptr<mluoptest::CaseStream> stream_by_case_list(std::string);
+  std::shared_ptr<mluoptest::CaseStream> stream_by_case_dir(std::string);
   std::vector<std::string> list_by_case_path(std::string);
 
   void assertPath(std::string &, caseType, std::string, int);
@@ -0,0 +1,107 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_CASE_STREAM_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_CASE_STREAM_H_
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <mutex>   // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+namespace mluoptest {
+
+// Which of the discovered cases to run, set by --cases_include,
+// --cases_exclude, --cases_shard_index and --cases_shard_count.
+// A glob without '/' is matched against the file name, otherwise against
+// the whole path. A case belongs to shard hash(case_path) % shard_count, so
+// the split doesn't depend on the order cases are found in.
+struct CaseFilter {
+  std::vector<std::string> include;  // empty for every case
+  std::vector<std::string> exclude;
+  int shard_index = 0;
+  int shard_count = 1;
+
+  bool accept(const std::string &case_path) const;
+};
+
+// split "a,b,c" into items, empty items are dropped.
+std::vector<std::string> splitList(const std::string &str, char delimiter);
+
+// Case paths handed from the producers (directory walker threads or the
+// cases_list reader) to the scheduler while discovery is still running, so
+// the first case starts as soon as it is found.
+class CaseStream {
+ public:
+  explicit CaseStream(const CaseFilter &filter);
+  CaseStream(const CaseStream &) = delete;
+  void operator=(const CaseStream &) = delete;
+  // stops the producers and joins them.
+  ~CaseStream();
+
+  // walk roots with thread_num threads in background, *.pb and *.prototxt
+  // without "invalid" in the path are cases. If op_name is not empty, only
+  // the files under a directory named op_name are taken.
+  void walk(const std::vector<std::string> &roots, const std::string &op_name,
+            size_t thread_num);
+  // read cases_list in background, lines without "/<op_name>/" are skipped.
+  void readList(const std::string &list_file, const std::string &op_name);
+  // add cases known already, filters are not applied to them.
+  void pushAll(const std::vector<std::string> &case_paths);
+
+  // block until the next case is found, returns false once all the producers
+  // are done and every case has been taken.
+  bool next(std::string *case_path);
+  // wait for the producers and return the cases not taken yet.
+  std::vector<std::string> drain();
+
+ private:
+  struct DirItem {
+    std::string path;
+    bool in_op_dir;
+  };
+  void walkDirs(const std::string &op_name);
+  void emit(std::string case_path);
+  void producerDone();
+
+  CaseFilter filter_;
+  std::atomic<bool> stop_;
+  std::vector<std::thread> threads_;
+
+  std::mutex mtx_;  // guard everything below
+  std::condition_variable cond_;
+  std::deque<std::string> cases_;
+  size_t running_ = 0;  // producers (walk or readList) not done yet
+
+  // directories to visit, shared by the walker threads.
+  std::mutex dir_mtx_;
+  std::condition_variable dir_cond_;
+  std::vector<DirItem> dirs_;
+  size_t pending_dirs_ = 0;  // queued or being read
+};
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_CASE_STREAM_H_
@@ -0,0 +1,86 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_CHANNEL_REDUCE_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_CHANNEL_REDUCE_H_
+
+#include <cstdint>
+#include <functional>
+
+namespace mluoptest {
+
+// Count, mean and sum of squared deviations of one channel (Welford).
+struct WelfordMoments {
+  double count = 0;
+  double mean = 0;
+  double m2 = 0;
+
+  void add(double value) {
+    count += 1;
+    const double delta = value - mean;
+    mean += delta / count;
+    m2 += delta * (value - mean);
+  }
+  double variance() const { return count > 0 ? m2 / count : 0; }
+};
+
+// Chan's pairwise update: a becomes the moments of a and b together.
+void welfordMerge(WelfordMoments *a, const WelfordMoments &b);
+
+// Adds one contiguous row of a channel-last tensor, row[c] going to
+// moments[c]. All moments must have seen the same rows so far, which lets
+// the row share one division.
+void welfordAddRow(const float *row, int channels, WelfordMoments *moments);
+
+// Rows of a [rows][channels] reduction are cut into at most
+// kChannelReduceMaxBlocks blocks of at least kChannelReduceMinRows rows.
+// The cut depends on rows only, never on the thread count.
+constexpr int kChannelReduceMaxBlocks = 64;
+constexpr int64_t kChannelReduceMinRows = 256;
+
+// Per-channel moments of a channel-last tensor. Blocks run in parallel;
+// add_rows(begin, end, moments) streams rows [begin, end) into the
+// block's own moments[channels], e.g. with welfordAddRow. The
+// blocks are then merged pairwise in a fixed tree, so the result is
+// reproducible.
+void channelMoments(
+    int64_t rows, int channels,
+    const std::function<void(int64_t, int64_t, WelfordMoments *)> &add_rows,
+    WelfordMoments *moments);
+
+// Same for plain sums: add_rows(begin, end, sums) adds rows [begin, end)
+// into the block's own zeroed sums[width] and blocks are summed pairwise.
+void channelSums(
+    int64_t rows, int width,
+    const std::function<void(int64_t, int64_t, double *)> &add_rows,
+    double *sums);
+
+// Elementwise passes over a [rows][channels] tensor: func(begin, end) runs
+// on row ranges in parallel, a chunk holding about kChannelRowsChunkElems
+// elements.
+constexpr int64_t kChannelRowsChunkElems = 1 << 14;
+void channelRows(int64_t rows, int channels,
+                 const std::function<void(int64_t, int64_t)> &func);
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_CHANNEL_REDUCE_H_
@@ -0,0 +1,63 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_CPU_GEMM_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_CPU_GEMM_H_
+
+#include <cstdint>
+
+namespace mluoptest {
+
+// k is consumed in blocks of this many elements, and the partial sum of each
+// block is added to C in turn. Splitting k at multiples of it into calls
+// with beta 1 thus gives the same bits as a single call.
+constexpr int64_t kCpuGemmKBlock = 256;
+
+// Bumped whenever the rounding of cpuSgemm results changes. Executors whose
+// baseline goes through cpuSgemm return it from cpuComputeVersion(), so
+// baselines cached by an older build are not reused.
+constexpr int64_t kCpuGemmVersion = 1;
+
+// Row-major single precision GEMM for cpu baselines:
+//   C = alpha * op(A) * op(B) + beta * C
+// op(A) is m x k, op(B) is k x n and C is m x n, arguments follow
+// cblas_sgemm(CblasRowMajor, ...). When beta is 0, C is not read.
+// Every element of C is accumulated over k in the same order whatever the
+// number of host threads, so results are reproducible.
+void cpuSgemm(bool trans_a, bool trans_b, int64_t m, int64_t n, int64_t k,
+              float alpha, const float *a, int64_t lda, const float *b,
+              int64_t ldb, float beta, float *c, int64_t ldc);
+
+// batch independent GEMMs, the i-th one uses a + i * stride_a,
+// b + i * stride_b and c + i * stride_c.
+void cpuSgemmBatched(bool trans_a, bool trans_b, int64_t m, int64_t n,
+                     int64_t k, float alpha, const float *a, int64_t lda,
+                     int64_t stride_a, const float *b, int64_t ldb,
+                     int64_t stride_b, float beta, float *c, int64_t ldc,
+                     int64_t stride_c, int64_t batch);
+
+// name of the micro-kernel selected for this cpu: avx512, avx2 or scalar.
+const char *cpuGemmKernelName();
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_CPU_GEMM_H_
@@ -0,0 +1,55 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_CPU_MS_DEFORM_ATTN_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_CPU_MS_DEFORM_ATTN_H_
+
+#include <cstdint>
+
+namespace mluoptest {
+
+// Multi-scale deformable attention of value [batch_size, num_keys,
+// num_heads, channels] sampled at sampling_loc [batch_size, num_query,
+// num_heads, num_levels, num_point, 2]. data_col is
+// [batch_size, num_query, num_heads, channels].
+void msDeformAttnForwardCpu(
+    const float *data_value, const float *data_spatial_shapes,
+    const float *data_level_start_index, const float *data_sampling_loc,
+    const float *data_attn_weight, const int batch_size, const int num_keys,
+    const int num_heads, const int channels, const int num_levels,
+    const int num_query, const int num_point, float *data_col);
+
+// Gradients of msDeformAttnForwardCpu for grad_output shaped like data_col.
+// They are accumulated into grad_value, grad_sampling_loc and
+// grad_attn_weight, which the caller zeroes.
+void msDeformAttnBackwardCpu(
+    const float *value, const float *spatial_shapes,
+    const float *level_start_index, const float *sampling_loc,
+    const float *attn_weight, const float *grad_output, const int32_t batch,
+    const int32_t spatial_size, const int32_t num_heads,
+    const int32_t channels, const int32_t num_levels,
+    const int32_t num_query, const int32_t num_point, float *grad_value,
+    float *grad_sampling_loc, float *grad_attn_weight);
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_CPU_MS_DEFORM_ATTN_H_
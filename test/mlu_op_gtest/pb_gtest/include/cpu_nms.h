@@ -0,0 +1,56 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_CPU_NMS_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_CPU_NMS_H_
+
+#include "mlu_op.h"
+
+namespace mluoptest {
+
+// nms_param of a 2D NMS case.
+struct NmsParam {
+  int keep_num;
+  float thresh_iou;
+  float thresh_score;
+  mluOpNmsAlgo_t algo;
+  float offset;
+  mluOpNmsBoxPointMode_t box_mode;
+  mluOpNmsMethodMode_t method_mode;
+  float soft_nms_sigma;
+};
+
+// 2D NMS of every (batch, class) pair, returns the number of output boxes.
+// Boxes are [batches, boxes_num, 4] (input_layout 0) or [batches, 4,
+// boxes_num] (input_layout 1), scores are [batches, classes, boxes_num].
+// Hard NMS sorts the scores once and compacts the survivors, soft NMS and
+// scores with NaN run the greedy arg max loop; both select the same boxes
+// as the greedy definition, ties going to the smaller index.
+int nmsDetectionCpu(float *output_info, const float *input_boxes,
+                    const float *input_conf, int input_batches_num,
+                    int input_classes_num, int input_boxes_num,
+                    int input_layout, mluOpNmsOutputMode_t mode,
+                    const NmsParam &param);
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_CPU_NMS_H_
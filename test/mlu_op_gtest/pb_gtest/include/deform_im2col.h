@@ -0,0 +1,63 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_DEFORM_IM2COL_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_DEFORM_IM2COL_H_
+
+#include <cstdint>
+
+namespace mluoptest {
+
+// Geometry of a 2-d deformable convolution in NHWC layout:
+//   input :[n,hi,wi,ci]
+//   offset:[n,ho,wo,dg*kh*kw*2]
+//   mask  :[n,ho,wo,dg*kh*kw]  // optional
+// An output row is one output pixel, row = (idx_n * ho + idx_ho) * wo + idx_wo.
+struct DeformConvShape {
+  int hi, wi, ci;
+  int ho, wo;
+  int kh, kw;
+  int pt, pl;
+  int sh, sw;
+  int dh, dw;
+  int dg;  // deformable groups
+  int g;   // convolution groups
+};
+
+// Output rows per column tile, so a tile of every group holds about
+// kDeformColumnTileFloats floats whatever the batch and spatial size. The
+// result is a multiple of align (at least align) so tiles can also split the
+// k dimension of a GEMM, see kCpuGemmKBlock.
+int64_t deformColumnTileRows(const DeformConvShape &s, int64_t align = 1);
+constexpr int64_t kDeformColumnTileFloats = (int64_t)1 << 22;
+
+// Deformable im2col of output rows [row_begin, row_end) into columns laid out
+// as [g][row_end - row_begin][kh*kw*ci/g], which is the A matrix of the
+// grouped GEMM without any transpose. Samples outside the input are zero.
+// Rows run in parallel; values are bit-identical to the per-channel kernel.
+void deformIm2col(const DeformConvShape &s, const float *input,
+                  const float *offset, const float *mask, int64_t row_begin,
+                  int64_t row_end, float *columns);
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_DEFORM_IM2COL_H_
@@ -28,6 +28,8 @@
 #include <limits>
 #endif
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
@@ -52,6 +54,7 @@
 #include "variable.h"
 #include "perf_test.h"
 #include "accuracy_test.h"
+#include "parallel_for.h"
 
 namespace mluoptest {
 
@@ -67,152 +70,115 @@ namespace mluoptest {
 const double EPSILON = 1e-9;
 const double EPSILON_FLOAT = 1e-6;
 const double EPSILON_HALF = 1e-4;
-
-#ifdef __AVX__
-// found inf or nan, return true.
-template <typename T>
-static bool hasNanOrInf(T *data, size_t count);
-
-template <>
-bool hasNanOrInf<float>(float *data, size_t count) {
-  const __m256 exp_bit = _mm256_set1_ps(std::numeric_limits<float>::infinity());
-  size_t stride =
-      256 / (sizeof(float) * 8);  // 1 __m256 saved 8 * (sizeof(float) * 8 bit)
-  size_t deal_count = (count / stride) * stride;
-  __m256 m_data;
-  for (size_t i = 0; i < deal_count; i += stride) {
-    m_data = _mm256_load_ps(data + i);
-    m_data = _mm256_and_ps(exp_bit, m_data);
-    m_data = _mm256_cmp_ps(m_data, exp_bit, _CMP_EQ_OQ);
-    if (_mm256_movemask_ps(m_data) != 0) {
-      return true;
-    }
+const double EPSILON_KL = 1e-10;
+
+// Partial results of the fused error evaluation over one chunk of elements.
+// Sums and maxima are kept per lane (element index % 4): for complex data the
+// even lanes are real parts and the odd lanes imaginary parts, and the SIMD
+// kernels keep one accumulator per vector lane.
+struct DiffSums {
+  double diff1_num[4] = {0, 0, 0, 0};    // sum(|mlu - baseline|)
+  double diff1_den[4] = {0, 0, 0, 0};    // sum(|baseline|)
+  double diff2_num[4] = {0, 0, 0, 0};    // sum((mlu - baseline)^2)
+  double diff2_den[4] = {0, 0, 0, 0};    // sum(baseline^2)
+  double diff3_max[4] = {0, 0, 0, 0};    // max relative error
+  double diff3_2_max[4] = {0, 0, 0, 0};  // max(|mlu - baseline|)
+  // for DIFF_KL, with p = max(|baseline|, eps), q = max(|mlu|, eps):
+  // sum(p), sum(q), sum(p * log(p / q)) and sum(q * log(p / q)).
+  double kl_base_sum = 0;
+  double kl_mlu_sum = 0;
+  double kl_base_log = 0;
+  double kl_mlu_log = 0;
+  // nan/inf bookkeeping
+  size_t nan_inf_num = 0;   // positions where baseline or mlu is nan/inf
+  size_t nan_pair_num = 0;  // both nan, treated as 0 at threshold level 1
+  size_t inf_pair_num = 0;  // equal inf, treated as 0 at threshold level 1
+  size_t wrong_num = 0;     // nan/inf positions that make the case fail
+  size_t wrong_pos = SIZE_MAX;  // first of them
+  size_t neq_pos = SIZE_MAX;    // first nan vs inf position in loose mode
+
+  inline void add(double baseline, double mlu, size_t lane, double eps3) {
+    double diff = mlu - baseline;
+    double abs_diff = std::abs(diff);
+    double abs_base = std::abs(baseline);
+    diff1_num[lane] += abs_diff;
+    diff1_den[lane] += abs_base;
+    diff2_num[lane] += diff * diff;
+    diff2_den[lane] += baseline * baseline;
+    double ratio =
+        (abs_base < eps3) ? abs_diff : abs_diff / (abs_base + EPSILON);
+    diff3_max[lane] = (ratio > diff3_max[lane]) ? ratio : diff3_max[lane];
+    diff3_2_max[lane] =
+        (abs_diff > diff3_2_max[lane]) ? abs_diff : diff3_2_max[lane];
   }
-  for (size_t i = deal_count; i < count; ++i) {
-    if (std::isnan(data[i]) || std::isinf(data[i])) {
-      return true;
-    }
-  }
-  return false;
-}
 
-template <>
-bool hasNanOrInf<double>(double *data, size_t count) {
-  const __m256d exp_bit =
-      _mm256_set1_pd(std::numeric_limits<double>::infinity());
-  size_t stride = 256 / (sizeof(double) *
-                         8);  // 1 __m256 saved 4 * (sizeof(double) * 8 bit)
-  size_t deal_count = (count / stride) * stride;
-  __m256d m_data;
-  for (size_t i = 0; i < deal_count; i += stride) {
-    m_data = _mm256_load_pd(data + i);
-    m_data = _mm256_and_pd(exp_bit, m_data);
-    m_data = _mm256_cmp_pd(m_data, exp_bit, _CMP_EQ_OQ);
-    if (_mm256_movemask_pd(m_data) != 0) {
-      return true;
-    }
-  }
-  for (size_t i = deal_count; i < count; ++i) {
-    if (std::isnan(data[i]) || std::isinf(data[i])) {
-      return true;
-    }
+  inline void addKl(double baseline, double mlu) {
+    double p = std::max(std::abs(baseline), EPSILON_KL);
+    double q = std::max(std::abs(mlu), EPSILON_KL);
+    double log_ratio = std::log(p / q);
+    kl_base_sum += p;
+    kl_mlu_sum += q;
+    kl_base_log += p * log_ratio;
+    kl_mlu_log += q * log_ratio;
   }
-  return false;
-}
 
-template <typename T>
-static bool twoBytesNanInf(T *data, size_t count, int first_mask,
-                           int second_mask) {
-  float *data_float = reinterpret_cast<float *>(data);
-  __m256 first_half_inf_bit = _mm256_set1_ps(*(float *)&first_mask);
-  __m256 second_half_inf_bit = _mm256_set1_ps(*(float *)&second_mask);
-
-  size_t stride = 256 / (sizeof(float) * 8);
-  size_t deal_count = (count / 2 / stride) * stride;
-
-  __m256 m_data;
-  for (size_t i = 0; i < deal_count; i += stride) {
-    m_data = _mm256_loadu_ps(data_float + i);
-    m_data = _mm256_and_ps(first_half_inf_bit, m_data);
-    m_data = _mm256_cmp_ps(m_data, first_half_inf_bit, _CMP_EQ_OQ);
-    if (_mm256_movemask_ps(m_data) != 0) {
-      return true;
-    }
-  }
-  for (size_t i = 0; i < deal_count; i += stride) {
-    m_data = _mm256_loadu_ps(data_float + i);
-    m_data = _mm256_and_ps(second_half_inf_bit, m_data);
-    m_data = _mm256_cmp_ps(m_data, second_half_inf_bit, _CMP_EQ_OQ);
-    if (_mm256_movemask_ps(m_data) != 0) {
-      return true;
-    }
-  }
-  for (size_t i = deal_count * 2; i < count; ++i) {
-    if (std::isnan(data[i]) || std::isinf(data[i])) {
-      return true;
-    }
-  }
-  return false;
-}
-
-template <>
-bool hasNanOrInf<half>(half *data, size_t count) {
-  return twoBytesNanInf(data, count, 0x7c000000, 0x00007c00);
-}
-
-// TODO(None): test itself
-template <>
-bool hasNanOrInf<bfloat16>(bfloat16 *data, size_t count) {
-  return twoBytesNanInf(data, count, 0x7f800000, 0x00007f80);
-}
+  void merge(const DiffSums &other);
+};
 
-#else  // __AVX__
+// Accumulate the DIFF1/DIFF2/DIFF3/DIFF3_2 terms of baseline[0, n) and
+// mlu[0, n) into the zero-initialized sums, where element i goes to lane
+// i % 4 (so the arrays must start at a global index that is a multiple of 4).
+// Returns false if any element is nan/inf, sums are unusable in that case and
+// the caller falls back to the scalar path. Only float and double have a
+// vectorized version.
+bool accumulateFiniteDiff(const float *baseline, const float *mlu, size_t n,
+                          double eps3, bool need_diff3, DiffSums *sums);
+bool accumulateFiniteDiff(const double *baseline, const double *mlu, size_t n,
+                          double eps3, bool need_diff3, DiffSums *sums);
 template <typename T>
-bool hasNanOrInf(T *data, size_t count) {
-  for (size_t i = 0; i < count; ++i) {
-    if (std::isinf(data[i]) || std::isnan(data[i])) {
-      return true;
-    }
-  }
+bool accumulateFiniteDiff(const T *baseline, const T *mlu, size_t n,
+                          double eps3, bool need_diff3, DiffSums *sums) {
   return false;
 }
-#endif
 
-template <typename T>
-bool isNanOrInf(T data) {
-  if (std::isinf(data) || std::isnan(data)) {
-    return true;
+// Set of distinct (mlu, baseline) pairs for DIFF4. Values are identified by
+// their bits, so -0 must be canonicalized to 0 and nan must not be inserted.
+class Diff4PairSet {
+ public:
+  // size hint of the hash index.
+  void reserve(size_t size);
+  template <typename T>
+  void insert(T mlu, T baseline) {
+    static_assert(sizeof(T) <= sizeof(uint64_t), "DIFF4 value is too wide.");
+    Pair pair;
+    std::memcpy(&pair.mlu, &mlu, sizeof(T));
+    std::memcpy(&pair.base, &baseline, sizeof(T));
+    pair.less = mlu < baseline;
+    insert(pair);
   }
-  return false;
-}
+  void merge(const Diff4PairSet &other);
+  // release the hash index, merge() into another set still works.
+  void finish();
+  size_t size() const { return pairs_.size(); }
+  // number of pairs where mlu < baseline
+  size_t lessCount() const;
 
-template <typename T>
-static void resetNanOrInfAsZero(T *a, T *b, size_t count) {
-  bool has_nan = false;
-  bool has_inf = false;
-
-  for (size_t i = 0; i < count; ++i) {
-    if (unlikely(std::isnan(a[i]) && std::isnan(b[i]))) {
-      a[i] = (T)0;
-      b[i] = (T)0;
-      has_nan = true;
-    } else if (unlikely(std::isinf(a[i]) && std::isinf(b[i]) && a[i] == b[i])) {
-      // if a is inf, b is -inf, don't deal here.
-      // when check hasNanOrInf will set diff as DBL_MAX (instead infinity).
-      a[i] = (T)0;
-      b[i] = (T)0;
-      has_inf = true;
-    }
-  }
-  if (has_nan) {
-    VLOG(4) << "Found result of baseline and mlu are both NaN, set them as 0, "
-               "and go on.";
-  }
-  if (has_inf) {
-    VLOG(4) << "Found result of baseline and mlu are both Inf, set them as 0, "
-               "and go on.";
-  }
-}
+ private:
+  struct Pair {
+    uint64_t mlu = 0;
+    uint64_t base = 0;
+    bool less = false;
+  };
+  void insert(const Pair &pair);
+  void rehash(size_t slot_num);
+  std::vector<size_t> slots_;  // index + 1 into pairs_, 0 for empty slot
+  std::vector<Pair> pairs_;
+};
+
+// merge sums[begin, end) pairwise, so the rounding is independent of the
+// number of threads that produced them.
+DiffSums mergeDiffSums(const std::vector<DiffSums> &sums, size_t begin,
+                       size_t end);
 
 enum StorageDtype {
   FLOAT = 0,
@@ -303,380 +269,116 @@ class Evaluator {
   double getMluWorkspaceSize() { return workspace_size_; }
 
  private:
-  // distinguish_nan_inf
+  // -0 and 0 are the same value for DIFF4 deduplication.
   template <typename T>
-  bool compareNanInfStrict(T mlu_out[], T baseline_out[], size_t index) {
-    T mlu = mlu_out[index];
-    T baseline = baseline_out[index];
-    if (!((std::isnan(mlu) && std::isnan(baseline)) || (mlu == baseline))) {
-      return false;
-    }
-    return true;
-  }
-
-  // not distinguish_nan_inf
-  template <typename T>
-  bool compareNanInfLoose(T mlu_out[], T baseline_out[], size_t index) {
-    T mlu = mlu_out[index];
-    T baseline = baseline_out[index];
-    if (std::isnan(mlu)) {
-      if (std::isnan(baseline)) {
-        return true;
-      } else if (std::isinf(baseline)) {
-        nan_inf_neq_pos_.emplace_back(index);
-        return true;
-      } else {
-        return false;
-      }
-    }  // mlu is nan
-    if (std::isinf(mlu)) {
-      if (mlu == baseline) {
-        return true;
-      } else if (std::isnan(baseline)) {
-        nan_inf_neq_pos_.emplace_back(index);
-        return true;
-      } else {
-        return false;
-      }
-    }
-    return true;
+  static T canonicalZero(T value) {
+    return (value == T(0)) ? T(0) : value;
   }
 
-  // if forst level accuracy(wiki:52441150), only compare nan/inf, skip other
-  // position
+  // evaluate one chunk [begin, end) of the arrays, see computeDiffFused().
   template <typename T>
-  void dealNanInf() {
-    skip_compute_diff_ = false;
-    bool has_nan_inf = false;
-    T *a = reinterpret_cast<T *>(base_array_);
-    T *b = reinterpret_cast<T *>(mlu_array_);
-    if (threshold_l1_) {
-      resetNanOrInfAsZero(a, b, count_total_);
-      nanInfRemain<T>();
+  void computeDiffChunk(const T *base_array, const T *mlu_array, size_t begin,
+                        size_t end, DiffSums *sums, Diff4PairSet *diff4_sets) {
+    bool finite = accumulateFiniteDiff(base_array + begin, mlu_array + begin,
+                                       end - begin, diff3_eps_, need_diff3_,
+                                       sums);
+    if (!finite) {
+      *sums = DiffSums();
+    } else if (!need_kl_ && !need_diff4_) {
       return;
     }
-    // TODO(None): have vector.push_back() in for loop, open it after
-    // modify code logic #pragma omp parallel for schedule(guided)
-    for (size_t i = 0; i < count_total_; ++i) {
-      if (isNanOrInf(a[i]) || isNanOrInf(b[i])) {
-        skip_compute_diff_ = true;
-        has_nan_inf = true;
-        bool res = false;
-        if (true == global_var.loose_check_nan_inf_) {
-          res = compareNanInfLoose(a, b, i);
-        } else {
-          res = compareNanInfStrict(a, b, i);
-        }
-        if (false == res) {
-          nan_inf_wrong_pos_.emplace_back(i);
-          nan_inf_pass_ = false;
-        }
-      }
+    for (int part = 0; need_diff4_ && part < stride_; ++part) {
+      diff4_sets[part].reserve((end - begin) / stride_);
     }
-    if (!nan_inf_wrong_pos_.empty()) {
-      auto first_pos = *std::min_element(std::begin(nan_inf_wrong_pos_),
-                                         std::end(nan_inf_wrong_pos_));
-      LOG(ERROR) << "Found NaN or Inf, but mlu is not equal to baseline,"
-                 << " return DBL_MAX instead."
-                 << "The first wrong position is " << first_pos;
-      return;
-    }
-    if (has_nan_inf) {
-      nan_inf_pass_ = true;
-      if (!nan_inf_neq_pos_.empty()) {
-        auto first_pos = *std::min_element(std::begin(nan_inf_neq_pos_),
-                                           std::end(nan_inf_neq_pos_));
-        LOG(WARNING) << "The results of baseline and mlu are not equal, "
-                     << "one of them is nan and the other is inf, "
-                     << "the current mode will not distinguish nan and inf, "
-                     << "this case will pass. The first position is "
-                     << first_pos;
-      }
-    }
-  }
-
-  template <typename T>
-  void compute_diff() {
-    if (skip_compute_diff_) {
-      return;
-    }
-    switch (func_) {
-      case Evaluator::Formula::DIFF1: {
-        computeDiff1<T>();
-      } break;
-      case Evaluator::Formula::DIFF2: {
-        computeDiff2<T>();
-      } break;
-      case Evaluator::Formula::DIFF3: {
-        computeDiff3<T>();
-      } break;
-      case Evaluator::Formula::DIFF3_2: {
-        computeDiff3_2<T>();
-      } break;
-      case Evaluator::Formula::DIFF4: {
-        computeDiff4<T>();
-      } break;
-      case Evaluator::Formula::DIFF_KL: {
-        computeDiffKl<T>();
-      } break;
-      default: {
-        GTEST_CHECK(false,
-                    "Evaluator: found unsupported criterion when compute "
-                    "result error.");
-      }
-    }
-  }
-
-  template <typename T>
-  void computeDiff1() {
-    double numerator_sum = 0.0;
-    double numerator_sum_imag = 0.0;
-    double denominator_sum = 0.0;
-    double denominator_sum_imag = 0.0;
-    T *base_array = reinterpret_cast<T *>(base_array_);
-    T *mlu_array = reinterpret_cast<T *>(mlu_array_);
-#pragma omp parallel for reduction \
-        (+:numerator_sum, denominator_sum, numerator_sum_imag, \
-         denominator_sum_imag) schedule(guided)
-    for (size_t i = 0; i < count_total_; i += stride_) {
-      numerator_sum += std::abs(double(mlu_array[i]) - double(base_array[i]));
-      denominator_sum += std::abs(double(base_array[i]));
-      if (is_complex_) {
-        numerator_sum_imag +=
-            std::abs(double(mlu_array[i + 1]) - double(base_array[i + 1]));
-        denominator_sum_imag += std::abs(double(base_array[i + 1]));
-      }
-    }  // end omp parallel block
-    error_ = numerator_sum / (denominator_sum + EPSILON);
-    if (is_complex_) {
-      error_imag_ = numerator_sum_imag / (denominator_sum_imag + EPSILON);
-    }
-  }
-
-  template <typename T>
-  void computeDiff2() {
-    double numerator_sum = 0.0;
-    double numerator_sum_imag = 0.0;
-    double denominator_sum = 0.0;
-    double denominator_sum_imag = 0.0;
-    T *base_array = reinterpret_cast<T *>(base_array_);
-    T *mlu_array = reinterpret_cast<T *>(mlu_array_);
-#pragma omp parallel for reduction \
-        (+:numerator_sum, denominator_sum, numerator_sum_imag, \
-        denominator_sum_imag) schedule(guided)
-    for (size_t i = 0; i < count_total_; i += stride_) {
-      numerator_sum +=
-          std::pow(double(mlu_array[i]) - double(base_array[i]), 2);
-      denominator_sum += std::pow(double(base_array[i]), 2);
-      if (is_complex_) {
-        numerator_sum_imag +=
-            std::pow(double(mlu_array[i + 1]) - double(base_array[i + 1]), 2);
-        denominator_sum_imag += std::pow(double(base_array[i + 1]), 2);
-      }
-    }  // end omp parallel block
-    error_ = std::sqrt(numerator_sum / (denominator_sum + EPSILON));
-    if (is_complex_) {
-      error_imag_ =
-          std::sqrt(numerator_sum_imag / (denominator_sum_imag + EPSILON));
-    }
-  }
-
-  template <typename T>
-  void computeDiff3() {
-    T *base_array = reinterpret_cast<T *>(base_array_);
-    T *mlu_array = reinterpret_cast<T *>(mlu_array_);
-    double max_ratio = 0;
-    double max_ratio_imag = 0;
-    double EPS = 0;
-    if (dtype_ == MLUOP_DTYPE_HALF || dtype_ == MLUOP_DTYPE_COMPLEX_HALF) {
-      EPS = EPSILON_HALF;
-    } else if (dtype_ == MLUOP_DTYPE_FLOAT ||
-               dtype_ == MLUOP_DTYPE_COMPLEX_FLOAT) {
-      EPS = EPSILON_FLOAT;
-    }
-#pragma omp parallel for reduction(max                          \
-                                   : max_ratio, max_ratio_imag) \
-    schedule(guided)
-    for (size_t i = 0; i < count_total_; i += stride_) {
-      double numerator = std::abs(double(mlu_array[i]) - double(base_array[i]));
-      double denominator = std::abs(double(base_array[i]));
-      double ratio =
-          (denominator < EPS) ? numerator : numerator / (denominator + EPSILON);
-      max_ratio = (ratio > max_ratio) ? ratio : max_ratio;
-      if (is_complex_) {
-        numerator =
-            std::abs(double(mlu_array[i + 1]) - double(base_array[i + 1]));
-        denominator = std::abs(double(base_array[i + 1]));
-        ratio = (denominator < EPS) ? numerator
-                                    : numerator / (denominator + EPSILON);
-        max_ratio_imag = (ratio > max_ratio_imag) ? ratio : max_ratio_imag;
-      }
-    }  // end omp parallel block
-    error_ = max_ratio;
-    if (is_complex_) {
-      error_imag_ = max_ratio_imag;
-    }
-  }
-
-  template <typename T>
-  void computeDiff3_2() {
-    T *base_array = reinterpret_cast<T *>(base_array_);
-    T *mlu_array = reinterpret_cast<T *>(mlu_array_);
-    double max_ratio = 0;
-    double max_ratio_imag = 0;
-#pragma omp parallel for reduction(max                          \
-                                   : max_ratio, max_ratio_imag) \
-    schedule(guided)
-    for (size_t i = 0; i < count_total_; i += stride_) {
-      double ratio = std::abs(double(mlu_array[i]) - double(base_array[i]));
-      max_ratio = (ratio > max_ratio) ? ratio : max_ratio;
-      if (is_complex_) {
-        ratio = std::abs(double(mlu_array[i + 1]) - double(base_array[i + 1]));
-        max_ratio_imag = (ratio > max_ratio_imag) ? ratio : max_ratio_imag;
-      }
-    }  // end omp parallel block
-    error_ = max_ratio;
-    if (is_complex_) {
-      error_imag_ = max_ratio_imag;
-    }
-  }
-
-  template <typename T>
-  struct TupleHash {
-    size_t operator()(const std::tuple<T, T> &t) const {
-      size_t seed;
-      hash_combine(seed, (T)std::get<0>(t));
-      hash_combine(seed, (T)std::get<1>(t));
-      return seed;
-    }
-  };
-
-#ifndef KL_EPSILON
-#define KL_EPSILON (1e-10)
-  template <typename T>
-  double diff_kl(T *data1, T *data2, size_t elem_num) {
-    double data1_sum = 0.0;
-    double data2_sum = 0.0;
-#pragma omp parallel for reduction(+ : data1_sum, data2_sum) schedule(guided)
-    for (size_t i = 0; i < elem_num; i++) {
-      data1_sum += std::max(std::abs((double)data1[i]), (double)KL_EPSILON);
-      data2_sum += std::max(std::abs((double)data2[i]), (double)KL_EPSILON);
-    }  // end omp parallel block
-    double entropy = 0.0;
-#pragma omp parallel for reduction(+ : entropy) schedule(guided)
-    for (size_t i = 0; i < elem_num; i++) {
-      double data1_prob =
-          std::max(std::abs((double)data1[i]), (double)KL_EPSILON) / data1_sum;
-      double data2_prob =
-          std::max(std::abs((double)data2[i]), (double)KL_EPSILON) / data2_sum;
-      entropy += 0.5 * data1_prob * log(data1_prob / data2_prob) +
-                 0.5 * data2_prob * log(data2_prob / data1_prob);
-    }  // end omp parallel block
-    return entropy;
-  }
-#endif
-
-  template <typename T>
-  void computeDiff4() {
-    T *base_array = reinterpret_cast<T *>(base_array_);
-    T *mlu_array = reinterpret_cast<T *>(mlu_array_);
-    double max_count = 0;
-    double num_count = 0;
-    double max_count_imag = 0;
-    double num_count_imag = 0;
-    std::unordered_set<std::tuple<T, T>, TupleHash<T>> unrepeat_res;
-    std::unordered_set<std::tuple<T, T>, TupleHash<T>> unrepeat_res_imag;
-    for (size_t i = 0; i < count_total_; i += stride_) {
-      if (is_complex_) {
-        if (mlu_array[i + 1] != base_array[i + 1]) {
-          auto unrepeat_tuple =
-              std::make_tuple(mlu_array[i + 1], base_array[i + 1]);
-          if (unrepeat_res_imag.end() ==
-              unrepeat_res_imag.find(unrepeat_tuple)) {
-            max_count_imag += mlu_array[i + 1] < base_array[i + 1];
-            num_count_imag++;
-            unrepeat_res_imag.emplace(unrepeat_tuple);
+    for (size_t i = begin; i < end; ++i) {
+      double base = double(base_array[i]);
+      double mlu = double(mlu_array[i]);
+      bool reset_as_zero = false;
+      if (!finite) {
+        if (unlikely(!std::isfinite(base) || !std::isfinite(mlu))) {
+          if (!resetNanInfAsZero(base, mlu, i, sums)) {
+            continue;
           }
+          base = 0;
+          mlu = 0;
+          reset_as_zero = true;
         }
+        sums->add(base, mlu, i & 3, diff3_eps_);
       }
-      if (mlu_array[i] != base_array[i]) {
-        auto unrepeat_tuple = std::make_tuple(mlu_array[i], base_array[i]);
-        if (unrepeat_res.end() == unrepeat_res.find(unrepeat_tuple)) {
-          max_count += mlu_array[i] < base_array[i];
-          num_count++;
-          unrepeat_res.emplace(unrepeat_tuple);
-        }
+      if (need_kl_) {
+        sums->addKl(base, mlu);
+      }
+      if (need_diff4_ && !reset_as_zero && mlu_array[i] != base_array[i]) {
+        diff4_sets[is_complex_ ? (i & 1) : 0].insert(
+            canonicalZero(mlu_array[i]), canonicalZero(base_array[i]));
       }
     }
-    error_ = (num_count < 100) ? -1 : max_count / num_count;
-    if (is_complex_) {
-      error_imag_ =
-          (num_count_imag < 100) ? -1 : max_count_imag / num_count_imag;
-    }
-  }
-
-  template <typename T>
-  void computeDiffKl() {
-    T *base_array = reinterpret_cast<T *>(base_array_);
-    T *mlu_array = reinterpret_cast<T *>(mlu_array_);
-    // diff_kl needs count_total_ <= INT64_MAX because of the length in python
-    // func is int64 diff_kl skips the data with too less quantity
-    if (count_total_ < (size_t)1000 || count_total_ > (size_t)INT64_MAX) {
-      error_ = -1;
-    } else {
-      error_ = diff_kl(base_array, mlu_array, count_total_);
-    }
-  }
-
-  template <typename T>
-  void check_nan_inf() {
-    skip_compute_diff_ = false;
-    // if diff is LEVEL 1, return. Else only compute where is nan/inf.
-    dealNanInf<T>();
-    if (skip_compute_diff_) {
-      setErrorWrap();
+    for (int part = 0; need_diff4_ && part < stride_; ++part) {
+      diff4_sets[part].finish();
     }
   }
 
+  // Evaluate all criterions with a single sweep over the baseline and mlu
+  // arrays: nan/inf check and every formula are computed chunk by chunk while
+  // the chunk is in cache, chunks are spread over host threads.
+  // The chunk size is fixed and partial results are merged pairwise in chunk
+  // order, so the errors don't depend on the number of threads.
   template <typename T>
-  void nanInfRemain() {
-    T *base_array = reinterpret_cast<T *>(base_array_);
-    T *mlu_array = reinterpret_cast<T *>(mlu_array_);
-    if (hasNanOrInf(base_array, count_total_) ||
-        hasNanOrInf(mlu_array, count_total_)) {
-      LOG(ERROR)
-          << "Found NaN or Inf when compute diff, return DBL_MAX instead.";
-      skip_compute_diff_ = true;
-      nan_inf_pass_ = false;
+  void computeDiffFused() {
+    const T *base_array = reinterpret_cast<const T *>(base_array_);
+    const T *mlu_array = reinterpret_cast<const T *>(mlu_array_);
+    size_t chunk_num = (count_total_ + kDiffChunkSize - 1) / kDiffChunkSize;
+    std::vector<DiffSums> sums(chunk_num);
+    // (mlu, baseline) pairs which are not equal, for real and imag.
+    std::vector<Diff4PairSet> diff4_sets(need_diff4_ ? chunk_num * 2 : 0);
+    parallelForChunks(
+        count_total_, kDiffChunkSize,
+        [&](size_t id, size_t begin, size_t end) {
+          computeDiffChunk(base_array, mlu_array, begin, end, &sums[id],
+                           need_diff4_ ? &diff4_sets[id * 2] : nullptr);
+        });
+
+    size_t diff4_num[2] = {0, 0};
+    size_t diff4_less[2] = {0, 0};
+    for (int part = 0; need_diff4_ && part < stride_; ++part) {
+      Diff4PairSet pairs;
+      for (size_t id = 0; id < chunk_num; ++id) {
+        pairs.merge(diff4_sets[id * 2 + part]);
+        diff4_sets[id * 2 + part] = Diff4PairSet();
+      }
+      diff4_num[part] = pairs.size();
+      diff4_less[part] = pairs.lessCount();
     }
+    setFusedErrorWrap(mergeDiffSums(sums, 0, chunk_num), diff4_num,
+                      diff4_less);
   }
-
   void init(void *baseline_result, void *mlu_result, const size_t count,
             const std::set<Criterion> criterions, const std::string &name,
             const mluOpDataType_t dtype);
 
-  void computeDiffForOneCriterion();
   void computeDiffFloatAndDouble();
   void computeDiffByDtype();
   void thresholdLevel1();
   void setErrorWrap();
-  void checkNanInfFloatAndDouble();
-  void checkNanInfByDtype();
+  bool resetNanInfAsZero(double base, double mlu, size_t pos, DiffSums *sums);
+  void setFusedErrorWrap(const DiffSums &sums, const size_t *diff4_num,
+                         const size_t *diff4_less);
   inline std::string showFormula(Formula f);
 
-  std::function<void(Evaluator *)> checkNanInfFunc = nullptr;
   std::function<void(Evaluator *)> computeDiffFunc = nullptr;
 
   inline void selectFuncPtr() {
     if (VOID == storage_dtype_) {
-      checkNanInfFunc = &Evaluator::checkNanInfByDtype;
       computeDiffFunc = &Evaluator::computeDiffByDtype;
     } else if (FLOAT == storage_dtype_) {
-      checkNanInfFunc = &Evaluator::checkNanInfFloatAndDouble;
       computeDiffFunc = &Evaluator::computeDiffFloatAndDouble;
     }
   }
 
+  // elements per chunk of the fused evaluation, multiple of 8 for the SIMD
+  // kernels; a float chunk of baseline and mlu fits in L2.
+  static const size_t kDiffChunkSize = 32768;
+
   void *base_array_ = nullptr;
   void *mlu_array_ = nullptr;
   mluOpDataType_t dtype_;
@@ -684,26 +386,22 @@ class Evaluator {
   size_t count_ = -1;
   // count with complex
   size_t count_total_ = -1;
-  double error_ = -1;
-  double error_imag_ = -1;
-  bool skip_compute_diff_ = false;
   bool is_complex_ = false;
   bool threshold_l1_ = false;
+  bool loose_check_nan_inf_ = false;
   bool nan_inf_pass_ = false;
   bool criterion_matching_ = true;
-  Criterion cur_criterion_;
+  // which formulas criterions_ needs, and the DIFF3 epsilon of dtype_
+  bool need_diff3_ = false;
+  bool need_diff4_ = false;
+  bool need_kl_ = false;
+  double diff3_eps_ = 0;
   StorageDtype storage_dtype_ = FLOAT;
-  Formula func_;
   std::string name_ = "";
   std::set<Criterion> criterions_;
   std::vector<Criterion>
       criterion_vec_;  // vector of (diff1+thresdhold) /(diff2 + threshold)
   std::vector<ErrorWrap> error_vec_;  // vetor output's error
-  // record the position where nan/inf output is wrong
-  std::vector<size_t> nan_inf_wrong_pos_;
-  // used for LOOSE_CHECK_NAN_INF mode, record the position where one is inf the
-  // other is nan
-  std::vector<size_t> nan_inf_neq_pos_;
 
   double workspace_size_ = -1;  // for -1
 };
@@ -187,7 +187,7 @@ struct ExecuteContext {
     hw_notifier_layer = std::make_shared<HardwareTimeNotifier>();
   }
   // reserve for memory pool
-  std::shared_ptr<CPUMemoryPool> cmp = nullptr;
+  std::shared_ptr<CPUMemoryPool> cmp = std::make_shared<CPUMemoryPool>();
   std::shared_ptr<MLUMemoryPool> mmp = std::make_shared<MLUMemoryPool>();
   void destroy() {
     hw_notifier->destroy();
@@ -369,6 +369,20 @@ class Executor {
   bool ready();
   void sync();
   EvaluateResult teardown();
+
+  // Stage-wise entry points,
+  // setup() == parseCase() + prepareHostData() + setupDevice() and
+  // teardown() == postProcessDevice() + computeBaseline() +
+  //               processMluOutput() + evaluate().
+  // Used by the pipelined scheduler to overlap host and device work of
+  // different cases.
+  void parseCase(std::string file, const std::shared_ptr<ExecuteConfig> ecfg);
+  void prepareHostData();
+  void setupDevice();
+  bool postProcessDevice();
+  void computeBaseline();
+  void processMluOutput();
+  EvaluateResult evaluate();
   inline EvaluateResult *result() { return &eva_res_; }
 
  protected:
@@ -433,6 +447,13 @@ class Executor {
   virtual void workspaceMalloc() {}
   virtual void workspaceFree() {}
   virtual void cpuCompute();
+  // version of cpuCompute, part of the key of cached baselines (see
+  // BaselineCache), bump it when cpuCompute changes its results.
+  // caching is opt-in: the default -1 never caches, override it with a
+  // version >= 0 only if cpuCompute does nothing but filling
+  // cpu_fp32_output_ (e.g. no theory ops counted in members), since it is
+  // skipped on a cache hit.
+  virtual int64_t cpuComputeVersion() { return -1; }
   virtual void compute() = 0;
   virtual void compute_v2() {}
   virtual void compute_v3() {}
@@ -567,6 +588,9 @@ class Executor {
   bool opParamSupportTf32();
   void dumpOutputData();
   void postProcessAfterLaunch();
+  std::string getBaselineCacheKey();
+  std::vector<std::pair<void *, size_t>> getBaselineOutputBuffers();
+  void cpuComputeWithCache();
 
   bool checkBaseline();
   bool checkAccuracyBaseline();
@@ -0,0 +1,68 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_HOST_MATH_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_HOST_MATH_H_
+
+#include <cstddef>
+
+namespace mluoptest {
+
+// Elementwise math for cpu baselines, dst[i] = f(src[i]) for i in [0, num),
+// dst may alias src. T is float or double. Every function is evaluated in
+// double precision, 4 lanes at a time with AVX2 and with the same operations
+// in the scalar tail, so results do not depend on the alignment or on AVX2.
+// The error bounds are in ulp of double before the final rounding; for float
+// data they leave the correctly rounded result except for values within
+// ~2^-28 ulp of a rounding boundary. Special values follow C99 Annex F.
+
+// natural logarithm (fdlibm reduction and polynomial), below 1 ulp.
+template <typename T>
+void hostLog(const T *src, T *dst, size_t num);
+// base 2 and base 10 logarithms, below 2 ulp. Exact for powers of two in
+// base 2.
+template <typename T>
+void hostLog2(const T *src, T *dst, size_t num);
+template <typename T>
+void hostLog10(const T *src, T *dst, size_t num);
+// e^x (fdlibm), below 1 ulp.
+template <typename T>
+void hostExp(const T *src, T *dst, size_t num);
+// correctly rounded.
+template <typename T>
+void hostSqrt(const T *src, T *dst, size_t num);
+// 1 / (1 + e^-x), below 3 ulp.
+template <typename T>
+void hostSigmoid(const T *src, T *dst, size_t num);
+// src^exponent as e^(exponent * ln|src|), relative error below
+// (|exponent * ln|src|| + 2) * 2^-52.
+template <typename T>
+void hostPow(const T *src, double exponent, T *dst, size_t num);
+// log|gamma(x)|. Stirling series with upward recurrence, absolute error
+// below 2^-45 for 0 < x < 10 and relative error below 2^-48 above. x <= 0,
+// inf, nan and the neighbourhoods of the zeros at 1 and 2 go to lgamma_r.
+template <typename T>
+void hostLgamma(const T *src, T *dst, size_t num);
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_HOST_MATH_H_
@@ -0,0 +1,109 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_HOST_TRACE_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_HOST_TRACE_H_
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mluoptest {
+
+// one finished span, name is a string literal, case_path is only set for
+// the spans that cover a whole stage of a case.
+struct TraceEvent {
+  const char *name = nullptr;
+  std::string case_path;
+  int64_t begin_ns = 0;
+  int64_t end_ns = 0;
+};
+
+// Spans of where the gtest spends its time on each thread, enabled by
+// MLUOP_GTEST_TRACE_FILE=<path>.
+// Every thread appends its finished spans to a buffer of its own, so
+// recording takes no lock (only the first span of a thread registers its
+// buffer). dump() merges the buffers once at exit and writes them as Chrome
+// trace JSON, which can be opened by chrome://tracing or ui.perfetto.dev.
+class HostTrace {
+ public:
+  // empty path disables the trace, getInstance() is the one used by cases.
+  explicit HostTrace(const std::string &path);
+  HostTrace(const HostTrace &) = delete;
+  void operator=(const HostTrace &) = delete;
+
+  static HostTrace *getInstance();
+
+  inline bool enabled() const { return !path_.empty(); }
+
+  // nanoseconds since the trace was created.
+  int64_t now() const;
+  void record(TraceEvent &&event);
+
+  // write events of all threads to path, only the first call writes.
+  // no span should be recording while dumping.
+  void dump();
+
+  // all events recorded so far, threads one after another.
+  std::vector<std::pair<int, TraceEvent>> mergeEvents() const;
+
+ private:
+  struct ThreadBuffer {
+    int tid = 0;
+    std::vector<TraceEvent> events;
+  };
+  ThreadBuffer *localBuffer();
+
+  std::string path_;
+  uint64_t trace_id_ = 0;  // tells thread_local buffers of traces apart
+  std::chrono::steady_clock::time_point start_;
+  mutable std::mutex mtx_;  // guard buffers_ and dumped_
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+  bool dumped_ = false;
+};
+
+// Records the time from construction to destruction as a span of the
+// calling thread, does nothing if the trace is disabled.
+class TraceSpan {
+ public:
+  explicit TraceSpan(const char *name, HostTrace *trace = nullptr);
+  // case_path must outlive the span.
+  TraceSpan(const char *name, const std::string &case_path,
+            HostTrace *trace = nullptr);
+  TraceSpan(const TraceSpan &) = delete;
+  void operator=(const TraceSpan &) = delete;
+  ~TraceSpan();
+
+ private:
+  HostTrace *trace_ = nullptr;  // null if disabled
+  const char *name_;
+  const std::string *case_path_ = nullptr;
+  int64_t begin_ns_ = 0;
+};
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_HOST_TRACE_H_
@@ -44,6 +44,10 @@ struct GtestInternal {
   size_t parsed_file_size = 0;
   double parsed_cost_seconds = 0.;
   TimeSeries_t time_costs_ms;  // cumulative time on different time point
+  size_t host_alloc_num = 0;   // times of CPURuntime::allocate
+  size_t host_reused_num = 0;  // allocate served without malloc
+  size_t host_peak_bytes = 0;  // peak bytes of host buffers of the case
+  size_t proc_rss_peak = 0;    // peak RSS of the process so far
 };
 
 struct GtestInternalMsg {
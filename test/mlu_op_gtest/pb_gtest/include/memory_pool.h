@@ -30,6 +30,7 @@
 #include <vector>
 #include <list>
 #include <utility>
+#include <unordered_map>
 #include <unordered_set>
 #include <mutex>               //NOLINT
 #include <condition_variable>  //NOLINT
@@ -135,13 +136,32 @@ class MemoryPool {
   std::list<MemoryPool::Chunk>::iterator getOnlyOneBigChunk() const;
 };
 
+// Host memory cache shared by the cases run on one execute context.
+// Blocks are rounded up to a size class (4 classes per power of 2) and kept
+// in per-class free lists when deallocated, so that the next case of the same
+// op gets its inputs/baselines/scratch without going through malloc.
+// Total cached bytes of all pools are limited by MLUOP_GTEST_HOST_CACHE_MB.
 class CPUMemoryPool : public MemoryPool {
  public:
   ~CPUMemoryPool() { destroy(); }
   void *allocate(size_t num_bytes, const std::string &name = "");
   void deallocate(void *ptr);
   void destroy();
-  void clear() {}  // free all obj of 1 thread.
+  void clear();  // free cached blocks.
+
+  static size_t sizeClass(size_t num_bytes);
+  size_t getReusedNum() const { return reused_num_; }
+  size_t getMallocNum() const { return malloc_num_; }
+
+ private:
+  std::mutex mtx_;
+  // live blocks, ptr -> size class
+  std::unordered_map<void *, size_t> live_blocks_;
+  // free blocks, size class -> ptrs
+  std::unordered_map<size_t, std::vector<void *>> free_blocks_;
+  size_t cached_bytes_ = 0;
+  size_t reused_num_ = 0;
+  size_t malloc_num_ = 0;
 };
 
 class MLUMemoryPool : public MemoryPool {
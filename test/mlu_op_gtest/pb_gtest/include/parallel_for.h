@@ -0,0 +1,60 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_PARALLEL_FOR_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_PARALLEL_FOR_H_
+
+#include <functional>
+
+namespace mluoptest {
+
+// Number of host threads one case may use for data-parallel loops.
+// MLUOP_GTEST_HOST_THREADS overrides it, otherwise the hardware threads are
+// shared among the --thread case workers.
+size_t getHostParallelism();
+
+// Call func(chunk_id, begin, end) for every chunk
+// [chunk_id * grain, min((chunk_id + 1) * grain, n)) of [0, n).
+// Chunks are claimed dynamically by the calling thread and up to
+// getHostParallelism() - 1 workers of a persistent host thread pool, so func
+// must only depend on its arguments; anything it stores per chunk_id is
+// independent of the thread count. Calls may be nested. The first exception
+// thrown by func is rethrown on the calling thread after all chunks have
+// finished.
+void parallelForChunks(
+    size_t n, size_t grain,
+    const std::function<void(size_t, size_t, size_t)> &func);
+
+// Elementwise loops are bound by memory bandwidth, so they are cut by bytes
+// instead of by work: func(begin, end) is called on chunks of [0, n) that
+// move about kElementwiseChunkBytes, given the bytes read and written per
+// element. A chunk is large enough to amortize its scheduling and small
+// enough to stay in L2 and balance the threads. Chunk bounds are multiples
+// of kElementwiseAlign elements, so threads never write the same cache line.
+constexpr size_t kElementwiseChunkBytes = 1 << 18;
+constexpr size_t kElementwiseAlign = 64;
+void parallelForElements(size_t n, size_t bytes_per_elem,
+                         const std::function<void(size_t, size_t)> &func);
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_PARALLEL_FOR_H_
@@ -0,0 +1,73 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_POINT_GRID_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_POINT_GRID_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace mluoptest {
+
+// Uniform grid over a 3-d point cloud (x, y, z interleaved) for the
+// neighbour searches of point-cloud cpu baselines. Queries return exactly
+// what a scan over all points in index order returns: distances are computed
+// with the same float expressions, and the grid only skips cells that
+// cannot hold a match. Queries are const and may run concurrently.
+class PointGrid {
+ public:
+  // Index the n points of xyz, which must outlive the grid. cell_size <= 0
+  // picks a size giving a few points per cell. Points with a non-finite
+  // coordinate never match a query and are left out of the cells.
+  void build(const float *xyz, int64_t n, double cell_size = 0.0);
+
+  // Indices i, in increasing order, of the first nsample points with
+  // d2 == 0 || (min_radius^2 <= d2 < max_radius^2), where d2 is the float
+  // squared distance between points[i] and query.
+  void radiusQuery(const float *query, float min_radius, float max_radius,
+                   int64_t nsample, std::vector<int32_t> *indices) const;
+
+  // The three points nearest to query, ordered by distance and then by
+  // index. Missing neighbours are reported as distance 1e40 and index 0,
+  // like the sequential insertion the baselines used.
+  void threeNearest(const float *query, double dist[3], int idx[3]) const;
+
+ private:
+  int64_t cellCoord(int axis, double v) const;
+  int64_t cellId(int64_t cx, int64_t cy, int64_t cz) const {
+    return (cz * dims_[1] + cy) * dims_[0] + cx;
+  }
+
+  const float *xyz_ = nullptr;
+  int64_t n_ = 0;
+  double lo_[3] = {0.0, 0.0, 0.0};
+  double cell_size_ = 1.0;
+  double inv_cell_size_ = 1.0;
+  int64_t dims_[3] = {1, 1, 1};
+  std::vector<int64_t> cell_start_;  // points of cell c: [start[c], start[c+1])
+  std::vector<int32_t> cell_index_;  // point indices, increasing in a cell
+  std::vector<float> cell_xyz_;      // coordinates in cell order
+};
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_POINT_GRID_H_
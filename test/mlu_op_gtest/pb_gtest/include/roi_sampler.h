@@ -0,0 +1,91 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_ROI_SAMPLER_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_ROI_SAMPLER_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace mluoptest {
+
+// One bilinear sample of a channel-last feature map: element offsets of the
+// top-left, top-right, bottom-left and bottom-right corners and their
+// weights. Bit i of mask is set when corner i lies in the map; the other
+// corners read as zero and get no gradient. A tap with mask 0 is empty.
+struct BilinearTap {
+  int64_t offset[4];
+  float weight[4];
+  int mask;
+};
+constexpr int kBilinearTapFull = 0xf;
+
+// Sampler of roi_align and friends (mmcv convention): a point outside
+// [-1, height] x [-1, width] is empty, any other point is clamped into the
+// map. pixel_stride is the distance in elements between two neighbouring
+// pixels. For a non-empty tap the ops of the clamp are added to *ops.
+void makeBilinearTap(int height, int width, float y, float x,
+                     int64_t pixel_stride, BilinearTap *tap,
+                     int64_t *ops = nullptr);
+
+// Tap of the pixel square whose top-left corner is (y0, x0), the corner
+// weights being y_weight * x_weight and their complements (roi_crop).
+// Corners outside the map are masked out.
+void makeCornerTap(int height, int width, int y0, int x0, float y_weight,
+                   float x_weight, int64_t pixel_stride, BilinearTap *tap);
+
+// Taps of a rotated RoI laid out as [pooled_h][pooled_w][grid_h][grid_w],
+// sample (iy, ix) of bin (ph, pw) being rotated around the RoI center. The
+// ops of roi_align_rotated's scalar kernel are added to *ops.
+void rotatedRoiTaps(int height, int width, int channels, int pooled_h,
+                    int pooled_w, int grid_h, int grid_w, float roi_start_x,
+                    float roi_start_y, float bin_size_h, float bin_size_w,
+                    float center_x, float center_y, float cos_theta,
+                    float sin_theta, std::vector<BilinearTap> *taps,
+                    int64_t *ops);
+
+// value[c] = w0 * v0[c] + w1 * v1[c] + w2 * v2[c] + w3 * v3[c] for every
+// channel, vi[c] = input[offset[i] + c]; zero for an empty tap.
+void bilinearGather(const BilinearTap &tap, const float *input, int channels,
+                    float *value);
+
+// sum[c] += the same value, an empty tap leaves sum as it is.
+void bilinearAccumulate(const BilinearTap &tap, const float *input,
+                        int channels, float *sum);
+
+// grad_input[offset[i] + c] += grad[c] * wi / count for every corner in the
+// map, one corner after another, so coinciding corners add up in order.
+void bilinearScatter(const BilinearTap &tap, const float *grad, float count,
+                     int channels, float *grad_input);
+
+// Backward scatters run func(image, channel_begin, channel_end) on disjoint
+// slices of a [batch][...][channels] gradient in parallel. A slice is owned
+// by one task that walks the RoIs of its image in their original order, so
+// every element sees the same additions in the same order as a serial loop
+// and the result does not depend on the thread count.
+void roiScatterSlices(int batch, int channels,
+                      const std::function<void(int, int, int)> &func);
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_ROI_SAMPLER_H_
@@ -0,0 +1,109 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_ROTATED_IOU_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_ROTATED_IOU_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace mluoptest {
+
+// Arithmetic of a rotated IoU baseline. box_iou_rotated evaluates the
+// rotation with double cos/sin and divides, nms_rotated uses cosf/sinf and
+// multiplies by reciprocals. Both are kept so the baselines do not change.
+struct RotatedIouFlavor {
+  bool float_trig;
+  bool reciprocal;
+};
+constexpr RotatedIouFlavor kBoxIouRotatedFlavor = {false, false};
+constexpr RotatedIouFlavor kNmsRotatedFlavor = {true, true};
+
+// Rotated boxes [x_ctr, y_ctr, w, h, a, ...] in structure-of-arrays layout,
+// with the rotation terms, areas and bounding circles of every box computed
+// once instead of once per pair.
+class RotatedBoxes {
+ public:
+  RotatedBoxes(const float *boxes, int64_t num, int64_t stride,
+               RotatedIouFlavor flavor);
+  int64_t size() const { return (int64_t)x_.size(); }
+
+ private:
+  friend float rotatedBoxIou(const RotatedBoxes &boxes1, int64_t i,
+                             const RotatedBoxes &boxes2, int64_t j, int mode);
+
+  RotatedIouFlavor flavor_;
+  std::vector<float> x_, y_, w_, h_;
+  std::vector<float> cos_half_, sin_half_;  // cos(a) / 2 and sin(a) / 2
+  std::vector<float> area_;                 // w * h
+  std::vector<double> radius_;              // circumscribed circle
+};
+
+// IoU (mode 0) or IoF (mode 1, over the area of boxes1[i]) of boxes1[i] and
+// boxes2[j]. Pairs whose bounding circles are apart return 0 right away, as
+// clipping them would.
+float rotatedBoxIou(const RotatedBoxes &boxes1, int64_t i,
+                    const RotatedBoxes &boxes2, int64_t j, int mode);
+
+// ious[i * boxes2.size() + j] for all pairs, or ious[i] for the pairs
+// (i, i) when aligned, evaluated in parallel.
+void rotatedBoxIouMatrix(const RotatedBoxes &boxes1,
+                         const RotatedBoxes &boxes2, int mode, bool aligned,
+                         float *ious);
+
+// Quadrilaterals [x0, y0, x1, y1, x2, y2, x3, y3, ...] of poly_nms, with
+// their bounding boxes.
+class QuadPolygons {
+ public:
+  QuadPolygons(const float *polys, int64_t num, int64_t stride);
+  int64_t size() const { return (int64_t)bound_.size() / 4; }
+
+  // true when the bounding boxes of polygons i and j are apart, so the two
+  // polygons cannot overlap.
+  bool apart(int64_t i, int64_t j) const;
+
+ private:
+  friend float quadPolygonIou(const QuadPolygons &polys, int64_t i,
+                              int64_t j);
+
+  std::vector<float> xy_;      // 8 coordinates per polygon
+  std::vector<float> bound_;   // x_min, y_min, x_max, y_max per polygon
+};
+
+// IoU of polygons i and j, clipped as a fan of triangles around the origin.
+// Being a sum of signed triangle overlaps, it is not exactly 0 for polygons
+// that are apart, so callers decide when apart() may replace it.
+float quadPolygonIou(const QuadPolygons &polys, int64_t i, int64_t j);
+
+// Greedy NMS over num boxes already sorted by decreasing score: returns the
+// kept positions in order, position b is dropped when suppress(a, b) holds
+// for a kept a < b. The suppression bits of a block of positions against all
+// later ones are evaluated in parallel, then the block is scanned
+// sequentially, so the result is the same as the sequential loop as long as
+// suppress only depends on its arguments.
+std::vector<int64_t> greedyNmsKeep(
+    int64_t num, const std::function<bool(int64_t, int64_t)> &suppress);
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_ROTATED_IOU_H_
@@ -27,6 +27,7 @@
 #include <iostream>
 #include <algorithm>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 #include <string>
 #include <cstring>
@@ -61,11 +62,20 @@ class Runtime {
   // use cnrtRet_t, cuz when call cnrtFree .. can return directly.
 };
 
+// Host memory of one case.
+// * allocate(num_bytes): small buffers are carved from a per-case bump arena,
+//   big ones come from the size-class cache of CPUMemoryPool (shared by the
+//   cases on the same execute context). Set MLUOP_GTEST_HOST_ARENA=OFF to
+//   malloc each buffer directly, e.g. when running with a memory checker.
+//   Buffers served from the arena or the pool cache are zero-filled, since
+//   they may hold data of an earlier buffer.
+// * blocks are kept in allocation order and indexed by address, so
+//   deallocate is O(1) and destroy() frees what is left in allocation order.
 class CPURuntime : public Runtime {
  public:
   CPURuntime();
   virtual ~CPURuntime();
-  void init(std::shared_ptr<CPUMemoryPool> cmp) {}
+  void init(std::shared_ptr<CPUMemoryPool> cmp) { cmp_ = cmp; }
 
   // allocate(mluOpCreate(), mluOpDestroy());
   // this function will throw exception
@@ -81,7 +91,7 @@ class CPURuntime : public Runtime {
                                   std::to_string(__LINE__));
       return NULL;
     }
-    memory_blocks_.push_back(std::make_shared<MemBlock<T>>(obj, dtor, name));
+    addBlock((void *)obj, std::make_shared<MemBlock<T>>(obj, dtor, name));
     return obj;
   }
 
@@ -92,7 +102,7 @@ class CPURuntime : public Runtime {
   template <typename R>
   R *allocate(R *ptr, std::string name = "") {
     void (*f)(void *) = (operator delete[]);
-    memory_blocks_.push_back(std::make_shared<MemBlock<R *>>(ptr, f, name));
+    addBlock((void *)ptr, std::make_shared<MemBlock<R *>>(ptr, f, name));
     return ptr;
   }
 
@@ -104,27 +114,31 @@ class CPURuntime : public Runtime {
     if (NULL == (void *)object) {
       return cnrtSuccess;
     }
-    auto it = std::find_if(memory_blocks_.begin(), memory_blocks_.end(),
-                           [=](std::shared_ptr<MemBlockBase> b) {
-                             return b->id == (void *)object;
-                           });
-    if (it == memory_blocks_.end()) {
+    auto it = block_index_.find((void *)object);
+    if (it == block_index_.end()) {
       LOG(ERROR) << "CPURuntime: Failed to deallocate " << (void *)object
                  << ", double free.";
       throw std::invalid_argument(std::string(__FILE__) + " +" +
                                   std::to_string(__LINE__));
       return CNRT_RET_ERR_INVALID;
     }
-    it->reset();
-    // XXX(zhaolianshui): since using erase rather frequently, memory_blocks_
-    // should be std::list?
-    memory_blocks_.erase(it);
+    size_t slot = it->second;
+    block_index_.erase(it);
+    removeBlock(slot);
     return cnrtSuccess;
   }
 
   // so only this function can be called in dtor
   cnrtRet_t destroy();
 
+  // host memory statistics of this case.
+  struct Stats {
+    size_t alloc_num = 0;   // times of allocate
+    size_t reused_num = 0;  // allocate served by arena or pool cache
+    size_t peak_bytes = 0;  // peak bytes of buffers allocated by size
+  };
+  inline const Stats &getStats() const { return stats_; }
+
  private:
   struct MemBlockBase {
     MemBlockBase() {}
@@ -165,7 +179,7 @@ class CPURuntime : public Runtime {
     // we have 2 kind of dtor
     // * void (*fp) for buildin type
     // * mluOpStatus (*fp) for customized type
-    // here put different type together in 1 vector
+    // here put different type together in 1 container
     // when deallocate, dtor type is unknown(only known obj type)
     // i don't want a map(or something) to find out dtor type by obj type
     //
@@ -174,12 +188,45 @@ class CPURuntime : public Runtime {
     void (*v_dtor)(void *) = NULL;
     mluOpStatus_t (*c_dtor)(T) = NULL;
     // here can't set object as shared_ptr directly.
-    // cuz we need put all object (different type) in a vector
-    // so declare vector of father struct, but push son struct in it.
+    // cuz we need put all object (different type) in a container
+    // so declare container of father struct, but push son struct in it.
     // by inheritance of struct, call son's dtor
     std::string name;
   };
-  std::vector<std::shared_ptr<MemBlockBase>> memory_blocks_;
+
+  enum BlockKind {
+    BLOCK_OBJECT,  // released by its dtor
+    BLOCK_ARENA,   // carved from arena_chunks_
+    BLOCK_POOL,    // from cmp_
+    BLOCK_SYSTEM,  // from malloc directly
+  };
+  struct BlockEntry {
+    void *ptr = nullptr;  // nullptr once the block is freed
+    BlockKind kind = BLOCK_OBJECT;
+    size_t bytes = 0;
+    std::shared_ptr<MemBlockBase> obj = nullptr;
+  };
+  struct ArenaChunk {
+    char *base = nullptr;
+    size_t used = 0;
+  };
+
+  void addBlock(void *ptr, std::shared_ptr<MemBlockBase> obj);
+  void insertBlock(const BlockEntry &entry);
+  void removeBlock(size_t slot);
+  void *allocateFromArena(size_t num_bytes);
+  void freeBlock(BlockEntry *entry);
+
+  // blocks in allocation order, freed ones stay as holes until compacted.
+  std::vector<BlockEntry> memory_blocks_;
+  // address -> slot in memory_blocks_
+  std::unordered_map<void *, size_t> block_index_;
+  size_t free_slots_ = 0;
+  std::vector<ArenaChunk> arena_chunks_;
+  std::shared_ptr<CPUMemoryPool> cmp_ = nullptr;
+  bool use_arena_ = true;
+  size_t bytes_in_use_ = 0;
+  Stats stats_;
 };
 
 class MLURuntime : public Runtime {
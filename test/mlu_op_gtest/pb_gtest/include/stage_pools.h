@@ -0,0 +1,75 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_STAGE_POOLS_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_STAGE_POOLS_H_
+
+#include <memory>
+#include <utility>
+#include "thread_pool.h"
+
+namespace mluoptest {
+
+// Stages of a case in multi-thread mode, in the order a case goes through
+// them, see TestSuite::ThreadX().
+enum CaseStage {
+  STAGE_PARSE = 0,  // parse the case and create tensors
+  STAGE_PREPARE,    // host malloc, generate and cast input data
+  STAGE_DEVICE,     // device malloc, copy in, launch, sync, copy out
+  STAGE_BASELINE,   // cpu compute (or read in) the baseline output
+  STAGE_COMPARE,    // cast the mlu output and compute the diff
+  STAGE_REPORT,     // free the case and record its result
+  STAGE_NUM,
+};
+
+// One worker pool per stage, so a run is bound by its slowest stage instead
+// of by the sum of them. The pool of a stage has MLUOP_GTEST_<STAGE>_THREADS
+// workers (e.g. MLUOP_GTEST_BASELINE_THREADS). If it is not set, the device
+// stage has thread_num (--thread) workers but at most device_limit, more of
+// them would only wait for the same queues. The four host stages from parse
+// to compare share thread_num workers, each gets a quarter of them, and the
+// report stage has one worker.
+class StagePools {
+ public:
+  StagePools(size_t thread_num, size_t device_limit);
+  // joins the pools in stage order, so tasks may still enqueue later stages.
+  ~StagePools();
+
+  template <typename F, typename... Args>
+  void enqueue(CaseStage stage, F &&f, Args &&... args) {
+    pools_[stage]->enqueue(std::forward<F>(f), std::forward<Args>(args)...);
+  }
+
+  size_t size(CaseStage stage) const { return pools_[stage]->size(); }
+
+  // "PARSE", "PREPARE", ... as in the name of its env.
+  static const char *name(CaseStage stage);
+  static size_t getStageThreads(CaseStage stage, size_t thread_num,
+                                size_t device_limit);
+
+ private:
+  std::unique_ptr<ThreadPool> pools_[STAGE_NUM];
+};
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_STAGE_POOLS_H_
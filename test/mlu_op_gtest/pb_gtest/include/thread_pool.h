@@ -28,9 +28,12 @@
 #include <future>              // NOLINT
 #include <thread>              // NOLINT
 #include <utility>             // NOLINT
+#include <cstddef>
+#include <deque>
 #include <functional>
-#include <queue>
 #include <memory>
+#include <new>
+#include <type_traits>
 #include <vector>
 #include <iostream>
 #include <atomic>
@@ -38,32 +41,147 @@
 
 namespace mluoptest {
 
+// Move-only void() callable. Closures up to kInlineSize bytes are stored
+// inline, so most tasks don't allocate.
+class ThreadTask {
+ public:
+  ThreadTask() = default;
+  template <typename F,
+            typename = typename std::enable_if<!std::is_same<
+                typename std::decay<F>::type, ThreadTask>::value>::type>
+  explicit ThreadTask(F &&f) {
+    using Func = typename std::decay<F>::type;
+    if (sizeof(Func) <= kInlineSize && alignof(Func) <= alignof(Storage) &&
+        std::is_nothrow_move_constructible<Func>::value) {
+      new (&storage_) Func(std::forward<F>(f));
+      ops_ = &InlineOps<Func>::ops;
+    } else {
+      new (&storage_) Func *(new Func(std::forward<F>(f)));
+      ops_ = &HeapOps<Func>::ops;
+    }
+  }
+  ThreadTask(ThreadTask &&other) noexcept { moveFrom(&other); }
+  ThreadTask &operator=(ThreadTask &&other) noexcept {
+    if (this != &other) {
+      reset();
+      moveFrom(&other);
+    }
+    return *this;
+  }
+  ThreadTask(const ThreadTask &) = delete;
+  ThreadTask &operator=(const ThreadTask &) = delete;
+  ~ThreadTask() { reset(); }
+
+  void operator()() { ops_->call(&storage_); }
+  explicit operator bool() const { return ops_ != nullptr; }
+
+ private:
+  static constexpr size_t kInlineSize = 112;
+  using Storage = typename std::aligned_storage<
+      kInlineSize, alignof(std::max_align_t)>::type;
+  struct Ops {
+    void (*call)(void *);
+    void (*move)(void *dst, void *src);  // move src to dst, destroy src
+    void (*destroy)(void *);
+  };
+  template <typename Func>
+  struct InlineOps {
+    static void call(void *p) { (*static_cast<Func *>(p))(); }
+    static void move(void *dst, void *src) {
+      new (dst) Func(std::move(*static_cast<Func *>(src)));
+      static_cast<Func *>(src)->~Func();
+    }
+    static void destroy(void *p) { static_cast<Func *>(p)->~Func(); }
+    static const Ops ops;
+  };
+  template <typename Func>
+  struct HeapOps {
+    static Func *&get(void *p) { return *static_cast<Func **>(p); }
+    static void call(void *p) { (*get(p))(); }
+    static void move(void *dst, void *src) { new (dst) Func *(get(src)); }
+    static void destroy(void *p) { delete get(p); }
+    static const Ops ops;
+  };
+
+  void moveFrom(ThreadTask *other) {
+    ops_ = other->ops_;
+    if (ops_ != nullptr) {
+      ops_->move(&storage_, &other->storage_);
+      other->ops_ = nullptr;
+    }
+  }
+  void reset() {
+    if (ops_ != nullptr) {
+      ops_->destroy(&storage_);
+      ops_ = nullptr;
+    }
+  }
+
+  const Ops *ops_ = nullptr;
+  Storage storage_;
+};
+
+template <typename Func>
+const ThreadTask::Ops ThreadTask::InlineOps<Func>::ops = {
+    &InlineOps<Func>::call, &InlineOps<Func>::move, &InlineOps<Func>::destroy};
+template <typename Func>
+const ThreadTask::Ops ThreadTask::HeapOps<Func>::ops = {
+    &HeapOps<Func>::call, &HeapOps<Func>::move, &HeapOps<Func>::destroy};
+
+// Work-stealing thread pool.
+// Every worker owns a deque: tasks submitted by a worker go to its own deque
+// and are popped LIFO, tasks from other threads are spread round-robin, and
+// idle workers steal FIFO from the others. Only one sleeping worker is woken
+// per task, and none if all workers are busy.
 class ThreadPool {
  public:
   ThreadPool() = default;
   ThreadPool(ThreadPool &&) = default;
   explicit ThreadPool(size_t thread_num);
+  // waits until all submitted tasks are done.
   ~ThreadPool();
 
+  // run f(args...) on a worker, its result and exception are dropped.
   template <typename F, typename... Args>
   void enqueue(F &&f, Args &&... args) {
-    auto task = std::make_shared<std::packaged_task<void()>>(
+    push(ThreadTask(
+        std::bind(std::forward<F>(f), std::forward<Args>(args)...)));
+  }
+
+  // run f(args...) on a worker, the future gets its result or exception.
+  template <typename F, typename... Args>
+  auto submit(F &&f, Args &&... args)
+      -> std::future<typename std::result_of<F(Args...)>::type> {
+    using Ret = typename std::result_of<F(Args...)>::type;
+    std::packaged_task<Ret()> task(
         std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-    {
-      std::lock_guard<std::mutex> lk(ctx_->mtx);
-      ctx_->tasks.emplace([task]() { (*task)(); });
-    }
-    ctx_->cond.notify_all();
+    auto res = task.get_future();
+    push(ThreadTask(std::move(task)));
+    return res;
   }
 
+  size_t size() const { return ctx_ == nullptr ? 0 : ctx_->workers.size(); }
+
  private:
-  struct Context {
+  struct Worker {
     std::mutex mtx;
+    std::deque<ThreadTask> tasks;
+  };
+  struct Context {
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> pending{0};   // tasks in all deques
+    std::atomic<size_t> idle_num{0};  // workers waiting on cond
+    std::atomic<size_t> next{0};      // round-robin for external submit
+    std::mutex idle_mtx;
     std::condition_variable cond;
     bool is_shutdown = false;
-    std::queue<std::function<void()>> tasks;
-    std::vector<std::thread> workers;
   };
+
+  void push(ThreadTask &&task);
+  static void work(Context *ctx, size_t id);
+  static bool pop(Context *ctx, size_t id, ThreadTask *task);
+
   std::shared_ptr<Context> ctx_ = nullptr;
 };
 
@@ -44,6 +44,10 @@ class GlobalVar {
   std::string cases_list_ = "";
   std::string case_path_ = "";
   std::string get_vmpeak_ = "";
+  std::string cases_include_ = "";  // globs of cases to run, split by ','
+  std::string cases_exclude_ = "";  // globs of cases to skip, split by ','
+  int cases_shard_index_ = 0;       // run the cases of this shard only
+  int cases_shard_count_ = 1;
   TestSummary summary_;
   TestInternalInfo internal_info_;
 
@@ -53,6 +57,8 @@ class GlobalVar {
   int repeat_ = 1;   // perf-repeat repeat * kernel enqueue cnrtQueue_t, and get
                      // ave hw_time
   int thread_num_ = 1;    // thread num
+  int process_num_ = 1;   // worker processes, > 1 runs the coordinator
+  int case_timeout_ = 0;  // seconds a worker may spend on one case, 0: none
   bool shuffle_ = false;  // shuffle cases.
   unsigned int half2float_algo_ = getEnvInt(
       "MLUOP_GTEST_EXPERIMENT_HALF2FLOAT_ALGO",
@@ -0,0 +1,69 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_VOXEL_SEGMENTS_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_VOXEL_SEGMENTS_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace mluoptest {
+
+// Stable LSD radix sort of order by keys, 8 bits per pass. Only the low
+// key_bits bits of the keys are looked at. Both vectors are permuted
+// together, and points with equal keys keep their relative order.
+void radixSortByKey(int key_bits, std::vector<uint64_t> *keys,
+                    std::vector<int32_t> *order);
+
+// Points grouped into segments of equal voxel, for the scatter baselines of
+// dynamic_point_to_voxel. Points of a segment are listed in increasing
+// index, so a reduction walking a segment sees them in the same order as a
+// loop over all points would.
+class VoxelSegments {
+ public:
+  // Segments of equal coordinate rows (coors is num_points x num_coors,
+  // values are integers stored as float), ordered lexicographically by
+  // coordinates, as a std::sort of the rows would order them.
+  void buildFromCoors(const float *coors, int64_t num_points, int num_coors);
+
+  // One segment per voxel id in [0, num_voxels), empty ones included.
+  // Points whose id is out of that range are left out.
+  void buildFromVoxelIds(const float *voxel_ids, int64_t num_points,
+                         int64_t num_voxels);
+
+  int64_t segmentNum() const { return (int64_t)offsets_.size() - 1; }
+  int64_t segmentSize(int64_t s) const {
+    return offsets_[s + 1] - offsets_[s];
+  }
+  // points of segment s are points()[begin(s)] .. points()[end(s) - 1].
+  int64_t begin(int64_t s) const { return offsets_[s]; }
+  int64_t end(int64_t s) const { return offsets_[s + 1]; }
+  const int32_t *points() const { return points_.data(); }
+
+ private:
+  std::vector<int32_t> points_;
+  std::vector<int64_t> offsets_ = {0};
+};
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_VOXEL_SEGMENTS_H_
@@ -0,0 +1,55 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_INCLUDE_WAVEFRONT_H_
+#define TEST_MLU_OP_GTEST_INCLUDE_WAVEFRONT_H_
+
+#include <functional>
+#include <vector>
+
+namespace mluoptest {
+
+// Inclusive cell range [s_begin, s_end] x [t_begin, t_end] of batch b.
+struct WavefrontBox {
+  int b;
+  int s_begin, s_end;
+  int t_begin, t_end;
+};
+
+// Tiles the wavefront is cut into, wide along the contiguous t axis.
+constexpr int kWavefrontTileRows = 64;
+constexpr int kWavefrontTileCols = 256;
+
+// Runs a 2-d dynamic programming table where cell (s, t) depends on
+// (s - 1, t) and (s, t - 1), or on (s + 1, t) and (s, t + 1) when reverse
+// is set. Every box is cut into tiles, and func is called once per tile
+// with the tile's own box. Tiles on the same anti-diagonal of tiles, of
+// every batch, run in parallel; a tile starts only after its upstream
+// neighbours are done. Inside a tile func visits cells in row-major order
+// (reversed for reverse), so each cell sees final neighbour values and the
+// table is the same as a serial fill.
+void wavefrontForTiles(const std::vector<WavefrontBox> &boxes, bool reverse,
+                       const std::function<void(const WavefrontBox &)> &func);
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_INCLUDE_WAVEFRONT_H_
@@ -0,0 +1,303 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <thread>  // NOLINT
+#include <tuple>
+
+#include "baseline_cache.h"
+#include "core/logging.h"
+#include "tools.h"
+
+namespace mluoptest {
+
+namespace {
+const uint64_t kPrime1 = 0x9e3779b185ebca87ULL;
+const uint64_t kPrime2 = 0xc2b2ae3d27d4eb4fULL;
+const uint64_t kPrime3 = 0x165667b19e3779f9ULL;
+const uint64_t kPrime4 = 0x85ebca77c2b2ae63ULL;
+const uint64_t kPrime5 = 0x27d4eb2f165667c5ULL;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t readU64(const unsigned char *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint64_t round64(uint64_t acc, uint64_t input) {
+  return rotl(acc + input * kPrime2, 31) * kPrime1;
+}
+
+inline uint64_t avalanche(uint64_t h) {
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime3;
+  h ^= h >> 32;
+  return h;
+}
+
+// xxhash64-like: 4 lanes over 32-byte stripes, two outputs from the lanes.
+void hashBuffer(const void *data, size_t bytes, uint64_t seed, uint64_t *out0,
+                uint64_t *out1) {
+  const unsigned char *p = (const unsigned char *)data;
+  const unsigned char *end = p + bytes;
+  uint64_t v1 = seed + kPrime1 + kPrime2;
+  uint64_t v2 = seed + kPrime2;
+  uint64_t v3 = seed;
+  uint64_t v4 = seed - kPrime1;
+  for (; p + 32 <= end; p += 32) {
+    v1 = round64(v1, readU64(p));
+    v2 = round64(v2, readU64(p + 8));
+    v3 = round64(v3, readU64(p + 16));
+    v4 = round64(v4, readU64(p + 24));
+  }
+  uint64_t tail = kPrime5;
+  for (; p + 8 <= end; p += 8) {
+    tail = rotl(tail ^ round64(0, readU64(p)), 27) * kPrime1 + kPrime4;
+  }
+  for (; p < end; ++p) {
+    tail = rotl(tail ^ (*p * kPrime5), 11) * kPrime1;
+  }
+  uint64_t h0 = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+  uint64_t h1 = rotl(v4, 1) + rotl(v3, 7) + rotl(v2, 12) + rotl(v1, 18);
+  *out0 = avalanche(h0 ^ tail ^ (bytes * kPrime3));
+  *out1 = avalanche(h1 + tail * kPrime4 + bytes);
+}
+
+// entry file: header, output sizes, then each output aligned to 64 bytes.
+const char kMagic[8] = {'M', 'L', 'U', 'B', 'A', 'S', 'E', '1'};
+const size_t kDataAlign = 64;
+
+size_t alignUp(size_t n) {
+  return (n + kDataAlign - 1) / kDataAlign * kDataAlign;
+}
+
+size_t headerBytes(size_t output_num) {
+  return alignUp(sizeof(kMagic) + sizeof(uint64_t) * (output_num + 1));
+}
+}  // namespace
+
+void BaselineHasher::update(const void *data, size_t bytes) {
+  uint64_t a, b;
+  hashBuffer(data, bytes, length_, &a, &b);
+  h0_ = avalanche(rotl(h0_, 17) ^ a);
+  h1_ = avalanche(rotl(h1_, 29) + b);
+  length_ += bytes + 1;
+}
+
+std::string BaselineHasher::hexDigest() const {
+  char buf[33];
+  snprintf(buf, sizeof(buf), "%016llx%016llx", (unsigned long long)h0_,
+           (unsigned long long)h1_);
+  return std::string(buf);
+}
+
+BaselineCache *BaselineCache::getInstance() {
+  const char *dir = std::getenv("MLUOP_GTEST_BASELINE_CACHE");
+  static BaselineCache cache(
+      dir == nullptr ? "" : dir,
+      (size_t)std::max(0, getEnvInt("MLUOP_GTEST_BASELINE_CACHE_MB", 10240))
+          << 20);
+  return &cache;
+}
+
+BaselineCache::BaselineCache(const std::string &dir, size_t limit_bytes) {
+  if (dir.empty()) {
+    return;
+  }
+  if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+    LOG(WARNING) << "BaselineCache: failed to create " << dir
+                 << ", baseline cache is disabled.";
+    return;
+  }
+  dir_ = dir;
+  limit_bytes_ = limit_bytes;
+}
+
+std::string BaselineCache::getPath(const std::string &key) const {
+  return dir_ + "/" + key + ".bin";
+}
+
+bool BaselineCache::load(
+    const std::string &key,
+    const std::vector<std::pair<void *, size_t>> &outputs) {
+  std::string path = getPath(key);
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    miss_num_++;
+    return false;
+  }
+  struct stat file_stat;
+  size_t header_bytes = headerBytes(outputs.size());
+  bool ok = fstat(fd, &file_stat) == 0 &&
+            (size_t)file_stat.st_size >= header_bytes;
+  void *addr = MAP_FAILED;
+  if (ok) {
+    addr = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ok = addr != MAP_FAILED;
+  }
+  close(fd);
+  if (ok) {
+    const char *base = (const char *)addr;
+    const uint64_t *sizes = (const uint64_t *)(base + sizeof(kMagic));
+    ok = memcmp(base, kMagic, sizeof(kMagic)) == 0 &&
+         sizes[0] == outputs.size();
+    size_t offset = header_bytes;
+    for (size_t i = 0; ok && i < outputs.size(); ++i) {
+      ok = sizes[i + 1] == outputs[i].second &&
+           offset + outputs[i].second <= (size_t)file_stat.st_size;
+      offset += alignUp(outputs[i].second);
+    }
+    offset = header_bytes;
+    for (size_t i = 0; ok && i < outputs.size(); ++i) {
+      if (outputs[i].second != 0) {
+        memcpy(outputs[i].first, base + offset, outputs[i].second);
+      }
+      offset += alignUp(outputs[i].second);
+    }
+    munmap(addr, file_stat.st_size);
+  }
+  if (!ok) {
+    LOG(WARNING) << "BaselineCache: ignore invalid entry " << path;
+    miss_num_++;
+    return false;
+  }
+  utime(path.c_str(), nullptr);  // mark as recently used
+  hit_num_++;
+  return true;
+}
+
+void BaselineCache::store(
+    const std::string &key,
+    const std::vector<std::pair<void *, size_t>> &outputs) {
+  size_t header_bytes = headerBytes(outputs.size());
+  size_t total_bytes = header_bytes;
+  for (const auto &output : outputs) {
+    total_bytes += alignUp(output.second);
+  }
+  if (total_bytes > limit_bytes_) {
+    return;
+  }
+  evict(total_bytes);
+
+  std::vector<char> header(header_bytes, 0);
+  memcpy(header.data(), kMagic, sizeof(kMagic));
+  uint64_t *sizes = (uint64_t *)(header.data() + sizeof(kMagic));
+  sizes[0] = outputs.size();
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    sizes[i + 1] = outputs[i].second;
+  }
+
+  std::ostringstream tmp;
+  tmp << getPath(key) << ".tmp." << getpid() << "."
+      << std::this_thread::get_id();
+  FILE *fp = fopen(tmp.str().c_str(), "wb");
+  if (fp == nullptr) {
+    LOG(WARNING) << "BaselineCache: failed to open " << tmp.str();
+    return;
+  }
+  const char zeros[kDataAlign] = {0};
+  bool ok = fwrite(header.data(), 1, header_bytes, fp) == header_bytes;
+  for (size_t i = 0; ok && i < outputs.size(); ++i) {
+    size_t bytes = outputs[i].second;
+    size_t pad = alignUp(bytes) - bytes;
+    ok = fwrite(outputs[i].first, 1, bytes, fp) == bytes &&
+         fwrite(zeros, 1, pad, fp) == pad;
+  }
+  ok = (fclose(fp) == 0) && ok;
+  if (!ok || rename(tmp.str().c_str(), getPath(key).c_str()) != 0) {
+    LOG(WARNING) << "BaselineCache: failed to write " << getPath(key);
+    unlink(tmp.str().c_str());
+    return;
+  }
+  store_num_++;
+}
+
+// remove least recently used entries until there is room for bytes_needed.
+void BaselineCache::evict(size_t bytes_needed) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (dir_scanned_ && dir_bytes_ + bytes_needed <= limit_bytes_) {
+    dir_bytes_ += bytes_needed;
+    return;
+  }
+  // first store, or over limit: rescan, other processes may share the dir.
+  std::vector<std::tuple<int64_t, size_t, std::string>> entries;
+  dir_scanned_ = true;
+  dir_bytes_ = 0;
+  DIR *dp = opendir(dir_.c_str());
+  if (dp != nullptr) {
+    struct dirent *dirp = nullptr;
+    while ((dirp = readdir(dp)) != nullptr) {
+      std::string name = dirp->d_name;
+      if (name.size() < 4 || name.compare(name.size() - 4, 4, ".bin") != 0) {
+        continue;
+      }
+      std::string path = dir_ + "/" + name;
+      struct stat file_stat;
+      if (stat(path.c_str(), &file_stat) == 0) {
+        int64_t mtime_ns = (int64_t)file_stat.st_mtim.tv_sec * 1000000000 +
+                           file_stat.st_mtim.tv_nsec;
+        entries.emplace_back(mtime_ns, file_stat.st_size, path);
+        dir_bytes_ += file_stat.st_size;
+      }
+    }
+    closedir(dp);
+  }
+  if (dir_bytes_ + bytes_needed > limit_bytes_) {
+    // drop down to 90% of limit, so that eviction doesn't run every store.
+    size_t target = limit_bytes_ / 10 * 9;
+    std::sort(entries.begin(), entries.end());
+    for (const auto &entry : entries) {
+      if (dir_bytes_ + bytes_needed <= target) {
+        break;
+      }
+      if (unlink(std::get<2>(entry).c_str()) == 0) {
+        dir_bytes_ -= std::get<1>(entry);
+        evict_num_++;
+      }
+    }
+  }
+  dir_bytes_ += bytes_needed;
+}
+
+std::string BaselineCache::getStats() const {
+  std::ostringstream oss;
+  oss << "hit " << hit_num_ << ", miss " << miss_num_ << ", store "
+      << store_num_ << ", evict " << evict_num_;
+  return oss.str();
+}
+
+}  // namespace mluoptest
@@ -0,0 +1,374 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "baseline_index.h"
+#include "core/logging.h"
+
+namespace mluoptest {
+
+namespace {
+const char kMagic[8] = {'M', 'L', 'U', 'B', 'I', 'D', 'X', '1'};
+
+struct IndexHeader {
+  char magic[8];
+  uint64_t xml_size;
+  int64_t xml_mtime;  // ns
+  uint64_t slot_num;  // power of 2
+  uint64_t entry_num;
+  uint64_t error_num;   // doubles after the slots
+  uint64_t name_bytes;  // chars after the errors
+  uint64_t reserved;
+};
+
+struct IndexSlot {
+  uint64_t hash;  // 0 for an empty slot
+  uint32_t name_offset;
+  uint32_t name_len;
+  double hw_time;
+  double workspace_size;
+  uint32_t error_offset;
+  uint32_t error_num;
+  uint32_t has_perf;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(IndexHeader) == 64, "IndexHeader is part of the format");
+static_assert(sizeof(IndexSlot) == 48, "IndexSlot is part of the format");
+
+uint64_t hashName(const char *data, size_t len) {
+  uint64_t hash = 0xcbf29ce484222325ULL;  // fnv-1a
+  for (size_t i = 0; i < len; ++i) {
+    hash = (hash ^ (unsigned char)data[i]) * 0x100000001b3ULL;
+  }
+  return hash == 0 ? 1 : hash;
+}
+
+std::string fileName(const std::string &path) {
+  size_t pos = path.find_last_of('/');
+  return pos == std::string::npos ? path : path.substr(pos + 1);
+}
+
+std::string unescapeXml(const std::string &str) {
+  if (str.find('&') == std::string::npos) {
+    return str;
+  }
+  static const char *kEntities[][2] = {{"&lt;", "<"},   {"&gt;", ">"},
+                                       {"&quot;", "\""}, {"&apos;", "'"},
+                                       {"&amp;", "&"}};
+  std::string res;
+  for (size_t i = 0; i < str.size();) {
+    bool replaced = false;
+    for (const auto &entity : kEntities) {
+      size_t len = strlen(entity[0]);
+      if (str.compare(i, len, entity[0]) == 0) {
+        res += entity[1];
+        i += len;
+        replaced = true;
+        break;
+      }
+    }
+    if (!replaced) {
+      res += str[i++];
+    }
+  }
+  return res;
+}
+
+// <property name="..." value="..." />
+bool parseProperty(const std::string &line, std::string *name,
+                   std::string *value) {
+  size_t begin = line.find("<property name=\"");
+  if (begin == std::string::npos) {
+    return false;
+  }
+  begin += strlen("<property name=\"");
+  size_t end = line.find('"', begin);
+  size_t value_begin = line.find("value=\"", end);
+  if (end == std::string::npos || value_begin == std::string::npos) {
+    return false;
+  }
+  value_begin += strlen("value=\"");
+  size_t value_end = line.find('"', value_begin);
+  if (value_end == std::string::npos) {
+    return false;
+  }
+  *name = line.substr(begin, end - begin);
+  *value = unescapeXml(line.substr(value_begin, value_end - value_begin));
+  return true;
+}
+
+struct Entry {
+  std::string name;
+  bool has_hw_time = false;
+  bool has_workspace = false;
+  double hw_time = 0;
+  double workspace_size = 0;
+  std::vector<double> errors;
+};
+}  // namespace
+
+BaselineIndex *BaselineIndex::getPerfInstance() {
+  static BaselineIndex index;
+  return &index;
+}
+
+BaselineIndex *BaselineIndex::getAccuracyInstance() {
+  static BaselineIndex index;
+  return &index;
+}
+
+BaselineIndex::~BaselineIndex() { reset(); }
+
+void BaselineIndex::reset() {
+  if (map_ != nullptr) {
+    munmap(map_, map_bytes_);
+  }
+  map_ = nullptr;
+  map_bytes_ = 0;
+  image_.clear();
+  data_ = nullptr;
+  slot_num_ = 0;
+  entry_num_ = 0;
+}
+
+std::string BaselineIndex::build(std::istream *xml, uint64_t xml_size,
+                                 int64_t xml_mtime) {
+  // properties of a case start with case_path and end with </properties>, a
+  // case recorded again later replaces the earlier one.
+  std::vector<Entry> entries;
+  std::unordered_map<std::string, size_t> entry_of_name;
+  Entry entry;
+  bool in_case = false;
+  auto flush = [&]() {
+    if (in_case) {
+      auto it = entry_of_name.emplace(entry.name, entries.size());
+      if (it.second) {
+        entries.emplace_back(std::move(entry));
+      } else {
+        entries[it.first->second] = std::move(entry);
+      }
+    }
+    entry = Entry();
+    in_case = false;
+  };
+  std::string line, name, value;
+  while (std::getline(*xml, line)) {
+    if (!parseProperty(line, &name, &value)) {
+      if (line.find("</properties>") != std::string::npos) {
+        flush();
+      }
+      continue;
+    }
+    if (name == "case_path") {
+      flush();
+      entry.name = fileName(value);
+      in_case = true;
+    } else if (!in_case) {
+      continue;
+    } else if (name == "hardware_time_base") {
+      entry.hw_time = atof(value.c_str());
+      entry.has_hw_time = true;
+    } else if (name == "workspace_size_mlu") {
+      entry.workspace_size = atof(value.c_str());
+      entry.has_workspace = true;
+    } else if (name.find("error_diff") != std::string::npos) {
+      entry.errors.push_back(atof(value.c_str()));
+    }
+  }
+  flush();
+
+  IndexHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.xml_size = xml_size;
+  header.xml_mtime = xml_mtime;
+  header.slot_num = 16;
+  while (header.slot_num < entries.size() * 2) {
+    header.slot_num *= 2;  // load factor <= 0.5
+  }
+  header.entry_num = entries.size();
+  std::vector<IndexSlot> slots(header.slot_num);
+  memset(slots.data(), 0, slots.size() * sizeof(IndexSlot));
+  std::vector<double> errors;
+  std::string names;
+  for (const auto &e : entries) {
+    uint64_t hash = hashName(e.name.data(), e.name.size());
+    size_t pos = hash & (header.slot_num - 1);
+    while (slots[pos].hash != 0) {
+      pos = (pos + 1) & (header.slot_num - 1);
+    }
+    IndexSlot &slot = slots[pos];
+    slot.hash = hash;
+    slot.name_offset = names.size();
+    slot.name_len = e.name.size();
+    slot.hw_time = e.hw_time;
+    slot.workspace_size = e.workspace_size;
+    slot.error_offset = errors.size();
+    slot.error_num = e.errors.size();
+    slot.has_perf = e.has_hw_time && e.has_workspace;
+    names += e.name;
+    errors.insert(errors.end(), e.errors.begin(), e.errors.end());
+  }
+  header.error_num = errors.size();
+  header.name_bytes = names.size();
+
+  std::string image((const char *)&header, sizeof(header));
+  image.append((const char *)slots.data(), slots.size() * sizeof(IndexSlot));
+  image.append((const char *)errors.data(), errors.size() * sizeof(double));
+  image += names;
+  return image;
+}
+
+bool BaselineIndex::attach(const char *data, size_t bytes, uint64_t xml_size,
+                           int64_t xml_mtime) {
+  if (bytes < sizeof(IndexHeader)) {
+    return false;
+  }
+  const IndexHeader *header = (const IndexHeader *)data;
+  uint64_t slot_num = header->slot_num;
+  bool ok = memcmp(header->magic, kMagic, sizeof(kMagic)) == 0 &&
+            header->xml_size == xml_size && header->xml_mtime == xml_mtime &&
+            slot_num != 0 && (slot_num & (slot_num - 1)) == 0 &&
+            slot_num <= bytes / sizeof(IndexSlot) &&
+            header->error_num <= bytes / sizeof(double) &&
+            bytes == sizeof(IndexHeader) + slot_num * sizeof(IndexSlot) +
+                         header->error_num * sizeof(double) +
+                         header->name_bytes;
+  if (!ok) {
+    return false;
+  }
+  data_ = data;
+  slot_num_ = slot_num;
+  entry_num_ = header->entry_num;
+  return true;
+}
+
+bool BaselineIndex::mapFile(const std::string &path, uint64_t xml_size,
+                            int64_t xml_mtime) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat file_stat;
+  void *addr = MAP_FAILED;
+  if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+    addr = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return false;
+  }
+  if (!attach((const char *)addr, file_stat.st_size, xml_size, xml_mtime)) {
+    munmap(addr, file_stat.st_size);
+    return false;
+  }
+  map_ = addr;
+  map_bytes_ = file_stat.st_size;
+  return true;
+}
+
+bool BaselineIndex::load(const std::string &xml_file) {
+  reset();
+  struct stat xml_stat;
+  if (stat(xml_file.c_str(), &xml_stat) != 0) {
+    LOG(ERROR) << "BaselineIndex: failed to open " << xml_file << ".";
+    return false;
+  }
+  uint64_t xml_size = xml_stat.st_size;
+  int64_t xml_mtime =
+      (int64_t)xml_stat.st_mtim.tv_sec * 1000000000 + xml_stat.st_mtim.tv_nsec;
+  std::string index_file = xml_file + ".idx";
+  if (mapFile(index_file, xml_size, xml_mtime)) {
+    VLOG(4) << "BaselineIndex: " << entry_num_ << " cases from " << index_file;
+    return true;
+  }
+
+  std::ifstream xml(xml_file);
+  std::string image = build(&xml, xml_size, xml_mtime);
+  // written to a temp name and renamed, as several processes may build it.
+  std::ostringstream tmp;
+  tmp << index_file << ".tmp." << getpid() << "."
+      << std::this_thread::get_id();
+  FILE *fp = fopen(tmp.str().c_str(), "wb");
+  bool written =
+      fp != nullptr &&
+      fwrite(image.data(), 1, image.size(), fp) == image.size();
+  written = (fp == nullptr || fclose(fp) == 0) && written &&
+            rename(tmp.str().c_str(), index_file.c_str()) == 0;
+  if (written && mapFile(index_file, xml_size, xml_mtime)) {
+    LOG(INFO) << "BaselineIndex: built " << index_file << " of " << entry_num_
+              << " cases.";
+    return true;
+  }
+  unlink(tmp.str().c_str());
+  LOG(WARNING) << "BaselineIndex: failed to write " << index_file
+               << ", keep the index of " << xml_file << " in memory.";
+  image_ = std::move(image);
+  return attach(image_.data(), image_.size(), xml_size, xml_mtime);
+}
+
+bool BaselineIndex::find(const std::string &case_name,
+                         BaselineRecord *record) const {
+  if (data_ == nullptr) {
+    return false;
+  }
+  const IndexHeader *header = (const IndexHeader *)data_;
+  const IndexSlot *slots = (const IndexSlot *)(data_ + sizeof(IndexHeader));
+  const double *errors = (const double *)(slots + slot_num_);
+  const char *names = (const char *)(errors + header->error_num);
+  uint64_t hash = hashName(case_name.data(), case_name.size());
+  for (uint64_t pos = hash & (slot_num_ - 1), probe = 0;
+       slots[pos].hash != 0 && probe < slot_num_;
+       pos = (pos + 1) & (slot_num_ - 1), ++probe) {
+    const IndexSlot &slot = slots[pos];
+    if (slot.hash != hash || slot.name_len != case_name.size() ||
+        (uint64_t)slot.name_offset + slot.name_len > header->name_bytes ||
+        (uint64_t)slot.error_offset + slot.error_num > header->error_num ||
+        memcmp(names + slot.name_offset, case_name.data(), slot.name_len) !=
+            0) {
+      continue;
+    }
+    record->has_perf = slot.has_perf != 0;
+    record->hw_time = slot.hw_time;
+    record->workspace_size = slot.workspace_size;
+    record->errors = errors + slot.error_offset;
+    record->error_num = slot.error_num;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace mluoptest
@@ -0,0 +1,150 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "box_grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace mluoptest {
+
+namespace {
+
+// boxes touching more cells than this are tested for every point.
+constexpr int64_t kMaxCellsPerBox = 64;
+constexpr int64_t kMaxCellsPerBoxNum = 4;
+// margin of points_in_boxes plus relative slack for float rounding.
+constexpr double kFootprintMargin = 1e-5;
+constexpr double kFootprintScale = 1.001;
+
+}  // namespace
+
+void BoxGrid::build(const float *boxes, int64_t num, bool float_trig) {
+  boxes_ = boxes;
+  rotation_.resize(num * 2);
+  // footprint [x0, x1] x [y0, y1] of every box, NaN when unbounded.
+  std::vector<double> bound(num * 4);
+  double hi[2];
+  lo_[0] = lo_[1] = std::numeric_limits<double>::max();
+  hi[0] = hi[1] = std::numeric_limits<double>::lowest();
+  double extent_sum = 0.0;
+  int64_t bounded = 0;
+  for (int64_t i = 0; i < num; ++i) {
+    const float *box = boxes + i * 7;
+    const float rz = box[6];
+    float cosa, sina;
+    if (float_trig) {
+      cosa = std::cos(-rz);
+      sina = std::sin(-rz);
+    } else {
+      cosa = (float)std::cos((double)-rz);
+      sina = (float)std::sin((double)-rz);
+    }
+    rotation_[i * 2] = cosa;
+    rotation_[i * 2 + 1] = sina;
+
+    const double half_x = std::fabs((double)box[3]) / 2 + kFootprintMargin;
+    const double half_y = std::fabs((double)box[4]) / 2 + kFootprintMargin;
+    const double ex =
+        (half_x * std::fabs(cosa) + half_y * std::fabs(sina)) * kFootprintScale;
+    const double ey =
+        (half_x * std::fabs(sina) + half_y * std::fabs(cosa)) * kFootprintScale;
+    double *b = bound.data() + i * 4;
+    b[0] = box[0] - ex;
+    b[1] = box[0] + ex;
+    b[2] = box[1] - ey;
+    b[3] = box[1] + ey;
+    if (!(std::isfinite(b[0]) && std::isfinite(b[1]) && std::isfinite(b[2]) &&
+          std::isfinite(b[3]))) {
+      b[0] = std::numeric_limits<double>::quiet_NaN();
+      continue;
+    }
+    lo_[0] = std::min(lo_[0], b[0]);
+    hi[0] = std::max(hi[0], b[1]);
+    lo_[1] = std::min(lo_[1], b[2]);
+    hi[1] = std::max(hi[1], b[3]);
+    extent_sum += std::max(b[1] - b[0], b[3] - b[2]);
+    ++bounded;
+  }
+  if (bounded == 0) {
+    lo_[0] = lo_[1] = hi[0] = hi[1] = 0.0;
+  }
+
+  // cells about the size of an average footprint, capped in number.
+  double cell_size = bounded ? extent_sum / bounded : 1.0;
+  if (!(cell_size > 0.0)) cell_size = 1.0;
+  const double max_cells = (double)(kMaxCellsPerBoxNum * bounded + 64);
+  while ((std::floor((hi[0] - lo_[0]) / cell_size) + 1.0) *
+             (std::floor((hi[1] - lo_[1]) / cell_size) + 1.0) >
+         max_cells) {
+    cell_size *= 1.5;
+  }
+  inv_cell_size_ = 1.0 / cell_size;
+  for (int a = 0; a < 2; ++a) {
+    dims_[a] = (int64_t)std::floor((hi[a] - lo_[a]) / cell_size) + 1;
+  }
+
+  const int64_t num_cells = dims_[0] * dims_[1];
+  cell_start_.assign(num_cells + 1, 0);
+  wide_.clear();
+  std::vector<int64_t> cover(num * 4);
+  for (int64_t i = 0; i < num; ++i) {
+    const double *b = bound.data() + i * 4;
+    int64_t *c = cover.data() + i * 4;
+    if (std::isnan(b[0])) {
+      c[0] = -1;
+      wide_.push_back((int32_t)i);
+      continue;
+    }
+    c[0] = cellCoord(0, b[0]);
+    c[1] = cellCoord(0, b[1]);
+    c[2] = cellCoord(1, b[2]);
+    c[3] = cellCoord(1, b[3]);
+    if ((c[1] - c[0] + 1) * (c[3] - c[2] + 1) > kMaxCellsPerBox) {
+      c[0] = -1;
+      wide_.push_back((int32_t)i);
+      continue;
+    }
+    for (int64_t cy = c[2]; cy <= c[3]; ++cy) {
+      for (int64_t cx = c[0]; cx <= c[1]; ++cx) {
+        ++cell_start_[cy * dims_[0] + cx + 1];
+      }
+    }
+  }
+  for (int64_t c = 0; c < num_cells; ++c) {
+    cell_start_[c + 1] += cell_start_[c];
+  }
+  std::vector<int64_t> fill(cell_start_.begin(), cell_start_.end() - 1);
+  cell_box_.resize(cell_start_[num_cells]);
+  for (int64_t i = 0; i < num; ++i) {
+    const int64_t *c = cover.data() + i * 4;
+    if (c[0] < 0) continue;
+    for (int64_t cy = c[2]; cy <= c[3]; ++cy) {
+      for (int64_t cx = c[0]; cx <= c[1]; ++cx) {
+        cell_box_[fill[cy * dims_[0] + cx]++] = (int32_t)i;
+      }
+    }
+  }
+}
+
+}  // namespace mluoptest
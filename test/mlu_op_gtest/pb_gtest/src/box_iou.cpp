@@ -0,0 +1,93 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "box_iou.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace mluoptest {
+
+void boxIouRange(const BoxIouSoA &boxes, int m, float m_area, bool add_offset,
+                 float offset, int begin, int end, float *iou) {
+  const float *x1 = boxes.x1, *y1 = boxes.y1;
+  const float *x2 = boxes.x2, *y2 = boxes.y2;
+  const float *area = boxes.area;
+  const float max_x1 = x1[m], max_y1 = y1[m];
+  const float max_x2 = x2[m], max_y2 = y2[m];
+  int i = begin;
+#if defined(__AVX2__)
+  const __m256 v_max_x1 = _mm256_set1_ps(max_x1);
+  const __m256 v_max_y1 = _mm256_set1_ps(max_y1);
+  const __m256 v_max_x2 = _mm256_set1_ps(max_x2);
+  const __m256 v_max_y2 = _mm256_set1_ps(max_y2);
+  const __m256 v_max_area = _mm256_set1_ps(m_area);
+  const __m256 v_offset = _mm256_set1_ps(offset);
+  const __m256 v_zero = _mm256_setzero_ps();
+  for (; i + 8 <= end; i += 8) {
+    // max_ps(a, b) is a > b ? a : b, min_ps(a, b) is a < b ? a : b
+    __m256 inter_x1 = _mm256_max_ps(v_max_x1, _mm256_loadu_ps(x1 + i));
+    __m256 inter_y1 = _mm256_max_ps(v_max_y1, _mm256_loadu_ps(y1 + i));
+    __m256 inter_x2 = _mm256_min_ps(_mm256_loadu_ps(x2 + i), v_max_x2);
+    __m256 inter_y2 = _mm256_min_ps(_mm256_loadu_ps(y2 + i), v_max_y2);
+    __m256 inter_w = _mm256_sub_ps(inter_x2, inter_x1);
+    __m256 inter_h = _mm256_sub_ps(inter_y2, inter_y1);
+    if (add_offset) {
+      inter_w = _mm256_add_ps(inter_w, v_offset);
+      inter_h = _mm256_add_ps(inter_h, v_offset);
+    }
+    // inter < 0 ? 0 : inter, nan is kept
+    inter_w = _mm256_andnot_ps(_mm256_cmp_ps(inter_w, v_zero, _CMP_LT_OQ),
+                               inter_w);
+    inter_h = _mm256_andnot_ps(_mm256_cmp_ps(inter_h, v_zero, _CMP_LT_OQ),
+                               inter_h);
+    __m256 area_I = _mm256_mul_ps(inter_w, inter_h);
+    __m256 area_U = _mm256_sub_ps(
+        _mm256_add_ps(v_max_area, _mm256_loadu_ps(area + i)), area_I);
+    _mm256_storeu_ps(iou + i, _mm256_div_ps(area_I, area_U));
+  }
+#endif
+  for (; i < end; ++i) {
+    float inter_x1 = (max_x1 > x1[i] ? max_x1 : x1[i]);
+    float inter_y1 = (max_y1 > y1[i] ? max_y1 : y1[i]);
+    float inter_x2 = (max_x2 > x2[i] ? x2[i] : max_x2);
+    float inter_y2 = (max_y2 > y2[i] ? y2[i] : max_y2);
+    float inter_w = inter_x2 - inter_x1;
+    float inter_h = inter_y2 - inter_y1;
+    if (add_offset) {
+      inter_w = inter_w + offset;
+      inter_h = inter_h + offset;
+    }
+    if (inter_w < 0) {
+      inter_w = 0;
+    }
+    if (inter_h < 0) {
+      inter_h = 0;
+    }
+    float area_I = inter_w * inter_h;
+    float area_U = m_area + area[i] - area_I;
+    iou[i] = area_I / area_U;
+  }
+}
+
+}  // namespace mluoptest
@@ -23,6 +23,7 @@
 #include <string>
 #include <set>
 #include <algorithm>
+#include <memory>
 #include <vector>
 #include "case_collector.h"
 
@@ -32,83 +33,26 @@ using mluoptest::global_var;
 Collector::Collector(const std::string &name) { op_name_ = name; }
 
 size_t Collector::num() {
-  if (global_var.thread_num_ > 1) {
+  // the coordinator only needs the op list, its workers collect the cases.
+  if (global_var.thread_num_ > 1 || global_var.process_num_ > 1) {
     return 1;
   } else {
     return list().size();
   }
 }
 
-void Collector::grep_case(std::string dir, std::vector<std::string> &files) {
-  DIR *dp = opendir(dir.c_str());
-  if (dp == NULL) {  // it's not dir or not exit
-    return;
-  } else {
-    // it is dir, grep all files
-    struct dirent *dirp;
-    while ((dirp = readdir(dp)) != NULL) {
-      if (dirp->d_type == DT_DIR) {
-        std::string sub_dir = std::string(dirp->d_name);
-        if (sub_dir[sub_dir.length() - 1] != '.') {
-          // is dir and not "." or ".."
-          grep_case(dir + "/" + std::string(dirp->d_name), files);
-        } else {
-          // is "." or ".."
-        }
-      } else if (dirp->d_type == DT_REG || dirp->d_type == DT_UNKNOWN) {
-        // is file
-        files.push_back(dir + "/" + std::string(dirp->d_name));
-      }
-      // else maybe . or .. or else file type.
-    }
-    closedir(dp);
-  }
-}
+namespace {
 
-void Collector::grep_dir(std::string dir, std::vector<std::string> &op_dirs) {
-  DIR *dp = opendir(dir.c_str());
-  if (dp == NULL) {  // it's not dir or not exit
-    return;
-  } else {
-    // it is dir, grep all files
-    struct dirent *dirp;
-    while ((dirp = readdir(dp)) != NULL) {
-      if (dirp->d_type == DT_DIR) {
-        std::string sub_dir = std::string(dirp->d_name);
-        if (strcmp(op_name_.c_str(), sub_dir.c_str()) == 0) {
-          op_dirs.push_back(dir + "/" + sub_dir);
-        } else if (sub_dir[sub_dir.length() - 1] != '.') {
-          grep_dir(dir + "/" + sub_dir, op_dirs);
-        } else {
-          // is "." or ".."
-        }
-      }
-    }
-    closedir(dp);
-  }
+mluoptest::CaseFilter caseFilter() {
+  mluoptest::CaseFilter filter;
+  filter.include = mluoptest::splitList(global_var.cases_include_, ',');
+  filter.exclude = mluoptest::splitList(global_var.cases_exclude_, ',');
+  filter.shard_index = global_var.cases_shard_index_;
+  filter.shard_count = global_var.cases_shard_count_;
+  return filter;
 }
 
-std::vector<std::string> Collector::read_case(std::string cases_list) {
-  // /**/add/add_***.pb\r
-  std::vector<std::string> res;
-  std::string op_dir = "/" + op_name_ + "/";
-  std::ifstream fin(cases_list, std::ios::in);
-
-  std::string case_path;
-  while (getline(fin, case_path)) {
-    if (case_path.find(op_dir) != std::string::npos) {
-      if (case_path.back() == '\r' || case_path.back() == '\n') {
-        res.push_back(
-            case_path.substr(0, case_path.length() - 1));  // remove "\r"
-      } else {
-        res.push_back(case_path.substr(0, case_path.length()));
-      }
-    }
-    case_path.clear();
-  }
-  fin.close();
-  return res;
-}
+}  // namespace
 
 std::string Collector::current_dir() {
   char *buffer = NULL;
@@ -135,14 +79,17 @@ std::vector<std::string> Collector::list_by_case_path(std::string path) {
   return {abs_case_path};
 }
 
-std::vector<std::string> Collector::list_by_case_list(std::string list_file) {
+std::shared_ptr<mluoptest::CaseStream> Collector::stream_by_case_list(
+    std::string list_file) {
   if (list_file[0] != '/') {
     // turn to abs
     list_file = current_dir() + list_file;
   }
   assertPath(list_file, caseType::CASE_LIST, __FILE__, __LINE__);
   RETURN_IF_PATH_INVALID();
-  return read_case(list_file);
+  auto cases = std::make_shared<mluoptest::CaseStream>(caseFilter());
+  cases->readList(list_file, op_name_);
+  return cases;
 }
 
 void Collector::assertPath(std::string &case_path, caseType case_type,
@@ -175,45 +122,56 @@ void Collector::assertPath(std::string &case_path, caseType case_type,
   }
 }
 
-std::vector<std::string> Collector::list_by_case_dir(std::string case_dir) {
+std::shared_ptr<mluoptest::CaseStream> Collector::stream_by_case_dir(
+    std::string case_dir) {
   assertPath(case_dir, caseType::CASE_DIR, __FILE__, __LINE__);
   RETURN_IF_PATH_INVALID();
-  std::vector<std::string> res;
-
-  std::string suffix_txt = ".prototxt";
-  std::string suffix_pb = ".pb";
 
   if (case_dir.back() != '/') {
     case_dir += "/";
   }
 
-  // get all the files in dir
-  std::vector<std::string> all_files;
+  // directories are read by several threads, as they mostly wait for the
+  // file system (often a network one) rather than the cpu.
+  size_t thread_num = mluoptest::getEnvInt("MLUOP_GTEST_COLLECT_THREADS", 8);
+  auto cases = std::make_shared<mluoptest::CaseStream>(caseFilter());
   if (true == mluoptest::getEnv("MLUOP_GTEST_CASE_RECURSIVE_SEARCH", false)) {
-    // found env
-    std::vector<std::string> op_dirs;
-    grep_dir(case_dir, op_dirs);
-    for (auto op_dir : op_dirs) {
-      grep_case(op_dir, all_files);
-    }
+    // found env, take cases under any dir named op_name
+    cases->walk({case_dir}, op_name_, thread_num);
   } else {
     // no env
-    grep_case(case_dir + op_name_, all_files);
+    cases->walk({case_dir + op_name_}, "", thread_num);
   }
+  return cases;
+}
 
-  for (auto name : all_files) {
-    if (name.find("invalid") == std::string::npos) {  // no "invalid" in name
-      if (name.substr(name.size() - suffix_pb.size(), suffix_pb.size()) ==
-          suffix_pb) {
-        res.push_back(name);
-      } else if (name.substr(name.size() - suffix_txt.size(),
-                             suffix_txt.size()) == suffix_txt) {
-        res.push_back(name);
-      }
-    }
+std::shared_ptr<mluoptest::CaseStream> Collector::start() {
+  std::shared_ptr<mluoptest::CaseStream> cases = nullptr;
+  if (!global_var.cases_list_.empty()) {
+    // for --case_list
+    cases = stream_by_case_list(global_var.cases_list_);
+  } else if (!global_var.cases_dir_.empty()) {
+    // for --case_dir
+    cases = stream_by_case_dir(global_var.cases_dir_);
+  } else {
+    cases = stream_by_case_dir("../../test/mlu_op_gtest/pb_gtest/src/zoo/");
+  }
+  if (cases == nullptr) {
+    cases = std::make_shared<mluoptest::CaseStream>(mluoptest::CaseFilter());
   }
+  return cases;
+}
 
-  return res;
+std::shared_ptr<mluoptest::CaseStream> Collector::stream() {
+  // --case_path, --rand_n and --gtest_shuffle need the whole list first.
+  if (!global_var.case_path_.empty() || global_var.rand_n_ != -1 ||
+      global_var.shuffle_) {
+    auto cases =
+        std::make_shared<mluoptest::CaseStream>(mluoptest::CaseFilter());
+    cases->pushAll(list());
+    return cases;
+  }
+  return start();
 }
 
 std::vector<std::string> Collector::list() {
@@ -225,16 +183,11 @@ std::vector<std::string> Collector::list() {
     return case_names;
   }
 
-  // for --case_list
-  if (!global_var.cases_list_.empty()) {
-    case_names = list_by_case_list(global_var.cases_list_);
-  } else if (!global_var.cases_dir_.empty()) {
-    // for --case_dir
-    case_names = list_by_case_dir(global_var.cases_dir_);
-  } else {
-    case_names = list_by_case_dir("../../test/mlu_op_gtest/pb_gtest/src/zoo/");
+  case_names = start()->drain();
+  if (global_var.cases_list_.empty()) {
+    // dirs are walked in parallel, sort to keep case ids the same every run.
+    std::sort(case_names.begin(), case_names.end());
   }
-
   auto fisher_shuffle = [](std::vector<std::string> res,
                            int n) -> std::vector<std::string> {
     std::vector<std::string> res_n;
@@ -0,0 +1,274 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <dirent.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "case_stream.h"
+
+namespace mluoptest {
+
+namespace {
+
+bool globMatch(const std::string &glob, const std::string &case_path) {
+  if (glob.find('/') == std::string::npos) {
+    size_t pos = case_path.find_last_of('/');
+    std::string name =
+        (pos == std::string::npos) ? case_path : case_path.substr(pos + 1);
+    return fnmatch(glob.c_str(), name.c_str(), 0) == 0;
+  }
+  return fnmatch(glob.c_str(), case_path.c_str(), 0) == 0;
+}
+
+// fnv-1a, the same in every process, unlike std::hash.
+uint64_t hashPath(const std::string &case_path) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : case_path) {
+    hash = (hash ^ c) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+bool endsWith(const std::string &str, const std::string &suffix) {
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool isCaseFile(const std::string &path) {
+  return path.find("invalid") == std::string::npos &&
+         (endsWith(path, ".pb") || endsWith(path, ".prototxt"));
+}
+
+}  // namespace
+
+bool CaseFilter::accept(const std::string &case_path) const {
+  if (shard_count > 1 &&
+      hashPath(case_path) % shard_count != (uint64_t)shard_index) {
+    return false;
+  }
+  for (const auto &glob : exclude) {
+    if (globMatch(glob, case_path)) {
+      return false;
+    }
+  }
+  if (include.empty()) {
+    return true;
+  }
+  for (const auto &glob : include) {
+    if (globMatch(glob, case_path)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<std::string> splitList(const std::string &str, char delimiter) {
+  std::vector<std::string> items;
+  size_t begin = 0;
+  while (begin <= str.size()) {
+    size_t end = str.find(delimiter, begin);
+    if (end == std::string::npos) {
+      end = str.size();
+    }
+    if (end > begin) {
+      items.emplace_back(str.substr(begin, end - begin));
+    }
+    begin = end + 1;
+  }
+  return items;
+}
+
+CaseStream::CaseStream(const CaseFilter &filter)
+    : filter_(filter), stop_(false) {}
+
+CaseStream::~CaseStream() {
+  {
+    std::lock_guard<std::mutex> lk(dir_mtx_);
+    stop_ = true;
+  }
+  dir_cond_.notify_all();
+  for (auto &t : threads_) {
+    t.join();
+  }
+}
+
+void CaseStream::walk(const std::vector<std::string> &roots,
+                      const std::string &op_name, size_t thread_num) {
+  {
+    std::lock_guard<std::mutex> lk(dir_mtx_);
+    for (auto root : roots) {
+      while (root.size() > 1 && root.back() == '/') {
+        root.pop_back();
+      }
+      dirs_.push_back({root, op_name.empty()});
+      pending_dirs_++;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    running_++;
+  }
+  // the walk is done when the last walker thread returns.
+  thread_num = std::max((size_t)1, thread_num);
+  auto walkers = std::make_shared<std::atomic<size_t>>(thread_num);
+  for (size_t i = 0; i < thread_num; ++i) {
+    threads_.emplace_back([this, op_name, walkers]() {
+      walkDirs(op_name);
+      if (walkers->fetch_sub(1) == 1) {
+        producerDone();
+      }
+    });
+  }
+}
+
+void CaseStream::walkDirs(const std::string &op_name) {
+  for (;;) {
+    DirItem item;
+    {
+      std::unique_lock<std::mutex> lk(dir_mtx_);
+      dir_cond_.wait(lk, [this]() {
+        return !dirs_.empty() || pending_dirs_ == 0 || stop_;
+      });
+      if (dirs_.empty() || stop_) {
+        return;
+      }
+      item = std::move(dirs_.back());
+      dirs_.pop_back();
+    }
+
+    std::vector<DirItem> sub_dirs;
+    DIR *dp = opendir(item.path.c_str());
+    if (dp != NULL) {  // it's dir
+      struct dirent *dirp;
+      while (!stop_ && (dirp = readdir(dp)) != NULL) {
+        std::string name = std::string(dirp->d_name);
+        if (name == "." || name == "..") {
+          continue;
+        }
+        std::string path = item.path + "/" + name;
+        unsigned char type = dirp->d_type;
+        if (type == DT_UNKNOWN) {
+          // d_type is not filled by some (network) file systems.
+          struct stat st;
+          if (stat(path.c_str(), &st) == 0) {
+            type = S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+          }
+        }
+        if (type == DT_DIR) {
+          sub_dirs.push_back({path, item.in_op_dir || name == op_name});
+        } else if (type == DT_REG && item.in_op_dir && isCaseFile(path)) {
+          emit(std::move(path));
+        }
+      }
+      closedir(dp);
+    }
+
+    {
+      std::lock_guard<std::mutex> lk(dir_mtx_);
+      pending_dirs_ = pending_dirs_ + sub_dirs.size() - 1;
+      for (auto &sub_dir : sub_dirs) {
+        dirs_.emplace_back(std::move(sub_dir));
+      }
+    }
+    dir_cond_.notify_all();
+  }
+}
+
+void CaseStream::readList(const std::string &list_file,
+                          const std::string &op_name) {
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    running_++;
+  }
+  threads_.emplace_back([this, list_file, op_name]() {
+    // /**/add/add_***.pb\r
+    std::string op_dir = "/" + op_name + "/";
+    std::ifstream fin(list_file, std::ios::in);
+    std::string case_path;
+    while (!stop_ && getline(fin, case_path)) {
+      if (!case_path.empty() && case_path.back() == '\r') {
+        case_path.pop_back();
+      }
+      if (case_path.find(op_dir) != std::string::npos) {
+        emit(std::move(case_path));
+      }
+      case_path.clear();
+    }
+    producerDone();
+  });
+}
+
+void CaseStream::pushAll(const std::vector<std::string> &case_paths) {
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    cases_.insert(cases_.end(), case_paths.begin(), case_paths.end());
+  }
+  cond_.notify_all();
+}
+
+void CaseStream::emit(std::string case_path) {
+  if (!filter_.accept(case_path)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    cases_.emplace_back(std::move(case_path));
+  }
+  cond_.notify_all();
+}
+
+void CaseStream::producerDone() {
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    running_--;
+  }
+  cond_.notify_all();
+}
+
+bool CaseStream::next(std::string *case_path) {
+  std::unique_lock<std::mutex> lk(mtx_);
+  cond_.wait(lk, [this]() { return !cases_.empty() || running_ == 0; });
+  if (cases_.empty()) {
+    return false;
+  }
+  *case_path = std::move(cases_.front());
+  cases_.pop_front();
+  return true;
+}
+
+std::vector<std::string> CaseStream::drain() {
+  std::unique_lock<std::mutex> lk(mtx_);
+  cond_.wait(lk, [this]() { return running_ == 0; });
+  std::vector<std::string> case_paths(std::make_move_iterator(cases_.begin()),
+                                      std::make_move_iterator(cases_.end()));
+  cases_.clear();
+  return case_paths;
+}
+
+}  // namespace mluoptest
@@ -0,0 +1,131 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "channel_reduce.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "parallel_for.h"
+
+namespace mluoptest {
+
+void welfordMerge(WelfordMoments *a, const WelfordMoments &b) {
+  if (b.count == 0) {
+    return;
+  }
+  if (a->count == 0) {
+    *a = b;
+    return;
+  }
+  const double count = a->count + b.count;
+  const double delta = b.mean - a->mean;
+  a->mean += delta * (b.count / count);
+  a->m2 += b.m2 + delta * delta * (a->count * b.count / count);
+  a->count = count;
+}
+
+void welfordAddRow(const float *row, int channels, WelfordMoments *moments) {
+  if (channels <= 0) {
+    return;
+  }
+  const double count = moments[0].count + 1;
+  const double inv_count = 1.0 / count;
+  for (int c = 0; c < channels; ++c) {
+    WelfordMoments &m = moments[c];
+    const double delta = row[c] - m.mean;
+    m.mean += delta * inv_count;
+    m.m2 += delta * (row[c] - m.mean);
+    m.count = count;
+  }
+}
+
+namespace {
+
+// Runs add_rows on every block into its own slot of width accumulators,
+// then folds slot i + step into slot i for step = 1, 2, 4, ...
+template <typename Acc>
+void reduceRowBlocks(
+    int64_t rows, int width,
+    const std::function<void(int64_t, int64_t, Acc *)> &add_rows,
+    const std::function<void(Acc *, const Acc &)> &merge, Acc *out) {
+  std::fill(out, out + width, Acc());
+  if (rows <= 0 || width <= 0) {
+    return;
+  }
+  const int64_t blocks = std::min<int64_t>(
+      kChannelReduceMaxBlocks,
+      (rows + kChannelReduceMinRows - 1) / kChannelReduceMinRows);
+  const int64_t block_rows = (rows + blocks - 1) / blocks;
+  std::vector<Acc> slots((size_t)blocks * width);
+  parallelForChunks(blocks, 1, [&](size_t, size_t begin, size_t end) {
+    for (size_t b = begin; b < end; ++b) {
+      const int64_t row_begin = b * block_rows;
+      const int64_t row_end = std::min(rows, row_begin + block_rows);
+      if (row_begin < row_end) {
+        add_rows(row_begin, row_end, slots.data() + b * width);
+      }
+    }
+  });
+  for (int64_t step = 1; step < blocks; step *= 2) {
+    for (int64_t b = 0; b + step < blocks; b += 2 * step) {
+      Acc *dst = slots.data() + b * width;
+      const Acc *src = slots.data() + (b + step) * width;
+      for (int c = 0; c < width; ++c) {
+        merge(dst + c, src[c]);
+      }
+    }
+  }
+  std::copy(slots.begin(), slots.begin() + width, out);
+}
+
+}  // namespace
+
+void channelMoments(
+    int64_t rows, int channels,
+    const std::function<void(int64_t, int64_t, WelfordMoments *)> &add_rows,
+    WelfordMoments *moments) {
+  reduceRowBlocks<WelfordMoments>(rows, channels, add_rows, welfordMerge,
+                                  moments);
+}
+
+void channelSums(
+    int64_t rows, int width,
+    const std::function<void(int64_t, int64_t, double *)> &add_rows,
+    double *sums) {
+  reduceRowBlocks<double>(rows, width, add_rows,
+                          [](double *a, const double &b) { *a += b; }, sums);
+}
+
+void channelRows(int64_t rows, int channels,
+                 const std::function<void(int64_t, int64_t)> &func) {
+  if (rows <= 0) {
+    return;
+  }
+  const size_t grain = std::max<int64_t>(
+      1, kChannelRowsChunkElems / std::max(1, channels));
+  parallelForChunks(rows, grain, [&](size_t, size_t begin, size_t end) {
+    func(begin, end);
+  });
+}
+
+}  // namespace mluoptest
@@ -0,0 +1,315 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "cpu_gemm.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <vector>
+
+#include "parallel_for.h"
+
+namespace mluoptest {
+
+namespace {
+// Goto-style blocking: a kc x nc panel of op(B) and a mc x kc panel of op(A)
+// are packed into micro-panels of nr columns / mr rows, then every mr x nr
+// tile of C is updated by a register-blocked micro-kernel.
+constexpr int64_t kKC = kCpuGemmKBlock;
+constexpr int64_t kMC = 144;
+constexpr int64_t kNC = 1024;
+constexpr int64_t kMaxTile = 6 * 32;  // largest mr * nr of the micro-kernels
+
+// c[0:mr, 0:nr] (leading dimension ldc) += pa * pb, where pa is kc x mr
+// and pb is kc x nr, both packed.
+typedef void (*MicroKernel)(int64_t kc, const float *pa, const float *pb,
+                            float *c, int64_t ldc);
+
+struct GemmKernel {
+  const char *name;
+  int64_t mr;
+  int64_t nr;
+  MicroKernel micro;
+};
+
+void microKernelScalar(int64_t kc, const float *pa, const float *pb, float *c,
+                       int64_t ldc) {
+  float acc[4][8] = {{0.0f}};
+  for (int64_t p = 0; p < kc; ++p, pa += 4, pb += 8) {
+    for (int r = 0; r < 4; ++r) {
+      for (int j = 0; j < 8; ++j) {
+        acc[r][j] += pa[r] * pb[j];
+      }
+    }
+  }
+  for (int r = 0; r < 4; ++r) {
+    for (int j = 0; j < 8; ++j) {
+      c[r * ldc + j] += acc[r][j];
+    }
+  }
+}
+
+#if defined(__x86_64__)
+#define MLUOP_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define MLUOP_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+
+// 6 x 16 tile, 12 ymm accumulators.
+MLUOP_TARGET_AVX2 void microKernelAvx2(int64_t kc, const float *pa,
+                                       const float *pb, float *c,
+                                       int64_t ldc) {
+  __m256 acc[6][2];
+#pragma GCC unroll 6
+  for (int r = 0; r < 6; ++r) {
+    acc[r][0] = _mm256_setzero_ps();
+    acc[r][1] = _mm256_setzero_ps();
+  }
+  for (int64_t p = 0; p < kc; ++p, pa += 6, pb += 16) {
+    __m256 b0 = _mm256_loadu_ps(pb);
+    __m256 b1 = _mm256_loadu_ps(pb + 8);
+#pragma GCC unroll 6
+    for (int r = 0; r < 6; ++r) {
+      __m256 a = _mm256_broadcast_ss(pa + r);
+      acc[r][0] = _mm256_fmadd_ps(a, b0, acc[r][0]);
+      acc[r][1] = _mm256_fmadd_ps(a, b1, acc[r][1]);
+    }
+  }
+#pragma GCC unroll 6
+  for (int r = 0; r < 6; ++r) {
+    float *cr = c + r * ldc;
+    _mm256_storeu_ps(cr, _mm256_add_ps(_mm256_loadu_ps(cr), acc[r][0]));
+    _mm256_storeu_ps(cr + 8,
+                     _mm256_add_ps(_mm256_loadu_ps(cr + 8), acc[r][1]));
+  }
+}
+
+// 6 x 32 tile, 12 zmm accumulators.
+MLUOP_TARGET_AVX512 void microKernelAvx512(int64_t kc, const float *pa,
+                                           const float *pb, float *c,
+                                           int64_t ldc) {
+  __m512 acc[6][2];
+#pragma GCC unroll 6
+  for (int r = 0; r < 6; ++r) {
+    acc[r][0] = _mm512_setzero_ps();
+    acc[r][1] = _mm512_setzero_ps();
+  }
+  for (int64_t p = 0; p < kc; ++p, pa += 6, pb += 32) {
+    __m512 b0 = _mm512_loadu_ps(pb);
+    __m512 b1 = _mm512_loadu_ps(pb + 16);
+#pragma GCC unroll 6
+    for (int r = 0; r < 6; ++r) {
+      __m512 a = _mm512_set1_ps(pa[r]);
+      acc[r][0] = _mm512_fmadd_ps(a, b0, acc[r][0]);
+      acc[r][1] = _mm512_fmadd_ps(a, b1, acc[r][1]);
+    }
+  }
+#pragma GCC unroll 6
+  for (int r = 0; r < 6; ++r) {
+    float *cr = c + r * ldc;
+    _mm512_storeu_ps(cr, _mm512_add_ps(_mm512_loadu_ps(cr), acc[r][0]));
+    _mm512_storeu_ps(cr + 16,
+                     _mm512_add_ps(_mm512_loadu_ps(cr + 16), acc[r][1]));
+  }
+}
+
+#undef MLUOP_TARGET_AVX2
+#undef MLUOP_TARGET_AVX512
+#endif  // defined(__x86_64__)
+
+const GemmKernel &getGemmKernel() {
+  static const GemmKernel kernel = []() -> GemmKernel {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+      return {"avx512", 6, 32, microKernelAvx512};
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+      return {"avx2", 6, 16, microKernelAvx2};
+    }
+#endif
+    return {"scalar", 4, 8, microKernelScalar};
+  }();
+  return kernel;
+}
+
+struct GemmArgs {
+  bool trans_a;
+  bool trans_b;
+  int64_t m, n, k;
+  float alpha;
+  int64_t lda, ldb;
+  float beta;
+  int64_t ldc;
+};
+
+// alpha * op(A)[i0:i0+mc, p0:p0+kc] into micro-panels of mr rows, rows past
+// m are zero.
+void packA(const GemmArgs &args, const float *a, int64_t i0, int64_t mc,
+           int64_t p0, int64_t kc, int64_t mr, float *pack) {
+  for (int64_t ir = 0; ir < mc; ir += mr) {
+    int64_t rows = std::min(mr, mc - ir);
+    for (int64_t p = 0; p < kc; ++p, pack += mr) {
+      for (int64_t r = 0; r < rows; ++r) {
+        int64_t i = i0 + ir + r;
+        float v = args.trans_a ? a[(p0 + p) * args.lda + i]
+                               : a[i * args.lda + p0 + p];
+        pack[r] = args.alpha * v;
+      }
+      std::fill(pack + rows, pack + mr, 0.0f);
+    }
+  }
+}
+
+// op(B)[p0:p0+kc, j0:j0+nc] into micro-panels of nr columns, columns past n
+// are zero.
+void packB(const GemmArgs &args, const float *b, int64_t p0, int64_t kc,
+           int64_t j0, int64_t nc, int64_t nr, float *pack) {
+  for (int64_t jr = 0; jr < nc; jr += nr) {
+    int64_t cols = std::min(nr, nc - jr);
+    for (int64_t p = 0; p < kc; ++p, pack += nr) {
+      if (args.trans_b) {
+        const float *src = b + (j0 + jr) * args.ldb + p0 + p;
+        for (int64_t j = 0; j < cols; ++j) {
+          pack[j] = src[j * args.ldb];
+        }
+      } else {
+        const float *src = b + (p0 + p) * args.ldb + j0 + jr;
+        std::copy(src, src + cols, pack);
+      }
+      std::fill(pack + cols, pack + nr, 0.0f);
+    }
+  }
+}
+
+// C[i0:i0+mc, j0:j0+nc] = alpha * op(A) * op(B) + beta * C
+void gemmBlock(const GemmKernel &kernel, const GemmArgs &args, const float *a,
+               const float *b, float *c, int64_t i0, int64_t mc, int64_t j0,
+               int64_t nc) {
+  for (int64_t i = i0; i < i0 + mc; ++i) {
+    float *ci = c + i * args.ldc + j0;
+    if (args.beta == 0.0f) {
+      std::fill(ci, ci + nc, 0.0f);
+    } else if (args.beta != 1.0f) {
+      for (int64_t j = 0; j < nc; ++j) {
+        ci[j] *= args.beta;
+      }
+    }
+  }
+  if (args.alpha == 0.0f) {
+    return;
+  }
+  const int64_t mr = kernel.mr;
+  const int64_t nr = kernel.nr;
+  const int64_t kc_max = std::min(kKC, args.k);
+  // workers of parallelForChunks are short-lived, so are these buffers.
+  thread_local std::vector<float> pack_a, pack_b;
+  pack_a.resize((mc + mr - 1) / mr * mr * kc_max);
+  pack_b.resize((nc + nr - 1) / nr * nr * kc_max);
+  for (int64_t p0 = 0; p0 < args.k; p0 += kKC) {
+    int64_t kc = std::min(kKC, args.k - p0);
+    packB(args, b, p0, kc, j0, nc, nr, pack_b.data());
+    packA(args, a, i0, mc, p0, kc, mr, pack_a.data());
+    for (int64_t jr = 0; jr < nc; jr += nr) {
+      int64_t cols = std::min(nr, nc - jr);
+      const float *pb = pack_b.data() + jr * kc;
+      for (int64_t ir = 0; ir < mc; ir += mr) {
+        int64_t rows = std::min(mr, mc - ir);
+        const float *pa = pack_a.data() + ir * kc;
+        float *ct = c + (i0 + ir) * args.ldc + j0 + jr;
+        if (rows == mr && cols == nr) {
+          kernel.micro(kc, pa, pb, ct, args.ldc);
+          continue;
+        }
+        float tile[kMaxTile] = {0.0f};
+        kernel.micro(kc, pa, pb, tile, nr);
+        for (int64_t r = 0; r < rows; ++r) {
+          for (int64_t j = 0; j < cols; ++j) {
+            ct[r * args.ldc + j] += tile[r * nr + j];
+          }
+        }
+      }
+    }
+  }
+}
+}  // namespace
+
+const char *cpuGemmKernelName() { return getGemmKernel().name; }
+
+void cpuSgemm(bool trans_a, bool trans_b, int64_t m, int64_t n, int64_t k,
+              float alpha, const float *a, int64_t lda, const float *b,
+              int64_t ldb, float beta, float *c, int64_t ldc) {
+  cpuSgemmBatched(trans_a, trans_b, m, n, k, alpha, a, lda, 0, b, ldb, 0,
+                  beta, c, ldc, 0, 1);
+}
+
+void cpuSgemmBatched(bool trans_a, bool trans_b, int64_t m, int64_t n,
+                     int64_t k, float alpha, const float *a, int64_t lda,
+                     int64_t stride_a, const float *b, int64_t ldb,
+                     int64_t stride_b, float beta, float *c, int64_t ldc,
+                     int64_t stride_c, int64_t batch) {
+  if (m <= 0 || n <= 0 || batch <= 0) {
+    return;
+  }
+  const GemmKernel &kernel = getGemmKernel();
+  GemmArgs args = {trans_a, trans_b, m, n, std::max((int64_t)0, k),
+                   alpha,   lda,     ldb, beta, ldc};
+
+  // blocks only decide which thread computes which part of C, not the order
+  // of accumulation, so shrink them until every thread has some blocks.
+  int64_t mc = std::min(kMC, (m + kernel.mr - 1) / kernel.mr * kernel.mr);
+  int64_t nc = std::min(kNC, (n + kernel.nr - 1) / kernel.nr * kernel.nr);
+  const int64_t threads = getHostParallelism();
+  const bool is_small = m * n * std::max((int64_t)1, k) < 64 * 64 * 64;
+  auto block_num = [&]() {
+    return batch * ((m + mc - 1) / mc) * ((n + nc - 1) / nc);
+  };
+  while (!is_small && threads > 1 && block_num() < 4 * threads &&
+         (mc > kernel.mr || nc > kernel.nr)) {
+    if (nc >= mc && nc > kernel.nr) {
+      nc = std::max(kernel.nr, nc / 2 / kernel.nr * kernel.nr);
+    } else {
+      mc = std::max(kernel.mr, mc / 2 / kernel.mr * kernel.mr);
+    }
+  }
+
+  const int64_t m_blocks = (m + mc - 1) / mc;
+  const int64_t n_blocks = (n + nc - 1) / nc;
+  auto func = [&](size_t, size_t begin, size_t end) {
+    for (size_t t = begin; t < end; ++t) {
+      int64_t bi = t / (m_blocks * n_blocks);
+      int64_t i0 = t / n_blocks % m_blocks * mc;
+      int64_t j0 = t % n_blocks * nc;
+      gemmBlock(kernel, args, a + bi * stride_a, b + bi * stride_b,
+                c + bi * stride_c, i0, std::min(mc, m - i0), j0,
+                std::min(nc, n - j0));
+    }
+  };
+  if (is_small) {
+    func(0, 0, block_num());
+  } else {
+    parallelForChunks(block_num(), 1, func);
+  }
+}
+
+}  // namespace mluoptest
@@ -0,0 +1,266 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "cpu_ms_deform_attn.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "parallel_for.h"
+
+namespace mluoptest {
+namespace {
+// (batch, query) rows of a forward chunk hold about this many channel
+// samples.
+constexpr int64_t kMsDeformAttnForwardChunkWork = 1 << 16;
+
+// Backward of one bilinear sample for all channels of a head. Corner
+// offsets and weights are computed once; grad_value is updated one corner at
+// a time over contiguous channels, while the location and weight gradients
+// sum over channels in increasing order like the per-channel kernel did.
+void msDeformAttnCol2imBilinear(
+    const float *bottom_data, const int32_t height, const int32_t width,
+    const int64_t w_stride, const int32_t channels, const float h,
+    const float w, const float *top_grad, const float attn_weight,
+    float *grad_data_value, float *grad_sampling_loc,
+    float *grad_attn_weight) {
+  const int32_t h_low = floorf(h);
+  const int32_t w_low = floorf(w);
+  const int32_t h_high = h_low + 1;
+  const int32_t w_high = w_low + 1;
+
+  const float lh = h - h_low;
+  const float lw = w - w_low;
+  const float hh = 1 - lh, hw = 1 - lw;
+
+  const int64_t h_stride = width * w_stride;
+  const int64_t h_low_ptr_offset = h_low * h_stride;
+  const int64_t h_high_ptr_offset = h_low_ptr_offset + h_stride;
+  const int64_t w_low_ptr_offset = w_low * w_stride;
+  const int64_t w_high_ptr_offset = w_low_ptr_offset + w_stride;
+  const bool valid[4] = {h_low >= 0 && w_low >= 0,
+                         h_low >= 0 && w_high <= width - 1,
+                         h_high <= height - 1 && w_low >= 0,
+                         h_high <= height - 1 && w_high <= width - 1};
+  const int64_t ptr[4] = {h_low_ptr_offset + w_low_ptr_offset,
+                          h_low_ptr_offset + w_high_ptr_offset,
+                          h_high_ptr_offset + w_low_ptr_offset,
+                          h_high_ptr_offset + w_high_ptr_offset};
+  const float w1 = hh * hw, w2 = hh * lw, w3 = lh * hw, w4 = lh * lw;
+  const float corner_weight[4] = {w1, w2, w3, w4};
+
+  for (int k = 0; k < 4; ++k) {
+    if (!valid[k]) {
+      continue;
+    }
+    float *grad = grad_data_value + ptr[k];
+    const float wk = corner_weight[k];
+    for (int32_t c = 0; c < channels; ++c) {
+      grad[c] = grad[c] + wk * (top_grad[c] * attn_weight);
+    }
+  }
+
+  for (int32_t c = 0; c < channels; ++c) {
+    const float top_grad_value = top_grad[c] * attn_weight;
+    float grad_h_weight = 0, grad_w_weight = 0;
+    float v1 = 0;
+    if (valid[0]) {
+      v1 = bottom_data[ptr[0] + c];
+      grad_h_weight -= hw * v1;
+      grad_w_weight -= hh * v1;
+    }
+    float v2 = 0;
+    if (valid[1]) {
+      v2 = bottom_data[ptr[1] + c];
+      grad_h_weight -= lw * v2;
+      grad_w_weight += hh * v2;
+    }
+    float v3 = 0;
+    if (valid[2]) {
+      v3 = bottom_data[ptr[2] + c];
+      grad_h_weight += hw * v3;
+      grad_w_weight -= lh * v3;
+    }
+    float v4 = 0;
+    if (valid[3]) {
+      v4 = bottom_data[ptr[3] + c];
+      grad_h_weight += lw * v4;
+      grad_w_weight += lh * v4;
+    }
+    float val = (w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4);
+    *grad_attn_weight += top_grad[c] * val;
+    *grad_sampling_loc += width * grad_w_weight * top_grad_value;
+    *(grad_sampling_loc + 1) += height * grad_h_weight * top_grad_value;
+  }
+}
+
+}  // namespace
+
+// Each (batch, query) row is independent, rows run in parallel. The corner
+// offsets and weights of a sample point are computed once and applied to
+// all channels of the head in one contiguous loop; corners outside the map
+// read a row of zeros, which is what the scalar kernel added for them.
+void msDeformAttnForwardCpu(
+    const float *data_value,
+    const float *data_spatial_shapes,
+    const float *data_level_start_index,
+    const float *data_sampling_loc,
+    const float *data_attn_weight,
+    const int batch_size,
+    const int num_keys,
+    const int num_heads,
+    const int channels,
+    const int num_levels,
+    const int num_query,
+    const int num_point,
+    float *data_col) {
+  const int64_t qid_stride = num_heads * channels;
+  const int64_t row_work = std::max(
+      (int64_t)1, (int64_t)num_heads * num_levels * num_point * channels);
+  const size_t grain =
+      std::max((int64_t)1, kMsDeformAttnForwardChunkWork / row_work);
+  const std::vector<float> zeros(channels, 0.0f);
+  auto forward_rows = [&](size_t, size_t begin, size_t end) {
+    for (size_t row = begin; row < end; ++row) {
+      const int64_t b_col = row / num_query;
+      const float *data_value_batch =
+          data_value + b_col * num_keys * qid_stride;
+      for (int m_col = 0; m_col < num_heads; ++m_col) {
+        const int64_t sampling_index = row * num_heads + m_col;
+        float *col = data_col + sampling_index * channels;
+        std::fill(col, col + channels, 0.0f);
+        int64_t data_weight_ptr = sampling_index * num_levels * num_point;
+        int64_t data_loc_w_ptr = data_weight_ptr << 1;
+        for (int l_col = 0; l_col < num_levels; ++l_col) {
+          const int level_start_id = data_level_start_index[l_col];
+          const int spatial_h_ptr = l_col << 1;
+          const int spatial_h = data_spatial_shapes[spatial_h_ptr];
+          const int spatial_w = data_spatial_shapes[spatial_h_ptr + 1];
+          const float *data_value_ptr = data_value_batch +
+                                        level_start_id * qid_stride +
+                                        m_col * channels;
+          for (int p_col = 0; p_col < num_point; ++p_col) {
+            const float loc_w = data_sampling_loc[data_loc_w_ptr];
+            const float loc_h = data_sampling_loc[data_loc_w_ptr + 1];
+            const float weight = data_attn_weight[data_weight_ptr];
+            const float h_im = loc_h * spatial_h - 0.5;
+            const float w_im = loc_w * spatial_w - 0.5;
+            data_weight_ptr += 1;
+            data_loc_w_ptr += 2;
+            if (!(h_im > -1 && w_im > -1 && h_im < spatial_h &&
+                  w_im < spatial_w)) {
+              continue;
+            }
+            const int h_low = floorf(h_im);
+            const int w_low = floorf(w_im);
+            const int h_high = h_low + 1;
+            const int w_high = w_low + 1;
+            const float lh = h_im - h_low;
+            const float lw = w_im - w_low;
+            const float hh = 1 - lh, hw = 1 - lw;
+            const float w1 = hh * hw, w2 = hh * lw, w3 = lh * hw, w4 = lh * lw;
+            auto corner = [&](bool inside, int h, int w) {
+              return inside ? data_value_ptr + (h * spatial_w + w) * qid_stride
+                            : zeros.data();
+            };
+            const float *v1 = corner(h_low >= 0 && w_low >= 0, h_low, w_low);
+            const float *v2 =
+                corner(h_low >= 0 && w_high <= spatial_w - 1, h_low, w_high);
+            const float *v3 =
+                corner(h_high <= spatial_h - 1 && w_low >= 0, h_high, w_low);
+            const float *v4 = corner(
+                h_high <= spatial_h - 1 && w_high <= spatial_w - 1, h_high,
+                w_high);
+            for (int c = 0; c < channels; ++c) {
+              col[c] += (w1 * v1[c] + w2 * v2[c] + w3 * v3[c] + w4 * v4[c]) *
+                        weight;
+            }
+          }
+        }
+      }
+    }
+  };
+  parallelForChunks((size_t)batch_size * num_query, grain, forward_rows);
+}
+
+void msDeformAttnBackwardCpu(
+    const float *value, const float *spatial_shapes,
+    const float *level_start_index, const float *sampling_loc,
+    const float *attn_weight, const float *grad_output, const int32_t batch,
+    const int32_t spatial_size, const int32_t num_heads,
+    const int32_t channels, const int32_t num_levels,
+    const int32_t num_query, const int32_t num_point, float *grad_value,
+    float *grad_sampling_loc, float *grad_attn_weight) {
+  const int32_t qid_stride = num_heads * channels;
+
+  // Every (batch, head) pair owns disjoint slices of all three gradients, so
+  // pairs run in parallel without locks or partial buffers. Inside a pair
+  // queries, levels and points are walked in the order of the sequential
+  // kernel, so each gradient element is accumulated in the same order and
+  // the result does not depend on the thread count.
+  auto backward_pairs = [&](size_t, size_t begin, size_t end) {
+    for (size_t pair = begin; pair < end; ++pair) {
+      const int32_t b_col = pair / num_heads;
+      const int32_t m_col = pair % num_heads;
+      const int64_t data_value_ptr_init_offset =
+          (int64_t)b_col * spatial_size * qid_stride + m_col * channels;
+      for (int32_t q_col = 0; q_col < num_query; ++q_col) {
+        const int64_t sampling_index =
+            ((int64_t)b_col * num_query + q_col) * num_heads + m_col;
+        const float *top_grad = grad_output + sampling_index * channels;
+        int64_t data_weight_ptr = sampling_index * num_levels * num_point;
+        for (int32_t l_col = 0; l_col < num_levels; ++l_col) {
+          int32_t level_start_id = level_start_index[l_col];
+          int32_t spatial_h_ptr = l_col << 1;
+          int32_t spatial_h = spatial_shapes[spatial_h_ptr];
+          int32_t spatial_w = spatial_shapes[spatial_h_ptr + 1];
+          int64_t value_ptr_offset =
+              data_value_ptr_init_offset + level_start_id * qid_stride;
+          const float *data_value_ptr = value + value_ptr_offset;
+          float *grad_value_ptr = grad_value + value_ptr_offset;
+          for (int32_t p_col = 0; p_col < num_point;
+               ++p_col, ++data_weight_ptr) {
+            float loc_w = sampling_loc[data_weight_ptr << 1];
+            float loc_h = sampling_loc[(data_weight_ptr << 1) + 1];
+            float weight = attn_weight[data_weight_ptr];
+            float h_im = loc_h * spatial_h - 0.5;
+            float w_im = loc_w * spatial_w - 0.5;
+            if (!(h_im > -1 && w_im > -1 && h_im < spatial_h &&
+                  w_im < spatial_w)) {
+              continue;
+            }
+            msDeformAttnCol2imBilinear(data_value_ptr, spatial_h, spatial_w,
+                                       qid_stride, channels, h_im, w_im,
+                                       top_grad, weight, grad_value_ptr,
+                                       grad_sampling_loc +
+                                           (data_weight_ptr << 1),
+                                       grad_attn_weight + data_weight_ptr);
+          }
+        }
+      }
+    }
+  };
+  parallelForChunks((size_t)batch * num_heads, 1, backward_pairs);
+}
+
+}  // namespace mluoptest
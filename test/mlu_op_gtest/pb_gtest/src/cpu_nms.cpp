@@ -0,0 +1,336 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <vector>
+#include "cpu_nms.h"
+#include "box_iou.h"
+#include "parallel_for.h"
+#include "core/logging.h"
+
+namespace mluoptest {
+
+namespace {
+// boxes of one batch in SoA, shared by all classes of the batch.
+struct NmsBoxes {
+  int num = 0;
+  std::vector<float> x1, y1, x2, y2;      // as in input, for output_mode 1/2
+  std::vector<float> bx1, by1, bx2, by2;  // corners after box_mode
+  std::vector<float> area;
+};
+
+
+struct NmsKeep {
+  int index;
+  float score;  // score when the box is selected
+};
+
+void loadNmsBoxes(const float *input_data, int input_box_num,
+                  int input_layout, const NmsParam &param, NmsBoxes *boxes) {
+  boxes->num = input_box_num;
+  for (auto v : {&boxes->x1, &boxes->y1, &boxes->x2, &boxes->y2, &boxes->bx1,
+                 &boxes->by1, &boxes->bx2, &boxes->by2, &boxes->area}) {
+    v->resize(input_box_num);
+  }
+  if (input_layout == 0) {
+    // input layout is [boxes_num, 4]
+    for (int i = 0; i < input_box_num; i++) {
+      boxes->x1[i] = input_data[0 + i * 4];
+      boxes->y1[i] = input_data[1 + i * 4];
+      boxes->x2[i] = input_data[2 + i * 4];
+      boxes->y2[i] = input_data[3 + i * 4];
+    }
+  } else if (input_layout == 1) {
+    // input layout is [4, boxes_num]
+    memcpy(boxes->x1.data(), input_data, input_box_num * sizeof(float));
+    memcpy(boxes->y1.data(), input_data + 1 * input_box_num,
+           input_box_num * sizeof(float));
+    memcpy(boxes->x2.data(), input_data + 2 * input_box_num,
+           input_box_num * sizeof(float));
+    memcpy(boxes->y2.data(), input_data + 3 * input_box_num,
+           input_box_num * sizeof(float));
+  } else {
+    VLOG(4) << "unsupport data layout now.";
+  }
+  for (int i = 0; i < input_box_num; i++) {
+    float x1_cur = boxes->x1[i];
+    float y1_cur = boxes->y1[i];
+    float x2_cur = boxes->x2[i];
+    float y2_cur = boxes->y2[i];
+    if (param.box_mode == 0) {
+      if (x1_cur > x2_cur) {
+        float tmp = x1_cur;
+        x1_cur = x2_cur;
+        x2_cur = tmp;
+      }
+      if (y1_cur > y2_cur) {
+        float tmp = y1_cur;
+        y1_cur = y2_cur;
+        y2_cur = tmp;
+      }
+    } else if (param.box_mode == 1) {
+      x1_cur = x1_cur - x2_cur * 0.5;
+      x2_cur = x1_cur + x2_cur;
+      y1_cur = y1_cur - y2_cur * 0.5;
+      y2_cur = y1_cur + y2_cur;
+    }
+    boxes->bx1[i] = x1_cur;
+    boxes->by1[i] = y1_cur;
+    boxes->bx2[i] = x2_cur;
+    boxes->by2[i] = y2_cur;
+    if (param.algo == 1) {
+      boxes->area[i] =
+          (x2_cur - x1_cur + param.offset) * (y2_cur - y1_cur + param.offset);
+    } else {
+      boxes->area[i] = (x2_cur - x1_cur) * (y2_cur - y1_cur);
+    }
+  }
+}
+
+// iou[i] = IoU of box m of (x1, y1, x2, y2, area) with box i, i in [begin,
+// end), see boxIouRange.
+void computeIou(const float *x1, const float *y1, const float *x2,
+                const float *y2, const float *area, int m, int begin, int end,
+                const NmsParam &param, float *iou) {
+  const float max_x1 = x1[m], max_y1 = y1[m];
+  const float max_x2 = x2[m], max_y2 = y2[m];
+  float max_area = 0;
+  if (param.algo == 0 || param.offset == 0.0) {
+    max_area = (max_x2 - max_x1) * (max_y2 - max_y1);
+  } else {
+    max_area = (max_x2 - max_x1 + param.offset) *
+               (max_y2 - max_y1 + param.offset);
+  }
+  const float offset = param.algo == 1 ? param.offset : 0.0f;
+  boxIouRange({x1, y1, x2, y2, area}, m, max_area, param.algo == 1, offset,
+              begin, end, iou);
+}
+
+// Greedy NMS as in the definition: take the box of max score (the first one
+// on ties), then decay or zero the scores of all boxes by their IoU with it.
+// The arg max of the next round is found in the same pass as the update.
+// Continues from the current score and keep, see nmsSorted.
+void nmsGreedy(const NmsBoxes &boxes, const NmsParam &param,
+               std::vector<float> *score_ptr, std::vector<NmsKeep> *keep) {
+  std::vector<float> &score = *score_ptr;
+  const int num = boxes.num;
+  std::vector<float> iou(num);
+  int max_index = 0;
+  for (int i = 1; i < num; i++) {
+    if (score[i] > score[max_index]) {
+      max_index = i;
+    }
+  }
+  while ((int)keep->size() < param.keep_num) {
+    float max_score = score[max_index];
+    if (max_score <= param.thresh_score) {
+      break;
+    }
+    keep->push_back({max_index, max_score});
+    score[max_index] = 0;
+    computeIou(boxes.bx1.data(), boxes.by1.data(), boxes.bx2.data(),
+               boxes.by2.data(), boxes.area.data(), max_index, 0, num, param,
+               iou.data());
+    max_index = 0;
+    for (int i = 0; i < num; i++) {
+      // update the score
+      if (param.method_mode == 0) {
+        if (iou[i] > param.thresh_iou) {
+          score[i] = 0;
+        }
+      } else if (param.method_mode == 1) {
+        score[i] = iou[i] > param.thresh_iou ? score[i] * (1 - iou[i])
+                                             : score[i];
+      } else {
+        // assert method_mode == 2
+        // TODO(wch): make sure the formula
+        if (param.soft_nms_sigma > 0.0) {
+          score[i] *= exp(-iou[i] * iou[i] / (2 * param.soft_nms_sigma));
+        } else {
+          score[i] = (iou[i] > param.thresh_iou) ? 0.0 : score[i];
+        }
+      }
+      if (score[i] > score[max_index]) {
+        max_index = i;
+      }
+    }
+  }
+}
+
+// Hard NMS (method_mode 0) on boxes sorted once by score, descending and
+// stable so that ties keep the smaller index first like nmsGreedy. After every
+// selected box the survivors are compacted behind it, so each round only
+// tests boxes that are still alive. Once the zeroed scores of suppressed
+// boxes could win the arg max of nmsGreedy (no positive score left), it takes
+// over from the current scores.
+void nmsSorted(const NmsBoxes &boxes, const NmsParam &param,
+               std::vector<float> *score_ptr, std::vector<NmsKeep> *keep) {
+  std::vector<float> &score = *score_ptr;
+  const int num = boxes.num;
+  for (int i = 0; i < num; ++i) {
+    if (std::isnan(score[i])) {
+      nmsGreedy(boxes, param, score_ptr, keep);
+      return;
+    }
+  }
+  std::vector<int> order(num);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](int a, int b) { return score[a] > score[b]; });
+  std::vector<float> x1(num), y1(num), x2(num), y2(num), area(num), iou(num);
+  for (int j = 0; j < num; ++j) {
+    x1[j] = boxes.bx1[order[j]];
+    y1[j] = boxes.by1[order[j]];
+    x2[j] = boxes.bx2[order[j]];
+    y2[j] = boxes.by2[order[j]];
+    area[j] = boxes.area[order[j]];
+  }
+  // [head, alive_num) of the sorted arrays are the boxes not selected or
+  // suppressed yet.
+  int head = 0;
+  int alive_num = num;
+  while ((int)keep->size() < param.keep_num) {
+    if (head == alive_num || (head > 0 && !(score[order[head]] > 0))) {
+      nmsGreedy(boxes, param, score_ptr, keep);
+      return;
+    }
+    int max_index = order[head];
+    float max_score = score[max_index];
+    if (max_score <= param.thresh_score) {
+      break;
+    }
+    keep->push_back({max_index, max_score});
+    score[max_index] = 0;
+    computeIou(x1.data(), y1.data(), x2.data(), y2.data(), area.data(), head,
+               head + 1, alive_num, param, iou.data());
+    int next_num = head + 1;
+    for (int j = head + 1; j < alive_num; ++j) {
+      if (iou[j] > param.thresh_iou) {
+        score[order[j]] = 0;
+        continue;
+      }
+      order[next_num] = order[j];
+      x1[next_num] = x1[j];
+      y1[next_num] = y1[j];
+      x2[next_num] = x2[j];
+      y2[next_num] = y2[j];
+      area[next_num] = area[j];
+      next_num++;
+    }
+    head++;
+    alive_num = next_num;
+  }
+}
+
+void writeNmsOutput(float *output_data, const std::vector<NmsKeep> &keep,
+                    const NmsBoxes &boxes, int keepNum,
+                    mluOpNmsOutputMode_t output_mode, int batch_idx,
+                    int class_idx) {
+  for (int output_box_num = 0; output_box_num < (int)keep.size();
+       ++output_box_num) {
+    int max_index = keep[output_box_num].index;
+    float max_score = keep[output_box_num].score;
+    float max_x1 = boxes.x1[max_index];
+    float max_y1 = boxes.y1[max_index];
+    float max_x2 = boxes.x2[max_index];
+    float max_y2 = boxes.y2[max_index];
+    if (output_mode == 0) {
+      // save index of max score
+      output_data[output_box_num] = max_index;
+    } else if (output_mode == 1) {
+      output_data[output_box_num * 5 + 0] = max_score;
+      output_data[output_box_num * 5 + 1] = max_x1;
+      output_data[output_box_num * 5 + 2] = max_y1;
+      output_data[output_box_num * 5 + 3] = max_x2;
+      output_data[output_box_num * 5 + 4] = max_y2;
+    } else if (output_mode == 2) {
+      output_data[0 * keepNum + output_box_num] = max_score;
+      output_data[1 * keepNum + output_box_num] = max_x1;
+      output_data[2 * keepNum + output_box_num] = max_y1;
+      output_data[3 * keepNum + output_box_num] = max_x2;
+      output_data[4 * keepNum + output_box_num] = max_y2;
+    } else if (output_mode == 3) {
+      output_data[output_box_num * 3 + 0] = batch_idx;
+      output_data[output_box_num * 3 + 1] = class_idx;
+      output_data[output_box_num * 3 + 2] = max_index;
+    } else {
+      VLOG(4) << "unsupport output mode now.";
+    }
+  }
+}
+
+}  // namespace
+
+int nmsDetectionCpu(float *output_info, const float *input_boxes,
+                    const float *input_conf, int input_batches_num,
+                    int input_classes_num, int input_boxes_num,
+                    int input_layout, mluOpNmsOutputMode_t mode,
+                    const NmsParam &param) {
+  // boxes are shared by classes, load them once per batch.
+  std::vector<NmsBoxes> batch_boxes(input_batches_num);
+  parallelForChunks(input_batches_num, 1,
+                    [&](size_t, size_t begin, size_t end) {
+                      for (size_t batch_idx = begin; batch_idx < end;
+                           ++batch_idx) {
+                        loadNmsBoxes(
+                            input_boxes + input_boxes_num * 4 * batch_idx,
+                            input_boxes_num, input_layout, param,
+                            &batch_boxes[batch_idx]);
+                      }
+                    });
+  // (batch, class) pairs are independent, outputs are written in order
+  // afterwards.
+  int pair_num = input_batches_num * input_classes_num;
+  std::vector<std::vector<NmsKeep>> keeps(pair_num);
+  parallelForChunks(
+      pair_num, 1, [&](size_t, size_t begin, size_t end) {
+        for (size_t pair_idx = begin; pair_idx < end; ++pair_idx) {
+          if (input_boxes_num == 0) {
+            continue;
+          }
+          const float *conf = input_conf + pair_idx * input_boxes_num;
+          std::vector<float> score(conf, conf + input_boxes_num);
+          const NmsBoxes &boxes = batch_boxes[pair_idx / input_classes_num];
+          if (param.method_mode == 0) {
+            nmsSorted(boxes, param, &score, &keeps[pair_idx]);
+          } else {
+            nmsGreedy(boxes, param, &score, &keeps[pair_idx]);
+          }
+        }
+      });
+  int total_output_boxes_num = 0;
+  for (int pair_idx = 0; pair_idx < pair_num; ++pair_idx) {
+    int batch_idx = pair_idx / input_classes_num;
+    int class_idx = pair_idx % input_classes_num;
+    int output_offset = mode == 3 ? 3 * total_output_boxes_num : 0;
+    writeNmsOutput(output_info + output_offset, keeps[pair_idx],
+                   batch_boxes[batch_idx], param.keep_num, mode, batch_idx,
+                   class_idx);
+    total_output_boxes_num += keeps[pair_idx].size();
+  }
+  return total_output_boxes_num;
+}
+
+}  // namespace mluoptest
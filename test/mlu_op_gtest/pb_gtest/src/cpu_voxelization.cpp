@@ -0,0 +1,250 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "cpu_voxelization.h"
+
+#include <cmath>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "parallel_for.h"
+
+namespace mluoptest {
+namespace {
+// points per chunk of the per point stages
+constexpr size_t kVoxelizeGrain = 4096;
+
+void dynamicVoxelize(const float *points, int32_t *coors, const float voxel_x,
+                     const float voxel_y, const float voxel_z,
+                     const float coors_x_min, const float coors_y_min,
+                     const float coors_z_min, const float coors_x_max,
+                     const float coors_y_max, const float coors_z_max,
+                     const int32_t grid_x, const int32_t grid_y,
+                     const int32_t grid_z, const size_t num_points,
+                     const size_t num_features, const size_t NDim) {
+  for (size_t index = 0; index < num_points; ++index) {
+    const float *points_offset = points + index * num_features;
+    int32_t *coors_offset = coors + index * NDim;
+    int32_t c_x = floorf((points_offset[0] - coors_x_min) / voxel_x);
+    if (c_x < 0 || c_x >= grid_x) {
+      coors_offset[0] = -1;
+      continue;
+    }
+
+    int32_t c_y = floorf((points_offset[1] - coors_y_min) / voxel_y);
+    if (c_y < 0 || c_y >= grid_y) {
+      coors_offset[0] = -1;
+      coors_offset[1] = -1;
+      continue;
+    }
+
+    int32_t c_z = floorf((points_offset[2] - coors_z_min) / voxel_z);
+    if (c_z < 0 || c_z >= grid_z) {
+      coors_offset[0] = -1;
+      coors_offset[1] = -1;
+      coors_offset[2] = -1;
+    } else {
+      coors_offset[0] = c_z;
+      coors_offset[1] = c_y;
+      coors_offset[2] = c_x;
+    }
+  }
+}
+
+struct VoxelCoor {
+  int32_t x, y, z;
+  bool operator==(const VoxelCoor &other) const {
+    return x == other.x && y == other.y && z == other.z;
+  }
+};
+
+struct VoxelCoorHash {
+  size_t operator()(const VoxelCoor &coor) const {
+    uint64_t h = (uint32_t)coor.x;
+    h = h * 0x9e3779b97f4a7c15ULL + (uint32_t)coor.y;
+    h = h * 0x9e3779b97f4a7c15ULL + (uint32_t)coor.z;
+    return h ^ (h >> 29);
+  }
+};
+
+// point_to_pointidx: the first point of the same voxel (itself if it is the
+// first one), point_to_voxelidx: number of earlier points of the same voxel,
+// -1 if it reaches max_points. Points are visited in order and the voxels are
+// looked up in a hash map, same results as comparing with all earlier points.
+void pointToVoxelidx(const int32_t *coor, int32_t *point_to_voxelidx,
+                     int32_t *point_to_pointidx, const int32_t max_points,
+                     const int32_t max_voxels, const size_t num_points,
+                     const size_t NDim) {
+  // voxel -> (first point, number of points so far)
+  std::unordered_map<VoxelCoor, std::pair<int32_t, int32_t>, VoxelCoorHash>
+      voxel_points;
+  voxel_points.reserve(num_points);
+  for (size_t index = 0; index < num_points; ++index) {
+    const int32_t *coor_offset = coor + index * NDim;
+    if (coor_offset[0] == -1) {
+      point_to_pointidx[index] = -1;
+      point_to_voxelidx[index] = -1;
+      continue;
+    }
+
+    VoxelCoor key = {coor_offset[0], coor_offset[1], coor_offset[2]};
+    auto &voxel =
+        voxel_points.emplace(key, std::make_pair((int32_t)index, 0))
+            .first->second;
+    int32_t num = voxel.second++;
+    point_to_pointidx[index] = voxel.first;
+    if (num < max_points) {
+      point_to_voxelidx[index] = num;
+    } else {
+      point_to_voxelidx[index] = -1;
+    }
+  }
+}
+
+void determinVoxelNum(float *num_points_per_voxel, int32_t *point_to_voxelidx,
+                      int32_t *point_to_pointidx, int32_t *coor_to_voxelidx,
+                      float *voxel_num, const int32_t max_points,
+                      const int32_t max_voxels, const size_t num_points) {
+  for (size_t i = 0; i < num_points; ++i) {
+    int point_pos_in_voxel = point_to_voxelidx[i];
+    coor_to_voxelidx[i] = -1;
+
+    if (point_pos_in_voxel == -1) {
+      continue;
+    } else if (point_pos_in_voxel == 0) {
+      int voxelidx = voxel_num[0];
+      if (voxel_num[0] >= max_voxels) continue;
+      voxel_num[0] += 1;
+      coor_to_voxelidx[i] = voxelidx;
+      num_points_per_voxel[voxelidx] = 1;
+    } else {
+      int point_idx = point_to_pointidx[i];
+      int voxelidx = coor_to_voxelidx[point_idx];
+      if (voxelidx != -1) {
+        coor_to_voxelidx[i] = voxelidx;
+        num_points_per_voxel[voxelidx] += 1;
+      }
+    }
+  }
+}
+
+void assignPointToVoxel(const float *points, int32_t *point_to_voxelidx,
+                        int32_t *coor_to_voxelidx, float *voxels,
+                        const int32_t max_points, const size_t num_features,
+                        const size_t num_points, const size_t NDim) {
+  for (size_t thread_idx = 0; thread_idx < num_points * num_features;
+       ++thread_idx) {
+    int32_t index = thread_idx / num_features;
+    int32_t num = point_to_voxelidx[index];
+    int32_t voxelidx = coor_to_voxelidx[index];
+    if (num > -1 && voxelidx > -1) {
+      float *voxels_offset =
+          voxels + voxelidx * max_points * num_features + num * num_features;
+
+      int32_t k = thread_idx % num_features;
+      voxels_offset[k] = points[thread_idx];
+    }
+  }
+}
+
+void assignVoxelCoors(int32_t *temp_coors, int32_t *point_to_voxelidx,
+                      int32_t *coor_to_voxelidx, float *coors,
+                      const size_t num_points, const size_t NDim) {
+  for (size_t thread_idx = 0; thread_idx < num_points * NDim; ++thread_idx) {
+    int32_t index = thread_idx / NDim;
+    int32_t num = point_to_voxelidx[index];
+    int32_t voxelidx = coor_to_voxelidx[index];
+    if (num == 0 && voxelidx > -1) {
+      float *coors_offset = coors + voxelidx * NDim;
+      int32_t k = thread_idx % NDim;
+      coors_offset[k] = temp_coors[thread_idx];
+    }
+  }
+}
+
+}  // namespace
+
+void hardVoxelizeCpu(const float *points, const float *voxel_size,
+                     const float *coors_range, const int32_t num_points,
+                     const int32_t num_features, const int32_t max_points,
+                     const int32_t max_voxels, const int32_t NDim,
+                     float *voxels, float *coors, float *num_points_per_voxel,
+                     float *voxel_num) {
+  const float voxel_x = voxel_size[0];
+  const float voxel_y = voxel_size[1];
+  const float voxel_z = voxel_size[2];
+  const float coors_x_min = coors_range[0];
+  const float coors_y_min = coors_range[1];
+  const float coors_z_min = coors_range[2];
+  const float coors_x_max = coors_range[3];
+  const float coors_y_max = coors_range[4];
+  const float coors_z_max = coors_range[5];
+
+  const int32_t grid_x = round((coors_x_max - coors_x_min) / voxel_x);
+  const int32_t grid_y = round((coors_y_max - coors_y_min) / voxel_y);
+  const int32_t grid_z = round((coors_z_max - coors_z_min) / voxel_z);
+
+  std::vector<int32_t> temp_coors_vec((size_t)num_points * NDim);
+  int32_t *temp_coors = temp_coors_vec.data();
+
+  // every stage but pointToVoxelidx and determinVoxelNum is per point.
+  parallelForChunks(
+      num_points, kVoxelizeGrain,
+      [&](size_t, size_t begin, size_t end) {
+        dynamicVoxelize(points + begin * num_features,
+                        temp_coors + begin * NDim, voxel_x, voxel_y, voxel_z,
+                        coors_x_min, coors_y_min, coors_z_min, coors_x_max,
+                        coors_y_max, coors_z_max, grid_x, grid_y, grid_z,
+                        end - begin, num_features, NDim);
+      });
+
+  std::vector<int32_t> point_to_pointidx_vec(num_points);
+  std::vector<int32_t> point_to_voxelidx_vec(num_points);
+  int32_t *point_to_pointidx = point_to_pointidx_vec.data();
+  int32_t *point_to_voxelidx = point_to_voxelidx_vec.data();
+
+  pointToVoxelidx(temp_coors, point_to_voxelidx, point_to_pointidx, max_points,
+                  max_voxels, num_points, NDim);
+
+  std::vector<int32_t> coor_to_voxelidx_vec(num_points);
+  int32_t *coor_to_voxelidx = coor_to_voxelidx_vec.data();
+
+  *voxel_num = 0;
+  determinVoxelNum(num_points_per_voxel, point_to_voxelidx, point_to_pointidx,
+                   coor_to_voxelidx, voxel_num, max_points, max_voxels,
+                   num_points);
+
+  parallelForChunks(
+      num_points, kVoxelizeGrain,
+      [&](size_t, size_t begin, size_t end) {
+        assignPointToVoxel(points + begin * num_features,
+                           point_to_voxelidx + begin, coor_to_voxelidx + begin,
+                           voxels, max_points, num_features, end - begin,
+                           NDim);
+        assignVoxelCoors(temp_coors + begin * NDim, point_to_voxelidx + begin,
+                         coor_to_voxelidx + begin, coors, end - begin, NDim);
+      });
+}
+
+
+}  // namespace mluoptest
@@ -0,0 +1,142 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "deform_im2col.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "parallel_for.h"
+
+namespace mluoptest {
+
+namespace {
+// output rows of a parallel chunk hold about this many column values.
+constexpr int64_t kIm2colChunkFloats = (int64_t)1 << 14;
+}  // namespace
+
+int64_t deformColumnTileRows(const DeformConvShape &s, int64_t align) {
+  const int64_t row_floats = std::max((int64_t)1, (int64_t)s.kh * s.kw * s.ci);
+  const int64_t rows =
+      std::max((int64_t)1, kDeformColumnTileFloats / row_floats);
+  align = std::max((int64_t)1, align);
+  return std::max(align, rows / align * align);
+}
+
+void deformIm2col(const DeformConvShape &s, const float *input,
+                  const float *offset, const float *mask, int64_t row_begin,
+                  int64_t row_end, float *columns) {
+  const int64_t rows = row_end - row_begin;
+  const int cg = s.ci / s.g;   // channels per convolution group
+  const int cd = s.ci / s.dg;  // channels per deformable group
+  const int64_t group_k = (int64_t)s.kh * s.kw * cg;
+  // corners outside the input read zeros, as the scalar kernel did.
+  const std::vector<float> zeros(cd, 0.0f);
+  const size_t grain = std::max(
+      (int64_t)1,
+      kIm2colChunkFloats / std::max((int64_t)1, (int64_t)s.kh * s.kw * s.ci));
+
+  auto im2col_rows = [&](size_t, size_t begin, size_t end) {
+    for (size_t r = begin; r < end; ++r) {
+      const int64_t row = row_begin + r;
+      const int64_t idx_n = row / ((int64_t)s.ho * s.wo);
+      const int idx_ho = row / s.wo % s.ho;
+      const int idx_wo = row % s.wo;
+      const float *input_ptr = input + idx_n * s.hi * s.wi * s.ci;
+      const float *offset_ptr = offset + row * s.dg * s.kh * s.kw * 2;
+      const float *mask_ptr =
+          mask != nullptr ? mask + row * s.dg * s.kh * s.kw : nullptr;
+      const int hi_start = idx_ho * s.sh - s.pt;
+      const int wi_start = idx_wo * s.sw - s.pl;
+      for (int idx_kh = 0; idx_kh < s.kh; ++idx_kh) {
+        for (int idx_kw = 0; idx_kw < s.kw; ++idx_kw) {
+          for (int idx_dg = 0; idx_dg < s.dg; ++idx_dg) {
+            const int data_mask = (idx_dg * s.kh + idx_kh) * s.kw + idx_kw;
+            const float offset_h = offset_ptr[data_mask * 2];
+            const float offset_w = offset_ptr[data_mask * 2 + 1];
+            const float mask_value =
+                mask_ptr != nullptr ? mask_ptr[data_mask] : 1.0f;
+            const float h_in = hi_start + idx_kh * s.dh + offset_h;
+            const float w_in = wi_start + idx_kw * s.dw + offset_w;
+            const bool inside =
+                h_in > -1 && w_in > -1 && h_in < s.hi && w_in < s.wi;
+
+            const int ci_begin = idx_dg * s.ci / s.dg;
+            const float *v1 = zeros.data(), *v2 = zeros.data();
+            const float *v3 = zeros.data(), *v4 = zeros.data();
+            float w1 = 0, w2 = 0, w3 = 0, w4 = 0;
+            if (inside) {
+              const int h_low = std::floor(h_in);
+              const int w_low = std::floor(w_in);
+              const int h_high = h_low + 1;
+              const int w_high = w_low + 1;
+              const float lh = h_in - h_low;
+              const float lw = w_in - w_low;
+              const float hh = 1 - lh;
+              const float hw = 1 - lw;
+              auto corner = [&](int h, int w) {
+                return input_ptr + ((int64_t)h * s.wi + w) * s.ci + ci_begin;
+              };
+              if (h_low >= 0 && w_low >= 0) {
+                v1 = corner(h_low, w_low);
+              }
+              if (h_low >= 0 && w_high <= s.wi - 1) {
+                v2 = corner(h_low, w_high);
+              }
+              if (h_high <= s.hi - 1 && w_low >= 0) {
+                v3 = corner(h_high, w_low);
+              }
+              if (h_high <= s.hi - 1 && w_high <= s.wi - 1) {
+                v4 = corner(h_high, w_high);
+              }
+              w1 = hh * hw, w2 = hh * lw, w3 = lh * hw, w4 = lh * lw;
+            }
+
+            // the channels of a deformable group may span convolution
+            // groups, write one contiguous run per convolution group.
+            for (int c = 0; c < cd;) {
+              const int cidx = ci_begin + c;
+              const int gi = cidx / cg;
+              const int run = std::min(cd - c, (gi + 1) * cg - cidx);
+              float *dst = columns + (gi * rows + (int64_t)r) * group_k +
+                           (idx_kh * s.kw + idx_kw) * cg + (cidx - gi * cg);
+              if (inside) {
+                for (int j = 0; j < run; ++j) {
+                  dst[j] = (w1 * v1[c + j] + w2 * v2[c + j] +
+                            w3 * v3[c + j] + w4 * v4[c + j]) *
+                           mask_value;
+                }
+              } else {
+                std::fill(dst, dst + run, 0.0f);
+              }
+              c += run;
+            }
+          }
+        }
+      }
+    }
+  };
+  parallelForChunks(rows, grain, im2col_rows);
+}
+
+}  // namespace mluoptest
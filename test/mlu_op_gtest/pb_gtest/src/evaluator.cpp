@@ -25,6 +25,7 @@
 #include <limits>
 #endif
 #include <algorithm>
+#include <cmath>
 #include <utility>
 #include <set>
 #include <vector>
@@ -54,13 +55,29 @@ void Evaluator::init(void *baseline_result, void *mlu_result,
   }
   stride_ = is_complex_ ? 2 : 1;
   count_total_ = is_complex_ ? count_ * 2 : count_;
+  loose_check_nan_inf_ = global_var.loose_check_nan_inf_;
+  need_diff3_ = false;
+  need_diff4_ = false;
+  need_kl_ = false;
+  for (auto &it : criterions_) {
+    need_diff3_ = need_diff3_ || it.formula == DIFF3;
+    need_diff4_ = need_diff4_ || it.formula == DIFF4;
+    need_kl_ = need_kl_ || it.formula == DIFF_KL;
+  }
+  diff3_eps_ = 0;
+  if (dtype_ == MLUOP_DTYPE_HALF || dtype_ == MLUOP_DTYPE_COMPLEX_HALF) {
+    diff3_eps_ = EPSILON_HALF;
+  } else if (dtype_ == MLUOP_DTYPE_FLOAT ||
+             dtype_ == MLUOP_DTYPE_COMPLEX_FLOAT) {
+    diff3_eps_ = EPSILON_FLOAT;
+  }
   thresholdLevel1();
 }
 
 void Evaluator::computeDiffByDtype() {
 #define COMPUTE_DIFF_BY_DTYPE(MLUOP_DTYPE, ORIGIN_DTYPE) \
   case MLUOP_DTYPE: {                                    \
-    compute_diff<ORIGIN_DTYPE>();                        \
+    computeDiffFused<ORIGIN_DTYPE>();                    \
   } break;
   switch (dtype_) {
     COMPUTE_DIFF_BY_DTYPE(MLUOP_DTYPE_DOUBLE, CPU_DTYPE(MLUOP_DTYPE_DOUBLE));
@@ -91,24 +108,14 @@ void Evaluator::computeDiffByDtype() {
 void Evaluator::computeDiffFloatAndDouble() {
   switch (dtype_) {
     case MLUOP_DTYPE_DOUBLE: {
-      compute_diff<double>();
+      computeDiffFused<double>();
     } break;
     default: {
-      compute_diff<float>();
+      computeDiffFused<float>();
     }
   }
 }
 
-void Evaluator::computeDiffForOneCriterion() {
-  if (skip_compute_diff_) {
-    return;
-  }
-  func_ = cur_criterion_.formula;
-  computeDiffFunc(this);
-  error_vec_.push_back(
-      ErrorWrap(name_, cur_criterion_, error_, error_imag_, dtype_));
-}
-
 void Evaluator::setErrorWrap() {
   for (auto &it : criterions_) {
     if (nan_inf_pass_) {
@@ -139,37 +146,130 @@ void Evaluator::thresholdLevel1() {
   }
 }
 
-// old: delete after all op use void *
-void Evaluator::checkNanInfFloatAndDouble() {
-  switch (dtype_) {
-    case MLUOP_DTYPE_DOUBLE: {
-      check_nan_inf<double>();
-    } break;
-    default: {
-      check_nan_inf<float>();
+// Called for positions where baseline or mlu is nan/inf.
+// For threshold level 1, both nan or equal inf are treated as 0 (return true)
+// and anything else fails the case. Otherwise only check whether the nan/inf
+// of mlu matches the baseline, the errors are not computed in this case.
+bool Evaluator::resetNanInfAsZero(double base, double mlu, size_t pos,
+                                  DiffSums *sums) {
+  bool pass = true;
+  if (threshold_l1_) {
+    if (std::isnan(base) && std::isnan(mlu)) {
+      sums->nan_pair_num++;
+      return true;
+    } else if (std::isinf(base) && std::isinf(mlu) && base == mlu) {
+      sums->inf_pair_num++;
+      return true;
+    }
+    // if a is inf, b is -inf, don't deal here, set diff as DBL_MAX.
+    pass = false;
+  } else if (!loose_check_nan_inf_) {
+    sums->nan_inf_num++;
+    pass = (std::isnan(mlu) && std::isnan(base)) || (mlu == base);
+  } else {
+    // not distinguish nan and inf
+    sums->nan_inf_num++;
+    bool neq = false;
+    if (std::isnan(mlu)) {
+      neq = std::isinf(base);
+      pass = std::isnan(base) || neq;
+    } else if (std::isinf(mlu)) {
+      neq = std::isnan(base);
+      pass = (mlu == base) || neq;
     }
+    if (neq) {
+      sums->neq_pos = std::min(sums->neq_pos, pos);
+    }
+  }
+  if (!pass) {
+    sums->wrong_num++;
+    sums->wrong_pos = std::min(sums->wrong_pos, pos);
   }
+  return false;
 }
 
-void Evaluator::checkNanInfByDtype() {
-  switch (dtype_) {
-    case MLUOP_DTYPE_DOUBLE: {
-      check_nan_inf<double>();
-    } break;
-    case MLUOP_DTYPE_COMPLEX_FLOAT:
-    case MLUOP_DTYPE_FLOAT: {
-      check_nan_inf<float>();
-    } break;
-    case MLUOP_DTYPE_COMPLEX_HALF:
-    case MLUOP_DTYPE_HALF: {
-      check_nan_inf<half>();
-    } break;
-    case MLUOP_DTYPE_BFLOAT16: {
-      check_nan_inf<bfloat16>();
-    } break;
-    default: {
-      // only float point need check nan/inf
+void Evaluator::setFusedErrorWrap(const DiffSums &sums,
+                                  const size_t *diff4_num,
+                                  const size_t *diff4_less) {
+  if (sums.nan_pair_num > 0) {
+    VLOG(4) << "Found result of baseline and mlu are both NaN, set them as 0, "
+               "and go on.";
+  }
+  if (sums.inf_pair_num > 0) {
+    VLOG(4) << "Found result of baseline and mlu are both Inf, set them as 0, "
+               "and go on.";
+  }
+  if (sums.wrong_num > 0 || sums.nan_inf_num > 0) {
+    if (threshold_l1_) {
+      LOG(ERROR)
+          << "Found NaN or Inf when compute diff, return DBL_MAX instead.";
+    } else if (sums.wrong_num > 0) {
+      LOG(ERROR) << "Found NaN or Inf, but mlu is not equal to baseline,"
+                 << " return DBL_MAX instead."
+                 << "The first wrong position is " << sums.wrong_pos;
+    } else if (sums.neq_pos != SIZE_MAX) {
+      LOG(WARNING) << "The results of baseline and mlu are not equal, "
+                   << "one of them is nan and the other is inf, "
+                   << "the current mode will not distinguish nan and inf, "
+                   << "this case will pass. The first position is "
+                   << sums.neq_pos;
     }
+    nan_inf_pass_ = (sums.wrong_num == 0);
+    setErrorWrap();
+    return;
+  }
+
+  // fold the 4 lanes into real part (part 0) and imaginary part (part 1).
+  auto sum_lanes = [this](const double *v, int part) {
+    return is_complex_ ? v[part] + v[part + 2] : (v[0] + v[1]) + (v[2] + v[3]);
+  };
+  auto max_lanes = [this](const double *v, int part) {
+    return is_complex_ ? std::max(v[part], v[part + 2])
+                       : std::max(std::max(v[0], v[1]), std::max(v[2], v[3]));
+  };
+  for (auto &it : criterions_) {
+    double error[2] = {-1, -1};
+    for (int part = 0; part < stride_; ++part) {
+      switch (it.formula) {
+        case DIFF1: {
+          error[part] = sum_lanes(sums.diff1_num, part) /
+                        (sum_lanes(sums.diff1_den, part) + EPSILON);
+        } break;
+        case DIFF2: {
+          error[part] = std::sqrt(sum_lanes(sums.diff2_num, part) /
+                                  (sum_lanes(sums.diff2_den, part) + EPSILON));
+        } break;
+        case DIFF3: {
+          error[part] = max_lanes(sums.diff3_max, part);
+        } break;
+        case DIFF3_2: {
+          error[part] = max_lanes(sums.diff3_2_max, part);
+        } break;
+        case DIFF4: {
+          error[part] = (diff4_num[part] < 100)
+                            ? -1
+                            : double(diff4_less[part]) / diff4_num[part];
+        } break;
+        case DIFF_KL: {
+          // diff_kl needs count_total_ <= INT64_MAX because of the length in
+          // python func is int64, diff_kl skips the data with too less
+          // quantity. real and imag parts are computed together.
+          // kl = sum(0.5 * (p' - q') * log(p' / q')), with p' = p / sum(p)
+          // and q' = q / sum(q), sum(p') = sum(q') = 1 cancels the sums in log.
+          if (part == 0 && count_total_ >= (size_t)1000 &&
+              count_total_ <= (size_t)INT64_MAX) {
+            error[part] = 0.5 * (sums.kl_base_log / sums.kl_base_sum -
+                                 sums.kl_mlu_log / sums.kl_mlu_sum);
+          }
+        } break;
+        default: {
+          GTEST_CHECK(false,
+                      "Evaluator: found unsupported criterion when compute "
+                      "result error.");
+        }
+      }
+    }
+    error_vec_.push_back(ErrorWrap(name_, it, error[0], error[1], dtype_));
   }
 }
 
@@ -185,11 +285,7 @@ void Evaluator::computeDiff(void *baseline_result, void *mlu_result,
   }
   init(baseline_result, mlu_result, count, criterions, name, dtype);
   selectFuncPtr();
-  checkNanInfFunc(this);
-  for (auto &it : criterions_) {
-    cur_criterion_ = it;
-    computeDiffForOneCriterion();
-  }
+  computeDiffFunc(this);
 }
 
 bool Evaluator::isPassed() {
@@ -342,4 +438,199 @@ void Evaluator::copy(const Evaluator *e) {
   criterion_vec_ = e->criterion_vec_;
 }
 
+void DiffSums::merge(const DiffSums &other) {
+  for (int lane = 0; lane < 4; ++lane) {
+    diff1_num[lane] += other.diff1_num[lane];
+    diff1_den[lane] += other.diff1_den[lane];
+    diff2_num[lane] += other.diff2_num[lane];
+    diff2_den[lane] += other.diff2_den[lane];
+    diff3_max[lane] = std::max(diff3_max[lane], other.diff3_max[lane]);
+    diff3_2_max[lane] = std::max(diff3_2_max[lane], other.diff3_2_max[lane]);
+  }
+  kl_base_sum += other.kl_base_sum;
+  kl_mlu_sum += other.kl_mlu_sum;
+  kl_base_log += other.kl_base_log;
+  kl_mlu_log += other.kl_mlu_log;
+  nan_inf_num += other.nan_inf_num;
+  nan_pair_num += other.nan_pair_num;
+  inf_pair_num += other.inf_pair_num;
+  wrong_num += other.wrong_num;
+  wrong_pos = std::min(wrong_pos, other.wrong_pos);
+  neq_pos = std::min(neq_pos, other.neq_pos);
+}
+
+void Diff4PairSet::reserve(size_t size) {
+  size_t slot_num = 16;
+  while (slot_num < size * 2) {
+    slot_num *= 2;
+  }
+  if (slot_num > slots_.size()) {
+    rehash(slot_num);
+  }
+}
+
+void Diff4PairSet::rehash(size_t slot_num) {
+  slots_.assign(slot_num, 0);
+  std::vector<Pair> pairs;
+  pairs.swap(pairs_);
+  for (auto &it : pairs) {
+    insert(it);
+  }
+}
+
+void Diff4PairSet::insert(const Pair &pair) {
+  if ((pairs_.size() + 1) * 2 > slots_.size()) {
+    rehash(std::max((size_t)16, slots_.size() * 2));
+  }
+  uint64_t hash = pair.mlu * 0x9e3779b97f4a7c15ULL + pair.base;
+  hash = (hash ^ (hash >> 31)) * 0xbf58476d1ce4e5b9ULL;
+  hash ^= hash >> 29;
+  size_t mask = slots_.size() - 1;
+  for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+    if (slots_[slot] == 0) {
+      pairs_.push_back(pair);
+      slots_[slot] = pairs_.size();
+      return;
+    }
+    const Pair &cur = pairs_[slots_[slot] - 1];
+    if (cur.mlu == pair.mlu && cur.base == pair.base) {
+      return;
+    }
+  }
+}
+
+void Diff4PairSet::merge(const Diff4PairSet &other) {
+  reserve(pairs_.size() + other.pairs_.size());
+  for (auto &it : other.pairs_) {
+    insert(it);
+  }
+}
+
+void Diff4PairSet::finish() {
+  std::vector<size_t>().swap(slots_);
+  pairs_.shrink_to_fit();
+}
+
+size_t Diff4PairSet::lessCount() const {
+  size_t res = 0;
+  for (auto &it : pairs_) {
+    res += it.less;
+  }
+  return res;
+}
+
+DiffSums mergeDiffSums(const std::vector<DiffSums> &sums, size_t begin,
+                       size_t end) {
+  if (begin >= end) {
+    return DiffSums();
+  } else if (end - begin == 1) {
+    return sums[begin];
+  }
+  size_t mid = begin + (end - begin) / 2;
+  DiffSums res = mergeDiffSums(sums, begin, mid);
+  res.merge(mergeDiffSums(sums, mid, end));
+  return res;
+}
+
+#ifdef __AVX2__
+namespace {
+struct DiffAccumulator {
+  __m256d diff1_num = _mm256_setzero_pd();
+  __m256d diff1_den = _mm256_setzero_pd();
+  __m256d diff2_num = _mm256_setzero_pd();
+  __m256d diff2_den = _mm256_setzero_pd();
+  __m256d diff3_max = _mm256_setzero_pd();
+  __m256d diff3_2_max = _mm256_setzero_pd();
+  // stays 0 unless some (mlu - baseline) is nan/inf
+  __m256d non_finite = _mm256_setzero_pd();
+
+  inline void add(__m256d base, __m256d mlu, __m256d eps3, bool need_diff3) {
+    const __m256d abs_mask =
+        _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+    __m256d diff = _mm256_sub_pd(mlu, base);
+    __m256d abs_diff = _mm256_and_pd(diff, abs_mask);
+    __m256d abs_base = _mm256_and_pd(base, abs_mask);
+    diff1_num = _mm256_add_pd(diff1_num, abs_diff);
+    diff1_den = _mm256_add_pd(diff1_den, abs_base);
+    diff2_num = _mm256_add_pd(diff2_num, _mm256_mul_pd(diff, diff));
+    diff2_den = _mm256_add_pd(diff2_den, _mm256_mul_pd(base, base));
+    diff3_2_max = _mm256_max_pd(diff3_2_max, abs_diff);
+    if (need_diff3) {
+      __m256d ratio = _mm256_div_pd(
+          abs_diff, _mm256_add_pd(abs_base, _mm256_set1_pd(EPSILON)));
+      ratio = _mm256_blendv_pd(ratio, abs_diff,
+                               _mm256_cmp_pd(abs_base, eps3, _CMP_LT_OQ));
+      diff3_max = _mm256_max_pd(diff3_max, ratio);
+    }
+    non_finite = _mm256_add_pd(non_finite,
+                               _mm256_mul_pd(diff, _mm256_setzero_pd()));
+  }
+
+  // store into sums, return false if found nan/inf.
+  inline bool store(DiffSums *sums) {
+    double check[4];
+    _mm256_storeu_pd(check, non_finite);
+    if (std::isnan(check[0] + check[1] + check[2] + check[3])) {
+      return false;
+    }
+    _mm256_storeu_pd(sums->diff1_num, diff1_num);
+    _mm256_storeu_pd(sums->diff1_den, diff1_den);
+    _mm256_storeu_pd(sums->diff2_num, diff2_num);
+    _mm256_storeu_pd(sums->diff2_den, diff2_den);
+    _mm256_storeu_pd(sums->diff3_max, diff3_max);
+    _mm256_storeu_pd(sums->diff3_2_max, diff3_2_max);
+    return true;
+  }
+};
+}  // namespace
+#endif
+
+template <typename T>
+static bool accumulateFiniteTail(const T *baseline, const T *mlu, size_t begin,
+                                 size_t end, double eps3, DiffSums *sums) {
+  for (size_t i = begin; i < end; ++i) {
+    double base = baseline[i];
+    double out = mlu[i];
+    if (!std::isfinite(base) || !std::isfinite(out)) {
+      return false;
+    }
+    sums->add(base, out, i & 3, eps3);
+  }
+  return true;
+}
+
+bool accumulateFiniteDiff(const float *baseline, const float *mlu, size_t n,
+                          double eps3, bool need_diff3, DiffSums *sums) {
+  size_t i = 0;
+#ifdef __AVX2__
+  DiffAccumulator acc;
+  const __m256d eps3_vec = _mm256_set1_pd(eps3);
+  for (; i + 4 <= n; i += 4) {
+    acc.add(_mm256_cvtps_pd(_mm_loadu_ps(baseline + i)),
+            _mm256_cvtps_pd(_mm_loadu_ps(mlu + i)), eps3_vec, need_diff3);
+  }
+  if (!acc.store(sums)) {
+    return false;
+  }
+#endif
+  return accumulateFiniteTail(baseline, mlu, i, n, eps3, sums);
+}
+
+bool accumulateFiniteDiff(const double *baseline, const double *mlu, size_t n,
+                          double eps3, bool need_diff3, DiffSums *sums) {
+  size_t i = 0;
+#ifdef __AVX2__
+  DiffAccumulator acc;
+  const __m256d eps3_vec = _mm256_set1_pd(eps3);
+  for (; i + 4 <= n; i += 4) {
+    acc.add(_mm256_loadu_pd(baseline + i), _mm256_loadu_pd(mlu + i), eps3_vec,
+            need_diff3);
+  }
+  if (!acc.store(sums)) {
+    return false;
+  }
+#endif
+  return accumulateFiniteTail(baseline, mlu, i, n, eps3, sums);
+}
+
 }  // namespace mluoptest
@@ -38,6 +38,10 @@
 
 #include "cndev.h"
 
+#include "baseline_cache.h"
+#include "baseline_index.h"
+#include "host_trace.h"
+
 #include "core/mlu_env.h"
 #include "core/runtime/device.h"
 #include "internal_kernel/fill_llc/fill_llc.h"  // mluOpFillLLC
@@ -49,8 +53,6 @@
 // #include "gperftools/profiler.h"
 // #endif
 
-extern std::unordered_map<std::string, std::vector<double>> acc_baseline_map;
-
 namespace mluoptest {
 
 void DataBlock::onlyServeAsInput() {
@@ -109,6 +111,14 @@ void Executor::init(const std::shared_ptr<ExecuteContext> ectx) {
 
 void Executor::setup(std::string file,
                      const std::shared_ptr<ExecuteConfig> ecfg) {
+  parseCase(file, ecfg);
+  prepareHostData();
+  setupDevice();
+}
+
+// host-only part of setup: parse the case and create tensors.
+void Executor::parseCase(std::string file,
+                         const std::shared_ptr<ExecuteConfig> ecfg) {
   exe_config_ = ecfg;
 
   eva_res_.mlu.kernel_tracing_enabled = true;
@@ -122,7 +132,10 @@ void Executor::setup(std::string file,
   clusterLimitCheck();
 
   recordGtestTimePoint("before_parse");
-  parser_->parse(file);
+  {
+    TraceSpan span("parse");
+    parser_->parse(file);
+  }
   recordGtestTimePoint("after_parse");
   eva_res_.case_path = file;
   VLOG(4) << "param check.";
@@ -133,9 +146,16 @@ void Executor::setup(std::string file,
 
   VLOG(4) << "Create input(/output) tensors.";
   createTensors();
+}
 
+// host-only part of setup: malloc host buffers and prepare input data,
+// nothing here touches the device queue.
+void Executor::prepareHostData() {
   VLOG(4) << "Host malloc.";
-  hostMalloc();
+  {
+    TraceSpan span("host_malloc");
+    hostMalloc();
+  }
   recordGtestTimePoint("after_host_malloc");
 
   getPerfTestMode();
@@ -147,30 +167,48 @@ void Executor::setup(std::string file,
   if (mlu_need_host_data) {
     if (parser_->device() == CPU) {
       VLOG(4) << "Host malloc (for cpu compute).";
-      baselineInputMalloc();
+      {
+        TraceSpan span("host_malloc");
+        baselineInputMalloc();
+      }
       recordGtestTimePoint("after_baseline_input_malloc");
       VLOG(4) << "Init data (random data for cpu compute).";
-      initBaselineInput();  // init fp32 cpu data
+      {
+        TraceSpan span("random_data");
+        initBaselineInput();  // init fp32 cpu data
+      }
       recordGtestTimePoint("after_baseline_input_init");
       VLOG(4) << "Cast dtype (host fp32 -> mlu X).";
+      TraceSpan span("cast_in");
       castIn();  // init host data(copy to host_data).
     } else {
       flag_quant_mode_ = NO_QUANT;
       VLOG(4) << "Init data from prototxt.";
-      initHostData();  // read data to host_data directly
+      {
+        TraceSpan span("init_host_data");
+        initHostData();  // read data to host_data directly
+      }
       recordGtestTimePoint("after_init_host_data");
       VLOG(4) << "Set quant param to tensor descs.";
       setQuantizedParam();  // set quant param
     }
   }
   hostReorder();
+}
 
+void Executor::setupDevice() {
   VLOG(4) << "Device malloc.";
   setMiscellaneousParam();
-  deviceMalloc();
+  {
+    TraceSpan span("device_malloc");
+    deviceMalloc();
+  }
   recordGtestTimePoint("after_device_malloc");
   VLOG(4) << "Copy data from host to device.";
-  copyIn();
+  {
+    TraceSpan span("copy_in");
+    copyIn();
+  }
   recordGtestTimePoint("after_copy_in");
 
   VLOG(4) << "switch to origin data buffer.";
@@ -263,6 +301,7 @@ void Executor::enableKernelTracing() {
 }
 
 void Executor::launch() {
+  TraceSpan span("launch");
   // for fusedOp, get layer by layer time
   if (need_compute_by_layer_) {
     launchAndGetTime(BY_LAYER, repeat_val_1);
@@ -305,6 +344,7 @@ bool Executor::ready() {
 }
 
 void Executor::sync() {
+  TraceSpan span("sync");
   GTEST_CHECK(cnrtSuccess == cnrtQueueSync(exe_context_->queue));
   recordGtestTimePoint("after_sync");
 }
@@ -594,17 +634,28 @@ void Executor::getTestInfo() {
 }
 
 void Executor::postProcessAfterLaunch() {
+  if (postProcessDevice()) {
+    computeBaseline();
+    processMluOutput();
+  }
+}
+
+// returns false if there is nothing left to do on host side.
+bool Executor::postProcessDevice() {
   // comupte for perf test
   const char *zero_element = std::getenv("MLUOP_GTEST_BUILD_ZERO_ELEMENT");
   if (zero_element != NULL) {
     std::string env_str = zero_element;
     int env_num = std::stoi(env_str);
     if (env_num == 1) {
-      return;
+      return false;
     }
   }
 
-  perfRepeat();
+  {
+    TraceSpan span("perf_repeat");
+    perfRepeat();
+  }
 
   VLOG(4) << "Device free (for workspace).";
   workspaceFree();
@@ -614,36 +665,53 @@ void Executor::postProcessAfterLaunch() {
   eva_res_.compute_completed = true;
 
   if (exe_config_->mlu_only) {
-    return;
+    return false;
   }
 
   // The rest steps are for computing diffs
   VLOG(4) << "Copy data from device to host.";
   // mlu_only should never get here as host space is not allocated
-  copyOut();
+  {
+    TraceSpan span("copy_out");
+    copyOut();
+  }
   recordGtestTimePoint("after_copy_out");
+  return true;
+}
 
+// cpu compute (or read in) the baseline output, after the launch as
+// cpuCompute() of some executors reads params set up by compute().
+void Executor::computeBaseline() {
   VLOG(4) << "Host malloc (for baseline output, fp32)";
-  baselineOutputMallocFunc(this);
+  {
+    TraceSpan span("host_malloc");
+    baselineOutputMallocFunc(this);
+  }
   if (parser_->device() == CPU) {
-    VLOG(4) << "Begin cpu compute.";
-    cpuCompute();
-    // if out dtype is half, cast cpu data from float to half to float,
-    // consistent with mlu.
-    castHalfOuput();
-    VLOG(4) << "End cpu compute.";
+    TraceSpan span("cpu_compute");
+    cpuComputeWithCache();
   } else {
     // baseline output
     VLOG(4) << "Read in baseline device outputs.";
+    TraceSpan span("read_baseline");
     getBaselineOutputFunc(this);  // read in baseline output
     recordGtestTimePoint("after_get_baseline_output");
   }
+}
 
+// cast the copied out mlu output to fp32 and get it ready for the diff.
+void Executor::processMluOutput() {
   VLOG(4) << "Host malloc (for mlu output, fp32).";
-  mluOutputMallocFunc(this);
+  {
+    TraceSpan span("host_malloc");
+    mluOutputMallocFunc(this);
+  }
   recordGtestTimePoint("after_mlu_output_malloc");
 
-  castOutFunc(this);
+  {
+    TraceSpan span("cast_out");
+    castOutFunc(this);
+  }
   recordGtestTimePoint("after_cast_out");
 
   diffPreprocess();
@@ -654,8 +722,69 @@ void Executor::postProcessAfterLaunch() {
   dumpOutputData();
 }
 
+// key of cpu baseline in BaselineCache, empty if it shouldn't be cached.
+// inputs are hashed as they are (instead of seeds in proto), so cases with
+// random data but without fixed seed always miss.
+std::string Executor::getBaselineCacheKey() {
+  if (!BaselineCache::getInstance()->enabled() || storage_dtype_ != FLOAT ||
+      cpuComputeVersion() < 0 || !mlu_need_host_data) {
+    return "";
+  }
+  BaselineHasher hasher;
+  hasher.update(eva_res_.op_name);
+  hasher.update(cpuComputeVersion());
+  hasher.update(parser_->getProtoNode()->SerializeAsString());
+  hasher.update((int64_t)getFlagHalfInfTo65504());
+  hasher.update((int64_t)global_var.half2float_algo_);
+  for (size_t i = 0; i < cpu_fp32_input_.size(); ++i) {
+    MetaTensor *ts = parser_->input(i);
+    if (cpu_fp32_input_[i] == nullptr) {
+      hasher.update((int64_t)-1);
+      continue;
+    }
+    hasher.update(cpu_fp32_input_[i],
+                  ts->total_count *
+                      mluop::getSizeOfDataType(getCpuDtype(ts->dtype)));
+  }
+  return hasher.hexDigest();
+}
+
+// cpu_fp32_output_ and their bytes, as malloced by baselineOutputMalloc().
+std::vector<std::pair<void *, size_t>> Executor::getBaselineOutputBuffers() {
+  std::vector<std::pair<void *, size_t>> outputs;
+  for (size_t i = 0; i < cpu_fp32_output_.size(); ++i) {
+    MetaTensor *ts = parser_->output(i);
+    size_t bytes = cpu_fp32_output_[i] == nullptr
+                       ? 0
+                       : ts->shape_count * mluop::getSizeOfDataType(
+                                               getCpuDtype(ts->dtype));
+    outputs.emplace_back(cpu_fp32_output_[i], bytes);
+  }
+  return outputs;
+}
+
+void Executor::cpuComputeWithCache() {
+  // inputs may be modified by cpuCompute, get key before it.
+  std::string key = getBaselineCacheKey();
+  auto cache = BaselineCache::getInstance();
+  if (!key.empty() && cache->load(key, getBaselineOutputBuffers())) {
+    VLOG(4) << "Read cpu baseline from cache " << key;
+    return;
+  }
+  VLOG(4) << "Begin cpu compute.";
+  cpuCompute();
+  // if out dtype is half, cast cpu data from float to half to float,
+  // consistent with mlu.
+  castHalfOuput();
+  VLOG(4) << "End cpu compute.";
+  if (!key.empty()) {
+    cache->store(key, getBaselineOutputBuffers());
+  }
+}
+
 // you should modify eva_res_.is_passed only in this function
 void Executor::getAllTestResult() {
+  TraceSpan span("compare");
   // 1.check baseline
   bool baseline_check = true;
   if (exe_config_->perf_baseline) {
@@ -697,6 +826,10 @@ void Executor::getAllTestResult() {
 
 EvaluateResult Executor::teardown() {
   postProcessAfterLaunch();
+  return evaluate();
+}
+
+EvaluateResult Executor::evaluate() {
   getAllTestResult();
   getTestInfo();
   return eva_res_;
@@ -805,6 +938,11 @@ void Executor::getGtestInternalInfo() {
   }
   eva_res_.gtest.parsed_file_size = parser_->getParsedFileSize();
   eva_res_.gtest.parsed_cost_seconds = parser_->getParsedCostSeconds();
+  const auto &host_stats = cpu_runtime_.getStats();
+  eva_res_.gtest.host_alloc_num = host_stats.alloc_num;
+  eva_res_.gtest.host_reused_num = host_stats.reused_num;
+  eva_res_.gtest.host_peak_bytes = host_stats.peak_bytes;
+  eva_res_.gtest.proc_rss_peak = proc_rss_peak();
   global_var.internal_info_.record_case(eva_res_.case_path, eva_res_.gtest);
 }
 
@@ -821,13 +959,15 @@ bool Executor::checkAccuracyBaseline() {
   double threshold = 0;
   in_white_list = getAccuracyThreshold(eva_res_.op_name, &threshold);
   if (!in_white_list) {
-    auto search = acc_baseline_map.find(case_name);
-    if (search != acc_baseline_map.end()) {
+    BaselineRecord record;
+    if (BaselineIndex::getAccuracyInstance()->find(case_name, &record)) {
+      std::vector<double> base_errors(record.errors,
+                                      record.errors + record.error_num);
       std::vector<double> errors;
       for (const auto &error : eva_res_.errors) {
         errors.push_back(error.error);
       }
-      accuracy_check = checkAccuracyBaselineStrategy(case_name, search->second,
+      accuracy_check = checkAccuracyBaselineStrategy(case_name, base_errors,
                                                      errors, threshold);
     } else {
       LOG(INFO) << "[Accuracy Baseline:" << case_name
@@ -867,7 +1007,8 @@ bool Executor::checkBaseline() {
     hw_time_base = hw_time_mean;
   } else {  // check baseline data in xml file
     std::string case_name = getTestCaseName(eva_res_.case_path);
-    is_get_base_data = getTxtData(case_name, &hw_time_base, &workspace_size);
+    is_get_base_data =
+        getBaselineData(case_name, &hw_time_base, &workspace_size);
     if (is_get_base_data) {
       LOG(INFO) << "[Baseline:" << case_name
                 << "]:hardware time of baseline is " << hw_time_base
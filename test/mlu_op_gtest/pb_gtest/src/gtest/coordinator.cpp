@@ -0,0 +1,971 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "coordinator.h"
+#include "case_collector.h"
+#include "json.h"
+#include "variable.h"
+#include "src/gtest-internal-inl.h"
+
+namespace mluoptest {
+
+namespace {
+
+const char kResultFdEnv[] = "MLUOP_GTEST_RESULT_FD";
+const char kTraceFileEnv[] = "MLUOP_GTEST_TRACE_FILE";
+const char kSuiteSuffix[] = "/TestSuite";
+
+// write end of the event pipe in a worker, -1 in other processes.
+int result_fd = -1;
+
+void sendEvent(const std::string &line) {
+  static std::mutex mtx;
+  const int fd = result_fd;
+  if (fd < 0) {
+    return;
+  }
+  // one write() per line, under the lock, so lines of threads never mix.
+  std::lock_guard<std::mutex> lk(mtx);
+  const char *data = line.data();
+  size_t left = line.size();
+  while (left > 0) {
+    ssize_t n = write(fd, data, left);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    data += n;
+    left -= n;
+  }
+}
+
+bool startsWith(const std::string &str, const std::string &prefix) {
+  return str.compare(0, prefix.size(), prefix) == 0;
+}
+
+std::string formatSeconds(double seconds) {
+  std::ostringstream oss;
+  oss << seconds;
+  return oss.str();
+}
+
+std::string escapeXml(const std::string &str) {
+  std::string res;
+  for (char c : str) {
+    switch (c) {
+      case '<': res += "&lt;"; break;
+      case '>': res += "&gt;"; break;
+      case '&': res += "&amp;"; break;
+      case '"': res += "&quot;"; break;
+      default: res += c;
+    }
+  }
+  return res;
+}
+
+std::string trimSpace(const std::string &str) {
+  const char *kSpace = " \t\r\n";
+  size_t begin = str.find_first_not_of(kSpace);
+  if (begin == std::string::npos) {
+    return "";
+  }
+  return str.substr(begin, str.find_last_not_of(kSpace) - begin + 1);
+}
+
+// position of the first tag at or after pos that is not in a CDATA section
+// (failure messages may quote anything), npos if there is none.
+size_t findXmlTag(const std::string &doc, const std::string &tag, size_t pos) {
+  while (pos < doc.size()) {
+    size_t found = doc.find(tag, pos);
+    size_t cdata = doc.find("<![CDATA[", pos);
+    if (found == std::string::npos || cdata == std::string::npos ||
+        found < cdata) {
+      return found;
+    }
+    pos = doc.find("]]>", cdata);
+    if (pos == std::string::npos) {
+      return pos;
+    }
+    pos += 3;
+  }
+  return std::string::npos;
+}
+
+// position of the next start tag of element name, e.g. <testsuite ...> but
+// not <testsuites ...> for "testsuite".
+size_t findXmlElement(const std::string &doc, const std::string &name,
+                      size_t pos) {
+  const std::string open = "<" + name;
+  while ((pos = findXmlTag(doc, open, pos)) != std::string::npos) {
+    size_t next = pos + open.size();
+    if (next < doc.size() && (isspace(doc[next]) || doc[next] == '>' ||
+                              doc[next] == '/')) {
+      return pos;
+    }
+    pos = next;
+  }
+  return pos;
+}
+
+// value of attribute name of the xml start tag, "" if there is none.
+std::string getXmlAttr(const std::string &line, const std::string &name) {
+  std::string key = " " + name + "=\"";
+  size_t begin = line.find(key);
+  if (begin == std::string::npos) {
+    return "";
+  }
+  begin += key.size();
+  size_t end = line.find('"', begin);
+  return end == std::string::npos ? "" : line.substr(begin, end - begin);
+}
+
+void setXmlAttr(std::string *line, const std::string &name,
+                const std::string &value) {
+  std::string key = " " + name + "=\"";
+  size_t begin = line->find(key);
+  if (begin == std::string::npos) {
+    return;
+  }
+  begin += key.size();
+  size_t end = line->find('"', begin);
+  if (end != std::string::npos) {
+    line->replace(begin, end - begin, value);
+  }
+}
+
+struct XmlSuite {
+  std::string head;        // the <testsuite ...> start tag
+  std::string properties;  // its <properties> element, if any
+  std::vector<std::string> testcases;  // content after the properties
+  int tests = 0;
+  int failures = 0;
+  int disabled = 0;
+  double time = 0;
+};
+
+// failure message of an outcome that is not "passed".
+std::string outcomeMessage(const CaseOutcome &outcome) {
+  std::string what = "failed.";
+  if (outcome.status == "crashed") {
+    what = "crashed its worker process.";
+  } else if (outcome.status == "timeout") {
+    what = "timed out, its worker process was killed.";
+  }
+  return "MLUOPGTEST: " + outcome.case_path + " " + what;
+}
+
+}  // namespace
+
+void initCaseReporter() {
+  result_fd = getEnvInt(kResultFdEnv, -1);
+  if (result_fd < 0) {
+    return;
+  }
+  // processes the cases start must not inherit the pipe, the coordinator
+  // takes its end of file as the exit of this worker.
+  fcntl(result_fd, F_SETFD, FD_CLOEXEC);
+  unsetenv(kResultFdEnv);
+}
+
+void reportCaseStart(const std::string &case_path) {
+  sendEvent("start " + case_path + "\n");
+}
+
+void reportCaseEnd(const std::string &case_path, bool passed) {
+  sendEvent(std::string("end ") + (passed ? "passed " : "failed ") +
+            case_path + "\n");
+}
+
+std::string mergeXmlReports(const std::vector<std::string> &reports,
+                            const std::vector<CaseOutcome> &outcomes,
+                            double elapsed_seconds) {
+  std::string head;
+  std::vector<std::string> order;
+  std::map<std::string, XmlSuite> suites;
+  // reports are split on element boundaries, whatever their layout.
+  for (const auto &report : reports) {
+    size_t pos = findXmlElement(report, "testsuites", 0);
+    size_t head_end =
+        pos == std::string::npos ? pos : report.find('>', pos);
+    if (head_end == std::string::npos) {
+      LOG(ERROR) << "Skip an xml report of worker without <testsuites>.";
+      continue;
+    }
+    if (head.empty()) {
+      head = report.substr(pos, head_end - pos + 1);
+    }
+    pos = head_end + 1;
+    while ((pos = findXmlElement(report, "testsuite", pos)) !=
+           std::string::npos) {
+      head_end = report.find('>', pos);
+      if (head_end == std::string::npos) {
+        break;
+      }
+      std::string suite_head = report.substr(pos, head_end - pos + 1);
+      std::string body;
+      pos = head_end + 1;
+      if (suite_head[suite_head.size() - 2] == '/') {
+        suite_head.erase(suite_head.size() - 2, 1);  // <testsuite ... />
+      } else {
+        size_t end = findXmlTag(report, "</testsuite>", pos);
+        if (end == std::string::npos) {
+          LOG(ERROR) << "Skip an unterminated <testsuite> of a worker.";
+          break;
+        }
+        body = trimSpace(report.substr(pos, end - pos));
+        pos = end + strlen("</testsuite>");
+      }
+
+      std::string name = getXmlAttr(suite_head, "name");
+      bool new_suite = suites.find(name) == suites.end();
+      XmlSuite &suite = suites[name];
+      if (new_suite) {
+        order.emplace_back(name);
+        suite.head = suite_head;
+      }
+      suite.tests += std::atoi(getXmlAttr(suite_head, "tests").c_str());
+      suite.failures += std::atoi(getXmlAttr(suite_head, "failures").c_str());
+      suite.disabled += std::atoi(getXmlAttr(suite_head, "disabled").c_str());
+      suite.time += std::atof(getXmlAttr(suite_head, "time").c_str());
+      // properties of the suite come before its first testcase, they are
+      // the same in every worker.
+      if (startsWith(body, "<properties>")) {
+        size_t end = findXmlTag(body, "</properties>", 0);
+        end = end == std::string::npos ? body.size()
+                                       : end + strlen("</properties>");
+        if (new_suite) {
+          suite.properties = body.substr(0, end);
+        }
+        body = trimSpace(body.substr(end));
+      }
+      if (!body.empty()) {
+        suite.testcases.emplace_back(body);
+      }
+    }
+  }
+
+  // cases of dead workers, one testcase each in the testsuite of their op.
+  std::string properties;
+  if (!order.empty()) {
+    properties = suites[order.front()].properties;
+  }
+  for (const auto &outcome : outcomes) {
+    std::string name = outcome.op_name + kSuiteSuffix;
+    if (suites.find(name) == suites.end()) {
+      order.emplace_back(name);
+      suites[name].head = "<testsuite name=\"" + escapeXml(name) +
+                          "\" tests=\"0\" failures=\"0\" disabled=\"0\" "
+                          "errors=\"0\" time=\"0\">";
+      suites[name].properties = properties;
+    }
+    XmlSuite &suite = suites[name];
+    bool passed = outcome.status == "passed";
+    suite.tests++;
+    suite.failures += passed ? 0 : 1;
+    std::string testcase =
+        "<testcase name=\"mluOp/" + outcome.status + "\" value_param=\"" +
+        escapeXml(outcome.case_path) +
+        "\" status=\"run\" time=\"0\" classname=\"" + escapeXml(name) +
+        "\">\n";
+    if (!passed) {
+      testcase += "      <failure message=\"" +
+                  escapeXml(outcomeMessage(outcome)) +
+                  "\" type=\"\"><![CDATA[" + outcomeMessage(outcome) +
+                  "]]></failure>\n";
+    }
+    testcase += "      <properties>\n"
+                "        <property name=\"case_path\" value=\"" +
+                escapeXml(outcome.case_path) +
+                "\" />\n"
+                "      </properties>\n"
+                "    </testcase>";
+    suite.testcases.emplace_back(testcase);
+  }
+
+  int tests = 0, failures = 0, disabled = 0;
+  std::ostringstream out;
+  for (const auto &name : order) {
+    XmlSuite &suite = suites[name];
+    tests += suite.tests;
+    failures += suite.failures;
+    disabled += suite.disabled;
+    setXmlAttr(&suite.head, "tests", std::to_string(suite.tests));
+    setXmlAttr(&suite.head, "failures", std::to_string(suite.failures));
+    setXmlAttr(&suite.head, "disabled", std::to_string(suite.disabled));
+    setXmlAttr(&suite.head, "time", formatSeconds(suite.time));
+    out << "  " << suite.head << "\n";
+    if (!suite.properties.empty()) {
+      out << "    " << suite.properties << "\n";
+    }
+    for (const auto &content : suite.testcases) {
+      out << "    " << content << "\n";
+    }
+    out << "  </testsuite>\n";
+  }
+  if (head.empty()) {
+    head =
+        "<testsuites tests=\"0\" failures=\"0\" disabled=\"0\" errors=\"0\" "
+        "time=\"0\" name=\"AllTests\">";
+  }
+  setXmlAttr(&head, "tests", std::to_string(tests));
+  setXmlAttr(&head, "failures", std::to_string(failures));
+  setXmlAttr(&head, "disabled", std::to_string(disabled));
+  setXmlAttr(&head, "time", formatSeconds(elapsed_seconds));
+  return "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" + head + "\n" +
+         out.str() + "</testsuites>\n";
+}
+
+std::string mergeJsonReports(const std::vector<std::string> &reports,
+                             const std::vector<CaseOutcome> &outcomes,
+                             double elapsed_seconds) {
+  Json::Value root(Json::objectValue);
+  std::vector<std::string> order;
+  std::map<std::string, Json::Value> suites;
+  auto addTime = [](Json::Value *obj, double seconds) {
+    double sum = std::atof((*obj)["time"].asString().c_str()) + seconds;
+    (*obj)["time"] = formatSeconds(sum) + "s";
+  };
+  for (const auto &report : reports) {
+    Json::Value worker;
+    Json::CharReaderBuilder build;
+    std::string errs;
+    std::istringstream in(report);
+    if (!Json::parseFromStream(build, in, &worker, &errs)) {
+      LOG(ERROR) << "Skip a json report of worker: " << errs;
+      continue;
+    }
+    if (root.empty()) {
+      root = worker;
+      root.removeMember("testsuites");
+    }
+    for (const auto &src : worker["testsuites"]) {
+      std::string name = src["name"].asString();
+      if (suites.find(name) == suites.end()) {
+        order.emplace_back(name);
+        suites[name] = src;
+        continue;
+      }
+      Json::Value &dst = suites[name];
+      for (const char *key : {"tests", "failures", "disabled", "errors"}) {
+        dst[key] = dst[key].asInt() + src[key].asInt();
+      }
+      addTime(&dst, std::atof(src["time"].asString().c_str()));
+      for (const auto &testcase : src["testsuite"]) {
+        dst["testsuite"].append(testcase);
+      }
+    }
+  }
+
+  for (const auto &outcome : outcomes) {
+    std::string name = outcome.op_name + kSuiteSuffix;
+    if (suites.find(name) == suites.end()) {
+      order.emplace_back(name);
+      Json::Value suite(Json::objectValue);
+      suite["name"] = name;
+      suite["tests"] = suite["failures"] = suite["disabled"] =
+          suite["errors"] = 0;
+      suite["time"] = "0s";
+      suite["testsuite"] = Json::Value(Json::arrayValue);
+      suites[name] = suite;
+    }
+    Json::Value &suite = suites[name];
+    bool passed = outcome.status == "passed";
+    Json::Value testcase(Json::objectValue);
+    testcase["name"] = "mluOp/" + outcome.status;
+    testcase["value_param"] = outcome.case_path;
+    testcase["status"] = "RUN";
+    testcase["time"] = "0s";
+    testcase["classname"] = name;
+    testcase["case_path"] = outcome.case_path;
+    if (!passed) {
+      Json::Value failure(Json::objectValue);
+      failure["failure"] = outcomeMessage(outcome);
+      failure["type"] = "";
+      testcase["failures"].append(failure);
+    }
+    suite["tests"] = suite["tests"].asInt() + 1;
+    suite["failures"] = suite["failures"].asInt() + (passed ? 0 : 1);
+    suite["testsuite"].append(testcase);
+  }
+
+  int tests = 0, failures = 0, disabled = 0;
+  root["testsuites"] = Json::Value(Json::arrayValue);
+  for (const auto &name : order) {
+    const Json::Value &suite = suites[name];
+    tests += suite["tests"].asInt();
+    failures += suite["failures"].asInt();
+    disabled += suite["disabled"].asInt();
+    root["testsuites"].append(suite);
+  }
+  root["tests"] = tests;
+  root["failures"] = failures;
+  root["disabled"] = disabled;
+  root["errors"] = 0;
+  root["time"] = formatSeconds(elapsed_seconds) + "s";
+  root["name"] = "AllTests";
+  Json::StreamWriterBuilder writer;
+  writer["indentation"] = "  ";
+  return Json::writeString(writer, root) + "\n";
+}
+
+std::string mergeTraces(const std::vector<WorkerTrace> &traces) {
+  Json::Value root(Json::objectValue);
+  root["displayTimeUnit"] = "ms";
+  root["traceEvents"] = Json::Value(Json::arrayValue);
+  Json::Value &events = root["traceEvents"];
+  for (const auto &trace : traces) {
+    Json::Value worker;
+    Json::CharReaderBuilder build;
+    std::string errs;
+    std::istringstream in(trace.content);
+    if (!Json::parseFromStream(build, in, &worker, &errs)) {
+      LOG(ERROR) << "Skip the trace of worker " << trace.worker_id << ": "
+                 << errs;
+      continue;
+    }
+    bool named = false;
+    for (auto event : worker["traceEvents"]) {
+      if (!named) {
+        Json::Value name(Json::objectValue);
+        name["name"] = "process_name";
+        name["ph"] = "M";
+        name["pid"] = event["pid"];
+        name["args"]["name"] = "worker " + std::to_string(trace.worker_id);
+        events.append(name);
+        named = true;
+      }
+      if (event.isMember("ts")) {
+        event["ts"] = event["ts"].asDouble() + trace.start_us;
+      }
+      events.append(event);
+    }
+  }
+  Json::StreamWriterBuilder writer;
+  writer["indentation"] = "";
+  return Json::writeString(writer, root) + "\n";
+}
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// the cases one worker process runs.
+struct Job {
+  std::vector<std::string> cases;
+  int attempt = 0;  // > 0: a case run alone, after it died with others.
+};
+
+struct Worker {
+  pid_t pid = -1;
+  int fd = -1;  // read end of the pipe
+  Job job;
+  std::string report;   // its --gtest_output file, if any.
+  std::string partial;  // bytes of the event line not complete yet.
+  std::map<std::string, Clock::time_point> running;
+  std::set<std::string> done;
+  std::string timeout_case;  // killed because of this case.
+  Clock::time_point last_event = Clock::now();  // or its start
+  bool stalled = false;  // killed as it ran no case for too long.
+};
+
+class Coordinator {
+ public:
+  explicit Coordinator(const std::vector<std::string> &args) : args_(args) {}
+  int run();
+
+ private:
+  bool collect();
+  void spawn(const Job &job);
+  std::vector<std::string> workerArgs(const Job &job,
+                                      const std::string &list_file,
+                                      const std::string &report) const;
+  bool readEvents(Worker *worker);
+  void checkTimeout(Worker *worker);
+  void onExit(Worker *worker, int status);
+  void giveUp(const std::string &case_path, const std::string &status);
+  bool writeReport(double elapsed_seconds);
+  void writeTrace();
+  void cleanup();
+
+  std::vector<std::string> args_;
+  std::string tmp_dir_;
+  std::string output_format_;
+  std::string trace_file_;  // MLUOP_GTEST_TRACE_FILE, empty if not set
+  Clock::time_point begin_;
+  std::vector<double> start_us_;  // when each worker was started
+  int crash_retry_ = 1;
+  int idle_timeout_ = 0;  // seconds a worker may run without any case
+  int job_id_ = 0;
+  std::vector<std::string> cases_;
+  std::map<std::string, std::string> op_of_case_;
+  std::deque<Job> jobs_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::string> reports_;  // files of workers that exited normally
+  std::map<std::string, std::string> status_;  // final status of each case
+  std::vector<CaseOutcome> outcomes_;  // cases whose report died with worker
+};
+
+// cases of every op the gtest_filter selects, in the order gtest runs ops.
+bool Coordinator::collect() {
+  const testing::UnitTest &unit_test = *testing::UnitTest::GetInstance();
+  for (int i = 0; i < unit_test.total_test_case_count(); ++i) {
+    const testing::TestCase *test_case = unit_test.GetTestCase(i);
+    std::string name = test_case->name();
+    size_t pos = name.rfind(kSuiteSuffix);
+    if (pos == std::string::npos ||
+        pos + sizeof(kSuiteSuffix) - 1 != name.size()) {
+      continue;
+    }
+    bool selected = false;
+    for (int j = 0; j < test_case->total_test_count(); ++j) {
+      selected |= testing::internal::UnitTestOptions::FilterMatchesTest(
+          name, test_case->GetTestInfo(j)->name());
+    }
+    if (!selected) {
+      continue;
+    }
+    std::string op_name = name.substr(0, pos);
+    for (const auto &case_path : Collector(op_name).list()) {
+      if (op_of_case_.emplace(case_path, op_name).second) {
+        cases_.emplace_back(case_path);
+      }
+    }
+  }
+  return !cases_.empty();
+}
+
+std::vector<std::string> Coordinator::workerArgs(
+    const Job &job, const std::string &list_file,
+    const std::string &report) const {
+  // the coordinator picked the cases, the worker runs exactly its list.
+  static const char *kDropped[] = {
+      "--processes=",     "--case_timeout=",      "--cases_dir=",
+      "--cases_list=",    "--case_path=",         "--cases_include=",
+      "--cases_exclude=", "--cases_shard_index=", "--cases_shard_count=",
+      "--rand_n=",        "--gtest_filter=",      "--gtest_output="};
+  std::vector<std::string> args = {args_[0]};
+  for (size_t i = 1; i < args_.size(); ++i) {
+    bool dropped = false;
+    for (const char *prefix : kDropped) {
+      dropped |= startsWith(args_[i], prefix);
+    }
+    if (!dropped) {
+      args.emplace_back(args_[i]);
+    }
+  }
+  std::set<std::string> ops;
+  std::string filter;
+  for (const auto &case_path : job.cases) {
+    const std::string &op_name = op_of_case_.at(case_path);
+    if (ops.insert(op_name).second) {
+      filter += (filter.empty() ? "" : ":") + op_name + kSuiteSuffix + ".*";
+    }
+  }
+  args.emplace_back("--cases_list=" + list_file);
+  args.emplace_back("--gtest_filter=" + filter);
+  if (!report.empty()) {
+    args.emplace_back("--gtest_output=" + output_format_ + ":" + report);
+  }
+  return args;
+}
+
+void Coordinator::spawn(const Job &job) {
+  std::string id = std::to_string(job_id_++);
+  std::string list_file = tmp_dir_ + "/worker_" + id + ".list";
+  std::string report = output_format_.empty()
+                           ? ""
+                           : tmp_dir_ + "/worker_" + id + "." + output_format_;
+  // workers would overwrite each other's trace, each one gets its own file.
+  std::string trace =
+      trace_file_.empty() ? "" : tmp_dir_ + "/worker_" + id + ".trace.json";
+  start_us_.emplace_back(
+      std::chrono::duration<double, std::micro>(Clock::now() - begin_)
+          .count());
+  std::ofstream list(list_file);
+  for (const auto &case_path : job.cases) {
+    list << case_path << "\n";
+  }
+  list.close();
+  std::vector<std::string> args = workerArgs(job, list_file, report);
+
+  int fds[2];
+  pid_t pid = -1;
+  if (pipe(fds) == 0) {
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    pid = fork();
+    if (pid < 0) {
+      close(fds[0]);
+      close(fds[1]);
+    }
+  }
+  if (pid < 0) {
+    LOG(ERROR) << "Failed to start a worker process: " << strerror(errno);
+    for (const auto &case_path : job.cases) {
+      giveUp(case_path, "crashed");
+    }
+    return;
+  }
+  if (pid == 0) {
+    close(fds[0]);
+    setenv(kResultFdEnv, std::to_string(fds[1]).c_str(), 1);
+    // shards are picked by the coordinator, not by gtest.
+    unsetenv("GTEST_TOTAL_SHARDS");
+    unsetenv("GTEST_SHARD_INDEX");
+    if (!trace.empty()) {
+      setenv(kTraceFileEnv, trace.c_str(), 1);
+    }
+    std::vector<char *> argv;
+    for (auto &arg : args) {
+      argv.emplace_back(const_cast<char *>(arg.c_str()));
+    }
+    argv.emplace_back(nullptr);
+    execv("/proc/self/exe", argv.data());
+    _exit(127);
+  }
+  close(fds[1]);
+  std::unique_ptr<Worker> worker(new Worker);
+  worker->pid = pid;
+  worker->fd = fds[0];
+  worker->job = job;
+  worker->report = report;
+  workers_.emplace_back(std::move(worker));
+}
+
+// false when the worker closed its pipe, i.e. it exited.
+bool Coordinator::readEvents(Worker *worker) {
+  char buffer[4096];
+  ssize_t n = read(worker->fd, buffer, sizeof(buffer));
+  if (n < 0) {
+    return errno == EINTR || errno == EAGAIN;
+  }
+  if (n == 0) {
+    return false;
+  }
+  worker->partial.append(buffer, n);
+  size_t pos;
+  while ((pos = worker->partial.find('\n')) != std::string::npos) {
+    std::string line = worker->partial.substr(0, pos);
+    worker->partial.erase(0, pos + 1);
+    worker->last_event = Clock::now();
+    if (startsWith(line, "start ")) {
+      worker->running[line.substr(6)] = Clock::now();
+    } else if (startsWith(line, "end passed ") ||
+               startsWith(line, "end failed ")) {
+      std::string case_path = line.substr(11);
+      worker->running.erase(case_path);
+      worker->done.insert(case_path);
+      status_[case_path] = line.substr(4, 6);
+    }
+  }
+  return true;
+}
+
+void Coordinator::checkTimeout(Worker *worker) {
+  if (!worker->timeout_case.empty() || worker->stalled) {
+    return;
+  }
+  // between cases: starting up, loading the next case or exiting.
+  if (idle_timeout_ > 0 && worker->running.empty() &&
+      Clock::now() - worker->last_event >
+          std::chrono::seconds(idle_timeout_)) {
+    LOG(WARNING) << "Kill worker " << worker->pid << ", no case runs for "
+                 << idle_timeout_ << "s.";
+    worker->stalled = true;
+    kill(worker->pid, SIGKILL);
+    return;
+  }
+  if (global_var.case_timeout_ <= 0) {
+    return;
+  }
+  auto limit = std::chrono::seconds(global_var.case_timeout_);
+  for (const auto &it : worker->running) {
+    if (Clock::now() - it.second > limit) {
+      LOG(WARNING) << "Kill worker " << worker->pid << ", " << it.first
+                   << " runs longer than " << global_var.case_timeout_
+                   << "s.";
+      worker->timeout_case = it.first;
+      kill(worker->pid, SIGKILL);
+      return;
+    }
+  }
+}
+
+void Coordinator::giveUp(const std::string &case_path,
+                         const std::string &status) {
+  status_[case_path] = status;
+  outcomes_.push_back({op_of_case_[case_path], case_path, status});
+}
+
+void Coordinator::onExit(Worker *worker, int status) {
+  bool normal = WIFEXITED(status) &&
+                (WEXITSTATUS(status) == 0 || WEXITSTATUS(status) == 1) &&
+                worker->running.empty();
+  if (normal) {
+    if (!worker->report.empty() && access(worker->report.c_str(), F_OK) == 0) {
+      reports_.emplace_back(worker->report);
+    }
+    return;
+  }
+  std::ostringstream reason;
+  if (WIFSIGNALED(status)) {
+    reason << "was killed by signal " << WTERMSIG(status);
+  } else {
+    reason << "exited with " << WEXITSTATUS(status);
+  }
+  LOG(WARNING) << "Worker " << worker->pid << " " << reason.str() << " with "
+               << worker->running.size() << " case(s) running, "
+               << worker->done.size() << " done.";
+
+  // its report is lost, keep what the pipe told about the finished cases.
+  for (const auto &case_path : worker->done) {
+    outcomes_.push_back(
+        {op_of_case_[case_path], case_path, status_[case_path]});
+  }
+  // one of the running cases killed it, run each alone to find out which.
+  for (const auto &it : worker->running) {
+    const std::string &case_path = it.first;
+    if (worker->job.attempt < crash_retry_) {
+      Job job;
+      job.cases = {case_path};
+      job.attempt = worker->job.attempt + 1;
+      jobs_.push_back(job);
+    } else {
+      giveUp(case_path,
+             case_path == worker->timeout_case ? "timeout" : "crashed");
+    }
+  }
+  Job rest;
+  for (const auto &case_path : worker->job.cases) {
+    if (worker->done.count(case_path) == 0 &&
+        worker->running.count(case_path) == 0) {
+      rest.cases.emplace_back(case_path);
+    }
+  }
+  if (rest.cases.empty()) {
+    return;
+  }
+  if (worker->done.empty() && worker->running.empty()) {
+    // it died before any case, another worker would most likely too.
+    LOG(ERROR) << "Worker " << worker->pid << " " << reason.str()
+               << " before running any case.";
+    for (const auto &case_path : rest.cases) {
+      giveUp(case_path, worker->stalled ? "timeout" : "crashed");
+    }
+  } else {
+    jobs_.push_front(rest);
+  }
+}
+
+bool Coordinator::writeReport(double elapsed_seconds) {
+  std::vector<std::string> reports;
+  for (const auto &file : reports_) {
+    std::ifstream in(file);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    reports.emplace_back(ss.str());
+  }
+  std::string merged =
+      output_format_ == "xml"
+          ? mergeXmlReports(reports, outcomes_, elapsed_seconds)
+          : mergeJsonReports(reports, outcomes_, elapsed_seconds);
+  std::string output =
+      testing::internal::UnitTestOptions::GetAbsolutePathToOutputFile();
+  std::ofstream out(output);
+  out << merged;
+  if (!out) {
+    LOG(ERROR) << "Failed to write " << output << ".";
+    return false;
+  }
+  return true;
+}
+
+// traces of workers that got to their TearDown, crashed ones write none.
+void Coordinator::writeTrace() {
+  std::vector<WorkerTrace> traces;
+  for (int id = 0; id < job_id_; ++id) {
+    std::ifstream in(tmp_dir_ + "/worker_" + std::to_string(id) +
+                     ".trace.json");
+    if (!in) {
+      continue;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    traces.push_back({id, start_us_[id], ss.str()});
+  }
+  std::ofstream out(trace_file_);
+  out << mergeTraces(traces);
+  if (!out) {
+    LOG(WARNING) << "HostTrace: failed to write " << trace_file_
+                 << ", trace is not saved.";
+    return;
+  }
+  printf("[ COORDINATOR ] traces of %zu workers saved to %s\n",
+         traces.size(), trace_file_.c_str());
+}
+
+void Coordinator::cleanup() {
+  if (tmp_dir_.empty()) {
+    return;
+  }
+  for (int id = 0; id < job_id_; ++id) {
+    std::string prefix = tmp_dir_ + "/worker_" + std::to_string(id);
+    unlink((prefix + ".list").c_str());
+    if (!output_format_.empty()) {
+      unlink((prefix + "." + output_format_).c_str());
+    }
+    if (!trace_file_.empty()) {
+      unlink((prefix + ".trace.json").c_str());
+    }
+  }
+  rmdir(tmp_dir_.c_str());
+}
+
+int Coordinator::run() {
+  begin_ = Clock::now();
+  const char *trace_file = getenv(kTraceFileEnv);
+  trace_file_ = trace_file == nullptr ? "" : trace_file;
+  crash_retry_ = getEnvInt("MLUOP_GTEST_CRASH_RETRY", 1);
+  idle_timeout_ =
+      getEnvInt("MLUOP_GTEST_WORKER_IDLE_TIMEOUT", global_var.case_timeout_);
+  output_format_ = testing::internal::UnitTestOptions::GetOutputFormat();
+  if (output_format_ != "" && output_format_ != "xml" &&
+      output_format_ != "json") {
+    GTEST_LOG_(WARNING) << "WARNING: unrecognized output format \""
+                        << output_format_ << "\" ignored.";
+    output_format_ = "";
+  }
+  if (!collect()) {
+    LOG(WARNING) << "No cases found, nothing to run.";
+    return 0;
+  }
+  const char *tmp_root = getenv("TMPDIR");
+  std::string tmpl = std::string(tmp_root ? tmp_root : "/tmp") +
+                     "/mluop_gtest_XXXXXX";
+  if (mkdtemp(&tmpl[0]) == nullptr) {
+    LOG(ERROR) << "Failed to create " << tmpl << ": " << strerror(errno);
+    return EXIT_FAILURE_MLUOP;
+  }
+  tmp_dir_ = tmpl;
+
+  // deal cases round-robin, ops with many cases are spread over all workers.
+  size_t process_num = global_var.process_num_;
+  std::vector<Job> shards(std::min(process_num, cases_.size()));
+  for (size_t i = 0; i < cases_.size(); ++i) {
+    shards[i % shards.size()].cases.emplace_back(cases_[i]);
+  }
+  jobs_.assign(shards.begin(), shards.end());
+  printf("[ COORDINATOR ] %zu cases, %zu worker processes.\n", cases_.size(),
+         shards.size());
+
+  while (!jobs_.empty() || !workers_.empty()) {
+    while (!jobs_.empty() && workers_.size() < process_num) {
+      Job job = jobs_.front();
+      jobs_.pop_front();
+      spawn(job);
+    }
+    std::vector<pollfd> fds;
+    for (const auto &worker : workers_) {
+      fds.push_back({worker->fd, POLLIN, 0});
+    }
+    if (poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) {
+      LOG(ERROR) << "poll() failed: " << strerror(errno);
+      break;
+    }
+    std::vector<std::unique_ptr<Worker>> alive;
+    for (size_t i = 0; i < workers_.size(); ++i) {
+      Worker *worker = workers_[i].get();
+      if ((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) &&
+          !readEvents(worker)) {
+        close(worker->fd);
+        int status = 0;
+        while (waitpid(worker->pid, &status, 0) < 0 && errno == EINTR) {
+        }
+        onExit(worker, status);
+        continue;
+      }
+      checkTimeout(worker);
+      alive.emplace_back(std::move(workers_[i]));
+    }
+    workers_.swap(alive);
+  }
+
+  double elapsed =
+      std::chrono::duration<double>(Clock::now() - begin_).count();
+  bool report_ok = output_format_.empty() || writeReport(elapsed);
+  if (!trace_file_.empty()) {
+    writeTrace();
+  }
+  cleanup();
+
+  std::map<std::string, std::vector<std::string>> unpassed;
+  for (const auto &case_path : cases_) {
+    auto it = status_.find(case_path);
+    std::string status = it == status_.end() ? "not run" : it->second;
+    if (status != "passed") {
+      unpassed[status].emplace_back(case_path);
+    }
+  }
+  size_t unpassed_num = 0;
+  for (const auto &it : unpassed) {
+    unpassed_num += it.second.size();
+    for (const auto &case_path : it.second) {
+      printf("[ COORDINATOR ] %s: %s\n", it.first.c_str(), case_path.c_str());
+    }
+  }
+  printf("[ COORDINATOR ] %zu cases in %.3fs, %zu passed, %zu not passed.\n",
+         cases_.size(), elapsed, cases_.size() - unpassed_num, unpassed_num);
+  return unpassed_num == 0 && report_ok ? 0 : 1;
+}
+
+}  // namespace
+
+int runCoordinator(const std::vector<std::string> &args) {
+  Coordinator coordinator(args);
+  return coordinator.run();
+}
+
+}  // namespace mluoptest
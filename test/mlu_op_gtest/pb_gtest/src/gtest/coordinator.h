@@ -0,0 +1,90 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLU_OP_GTEST_SRC_GTEST_COORDINATOR_H_
+#define TEST_MLU_OP_GTEST_SRC_GTEST_COORDINATOR_H_
+
+#include <string>
+#include <vector>
+
+namespace mluoptest {
+
+// Multi-process mode, --processes=n.
+// The coordinator collects the cases of every op the gtest_filter selects,
+// deals them round-robin into n cases_lists and runs one worker process
+// (this binary with --cases_list=<its list>) per list. Each worker writes
+// one line per case event to a pipe:
+//   start <case_path>
+//   end <passed|failed> <case_path>
+// When a worker dies (crash, abnormal exit, or killed after --case_timeout
+// seconds on one case, or after MLUOP_GTEST_WORKER_IDLE_TIMEOUT seconds
+// without a running case), the cases it had not started go to a new worker and
+// each case it was running is run again alone, so the one that crashed is
+// found and the others still get a result. Reports the workers write with
+// --gtest_output are merged into the one asked for, and so are the traces
+// they write when MLUOP_GTEST_TRACE_FILE is set (each worker gets a file of
+// its own).
+
+// Called once at the start of main(), takes the event pipe if this process
+// is a worker.
+void initCaseReporter();
+
+// Called by the cases of a worker, nothing is sent if the process is not
+// a worker.
+void reportCaseStart(const std::string &case_path);
+void reportCaseEnd(const std::string &case_path, bool passed);
+
+// A case whose result is only known by the coordinator, as the worker that
+// ran it died before writing its report.
+struct CaseOutcome {
+  std::string op_name;
+  std::string case_path;
+  std::string status;  // "passed", "failed", "crashed" or "timeout"
+};
+
+// merge reports of workers, outcomes are added as testcases of their op.
+std::string mergeXmlReports(const std::vector<std::string> &reports,
+                            const std::vector<CaseOutcome> &outcomes,
+                            double elapsed_seconds);
+std::string mergeJsonReports(const std::vector<std::string> &reports,
+                             const std::vector<CaseOutcome> &outcomes,
+                             double elapsed_seconds);
+
+// Chrome trace written by the worker with id worker_id, which was started
+// start_us microseconds after the coordinator.
+struct WorkerTrace {
+  int worker_id;
+  double start_us;
+  std::string content;
+};
+
+// merge traces of workers into one, the process of each worker is named
+// "worker <id>" and its spans are shifted to the time of the coordinator.
+std::string mergeTraces(const std::vector<WorkerTrace> &traces);
+
+// args is the whole command line, as main() got it. Must be called after
+// InitGoogleTest(), returns the exit code of the gtest.
+int runCoordinator(const std::vector<std::string> &args);
+
+}  // namespace mluoptest
+
+#endif  // TEST_MLU_OP_GTEST_SRC_GTEST_COORDINATOR_H_
@@ -31,14 +31,18 @@
 #include <stdexcept>
 #include <utility>
 #include "mlu_op_gtest.h"
+#include "coordinator.h"
 #include "op_register.h"
 #include "internal_perf.h"
+#include "host_trace.h"
+#include "stage_pools.h"
 #include "gtest/mlu_op_test_case.h"
 
 extern mluoptest::GlobalVar mluoptest::global_var;
 using mluoptest::global_var;
 std::string TestSuite::op_name_ = "";  // NOLINT
 std::vector<std::string> TestSuite::case_path_vec_ = {};
+std::shared_ptr<mluoptest::CaseStream> TestSuite::case_stream_ = nullptr;
 std::shared_ptr<mluoptest::ExecuteConfig> TestSuite::ecfg_ =
     std::make_shared<mluoptest::ExecuteConfig>();
 std::shared_ptr<mluoptest::ExecuteContext> TestSuite::ectx_ =
@@ -50,11 +54,16 @@ void TestSuite::SetUpTestCase() {
   auto test_case = UnitTest::GetInstance()->current_test_case();
   auto case_name = std::string(test_case->name());
   op_name_ = case_name.substr(0, case_name.find_first_of("/"));
-  case_path_vec_ = Collector(op_name_).list();
 
   // record info.
   global_var.summary_.suite_count += 1;
-  global_var.summary_.case_count += case_path_vec_.size();
+  if (global_var.thread_num_ == 1) {
+    case_path_vec_ = Collector(op_name_).list();
+    global_var.summary_.case_count += case_path_vec_.size();
+  } else {
+    // cases are counted by ThreadX(), when they are all found.
+    case_stream_ = Collector(op_name_).stream();
+  }
 
   // exe config
   ecfg_->perf_repeat = global_var.repeat_;
@@ -92,6 +101,7 @@ void TestSuite::TearDownTestCase() {
 
   op_name_.clear();
   case_path_vec_.clear();
+  case_stream_.reset();
 }
 
 void TestSuite::TearDown() {
@@ -105,7 +115,9 @@ void TestSuite::TearDown() {
 void TestSuite::Thread1() {
   size_t case_idx = std::get<1>(GetParam());
   auto case_path = case_path_vec_[case_idx];
+  mluoptest::TraceSpan case_span("case", case_path);
   std::shared_ptr<mluoptest::Executor> exe = nullptr;
+  mluoptest::reportCaseStart(case_path);
   try {
     exe = getOpExecutor(op_name_);
 
@@ -116,15 +128,25 @@ void TestSuite::Thread1() {
     exe->launch();
     auto res = exe->teardown();
     res_.emplace_back(res);
+    bool passed = res.is_passed;
 
     if (global_var.get_vmpeak_ != "") {
       std::ofstream get_vmpeak_oss;
       get_vmpeak_oss.open(global_var.get_vmpeak_, std::ios::app);
+      // op|case|vm_peak|rss_peak|host_alloc_num|host_reused_num|host_peak
       get_vmpeak_oss << op_name_ << "|" << case_path_vec_[case_idx] << "|"
-                     << mluoptest::proc_usage_peak() << std::endl;
+                     << mluoptest::proc_usage_peak() << "|"
+                     << mluoptest::proc_rss_peak() << "|"
+                     << res.gtest.host_alloc_num << "|"
+                     << res.gtest.host_reused_num << "|"
+                     << res.gtest.host_peak_bytes << std::endl;
       get_vmpeak_oss.close();
     }
-    exe = nullptr;
+    {
+      mluoptest::TraceSpan span("teardown");
+      exe = nullptr;
+    }
+    mluoptest::reportCaseEnd(case_path, passed);
   } catch (std::exception &e) {
     ectx_->reset();
 
@@ -137,53 +159,14 @@ void TestSuite::Thread1() {
     res_.emplace_back(res);
     ADD_FAILURE() << "MLUOPGTEST: catched " << e.what()
                   << " in single thread mode. (of " << case_path << ")";
+    mluoptest::reportCaseEnd(case_path, false);
   }
 }
 
-// wrap a executor and it status flag
-// task buffer is a vector and each element is an ExecutorWrap.
-// when setup, set in_used as true, then setup(), then set exe.
-// when it's ready, set been_chosen as true, then teardown, then reset().
-struct ExecutorWrap {
-  ExecutorWrap() = default;
-  explicit ExecutorWrap(std::shared_ptr<mluoptest::Executor> e) : exe(e) {
-    in_used = true;
-  }
-
-  std::shared_ptr<mluoptest::Executor> exe = nullptr;
-  // flag for teardown polling and pick up.
-  // if 1 thread choose this exe, other thread shouldn't choose it.
-  bool been_chosen = false;
-  // flag for setup
-  // if 1 thread choose this exe, other thread shouldn't choose it.
-  bool in_used = false;
-
-  void used() { in_used = true; }
-  void set(std::shared_ptr<mluoptest::Executor> e) { exe = e; }
-  void reset() {
-    been_chosen = false;
-    in_used = false;
-    exe = nullptr;
-  }
-  bool is_free() { return !in_used; }
-  // ready means ready to teardown:
-  // exe is not null and not been chose by other thread and is ready.
-  bool ready() {
-    if (exe == nullptr) {
-      return false;
-    } else if (been_chosen == true) {
-      return false;
-    } else {
-      return exe->ready();  // kernel is done, is ready.
-    }
-  }
-};
-
 // wrap a executor context and it status flag
 // executor context encapsulates handle queue ... and anything can share.
-// ecw_vec is a vector and each element is an ExecuteContextWrap.
-// when setup, set in_used as true, then setup(), then set exe.
-// when it's ready, set been_chosen as true, then teardown, then reset().
+// each in-flight case borrows one ExecuteContextWrap from the free list of
+// Pipeline and gives it back when the case is reported.
 struct ExecuteContextWrap {
   std::shared_ptr<mluoptest::ExecuteContext> ectx = nullptr;
   void init() {
@@ -205,42 +188,115 @@ struct ExecuteContextWrap {
   void reset() { ectx->reset(); }
 };
 
-struct Context {
-  explicit Context(size_t buffer_num) {
-    ecw_vec.resize(buffer_num);
-    exe_vec.resize(buffer_num);
+// one case flowing through the pipeline.
+struct CaseSlot {
+  std::string op_name;
+  std::string case_path;
+  std::shared_ptr<ExecuteContextWrap> ecw = nullptr;
+  std::shared_ptr<mluoptest::Executor> exe = nullptr;
+};
+
+// set device for each worker thread, once.
+static void setWorkerDevice() {
+  static thread_local bool been_initialized = false;
+  if (!been_initialized) {
+    ASSERT_EQ(cnrtSetDevice(global_var.dev_id_), cnrtSuccess);
+    been_initialized = true;
+  }
+}
+
+// Each case goes through the stages of StagePools, each stage enqueues the
+// next stage of the same case when it is done:
+//   parse -> prepare -> device -> baseline -> compare -> report
+// so the parse, input data, cpu baseline and diff of some cases overlap the
+// kernels of the others instead of every worker running setup -> launch ->
+// teardown back to back. The baseline follows the device stage as cpuCompute()
+// of some executors reads params set up by compute().
+// The number of in-flight cases is bounded by the number of execute contexts.
+struct Pipeline {
+  explicit Pipeline(size_t thread_num) {
+    ecw_vec.resize(thread_num * 2);
     for (auto it = ecw_vec.begin(); it != ecw_vec.end(); ++it) {
       (*it) = std::make_shared<ExecuteContextWrap>();
     }
-    for (auto it = exe_vec.begin(); it != exe_vec.end(); ++it) {
-      (*it) = std::make_shared<ExecutorWrap>();
+    free_ecw = ecw_vec;
+    // every context has its own queue, unless they share the default one.
+    size_t queue_num = global_var.use_default_queue_ ? 1 : ecw_vec.size();
+    pools = std::make_shared<mluoptest::StagePools>(thread_num, queue_num);
+  }
+
+  // block until an execute context is free.
+  std::shared_ptr<ExecuteContextWrap> acquire() {
+    std::unique_lock<std::mutex> lk(mtx);
+    cond.wait(lk, [this]() { return !free_ecw.empty(); });
+    auto ecw = free_ecw.back();
+    free_ecw.pop_back();
+    return ecw;
+  }
+
+  // report stage: case is done, save result and give its execute context
+  // back.
+  void finish(std::shared_ptr<CaseSlot> slot,
+              const mluoptest::EvaluateResult &res) {
+    setWorkerDevice();
+    printf("[ TEARDOWN ]: %s\n",
+           res.case_path.c_str());  // printf is thread-safe
+    {
+      mluoptest::TraceSpan span("teardown");
+      slot->exe.reset();  // free this exe.
+    }
+    mluoptest::reportCaseEnd(slot->case_path, res.is_passed);
+    {
+      std::lock_guard<std::mutex> lk(mtx);
+      results.emplace_back(res);
+      free_ecw.emplace_back(slot->ecw);
+      finished++;
     }
+    cond.notify_all();
+  }
+
+  // the report stage of a failed case follows right away.
+  void fail(std::shared_ptr<CaseSlot> slot, const char *stage,
+            const std::exception &e) {
+    slot->ecw->reset();  // reset running env
+
+    mluoptest::EvaluateResult res;
+    if (slot->exe) res = *(slot->exe->result());
+    res.op_name = slot->op_name;
+    res.case_path = slot->case_path;
+    res.what.emplace_back(
+        "Unknown error: maybe exception raised, other info is lost.");
+    ADD_FAILURE() << "MLUOPGTEST: catched " << e.what() << " in " << stage
+                  << ". (of " << slot->case_path
+                  << ") tid: " << std::this_thread::get_id();
+    pools->enqueue(mluoptest::STAGE_REPORT, &Pipeline::finish, this, slot,
+                   res);
+  }
+
+  void wait(size_t case_num) {
+    std::unique_lock<std::mutex> lk(mtx);
+    cond.wait(lk, [=]() { return finished == case_num; });
   }
 
   void destroy() {
-    exe_vec.clear();
+    // join thread pools before freeing the contexts they may still touch.
+    pools.reset();
     for (auto it = ecw_vec.begin(); it != ecw_vec.end(); ++it) {
       // free each context (handle queue .. in it)
       (*it)->destroy();
     }
+    free_ecw.clear();
     results.clear();
   }
 
-  std::mutex mtx;  // modify anything, remember lock it by this mtx.
+  std::mutex mtx;  // guard free_ecw, results and finished.
   std::condition_variable cond;
-
-  // 1 to 1 corresponding
-  // exe_vec saved executor
-  // and ecw_vec saved context for executor.
-  // their size is same, and exe_vec[0] will use context in ecw_vec[0]
   std::vector<std::shared_ptr<ExecuteContextWrap>> ecw_vec;
-  // this is so-called task queue, but kernel's latency is not same,
-  // so it is not fifo. so use vector.
-  std::vector<std::shared_ptr<ExecutorWrap>> exe_vec;
-
+  std::vector<std::shared_ptr<ExecuteContextWrap>> free_ecw;
   std::list<mluoptest::EvaluateResult> results;
-  // set current device for all thread.
-  std::set<std::thread::id, std::greater<std::thread::id>> been_initialized;
+  size_t finished = 0;
+
+  std::shared_ptr<mluoptest::StagePools> pools;
 };
 
 void TestSuite::ThreadX() {
@@ -251,178 +307,119 @@ void TestSuite::ThreadX() {
   // we may need to write new thread model.
   ASSERT_EQ(cnrtSetDevice(global_var.dev_id_), cnrtSuccess);
 
-  size_t thread_num = global_var.thread_num_;
-  size_t max_exe_vec_num = thread_num * 1.5;
-  auto thread_pool = std::make_shared<mluoptest::ThreadPool>(thread_num);
-  auto context = std::make_shared<Context>(max_exe_vec_num);
-
-  // set device for each thread.
-  auto set_device = [](std::shared_ptr<Context> ctx) {
-    std::lock_guard<std::mutex> lk(ctx->mtx);
-    auto it = ctx->been_initialized.find(std::this_thread::get_id());
-    if (it == ctx->been_initialized
-                  .end()) {  // if current thread has not been set device.
-      ASSERT_EQ(cnrtSetDevice(global_var.dev_id_), cnrtSuccess);
-      ctx->been_initialized.insert(std::this_thread::get_id());
+  auto compare = [=](std::shared_ptr<Pipeline> pl,
+                     std::shared_ptr<CaseSlot> slot, bool need_host) {
+    setWorkerDevice();
+    mluoptest::TraceSpan span("compare", slot->case_path);
+    mluoptest::EvaluateResult res;
+    try {
+      if (need_host) {
+        slot->exe->processMluOutput();
+      }
+      res = slot->exe->evaluate();
+    } catch (std::exception &e) {
+      pl->fail(slot, "compare", e);
+      return;
     }
+    pl->pools->enqueue(mluoptest::STAGE_REPORT, &Pipeline::finish, pl, slot,
+                       res);
   };
 
-  // find executor that is done
-  auto has_done = [](std::shared_ptr<Context> ctx) -> bool {
-    auto it =
-        find_if(ctx->exe_vec.begin(), ctx->exe_vec.end(),
-                [](std::shared_ptr<ExecutorWrap> ew) { return ew->ready(); });
-    if (it != ctx->exe_vec.end()) {
-      return true;
-    } else {
-      return false;
+  auto baseline = [=](std::shared_ptr<Pipeline> pl,
+                      std::shared_ptr<CaseSlot> slot) {
+    setWorkerDevice();
+    mluoptest::TraceSpan span("baseline", slot->case_path);
+    try {
+      slot->exe->computeBaseline();
+    } catch (std::exception &e) {
+      pl->fail(slot, "baseline", e);
+      return;
     }
+    pl->pools->enqueue(mluoptest::STAGE_COMPARE, compare, pl, slot, true);
   };
 
-  // return unique item.
-  // buffer is thread num * 1.5 wont exceed int64_t
-  auto any_done = [](std::shared_ptr<Context> ctx) -> int64_t {
-    std::lock_guard<std::mutex> lk(ctx->mtx);
-    auto it =
-        find_if(ctx->exe_vec.begin(), ctx->exe_vec.end(),
-                [](std::shared_ptr<ExecutorWrap> ew) { return ew->ready(); });
-    if (it != ctx->exe_vec.end()) {
-      (*it)->been_chosen = true;
-      // mark this exe been chosen, and other thread shouldn't choose it.
-      return std::distance(ctx->exe_vec.begin(), it);
+  // launch and sync in the same thread, so it also works with default queue.
+  auto device = [=](std::shared_ptr<Pipeline> pl,
+                    std::shared_ptr<CaseSlot> slot) {
+    setWorkerDevice();
+    mluoptest::TraceSpan span("device", slot->case_path);
+    bool need_host = false;
+    try {
+      slot->exe->setupDevice();
+      slot->exe->launch();
+      slot->exe->sync();
+      need_host = slot->exe->postProcessDevice();
+    } catch (std::exception &e) {
+      pl->fail(slot, "launch", e);
+      return;
+    }
+    if (need_host) {
+      pl->pools->enqueue(mluoptest::STAGE_BASELINE, baseline, pl, slot);
     } else {
-      return -1;
+      pl->pools->enqueue(mluoptest::STAGE_COMPARE, compare, pl, slot, false);
     }
   };
 
-  auto teardown = [](size_t id, std::shared_ptr<Context> ctx) {
-    mluoptest::EvaluateResult res;
-    auto exe = ctx->exe_vec[id]->exe;
+  auto prepare = [=](std::shared_ptr<Pipeline> pl,
+                     std::shared_ptr<CaseSlot> slot) {
+    setWorkerDevice();
+    mluoptest::TraceSpan span("prepare", slot->case_path);
     try {
-      if (!global_var.use_default_queue_) {
-        // when we use default cnrt queue, sync has been called in setup phase
-        exe->sync();
-      }
-      res = exe->teardown();
+      slot->exe->prepareHostData();
     } catch (std::exception &e) {
-      ctx->ecw_vec[id]->reset();  // reset running env
-
-      res = *(exe->result());
-      res.what.emplace_back(
-          "Unknown error: maybe exception raised, other info is lost.");
-      ADD_FAILURE() << "MLUOPGTEST: catched " << e.what()
-                    << " in teardown. (of " << res.case_path
-                    << ") tid: " << std::this_thread::get_id();
+      pl->fail(slot, "setup", e);
+      return;
     }
-    printf("[ TEARDOWN ]: %s\n",
-           res.case_path.c_str());  // printf is thread-safe
-    exe.reset();                    // free this exe.
-    {
-      std::lock_guard<std::mutex> lk(ctx->mtx);
-      ctx->exe_vec[id]->reset();  // reset this position as idle.
-      ctx->results.emplace_back(res);
-    }
-    // this thread is free, wake master thread to schedule new task.
-    ctx->cond.notify_all();
+    pl->pools->enqueue(mluoptest::STAGE_DEVICE, device, pl, slot);
   };
 
-  auto setup = [](std::string op_name, std::string case_path,
-                  std::shared_ptr<Context> ctx, size_t pos) {
-    printf("[ SETUP    ]: %s\n", case_path.c_str());  // printf is thread-safe
-    // get corresponding executor context which saved handle queue ...
-    auto ecw = ctx->ecw_vec[pos];
-    ecw->init();  // if initialized, this func will return directly.
-
-    std::shared_ptr<mluoptest::Executor> exe = nullptr;
-    // run
+  auto parse = [=](std::shared_ptr<Pipeline> pl,
+                   std::shared_ptr<CaseSlot> slot) {
+    setWorkerDevice();
+    mluoptest::TraceSpan span("parse", slot->case_path);
+    mluoptest::reportCaseStart(slot->case_path);
+    printf("[ SETUP    ]: %s\n",
+           slot->case_path.c_str());  // printf is thread-safe
     try {
-      exe = getOpExecutor(op_name);
+      slot->ecw->init();  // if initialized, this func will return directly.
+      slot->exe = getOpExecutor(slot->op_name);
       // TODO(None): modify ctor, set op_name in ctor.
-      exe->result()->op_name = op_name;
-      exe->init(ecw->ectx);
-      exe->setup(case_path, ecfg_);
-      exe->launch();
-      if (global_var.use_default_queue_) {
-        // when we use default cnrt queue, launch and sync should be in the same
-        // thread
-        exe->sync();
-      }
-      {
-        std::lock_guard<std::mutex> lk(ctx->mtx);
-        ctx->exe_vec[pos]->set(exe);  // push exe into task queue.
-      }
-      exe = nullptr;
+      slot->exe->result()->op_name = slot->op_name;
+      slot->exe->init(slot->ecw->ectx);
+      slot->exe->parseCase(slot->case_path, ecfg_);
     } catch (std::exception &e) {
-      ctx->ecw_vec[pos]->reset();  // reset running env
-      ctx->exe_vec[pos]->reset();  // mark pos as free
-
-      mluoptest::EvaluateResult res;
-      if (exe) res = *(exe->result());
-      res.op_name = op_name;
-      res.case_path = case_path;
-      res.what.emplace_back(
-          "Unknown error: maybe exception raised, other info is lost.");
-      {
-        std::lock_guard<std::mutex> lk(ctx->mtx);
-        ctx->results.emplace_back(res);
-      }
-      ADD_FAILURE() << "MLUOPGTEST: catched " << e.what() << " in setup. (of "
-                    << res.case_path << ") tid: " << std::this_thread::get_id();
+      pl->fail(slot, "setup", e);
+      return;
     }
+    pl->pools->enqueue(mluoptest::STAGE_PREPARE, prepare, pl, slot);
   };
 
-  // set current device for each thread.
-  while (context->been_initialized.size() < thread_num) {
-    thread_pool->enqueue(set_device, context);
+  // cases start as soon as the collector finds them.
+  auto pipeline = std::make_shared<Pipeline>(global_var.thread_num_);
+  size_t case_num = 0;
+  std::string case_path;
+  while (case_stream_->next(&case_path)) {
+    auto slot = std::make_shared<CaseSlot>();
+    slot->op_name = op_name_;
+    slot->case_path = case_path;
+    slot->ecw = pipeline->acquire();  // wait here if too many cases in flight.
+    pipeline->pools->enqueue(mluoptest::STAGE_PARSE, parse, pipeline, slot);
+    case_num++;
   }
-
-  for (size_t i = 0;;) {
-    auto teardown_pos = any_done(context);
-    if (teardown_pos != -1) {
-      thread_pool->enqueue(teardown, teardown_pos, context);
-    } else {
-      // find a idle position.
-      auto it =
-          find_if(context->exe_vec.begin(), context->exe_vec.end(),
-                  [](std::shared_ptr<ExecutorWrap> e) { return e->is_free(); });
-      if (it != context->exe_vec.end() && i < case_path_vec_.size()) {
-        (*it)->used();  // occupy this position
-        auto setup_pos = std::distance(context->exe_vec.begin(), it);
-        thread_pool->enqueue(setup, op_name_, case_path_vec_[i], context,
-                             setup_pos);
-        i++;
-      } else {
-        // task is full, just wait.
-        std::unique_lock<std::mutex> lk(context->mtx);
-        context->cond.wait_for(lk, std::chrono::milliseconds(1),
-                               [=]() { return has_done(context); });
-      }
-    }
-
-    // all case been launched and buffer is empty, done.
-    if (i == case_path_vec_.size()) {
-      // find a exe which is not free
-      auto it = find_if(
-          context->exe_vec.begin(), context->exe_vec.end(),
-          [](std::shared_ptr<ExecutorWrap> e) { return !e->is_free(); });
-      if (it == context->exe_vec.end()) {
-        // if all exe in task buffer is free, done.
-        break;
-      }
-    }
+  global_var.summary_.case_count += case_num;
+  if (case_num == 0) {
+    LOG(INFO) << "No cases found for " << op_name_;
   }
-
-  // join thread pool
-  thread_pool.reset();
+  pipeline->wait(case_num);
 
   // get results.
-  res_ = context->results;
+  res_ = pipeline->results;
 
   // free all.
-  context->destroy();
-  context.reset();
+  pipeline->destroy();
+  pipeline.reset();
 
-  ASSERT_EQ(case_path_vec_.size(), res_.size());
+  ASSERT_EQ(case_num, res_.size());
 }
 
 void TestSuite::Run() {
@@ -63,6 +63,7 @@ class TestSuite : public TestWithParam<std::tuple<std::string, size_t>> {
 
   static std::string op_name_;
   static std::vector<std::string> case_path_vec_;
+  static std::shared_ptr<mluoptest::CaseStream> case_stream_;  // thread x
   static std::shared_ptr<mluoptest::ExecuteContext> ectx_;
   static std::shared_ptr<mluoptest::ExecuteConfig> ecfg_;
 
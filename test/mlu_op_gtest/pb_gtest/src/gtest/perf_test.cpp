@@ -22,6 +22,7 @@
  *************************************************************************/
 #include <string>
 #include "perf_test.h"
+#include "baseline_index.h"
 #include "core/logging.h"
 #include "json.h"
 
@@ -30,52 +31,24 @@
 #define DEFAULT_THRESHOLD_ABSOLUTE (5)
 #define DEFAULT_THRESHOLD_RELATIVE (0.04f)
 
-// get hardware_time and workspace_size from txt file for better perfermance
-bool getTxtData(std::string case_name, double *txt_time,
-                double *workspace_size) {
-  bool is_get = false;
-
+// get hardware_time and workspace_size from the index of baseline xml
+bool getBaselineData(std::string case_name, double *hw_time,
+                     double *workspace_size) {
   if (std::getenv("MLUOP_GTEST_GENERATE_BASELINE_ONLY") != NULL &&
       std::string(std::getenv("MLUOP_GTEST_GENERATE_BASELINE_ONLY"))
               .compare("ON") == 0) {
-    return is_get;
-  }
-
-  std::string txt_file;
-  if (getenv("MLUOP_BASELINE_XML_FILE") != NULL) {
-    txt_file = std::string(getenv("MLUOP_BASELINE_XML_FILE")) + ".txt";
-  } else {
-    LOG(ERROR) << "getTxtData:The env of MLUOP_BASELINE_XML_FILE is NULL.";
-    return is_get;
-  }
-
-  std::ifstream file(txt_file.c_str(), std::fstream::in);
-  if (!file.is_open()) {
-    LOG(ERROR) << "getTxtData: failed to open file " << txt_file << "\n";
-    return is_get;
+    return false;
   }
-  std::string hw_input, ws_input, result;
-  std::string::size_type start, end;
-  while (getline(file, hw_input)) {
-    if (hw_input.find(case_name.c_str()) != std::string::npos) {
-      // get hard_time_base
-      start = hw_input.find_last_of("value=");
-      end = hw_input.find_last_of("/");
-      result = hw_input.substr(start + 1, end - start - 1);
-      *txt_time = atof(result.c_str());
 
-      // get workspace_size_base
-      getline(file, ws_input);
-      start = ws_input.find_last_of("value=");
-      end = ws_input.find_last_of("/");
-      result = ws_input.substr(start + 1, end - start - 1);
-      *workspace_size = atof(result.c_str());
-      is_get = true;
-      break;
-    }
+  mluoptest::BaselineRecord record;
+  if (!mluoptest::BaselineIndex::getPerfInstance()->find(case_name,
+                                                          &record) ||
+      !record.has_perf) {
+    return false;
   }
-
-  return is_get;
+  *hw_time = record.hw_time;
+  *workspace_size = record.workspace_size;
+  return true;
 }
 
 // get pb or prototxt file name
@@ -26,8 +26,8 @@
 
 std::string getTestCaseName(std::string str);
 
-bool getTxtData(std::string case_name, double *xml_time,
-                double *workspace_size);
+bool getBaselineData(std::string case_name, double *hw_time,
+                     double *workspace_size);
 
 bool getThreshold(std::string op_name, double *scale_bound,
                   double *threshold_absolute, double *threshold_relative);
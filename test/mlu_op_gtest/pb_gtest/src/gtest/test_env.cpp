@@ -30,54 +30,29 @@
 #include <utility>    // std::pair
 #include "cndev.h"    // cndevGetProcessInfo
 #include "hardware_monitor.h"
+#include "baseline_cache.h"
+#include "baseline_index.h"
+#include "host_trace.h"
 
 using mluoptest::global_var;
 
 TestEnvInfo TestEnvironment::test_env_;
-std::unordered_map<std::string, std::vector<double>> acc_baseline_map;
 
-void TestEnvironment::getAccuracyBaselineXml() {
+void TestEnvironment::loadAccuracyBaselineIndex() {
   if (std::getenv("MLUOP_GTEST_ACC_BASELINE") == NULL ||
       std::string(std::getenv("MLUOP_GTEST_ACC_BASELINE")).compare("ON") != 0) {
     return;
   }
-  std::string xml_file_name;
-  if (std::getenv("MLUOP_ACC_BASELINE_XML_FILE") != NULL) {
-    xml_file_name = std::getenv("MLUOP_ACC_BASELINE_XML_FILE");
-  } else {
+  if (std::getenv("MLUOP_ACC_BASELINE_XML_FILE") == NULL) {
     LOG(WARNING)
-        << "getAccuracyBaseline: MLUOP_ACC_BASELINE_XML_FILE is not set.";
-  }
-  std::ifstream xml_file(xml_file_name, std::ifstream::in);
-  std::string line, error_diff;
-  std::string::size_type start, end;
-  while (std::getline(xml_file, line, '\n')) {
-    if (line.find("name=\"case_path\"") != std::string::npos) {
-      start = line.find_last_of("=") + 2;
-      end = line.find_last_of("/") - 2;
-      std::string case_path = line.substr(start, end - start + 1);
-      std::string case_name = case_path.substr(case_path.find_last_of("/") + 1);
-      acc_baseline_map[case_name] = std::vector<double>({});
-
-      // move to error_diff
-      while (line.find("error_diff") == std::string::npos) {
-        std::getline(xml_file, line, '\n');
-      }
-
-      while (line.find("properties") == std::string::npos &&
-             line.find("error_diff") != std::string::npos) {
-        start = line.find_last_of("=") + 2;
-        end = line.find_last_of("/") - 2;
-        error_diff = line.substr(start, end - start + 1);
-        acc_baseline_map[case_name].push_back(atof(error_diff.c_str()));
-        std::getline(xml_file, line, '\n');
-      }
-    }
+        << "loadAccuracyBaselineIndex: MLUOP_ACC_BASELINE_XML_FILE is not set.";
+    return;
   }
-  xml_file.close();
+  mluoptest::BaselineIndex::getAccuracyInstance()->load(
+      std::getenv("MLUOP_ACC_BASELINE_XML_FILE"));
 }
 
-void TestEnvironment::convertBaselineXml2Txt() {
+void TestEnvironment::loadBaselineIndex() {
   if ((std::getenv("MLUOP_GTEST_GENERATE_BASELINE_ONLY") != NULL &&
        std::string(std::getenv("MLUOP_GTEST_GENERATE_BASELINE_ONLY"))
                .compare("ON") == 0) ||
@@ -86,92 +61,12 @@ void TestEnvironment::convertBaselineXml2Txt() {
           0) {
     return;
   }
-  std::string xml_file_name;
-  if (std::getenv("MLUOP_BASELINE_XML_FILE") != NULL) {
-    xml_file_name = std::getenv("MLUOP_BASELINE_XML_FILE");
-  } else {
-    LOG(ERROR) << "convertBaselineXml2Txt: MLUOP_BASELINE_XML_FILE is not set.";
+  if (std::getenv("MLUOP_BASELINE_XML_FILE") == NULL) {
+    LOG(ERROR) << "loadBaselineIndex: MLUOP_BASELINE_XML_FILE is not set.";
     return;
   }
-
-  std::ifstream xml_file(xml_file_name, std::ifstream::in);
-  std::ofstream baseline_perf_txt_file;
-  baseline_perf_txt_file.open(xml_file_name + ".txt", std::fstream::out);
-  std::string line;
-  // xml has the following order of properties
-  // case_path, mluop_version, mlu_platform, hardware_time_base, <file_name>,
-  // workspace_size_mlu
-  while (std::getline(xml_file, line, '\n')) {
-    if (line.find("name=\"case_path\"") != std::string::npos) {
-      int start = line.find_last_of("=") + 2;
-      int end = line.find_last_of("/") - 3;
-      std::string case_path = line.substr(start, end - start + 1);
-      std::string case_path_file_name =
-          case_path.substr(case_path.find_last_of("/") + 1);
-
-      // move to hardware_time_base
-      for (int i = 0; i < 1; ++i) {
-        std::getline(xml_file, line, '\n');
-      }
-      start = line.find("=") + 2;
-      end = line.find("value=") - 3;
-      if ((line.substr(start, end - start + 1)).compare("hardware_time_base") !=
-          0) {
-        LOG(ERROR)
-            << "convertBaselineXml2Txt: expected hardware_time_base, but got "
-            << line.substr(start, end - start + 1) << ".";
-        baseline_perf_txt_file.close();
-        xml_file.close();
-        break;
-      }
-      std::string hardware_time_base_value;
-      start = line.find_last_of("=") + 2;
-      end = line.find_last_of("/") - 3;
-      hardware_time_base_value = line.substr(start, end - start + 1);
-
-      // move to <file_name>
-      std::getline(xml_file, line, '\n');
-      start = line.find("=") + 2;
-      end = line.find("value=") - 3;
-      std::string file_name = line.substr(start, end - start + 1);
-      if (case_path_file_name.compare(file_name) != 0) {
-        LOG(ERROR) << "convertBaselineXml2Txt: case file " << file_name
-                   << " does not match the "
-                   << "one in case_path " << case_path << ".";
-        baseline_perf_txt_file.close();
-        xml_file.close();
-        break;
-      }
-
-      // move to workspace_size_mlu
-      std::getline(xml_file, line, '\n');
-
-      start = line.find("=") + 2;
-      end = line.find("value=") - 3;
-      if ((line.substr(start, end - start + 1)).compare("workspace_size_mlu") !=
-          0) {
-        LOG(ERROR)
-            << "convertBaselineXml2Txt: expected workspace_size_mlu, but got "
-            << line.substr(start, end - start + 1) << ".";
-        baseline_perf_txt_file.close();
-        xml_file.close();
-        break;
-      }
-      std::string workspace_size_mlu_value;
-      start = line.find_last_of("=") + 2;
-      end = line.find_last_of("/") - 2;
-      workspace_size_mlu_value = line.substr(start, end - start + 1);
-
-      // write this case to txt
-      baseline_perf_txt_file << "<" << file_name
-                             << " value=" << hardware_time_base_value << "/>\n";
-      baseline_perf_txt_file
-          << "<workspace_size_mlu value=" << workspace_size_mlu_value << "/>\n";
-    }
-  }
-
-  baseline_perf_txt_file.close();
-  xml_file.close();
+  mluoptest::BaselineIndex::getPerfInstance()->load(
+      std::getenv("MLUOP_BASELINE_XML_FILE"));
 }
 
 void TestEnvironment::SetUp() {
@@ -179,9 +74,9 @@ void TestEnvironment::SetUp() {
   // set device
   setDevice();
   mluoptest::monitor->signalMonitorDeviceChosen();
-  // convert baseline xml to txt
-  convertBaselineXml2Txt();
-  getAccuracyBaselineXml();
+  // index baseline xml, or map the index built by an earlier run
+  loadBaselineIndex();
+  loadAccuracyBaselineIndex();
   setTestEnv();
   recordEnvXml();
   recordEnvLog();
@@ -190,6 +85,7 @@ void TestEnvironment::SetUp() {
 void TestEnvironment::TearDown() {
   VLOG(4) << "TearDown CNRT environment.";
   showSummary();
+  mluoptest::HostTrace::getInstance()->dump();
 
   // set compute mode as default
   restoreComputeMode();
@@ -624,4 +520,8 @@ void TestEnvironment::showSummary() {
       std::cout << "Failed: " << (*it) << "\n";
     }
   }
+  auto baseline_cache = mluoptest::BaselineCache::getInstance();
+  if (baseline_cache->enabled()) {
+    std::cout << "[ BASELINE CACHE ] " << baseline_cache->getStats() << "\n";
+  }
 }
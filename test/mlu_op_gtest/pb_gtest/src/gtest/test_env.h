@@ -68,8 +68,8 @@ class TestEnvironment : public testing::Environment {
   static TestEnvInfo test_env_;
 
  private:
-  void convertBaselineXml2Txt();
-  void getAccuracyBaselineXml();
+  void loadBaselineIndex();
+  void loadAccuracyBaselineIndex();
   // set device
   static void setDevice();
   // set computemode as default before teardown.
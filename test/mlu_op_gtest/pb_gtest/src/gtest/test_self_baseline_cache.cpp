@@ -0,0 +1,79 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "baseline_cache.h"
+
+namespace {
+TEST(BaselineCacheSelfTest, StoreAndLoad) {
+  mluoptest::BaselineHasher h1, h2, h3;
+  h1.update(std::string("abs"));
+  h2.update(std::string("abs"));
+  h3.update(std::string("abd"));
+  ASSERT_EQ(32, h1.hexDigest().size());
+  EXPECT_EQ(h1.hexDigest(), h2.hexDigest());
+  EXPECT_NE(h1.hexDigest(), h3.hexDigest());
+
+  char tmpl[] = "/tmp/mluop_baseline_cache_XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(tmpl));
+  std::string dir(tmpl);
+  // room for 2 entries only
+  mluoptest::BaselineCache cache(dir, 2 * 4096 + 1024);
+  ASSERT_TRUE(cache.enabled());
+  std::vector<float> out0(1000), out1(7);
+  for (size_t i = 0; i < out0.size(); ++i) out0[i] = i * 0.5f;
+  for (size_t i = 0; i < out1.size(); ++i) out1[i] = -1.0f * i;
+  std::vector<std::pair<void *, size_t>> outputs = {
+      {out0.data(), out0.size() * sizeof(float)},
+      {nullptr, 0},
+      {out1.data(), out1.size() * sizeof(float)}};
+  EXPECT_FALSE(cache.load("k0", outputs));
+  cache.store("k0", outputs);
+
+  std::vector<float> res0(out0.size()), res1(out1.size());
+  std::vector<std::pair<void *, size_t>> results = {
+      {res0.data(), res0.size() * sizeof(float)},
+      {nullptr, 0},
+      {res1.data(), res1.size() * sizeof(float)}};
+  ASSERT_TRUE(cache.load("k0", results));
+  EXPECT_EQ(out0, res0);
+  EXPECT_EQ(out1, res1);
+  // sizes differ from the stored ones
+  results[2].second -= sizeof(float);
+  EXPECT_FALSE(cache.load("k0", results));
+
+  // the third entry evicts the least recently used one
+  cache.store("k1", outputs);
+  cache.store("k2", outputs);
+  results[2].second += sizeof(float);
+  EXPECT_FALSE(cache.load("k0", results));
+  EXPECT_TRUE(cache.load("k2", results));
+
+  std::string cmd = "rm -rf " + dir;
+  EXPECT_EQ(0, system(cmd.c_str()));
+}
+}  // namespace
@@ -0,0 +1,97 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "baseline_index.h"
+
+namespace {
+TEST(BaselineIndexSelfTest, BuildMapAndRebuild) {
+  char tmpl[] = "/tmp/mluop_baseline_index_XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(tmpl));
+  std::string xml_file = std::string(tmpl) + "/baseline.xml";
+  auto write_xml = [&xml_file](int case_num, double hw_time) {
+    std::ofstream fout(xml_file);
+    fout << "<testsuites>\n";
+    for (int i = 0; i < case_num; ++i) {
+      fout << "    <testcase name=\"mluOp/" << i << "\">\n<properties>\n"
+           << "<property name=\"case_path\" value=\"/a/abs/case_" << i
+           << ".pb\" />\n"
+           << "<property name=\"hardware_time_base\" value=\""
+           << hw_time + i << "\" />\n"
+           << "<property name=\"case_" << i << ".pb\" value=\"1\" />\n"
+           << "<property name=\"workspace_size_mlu\" value=\"" << i * 64
+           << "\" />\n"
+           << "<property name=\"output1_error_diff1\" value=\"" << i * 0.5
+           << "\" />\n"
+           << "<property name=\"output1_error_diff2\" value=\"1e-3\" />\n"
+           << "</properties>\n    </testcase>\n";
+    }
+    // no hardware_time_base, only accuracy baseline.
+    fout << "<properties>\n<property name=\"case_path\" "
+            "value=\"/a/add/case_acc.pb\" />\n"
+            "<property name=\"output1_error_diff1\" value=\"2\" />\n"
+            "</properties>\n</testsuites>\n";
+  };
+
+  write_xml(1000, 10);
+  mluoptest::BaselineIndex index;
+  ASSERT_TRUE(index.load(xml_file));
+  EXPECT_EQ(1001, index.size());
+  std::ifstream idx(xml_file + ".idx");
+  EXPECT_TRUE(idx.good());
+  mluoptest::BaselineRecord record;
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(index.find("case_" + std::to_string(i) + ".pb", &record));
+    EXPECT_TRUE(record.has_perf);
+    EXPECT_EQ(10 + i, record.hw_time);
+    EXPECT_EQ(i * 64, record.workspace_size);
+    ASSERT_EQ(2, record.error_num);
+    EXPECT_EQ(i * 0.5, record.errors[0]);
+    EXPECT_EQ(1e-3, record.errors[1]);
+  }
+  ASSERT_TRUE(index.find("case_acc.pb", &record));
+  EXPECT_FALSE(record.has_perf);
+  ASSERT_EQ(1, record.error_num);
+  EXPECT_EQ(2, record.errors[0]);
+  EXPECT_FALSE(index.find("case_1000.pb", &record));
+  EXPECT_FALSE(index.find("case_1.p", &record));
+
+  // unchanged xml maps the same index, a changed one is indexed again.
+  mluoptest::BaselineIndex mapped;
+  ASSERT_TRUE(mapped.load(xml_file));
+  ASSERT_TRUE(mapped.find("case_999.pb", &record));
+  EXPECT_EQ(1009, record.hw_time);
+  write_xml(10, 20);
+  ASSERT_TRUE(mapped.load(xml_file));
+  EXPECT_EQ(11, mapped.size());
+  ASSERT_TRUE(mapped.find("case_9.pb", &record));
+  EXPECT_EQ(29, record.hw_time);
+  EXPECT_FALSE(mapped.find("case_999.pb", &record));
+
+  std::string cmd = std::string("rm -rf ") + tmpl;
+  EXPECT_EQ(0, system(cmd.c_str()));
+}
+}  // namespace
@@ -0,0 +1,66 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "box_grid.h"
+
+namespace {
+TEST(BoxGridSelfTest, VisitsEveryContainingBox) {
+  std::mt19937 gen(2468);
+  std::uniform_real_distribution<float> dist(-10.0f, 10.0f);
+  const int64_t num = 300;
+  std::vector<float> boxes(num * 7);
+  for (int64_t i = 0; i < num; ++i) {
+    float *box = boxes.data() + i * 7;
+    box[0] = dist(gen), box[1] = dist(gen), box[2] = 0.0f;
+    box[3] = std::fabs(dist(gen)) * 0.3f, box[4] = std::fabs(dist(gen)) * 0.3f;
+    box[5] = 1.0f, box[6] = dist(gen);
+  }
+  mluoptest::BoxGrid grid;
+  grid.build(boxes.data(), num);
+  for (int q = 0; q < 2000; ++q) {
+    const float x = dist(gen), y = dist(gen);
+    std::vector<int64_t> visited;
+    grid.forEachCandidate(x, y, [&](int64_t box) {
+      visited.push_back(box);
+      return false;
+    });
+    ASSERT_TRUE(std::is_sorted(visited.begin(), visited.end()));
+    for (int64_t i = 0; i < num; ++i) {
+      const float *box = boxes.data() + i * 7;
+      float local_x, local_y;
+      grid.localCoords(i, x, y, &local_x, &local_y);
+      if (std::fabs(local_x) < box[3] / 2 + 1e-5 &&
+          std::fabs(local_y) < box[4] / 2 + 1e-5) {
+        ASSERT_TRUE(std::binary_search(visited.begin(), visited.end(), i))
+            << "box " << i << " query " << q;
+      }
+    }
+  }
+}
+}  // namespace
@@ -0,0 +1,68 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "box_iou.h"
+
+namespace {
+TEST(BoxIouSelfTest, CompareWithScalar) {
+  // 37 boxes and odd ranges cover both the vector body and the scalar tail.
+  const int num = 37;
+  std::mt19937 gen(97531);
+  std::uniform_real_distribution<float> coord(0.0f, 20.0f);
+  std::vector<float> x1(num), y1(num), x2(num), y2(num), area(num), iou(num);
+  for (int i = 0; i < num; ++i) {
+    x1[i] = coord(gen);
+    y1[i] = coord(gen);
+    x2[i] = x1[i] + coord(gen) / 2;
+    y2[i] = y1[i] + coord(gen) / 2;
+  }
+  for (bool add_offset : {false, true}) {
+    const float offset = add_offset ? 1.0f : 0.0f;
+    for (int i = 0; i < num; ++i) {
+      area[i] = (x2[i] - x1[i] + offset) * (y2[i] - y1[i] + offset);
+    }
+    const mluoptest::BoxIouSoA boxes = {x1.data(), y1.data(), x2.data(),
+                                        y2.data(), area.data()};
+    for (int m : {0, 5, 36}) {
+      std::fill(iou.begin(), iou.end(), -1.0f);
+      mluoptest::boxIouRange(boxes, m, area[m], add_offset, offset, 3, num,
+                             iou.data());
+      for (int i = 0; i < num; ++i) {
+        if (i < 3) {
+          ASSERT_EQ(iou[i], -1.0f);
+          continue;
+        }
+        const float w = std::max(
+            std::min(x2[m], x2[i]) - std::max(x1[m], x1[i]) + offset, 0.0f);
+        const float h = std::max(
+            std::min(y2[m], y2[i]) - std::max(y1[m], y1[i]) + offset, 0.0f);
+        ASSERT_EQ(iou[i], w * h / (area[m] + area[i] - w * h)) << m << " " << i;
+      }
+    }
+  }
+}
+}  // namespace
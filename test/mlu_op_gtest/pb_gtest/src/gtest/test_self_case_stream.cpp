@@ -0,0 +1,118 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "case_stream.h"
+
+namespace {
+TEST(CaseStreamSelfTest, WalkFilterAndShard) {
+  char tmpl[] = "/tmp/mluop_case_stream_XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(tmpl));
+  std::string root(tmpl);
+  auto touch = [](const std::string &path) { std::ofstream fout(path); };
+  std::set<std::string> abs_cases;
+  for (int d = 0; d < 20; ++d) {
+    std::string dir = root + "/abs/d" + std::to_string(d);
+    std::string cmd = "mkdir -p " + dir + "/sub";
+    ASSERT_EQ(0, system(cmd.c_str()));
+    for (int i = 0; i < 10; ++i) {
+      std::string name = dir + (i % 3 ? "/" : "/sub/") + "case_" +
+                         std::to_string(i) + (i % 2 ? ".pb" : ".prototxt");
+      touch(name);
+      abs_cases.insert(name);
+    }
+    touch(dir + "/case_invalid.pb");
+    touch(dir + "/readme.txt");
+  }
+  std::string cmd = "mkdir -p " + root + "/x/abs " + root + "/add";
+  ASSERT_EQ(0, system(cmd.c_str()));
+  touch(root + "/x/abs/case_0.pb");
+  touch(root + "/add/case_0.pb");
+
+  auto walk = [&](const mluoptest::CaseFilter &filter, std::string sub_dir,
+                  std::string op_name) {
+    mluoptest::CaseStream cases(filter);
+    cases.walk({root + sub_dir}, op_name, 4);
+    auto case_paths = cases.drain();
+    std::set<std::string> res(case_paths.begin(), case_paths.end());
+    EXPECT_EQ(case_paths.size(), res.size());
+    return res;
+  };
+  mluoptest::CaseFilter all;
+  EXPECT_EQ(abs_cases, walk(all, "/abs/", ""));
+  // recursive search takes every dir named abs.
+  auto recursive = walk(all, "", "abs");
+  EXPECT_EQ(abs_cases.size() + 1, recursive.size());
+  EXPECT_EQ(1, recursive.count(root + "/x/abs/case_0.pb"));
+
+  mluoptest::CaseFilter filter;
+  filter.include = mluoptest::splitList("case_1.*,,*/d7/*", ',');
+  filter.exclude = {"*/sub/*"};
+  ASSERT_EQ(2, filter.include.size());
+  for (const auto &case_path : walk(filter, "/abs", "")) {
+    EXPECT_EQ(std::string::npos, case_path.find("/sub/"));
+    EXPECT_TRUE(case_path.find("/case_1.pb") != std::string::npos ||
+                case_path.find("/d7/") != std::string::npos);
+  }
+  EXPECT_EQ(20 + 6 - 1, walk(filter, "/abs", "").size());
+
+  // shards are disjoint and cover every case.
+  std::set<std::string> merged;
+  size_t total = 0;
+  for (int i = 0; i < 3; ++i) {
+    mluoptest::CaseFilter shard;
+    shard.shard_index = i;
+    shard.shard_count = 3;
+    auto res = walk(shard, "/abs", "");
+    EXPECT_GT(res.size(), 0);
+    total += res.size();
+    merged.insert(res.begin(), res.end());
+  }
+  EXPECT_EQ(abs_cases.size(), total);
+  EXPECT_EQ(abs_cases, merged);
+
+  // cases of a list come in the order of the list.
+  std::string list_file = root + "/cases_list.txt";
+  {
+    std::ofstream fout(list_file);
+    fout << "/a/abs/case_1.pb\r\n/a/add/case_0.pb\n/a/abs/case_0.pb\n";
+  }
+  mluoptest::CaseStream cases(all);
+  cases.readList(list_file, "abs");
+  std::vector<std::string> listed;
+  std::string case_path;
+  while (cases.next(&case_path)) {
+    listed.push_back(case_path);
+  }
+  EXPECT_EQ(std::vector<std::string>({"/a/abs/case_1.pb", "/a/abs/case_0.pb"}),
+            listed);
+
+  cmd = "rm -rf " + root;
+  EXPECT_EQ(0, system(cmd.c_str()));
+}
+}  // namespace
@@ -0,0 +1,86 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "channel_reduce.h"
+
+namespace {
+TEST(ChannelReduceSelfTest, CompareWithTwoPass) {
+  // an offset mean makes the naive sum-of-squares variance useless.
+  const int64_t rows = 5000;
+  const int C = 7;
+  std::mt19937 gen(1357);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::vector<float> data(rows * C);
+  for (auto &v : data) v = 1000.0f + dist(gen);
+  std::vector<double> mean(C, 0.0), var(C, 0.0);
+  for (int64_t r = 0; r < rows; ++r) {
+    for (int c = 0; c < C; ++c) mean[c] += data[r * C + c];
+  }
+  for (int c = 0; c < C; ++c) mean[c] /= rows;
+  for (int64_t r = 0; r < rows; ++r) {
+    for (int c = 0; c < C; ++c) {
+      var[c] += (data[r * C + c] - mean[c]) * (data[r * C + c] - mean[c]);
+    }
+  }
+  std::vector<mluoptest::WelfordMoments> moments[2];
+  std::vector<double> sums[2];
+  const char *host_threads[] = {"1", "3"};
+  for (int k = 0; k < 2; k++) {
+    setenv("MLUOP_GTEST_HOST_THREADS", host_threads[k], 1);
+    moments[k].resize(C);
+    mluoptest::channelMoments(
+        rows, C,
+        [&](int64_t begin, int64_t end, mluoptest::WelfordMoments *m) {
+          for (int64_t r = begin; r < end; ++r) {
+            mluoptest::welfordAddRow(&data[r * C], C, m);
+          }
+        },
+        moments[k].data());
+    sums[k].resize(C);
+    mluoptest::channelSums(
+        rows, C,
+        [&](int64_t begin, int64_t end, double *s) {
+          for (int64_t r = begin; r < end; ++r) {
+            for (int c = 0; c < C; ++c) s[c] += data[r * C + c];
+          }
+        },
+        sums[k].data());
+  }
+  unsetenv("MLUOP_GTEST_HOST_THREADS");
+  for (int c = 0; c < C; ++c) {
+    ASSERT_EQ(moments[0][c].count, (double)rows);
+    ASSERT_NEAR(moments[0][c].mean, mean[c], 1e-9);
+    ASSERT_NEAR(moments[0][c].variance(), var[c] / rows, 1e-9);
+    ASSERT_NEAR(sums[0][c], mean[c] * rows, 1e-6);
+    // the merge order depends on the row count only.
+    ASSERT_EQ(moments[0][c].mean, moments[1][c].mean);
+    ASSERT_EQ(moments[0][c].m2, moments[1][c].m2);
+    ASSERT_EQ(sums[0][c], sums[1][c]);
+  }
+}
+}  // namespace
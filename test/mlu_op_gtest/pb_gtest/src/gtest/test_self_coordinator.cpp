@@ -0,0 +1,150 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "coordinator.h"
+#include "json.h"
+
+namespace {
+TEST(CoordinatorSelfTest, MergeReports) {
+  auto report = [](const std::string &suite, int tests, int failures,
+                   const std::string &time) {
+    return "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+           "<testsuites tests=\"" + std::to_string(tests) +
+           "\" failures=\"" + std::to_string(failures) +
+           "\" disabled=\"0\" errors=\"0\" timestamp=\"2024-01-01T00:00:00\" "
+           "time=\"" + time + "\" name=\"AllTests\">\n"
+           "  <testsuite name=\"" + suite + "\" tests=\"" +
+           std::to_string(tests) + "\" failures=\"" +
+           std::to_string(failures) + "\" disabled=\"0\" errors=\"0\" "
+           "time=\"" + time + "\">\n"
+           "    <properties>\n"
+           "      <property name=\"project\" value=\"MLUOPCORE\" />\n"
+           "    </properties>\n"
+           "    <testcase name=\"mluOp/0\" status=\"run\" time=\"" + time +
+           "\" classname=\"" + suite + "\" />\n"
+           "  </testsuite>\n"
+           "</testsuites>\n";
+  };
+  std::vector<mluoptest::CaseOutcome> outcomes = {
+      {"abs", "/a/abs/case_2.pb", "crashed"},
+      {"add", "/a/add/case_0.pb", "passed"}};
+  std::string xml = mluoptest::mergeXmlReports(
+      {report("abs/TestSuite", 1, 0, "1.5"),
+       report("abs/TestSuite", 1, 1, "2")},
+      outcomes, 3);
+  auto count = [&xml](const std::string &str) {
+    size_t num = 0;
+    for (size_t pos = xml.find(str); pos != std::string::npos;
+         pos = xml.find(str, pos + 1)) {
+      num++;
+    }
+    return num;
+  };
+  EXPECT_EQ(1, count("<testsuites tests=\"4\" failures=\"2\""));
+  EXPECT_EQ(1, count("time=\"3\" name=\"AllTests\""));
+  EXPECT_EQ(1, count("name=\"abs/TestSuite\" tests=\"3\" failures=\"2\""));
+  EXPECT_EQ(1, count("name=\"add/TestSuite\" tests=\"1\" failures=\"0\""));
+  EXPECT_EQ(1, count("time=\"3.5\">"));
+  EXPECT_EQ(2, count("\n    <properties>\n"));  // once per suite
+  EXPECT_EQ(1, count("name=\"mluOp/crashed\""));
+  EXPECT_EQ(1, count("<failure message=\"MLUOPGTEST: /a/abs/case_2.pb"));
+  EXPECT_EQ(4, count("<testcase "));
+  EXPECT_EQ(2, count("</testsuite>"));
+
+  // only elements matter, not the layout, and CDATA is not markup
+  std::string compact =
+      "<testsuites tests=\"1\" failures=\"1\" name=\"AllTests\">"
+      "<testsuite name=\"abs/TestSuite\" tests=\"1\" failures=\"1\" "
+      "disabled=\"0\" time=\"1\"><testcase name=\"mluOp/1\"><failure "
+      "message=\"x\"><![CDATA[</testsuite><testsuite name=\"fake\">]]>"
+      "</failure></testcase></testsuite><testsuite name=\"empty/TestSuite\" "
+      "tests=\"0\" failures=\"0\" disabled=\"0\" time=\"0\"/>"
+      "</testsuites>";
+  xml = mluoptest::mergeXmlReports({report("abs/TestSuite", 1, 0, "1.5"),
+                                    compact},
+                                   {}, 2);
+  EXPECT_EQ(1, count("<testsuites tests=\"2\" failures=\"1\""));
+  EXPECT_EQ(1, count("name=\"abs/TestSuite\" tests=\"2\" failures=\"1\""));
+  EXPECT_EQ(1, count("name=\"empty/TestSuite\" tests=\"0\""));
+  EXPECT_EQ(2, count("<testcase "));
+  EXPECT_EQ(1, count("<![CDATA[</testsuite><testsuite name=\"fake\">]]>"));
+  EXPECT_EQ(3, count("</testsuite>"));  // one is in the CDATA
+
+  std::string json_report =
+      "{\"tests\": 2, \"failures\": 1, \"disabled\": 0, \"errors\": 0,"
+      " \"time\": \"1s\", \"name\": \"AllTests\", \"testsuites\": [{"
+      "\"name\": \"abs/TestSuite\", \"tests\": 2, \"failures\": 1,"
+      " \"disabled\": 0, \"errors\": 0, \"time\": \"0.5s\", \"testsuite\":"
+      " [{\"name\": \"mluOp/0\"}, {\"name\": \"mluOp/1\"}]}]}";
+  std::string json =
+      mluoptest::mergeJsonReports({json_report, json_report}, outcomes, 2);
+  Json::Value root;
+  Json::CharReaderBuilder build;
+  std::string errs;
+  std::istringstream in(json);
+  ASSERT_TRUE(Json::parseFromStream(build, in, &root, &errs)) << errs;
+  EXPECT_EQ(6, root["tests"].asInt());
+  EXPECT_EQ(3, root["failures"].asInt());
+  EXPECT_EQ("2s", root["time"].asString());
+  ASSERT_EQ(2, root["testsuites"].size());
+  const Json::Value &abs = root["testsuites"][0];
+  EXPECT_EQ("abs/TestSuite", abs["name"].asString());
+  EXPECT_EQ(5, abs["tests"].asInt());
+  EXPECT_EQ("1s", abs["time"].asString());
+  ASSERT_EQ(5, abs["testsuite"].size());
+  EXPECT_EQ("/a/abs/case_2.pb", abs["testsuite"][4]["case_path"].asString());
+  EXPECT_EQ(1, abs["testsuite"][4]["failures"].size());
+  EXPECT_EQ("add/TestSuite", root["testsuites"][1]["name"].asString());
+}
+
+TEST(CoordinatorSelfTest, MergeTraces) {
+  auto trace = [](int pid, double ts) {
+    std::string p = std::to_string(pid);
+    return "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n"
+           "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " + p +
+           ", \"tid\": 1, \"args\": {\"name\": \"thread 1\"}},\n"
+           "{\"name\": \"cpu_compute\", \"cat\": \"gtest\", \"ph\": \"X\", "
+           "\"pid\": " + p + ", \"tid\": 1, \"ts\": " + std::to_string(ts) +
+           ", \"dur\": 2.000}\n]}\n";
+  };
+  std::string merged = mluoptest::mergeTraces(
+      {{0, 0, trace(100, 5)}, {2, 1000, trace(102, 7)}, {3, 0, "{broken"}});
+  Json::Value root;
+  Json::CharReaderBuilder build;
+  std::string errs;
+  std::istringstream in(merged);
+  ASSERT_TRUE(Json::parseFromStream(build, in, &root, &errs)) << errs;
+  const Json::Value &events = root["traceEvents"];
+  ASSERT_EQ(6, events.size());  // process name + 2 events per worker
+  EXPECT_EQ("process_name", events[3]["name"].asString());
+  EXPECT_EQ(102, events[3]["pid"].asInt());
+  EXPECT_EQ("worker 2", events[3]["args"]["name"].asString());
+  EXPECT_DOUBLE_EQ(5, events[2]["ts"].asDouble());
+  EXPECT_DOUBLE_EQ(1007, events[5]["ts"].asDouble());
+  EXPECT_FALSE(events[4].isMember("ts"));  // metadata is not shifted
+}
+}  // namespace
@@ -0,0 +1,73 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "cpu_gemm.h"
+
+namespace {
+TEST(CpuGemmSelfTest, CompareWithNaive) {
+  std::mt19937 gen(1234);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  // odd sizes cover the partial tiles, the large ones cover several blocks.
+  const int64_t shapes[][3] = {{1, 1, 1},   {7, 5, 3},      {13, 33, 0},
+                               {50, 70, 300}, {150, 1100, 40}, {3, 2000, 257}};
+  for (const auto &shape : shapes) {
+    const int64_t m = shape[0], n = shape[1], k = shape[2], batch = 2;
+    std::vector<float> a(batch * m * k), b(batch * k * n), c(batch * m * n);
+    for (auto &v : a) v = dist(gen);
+    for (auto &v : b) v = dist(gen);
+    for (auto &v : c) v = dist(gen);
+    for (int trans = 0; trans < 4; ++trans) {
+      const bool trans_a = trans & 1, trans_b = trans & 2;
+      const float alpha = 0.5f, beta = trans == 3 ? 0.0f : 2.0f;
+      std::vector<float> res(c);
+      mluoptest::cpuSgemmBatched(trans_a, trans_b, m, n, k, alpha, a.data(),
+                                 trans_a ? m : k, m * k, b.data(),
+                                 trans_b ? k : n, k * n, beta, res.data(), n,
+                                 m * n, batch);
+      for (int64_t bi = 0; bi < batch; ++bi) {
+        for (int64_t i = 0; i < m; ++i) {
+          for (int64_t j = 0; j < n; ++j) {
+            double sum = 0.0;
+            for (int64_t p = 0; p < k; ++p) {
+              float va = trans_a ? a[bi * m * k + p * m + i]
+                                 : a[bi * m * k + i * k + p];
+              float vb = trans_b ? b[bi * k * n + j * k + p]
+                                 : b[bi * k * n + p * n + j];
+              sum += (double)va * vb;
+            }
+            int64_t idx = bi * m * n + i * n + j;
+            double expect = alpha * sum + beta * c[idx];
+            ASSERT_NEAR(expect, res[idx], 1e-4 * (k + 1))
+                << mluoptest::cpuGemmKernelName() << " m " << m << " n " << n
+                << " k " << k << " trans " << trans;
+          }
+        }
+      }
+    }
+  }
+}
+}  // namespace
@@ -0,0 +1,87 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "deform_im2col.h"
+
+namespace {
+TEST(DeformIm2colSelfTest, IntegerOffsets) {
+  // integer offsets pick single input pixels, so every column value is exact.
+  const mluoptest::DeformConvShape s = {5, 6, 12, 4, 5, 3, 2, 1, 0,
+                                        1, 1, 1, 2, 3, 2};
+  const int n = 2;
+  const int64_t rows = (int64_t)n * s.ho * s.wo;
+  const int64_t group_k = s.kh * s.kw * s.ci / s.g;
+  std::mt19937 gen(2468);
+  std::vector<float> input(n * s.hi * s.wi * s.ci);
+  std::vector<float> offset(rows * s.dg * s.kh * s.kw * 2);
+  std::vector<float> mask(rows * s.dg * s.kh * s.kw);
+  for (auto &v : input) v = (float)(gen() % 100) - 50;
+  for (auto &v : offset) v = (float)(gen() % 5) - 2;
+  for (auto &v : mask) v = gen() % 2 ? 1.0f : 0.5f;
+  std::vector<float> columns(s.g * rows * group_k);
+  mluoptest::deformIm2col(s, input.data(), offset.data(), mask.data(), 0,
+                          rows, columns.data());
+  for (int64_t r = 0; r < rows; ++r) {
+    const int64_t idx_n = r / (s.ho * s.wo);
+    const int idx_ho = r / s.wo % s.ho;
+    const int idx_wo = r % s.wo;
+    for (int kh = 0; kh < s.kh; ++kh) {
+      for (int kw = 0; kw < s.kw; ++kw) {
+        for (int c = 0; c < s.ci; ++c) {
+          const int64_t dm = (r * s.dg + c / (s.ci / s.dg)) * s.kh * s.kw +
+                             kh * s.kw + kw;
+          const int h = idx_ho * s.sh - s.pt + kh * s.dh + offset[dm * 2];
+          const int w = idx_wo * s.sw - s.pl + kw * s.dw + offset[dm * 2 + 1];
+          float expected = 0.0f;
+          if (h >= 0 && h < s.hi && w >= 0 && w < s.wi) {
+            expected =
+                input[((idx_n * s.hi + h) * s.wi + w) * s.ci + c] * mask[dm];
+          }
+          const int cg = s.ci / s.g;
+          const int gi = c / cg;
+          ASSERT_EQ(columns[(gi * rows + r) * group_k +
+                            (kh * s.kw + kw) * cg + c % cg],
+                    expected)
+              << "row " << r << " kh " << kh << " kw " << kw << " c " << c;
+        }
+      }
+    }
+  }
+  // a tile of rows is the same slice of every group.
+  const int64_t begin = 7, end = 29;
+  std::vector<float> tile(s.g * (end - begin) * group_k);
+  mluoptest::deformIm2col(s, input.data(), offset.data(), mask.data(), begin,
+                          end, tile.data());
+  for (int gi = 0; gi < s.g; ++gi) {
+    ASSERT_TRUE(std::equal(
+        tile.begin() + gi * (end - begin) * group_k,
+        tile.begin() + (gi + 1) * (end - begin) * group_k,
+        columns.begin() + (gi * rows + begin) * group_k));
+  }
+}
+}  // namespace
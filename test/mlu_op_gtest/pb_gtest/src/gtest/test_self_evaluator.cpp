@@ -0,0 +1,87 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "evaluator.h"
+
+namespace {
+// fused evaluation against plain loops, and bitwise equal for any number of
+// host threads.
+TEST(EvaluatorSelfTest, FusedDiff) {
+  using mluoptest::Evaluator;
+  constexpr size_t len = 300007;
+  std::vector<float> baseline(len), mlu(len);
+  std::mt19937 gen(23);
+  std::normal_distribution<float> dis(0, 1);
+  for (size_t i = 0; i < len; i++) {
+    baseline[i] = dis(gen);
+    mlu[i] = baseline[i] + 1e-3f * dis(gen);
+  }
+  // both nan, treated as 0 because all thresholds are 0
+  baseline[7] = NAN;
+  mlu[7] = NAN;
+  double diff1_num = 0, diff1_den = 0, diff3_2 = 0;
+  for (size_t i = 0; i < len; i++) {
+    if (i != 7) {
+      double diff = std::abs((double)mlu[i] - (double)baseline[i]);
+      diff1_num += diff;
+      diff1_den += std::abs((double)baseline[i]);
+      diff3_2 = std::max(diff3_2, diff);
+    }
+  }
+
+  std::set<Evaluator::Criterion> criterions = {
+      Evaluator::Criterion(Evaluator::DIFF1, 0),
+      Evaluator::Criterion(Evaluator::DIFF3_2, 0),
+      Evaluator::Criterion(Evaluator::DIFF4, 0),
+      Evaluator::Criterion(Evaluator::DIFF_KL, 0)};
+  std::vector<Evaluator::ErrorWrap> errors[2];
+  const char *host_threads[] = {"1", "3"};
+  for (int k = 0; k < 2; k++) {
+    setenv("MLUOP_GTEST_HOST_THREADS", host_threads[k], 1);
+    Evaluator eva;
+    eva.computeDiff(baseline.data(), mlu.data(), len, criterions, "output",
+                    MLUOP_DTYPE_FLOAT);
+    errors[k] = eva.errors();
+  }
+  unsetenv("MLUOP_GTEST_HOST_THREADS");
+  ASSERT_EQ(criterions.size(), errors[0].size());
+  ASSERT_EQ(criterions.size(), errors[1].size());
+  for (size_t i = 0; i < criterions.size(); i++) {
+    ASSERT_EQ(errors[0][i].error, errors[1][i].error)
+        << Evaluator::Formula2str(errors[0][i].criterion.formula);
+  }
+  EXPECT_NEAR(diff1_num / (diff1_den + mluoptest::EPSILON), errors[0][0].error,
+              1e-12);
+  EXPECT_EQ(diff3_2, errors[0][1].error);
+  EXPECT_GT(errors[0][2].error, 0.0);
+  EXPECT_LT(errors[0][2].error, 1.0);
+  EXPECT_GT(errors[0][3].error, 0.0);
+}
+}  // namespace
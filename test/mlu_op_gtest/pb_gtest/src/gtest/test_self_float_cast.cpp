@@ -0,0 +1,159 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <cstdint>
+#include <cstring>
+#include <ios>
+#include <random>
+#include <vector>
+
+#include "cnrt.h"
+
+#include "gtest/gtest.h"
+#include "core/float_cast.h"
+#include "math_half.h"
+#include "tools.h"
+
+namespace {
+using mluoptest::AlgoHalfToFloat;
+
+// vectorized kernels in core/float_cast.h must match the scalar ones bit by bit
+TEST(ArrayCastSelfTest, HalfToFloat) {
+  constexpr size_t len = UINT16_MAX + 1 + 13;  // also cover the scalar tail
+  std::vector<uint16_t> src(len);
+  std::vector<float> dst(len);
+  for (size_t i = 0; i < len; i++) {
+    src[i] = static_cast<uint16_t>(i);
+  }
+  auto bits = [](float v) {
+    uint32_t ret;
+    memcpy(&ret, &v, sizeof(ret));
+    return ret;
+  };
+
+  mluop::castHalfToFloat32Array(src.data(), dst.data(), len,
+                                mluop::HALF_TO_FLOAT_SATURATE_SOPA);
+  for (size_t i = 0; i < len; i++) {
+    ASSERT_EQ(bits(mluoptest::cvtHalfToFloatImpl<AlgoHalfToFloat::SOPA>(
+                  src[i])),
+              bits(dst[i]))
+        << "SOPA: src[" << i << "]=0x" << std::hex << src[i];
+  }
+  mluop::castHalfToFloat32Array(src.data(), dst.data(), len,
+                                mluop::HALF_TO_FLOAT_SATURATE_QNAN);
+  for (size_t i = 0; i < len; i++) {
+    ASSERT_EQ(bits(mluoptest::cvtHalfToFloatImpl<AlgoHalfToFloat::MLUOPGTEST2>(
+                  src[i])),
+              bits(dst[i]))
+        << "MLUOPGTEST2: src[" << i << "]=0x" << std::hex << src[i];
+  }
+  mluop::castHalfToFloat32Array(src.data(), dst.data(), len,
+                                mluop::HALF_TO_FLOAT_IEEE);
+  for (size_t i = 0; i < len; i++) {
+    ASSERT_EQ(bits(mluoptest::cvtHalfToFloatImpl<
+                   AlgoHalfToFloat::CPU_INTRINSIC>(src[i])),
+              bits(dst[i]))
+        << "CPU_INTRINSIC: src[" << i << "]=0x" << std::hex << src[i];
+  }
+  mluop::castBfloat16ToFloat32Array(src.data(), dst.data(), len);
+  for (size_t i = 0; i < len; i++) {
+    ASSERT_EQ(static_cast<uint32_t>(src[i]) << 16, bits(dst[i]));
+  }
+}
+
+TEST(ArrayCastSelfTest, FloatToHalf) {
+  constexpr size_t len = (1 << 20) + 13;
+  std::vector<uint32_t> src(len);
+  std::vector<uint16_t> dst(len);
+  // random bit patterns hit nan/inf/denormal, the boundaries are added below
+  std::mt19937 gen(23);
+  for (size_t i = 0; i < len; i++) {
+    src[i] = gen();
+  }
+  const uint32_t special[] = {0x0,        0x80000000, 0x7f800000, 0xff800000,
+                              0x7fc00000, 0x7f800001, 0x477fe000, 0x477ff000,
+                              0x477fefff, 0x47800000, 0x38800000, 0x387fffff,
+                              0x33800000, 0x33000000, 0x33000001, 0x32ffffff};
+  for (size_t i = 0; i < sizeof(special) / sizeof(special[0]); i++) {
+    src[i * 5] = special[i];
+  }
+  const float *src_f = reinterpret_cast<const float *>(src.data());
+
+  const mluop::floatToHalfMode_t modes[] = {
+      mluop::FLOAT_TO_HALF_IEEE, mluop::FLOAT_TO_HALF_SATURATE_RN,
+      mluop::FLOAT_TO_HALF_SATURATE_RU, mluop::FLOAT_TO_HALF_CNRT_RM};
+  for (auto mode : modes) {
+    mluop::castFloat32ToHalfArray(src_f, dst.data(), len, mode);
+    for (size_t i = 0; i < len; i++) {
+      ASSERT_EQ(mluop::castFloat32ToHalfScalar(src_f[i], mode), dst[i])
+          << "mode " << mode << ": src[" << i << "]=0x" << std::hex << src[i];
+    }
+  }
+  mluop::castFloat32ToBfloat16Array(src_f, dst.data(), len);
+  for (size_t i = 0; i < len; i++) {
+    ASSERT_EQ(mluop::castFloat32ToBfloat16Scalar(src_f[i]), dst[i])
+        << "bf16: src[" << i << "]=0x" << std::hex << src[i];
+  }
+  // tools.cpp splits the array casts into chunks over host threads
+  std::vector<uint16_t> dst_chunked(len);
+  mluoptest::arrayCastFloatToBF16(dst_chunked.data(),
+                                  const_cast<float *>(src_f), len);
+  ASSERT_EQ(dst, dst_chunked);
+  std::vector<float> back(len);
+  mluoptest::arrayCastBF16ToFloat(back.data(), dst.data(), len);
+  for (size_t i = 0; i < len; i++) {
+    ASSERT_EQ(static_cast<uint32_t>(dst[i]) << 16,
+              *reinterpret_cast<uint32_t *>(&back[i]))
+        << "bf16: dst[" << i << "]=0x" << std::hex << dst[i];
+  }
+}
+
+// the casts that replaced cnrtCastDataType_V2 in tools.cpp, every input
+TEST(ArrayCastSelfTest, SameAsCnrt) {
+  constexpr size_t chunk = 1 << 24;
+  std::vector<uint32_t> src(chunk);
+  std::vector<int16_t> dst(chunk), dst_cnrt(chunk);
+  for (uint64_t begin = 0; begin < (1ull << 32); begin += chunk) {
+    for (size_t i = 0; i < chunk; i++) {
+      src[i] = static_cast<uint32_t>(begin + i);
+    }
+    float *src_f = reinterpret_cast<float *>(src.data());
+    ASSERT_EQ(cnrtSuccess,
+              cnrtCastDataType_V2(src_f, cnrtFloat, dst_cnrt.data(), cnrtHalf,
+                                  chunk, NULL, cnrtRounding_rm));
+    mluoptest::arrayCastFloatToHalf(dst.data(), src_f, chunk);
+    for (size_t i = 0; i < chunk; i++) {
+      ASSERT_EQ(dst_cnrt[i], dst[i]) << "src=0x" << std::hex << src[i];
+    }
+  }
+  for (uint32_t i = 0; i <= UINT16_MAX; i++) {
+    uint16_t half = static_cast<uint16_t>(i);
+    float value, value_cnrt;
+    ASSERT_EQ(cnrtSuccess, cnrtCastDataType_V2(&half, cnrtHalf, &value_cnrt,
+                                               cnrtFloat, 1, NULL,
+                                               cnrtRounding_rm));
+    ASSERT_EQ(cnrtSuccess, mluoptest::wrapRtConvertHalfToFloat(&value, half));
+    ASSERT_EQ(0, memcmp(&value_cnrt, &value, sizeof(value)))
+        << "src=0x" << std::hex << half;
+  }
+}
+}  // namespace
@@ -0,0 +1,70 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "host_math.h"
+
+namespace {
+TEST(HostMathSelfTest, CompareWithLibm) {
+  // 1001 inputs cover both the vector body and the scalar tail.
+  const size_t num = 1001;
+  std::mt19937 gen(24680);
+  std::uniform_real_distribution<float> mag(-30.0f, 30.0f);
+  std::vector<float> x(num), y(num), tail(num);
+  for (size_t i = 0; i < num; ++i) {
+    x[i] = std::exp(mag(gen));
+  }
+  auto expect_near = [&](const char *name, double (*ref)(double)) {
+    for (size_t i = 0; i < num; ++i) {
+      const float want = (float)ref(x[i]);
+      ASSERT_LE(std::fabs(y[i] - want),
+                std::fabs(std::nextafter(want, 0.0f) - want))
+          << name << " " << x[i];
+    }
+    // the last lane computed alone takes the scalar tail.
+    ASSERT_EQ(tail[num - 1], y[num - 1]) << name;
+  };
+  mluoptest::hostLog(x.data(), y.data(), num);
+  mluoptest::hostLog(x.data() + num - 1, tail.data() + num - 1, 1);
+  expect_near("log", [](double v) { return std::log(v); });
+  mluoptest::hostLgamma(x.data(), y.data(), num);
+  mluoptest::hostLgamma(x.data() + num - 1, tail.data() + num - 1, 1);
+  expect_near("lgamma", [](double v) { return std::lgamma(v); });
+  mluoptest::hostPow(x.data(), 0.75, y.data(), num);
+  mluoptest::hostPow(x.data() + num - 1, 0.75, tail.data() + num - 1, 1);
+  expect_near("pow", [](double v) { return std::pow(v, 0.75); });
+  for (size_t i = 0; i < num; ++i) {
+    x[i] = mag(gen);
+  }
+  mluoptest::hostExp(x.data(), y.data(), num);
+  mluoptest::hostExp(x.data() + num - 1, tail.data() + num - 1, 1);
+  expect_near("exp", [](double v) { return std::exp(v); });
+  mluoptest::hostSigmoid(x.data(), y.data(), num);
+  mluoptest::hostSigmoid(x.data() + num - 1, tail.data() + num - 1, 1);
+  expect_near("sigmoid", [](double v) { return 1.0 / (1.0 + std::exp(-v)); });
+}
+}  // namespace
@@ -0,0 +1,91 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "host_trace.h"
+
+namespace {
+TEST(HostTraceSelfTest, SpansOfThreads) {
+  char tmpl[] = "/tmp/mluop_trace_XXXXXX";
+  int fd = mkstemp(tmpl);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  mluoptest::HostTrace trace(tmpl);
+  ASSERT_TRUE(trace.enabled());
+  const std::string case_path = "cases/\"abs\"/case_0.prototxt";
+  const int thread_num = 4, case_num = 3;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; ++t) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < case_num; ++i) {
+        mluoptest::TraceSpan span("case", case_path, &trace);
+        mluoptest::TraceSpan inner("cpu_compute", &trace);
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  // a disabled trace records nothing.
+  mluoptest::HostTrace disabled("");
+  { mluoptest::TraceSpan span("parse", &disabled); }
+  EXPECT_TRUE(disabled.mergeEvents().empty());
+
+  auto events = trace.mergeEvents();
+  ASSERT_EQ(2 * thread_num * case_num, events.size());
+  std::set<int> tids;
+  for (size_t i = 0; i < events.size(); i += 2) {
+    // inner span ends first and lies within the outer one.
+    const auto &inner = events[i], &outer = events[i + 1];
+    EXPECT_EQ(inner.first, outer.first);
+    EXPECT_STREQ("cpu_compute", inner.second.name);
+    EXPECT_STREQ("case", outer.second.name);
+    EXPECT_TRUE(inner.second.case_path.empty());
+    EXPECT_EQ(case_path, outer.second.case_path);
+    EXPECT_LE(outer.second.begin_ns, inner.second.begin_ns);
+    EXPECT_LE(inner.second.end_ns, outer.second.end_ns);
+    tids.insert(inner.first);
+  }
+  EXPECT_EQ(thread_num, tids.size());
+
+  trace.dump();
+  std::ifstream fin(tmpl);
+  std::string json((std::istreambuf_iterator<char>(fin)),
+                   std::istreambuf_iterator<char>());
+  EXPECT_EQ(0, json.find("{\"displayTimeUnit\": \"ms\", \"traceEvents\": ["));
+  EXPECT_NE(std::string::npos,
+            json.find("\"case\": \"cases/\\\"abs\\\"/case_0.prototxt\""));
+  EXPECT_EQ(json.size() - 3, json.rfind("]}\n"));
+  remove(tmpl);
+}
+}  // namespace
@@ -0,0 +1,317 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "cpu_ms_deform_attn.h"
+
+namespace {
+
+// Bilinear sample of one channel, as the forward baseline did it before
+// cpu_ms_deform_attn.
+float im2colBilinearReference(const float *bottom_data, int height, int width,
+                              int nheads, int channels, float h, float w,
+                              int m, int c) {
+  const int h_low = floorf(h);
+  const int w_low = floorf(w);
+  const int h_high = h_low + 1;
+  const int w_high = w_low + 1;
+  const float lh = h - h_low;
+  const float lw = w - w_low;
+  const float hh = 1 - lh, hw = 1 - lw;
+  const int w_stride = nheads * channels;
+  const int h_stride = width * w_stride;
+  const int h_low_ptr_offset = h_low * h_stride;
+  const int h_high_ptr_offset = h_low_ptr_offset + h_stride;
+  const int w_low_ptr_offset = w_low * w_stride;
+  const int w_high_ptr_offset = w_low_ptr_offset + w_stride;
+  const int base_ptr = m * channels + c;
+  float v1 = 0;
+  if (h_low >= 0 && w_low >= 0) {
+    v1 = bottom_data[h_low_ptr_offset + w_low_ptr_offset + base_ptr];
+  }
+  float v2 = 0;
+  if (h_low >= 0 && w_high <= width - 1) {
+    v2 = bottom_data[h_low_ptr_offset + w_high_ptr_offset + base_ptr];
+  }
+  float v3 = 0;
+  if (h_high <= height - 1 && w_low >= 0) {
+    v3 = bottom_data[h_high_ptr_offset + w_low_ptr_offset + base_ptr];
+  }
+  float v4 = 0;
+  if (h_high <= height - 1 && w_high <= width - 1) {
+    v4 = bottom_data[h_high_ptr_offset + w_high_ptr_offset + base_ptr];
+  }
+  const float w1 = hh * hw, w2 = hh * lw, w3 = lh * hw, w4 = lh * lw;
+  return (w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4);
+}
+
+// The forward baseline before cpu_ms_deform_attn, one output element at a
+// time.
+void forwardReference(const float *data_value,
+                      const float *data_spatial_shapes,
+                      const float *data_level_start_index,
+                      const float *data_sampling_loc,
+                      const float *data_attn_weight, int batch_size,
+                      int num_keys, int num_heads, int channels,
+                      int num_levels, int num_query, int num_point,
+                      float *data_col) {
+  const int n = batch_size * num_query * num_heads * channels;
+  for (int index = 0; index < n; ++index) {
+    const int c_col = index % channels;
+    const int sampling_index = index / channels;
+    const int m_col = sampling_index % num_heads;
+    const int b_col = sampling_index / num_heads / num_query;
+    int data_weight_ptr = sampling_index * num_levels * num_point;
+    int data_loc_w_ptr = data_weight_ptr << 1;
+    const int qid_stride = num_heads * channels;
+    float col = 0;
+    for (int l_col = 0; l_col < num_levels; ++l_col) {
+      const int level_start_id = data_level_start_index[l_col];
+      const int spatial_h = data_spatial_shapes[l_col << 1];
+      const int spatial_w = data_spatial_shapes[(l_col << 1) + 1];
+      const float *data_value_ptr =
+          data_value + (b_col * num_keys + level_start_id) * qid_stride;
+      for (int p_col = 0; p_col < num_point; ++p_col) {
+        const float loc_w = data_sampling_loc[data_loc_w_ptr];
+        const float loc_h = data_sampling_loc[data_loc_w_ptr + 1];
+        const float weight = data_attn_weight[data_weight_ptr];
+        const float h_im = loc_h * spatial_h - 0.5;
+        const float w_im = loc_w * spatial_w - 0.5;
+        if (h_im > -1 && w_im > -1 && h_im < spatial_h && w_im < spatial_w) {
+          col += im2colBilinearReference(data_value_ptr, spatial_h, spatial_w,
+                                         num_heads, channels, h_im, w_im,
+                                         m_col, c_col) *
+                 weight;
+        }
+        data_weight_ptr += 1;
+        data_loc_w_ptr += 2;
+      }
+    }
+    data_col[index] = col;
+  }
+}
+
+// Backward of one bilinear sample of one channel, as the backward baseline
+// did it before cpu_ms_deform_attn.
+void col2imBilinearReference(const float *bottom_data, int height, int width,
+                             int nheads, int channels, float h, float w,
+                             int m, int c, float top_grad, float attn_weight,
+                             float *grad_data_value, float *grad_sampling_loc,
+                             float *grad_attn_weight) {
+  const int h_low = floorf(h);
+  const int w_low = floorf(w);
+  const int h_high = h_low + 1;
+  const int w_high = w_low + 1;
+  const float lh = h - h_low;
+  const float lw = w - w_low;
+  const float hh = 1 - lh, hw = 1 - lw;
+  const int w_stride = nheads * channels;
+  const int h_stride = width * w_stride;
+  const int h_low_ptr_offset = h_low * h_stride;
+  const int h_high_ptr_offset = h_low_ptr_offset + h_stride;
+  const int w_low_ptr_offset = w_low * w_stride;
+  const int w_high_ptr_offset = w_low_ptr_offset + w_stride;
+  const int base_ptr = m * channels + c;
+  const float w1 = hh * hw, w2 = hh * lw, w3 = lh * hw, w4 = lh * lw;
+  const float top_grad_value = top_grad * attn_weight;
+  float grad_h_weight = 0, grad_w_weight = 0;
+  float v1 = 0;
+  if (h_low >= 0 && w_low >= 0) {
+    const int ptr1 = h_low_ptr_offset + w_low_ptr_offset + base_ptr;
+    v1 = bottom_data[ptr1];
+    grad_h_weight -= hw * v1;
+    grad_w_weight -= hh * v1;
+    grad_data_value[ptr1] = grad_data_value[ptr1] + w1 * top_grad_value;
+  }
+  float v2 = 0;
+  if (h_low >= 0 && w_high <= width - 1) {
+    const int ptr2 = h_low_ptr_offset + w_high_ptr_offset + base_ptr;
+    v2 = bottom_data[ptr2];
+    grad_h_weight -= lw * v2;
+    grad_w_weight += hh * v2;
+    grad_data_value[ptr2] = grad_data_value[ptr2] + w2 * top_grad_value;
+  }
+  float v3 = 0;
+  if (h_high <= height - 1 && w_low >= 0) {
+    const int ptr3 = h_high_ptr_offset + w_low_ptr_offset + base_ptr;
+    v3 = bottom_data[ptr3];
+    grad_h_weight += hw * v3;
+    grad_w_weight -= lh * v3;
+    grad_data_value[ptr3] = grad_data_value[ptr3] + w3 * top_grad_value;
+  }
+  float v4 = 0;
+  if (h_high <= height - 1 && w_high <= width - 1) {
+    const int ptr4 = h_high_ptr_offset + w_high_ptr_offset + base_ptr;
+    v4 = bottom_data[ptr4];
+    grad_h_weight += lw * v4;
+    grad_w_weight += lh * v4;
+    grad_data_value[ptr4] = grad_data_value[ptr4] + w4 * top_grad_value;
+  }
+  float val = (w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4);
+  *grad_attn_weight += top_grad * val;
+  *grad_sampling_loc += width * grad_w_weight * top_grad_value;
+  *(grad_sampling_loc + 1) += height * grad_h_weight * top_grad_value;
+}
+
+// The backward baseline before cpu_ms_deform_attn, one grad_output element
+// at a time.
+void backwardReference(const float *value, const float *spatial_shapes,
+                       const float *level_start_index,
+                       const float *sampling_loc, const float *attn_weight,
+                       const float *grad_output, int batch, int spatial_size,
+                       int num_heads, int channels, int num_levels,
+                       int num_query, int num_point, float *grad_value,
+                       float *grad_sampling_loc, float *grad_attn_weight) {
+  const int qid_stride = num_heads * channels;
+  for (int i = 0; i < batch * num_query * num_heads * channels; ++i) {
+    const int c_col = i % channels;
+    const int sampling_index = i / channels;
+    const int m_col = sampling_index % num_heads;
+    const int b_col = sampling_index / num_heads / num_query;
+    const float top_grad = grad_output[i];
+    int data_weight_ptr = sampling_index * num_levels * num_point;
+    for (int l_col = 0; l_col < num_levels; ++l_col) {
+      const int level_start_id = level_start_index[l_col];
+      const int spatial_h = spatial_shapes[l_col << 1];
+      const int spatial_w = spatial_shapes[(l_col << 1) + 1];
+      const int value_ptr_offset =
+          (b_col * spatial_size + level_start_id) * qid_stride;
+      for (int p_col = 0; p_col < num_point; ++p_col, ++data_weight_ptr) {
+        const float loc_w = sampling_loc[data_weight_ptr << 1];
+        const float loc_h = sampling_loc[(data_weight_ptr << 1) + 1];
+        const float weight = attn_weight[data_weight_ptr];
+        const float h_im = loc_h * spatial_h - 0.5;
+        const float w_im = loc_w * spatial_w - 0.5;
+        if (h_im > -1 && w_im > -1 && h_im < spatial_h && w_im < spatial_w) {
+          col2imBilinearReference(
+              value + value_ptr_offset, spatial_h, spatial_w, num_heads,
+              channels, h_im, w_im, m_col, c_col, top_grad, weight,
+              grad_value + value_ptr_offset,
+              grad_sampling_loc + (data_weight_ptr << 1),
+              grad_attn_weight + data_weight_ptr);
+        }
+      }
+    }
+  }
+}
+
+// random shapes with sample points inside, on the border of and outside
+// each level, against the per channel loops, bit for bit. Many queries now
+// and then, so the forward rows run in several chunks.
+TEST(CpuMsDeformAttnSelfTest, CompareWithPerChannel) {
+  std::mt19937 gen(2024);
+  auto pick = [&gen](int lo, int hi) {
+    return std::uniform_int_distribution<int>(lo, hi)(gen);
+  };
+  std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+  for (int iter = 0; iter < 400; ++iter) {
+    const int batch = pick(1, 3);
+    const int num_heads = pick(1, 4);
+    const int channels = pick(1, 17);
+    const int num_levels = pick(1, 3);
+    const int num_query = pick(0, 7) == 0 ? pick(200, 600) : pick(1, 20);
+    const int num_point = pick(1, 4);
+    std::vector<float> spatial_shapes(num_levels * 2);
+    std::vector<float> level_start_index(num_levels);
+    int num_keys = 0;
+    for (int l = 0; l < num_levels; ++l) {
+      spatial_shapes[l * 2] = pick(1, 7);
+      spatial_shapes[l * 2 + 1] = pick(1, 7);
+      level_start_index[l] = num_keys;
+      num_keys += spatial_shapes[l * 2] * spatial_shapes[l * 2 + 1];
+    }
+    const size_t samples =
+        (size_t)batch * num_query * num_heads * num_levels * num_point;
+    std::vector<float> value((size_t)batch * num_keys * num_heads * channels);
+    std::vector<float> sampling_loc(samples * 2);
+    std::vector<float> attn_weight(samples);
+    std::vector<float> grad_output((size_t)batch * num_query * num_heads *
+                                   channels);
+    for (auto &v : value) {
+      v = uniform(gen);
+    }
+    for (auto &v : attn_weight) {
+      v = uniform(gen);
+    }
+    for (auto &v : grad_output) {
+      v = uniform(gen);
+    }
+    for (auto &v : sampling_loc) {
+      // mostly inside, some on the border and some off the map.
+      switch (pick(0, 7)) {
+        case 0:
+          v = pick(0, 1);
+          break;
+        case 1:
+          v = uniform(gen) * 2.0f;
+          break;
+        default:
+          v = (uniform(gen) + 1.0f) * 0.5f;
+      }
+    }
+
+    std::vector<float> expected_col(grad_output.size(), -3.0f);
+    std::vector<float> actual_col(expected_col);
+    forwardReference(value.data(), spatial_shapes.data(),
+                     level_start_index.data(), sampling_loc.data(),
+                     attn_weight.data(), batch, num_keys, num_heads, channels,
+                     num_levels, num_query, num_point, expected_col.data());
+    mluoptest::msDeformAttnForwardCpu(
+        value.data(), spatial_shapes.data(), level_start_index.data(),
+        sampling_loc.data(), attn_weight.data(), batch, num_keys, num_heads,
+        channels, num_levels, num_query, num_point, actual_col.data());
+    ASSERT_EQ(0, memcmp(expected_col.data(), actual_col.data(),
+                        expected_col.size() * sizeof(float)))
+        << "forward, iter " << iter;
+
+    std::vector<float> expected_grad(value.size() + samples * 3, 0.0f);
+    std::vector<float> actual_grad(expected_grad);
+    auto outputs = [&](std::vector<float> *grad) {
+      float *grad_value = grad->data();
+      float *grad_sampling_loc = grad_value + value.size();
+      return std::vector<float *>{grad_value, grad_sampling_loc,
+                                  grad_sampling_loc + samples * 2};
+    };
+    auto e = outputs(&expected_grad);
+    backwardReference(value.data(), spatial_shapes.data(),
+                      level_start_index.data(), sampling_loc.data(),
+                      attn_weight.data(), grad_output.data(), batch, num_keys,
+                      num_heads, channels, num_levels, num_query, num_point,
+                      e[0], e[1], e[2]);
+    auto a = outputs(&actual_grad);
+    mluoptest::msDeformAttnBackwardCpu(
+        value.data(), spatial_shapes.data(), level_start_index.data(),
+        sampling_loc.data(), attn_weight.data(), grad_output.data(), batch,
+        num_keys, num_heads, channels, num_levels, num_query, num_point, a[0],
+        a[1], a[2]);
+    ASSERT_EQ(0, memcmp(expected_grad.data(), actual_grad.data(),
+                        expected_grad.size() * sizeof(float)))
+        << "backward, iter " << iter;
+  }
+}
+}  // namespace
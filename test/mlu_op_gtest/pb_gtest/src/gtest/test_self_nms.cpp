@@ -0,0 +1,236 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "cpu_nms.h"
+
+namespace {
+using mluoptest::NmsParam;
+
+// The greedy 2D NMS the baseline used before cpu_nms, for one (batch, class)
+// pair: every round takes the arg max score and rescans all boxes.
+int nmsGreedyReference(float *output_data, const float *input_data,
+                       const float *input_score, int input_box_num,
+                       int input_layout, mluOpNmsOutputMode_t output_mode,
+                       const NmsParam &param, int batch_idx, int class_idx) {
+  const int keepNum = param.keep_num;
+  const float offset = param.offset;
+  std::vector<float> score(input_score, input_score + input_box_num);
+  std::vector<float> x1(input_box_num), y1(input_box_num);
+  std::vector<float> x2(input_box_num), y2(input_box_num);
+  for (int i = 0; i < input_box_num; i++) {
+    if (input_layout == 0) {
+      x1[i] = input_data[0 + i * 4];
+      y1[i] = input_data[1 + i * 4];
+      x2[i] = input_data[2 + i * 4];
+      y2[i] = input_data[3 + i * 4];
+    } else {
+      x1[i] = input_data[i];
+      y1[i] = input_data[i + input_box_num];
+      x2[i] = input_data[i + 2 * input_box_num];
+      y2[i] = input_data[i + 3 * input_box_num];
+    }
+  }
+  // same corners for the selected box and for box i, as in the old loop.
+  auto corners = [&](int i, float *c) {
+    c[0] = x1[i], c[1] = y1[i], c[2] = x2[i], c[3] = y2[i];
+    if (param.box_mode == 0) {
+      if (c[0] > c[2]) std::swap(c[0], c[2]);
+      if (c[1] > c[3]) std::swap(c[1], c[3]);
+    } else if (param.box_mode == 1) {
+      c[0] = c[0] - c[2] * 0.5;
+      c[2] = c[0] + c[2];
+      c[1] = c[1] - c[3] * 0.5;
+      c[3] = c[1] + c[3];
+    }
+  };
+  int output_box_num = 0;
+  for (int keep = 0; keep < keepNum; keep++) {
+    float max_score = score[0];
+    int max_index = 0;
+    for (int i = 1; i < input_box_num; i++) {
+      if (score[i] > max_score) {
+        max_score = score[i];
+        max_index = i;
+      }
+    }
+    if (max_score <= param.thresh_score) {
+      break;
+    }
+    if (output_mode == 0) {
+      output_data[output_box_num] = max_index;
+    } else if (output_mode == 1) {
+      output_data[output_box_num * 5 + 0] = max_score;
+      output_data[output_box_num * 5 + 1] = x1[max_index];
+      output_data[output_box_num * 5 + 2] = y1[max_index];
+      output_data[output_box_num * 5 + 3] = x2[max_index];
+      output_data[output_box_num * 5 + 4] = y2[max_index];
+    } else if (output_mode == 2) {
+      output_data[0 * keepNum + output_box_num] = max_score;
+      output_data[1 * keepNum + output_box_num] = x1[max_index];
+      output_data[2 * keepNum + output_box_num] = y1[max_index];
+      output_data[3 * keepNum + output_box_num] = x2[max_index];
+      output_data[4 * keepNum + output_box_num] = y2[max_index];
+    } else {
+      output_data[output_box_num * 3 + 0] = batch_idx;
+      output_data[output_box_num * 3 + 1] = class_idx;
+      output_data[output_box_num * 3 + 2] = max_index;
+    }
+    output_box_num++;
+    score[max_index] = 0;
+
+    float m[4];
+    corners(max_index, m);
+    float max_area = 0;
+    if (param.algo == 0 || offset == 0.0) {
+      max_area = (m[2] - m[0]) * (m[3] - m[1]);
+    } else {
+      max_area = (m[2] - m[0] + offset) * (m[3] - m[1] + offset);
+    }
+    for (int i = 0; i < input_box_num; i++) {
+      float c[4];
+      corners(i, c);
+      float area_cur = 0.0;
+      if (param.algo == 1) {
+        area_cur = (c[2] - c[0] + offset) * (c[3] - c[1] + offset);
+      } else {
+        area_cur = (c[2] - c[0]) * (c[3] - c[1]);
+      }
+      float inter_x1 = (m[0] > c[0] ? m[0] : c[0]);
+      float inter_y1 = (m[1] > c[1] ? m[1] : c[1]);
+      float inter_x2 = (m[2] > c[2] ? c[2] : m[2]);
+      float inter_y2 = (m[3] > c[3] ? c[3] : m[3]);
+      float inter_w = 0.0, inter_h = 0.0;
+      if (param.algo == 1) {
+        inter_w = inter_x2 - inter_x1 + offset;
+        inter_h = inter_y2 - inter_y1 + offset;
+      } else {
+        inter_w = inter_x2 - inter_x1;
+        inter_h = inter_y2 - inter_y1;
+      }
+      if (inter_w < 0) {
+        inter_w = 0;
+      }
+      if (inter_h < 0) {
+        inter_h = 0;
+      }
+      float area_I = inter_w * inter_h;
+      float area_U = max_area + area_cur - area_I;
+      float iou = area_I / area_U;
+      if (param.method_mode == 0) {
+        if (iou > param.thresh_iou) {
+          score[i] = 0;
+        }
+      } else if (param.method_mode == 1) {
+        score[i] = iou > param.thresh_iou ? score[i] * (1 - iou) : score[i];
+      } else {
+        if (param.soft_nms_sigma > 0.0) {
+          score[i] *= exp(-iou * iou / (2 * param.soft_nms_sigma));
+        } else {
+          score[i] = (iou > param.thresh_iou) ? 0.0 : score[i];
+        }
+      }
+    }
+  }
+  return output_box_num;
+}
+
+// random cases with ties, NaN and negative scores, duplicated and
+// degenerate boxes, against the old greedy loop, bit for bit.
+TEST(CpuNmsSelfTest, CompareWithGreedy) {
+  std::mt19937 gen(2024);
+  auto uniform = [&gen](float lo, float hi) {
+    return std::uniform_real_distribution<float>(lo, hi)(gen);
+  };
+  auto pick = [&gen](int n) {
+    return std::uniform_int_distribution<int>(0, n - 1)(gen);
+  };
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  for (int iter = 0; iter < 600; ++iter) {
+    const int batches = 1 + pick(2);
+    const int classes = 1 + pick(3);
+    const int boxes_num = 1 + pick(48);
+    const int layout = pick(2);
+    const auto mode = (mluOpNmsOutputMode_t)pick(4);
+    NmsParam param;
+    param.keep_num = 1 + pick(boxes_num + 4);
+    param.thresh_iou = pick(4) == 0 ? 0.0f : uniform(0.0f, 0.9f);
+    param.thresh_score = pick(3) == 0 ? -1.0f : uniform(0.0f, 0.5f);
+    param.algo = (mluOpNmsAlgo_t)pick(2);
+    param.offset = pick(2) == 0 ? 0.0f : 1.0f;
+    param.box_mode = (mluOpNmsBoxPointMode_t)pick(2);
+    param.method_mode = (mluOpNmsMethodMode_t)pick(3);
+    param.soft_nms_sigma = pick(2) == 0 ? 0.0f : uniform(0.1f, 1.0f);
+
+    std::vector<float> boxes(batches * boxes_num * 4);
+    for (auto &v : boxes) {
+      v = pick(4) == 0 ? (float)pick(8) : uniform(0.0f, 16.0f);
+    }
+    if (boxes_num > 1 && pick(2) == 0) {  // a duplicated box
+      for (int k = 0; k < 4; ++k) {
+        int stride = layout == 0 ? 1 : boxes_num;
+        int step = layout == 0 ? 4 : 1;
+        boxes[k * stride + step] = boxes[k * stride];
+      }
+    }
+    std::vector<float> scores(batches * classes * boxes_num);
+    const bool with_nan = pick(4) == 0;
+    for (auto &v : scores) {
+      int kind = pick(8);
+      // a few distinct values make ties likely.
+      v = kind < 3 ? pick(4) * 0.25f : uniform(-0.2f, 1.0f);
+      if (with_nan && kind == 7) {
+        v = nan;
+      }
+    }
+
+    const size_t out_size = 5 * param.keep_num +
+                            3 * batches * classes * param.keep_num;
+    std::vector<float> expected(out_size, -7.0f), actual(out_size, -7.0f);
+    int expected_num = 0;
+    for (int b = 0; b < batches; ++b) {
+      for (int c = 0; c < classes; ++c) {
+        int output_offset = mode == 3 ? 3 * expected_num : 0;
+        expected_num += nmsGreedyReference(
+            expected.data() + output_offset,
+            boxes.data() + boxes_num * 4 * b,
+            scores.data() + (b * classes + c) * boxes_num, boxes_num, layout,
+            mode, param, b, c);
+      }
+    }
+    int actual_num = mluoptest::nmsDetectionCpu(
+        actual.data(), boxes.data(), scores.data(), batches, classes,
+        boxes_num, layout, mode, param);
+    ASSERT_EQ(expected_num, actual_num) << "iter " << iter;
+    ASSERT_EQ(0, memcmp(expected.data(), actual.data(),
+                        out_size * sizeof(float)))
+        << "iter " << iter << ", method_mode " << param.method_mode;
+  }
+}
+}  // namespace
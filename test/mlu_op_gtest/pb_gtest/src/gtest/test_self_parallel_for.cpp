@@ -0,0 +1,75 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <atomic>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "parallel_for.h"
+
+namespace {
+// every chunk runs once, also for nested and many back-to-back loops on the
+// shared host pool.
+TEST(ParallelForSelfTest, ChunksOnceOnPool) {
+  setenv("MLUOP_GTEST_HOST_THREADS", "4", 1);
+  for (size_t n : {1, 7, 64, 1000, 100000}) {
+    for (size_t grain : {1, 3, 64, 5000}) {
+      const size_t chunk_num = (n + grain - 1) / grain;
+      std::vector<std::atomic<int>> hits(n);
+      std::vector<std::atomic<int>> chunk_hits(chunk_num);
+      mluoptest::parallelForChunks(
+          n, grain, [&](size_t id, size_t begin, size_t end) {
+            ASSERT_EQ(id * grain, begin);
+            ++chunk_hits[id];
+            for (size_t i = begin; i < end; ++i) ++hits[i];
+          });
+      for (size_t i = 0; i < n; ++i) ASSERT_EQ(1, hits[i]) << n << " " << i;
+      for (auto &h : chunk_hits) ASSERT_EQ(1, h);
+    }
+  }
+  std::atomic<size_t> sum(0);
+  mluoptest::parallelForChunks(8, 1, [&](size_t, size_t, size_t) {
+    mluoptest::parallelForChunks(100, 7, [&](size_t, size_t begin,
+                                             size_t end) {
+      sum += end - begin;
+    });
+  });
+  EXPECT_EQ(800, sum);
+  // helpers that start after a loop returned must not touch it.
+  for (int i = 0; i < 20000; ++i) {
+    int count = 0;
+    mluoptest::parallelForChunks(2, 1, [&](size_t id, size_t, size_t) {
+      if (id == 0) count = 1;
+    });
+    ASSERT_EQ(1, count);
+  }
+  EXPECT_THROW(mluoptest::parallelForChunks(
+                   1000, 1,
+                   [](size_t id, size_t, size_t) {
+                     if (id == 500) throw std::runtime_error("chunk");
+                   }),
+               std::runtime_error);
+  unsetenv("MLUOP_GTEST_HOST_THREADS");
+}
+}  // namespace
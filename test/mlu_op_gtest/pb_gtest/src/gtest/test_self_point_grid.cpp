@@ -0,0 +1,81 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "point_grid.h"
+
+namespace {
+TEST(PointGridSelfTest, CompareWithScan) {
+  std::mt19937 gen(4321);
+  // rounded coordinates give many duplicates and distance ties.
+  std::uniform_int_distribution<int> dist(-4, 4);
+  const int64_t n = 500;
+  std::vector<float> xyz(n * 3);
+  for (auto &v : xyz) v = dist(gen) * 0.5f;
+  mluoptest::PointGrid grid;
+  grid.build(xyz.data(), n);
+  std::vector<int32_t> indices;
+  for (int q = 0; q < 200; ++q) {
+    const float query[3] = {dist(gen) * 0.3f, dist(gen) * 0.3f,
+                            dist(gen) * 0.3f};
+    const float min_radius = 0.25f, max_radius = 1.0f;
+    const int64_t nsample = 16;
+    std::vector<int32_t> expect_ball;
+    double expect_dist[3] = {1e40, 1e40, 1e40};
+    int expect_idx[3] = {0, 0, 0};
+    for (int64_t i = 0; i < n; ++i) {
+      float dx = query[0] - xyz[i * 3], dy = query[1] - xyz[i * 3 + 1],
+            dz = query[2] - xyz[i * 3 + 2];
+      float d2 = dx * dx + dy * dy + dz * dz;
+      if ((int64_t)expect_ball.size() < nsample &&
+          (d2 == 0 || (d2 >= min_radius * min_radius &&
+                       d2 < max_radius * max_radius))) {
+        expect_ball.push_back((int32_t)i);
+      }
+      for (int k = 0; k < 3; ++k) {
+        if (d2 < expect_dist[k]) {
+          for (int j = 2; j > k; --j) {
+            expect_dist[j] = expect_dist[j - 1];
+            expect_idx[j] = expect_idx[j - 1];
+          }
+          expect_dist[k] = d2;
+          expect_idx[k] = (int)i;
+          break;
+        }
+      }
+    }
+    grid.radiusQuery(query, min_radius, max_radius, nsample, &indices);
+    ASSERT_EQ(expect_ball, indices) << "query " << q;
+    double nearest_dist[3];
+    int nearest_idx[3];
+    grid.threeNearest(query, nearest_dist, nearest_idx);
+    for (int k = 0; k < 3; ++k) {
+      ASSERT_EQ(expect_dist[k], nearest_dist[k]) << "query " << q;
+      ASSERT_EQ(expect_idx[k], nearest_idx[k]) << "query " << q;
+    }
+  }
+}
+}  // namespace
@@ -0,0 +1,88 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "roi_sampler.h"
+
+namespace {
+TEST(RoiSamplerSelfTest, CompareWithScalar) {
+  // 21 channels cover both the vector body and the scalar tail.
+  const int H = 5, W = 7, C = 21;
+  std::mt19937 gen(2468);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::uniform_real_distribution<float> coord(-2.0f, 8.0f);
+  std::vector<float> input(H * W * C);
+  for (auto &v : input) v = dist(gen);
+  auto scalar = [&](float y, float x, int c) {
+    if (y < -1.0f || y > H || x < -1.0f || x > W) return 0.0f;
+    y = std::max(y, 0.0f);
+    x = std::max(x, 0.0f);
+    const int y_low = std::min((int)y, H - 1), x_low = std::min((int)x, W - 1);
+    const int y_high = std::min(y_low + 1, H - 1);
+    const int x_high = std::min(x_low + 1, W - 1);
+    const float fy = y >= H - 1 ? 0.0f : y - y_low;
+    const float fx = x >= W - 1 ? 0.0f : x - x_low;
+    auto at = [&](int yy, int xx) { return input[(yy * W + xx) * C + c]; };
+    return (1 - fy) * (1 - fx) * at(y_low, x_low) +
+           (1 - fy) * fx * at(y_low, x_high) +
+           fy * (1 - fx) * at(y_high, x_low) + fy * fx * at(y_high, x_high);
+  };
+  std::vector<float> value(C), sum(C), grad(C), grad_input(H * W * C);
+  for (int i = 0; i < 500; ++i) {
+    const float y = coord(gen), x = coord(gen);
+    mluoptest::BilinearTap tap;
+    mluoptest::makeBilinearTap(H, W, y, x, C, &tap);
+    mluoptest::bilinearGather(tap, input.data(), C, value.data());
+    std::fill(sum.begin(), sum.end(), 1.0f);
+    mluoptest::bilinearAccumulate(tap, input.data(), C, sum.data());
+    for (int c = 0; c < C; ++c) {
+      ASSERT_NEAR(value[c], scalar(y, x, c), 1e-5) << y << " " << x;
+      ASSERT_NEAR(sum[c], 1.0f + value[c], 1e-5);
+    }
+    // the scatter is the transpose of the gather
+    for (auto &g : grad) g = dist(gen);
+    std::fill(grad_input.begin(), grad_input.end(), 0.0f);
+    mluoptest::bilinearScatter(tap, grad.data(), 2.0f, C, grad_input.data());
+    double lhs = 0, rhs = 0;
+    for (int c = 0; c < C; ++c) lhs += (double)value[c] * grad[c] / 2;
+    for (int k = 0; k < H * W * C; ++k) rhs += (double)grad_input[k] * input[k];
+    ASSERT_NEAR(lhs, rhs, 1e-4);
+  }
+}
+
+TEST(RoiSamplerSelfTest, SlicesCoverEveryChannelOnce) {
+  for (int batch : {1, 3, 17}) {
+    for (int channels : {1, 8, 33, 500}) {
+      std::vector<int> hits(batch * channels, 0);
+      mluoptest::roiScatterSlices(
+          batch, channels, [&](int image, int c_begin, int c_end) {
+            for (int c = c_begin; c < c_end; ++c) ++hits[image * channels + c];
+          });
+      ASSERT_EQ(std::count(hits.begin(), hits.end(), 1), batch * channels);
+    }
+  }
+}
+}  // namespace
@@ -0,0 +1,82 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "rotated_iou.h"
+
+namespace {
+TEST(RotatedIouSelfTest, KnownOverlaps) {
+  // identical, half shifted, rotated square in square, disjoint
+  const float boxes1[] = {0, 0, 2, 2, 0.5f, 0, 0, 2, 2, 0,
+                          0, 0, 2, 2, 0,    0, 0, 2, 2, 0};
+  const float boxes2[] = {0, 0, 2, 2, 0.5f, 1, 0, 2, 2, 0,
+                          0, 0, 1, 1, 0.7f, 5, 5, 2, 2, 0.3f};
+  const float expected[] = {1.0f, 2.0f / 6.0f, 0.25f, 0.0f};
+  for (auto flavor : {mluoptest::kBoxIouRotatedFlavor,
+                      mluoptest::kNmsRotatedFlavor}) {
+    mluoptest::RotatedBoxes b1(boxes1, 4, 5, flavor);
+    mluoptest::RotatedBoxes b2(boxes2, 4, 5, flavor);
+    float ious[4];
+    mluoptest::rotatedBoxIouMatrix(b1, b2, 0, true, ious);
+    for (int i = 0; i < 4; ++i) {
+      ASSERT_NEAR(ious[i], expected[i], 1e-5) << "pair " << i;
+    }
+  }
+  const float quads[] = {0, 0, 2, 0, 2, 2, 0, 2, 1, 1, 0, 3, 0, 3, 2, 1, 2, 1,
+                         5, 5, 6, 5, 6, 6, 5, 6, 1};
+  mluoptest::QuadPolygons polys(quads, 3, 9);
+  ASSERT_NEAR(mluoptest::quadPolygonIou(polys, 0, 1), 1.0f / 3.0f, 1e-5);
+  ASSERT_TRUE(polys.apart(0, 2));
+  ASSERT_FALSE(polys.apart(0, 1));
+}
+
+// same kept positions as the sequential loop, across several blocks.
+TEST(RotatedIouSelfTest, GreedyNmsKeep) {
+  for (int64_t num : {0, 1, 63, 64, 65, 300}) {
+    for (uint64_t salt : {3, 7, 31}) {
+      auto suppress = [salt](int64_t a, int64_t b) {
+        uint64_t h = (uint64_t)a * 0x9e3779b97f4a7c15ULL ^ (uint64_t)b * salt;
+        h ^= h >> 29;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        return (h >> 32) % salt == 0;
+      };
+      std::vector<uint8_t> suppressed(num, 0);
+      std::vector<int64_t> expected;
+      for (int64_t a = 0; a < num; ++a) {
+        if (suppressed[a]) {
+          continue;
+        }
+        expected.push_back(a);
+        for (int64_t b = a + 1; b < num; ++b) {
+          suppressed[b] |= suppress(a, b);
+        }
+      }
+      ASSERT_EQ(expected, mluoptest::greedyNmsKeep(num, suppress))
+          << "num " << num << ", salt " << salt;
+    }
+  }
+}
+}  // namespace
@@ -0,0 +1,120 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "runtime.h"
+
+namespace {
+struct RuntimeTag {
+  int id;
+};
+int next_runtime_tag = 0;
+std::vector<int> destroyed_runtime_tags;
+mluOpStatus_t createRuntimeTag(RuntimeTag **tag) {
+  *tag = new RuntimeTag{next_runtime_tag++};
+  return MLUOP_STATUS_SUCCESS;
+}
+mluOpStatus_t destroyRuntimeTag(RuntimeTag *tag) {
+  destroyed_runtime_tags.push_back(tag->id);
+  delete tag;
+  return MLUOP_STATUS_SUCCESS;
+}
+
+TEST(CPURuntimeSelfTest, ArenaAndPool) {
+  EXPECT_EQ(256, mluoptest::CPUMemoryPool::sizeClass(1));
+  EXPECT_EQ(320, mluoptest::CPUMemoryPool::sizeClass(257));
+  EXPECT_EQ(512, mluoptest::CPUMemoryPool::sizeClass(512));
+  EXPECT_EQ(640, mluoptest::CPUMemoryPool::sizeClass(513));
+
+  auto cmp = std::make_shared<mluoptest::CPUMemoryPool>();
+  void *big = nullptr;
+  {
+    mluoptest::CPURuntime rt;
+    rt.init(cmp);
+    // small buffers: last one freed is reused at once
+    char *a = (char *)rt.allocate((size_t)100);
+    char *b = (char *)rt.allocate((size_t)100);
+    ASSERT_EQ(0, (size_t)a % 64);
+    ASSERT_EQ(a + 128, b);
+    memset(b, 0xff, 100);
+    rt.deallocate(b);
+    // reused buffers are zero-filled
+    EXPECT_EQ(b, rt.allocate((size_t)64));
+    EXPECT_EQ(std::string(64, '\0'), std::string(b, 64));
+    EXPECT_THROW(rt.deallocate(b + 1), std::invalid_argument);
+
+    big = rt.allocate((size_t)(1 << 20) + 1);
+    memset(big, 0xff, (1 << 20) + 1);
+    rt.deallocate(big);
+    EXPECT_THROW(rt.deallocate(big), std::invalid_argument);
+    EXPECT_EQ(4, rt.getStats().alloc_num);
+    EXPECT_GT(rt.getStats().peak_bytes, (size_t)1 << 20);
+  }
+  // big buffer is reused by the next case on the same pool
+  mluoptest::CPURuntime rt;
+  rt.init(cmp);
+  EXPECT_EQ(big, rt.allocate((size_t)(1 << 20) + 100));
+  EXPECT_EQ(1, rt.getStats().reused_num);
+  EXPECT_EQ(std::string((1 << 20) + 100, '\0'),
+            std::string((char *)big, (1 << 20) + 100));
+}
+
+// blocks left at the end of a case are released in allocation order, also
+// after holes of freed blocks were compacted.
+TEST(CPURuntimeSelfTest, DestroyOrder) {
+  const int num = 300;
+  next_runtime_tag = 0;
+  destroyed_runtime_tags.clear();
+  std::vector<int> expected;
+  {
+    mluoptest::CPURuntime rt;
+    std::vector<RuntimeTag *> tags;
+    for (int i = 0; i < num; ++i) {
+      tags.push_back(rt.allocate(createRuntimeTag, destroyRuntimeTag));
+    }
+    for (int i = num - 1; i >= 0; --i) {
+      if (i % 3 != 0) {
+        rt.deallocate(tags[i]);
+        expected.push_back(i);
+      }
+    }
+    ASSERT_EQ(expected, destroyed_runtime_tags);
+    // new blocks go after the ones still alive
+    for (int i = 0; i < 10; ++i) {
+      rt.allocate(createRuntimeTag, destroyRuntimeTag);
+    }
+    for (int i = 0; i < num; i += 3) {
+      expected.push_back(i);
+    }
+    for (int i = num; i < num + 10; ++i) {
+      expected.push_back(i);
+    }
+  }
+  EXPECT_EQ(expected, destroyed_runtime_tags);
+}
+}  // namespace
@@ -0,0 +1,117 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "stage_pools.h"
+
+namespace {
+using mluoptest::CaseStage;
+using mluoptest::StagePools;
+
+TEST(StagePoolsSelfTest, PoolSizes) {
+  setenv("MLUOP_GTEST_BASELINE_THREADS", "3", 1);
+  setenv("MLUOP_GTEST_DEVICE_THREADS", "8", 1);
+  setenv("MLUOP_GTEST_REPORT_THREADS", "0", 1);  // not positive, default
+  {
+    StagePools pools(7, 4);
+    EXPECT_EQ(2, pools.size(mluoptest::STAGE_PARSE));
+    EXPECT_EQ(2, pools.size(mluoptest::STAGE_PREPARE));
+    EXPECT_EQ(4, pools.size(mluoptest::STAGE_DEVICE));  // capped
+    EXPECT_EQ(3, pools.size(mluoptest::STAGE_BASELINE));
+    EXPECT_EQ(2, pools.size(mluoptest::STAGE_COMPARE));
+    EXPECT_EQ(1, pools.size(mluoptest::STAGE_REPORT));
+  }
+  unsetenv("MLUOP_GTEST_BASELINE_THREADS");
+  unsetenv("MLUOP_GTEST_DEVICE_THREADS");
+  unsetenv("MLUOP_GTEST_REPORT_THREADS");
+
+  EXPECT_EQ(1, StagePools::getStageThreads(mluoptest::STAGE_PARSE, 0, 4));
+  EXPECT_EQ(1, StagePools::getStageThreads(mluoptest::STAGE_DEVICE, 4, 1));
+  EXPECT_EQ(1, StagePools::getStageThreads(mluoptest::STAGE_COMPARE, 4, 1));
+  // --thread=20 gives 20 device workers and 41 in all, not 6 * 20.
+  size_t total = 0;
+  for (int i = 0; i < mluoptest::STAGE_NUM; ++i) {
+    total += StagePools::getStageThreads(static_cast<CaseStage>(i), 20, 40);
+  }
+  EXPECT_EQ(20, StagePools::getStageThreads(mluoptest::STAGE_DEVICE, 20, 40));
+  EXPECT_EQ(41, total);
+}
+
+// items flow through the stages like cases, each stage enqueues the next.
+struct StageFlow {
+  explicit StageFlow(size_t item_num) : stages(item_num) {
+    for (auto &stage : stages) {
+      stage = -1;
+    }
+  }
+
+  void run(CaseStage stage, size_t item) {
+    size_t now = ++running[stage];
+    size_t max = max_running[stage];
+    while (now > max && !max_running[stage].compare_exchange_weak(max, now)) {
+    }
+    if (stages[item] + 1 != stage) {
+      out_of_order++;
+    }
+    stages[item] = stage;
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    running[stage]--;
+    if (stage + 1 < mluoptest::STAGE_NUM) {
+      pools->enqueue(static_cast<CaseStage>(stage + 1), &StageFlow::run, this,
+                     static_cast<CaseStage>(stage + 1), item);
+    } else {
+      done++;
+    }
+  }
+
+  StagePools *pools = nullptr;
+  std::vector<std::atomic<int>> stages;  // last stage of each item
+  std::atomic<size_t> running[mluoptest::STAGE_NUM] = {};
+  std::atomic<size_t> max_running[mluoptest::STAGE_NUM] = {};
+  std::atomic<size_t> out_of_order{0};
+  std::atomic<size_t> done{0};
+};
+
+TEST(StagePoolsSelfTest, StagesInOrder) {
+  constexpr size_t item_num = 64;
+  StageFlow flow(item_num);
+  flow.pools = new StagePools(3, 2);
+  for (size_t i = 0; i < item_num; ++i) {
+    flow.pools->enqueue(mluoptest::STAGE_PARSE, &StageFlow::run, &flow,
+                        mluoptest::STAGE_PARSE, i);
+  }
+  delete flow.pools;  // joins the stages in order, all items are done
+  EXPECT_EQ(item_num, flow.done.load());
+  EXPECT_EQ(0, flow.out_of_order.load());
+  for (int i = 0; i < mluoptest::STAGE_NUM; ++i) {
+    size_t limit = i == mluoptest::STAGE_DEVICE ? 2 : 3;
+    EXPECT_LE(flow.max_running[i].load(), limit)
+        << StagePools::name(static_cast<CaseStage>(i));
+  }
+}
+}  // namespace
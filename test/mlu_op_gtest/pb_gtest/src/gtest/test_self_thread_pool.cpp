@@ -0,0 +1,67 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <future>  // NOLINT
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "thread_pool.h"
+
+namespace {
+// scheduler throughput with many tiny tasks, like a suite of tiny cases.
+TEST(ThreadPoolSelfTest, TinyTasks) {
+  constexpr size_t task_num = 200000;
+  for (size_t thread_num : {1, 4}) {
+    std::atomic<size_t> done(0);
+    auto start = std::chrono::steady_clock::now();
+    {
+      mluoptest::ThreadPool pool(thread_num);
+      for (size_t i = 0; i < task_num; ++i) {
+        pool.enqueue([&done](size_t n) { done += n; }, 1);
+      }
+    }  // join, all tasks are done
+    auto end = std::chrono::steady_clock::now();
+    ASSERT_EQ(task_num, done.load());
+    double seconds = std::chrono::duration<double>(end - start).count();
+    RecordProperty("threads_" + std::to_string(thread_num) + "_tasks_per_s",
+                   std::to_string(static_cast<int64_t>(task_num / seconds)));
+  }
+
+  // submit from workers, results and exceptions through futures
+  mluoptest::ThreadPool pool(3);
+  std::vector<std::future<std::future<size_t>>> futures;
+  for (size_t i = 0; i < 1000; ++i) {
+    futures.emplace_back(pool.submit(
+        [&pool](size_t n) { return pool.submit([n] { return n * 2; }); }, i));
+  }
+  for (size_t i = 0; i < futures.size(); ++i) {
+    ASSERT_EQ(i * 2, futures[i].get().get());
+  }
+  auto error = pool.submit([]() -> int { throw std::runtime_error("task"); });
+  EXPECT_THROW(error.get(), std::runtime_error);
+}
+}  // namespace
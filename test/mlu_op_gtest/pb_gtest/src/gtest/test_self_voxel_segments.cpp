@@ -0,0 +1,67 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "voxel_segments.h"
+
+namespace {
+TEST(VoxelSegmentsSelfTest, CompareWithStableSort) {
+  std::mt19937 gen(1357);
+  // small coordinates go through the packed radix keys, huge ones through
+  // the comparison fallback.
+  for (int64_t range : {(int64_t)7, (int64_t)4000000000}) {
+    const int64_t num = 5000;
+    std::vector<float> coors(num * 3);
+    for (auto &c : coors) {
+      c = (float)((int64_t)(gen() % 7) * (range / 7) - range / 2);
+    }
+    std::vector<int32_t> expected(num);
+    std::iota(expected.begin(), expected.end(), 0);
+    auto row = [&](int32_t i) {
+      return std::make_tuple((int32_t)coors[i * 3], (int32_t)coors[i * 3 + 1],
+                             (int32_t)coors[i * 3 + 2]);
+    };
+    std::stable_sort(expected.begin(), expected.end(),
+                     [&](int32_t i, int32_t j) { return row(i) < row(j); });
+    mluoptest::VoxelSegments segments;
+    segments.buildFromCoors(coors.data(), num, 3);
+    ASSERT_TRUE(std::equal(expected.begin(), expected.end(),
+                           segments.points()));
+    int64_t segment_num = 1;
+    for (int64_t k = 1; k < num; ++k) {
+      segment_num += row(expected[k]) != row(expected[k - 1]);
+    }
+    ASSERT_EQ(segments.segmentNum(), segment_num);
+    for (int64_t s = 0; s < segments.segmentNum(); ++s) {
+      ASSERT_EQ(row(segments.points()[segments.begin(s)]),
+                row(segments.points()[segments.end(s) - 1]));
+    }
+  }
+}
+}  // namespace
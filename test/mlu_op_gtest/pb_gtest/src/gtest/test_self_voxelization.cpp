@@ -0,0 +1,197 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "cpu_voxelization.h"
+
+namespace {
+
+// The serial hard voxelization the baseline used before cpu_voxelization,
+// where every point rescans the earlier points for its voxel.
+void hardVoxelizeReference(const float *points, const float *voxel_size,
+                           const float *coors_range, int32_t num_points,
+                           int32_t num_features, int32_t max_points,
+                           int32_t max_voxels, int32_t NDim, float *voxels,
+                           float *coors, float *num_points_per_voxel,
+                           float *voxel_num) {
+  const int32_t grid_x =
+      round((coors_range[3] - coors_range[0]) / voxel_size[0]);
+  const int32_t grid_y =
+      round((coors_range[4] - coors_range[1]) / voxel_size[1]);
+  const int32_t grid_z =
+      round((coors_range[5] - coors_range[2]) / voxel_size[2]);
+  std::vector<int32_t> coor(num_points * NDim);
+  for (int32_t index = 0; index < num_points; ++index) {
+    const float *p = points + index * num_features;
+    int32_t *c = coor.data() + index * NDim;
+    int32_t c_x = floorf((p[0] - coors_range[0]) / voxel_size[0]);
+    if (c_x < 0 || c_x >= grid_x) {
+      c[0] = -1;
+      continue;
+    }
+    int32_t c_y = floorf((p[1] - coors_range[1]) / voxel_size[1]);
+    if (c_y < 0 || c_y >= grid_y) {
+      c[0] = -1;
+      c[1] = -1;
+      continue;
+    }
+    int32_t c_z = floorf((p[2] - coors_range[2]) / voxel_size[2]);
+    if (c_z < 0 || c_z >= grid_z) {
+      c[0] = -1;
+      c[1] = -1;
+      c[2] = -1;
+    } else {
+      c[0] = c_z;
+      c[1] = c_y;
+      c[2] = c_x;
+    }
+  }
+
+  std::vector<int32_t> point_to_pointidx(num_points);
+  std::vector<int32_t> point_to_voxelidx(num_points);
+  for (int32_t index = 0; index < num_points; ++index) {
+    const int32_t *c = coor.data() + index * NDim;
+    if (c[0] == -1) {
+      point_to_pointidx[index] = -1;
+      point_to_voxelidx[index] = -1;
+      continue;
+    }
+    int32_t num = 0;
+    for (int32_t i = 0; i < index; ++i) {
+      const int32_t *prev = coor.data() + i * NDim;
+      if (prev[0] == -1) {
+        continue;
+      }
+      if (prev[0] == c[0] && prev[1] == c[1] && prev[2] == c[2]) {
+        num++;
+        if (num == 1) {
+          point_to_pointidx[index] = i;
+        } else if (num >= max_points) {
+          break;
+        }
+      }
+    }
+    if (num == 0) {
+      point_to_pointidx[index] = index;
+    }
+    point_to_voxelidx[index] = num < max_points ? num : -1;
+  }
+
+  std::vector<int32_t> coor_to_voxelidx(num_points);
+  *voxel_num = 0;
+  for (int32_t i = 0; i < num_points; ++i) {
+    int point_pos_in_voxel = point_to_voxelidx[i];
+    coor_to_voxelidx[i] = -1;
+    if (point_pos_in_voxel == -1) {
+      continue;
+    } else if (point_pos_in_voxel == 0) {
+      int voxelidx = voxel_num[0];
+      if (voxel_num[0] >= max_voxels) continue;
+      voxel_num[0] += 1;
+      coor_to_voxelidx[i] = voxelidx;
+      num_points_per_voxel[voxelidx] = 1;
+    } else {
+      int voxelidx = coor_to_voxelidx[point_to_pointidx[i]];
+      if (voxelidx != -1) {
+        coor_to_voxelidx[i] = voxelidx;
+        num_points_per_voxel[voxelidx] += 1;
+      }
+    }
+  }
+
+  for (int32_t i = 0; i < num_points; ++i) {
+    int32_t num = point_to_voxelidx[i];
+    int32_t voxelidx = coor_to_voxelidx[i];
+    if (num < 0 || voxelidx < 0) {
+      continue;
+    }
+    for (int32_t k = 0; k < num_features; ++k) {
+      voxels[(voxelidx * max_points + num) * num_features + k] =
+          points[i * num_features + k];
+    }
+    if (num == 0) {
+      for (int32_t k = 0; k < NDim; ++k) {
+        coors[voxelidx * NDim + k] = coor[i * NDim + k];
+      }
+    }
+  }
+}
+
+// random clouds with many points per voxel and points out of range, against
+// the old serial loops, bit for bit. max_points covers <= 0, 1 and more
+// than any voxel holds, max_voxels 0 to more than there are voxels.
+TEST(CpuVoxelizationSelfTest, CompareWithScan) {
+  std::mt19937 gen(2024);
+  auto pick = [&gen](int lo, int hi) {
+    return std::uniform_int_distribution<int>(lo, hi)(gen);
+  };
+  const float voxel_size[3] = {0.5f, 0.5f, 1.0f};
+  const float coors_range[6] = {0.0f, -1.0f, -1.0f, 2.0f, 1.0f, 1.0f};
+  const int32_t NDim = 3;
+  for (int iter = 0; iter < 300; ++iter) {
+    // large clouds now and then, so the per point stages run in chunks.
+    const int32_t num_points = pick(0, 4) == 0 ? pick(5000, 20000)
+                                               : pick(0, 300);
+    const int32_t num_features = pick(3, 5);
+    const int32_t max_points = pick(-1, 6) == 6 ? 10000 : pick(-1, 5);
+    const int32_t max_voxels = pick(0, 5) == 5 ? 100 : pick(0, 20);
+    std::vector<float> points(num_points * num_features);
+    std::uniform_real_distribution<float> coordinate(-1.5f, 2.5f);
+    for (auto &v : points) {
+      v = coordinate(gen);
+    }
+
+    const size_t voxels_size =
+        (size_t)max_voxels * std::max(0, max_points) * num_features;
+    std::vector<float> expected(voxels_size + max_voxels * (NDim + 1) + 1,
+                                -3.0f);
+    std::vector<float> actual(expected);
+    auto outputs = [&](std::vector<float> *out) {
+      float *voxels = out->data();
+      float *coors = voxels + voxels_size;
+      float *num_points_per_voxel = coors + max_voxels * NDim;
+      float *voxel_num = num_points_per_voxel + max_voxels;
+      return std::vector<float *>{voxels, coors, num_points_per_voxel,
+                                  voxel_num};
+    };
+    auto e = outputs(&expected);
+    hardVoxelizeReference(points.data(), voxel_size, coors_range, num_points,
+                          num_features, max_points, max_voxels, NDim, e[0],
+                          e[1], e[2], e[3]);
+    auto a = outputs(&actual);
+    mluoptest::hardVoxelizeCpu(points.data(), voxel_size, coors_range,
+                               num_points, num_features, max_points,
+                               max_voxels, NDim, a[0], a[1], a[2], a[3]);
+    ASSERT_EQ(0, memcmp(expected.data(), actual.data(),
+                        expected.size() * sizeof(float)))
+        << "iter " << iter << ", num_points " << num_points
+        << ", max_points " << max_points << ", max_voxels " << max_voxels;
+  }
+}
+}  // namespace
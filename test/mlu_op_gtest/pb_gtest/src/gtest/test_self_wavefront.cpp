@@ -0,0 +1,69 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "wavefront.h"
+
+namespace {
+TEST(WavefrontSelfTest, CompareWithSerialFill) {
+  // an order sensitive recurrence, every cell must see final neighbours.
+  const int S = 150, T = 600;
+  std::vector<mluoptest::WavefrontBox> boxes = {
+      {0, 0, S, 0, T}, {1, 3, 70, 500, T}, {2, 9, 9, 0, 300}};
+  for (bool reverse : {false, true}) {
+    const int step = reverse ? -1 : 1;
+    std::vector<uint64_t> expected(boxes.size() * (S + 1) * (T + 1), 1);
+    std::vector<uint64_t> table(expected);
+    auto cell = [&](std::vector<uint64_t> &v, int b, int s, int t) {
+      uint64_t *at = &v[((size_t)b * (S + 1) + s) * (T + 1) + t];
+      const mluoptest::WavefrontBox &box = boxes[b];
+      const int s_first = reverse ? box.s_end : box.s_begin;
+      const int t_first = reverse ? box.t_end : box.t_begin;
+      const uint64_t up = s == s_first ? 1 : at[-step * (T + 1)];
+      const uint64_t left = t == t_first ? 1 : at[-step];
+      *at = up * 3 + left * 5 + (uint64_t)s * t;
+    };
+    for (const auto &box : boxes) {
+      for (int i = 0; i <= box.s_end - box.s_begin; ++i) {
+        for (int j = 0; j <= box.t_end - box.t_begin; ++j) {
+          cell(expected, box.b, reverse ? box.s_end - i : box.s_begin + i,
+               reverse ? box.t_end - j : box.t_begin + j);
+        }
+      }
+    }
+    mluoptest::wavefrontForTiles(
+        boxes, reverse, [&](const mluoptest::WavefrontBox &tile) {
+          for (int i = 0; i <= tile.s_end - tile.s_begin; ++i) {
+            for (int j = 0; j <= tile.t_end - tile.t_begin; ++j) {
+              cell(table, tile.b, reverse ? tile.s_end - i : tile.s_begin + i,
+                   reverse ? tile.t_end - j : tile.t_begin + j);
+            }
+          }
+        });
+    ASSERT_EQ(table, expected) << "reverse " << reverse;
+  }
+}
+}  // namespace
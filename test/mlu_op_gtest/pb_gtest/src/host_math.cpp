@@ -0,0 +1,421 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "host_math.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include <math.h>
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace mluoptest {
+
+namespace {
+
+// fdlibm e_log.c, e_log10.c and e_exp.c
+constexpr double kLn2Hi = 6.93147180369123816490e-01;
+constexpr double kLn2Lo = 1.90821492927058770002e-10;
+constexpr double kInvLn2 = 1.44269504088896338700e+00;
+constexpr double kInvLn10 = 4.34294481903251816668e-01;
+constexpr double kLog10Of2Hi = 3.01029995663611771306e-01;
+constexpr double kLog10Of2Lo = 3.69423907715893078616e-13;
+constexpr double kLg1 = 6.666666666666735130e-01;
+constexpr double kLg2 = 3.999999999940941908e-01;
+constexpr double kLg3 = 2.857142874366239149e-01;
+constexpr double kLg4 = 2.222219843214978396e-01;
+constexpr double kLg5 = 1.818357216161805012e-01;
+constexpr double kLg6 = 1.531383769920937332e-01;
+constexpr double kLg7 = 1.479819860511658591e-01;
+constexpr double kP1 = 1.66666666666666019037e-01;
+constexpr double kP2 = -2.77777777770155933842e-03;
+constexpr double kP3 = 6.61375632143793436117e-05;
+constexpr double kP4 = -1.65339022054652515390e-06;
+constexpr double kP5 = 4.13813679705723846039e-08;
+constexpr double kSqrt2 = 1.41421356237309514547e+00;
+constexpr double kTwo52 = 4503599627370496.0;
+constexpr double kTwo54 = 18014398509481984.0;
+// exp is evaluated on x clamped to this range, beyond it the result is 0 or
+// inf anyway.
+constexpr double kExpMin = -746.0;
+constexpr double kExpMax = 710.0;
+// lgamma: the Stirling series is summed from kStirlingMin on, smaller x are
+// shifted up by the recurrence lgamma(x) = lgamma(x + 1) - log(x).
+constexpr double kStirlingMin = 10.0;
+constexpr double kHalfLog2Pi = 9.18938533204672741780e-01;
+// B(2k) / (2k (2k - 1)) for k = 1..7
+constexpr double kStirling[7] = {1.0 / 12,   -1.0 / 360,      1.0 / 1260,
+                                 -1.0 / 1680, 1.0 / 1188,     -691.0 / 360360,
+                                 1.0 / 156};
+// the recurrence cancels near the zeros of lgamma at 1 and 2, lanes this
+// close to them go to lgamma_r.
+constexpr double kLgammaZeroBand = 1.0 / 256;
+
+constexpr double kInf = std::numeric_limits<double>::infinity();
+constexpr double kNan = std::numeric_limits<double>::quiet_NaN();
+
+// Each function is written once over V, which is double for the scalar tail
+// or __m256d for 4 lanes, so both paths run the same operations. Masks are
+// bool or all-ones __m256d lanes.
+template <typename V>
+V splat(double value);
+
+template <>
+inline double splat<double>(double value) {
+  return value;
+}
+inline bool lessThan(double a, double b) { return a < b; }
+inline bool notGreater(double a, double b) { return !(a > b); }
+inline bool equalTo(double a, double b) { return a == b; }
+inline bool isNan(double a) { return a != a; }
+inline bool maskOr(bool a, bool b) { return a || b; }
+inline bool maskAnd(bool a, bool b) { return a && b; }
+inline double blend(bool mask, double a, double b) { return mask ? a : b; }
+inline double roundToInt(double a) { return std::nearbyint(a); }
+inline double floorOf(double a) { return std::floor(a); }
+inline double sqrtOf(double a) { return std::sqrt(a); }
+
+inline uint64_t asBits(double a) {
+  uint64_t bits;
+  memcpy(&bits, &a, sizeof(bits));
+  return bits;
+}
+inline double fromBits(uint64_t bits) {
+  double a;
+  memcpy(&a, &bits, sizeof(a));
+  return a;
+}
+inline double absOf(double a) { return fromBits(asBits(a) & ~(1ull << 63)); }
+// a with its sign flipped where sign is negative.
+inline double xorSign(double a, double sign) {
+  return fromBits(asBits(a) ^ (asBits(sign) & (1ull << 63)));
+}
+// biased exponent field of a >= 0
+inline double exponentField(double a) { return (double)(asBits(a) >> 52); }
+// a with the exponent field of 1.0, in [1, 2) for finite a > 0
+inline double mantissaOf(double a) {
+  return fromBits((asBits(a) & ((1ull << 52) - 1)) | asBits(1.0));
+}
+// 2^k for integer k in [-1022, 1023]
+inline double pow2(double k) {
+  return fromBits(asBits(k + (kTwo52 + 1023)) << 52);
+}
+
+#if defined(__AVX2__)
+template <>
+inline __m256d splat<__m256d>(double value) {
+  return _mm256_set1_pd(value);
+}
+inline __m256d lessThan(__m256d a, __m256d b) {
+  return _mm256_cmp_pd(a, b, _CMP_LT_OQ);
+}
+inline __m256d notGreater(__m256d a, __m256d b) {
+  return _mm256_cmp_pd(a, b, _CMP_NGT_UQ);
+}
+inline __m256d equalTo(__m256d a, __m256d b) {
+  return _mm256_cmp_pd(a, b, _CMP_EQ_OQ);
+}
+inline __m256d isNan(__m256d a) { return _mm256_cmp_pd(a, a, _CMP_UNORD_Q); }
+inline __m256d maskOr(__m256d a, __m256d b) { return _mm256_or_pd(a, b); }
+inline __m256d maskAnd(__m256d a, __m256d b) { return _mm256_and_pd(a, b); }
+inline __m256d blend(__m256d mask, __m256d a, __m256d b) {
+  return _mm256_blendv_pd(b, a, mask);
+}
+inline __m256d roundToInt(__m256d a) {
+  return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+inline __m256d floorOf(__m256d a) { return _mm256_floor_pd(a); }
+inline __m256d sqrtOf(__m256d a) { return _mm256_sqrt_pd(a); }
+inline __m256d absOf(__m256d a) {
+  return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a);
+}
+inline __m256d xorSign(__m256d a, __m256d sign) {
+  return _mm256_xor_pd(a, _mm256_and_pd(sign, _mm256_set1_pd(-0.0)));
+}
+inline __m256d exponentField(__m256d a) {
+  // the field is placed in the mantissa of 2^52, then 2^52 is taken off.
+  const __m256i field = _mm256_srli_epi64(_mm256_castpd_si256(a), 52);
+  const __m256i biased =
+      _mm256_or_si256(field, _mm256_castpd_si256(splat<__m256d>(kTwo52)));
+  return _mm256_sub_pd(_mm256_castsi256_pd(biased), splat<__m256d>(kTwo52));
+}
+inline __m256d mantissaOf(__m256d a) {
+  const __m256i bits = _mm256_castpd_si256(a);
+  const __m256i mantissa =
+      _mm256_and_si256(bits, _mm256_set1_epi64x((1ll << 52) - 1));
+  return _mm256_castsi256_pd(_mm256_or_si256(
+      mantissa, _mm256_castpd_si256(splat<__m256d>(1.0))));
+}
+inline __m256d pow2(__m256d k) {
+  const __m256d biased = _mm256_add_pd(k, splat<__m256d>(kTwo52 + 1023));
+  return _mm256_castsi256_pd(
+      _mm256_slli_epi64(_mm256_castpd_si256(biased), 52));
+}
+#endif
+
+// x = 2^k (1 + f) with 1 + f in [sqrt(2) / 2, sqrt(2)) for finite x > 0,
+// and the terms of fdlibm such that ln(1 + f) = f - (hfsq - shr).
+template <typename V>
+struct LogParts {
+  V k, f, hfsq, shr;
+};
+
+template <typename V>
+LogParts<V> logParts(V x) {
+  const auto subnormal = lessThan(x, splat<V>(DBL_MIN));
+  x = blend(subnormal, x * kTwo54, x);
+  V k = blend(subnormal, splat<V>(-54.0), splat<V>(0.0)) +
+        (exponentField(x) - 1023.0);
+  V m = mantissaOf(x);
+  const auto above = lessThan(splat<V>(kSqrt2), m);
+  m = blend(above, m * 0.5, m);
+  k = blend(above, k + 1.0, k);
+  LogParts<V> parts;
+  parts.k = k;
+  parts.f = m - 1.0;
+  const V s = parts.f / (parts.f + 2.0);
+  const V z = s * s;
+  const V w = z * z;
+  const V t1 = w * (kLg2 + w * (kLg4 + w * kLg6));
+  const V t2 = z * (kLg1 + w * (kLg3 + w * (kLg5 + w * kLg7)));
+  parts.hfsq = 0.5 * parts.f * parts.f;
+  parts.shr = s * (parts.hfsq + (t2 + t1));
+  return parts;
+}
+
+template <typename V>
+V logSpecial(V x, V result) {
+  result = blend(equalTo(x, splat<V>(0.0)), splat<V>(-kInf), result);
+  result = blend(equalTo(x, splat<V>(kInf)), splat<V>(kInf), result);
+  result = blend(lessThan(x, splat<V>(0.0)), splat<V>(kNan), result);
+  return blend(isNan(x), x, result);
+}
+
+template <typename V>
+V logOf(V x) {
+  const LogParts<V> p = logParts(x);
+  return logSpecial(
+      x, p.k * kLn2Hi - ((p.hfsq - (p.shr + p.k * kLn2Lo)) - p.f));
+}
+
+template <typename V>
+V log2Of(V x) {
+  const LogParts<V> p = logParts(x);
+  return logSpecial(x, p.k + (p.f - (p.hfsq - p.shr)) * kInvLn2);
+}
+
+template <typename V>
+V log10Of(V x) {
+  const LogParts<V> p = logParts(x);
+  return logSpecial(x, p.k * kLog10Of2Hi +
+                           (p.k * kLog10Of2Lo +
+                            (p.f - (p.hfsq - p.shr)) * kInvLn10));
+}
+
+template <typename V>
+V expOf(V x) {
+  V clamped = blend(lessThan(x, splat<V>(kExpMin)), splat<V>(kExpMin), x);
+  clamped =
+      blend(lessThan(splat<V>(kExpMax), clamped), splat<V>(kExpMax), clamped);
+  const V k = roundToInt(clamped * kInvLn2);
+  const V hi = clamped - k * kLn2Hi;
+  const V lo = k * kLn2Lo;
+  const V r = hi - lo;
+  const V t = r * r;
+  const V c = r - t * (kP1 + t * (kP2 + t * (kP3 + t * (kP4 + t * kP5))));
+  const V y = 1.0 - ((lo - (r * c) / (2.0 - c)) - hi);
+  // 2^k in two factors, so that neither overflows for k in [-1076, 1024].
+  const V k_half = floorOf(k * 0.5);
+  return blend(isNan(x), x, y * pow2(k_half) * pow2(k - k_half));
+}
+
+template <typename V>
+V sigmoidOf(V x) {
+  return 1.0 / (1.0 + expOf(-x));
+}
+
+template <typename V>
+V powOf(V x, double exponent, bool integral, bool odd) {
+  const V y = expOf(logOf(absOf(x)) * exponent);
+  V result = odd ? xorSign(y, x) : y;
+  if (!integral) {
+    const auto negative_finite = maskAnd(lessThan(x, splat<V>(0.0)),
+                                         lessThan(splat<V>(-kInf), x));
+    result = blend(negative_finite, splat<V>(kNan), result);
+  }
+  return blend(equalTo(x, splat<V>(1.0)), splat<V>(1.0), result);
+}
+
+template <typename V>
+V lgammaOf(V x) {
+  V z = x;
+  V prod = splat<V>(1.0);
+  for (int i = 0; i < (int)kStirlingMin; ++i) {
+    const auto shift = lessThan(z, splat<V>(kStirlingMin));
+    prod = blend(shift, prod * z, prod);
+    z = blend(shift, z + 1.0, z);
+  }
+  const V w = 1.0 / z;
+  const V w2 = w * w;
+  V series = splat<V>(kStirling[6]);
+  for (int i = 5; i >= 0; --i) {
+    series = kStirling[i] + w2 * series;
+  }
+  const V stirling = (z - 0.5) * logOf(z) - z + kHalfLog2Pi + w * series;
+  return stirling - logOf(prod);
+}
+
+template <typename V>
+auto lgammaFallback(V x) -> decltype(lessThan(x, x)) {
+  const auto near_zero =
+      maskOr(lessThan(absOf(x - 1.0), splat<V>(kLgammaZeroBand)),
+             lessThan(absOf(x - 2.0), splat<V>(kLgammaZeroBand)));
+  return maskOr(maskOr(notGreater(x, splat<V>(0.0)),
+                       equalTo(x, splat<V>(kInf))),
+                near_zero);
+}
+
+inline double lgammaReference(double x) {
+  int sign;
+  return lgamma_r(x, &sign);
+}
+
+inline double lgammaLanes(double x) {
+  return lgammaFallback(x) ? lgammaReference(x) : lgammaOf(x);
+}
+
+#if defined(__AVX2__)
+inline __m256d lgammaLanes(__m256d x) {
+  __m256d y = lgammaOf(x);
+  const int fallback = _mm256_movemask_pd(lgammaFallback(x));
+  if (fallback != 0) {
+    double xs[4], ys[4];
+    _mm256_storeu_pd(xs, x);
+    _mm256_storeu_pd(ys, y);
+    for (int lane = 0; lane < 4; ++lane) {
+      if (fallback & (1 << lane)) {
+        ys[lane] = lgammaReference(xs[lane]);
+      }
+    }
+    y = _mm256_loadu_pd(ys);
+  }
+  return y;
+}
+
+inline __m256d loadLanes(const float *src) {
+  return _mm256_cvtps_pd(_mm_loadu_ps(src));
+}
+inline __m256d loadLanes(const double *src) { return _mm256_loadu_pd(src); }
+inline void storeLanes(float *dst, __m256d lanes) {
+  _mm_storeu_ps(dst, _mm256_cvtpd_ps(lanes));
+}
+inline void storeLanes(double *dst, __m256d lanes) {
+  _mm256_storeu_pd(dst, lanes);
+}
+#endif
+
+template <typename T, typename Func>
+void mapElements(const T *src, T *dst, size_t num, Func func) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 4 <= num; i += 4) {
+    storeLanes(dst + i, func(loadLanes(src + i)));
+  }
+#endif
+  for (; i < num; ++i) {
+    dst[i] = (T)func((double)src[i]);
+  }
+}
+
+}  // namespace
+
+template <typename T>
+void hostLog(const T *src, T *dst, size_t num) {
+  mapElements(src, dst, num, [](auto x) { return logOf(x); });
+}
+
+template <typename T>
+void hostLog2(const T *src, T *dst, size_t num) {
+  mapElements(src, dst, num, [](auto x) { return log2Of(x); });
+}
+
+template <typename T>
+void hostLog10(const T *src, T *dst, size_t num) {
+  mapElements(src, dst, num, [](auto x) { return log10Of(x); });
+}
+
+template <typename T>
+void hostExp(const T *src, T *dst, size_t num) {
+  mapElements(src, dst, num, [](auto x) { return expOf(x); });
+}
+
+template <typename T>
+void hostSqrt(const T *src, T *dst, size_t num) {
+  mapElements(src, dst, num, [](auto x) { return sqrtOf(x); });
+}
+
+template <typename T>
+void hostSigmoid(const T *src, T *dst, size_t num) {
+  mapElements(src, dst, num, [](auto x) { return sigmoidOf(x); });
+}
+
+template <typename T>
+void hostPow(const T *src, double exponent, T *dst, size_t num) {
+  if (exponent == 0) {
+    // x^0 is 1 even for nan x
+    for (size_t i = 0; i < num; ++i) {
+      dst[i] = 1;
+    }
+    return;
+  }
+  const bool integral = std::floor(exponent) == exponent;
+  const bool odd = integral && std::fmod(exponent, 2.0) != 0;
+  mapElements(src, dst, num, [=](auto x) {
+    return powOf(x, exponent, integral, odd);
+  });
+}
+
+template <typename T>
+void hostLgamma(const T *src, T *dst, size_t num) {
+  mapElements(src, dst, num, [](auto x) { return lgammaLanes(x); });
+}
+
+#define HOST_MATH_INSTANTIATE(T)                                  \
+  template void hostLog<T>(const T *, T *, size_t);               \
+  template void hostLog2<T>(const T *, T *, size_t);              \
+  template void hostLog10<T>(const T *, T *, size_t);             \
+  template void hostExp<T>(const T *, T *, size_t);               \
+  template void hostSqrt<T>(const T *, T *, size_t);              \
+  template void hostSigmoid<T>(const T *, T *, size_t);           \
+  template void hostPow<T>(const T *, double, T *, size_t);       \
+  template void hostLgamma<T>(const T *, T *, size_t);
+
+HOST_MATH_INSTANTIATE(float)
+HOST_MATH_INSTANTIATE(double)
+#undef HOST_MATH_INSTANTIATE
+
+}  // namespace mluoptest
@@ -0,0 +1,199 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "host_trace.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/logging.h"
+#include "tools.h"
+
+namespace mluoptest {
+
+namespace {
+
+// buffer of the calling thread, and the trace it belongs to.
+struct LocalBuffer {
+  uint64_t trace_id = 0;
+  void *buffer = nullptr;
+};
+thread_local LocalBuffer local_buffer;
+
+std::atomic<uint64_t> next_trace_id(1);
+
+void appendJsonString(const std::string &str, std::string *out) {
+  out->push_back('"');
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      out->push_back('\\');
+      out->push_back(c);
+    } else if ((unsigned char)c < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+      out->append(buf);
+    } else {
+      out->push_back(c);
+    }
+  }
+  out->push_back('"');
+}
+
+}  // namespace
+
+HostTrace *HostTrace::getInstance() {
+  const char *path = std::getenv("MLUOP_GTEST_TRACE_FILE");
+  static HostTrace trace(path == nullptr ? "" : path);
+  return &trace;
+}
+
+HostTrace::HostTrace(const std::string &path)
+    : path_(path),
+      trace_id_(next_trace_id.fetch_add(1)),
+      start_(std::chrono::steady_clock::now()) {}
+
+int64_t HostTrace::now() const {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start_)
+      .count();
+}
+
+HostTrace::ThreadBuffer *HostTrace::localBuffer() {
+  if (local_buffer.trace_id != trace_id_) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    buffers_.emplace_back(new ThreadBuffer);
+    buffers_.back()->tid = buffers_.size();
+    local_buffer.trace_id = trace_id_;
+    local_buffer.buffer = buffers_.back().get();
+  }
+  return static_cast<ThreadBuffer *>(local_buffer.buffer);
+}
+
+void HostTrace::record(TraceEvent &&event) {
+  localBuffer()->events.emplace_back(std::move(event));
+}
+
+std::vector<std::pair<int, TraceEvent>> HostTrace::mergeEvents() const {
+  std::lock_guard<std::mutex> lk(mtx_);
+  std::vector<std::pair<int, TraceEvent>> events;
+  for (const auto &buffer : buffers_) {
+    for (const auto &event : buffer->events) {
+      events.emplace_back(buffer->tid, event);
+    }
+  }
+  return events;
+}
+
+void HostTrace::dump() {
+  if (!enabled()) {
+    return;
+  }
+  int thread_num = 0;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (dumped_) {
+      return;
+    }
+    dumped_ = true;
+    thread_num = buffers_.size();
+  }
+  FILE *fp = fopen(path_.c_str(), "w");
+  if (fp == nullptr) {
+    LOG(WARNING) << "HostTrace: failed to open " << path_
+                 << ", trace is not saved.";
+    return;
+  }
+  const std::string pid = std::to_string(getpid());
+  std::string line;
+  fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  for (int tid = 1; tid <= thread_num; ++tid) {
+    fprintf(fp,
+            "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %s, "
+            "\"tid\": %d, \"args\": {\"name\": \"thread %d\"}},\n",
+            pid.c_str(), tid, tid);
+  }
+  // complete events, ts and dur are in microseconds.
+  auto events = mergeEvents();
+  for (size_t i = 0; i < events.size(); ++i) {
+    const TraceEvent &event = events[i].second;
+    char buf[160];
+    snprintf(buf, sizeof(buf),
+             "\"ph\": \"X\", \"pid\": %s, \"tid\": %d, \"ts\": %.3f, "
+             "\"dur\": %.3f",
+             pid.c_str(), events[i].first, event.begin_ns / 1e3,
+             (event.end_ns - event.begin_ns) / 1e3);
+    line = "{\"name\": ";
+    appendJsonString(event.name, &line);
+    line += ", \"cat\": \"gtest\", ";
+    line += buf;
+    if (!event.case_path.empty()) {
+      line += ", \"args\": {\"case\": ";
+      appendJsonString(event.case_path, &line);
+      line += "}";
+    }
+    line += i + 1 < events.size() ? "},\n" : "}\n";
+    fputs(line.c_str(), fp);
+  }
+  fprintf(fp, "]}\n");
+  fclose(fp);
+  std::cout << "[ TRACE    ] " << events.size() << " spans of " << thread_num
+            << " threads saved to " << path_ << "\n";
+}
+
+TraceSpan::TraceSpan(const char *name, HostTrace *trace)
+    : trace_(trace == nullptr ? HostTrace::getInstance() : trace),
+      name_(name) {
+  if (!trace_->enabled()) {
+    trace_ = nullptr;
+    return;
+  }
+  begin_ns_ = trace_->now();
+}
+
+TraceSpan::TraceSpan(const char *name, const std::string &case_path,
+                     HostTrace *trace)
+    : TraceSpan(name, trace) {
+  case_path_ = &case_path;
+}
+
+TraceSpan::~TraceSpan() {
+  if (trace_ == nullptr) {
+    return;
+  }
+  TraceEvent event;
+  event.name = name_;
+  if (case_path_ != nullptr) {
+    event.case_path = *case_path_;
+  }
+  event.begin_ns = begin_ns_;
+  event.end_ns = trace_->now();
+  trace_->record(std::move(event));
+}
+
+}  // namespace mluoptest
@@ -66,8 +66,13 @@ void TestInternalInfo::record_case(const std::string &case_path,
 std::string GtestInternalMsg::serialize_to_csv(std::string sep) const {
   double size_mb = gtest_internal_.parsed_file_size / 1024. / 1024.;
   auto cost = gtest_internal_.parsed_cost_seconds;
-  std::string init = sep + case_path_ + sep + std::to_string(size_mb) + sep +
-                     std::to_string(cost) + sep;
+  std::string init =
+      sep + case_path_ + sep + std::to_string(size_mb) + sep +
+      std::to_string(cost) + sep +
+      std::to_string(gtest_internal_.host_alloc_num) + sep +
+      std::to_string(gtest_internal_.host_reused_num) + sep +
+      std::to_string(gtest_internal_.host_peak_bytes / 1024. / 1024.) + sep +
+      std::to_string(gtest_internal_.proc_rss_peak / 1024. / 1024.) + sep;
   return std::accumulate(
       timespan_record_.begin(), timespan_record_.end(), std::move(init),
       [&sep](std::string s, const auto &item) {
@@ -76,8 +81,10 @@ std::string GtestInternalMsg::serialize_to_csv(std::string sep) const {
 }
 
 std::string GtestInternalMsg::get_csv_header(std::string sep) const {
-  std::string init =
-      sep + "case_path" + sep + "file_size_mb" + sep + "parse_time_s" + sep;
+  std::string init = sep + "case_path" + sep + "file_size_mb" + sep +
+                     "parse_time_s" + sep + "host_alloc_num" + sep +
+                     "host_reused_num" + sep + "host_peak_mb" + sep +
+                     "rss_peak_mb" + sep;
   return std::accumulate(timespan_record_.begin(), timespan_record_.end(),
                          std::move(init),
                          [&sep](std::string s, const auto &item) {
@@ -28,6 +28,8 @@
  **************************************************************************/
 
 #include <stdlib.h>
+#include <string>
+#include <vector>
 #include "gtest/gtest.h"
 #include "variable.h"
 #include "test_env.h"
@@ -38,6 +40,7 @@
 #include "modules_test.h"
 #include "src/gtest-internal-inl.h"
 #include "hardware_monitor.h"
+#include "coordinator.h"
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -102,6 +105,9 @@ using namespace mluoptest; // NOLINT
 
 int main(int argc, char **argv) {
   // XXX(zhaolianshui): do we need a try-catch block?
+  initCaseReporter();
+  // workers of the coordinator get the command line as it was given.
+  const std::vector<std::string> args(argv, argv + argc);
   // be consistent with gtest and remove valid arguments from argv
   global_var.init(&argc, argv);
   setup_parallel_execution_policy();
@@ -110,6 +116,9 @@ int main(int argc, char **argv) {
   // global_var
   testing::InitGoogleTest(&argc, argv);
   assertValidCmdArg(argc, argv, __FILE__, __LINE__);
+  if (global_var.process_num_ > 1) {
+    return runCoordinator(args);
+  }
   testing::TestEventListeners &listeners =
       testing::UnitTest::GetInstance()->listeners();
   delete listeners.Release(listeners.default_xml_generator());
@@ -20,6 +20,8 @@
  * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *************************************************************************/
+#include <algorithm>
+#include <atomic>
 #include <string>
 #include <functional>
 #include "memory_pool.h"
@@ -211,40 +213,100 @@ std::pair<bool, void *> MemoryPool::getRandomSpaceBigChunk(
   return std::make_pair(found, (char *)big_chunk_itr->ptr + random_offset);
 }
 
+namespace {
+// bytes cached by all CPUMemoryPool, limited by MLUOP_GTEST_HOST_CACHE_MB.
+std::atomic<size_t> total_cached_bytes{0};
+const size_t kHostAlign = 64;
+
+size_t getHostCacheLimit() {
+  static size_t limit =
+      (size_t)std::max(0, getEnvInt("MLUOP_GTEST_HOST_CACHE_MB", 1024)) << 20;
+  return limit;
+}
+}  // namespace
+
+// round up to 4 classes per power of 2, so at most 25% is wasted.
+size_t CPUMemoryPool::sizeClass(size_t num_bytes) {
+  if (num_bytes <= 256) {
+    return 256;
+  }
+  size_t shift = 0;
+  for (size_t n = (num_bytes - 1) >> 3; n > 0; n >>= 1) {
+    shift++;
+  }
+  return (((num_bytes - 1) >> shift) + 1) << shift;
+}
+
 void *CPUMemoryPool::allocate(size_t num_bytes, const std::string &name) {
   if (0 == num_bytes) {
     return nullptr;
+  }
+  size_t bytes = sizeClass(num_bytes);
+  std::lock_guard<std::mutex> lk(mtx_);
+  void *ptr = nullptr;
+  auto it = free_blocks_.find(bytes);
+  if (it != free_blocks_.end() && !it->second.empty()) {
+    ptr = it->second.back();
+    it->second.pop_back();
+    cached_bytes_ -= bytes;
+    total_cached_bytes -= bytes;
+    reused_num_++;
   } else {
-    void *ptr = malloc(num_bytes);
-    ctx_->chunks.emplace_back(Chunk(num_bytes, num_bytes, ptr));
-    ctx_->total_allocated_size += num_bytes;
-    return ptr;
+    if (0 != posix_memalign(&ptr, kHostAlign, bytes)) {
+      ptr = nullptr;
+    }
+    if (ptr == nullptr) {
+      LOG(ERROR) << "CPUMemoryPool: Failed to allocate " << num_bytes
+                 << " bytes.";
+      throw std::invalid_argument(std::string(__FILE__) + " +" +
+                                  std::to_string(__LINE__));
+    }
+    malloc_num_++;
+    ctx_->total_allocated_size += bytes;
   }
+  live_blocks_.emplace(ptr, bytes);
+  return ptr;
 }
 
 void CPUMemoryPool::deallocate(void *ptr) {
-  auto it = ctx_->chunks.begin();
-  for (; it != ctx_->chunks.end();) {
-    if ((*it).ptr == ptr) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto it = live_blocks_.find(ptr);
+  if (it == live_blocks_.end()) {
+    return;
+  }
+  size_t bytes = it->second;
+  live_blocks_.erase(it);
+  if (total_cached_bytes + bytes > getHostCacheLimit()) {
+    free(ptr);
+    ctx_->total_allocated_size -= bytes;
+    return;
+  }
+  free_blocks_[bytes].push_back(ptr);
+  cached_bytes_ += bytes;
+  total_cached_bytes += bytes;
+}
+
+void CPUMemoryPool::clear() {
+  std::lock_guard<std::mutex> lk(mtx_);
+  for (auto &kv : free_blocks_) {
+    for (auto ptr : kv.second) {
       free(ptr);
-      ctx_->total_allocated_size -= (*it).allocated_size;
-      it = ctx_->chunks.erase(it);
-      return;
-    } else {
-      ++it;
+      ctx_->total_allocated_size -= kv.first;
     }
   }
+  free_blocks_.clear();
+  total_cached_bytes -= cached_bytes_;
+  cached_bytes_ = 0;
 }
 
 void CPUMemoryPool::destroy() {
-  for (auto it = ctx_->chunks.begin(); it != ctx_->chunks.end(); ++it) {
-    if (it->ptr != nullptr) {
-      free(it->ptr);
-      it->ptr = nullptr;
-      ctx_->total_allocated_size -= it->allocated_size;
-    }
+  clear();
+  std::lock_guard<std::mutex> lk(mtx_);
+  for (auto &kv : live_blocks_) {
+    free(kv.first);
+    ctx_->total_allocated_size -= kv.second;
   }
-  ctx_->chunks.clear();
+  live_blocks_.clear();
 }
 
 void *MLUMemoryPool::allocate(size_t num_bytes, const std::string &name) {
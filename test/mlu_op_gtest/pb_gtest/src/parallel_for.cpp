@@ -0,0 +1,145 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <exception>
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include "parallel_for.h"
+#include "thread_pool.h"
+#include "variable.h"
+
+namespace mluoptest {
+
+size_t getHostParallelism() {
+  int env_threads = getEnvInt("MLUOP_GTEST_HOST_THREADS", 0);
+  if (env_threads > 0) {
+    return env_threads;
+  }
+  size_t hw_threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t case_threads = std::max(1, global_var.thread_num_);
+  return std::max((size_t)1, hw_threads / case_threads);
+}
+
+namespace {
+// One chunked loop. Helpers hold it by shared_ptr: a helper that starts after
+// the loop has returned finds no chunk left and never touches func.
+struct ChunkLoop {
+  ChunkLoop(size_t n, size_t grain,
+            const std::function<void(size_t, size_t, size_t)> *func)
+      : n(n), grain(grain), chunk_num((n + grain - 1) / grain), func(func) {}
+
+  // claim and run chunks until none is left.
+  void drain() {
+    for (;;) {
+      size_t id = next_chunk.fetch_add(1);
+      if (id >= chunk_num) {
+        return;
+      }
+      // after an error the remaining chunks are only counted, the result is
+      // discarded anyway.
+      if (!failed) {
+        try {
+          (*func)(id, id * grain, std::min(n, (id + 1) * grain));
+        } catch (...) {
+          std::lock_guard<std::mutex> lk(mtx);
+          if (error == nullptr) {
+            error = std::current_exception();
+          }
+          failed = true;
+        }
+      }
+      if (done_chunks.fetch_add(1) + 1 == chunk_num) {
+        std::lock_guard<std::mutex> lk(mtx);
+        cond.notify_all();
+      }
+    }
+  }
+
+  const size_t n, grain, chunk_num;
+  const std::function<void(size_t, size_t, size_t)> *func;
+  std::atomic<size_t> next_chunk{0};
+  std::atomic<size_t> done_chunks{0};
+  std::atomic<bool> failed{false};
+  std::exception_ptr error = nullptr;
+  std::mutex mtx;
+  std::condition_variable cond;
+};
+
+// Created on first use and shared by all case threads, so a loop costs a few
+// task pushes instead of thread creation. It has a worker per hardware
+// thread but the calling one; helpers of a loop only speed it up, the
+// calling thread drains the loop by itself if the workers are busy.
+ThreadPool &getHostPool() {
+  static ThreadPool pool(
+      std::max((size_t)std::max(1u, std::thread::hardware_concurrency()),
+               getHostParallelism()) -
+      1);
+  return pool;
+}
+}  // namespace
+
+void parallelForChunks(
+    size_t n, size_t grain,
+    const std::function<void(size_t, size_t, size_t)> &func) {
+  if (n == 0) {
+    return;
+  }
+  grain = std::max((size_t)1, grain);
+  size_t chunk_num = (n + grain - 1) / grain;
+  size_t thread_num = std::min(chunk_num, getHostParallelism());
+  ThreadPool *pool = thread_num <= 1 ? nullptr : &getHostPool();
+  if (pool == nullptr || pool->size() == 0) {
+    for (size_t id = 0; id < chunk_num; ++id) {
+      func(id, id * grain, std::min(n, (id + 1) * grain));
+    }
+    return;
+  }
+
+  auto loop = std::make_shared<ChunkLoop>(n, grain, &func);
+  for (size_t i = 0; i < std::min(thread_num - 1, pool->size()); ++i) {
+    pool->enqueue([loop]() { loop->drain(); });
+  }
+  loop->drain();
+  {
+    std::unique_lock<std::mutex> lk(loop->mtx);
+    loop->cond.wait(lk, [&]() { return loop->done_chunks == chunk_num; });
+  }
+  if (loop->error != nullptr) {
+    std::rethrow_exception(loop->error);
+  }
+}
+
+void parallelForElements(size_t n, size_t bytes_per_elem,
+                         const std::function<void(size_t, size_t)> &func) {
+  size_t grain = kElementwiseChunkBytes / std::max((size_t)1, bytes_per_elem);
+  grain = std::max(kElementwiseAlign,
+                   grain / kElementwiseAlign * kElementwiseAlign);
+  parallelForChunks(n, grain, [&](size_t, size_t begin, size_t end) {
+    func(begin, end);
+  });
+}
+
+}  // namespace mluoptest
@@ -0,0 +1,287 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "point_grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace mluoptest {
+
+namespace {
+
+// cells per point are capped so sparse or very flat clouds stay cheap.
+constexpr int64_t kMaxCellsPerPoint = 4;
+// below this many points a plain scan is as fast as the grid.
+constexpr int64_t kMinGridPoints = 32;
+
+inline bool isFinitePoint(const float *p) {
+  return std::isfinite(p[0]) && std::isfinite(p[1]) && std::isfinite(p[2]);
+}
+
+// same float expression as the original brute-force baselines.
+inline float squaredDistance(const float *q, const float *p) {
+  float sx = q[0] - p[0];
+  float sy = q[1] - p[1];
+  float sz = q[2] - p[2];
+  return sx * sx + sy * sy + sz * sz;
+}
+
+inline bool inBall(float d2, float min2, float max2) {
+  return d2 == 0 || (d2 >= min2 && d2 < max2);
+}
+
+inline bool nearer(double d, int k, double best_d, int best_k) {
+  return d < best_d || (d == best_d && k < best_k);
+}
+
+inline void insertNearest(double d, int k, double dist[3], int idx[3]) {
+  if (nearer(d, k, dist[0], idx[0])) {
+    dist[2] = dist[1], idx[2] = idx[1];
+    dist[1] = dist[0], idx[1] = idx[0];
+    dist[0] = d, idx[0] = k;
+  } else if (nearer(d, k, dist[1], idx[1])) {
+    dist[2] = dist[1], idx[2] = idx[1];
+    dist[1] = d, idx[1] = k;
+  } else if (nearer(d, k, dist[2], idx[2])) {
+    dist[2] = d, idx[2] = k;
+  }
+}
+
+}  // namespace
+
+void PointGrid::build(const float *xyz, int64_t n, double cell_size) {
+  xyz_ = xyz;
+  n_ = n;
+  double hi[3];
+  for (int a = 0; a < 3; ++a) {
+    lo_[a] = std::numeric_limits<double>::max();
+    hi[a] = std::numeric_limits<double>::lowest();
+  }
+  int64_t valid = 0;
+  for (int64_t i = 0; i < n; ++i) {
+    const float *p = xyz + i * 3;
+    if (!isFinitePoint(p)) continue;
+    for (int a = 0; a < 3; ++a) {
+      lo_[a] = std::min(lo_[a], (double)p[a]);
+      hi[a] = std::max(hi[a], (double)p[a]);
+    }
+    ++valid;
+  }
+  if (valid == 0) {
+    for (int a = 0; a < 3; ++a) {
+      lo_[a] = 0.0;
+      hi[a] = 0.0;
+    }
+  }
+
+  double extent[3], max_extent = 0.0;
+  for (int a = 0; a < 3; ++a) {
+    extent[a] = hi[a] - lo_[a];
+    max_extent = std::max(max_extent, extent[a]);
+  }
+  if (!(cell_size > 0.0) || !std::isfinite(cell_size)) {
+    if (max_extent > 0.0) {
+      // aim at about two points per cell, flat axes count as thin slabs.
+      double volume = 1.0;
+      for (int a = 0; a < 3; ++a) {
+        volume *= std::max(extent[a], max_extent * 1e-3);
+      }
+      cell_size = std::cbrt(volume / std::max<int64_t>(valid / 2, 1));
+    } else {
+      cell_size = 1.0;
+    }
+  }
+  const double max_cells = (double)(kMaxCellsPerPoint * valid + 64);
+  while (true) {
+    double cells = 1.0;
+    for (int a = 0; a < 3; ++a) {
+      cells *= std::floor(extent[a] / cell_size) + 1.0;
+    }
+    if (cells <= max_cells) break;
+    cell_size *= 1.5;
+  }
+  cell_size_ = cell_size;
+  inv_cell_size_ = 1.0 / cell_size;
+  for (int a = 0; a < 3; ++a) {
+    dims_[a] = (int64_t)std::floor(extent[a] / cell_size) + 1;
+  }
+
+  // counting sort keeps the points of a cell in increasing index order.
+  const int64_t num_cells = dims_[0] * dims_[1] * dims_[2];
+  cell_start_.assign(num_cells + 1, 0);
+  std::vector<int64_t> point_cell(n, -1);
+  for (int64_t i = 0; i < n; ++i) {
+    const float *p = xyz + i * 3;
+    if (!isFinitePoint(p)) continue;
+    point_cell[i] = cellId(cellCoord(0, p[0]), cellCoord(1, p[1]),
+                           cellCoord(2, p[2]));
+    ++cell_start_[point_cell[i] + 1];
+  }
+  for (int64_t c = 0; c < num_cells; ++c) {
+    cell_start_[c + 1] += cell_start_[c];
+  }
+  std::vector<int64_t> fill(cell_start_.begin(), cell_start_.end() - 1);
+  cell_index_.resize(valid);
+  cell_xyz_.resize(valid * 3);
+  for (int64_t i = 0; i < n; ++i) {
+    if (point_cell[i] < 0) continue;
+    int64_t pos = fill[point_cell[i]]++;
+    cell_index_[pos] = (int32_t)i;
+    std::copy(xyz + i * 3, xyz + i * 3 + 3, cell_xyz_.data() + pos * 3);
+  }
+}
+
+// monotone in v, so a point inside [v0, v1] always lies in a cell between
+// cellCoord(v0) and cellCoord(v1).
+int64_t PointGrid::cellCoord(int axis, double v) const {
+  double t = (v - lo_[axis]) * inv_cell_size_;
+  if (!(t >= 0.0)) return 0;
+  if (t >= (double)(dims_[axis] - 1)) return dims_[axis] - 1;
+  return (int64_t)t;
+}
+
+void PointGrid::radiusQuery(const float *query, float min_radius,
+                            float max_radius, int64_t nsample,
+                            std::vector<int32_t> *indices) const {
+  indices->clear();
+  if (nsample <= 0) return;
+  const float min2 = min_radius * min_radius;
+  const float max2 = max_radius * max_radius;
+  // covers the rounding of d2 and the points whose d2 underflows to 0.
+  const double reach = std::sqrt((double)max2) * 1.001 + 1e-18;
+
+  bool use_grid = n_ >= kMinGridPoints && isFinitePoint(query) &&
+                  std::isfinite(reach);
+  int64_t c0[3], c1[3];
+  if (use_grid) {
+    double visited = 1.0;
+    for (int a = 0; a < 3; ++a) {
+      c0[a] = cellCoord(a, query[a] - reach);
+      c1[a] = cellCoord(a, query[a] + reach);
+      visited *= (double)(c1[a] - c0[a] + 1);
+    }
+    // a ball covering most of the cloud is cheaper as an early-exit scan.
+    use_grid = visited * 2 <= (double)(cell_start_.size() - 1);
+  }
+  if (!use_grid) {
+    for (int64_t i = 0; i < n_; ++i) {
+      if (inBall(squaredDistance(query, xyz_ + i * 3), min2, max2)) {
+        indices->push_back((int32_t)i);
+        if ((int64_t)indices->size() >= nsample) break;
+      }
+    }
+    return;
+  }
+
+  for (int64_t cz = c0[2]; cz <= c1[2]; ++cz) {
+    for (int64_t cy = c0[1]; cy <= c1[1]; ++cy) {
+      int64_t begin = cell_start_[cellId(c0[0], cy, cz)];
+      int64_t end = cell_start_[cellId(c1[0], cy, cz) + 1];
+      for (int64_t k = begin; k < end; ++k) {
+        if (inBall(squaredDistance(query, cell_xyz_.data() + k * 3), min2,
+                   max2)) {
+          indices->push_back(cell_index_[k]);
+        }
+      }
+    }
+  }
+  if ((int64_t)indices->size() > nsample) {
+    std::nth_element(indices->begin(), indices->begin() + nsample,
+                     indices->end());
+    indices->resize(nsample);
+  }
+  std::sort(indices->begin(), indices->end());
+}
+
+void PointGrid::threeNearest(const float *query, double dist[3],
+                             int idx[3]) const {
+  for (int i = 0; i < 3; ++i) {
+    dist[i] = 1e40;
+    idx[i] = 0;
+  }
+  if (n_ < kMinGridPoints || !isFinitePoint(query)) {
+    for (int64_t i = 0; i < n_; ++i) {
+      insertNearest(squaredDistance(query, xyz_ + i * 3), (int)i, dist, idx);
+    }
+    return;
+  }
+
+  int64_t center[3];
+  for (int a = 0; a < 3; ++a) {
+    center[a] = cellCoord(a, query[a]);
+  }
+  // visit shells of cells at growing Chebyshev distance from the query cell
+  // until no unvisited point can be nearer than the current third one.
+  for (int64_t s = 0;; ++s) {
+    int64_t c0[3], c1[3];
+    bool covered = true;
+    for (int a = 0; a < 3; ++a) {
+      c0[a] = center[a] - s;
+      c1[a] = center[a] + s;
+      covered = covered && c0[a] <= 0 && c1[a] >= dims_[a] - 1;
+    }
+    // cells of a row are stored contiguously, so scan [first, last] at once.
+    auto scan = [&](int64_t first, int64_t last) {
+      for (int64_t k = cell_start_[first]; k < cell_start_[last + 1]; ++k) {
+        insertNearest(squaredDistance(query, cell_xyz_.data() + k * 3),
+                      cell_index_[k], dist, idx);
+      }
+    };
+    const int64_t x0 = std::max<int64_t>(c0[0], 0);
+    const int64_t x1 = std::min(c1[0], dims_[0] - 1);
+    for (int64_t cz = std::max<int64_t>(c0[2], 0);
+         cz <= std::min(c1[2], dims_[2] - 1); ++cz) {
+      for (int64_t cy = std::max<int64_t>(c0[1], 0);
+           cy <= std::min(c1[1], dims_[1] - 1); ++cy) {
+        if (cz != c0[2] && cz != c1[2] && cy != c0[1] && cy != c1[1]) {
+          // rows inside the shell only contribute their two end cells.
+          if (c0[0] >= 0) scan(cellId(c0[0], cy, cz), cellId(c0[0], cy, cz));
+          if (c1[0] < dims_[0]) {
+            scan(cellId(c1[0], cy, cz), cellId(c1[0], cy, cz));
+          }
+        } else {
+          scan(cellId(x0, cy, cz), cellId(x1, cy, cz));
+        }
+      }
+    }
+    if (covered) break;
+
+    double gap = std::numeric_limits<double>::max();
+    for (int a = 0; a < 3; ++a) {
+      double slack = 1e-9 * (std::fabs(lo_[a]) + dims_[a] * cell_size_ +
+                             std::fabs((double)query[a]));
+      if (c0[a] > 0) {
+        gap = std::min(gap, query[a] - (lo_[a] + c0[a] * cell_size_) - slack);
+      }
+      if (c1[a] < dims_[a] - 1) {
+        gap = std::min(gap,
+                       lo_[a] + (c1[a] + 1) * cell_size_ - query[a] - slack);
+      }
+    }
+    gap = std::max(gap, 0.0);
+    if (dist[2] < gap * gap * (1.0 - 1e-5) - 1e-40) break;
+  }
+}
+
+}  // namespace mluoptest
@@ -0,0 +1,257 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "roi_sampler.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+
+#include "parallel_for.h"
+
+namespace mluoptest {
+
+namespace {
+// channels of a scatter slice are kept at least this wide for the vector
+// loops, and rounded to the vector width.
+constexpr int kRoiScatterMinChannels = 32;
+constexpr int kRoiScatterChannelAlign = 8;
+// scatter slices handed out per host thread, for load balance.
+constexpr int kRoiScatterSlicesPerThread = 4;
+
+// sample of a tap with corners outside the map, those read as zero.
+void samplePartial(const BilinearTap &tap, const float *input, int channels,
+                   bool accumulate, float *out) {
+  const float *v1 = input + tap.offset[0], *v2 = input + tap.offset[1];
+  const float *v3 = input + tap.offset[2], *v4 = input + tap.offset[3];
+  const float w1 = tap.weight[0], w2 = tap.weight[1];
+  const float w3 = tap.weight[2], w4 = tap.weight[3];
+  for (int c = 0; c < channels; ++c) {
+    const float value = w1 * ((tap.mask & 1) ? v1[c] : 0.0f) +
+                        w2 * ((tap.mask & 2) ? v2[c] : 0.0f) +
+                        w3 * ((tap.mask & 4) ? v3[c] : 0.0f) +
+                        w4 * ((tap.mask & 8) ? v4[c] : 0.0f);
+    out[c] = accumulate ? out[c] + value : value;
+  }
+}
+
+void sampleFull(const BilinearTap &tap, const float *input, int channels,
+                bool accumulate, float *out) {
+  const float *v1 = input + tap.offset[0], *v2 = input + tap.offset[1];
+  const float *v3 = input + tap.offset[2], *v4 = input + tap.offset[3];
+  const float w1 = tap.weight[0], w2 = tap.weight[1];
+  const float w3 = tap.weight[2], w4 = tap.weight[3];
+  int c = 0;
+#if defined(__AVX2__)
+  // no fma: ((w1 * v1 + w2 * v2) + w3 * v3) + w4 * v4 rounds like the
+  // scalar expression.
+  const __m256 vw1 = _mm256_set1_ps(w1), vw2 = _mm256_set1_ps(w2);
+  const __m256 vw3 = _mm256_set1_ps(w3), vw4 = _mm256_set1_ps(w4);
+  for (; c + 8 <= channels; c += 8) {
+    __m256 value = _mm256_add_ps(_mm256_mul_ps(vw1, _mm256_loadu_ps(v1 + c)),
+                                 _mm256_mul_ps(vw2, _mm256_loadu_ps(v2 + c)));
+    value = _mm256_add_ps(value, _mm256_mul_ps(vw3, _mm256_loadu_ps(v3 + c)));
+    value = _mm256_add_ps(value, _mm256_mul_ps(vw4, _mm256_loadu_ps(v4 + c)));
+    if (accumulate) {
+      value = _mm256_add_ps(_mm256_loadu_ps(out + c), value);
+    }
+    _mm256_storeu_ps(out + c, value);
+  }
+#endif
+  for (; c < channels; ++c) {
+    const float value = w1 * v1[c] + w2 * v2[c] + w3 * v3[c] + w4 * v4[c];
+    out[c] = accumulate ? out[c] + value : value;
+  }
+}
+}  // namespace
+
+void makeBilinearTap(int height, int width, float y, float x,
+                     int64_t pixel_stride, BilinearTap *tap, int64_t *ops) {
+  if (y < -1.0 || y > height || x < -1.0 || x > width) {
+    *tap = BilinearTap{{0, 0, 0, 0}, {0, 0, 0, 0}, 0};
+    return;
+  }
+
+  if (y <= 0) y = 0;
+  if (x <= 0) x = 0;
+  int y_low = (int)y;
+  int x_low = (int)x;
+  int y_high, x_high;
+  int64_t clamp_ops = 2;
+  if (y_low >= height - 1) {
+    y_high = y_low = height - 1;
+    y = (float)y_low;
+    clamp_ops += 2;
+  } else {
+    y_high = y_low + 1;
+    clamp_ops += 1;
+  }
+  if (x_low >= width - 1) {
+    x_high = x_low = width - 1;
+    x = (float)x_low;
+    clamp_ops += 2;
+  } else {
+    x_high = x_low + 1;
+    clamp_ops += 1;
+  }
+  if (ops != nullptr) {
+    *ops += clamp_ops;
+  }
+
+  float ly = y - y_low, lx = x - x_low;
+  float hy = 1. - ly, hx = 1. - lx;
+  tap->offset[0] = ((int64_t)y_low * width + x_low) * pixel_stride;
+  tap->offset[1] = ((int64_t)y_low * width + x_high) * pixel_stride;
+  tap->offset[2] = ((int64_t)y_high * width + x_low) * pixel_stride;
+  tap->offset[3] = ((int64_t)y_high * width + x_high) * pixel_stride;
+  tap->weight[0] = hy * hx;
+  tap->weight[1] = hy * lx;
+  tap->weight[2] = ly * hx;
+  tap->weight[3] = ly * lx;
+  tap->mask = kBilinearTapFull;
+}
+
+void makeCornerTap(int height, int width, int y0, int x0, float y_weight,
+                   float x_weight, int64_t pixel_stride, BilinearTap *tap) {
+  const bool x_in[2] = {x0 >= 0 && x0 <= width - 1,
+                        x0 + 1 >= 0 && x0 + 1 <= width - 1};
+  const bool y_in[2] = {y0 >= 0 && y0 <= height - 1,
+                        y0 + 1 >= 0 && y0 + 1 <= height - 1};
+  tap->mask = 0;
+  for (int i = 0; i < 4; ++i) {
+    const int dy = i / 2, dx = i % 2;
+    tap->offset[i] = 0;
+    if (y_in[dy] && x_in[dx]) {
+      tap->offset[i] = ((int64_t)(y0 + dy) * width + x0 + dx) * pixel_stride;
+      tap->mask |= 1 << i;
+    }
+  }
+  tap->weight[0] = x_weight * y_weight;
+  tap->weight[1] = (1 - x_weight) * y_weight;
+  tap->weight[2] = x_weight * (1 - y_weight);
+  tap->weight[3] = (1 - x_weight) * (1 - y_weight);
+}
+
+void rotatedRoiTaps(int height, int width, int channels, int pooled_h,
+                    int pooled_w, int grid_h, int grid_w, float roi_start_x,
+                    float roi_start_y, float bin_size_h, float bin_size_w,
+                    float center_x, float center_y, float cos_theta,
+                    float sin_theta, std::vector<BilinearTap> *taps,
+                    int64_t *ops) {
+  taps->resize((size_t)pooled_h * pooled_w * grid_h * grid_w);
+  BilinearTap *tap = taps->data();
+  for (int ph = 0; ph < pooled_h; ++ph) {
+    for (int pw = 0; pw < pooled_w; ++pw) {
+      for (int iy = 0; iy < grid_h; ++iy) {
+        const float yy = roi_start_y + ph * bin_size_h +
+                         static_cast<float>(iy + 0.5) * bin_size_h /
+                             static_cast<float>(grid_h);
+        *ops += 8;
+        for (int ix = 0; ix < grid_w; ++ix, ++tap) {
+          const float xx = roi_start_x + pw * bin_size_w +
+                           static_cast<float>(ix + 0.5) * bin_size_w /
+                               static_cast<float>(grid_w);
+          const float y = yy * cos_theta - xx * sin_theta + center_y;
+          const float x = yy * sin_theta + xx * cos_theta + center_x;
+          *ops += 16;
+          makeBilinearTap(height, width, y, x, channels, tap, ops);
+          if (tap->mask != 0) {
+            *ops += 20;
+          }
+        }
+      }
+    }
+  }
+}
+
+void bilinearGather(const BilinearTap &tap, const float *input, int channels,
+                    float *value) {
+  if (tap.mask == kBilinearTapFull) {
+    sampleFull(tap, input, channels, false, value);
+  } else if (tap.mask != 0) {
+    samplePartial(tap, input, channels, false, value);
+  } else {
+    std::fill(value, value + channels, 0.0f);
+  }
+}
+
+void bilinearAccumulate(const BilinearTap &tap, const float *input,
+                        int channels, float *sum) {
+  if (tap.mask == kBilinearTapFull) {
+    sampleFull(tap, input, channels, true, sum);
+  } else if (tap.mask != 0) {
+    samplePartial(tap, input, channels, true, sum);
+  }
+}
+
+void bilinearScatter(const BilinearTap &tap, const float *grad, float count,
+                     int channels, float *grad_input) {
+  for (int i = 0; i < 4; ++i) {
+    if (!(tap.mask & (1 << i))) {
+      continue;
+    }
+    float *dst = grad_input + tap.offset[i];
+    const float w = tap.weight[i];
+    int c = 0;
+#if defined(__AVX2__)
+    const __m256 vw = _mm256_set1_ps(w);
+    const __m256 vcount = _mm256_set1_ps(count);
+    for (; c + 8 <= channels; c += 8) {
+      __m256 g = _mm256_div_ps(_mm256_mul_ps(_mm256_loadu_ps(grad + c), vw),
+                               vcount);
+      _mm256_storeu_ps(dst + c, _mm256_add_ps(_mm256_loadu_ps(dst + c), g));
+    }
+#endif
+    for (; c < channels; ++c) {
+      dst[c] += grad[c] * w / count;
+    }
+  }
+}
+
+void roiScatterSlices(int batch, int channels,
+                      const std::function<void(int, int, int)> &func) {
+  if (batch <= 0 || channels <= 0) {
+    return;
+  }
+  // cut channels until every thread has a few slices to pick from.
+  const int threads = getHostParallelism();
+  int blocks = (kRoiScatterSlicesPerThread * threads + batch - 1) / batch;
+  blocks = std::min(blocks, (channels + kRoiScatterMinChannels - 1) /
+                                kRoiScatterMinChannels);
+  blocks = std::max(blocks, 1);
+  int block_c = (channels + blocks - 1) / blocks;
+  block_c = (block_c + kRoiScatterChannelAlign - 1) /
+            kRoiScatterChannelAlign * kRoiScatterChannelAlign;
+  blocks = (channels + block_c - 1) / block_c;
+  parallelForChunks((size_t)batch * blocks, 1,
+                    [&](size_t, size_t begin, size_t end) {
+                      for (size_t task = begin; task < end; ++task) {
+                        const int n = task / blocks;
+                        const int c_begin = task % blocks * block_c;
+                        func(n, c_begin, std::min(channels, c_begin + block_c));
+                      }
+                    });
+}
+
+}  // namespace mluoptest
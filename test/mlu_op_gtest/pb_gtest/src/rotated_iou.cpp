@@ -0,0 +1,481 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "rotated_iou.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "parallel_for.h"
+
+namespace mluoptest {
+
+namespace {
+
+// pairs per chunk of the parallel IoU loops.
+constexpr size_t kRotatedIouGrain = 4096;
+// positions per block of greedyNmsKeep. Rows suppressed inside their own
+// block are evaluated for nothing, so blocks are kept small.
+constexpr int64_t kNmsBlockRows = 64;
+// bounding circles must be this much apart before a pair is skipped, which
+// leaves room for the rounding of the clipping code.
+constexpr double kCircleSlack = 1.001;
+
+struct Vec2 {
+  float x, y;
+};
+inline Vec2 operator+(const Vec2 &a, const Vec2 &b) {
+  return {a.x + b.x, a.y + b.y};
+}
+inline Vec2 operator-(const Vec2 &a, const Vec2 &b) {
+  return {a.x - b.x, a.y - b.y};
+}
+inline Vec2 operator*(const Vec2 &a, float coeff) {
+  return {a.x * coeff, a.y * coeff};
+}
+inline float dot2d(const Vec2 &a, const Vec2 &b) {
+  return a.x * b.x + a.y * b.y;
+}
+inline float cross2d(const Vec2 &a, const Vec2 &b) {
+  return a.x * b.y - a.y * b.x;
+}
+
+void getRotatedVertices(float x_ctr, float y_ctr, float w, float h,
+                        float cos_half, float sin_half, Vec2 (&pts)[4]) {
+  // y: top->down; x: left->right
+  pts[0].x = x_ctr - sin_half * h - cos_half * w;
+  pts[0].y = y_ctr + cos_half * h - sin_half * w;
+  pts[1].x = x_ctr + sin_half * h - cos_half * w;
+  pts[1].y = y_ctr - cos_half * h - sin_half * w;
+  pts[2].x = 2 * x_ctr - pts[0].x;
+  pts[2].y = 2 * y_ctr - pts[0].y;
+  pts[3].x = 2 * x_ctr - pts[1].x;
+  pts[3].y = 2 * y_ctr - pts[1].y;
+}
+
+// Appends the points of pts inside rectangle rect, whose edge vectors are
+// vec. P is inside ABCD iff. its projections on AB and AD lie within AB and
+// AD.
+void addContainedVertices(const Vec2 (&pts)[4], const Vec2 (&rect)[4],
+                          const Vec2 (&vec)[4], Vec2 (&intersections)[24],
+                          int *num) {
+  const Vec2 &AB = vec[0];
+  const Vec2 &DA = vec[3];
+  float ABdotAB = dot2d(AB, AB);
+  float ADdotAD = dot2d(DA, DA);
+  for (int i = 0; i < 4; i++) {
+    Vec2 AP = pts[i] - rect[0];
+    float APdotAB = dot2d(AP, AB);
+    float APdotAD = -dot2d(AP, DA);
+    if ((APdotAB >= 0) && (APdotAD >= 0) && (APdotAB <= ABdotAB) &&
+        (APdotAD <= ADdotAD)) {
+      intersections[(*num)++] = pts[i];
+    }
+  }
+}
+
+// up to 4 x 4 edge crossings plus 4 + 4 contained vertices, with duplicates.
+int getIntersectionPoints(const Vec2 (&pts1)[4], const Vec2 (&pts2)[4],
+                          bool reciprocal, Vec2 (&intersections)[24]) {
+  // Line vector, from p1 to p2 is: p1+(p2-p1)*t, t=[0,1]
+  Vec2 vec1[4], vec2[4];
+  for (int i = 0; i < 4; i++) {
+    vec1[i] = pts1[(i + 1) % 4] - pts1[i];
+    vec2[i] = pts2[(i + 1) % 4] - pts2[i];
+  }
+
+  int num = 0;
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      float det = cross2d(vec2[j], vec1[i]);
+      // deal with parallel lines
+      if (std::fabs((double)det) <= 1e-14) {
+        continue;
+      }
+      Vec2 vec12 = pts2[j] - pts1[i];
+      float t1, t2;
+      if (reciprocal) {
+        t1 = cross2d(vec2[j], vec12) * (1.0f / det);
+        t2 = cross2d(vec1[i], vec12) * (1.0f / det);
+      } else {
+        t1 = cross2d(vec2[j], vec12) / det;
+        t2 = cross2d(vec1[i], vec12) / det;
+      }
+      if (t1 >= 0.0f && t1 <= 1.0f && t2 >= 0.0f && t2 <= 1.0f) {
+        intersections[num++] = pts1[i] + vec1[i] * t1;
+      }
+    }
+  }
+
+  addContainedVertices(pts1, pts2, vec2, intersections, &num);
+  addContainedVertices(pts2, pts1, vec1, intersections, &num);
+  return num;
+}
+
+// orders the points counter-clockwise around the lowest one and drops the
+// ones inside, returns the number of hull points in q.
+int convexHullGraham(const Vec2 (&p)[24], int num_in, Vec2 (&q)[24]) {
+  // the lowest point, the leftmost one among ties.
+  int t = 0;
+  for (int i = 0; i < num_in; i++) {
+    if (p[i].y < p[t].y || (p[i].y == p[t].y && p[i].x < p[t].x)) {
+      t = i;
+    }
+  }
+  const Vec2 &start = p[t];
+  for (int i = 0; i < num_in; i++) {
+    q[i] = p[i] - start;
+  }
+  std::swap(q[0], q[t]);
+
+  // sort by angle, then by distance to the start point.
+  float dist[24];
+  for (int i = 0; i < num_in; i++) {
+    dist[i] = dot2d(q[i], q[i]);
+  }
+  for (int i = 1; i < num_in - 1; i++) {
+    for (int j = i + 1; j < num_in; j++) {
+      float temp = cross2d(q[i], q[j]);
+      if ((temp < -1e-6) ||
+          ((std::fabs((double)temp) < 1e-6) && (dist[i] > dist[j]))) {
+        std::swap(q[i], q[j]);
+        std::swap(dist[i], dist[j]);
+      }
+    }
+  }
+
+  // the second point of the stack must not overlap the first one.
+  int k;
+  for (k = 1; k < num_in; k++) {
+    if (dist[k] > 1e-8) {
+      break;
+    }
+  }
+  if (k == num_in) {
+    q[0] = p[t];
+    return 1;
+  }
+  q[1] = q[k];
+  int m = 2;
+  // pop the stack until the last 3 points turn left again.
+  for (int i = k + 1; i < num_in; i++) {
+    while (m > 1 && cross2d(q[i] - q[m - 2], q[m - 1] - q[m - 2]) >= 0) {
+      m--;
+    }
+    q[m++] = q[i];
+  }
+  return m;
+}
+
+float polygonArea(const Vec2 (&q)[24], int m) {
+  if (m <= 2) {
+    return 0;
+  }
+  float area = 0;
+  for (int i = 1; i < m - 1; i++) {
+    area += std::fabs((double)cross2d(q[i] - q[0], q[i + 1] - q[0]));
+  }
+  return area / 2.0;
+}
+
+// Clipping of poly_nms: the intersection of two polygons is the sum of the
+// signed overlaps of the triangles they fan out from the origin.
+constexpr int kPolyMaxPoints = 51;
+constexpr float kPolyEps = 1E-8;
+
+int sig(float d) { return (d > kPolyEps) - (d < -kPolyEps); }
+
+struct PolyPoint {
+  float x, y;
+  PolyPoint() {}
+  PolyPoint(float x, float y) : x(x), y(y) {}
+  bool operator==(const PolyPoint &p) const {
+    return sig(x - p.x) == 0 && sig(y - p.y) == 0;
+  }
+};
+
+float cross(PolyPoint o, PolyPoint a, PolyPoint b) {
+  return (a.x - o.x) * (b.y - o.y) - (b.x - o.x) * (a.y - o.y);
+}
+
+float area(PolyPoint *ps, int n) {
+  ps[n] = ps[0];
+  float res = 0;
+  for (int i = 0; i < n; i++) {
+    res += ps[i].x * ps[i + 1].y - ps[i].y * ps[i + 1].x;
+  }
+  return res / 2.0;
+}
+
+int lineCross(PolyPoint a, PolyPoint b, PolyPoint c, PolyPoint d,
+              PolyPoint *p) {
+  float s1 = cross(a, b, c);
+  float s2 = cross(a, b, d);
+  if (sig(s1) == 0 && sig(s2) == 0) return 2;
+  if (sig(s2 - s1) == 0) return 0;
+  p[0].x = (c.x * s2 - d.x * s1) / (s2 - s1);
+  p[0].y = (c.y * s2 - d.y * s1) / (s2 - s1);
+  return 1;
+}
+
+void polygonCut(PolyPoint *p, int *p_count, PolyPoint a, PolyPoint b,
+                PolyPoint *pp) {
+  int m = 0;
+  int n = p_count[0];
+  p[n] = p[0];
+  for (int i = 0; i < n; i++) {
+    if (sig(cross(a, b, p[i])) > 0) pp[m++] = p[i];
+    if (sig(cross(a, b, p[i])) != sig(cross(a, b, p[i + 1])))
+      lineCross(a, b, p[i], p[i + 1], &(pp[m++]));
+  }
+
+  n = 0;
+  for (int i = 0; i < m; i++)
+    if (!i || !(pp[i] == pp[i - 1])) p[n++] = pp[i];
+  while (n > 1 && p[n - 1] == p[0]) n--;
+  p_count[0] = n;
+}
+
+float triangleIntersectArea(PolyPoint a, PolyPoint b, PolyPoint c,
+                            PolyPoint d) {
+  PolyPoint o(0, 0);
+  int s1 = sig(cross(o, a, b));
+  int s2 = sig(cross(o, c, d));
+  if (s1 == 0 || s2 == 0) return 0.0;
+  if (s1 == -1) std::swap(a, b);
+  if (s2 == -1) std::swap(c, d);
+  PolyPoint p[10] = {o, a, b};
+  int n = 3;
+  PolyPoint pp[kPolyMaxPoints];
+
+  polygonCut(p, &n, o, c, pp);
+  polygonCut(p, &n, c, d, pp);
+  polygonCut(p, &n, d, o, pp);
+
+  float res = std::fabs(area(p, n));
+  if (s1 * s2 == -1) res = -res;
+  return res;
+}
+
+float polygonIntersectArea(PolyPoint *ps1, int n1, PolyPoint *ps2, int n2) {
+  if (area(ps1, n1) < 0) {
+    std::reverse(ps1, ps1 + n1);
+  }
+  if (area(ps2, n2) < 0) {
+    std::reverse(ps2, ps2 + n2);
+  }
+
+  ps1[n1] = ps1[0];
+  ps2[n2] = ps2[0];
+  float res = 0;
+  for (int i = 0; i < n1; i++) {
+    for (int j = 0; j < n2; j++) {
+      res += triangleIntersectArea(ps1[i], ps1[i + 1], ps2[j], ps2[j + 1]);
+    }
+  }
+  return res;
+}
+
+}  // namespace
+
+RotatedBoxes::RotatedBoxes(const float *boxes, int64_t num, int64_t stride,
+                           RotatedIouFlavor flavor)
+    : flavor_(flavor),
+      x_(num),
+      y_(num),
+      w_(num),
+      h_(num),
+      cos_half_(num),
+      sin_half_(num),
+      area_(num),
+      radius_(num) {
+  for (int64_t i = 0; i < num; ++i) {
+    const float *box = boxes + i * stride;
+    x_[i] = box[0];
+    y_[i] = box[1];
+    w_[i] = box[2];
+    h_[i] = box[3];
+    double theta = box[4];
+    if (flavor.float_trig) {
+      cos_half_[i] = (float)cosf(theta) * 0.5f;
+      sin_half_[i] = (float)sinf(theta) * 0.5f;
+    } else {
+      cos_half_[i] = (float)std::cos(theta) * 0.5f;
+      sin_half_[i] = (float)std::sin(theta) * 0.5f;
+    }
+    area_[i] = box[2] * box[3];
+    radius_[i] = 0.5 * std::sqrt((double)box[2] * box[2] +
+                                 (double)box[3] * box[3]);
+  }
+}
+
+float rotatedBoxIou(const RotatedBoxes &boxes1, int64_t i,
+                    const RotatedBoxes &boxes2, int64_t j, int mode) {
+  const float area1 = boxes1.area_[i];
+  const float area2 = boxes2.area_[j];
+  if (area1 < 1e-14 || area2 < 1e-14) {
+    return 0.f;
+  }
+  const double dx = (double)boxes1.x_[i] - boxes2.x_[j];
+  const double dy = (double)boxes1.y_[i] - boxes2.y_[j];
+  const double reach = (boxes1.radius_[i] + boxes2.radius_[j]) * kCircleSlack;
+  if (dx * dx + dy * dy > reach * reach) {
+    return 0.f;
+  }
+
+  // move the pair around their mid point to keep the clipping accurate.
+  auto center_shift_x = (boxes1.x_[i] + boxes2.x_[j]) / 2.0;
+  auto center_shift_y = (boxes1.y_[i] + boxes2.y_[j]) / 2.0;
+  Vec2 pts1[4], pts2[4];
+  getRotatedVertices(boxes1.x_[i] - center_shift_x,
+                     boxes1.y_[i] - center_shift_y, boxes1.w_[i],
+                     boxes1.h_[i], boxes1.cos_half_[i], boxes1.sin_half_[i],
+                     pts1);
+  getRotatedVertices(boxes2.x_[j] - center_shift_x,
+                     boxes2.y_[j] - center_shift_y, boxes2.w_[j],
+                     boxes2.h_[j], boxes2.cos_half_[j], boxes2.sin_half_[j],
+                     pts2);
+
+  const bool reciprocal = boxes1.flavor_.reciprocal;
+  Vec2 intersect_pts[24], ordered_pts[24];
+  float intersection = 0.0;
+  int num = getIntersectionPoints(pts1, pts2, reciprocal, intersect_pts);
+  if (num > 2) {
+    int num_convex = convexHullGraham(intersect_pts, num, ordered_pts);
+    intersection = polygonArea(ordered_pts, num_convex);
+  }
+
+  // mode 0 is IoU, mode 1 is IoF
+  const float base = mode == 0 ? area1 + area2 - intersection : area1;
+  return reciprocal ? intersection * (1.0f / base) : intersection / base;
+}
+
+void rotatedBoxIouMatrix(const RotatedBoxes &boxes1,
+                         const RotatedBoxes &boxes2, int mode, bool aligned,
+                         float *ious) {
+  if (aligned) {
+    parallelForChunks(boxes1.size(), kRotatedIouGrain,
+                      [&](size_t, size_t begin, size_t end) {
+                        for (size_t i = begin; i < end; ++i) {
+                          ious[i] = rotatedBoxIou(boxes1, i, boxes2, i, mode);
+                        }
+                      });
+    return;
+  }
+  const int64_t num2 = boxes2.size();
+  const size_t rows = std::max<int64_t>(1, kRotatedIouGrain / (num2 + 1));
+  parallelForChunks(boxes1.size(), rows, [&](size_t, size_t begin,
+                                             size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      for (int64_t j = 0; j < num2; ++j) {
+        ious[i * num2 + j] = rotatedBoxIou(boxes1, i, boxes2, j, mode);
+      }
+    }
+  });
+}
+
+QuadPolygons::QuadPolygons(const float *polys, int64_t num, int64_t stride)
+    : xy_(num * 8), bound_(num * 4) {
+  for (int64_t i = 0; i < num; ++i) {
+    const float *poly = polys + i * stride;
+    std::copy(poly, poly + 8, xy_.data() + i * 8);
+    float *b = bound_.data() + i * 4;
+    b[0] = std::min({poly[0], poly[2], poly[4], poly[6]});
+    b[1] = std::min({poly[1], poly[3], poly[5], poly[7]});
+    b[2] = std::max({poly[0], poly[2], poly[4], poly[6]});
+    b[3] = std::max({poly[1], poly[3], poly[5], poly[7]});
+  }
+}
+
+bool QuadPolygons::apart(int64_t i, int64_t j) const {
+  const float *a = bound_.data() + i * 4;
+  const float *b = bound_.data() + j * 4;
+  return a[2] < b[0] || b[2] < a[0] || a[3] < b[1] || b[3] < a[1];
+}
+
+float quadPolygonIou(const QuadPolygons &polys, int64_t i, int64_t j) {
+  PolyPoint ps1[kPolyMaxPoints], ps2[kPolyMaxPoints];
+  const int n1 = 4;
+  const int n2 = 4;
+  const float *p = polys.xy_.data() + i * 8;
+  const float *q = polys.xy_.data() + j * 8;
+  for (int k = 0; k < 4; k++) {
+    ps1[k].x = p[k * 2];
+    ps1[k].y = p[k * 2 + 1];
+    ps2[k].x = q[k * 2];
+    ps2[k].y = q[k * 2 + 1];
+  }
+
+  float inter_area = polygonIntersectArea(ps1, n1, ps2, n2);
+  float union_area =
+      std::fabs(area(ps1, n1)) + std::fabs(area(ps2, n2)) - inter_area;
+  if (union_area == 0) {
+    return (inter_area + 1) / (union_area + 1);
+  }
+  return inter_area / union_area;
+}
+
+std::vector<int64_t> greedyNmsKeep(
+    int64_t num, const std::function<bool(int64_t, int64_t)> &suppress) {
+  const int64_t words = (num + 63) / 64;
+  auto is_set = [](const uint64_t *bits, int64_t pos) {
+    return (bits[pos / 64] >> (pos % 64)) & 1;
+  };
+  std::vector<uint64_t> removed(words, 0);
+  std::vector<uint64_t> mask;
+  std::vector<int64_t> keep;
+  for (int64_t row0 = 0; row0 < num; row0 += kNmsBlockRows) {
+    const int64_t rows = std::min(kNmsBlockRows, num - row0);
+    mask.assign(rows * words, 0);
+    // positions removed by earlier blocks are skipped, every row only writes
+    // its own bits.
+    parallelForChunks(rows, 1, [&](size_t, size_t begin, size_t end) {
+      for (size_t r = begin; r < end; ++r) {
+        const int64_t a = row0 + r;
+        if (is_set(removed.data(), a)) {
+          continue;
+        }
+        uint64_t *bits = mask.data() + r * words;
+        for (int64_t b = a + 1; b < num; ++b) {
+          if (!is_set(removed.data(), b) && suppress(a, b)) {
+            bits[b / 64] |= uint64_t(1) << (b % 64);
+          }
+        }
+      }
+    });
+    for (int64_t r = 0; r < rows; ++r) {
+      const int64_t a = row0 + r;
+      if (is_set(removed.data(), a)) {
+        continue;
+      }
+      keep.push_back(a);
+      const uint64_t *bits = mask.data() + r * words;
+      for (int64_t w = a / 64; w < words; ++w) {
+        removed[w] |= bits[w];
+      }
+    }
+  }
+  return keep;
+}
+
+}  // namespace mluoptest
@@ -34,49 +34,183 @@ const int AVX_ALIGN = 32;
 namespace mluoptest {
 
 // CPURuntime part
-CPURuntime::CPURuntime() {}
+namespace {
+// buffers no bigger than kArenaMaxBytes are carved from arena chunks.
+const size_t kArenaChunkBytes = 1 << 20;
+const size_t kArenaMaxBytes = 64 << 10;
+const size_t kArenaAlign = 64;
+// holes of freed blocks are squeezed out once they outnumber live blocks.
+const size_t kMinCompactSlots = 64;
+}  // namespace
 
-CPURuntime::~CPURuntime() {}
+CPURuntime::CPURuntime() {
+  use_arena_ = getEnv("MLUOP_GTEST_HOST_ARENA", true);
+}
+
+CPURuntime::~CPURuntime() { destroy(); }
+
+// won't throw, free all blocks of this case and give arena back to pool.
+cnrtRet_t CPURuntime::destroy() {
+  for (auto &entry : memory_blocks_) {
+    freeBlock(&entry);
+  }
+  memory_blocks_.clear();
+  block_index_.clear();
+  free_slots_ = 0;
+  for (auto &chunk : arena_chunks_) {
+    cmp_->deallocate(chunk.base);
+  }
+  arena_chunks_.clear();
+  return cnrtSuccess;
+}
 
-// all member variable are shared_ptr.
-cnrtRet_t CPURuntime::destroy() { return cnrtSuccess; }
+void CPURuntime::addBlock(void *ptr, std::shared_ptr<MemBlockBase> obj) {
+  BlockEntry entry;
+  entry.ptr = ptr;
+  entry.obj = obj;
+  insertBlock(entry);
+  stats_.alloc_num++;
+}
+
+void CPURuntime::insertBlock(const BlockEntry &entry) {
+  block_index_[entry.ptr] = memory_blocks_.size();
+  memory_blocks_.push_back(entry);
+}
+
+void CPURuntime::removeBlock(size_t slot) {
+  freeBlock(&memory_blocks_[slot]);
+  free_slots_++;
+  while (!memory_blocks_.empty() && memory_blocks_.back().ptr == nullptr) {
+    memory_blocks_.pop_back();
+    free_slots_--;
+  }
+  if (free_slots_ < kMinCompactSlots ||
+      free_slots_ * 2 < memory_blocks_.size()) {
+    return;
+  }
+  size_t live = 0;
+  for (size_t i = 0; i < memory_blocks_.size(); ++i) {
+    if (memory_blocks_[i].ptr == nullptr) {
+      continue;
+    }
+    if (live != i) {
+      memory_blocks_[live] = std::move(memory_blocks_[i]);
+      block_index_[memory_blocks_[live].ptr] = live;
+    }
+    live++;
+  }
+  memory_blocks_.resize(live);
+  free_slots_ = 0;
+}
 
 void *CPURuntime::allocate(void *ptr, std::string name) {
   if (ptr == NULL) {
-    return NULL;  // can't free NULL, don't push NULL into vector.
+    return NULL;  // can't free NULL, don't push NULL into table.
   } else {
-    memory_blocks_.push_back(
-        std::make_shared<MemBlock<void *>>(ptr, free, name));
+    addBlock(ptr, std::make_shared<MemBlock<void *>>(ptr, free, name));
     return ptr;
   }
 }
 
+void *CPURuntime::allocateFromArena(size_t num_bytes) {
+  if (arena_chunks_.empty() ||
+      arena_chunks_.back().used + num_bytes > kArenaChunkBytes) {
+    ArenaChunk chunk;
+    chunk.base = (char *)cmp_->allocate(kArenaChunkBytes);
+    arena_chunks_.push_back(chunk);
+  }
+  auto &chunk = arena_chunks_.back();
+  void *ptr = chunk.base + chunk.used;
+  chunk.used += num_bytes;
+  return ptr;
+}
+
 void *CPURuntime::allocate(size_t num_bytes, std::string name) {
   if (num_bytes == 0) {
     return NULL;
   }
-
-#ifdef __AVX__
-  void *ptr = _mm_malloc(num_bytes, AVX_ALIGN);  // avx need align to 32
-#else
-  void *ptr = malloc(num_bytes);
+#ifdef GTEST_DEBUG_LOG
+  VLOG(4) << "CPURuntime: [allocate] malloc for [" << name << "] "
+          << num_bytes << " bytes.";
 #endif
 
-  if (ptr != NULL) {
+  BlockEntry entry;
+  void *ptr = NULL;
+  bool reused = false;
+  if (!use_arena_ || cmp_ == nullptr) {
 #ifdef __AVX__
-    memory_blocks_.push_back(
-        std::make_shared<MemBlock<void *>>(ptr, _mm_free, name));
+    ptr = _mm_malloc(num_bytes, AVX_ALIGN);  // avx need align to 32
 #else
-    memory_blocks_.push_back(
-        std::make_shared<MemBlock<void *>>(ptr, free, name));
+    ptr = malloc(num_bytes);
 #endif
-    return ptr;
+    entry.kind = BLOCK_SYSTEM;
+    entry.bytes = num_bytes;
+  } else if (num_bytes <= kArenaMaxBytes) {
+    entry.kind = BLOCK_ARENA;
+    entry.bytes = (num_bytes + kArenaAlign - 1) / kArenaAlign * kArenaAlign;
+    ptr = allocateFromArena(entry.bytes);
+    stats_.reused_num++;
+    reused = true;
   } else {
+    size_t reused_num = cmp_->getReusedNum();
+    ptr = cmp_->allocate(num_bytes);
+    entry.kind = BLOCK_POOL;
+    entry.bytes = num_bytes;
+    reused = cmp_->getReusedNum() != reused_num;
+    stats_.reused_num += reused ? 1 : 0;
+  }
+
+  if (ptr == NULL) {
     LOG(ERROR) << "CPURuntime: Failed to allocate " << num_bytes << " bytes.";
     throw std::invalid_argument(std::string(__FILE__) + " +" +
                                 std::to_string(__LINE__));
     return NULL;
   }
+  if (reused) {
+    // a fresh malloc of this size is usually zero pages, don't leak data of
+    // the buffer used before into this one.
+    memset(ptr, 0, num_bytes);
+  }
+  entry.ptr = ptr;
+  insertBlock(entry);
+  stats_.alloc_num++;
+  bytes_in_use_ += entry.bytes;
+  stats_.peak_bytes = std::max(stats_.peak_bytes, bytes_in_use_);
+  return ptr;
+}
+
+// release the memory of entry and leave a hole in its slot.
+void CPURuntime::freeBlock(BlockEntry *entry) {
+  void *ptr = entry->ptr;
+  if (ptr == nullptr) {
+    return;
+  }
+  bytes_in_use_ -= entry->bytes;
+  switch (entry->kind) {
+    case BLOCK_ARENA: {
+      // memory of arena is given back when case ends, but the newest block
+      // can be reused at once, which is the common alloc-free-alloc pattern
+      // of temp buffers.
+      auto &chunk = arena_chunks_.back();
+      if ((char *)ptr + entry->bytes == chunk.base + chunk.used) {
+        chunk.used -= entry->bytes;
+      }
+    } break;
+    case BLOCK_POOL: {
+      cmp_->deallocate(ptr);
+    } break;
+    case BLOCK_SYSTEM: {
+#ifdef __AVX__
+      _mm_free(ptr);
+#else
+      free(ptr);
+#endif
+    } break;
+    default: {
+      // BLOCK_OBJECT is released by dtor of MemBlock.
+    } break;
+  }
+  *entry = BlockEntry();
 }
 
 // MLURuntime part
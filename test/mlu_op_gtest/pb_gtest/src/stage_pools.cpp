@@ -0,0 +1,88 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <algorithm>
+#include <string>
+#include "stage_pools.h"
+#include "tools.h"
+
+namespace mluoptest {
+
+StagePools::StagePools(size_t thread_num, size_t device_limit) {
+  for (int i = 0; i < STAGE_NUM; ++i) {
+    CaseStage stage = static_cast<CaseStage>(i);
+    pools_[i].reset(new ThreadPool(
+        getStageThreads(stage, thread_num, device_limit)));
+  }
+}
+
+StagePools::~StagePools() {
+  for (int i = 0; i < STAGE_NUM; ++i) {
+    pools_[i].reset();
+  }
+}
+
+const char *StagePools::name(CaseStage stage) {
+  switch (stage) {
+    case STAGE_PARSE:
+      return "PARSE";
+    case STAGE_PREPARE:
+      return "PREPARE";
+    case STAGE_DEVICE:
+      return "DEVICE";
+    case STAGE_BASELINE:
+      return "BASELINE";
+    case STAGE_COMPARE:
+      return "COMPARE";
+    case STAGE_REPORT:
+      return "REPORT";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+size_t StagePools::getStageThreads(CaseStage stage, size_t thread_num,
+                                   size_t device_limit) {
+  std::string env = std::string("MLUOP_GTEST_") + name(stage) + "_THREADS";
+  int num = getEnvInt(env, 0);
+  size_t stage_num = num;
+  if (num <= 0) {
+    // parse, prepare, baseline and compare
+    constexpr size_t host_stage_num = 4;
+    switch (stage) {
+      case STAGE_DEVICE:
+        stage_num = thread_num;
+        break;
+      case STAGE_REPORT:
+        stage_num = 1;
+        break;
+      default:
+        stage_num = (thread_num + host_stage_num - 1) / host_stage_num;
+    }
+  }
+  if (stage == STAGE_DEVICE) {
+    stage_num = std::min(stage_num, device_limit);
+  }
+  return std::max((size_t)1, stage_num);
+}
+
+}  // namespace mluoptest
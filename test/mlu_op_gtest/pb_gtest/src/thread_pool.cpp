@@ -20,35 +20,27 @@
  * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *************************************************************************/
+#include <exception>
 #include <memory>
 #include <utility>
 #include "thread_pool.h"
 
 namespace mluoptest {
 
+namespace {
+// the pool and worker id of current thread, so that tasks submitted by a
+// worker go to its own deque.
+thread_local const void *current_pool = nullptr;
+thread_local size_t current_id = 0;
+}  // namespace
+
 ThreadPool::ThreadPool(size_t thread_num) {
   ctx_ = std::make_shared<Context>();
-
-  auto work = [=] {
-    auto ctx = ctx_;
-    std::unique_lock<std::mutex> lk(ctx->mtx);
-    for (;;) {
-      if (!ctx->tasks.empty()) {
-        auto task = std::move(ctx->tasks.front());
-        ctx->tasks.pop();
-        lk.unlock();
-        task();
-        lk.lock();
-      } else if (ctx->is_shutdown) {
-        break;
-      } else {
-        ctx->cond.wait(lk);
-      }
-    }
-  };
-
   for (size_t i = 0; i < thread_num; ++i) {
-    ctx_->workers.emplace_back(work);
+    ctx_->workers.emplace_back(new Worker());
+  }
+  for (size_t i = 0; i < thread_num; ++i) {
+    ctx_->threads.emplace_back(&ThreadPool::work, ctx_.get(), i);
   }
 }
 
@@ -57,12 +49,81 @@ ThreadPool::~ThreadPool() {
     return;
   }
   {
-    std::lock_guard<std::mutex> lk(ctx_->mtx);
+    std::lock_guard<std::mutex> lk(ctx_->idle_mtx);
     ctx_->is_shutdown = true;
   }
   ctx_->cond.notify_all();
-  for (std::thread &worker : ctx_->workers) {
-    worker.join();
+  for (std::thread &thread : ctx_->threads) {
+    thread.join();
+  }
+}
+
+void ThreadPool::push(ThreadTask &&task) {
+  GTEST_CHECK(ctx_ != nullptr && !ctx_->workers.empty(),
+              "ThreadPool: no worker to run the task.");
+  Context *ctx = ctx_.get();
+  size_t id = (current_pool == ctx)
+                  ? current_id
+                  : ctx->next.fetch_add(1) % ctx->workers.size();
+  Worker *worker = ctx->workers[id].get();
+  {
+    std::lock_guard<std::mutex> lk(worker->mtx);
+    worker->tasks.emplace_back(std::move(task));
+    ctx->pending++;
+  }
+  // idle workers increase idle_num before checking pending, so either they
+  // see this task or we see them.
+  if (ctx->idle_num > 0) {
+    std::lock_guard<std::mutex> lk(ctx->idle_mtx);
+    ctx->cond.notify_one();
+  }
+}
+
+// take a task from own deque back, or steal from the front of others.
+bool ThreadPool::pop(Context *ctx, size_t id, ThreadTask *task) {
+  size_t worker_num = ctx->workers.size();
+  for (size_t i = 0; i < worker_num; ++i) {
+    Worker *worker = ctx->workers[(id + i) % worker_num].get();
+    std::lock_guard<std::mutex> lk(worker->mtx);
+    if (worker->tasks.empty()) {
+      continue;
+    }
+    if (i == 0) {
+      *task = std::move(worker->tasks.back());
+      worker->tasks.pop_back();
+    } else {
+      *task = std::move(worker->tasks.front());
+      worker->tasks.pop_front();
+    }
+    ctx->pending--;
+    return true;
+  }
+  return false;
+}
+
+void ThreadPool::work(Context *ctx, size_t id) {
+  current_pool = ctx;
+  current_id = id;
+  for (;;) {
+    ThreadTask task;
+    if (ctx->pending > 0 && pop(ctx, id, &task)) {
+      try {
+        task();
+      } catch (std::exception &e) {
+        LOG(ERROR) << "ThreadPool: task raised an exception: " << e.what();
+      } catch (...) {
+        LOG(ERROR) << "ThreadPool: task raised an unknown exception.";
+      }
+      continue;
+    }
+    std::unique_lock<std::mutex> lk(ctx->idle_mtx);
+    ctx->idle_num++;
+    ctx->cond.wait(lk,
+                   [ctx]() { return ctx->pending > 0 || ctx->is_shutdown; });
+    ctx->idle_num--;
+    if (ctx->is_shutdown && ctx->pending == 0) {
+      break;
+    }
   }
 }
 
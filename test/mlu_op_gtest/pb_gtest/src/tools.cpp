@@ -41,19 +41,22 @@
 #include "perf_test.h"
 #include "accuracy_test.h"
 #include "math_half.h"
+#include "parallel_for.h"
+#include "core/float_cast.h"
 
 namespace mluoptest {
 
 extern GlobalVar global_var;
 
 cnrtRet_t wrapRtConvertFloatToHalf(uint16_t *f16, float d) {
-  return cnrtCastDataType_V2(&d, cnrtFloat, f16, cnrtHalf, 1, NULL,
-                             cnrtRounding_rm);
+  *f16 = mluop::castFloat32ToHalfScalar(d, mluop::FLOAT_TO_HALF_CNRT_RM);
+  return cnrtSuccess;
 }
 
+// half -> float is exact, no rounding mode is involved
 cnrtRet_t wrapRtConvertHalfToFloat(float *d, uint16_t f16) {
-  return cnrtCastDataType_V2(&f16, cnrtHalf, d, cnrtFloat, 1, NULL,
-                             cnrtRounding_rm);
+  *d = mluop::castHalfToFloat32Scalar(f16, mluop::HALF_TO_FLOAT_IEEE);
+  return cnrtSuccess;
 }
 
 size_t shapeStrideCount(const Shape *shape) {
@@ -458,50 +461,8 @@ mluOpTensorLayout_t cvtProtoLayoutToMluOp(TensorLayout order) {
 
 // ref: sopa/core/src/util/type_converter.cpp
 int16_t cvtFloatToHalf(float x) {
-  const int fs_shift = 31;
-  const int fe_shift = 23;
-  const int fe_mark = 0xff;
-  const int hs_shift = 15;
-  const int he_shift = 10;
-  int *in1 = (int *)&x;
-  int in = *in1;
-  int sign = in >> fs_shift;
-  int exp = ((in >> fe_shift) & fe_mark) - 127;
-  int denorm = 0;
-  int eff;
-  int g = 0;  // for round
-  int gr_last = 0;
-  int gr_first = 0;
-  int g_last = 0;
-  if ((exp == 128) && (in & 0x7fffff)) {  // NaN
-    exp = 0x1f - 15;
-    eff = 0x200;
-  } else if ((exp == 128)) {
-    exp = 0x1f - 15;
-    eff = 0x000;
-  } else if (exp >= 16) {
-    exp = 0xf;
-    eff = 0x3ff;
-  } else if (exp >= -14) {
-    gr_last = in & (0xfff);
-    gr_first = (in >> 12) & 1;
-    g_last = (in >> 13) & 1;
-    g = ((gr_first && gr_last) || (gr_first && g_last));
-    eff = (in >> 13) & 0x3ff;
-  } else if (exp >= -24) {
-    g = (((in & 0x7fffff) | 0x800000) >> (-exp - 2)) & 1;
-    eff = (((in & 0x7fffff) | 0x800000) >> (-exp - 1)) & 0x3ff;
-    denorm = 1;
-    exp = 0;
-  } else {
-    exp = 0;
-    denorm = 1;
-    eff = (in & 0x7fffffff) ? 1 : 0;
-  }
-  eff += g;  // round
-  exp = (denorm == 1) ? exp : (exp + 15);
-  int result = (sign << hs_shift) + (exp << he_shift) + eff;
-  return result;
+  return static_cast<int16_t>(
+      mluop::castFloat32ToHalfScalar(x, mluop::FLOAT_TO_HALF_SATURATE_RN));
 }
 
 float cvtHalfToFloat(int16_t src) {
@@ -552,7 +513,8 @@ bool hasRamdomBound(const RandomData *random_param) {
   return has_float_bound || has_double_bound;
 }
 
-size_t proc_usage_peak() {
+// read "<key>: xxx kB" from /proc/<pid>/status, in bytes.
+static size_t procStatusBytes(const std::string &key) {
   auto pid = getpid();
   std::string name = "/proc/" + std::to_string(pid) + "/status";
   std::ifstream fin(name, std::ios::in);
@@ -563,7 +525,7 @@ size_t proc_usage_peak() {
   std::string line;
   while (!fin.eof()) {
     getline(fin, line);
-    if (line.find("VmPeak:") != std::string::npos) {
+    if (line.find(key) != std::string::npos) {
       try {
         // remove space
         auto it = std::remove(line.begin(), line.end(), ' ');
@@ -584,15 +546,19 @@ size_t proc_usage_peak() {
   return 0;
 }
 
+size_t proc_usage_peak() { return procStatusBytes("VmPeak:"); }
+
+size_t proc_rss_peak() { return procStatusBytes("VmHWM:"); }
+
+// same bits as cnrtCastDataType_V2 with cnrtRounding_rm
 void arrayCastFloatToHalf(int16_t *dst, float *src, size_t num) {
-  while (num > 0) {
-    int count = (int)std::min(num, (size_t)(INT_MAX));
-    GTEST_CHECK(cnrtCastDataType_V2(src, cnrtFloat, dst, cnrtHalf, count, NULL,
-                                    cnrtRounding_rm) == cnrtSuccess);
-    dst += count;
-    src += count;
-    num -= count;
-  }
+  uint16_t *half = reinterpret_cast<uint16_t *>(dst);
+  parallelForElements(num, sizeof(float) + sizeof(uint16_t),
+                      [&](size_t begin, size_t end) {
+                        mluop::castFloat32ToHalfArray(
+                            src + begin, half + begin, end - begin,
+                            mluop::FLOAT_TO_HALF_CNRT_RM);
+                      });
 }
 
 template <AlgoHalfToFloat algo>
@@ -603,18 +569,44 @@ void arrayCastHalfToFloatAlgoImpl(float *dst, uint16_t *src, size_t num) {
   }
 }
 
+// algos below have bit-exact vectorized kernels in core/float_cast.h, each
+// chunk of a large array is converted on its own host thread
+static void castHalfToFloatChunked(float *dst, const uint16_t *src,
+                                   size_t num,
+                                   mluop::halfToFloatMode_t mode) {
+  parallelForElements(num, sizeof(float) + sizeof(uint16_t),
+                      [&](size_t begin, size_t end) {
+                        mluop::castHalfToFloat32Array(src + begin, dst + begin,
+                                                      end - begin, mode);
+                      });
+}
+
+template <>
+void arrayCastHalfToFloatAlgoImpl<AlgoHalfToFloat::SOPA>(float *dst,
+                                                         uint16_t *src,
+                                                         size_t num) {
+  castHalfToFloatChunked(dst, src, num, mluop::HALF_TO_FLOAT_SATURATE_SOPA);
+}
+
+template <>
+void arrayCastHalfToFloatAlgoImpl<AlgoHalfToFloat::MLUOPGTEST2>(float *dst,
+                                                                uint16_t *src,
+                                                                size_t num) {
+  castHalfToFloatChunked(dst, src, num, mluop::HALF_TO_FLOAT_SATURATE_QNAN);
+}
+
+// cnrtCastDataType_V2 and F16C are both exact for half -> float
 template <>
 void arrayCastHalfToFloatAlgoImpl<AlgoHalfToFloat::CNRT>(float *dst,
                                                          uint16_t *src,
                                                          size_t num) {
-  while (num) {
-    int count = (int)std::min(num, (size_t)(INT_MAX));
-    GTEST_CHECK(cnrtCastDataType_V2(src, cnrtHalf, dst, cnrtFloat, count, NULL,
-                                    cnrtRounding_rm) == cnrtSuccess);
-    dst += count;
-    src += count;
-    num -= count;
-  }
+  castHalfToFloatChunked(dst, src, num, mluop::HALF_TO_FLOAT_IEEE);
+}
+
+template <>
+void arrayCastHalfToFloatAlgoImpl<AlgoHalfToFloat::CPU_INTRINSIC>(
+    float *dst, uint16_t *src, size_t num) {
+  castHalfToFloatChunked(dst, src, num, mluop::HALF_TO_FLOAT_IEEE);
 }
 
 void arrayCastHalfToFloatInvalidInf(float *dst, uint16_t *src, size_t num) {
@@ -689,42 +681,26 @@ void arrayCastFloatAndNormal<float, bool>(void *dst, void *src, size_t num) {
 
 // Note: here uint16_t is acutally bf16
 void arrayCastFloatToBF16(uint16_t *dst, float *src, size_t num) {
-// rounding mode: rn
-#pragma omp parallel for schedule(guided)
-  for (size_t i = 0; i < num; ++i) {
-    union {
-      uint32_t src_i_u32;
-      float src_i_f32;
-    };
-    src_i_f32 = src[i];
-    if (std::isnan(src_i_f32)) {
-      // XXX(zhaolianshui): loosing sign and quiet_nan/signaling_nan info
-      ((uint16_t *)dst)[i] = 0x7FC0;
-    } else {
-      uint32_t rounding_bias = ((src_i_u32 >> 16) & 1) + (uint32_t)0x7FFF;
-      dst[i] = static_cast<uint16_t>((src_i_u32 + rounding_bias) >> 16);
-    }
-  }
+  // rounding mode: rn
+  parallelForElements(num, sizeof(float) + sizeof(uint16_t),
+                      [&](size_t begin, size_t end) {
+                        mluop::castFloat32ToBfloat16Array(
+                            src + begin, dst + begin, end - begin);
+                      });
 }
 
 // the actual dtype of src is bf16
 float cvtBF16ToFloat(uint16_t src_i) {
-  union {
-    uint32_t src_i_u32;
-    float src_i_f32;
-  };
-  src_i_u32 = src_i;
-  src_i_u32 <<= 16;
-  return src_i_f32;
+  return mluop::castBfloat16ToFloat32Scalar(src_i);
 }
 
 // Note: here uint16_t is acutally bf16
 void arrayCastBF16ToFloat(float *dst, uint16_t *src, size_t num) {
-#pragma omp parallel for schedule(guided)
-  for (size_t i = 0; i < num; ++i) {
-    uint16_t src_i = src[i];
-    dst[i] = cvtBF16ToFloat(src_i);
-  }
+  parallelForElements(num, sizeof(float) + sizeof(uint16_t),
+                      [&](size_t begin, size_t end) {
+                        mluop::castBfloat16ToFloat32Array(
+                            src + begin, dst + begin, end - begin);
+                      });
 }
 
 // support uint8, uint16, uint32, uint64, int8, int16, int32, int64, bool
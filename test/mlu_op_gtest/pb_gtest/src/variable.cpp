@@ -82,6 +82,22 @@ void GlobalVar::init(int *argc, char **argv) {
     get_vmpeak_ = getParam(arg, "--get_vmpeak").empty()
                       ? get_vmpeak_
                       : getParam(arg, "--get_vmpeak");
+    cases_include_ = getParam(arg, "--cases_include").empty()
+                         ? cases_include_
+                         : getParam(arg, "--cases_include");
+    cases_exclude_ = getParam(arg, "--cases_exclude").empty()
+                         ? cases_exclude_
+                         : getParam(arg, "--cases_exclude");
+    cases_shard_index_ =
+        getParam(arg, "--cases_shard_index").empty()
+            ? cases_shard_index_
+            : to_int(getParam(arg, "--cases_shard_index"),
+                     "--cases_shard_index");
+    cases_shard_count_ =
+        getParam(arg, "--cases_shard_count").empty()
+            ? cases_shard_count_
+            : to_int(getParam(arg, "--cases_shard_count"),
+                     "--cases_shard_count");
     rand_n_ = getParam(arg, "--rand_n").empty()
                   ? rand_n_
                   : to_int(getParam(arg, "--rand_n"), "--rand_n");
@@ -91,6 +107,13 @@ void GlobalVar::init(int *argc, char **argv) {
     thread_num_ = getParam(arg, "--thread").empty()
                       ? thread_num_
                       : to_int(getParam(arg, "--thread"), "--thread");
+    process_num_ = getParam(arg, "--processes").empty()
+                       ? process_num_
+                       : to_int(getParam(arg, "--processes"), "--processes");
+    case_timeout_ =
+        getParam(arg, "--case_timeout").empty()
+            ? case_timeout_
+            : to_int(getParam(arg, "--case_timeout"), "--case_timeout");
     half2float_algo_ =
         getParam(arg, "--half2float_algo").empty()
             ? half2float_algo_
@@ -220,9 +243,15 @@ void GlobalVar::print() {
   std::cout << "cases_list is " << cases_list_ << ENDL;
   std::cout << "cases_path is " << case_path_ << ENDL;
   std::cout << "get_vmpeak is " << get_vmpeak_ << ENDL;
+  std::cout << "cases_include is " << cases_include_ << ENDL;
+  std::cout << "cases_exclude is " << cases_exclude_ << ENDL;
+  std::cout << "cases_shard is " << cases_shard_index_ << "/"
+            << cases_shard_count_ << ENDL;
   std::cout << "rand_n is " << rand_n_ << ENDL;
   std::cout << "repeat is " << repeat_ << ENDL;
   std::cout << "thread is " << thread_num_ << ENDL;
+  std::cout << "processes is " << process_num_ << ENDL;
+  std::cout << "case_timeout is " << case_timeout_ << ENDL;
   std::cout << "half2float_algo is " << half2float_algo_ << ENDL;
   std::cout << "shuffle is " << shuffle_ << ENDL;
   std::cout << "mlu_only is " << mlu_only_ << ENDL;
@@ -242,6 +271,17 @@ void GlobalVar::print() {
 }
 
 void GlobalVar::checkUnsupportedTest() const {
+  if (cases_shard_count_ < 1 || cases_shard_index_ < 0 ||
+      cases_shard_index_ >= cases_shard_count_) {
+    LOG(ERROR) << "Invalid --cases_shard_index=" << cases_shard_index_
+               << " of --cases_shard_count=" << cases_shard_count_ << ".";
+    exit(EXIT_FAILURE_MLUOP);
+  }
+  if (process_num_ < 1 || case_timeout_ < 0) {
+    LOG(ERROR) << "Invalid --processes=" << process_num_
+               << " or --case_timeout=" << case_timeout_ << ".";
+    exit(EXIT_FAILURE_MLUOP);
+  }
   // random_mlu_address use MLU memory pool, which is not mutex guarded, so
   // don't use it in multi-thread mode
   if (thread_num_ > 1) {
@@ -0,0 +1,194 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "voxel_segments.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include "parallel_for.h"
+
+namespace mluoptest {
+
+namespace {
+
+constexpr int kRadixBits = 8;
+constexpr size_t kRadixBuckets = (size_t)1 << kRadixBits;
+// points per chunk of the parallel key, histogram and scatter loops.
+constexpr size_t kRadixGrain = (size_t)1 << 16;
+
+int bitWidth(uint64_t v) {
+  int bits = 0;
+  while (bits < 64 && (v >> bits) != 0) {
+    ++bits;
+  }
+  return bits;
+}
+
+}  // namespace
+
+void radixSortByKey(int key_bits, std::vector<uint64_t> *keys,
+                    std::vector<int32_t> *order) {
+  const size_t n = keys->size();
+  if (n <= 1) {
+    return;
+  }
+  const size_t chunk_num = (n + kRadixGrain - 1) / kRadixGrain;
+  std::vector<size_t> hist(chunk_num * kRadixBuckets);
+  std::vector<uint64_t> keys_out(n);
+  std::vector<int32_t> order_out(n);
+  for (int shift = 0; shift < key_bits; shift += kRadixBits) {
+    const uint64_t *src_keys = keys->data();
+    const int32_t *src_order = order->data();
+    std::fill(hist.begin(), hist.end(), 0);
+    parallelForChunks(n, kRadixGrain, [&](size_t chunk, size_t b, size_t e) {
+      size_t *chunk_hist = hist.data() + chunk * kRadixBuckets;
+      for (size_t i = b; i < e; ++i) {
+        ++chunk_hist[(src_keys[i] >> shift) & (kRadixBuckets - 1)];
+      }
+    });
+    // bucket offsets in (digit, chunk) order, which keeps the pass stable.
+    size_t offset = 0;
+    bool single_digit = false;
+    for (size_t digit = 0; digit < kRadixBuckets; ++digit) {
+      size_t digit_count = 0;
+      for (size_t chunk = 0; chunk < chunk_num; ++chunk) {
+        size_t count = hist[chunk * kRadixBuckets + digit];
+        hist[chunk * kRadixBuckets + digit] = offset;
+        offset += count;
+        digit_count += count;
+      }
+      single_digit = single_digit || digit_count == n;
+    }
+    if (single_digit) {
+      continue;
+    }
+    parallelForChunks(n, kRadixGrain, [&](size_t chunk, size_t b, size_t e) {
+      size_t *chunk_offset = hist.data() + chunk * kRadixBuckets;
+      for (size_t i = b; i < e; ++i) {
+        size_t digit = (src_keys[i] >> shift) & (kRadixBuckets - 1);
+        size_t pos = chunk_offset[digit]++;
+        keys_out[pos] = src_keys[i];
+        order_out[pos] = src_order[i];
+      }
+    });
+    keys->swap(keys_out);
+    order->swap(order_out);
+  }
+}
+
+void VoxelSegments::buildFromCoors(const float *coors, int64_t num_points,
+                                   int num_coors) {
+  points_.resize(std::max((int64_t)0, num_points));
+  offsets_.assign(1, 0);
+  if (num_points <= 0) {
+    return;
+  }
+  // coordinates compare as int32, like the original comparator.
+  auto coor = [=](int64_t i, int d) {
+    return (int64_t)(int32_t)coors[i * num_coors + d];
+  };
+  std::vector<int64_t> lo(num_coors, std::numeric_limits<int64_t>::max());
+  std::vector<int64_t> hi(num_coors, std::numeric_limits<int64_t>::min());
+  for (int64_t i = 0; i < num_points; ++i) {
+    for (int d = 0; d < num_coors; ++d) {
+      lo[d] = std::min(lo[d], coor(i, d));
+      hi[d] = std::max(hi[d], coor(i, d));
+    }
+  }
+  std::vector<int> bits(num_coors);
+  int key_bits = 0;
+  for (int d = 0; d < num_coors; ++d) {
+    bits[d] = bitWidth(hi[d] - lo[d]);
+    key_bits += bits[d];
+  }
+
+  std::iota(points_.begin(), points_.end(), 0);
+  auto same_row = [&](int32_t i, int32_t j) {
+    for (int d = 0; d < num_coors; ++d) {
+      if (coor(i, d) != coor(j, d)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  if (key_bits <= 64) {
+    // pack the offset coordinates, first coordinate in the high bits, so
+    // the key order is the lexicographic order of the rows.
+    std::vector<uint64_t> keys(num_points);
+    auto pack = [&](size_t, size_t b, size_t e) {
+      for (size_t i = b; i < e; ++i) {
+        uint64_t key = 0;
+        for (int d = 0; d < num_coors; ++d) {
+          key = (key << bits[d]) | (uint64_t)(coor(i, d) - lo[d]);
+        }
+        keys[i] = key;
+      }
+    };
+    parallelForChunks(num_points, kRadixGrain, pack);
+    radixSortByKey(key_bits, &keys, &points_);
+  } else {
+    std::stable_sort(points_.begin(), points_.end(),
+                     [&](int32_t i, int32_t j) {
+                       for (int d = 0; d < num_coors; ++d) {
+                         if (coor(i, d) != coor(j, d)) {
+                           return coor(i, d) < coor(j, d);
+                         }
+                       }
+                       return false;
+                     });
+  }
+  for (int64_t k = 1; k < num_points; ++k) {
+    if (!same_row(points_[k - 1], points_[k])) {
+      offsets_.push_back(k);
+    }
+  }
+  offsets_.push_back(num_points);
+}
+
+void VoxelSegments::buildFromVoxelIds(const float *voxel_ids,
+                                      int64_t num_points,
+                                      int64_t num_voxels) {
+  // a single counting pass, the ids are already dense.
+  offsets_.assign(std::max((int64_t)0, num_voxels) + 1, 0);
+  auto voxel = [=](int64_t i) { return (int64_t)(int32_t)voxel_ids[i]; };
+  for (int64_t i = 0; i < num_points; ++i) {
+    int64_t v = voxel(i);
+    if (v >= 0 && v < num_voxels) {
+      ++offsets_[v + 1];
+    }
+  }
+  for (int64_t v = 0; v < num_voxels; ++v) {
+    offsets_[v + 1] += offsets_[v];
+  }
+  points_.resize(offsets_.back());
+  std::vector<int64_t> next(offsets_.begin(), offsets_.end() - 1);
+  for (int64_t i = 0; i < num_points; ++i) {
+    int64_t v = voxel(i);
+    if (v >= 0 && v < num_voxels) {
+      points_[next[v]++] = i;
+    }
+  }
+}
+
+}  // namespace mluoptest
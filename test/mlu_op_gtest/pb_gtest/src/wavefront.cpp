@@ -0,0 +1,88 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include "wavefront.h"
+
+#include <algorithm>
+
+#include "parallel_for.h"
+
+namespace mluoptest {
+
+namespace {
+
+int tileNum(int begin, int end, int tile) {
+  return end < begin ? 0 : (end - begin) / tile + 1;
+}
+
+}  // namespace
+
+void wavefrontForTiles(const std::vector<WavefrontBox> &boxes, bool reverse,
+                       const std::function<void(const WavefrontBox &)> &func) {
+  int diag_num = 0;
+  for (const auto &box : boxes) {
+    const int s_tiles = tileNum(box.s_begin, box.s_end, kWavefrontTileRows);
+    const int t_tiles = tileNum(box.t_begin, box.t_end, kWavefrontTileCols);
+    if (s_tiles > 0 && t_tiles > 0) {
+      diag_num = std::max(diag_num, s_tiles + t_tiles - 1);
+    }
+  }
+
+  // tile (i, j) counts from the start corner of the recurrence, which is
+  // the far corner of the box when reverse is set.
+  auto tile_range = [&](int begin, int end, int i, int tile, int *lo,
+                        int *hi) {
+    if (!reverse) {
+      *lo = begin + i * tile;
+      *hi = std::min(end, *lo + tile - 1);
+    } else {
+      *hi = end - i * tile;
+      *lo = std::max(begin, *hi - tile + 1);
+    }
+  };
+
+  std::vector<WavefrontBox> tiles;
+  for (int d = 0; d < diag_num; ++d) {
+    tiles.clear();
+    for (const auto &box : boxes) {
+      const int s_tiles = tileNum(box.s_begin, box.s_end, kWavefrontTileRows);
+      const int t_tiles = tileNum(box.t_begin, box.t_end, kWavefrontTileCols);
+      for (int i = std::max(0, d - t_tiles + 1); i < std::min(d + 1, s_tiles);
+           ++i) {
+        WavefrontBox tile;
+        tile.b = box.b;
+        tile_range(box.s_begin, box.s_end, i, kWavefrontTileRows, &tile.s_begin,
+                   &tile.s_end);
+        tile_range(box.t_begin, box.t_end, d - i, kWavefrontTileCols,
+                   &tile.t_begin, &tile.t_end);
+        tiles.push_back(tile);
+      }
+    }
+    parallelForChunks(tiles.size(), 1, [&](size_t, size_t begin, size_t end) {
+      for (size_t k = begin; k < end; ++k) {
+        func(tiles[k]);
+      }
+    });
+  }
+}
+
+}  // namespace mluoptest
@@ -22,6 +22,8 @@
  *************************************************************************/
 #include "abs.h"
 
+#include "parallel_for.h"
+
 namespace mluoptest {
 
 void AbsExecutor::paramCheck() {
@@ -51,20 +53,27 @@ void AbsExecutor::cpuCompute() {
     if (count1 == 0 || count2 == 0) {
       return;
     }
-    for (int i = 0; i < count1; ++i) {
-      cpu_fp32_output_[0][i] =
-          std::hypotf(cpu_fp32_input_[0][2 * i], cpu_fp32_input_[0][2 * i + 1]);
-    }
+    const float *x = cpu_fp32_input_[0];
+    float *y = cpu_fp32_output_[0];
+    parallelForElements(count1, 3 * sizeof(float),
+                        [&](size_t begin, size_t end) {
+                          for (size_t i = begin; i < end; ++i) {
+                            y[i] = std::hypotf(x[2 * i], x[2 * i + 1]);
+                          }
+                        });
   } else {
     auto count = parser_->input(0)->shape_count;
     if (count == 0) {
       return;
     }
-    for (size_t i = 0; i < count; ++i) {
-      cpu_fp32_output_[0][i] = (cpu_fp32_input_[0][i] >= 0)
-                                   ? cpu_fp32_input_[0][i]
-                                   : -1 * (cpu_fp32_input_[0][i]);
-    }
+    const float *x = cpu_fp32_input_[0];
+    float *y = cpu_fp32_output_[0];
+    parallelForElements(count, 2 * sizeof(float),
+                        [&](size_t begin, size_t end) {
+                          for (size_t i = begin; i < end; ++i) {
+                            y[i] = (x[i] >= 0) ? x[i] : -1 * (x[i]);
+                          }
+                        });
   }
 }
 
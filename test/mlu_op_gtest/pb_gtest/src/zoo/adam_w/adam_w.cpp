@@ -23,6 +23,7 @@
 
 #include "adam_w.h"
 #include "cn_api.h"
+#include "parallel_for.h"
 
 namespace mluoptest {
 
@@ -126,23 +127,27 @@ void AdamWExecutor::cpuCompute() {
   auto cpu_tensor_momentum_output = cpu_fp32_output_[2];
   auto cpu_tensor_velocity_output = cpu_fp32_output_[3];
 
-  for (int i = 0; i < count1; ++i) {
-    // output is: momentum velocity param param_h
-    cpu_tensor_grad[i] = cpu_tensor_grad[i] / fp32_scale;
-    cpu_tensor_momentum_output[i] =
-        cpu_tensor_momentum[i] +
-        (cpu_tensor_grad[i] - cpu_tensor_momentum[i]) * (1 - beta1);
-    cpu_tensor_velocity_output[i] =
-        cpu_tensor_velocity[i] +
-        (cpu_tensor_grad[i] * cpu_tensor_grad[i] - cpu_tensor_velocity[i]) *
-            (1 - beta2);
-    cpu_tensor_param_output[i] =
-        cpu_tensor_param[i] -
-        lr * cpu_tensor_momentum_output[i] / bias1 /
-            (sqrt(cpu_tensor_velocity_output[i] / bias2) + epsilon) -
-        lr * fp32_weight_decay * cpu_tensor_param[i];
-    cpu_tensor_paramh_output[i] = cpu_tensor_param_output[i];
-  }
+  // 5 inputs and 4 outputs of float per element
+  parallelForElements(count1, 9 * sizeof(float), [&](size_t begin,
+                                                     size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      // output is: momentum velocity param param_h
+      cpu_tensor_grad[i] = cpu_tensor_grad[i] / fp32_scale;
+      cpu_tensor_momentum_output[i] =
+          cpu_tensor_momentum[i] +
+          (cpu_tensor_grad[i] - cpu_tensor_momentum[i]) * (1 - beta1);
+      cpu_tensor_velocity_output[i] =
+          cpu_tensor_velocity[i] +
+          (cpu_tensor_grad[i] * cpu_tensor_grad[i] - cpu_tensor_velocity[i]) *
+              (1 - beta2);
+      cpu_tensor_param_output[i] =
+          cpu_tensor_param[i] -
+          lr * cpu_tensor_momentum_output[i] / bias1 /
+              (sqrt(cpu_tensor_velocity_output[i] / bias2) + epsilon) -
+          lr * fp32_weight_decay * cpu_tensor_param[i];
+      cpu_tensor_paramh_output[i] = cpu_tensor_param_output[i];
+    }
+  });
 }
 
 }  // namespace mluoptest
@@ -28,8 +28,12 @@
 
 #include "mlu_op.h"
 #include "core/type.h"
+#include "parallel_for.h"
+#include "point_grid.h"
 
 namespace mluoptest {
+constexpr size_t kBallQueryGrain = 256;
+
 void BallQueryExecutor::paramCheck() {
   GTEST_CHECK(parser_->inputs().size() == 2,
               "[BallQueryExecutor] input number is wrong. ");
@@ -90,42 +94,28 @@ void BallQueryExecutor::cpuCompute() {
   max_radius_ = parser_->getProtoNode()->ball_query_param().max_radius();
   nsample_ = parser_->getProtoNode()->ball_query_param().nsample();
 
-  float min_radius2 = min_radius_ * min_radius_;
-  float max_radius2 = max_radius_ * max_radius_;
-
-  for (int b_idx = 0; b_idx < b; ++b_idx) {
-    for (int row = 0; row < m; ++row) {
-      int record_idx = 0;
-      bool in_ball = false;
-      for (int col = 0; col < n; ++col) {
-        float sub_x1 = new_xyz_host[b_idx * m * 3 + row * 3 + 0] -
-                       xyz_host[b_idx * n * 3 + col * 3 + 0];
-        float sub_y1 = new_xyz_host[b_idx * m * 3 + row * 3 + 1] -
-                       xyz_host[b_idx * n * 3 + col * 3 + 1];
-        float sub_z1 = new_xyz_host[b_idx * m * 3 + row * 3 + 2] -
-                       xyz_host[b_idx * n * 3 + col * 3 + 2];
-        float distance2 = sub_x1 * sub_x1 + sub_y1 * sub_y1 + sub_z1 * sub_z1;
-        if (distance2 == 0 ||
-            (distance2 >= min_radius2 && distance2 < max_radius2)) {
-          in_ball = true;
-          if (record_idx == 0) {
-            for (int i = 0; i < nsample_; ++i) {
-              idx_host[b_idx * m * nsample_ + row * nsample_ + i] = col;
-            }
+  std::vector<PointGrid> grids(b);
+  parallelForChunks(b, 1, [&](size_t, size_t begin, size_t end) {
+    for (size_t b_idx = begin; b_idx < end; ++b_idx) {
+      // cells of max_radius keep a query within its 27 neighbouring cells.
+      grids[b_idx].build(xyz_host + b_idx * n * 3, n, max_radius_);
+    }
+  });
+  parallelForChunks(
+      (size_t)b * m, kBallQueryGrain, [&](size_t, size_t begin, size_t end) {
+        std::vector<int32_t> indices;
+        for (size_t q = begin; q < end; ++q) {
+          grids[q / m].radiusQuery(new_xyz_host + q * 3, min_radius_,
+                                   max_radius_, nsample_, &indices);
+          // unfilled samples repeat the first point in the ball, or are 0
+          // when the ball is empty.
+          float *idx = idx_host + q * nsample_;
+          const float first = indices.empty() ? 0.0f : (float)indices[0];
+          for (int i = 0; i < nsample_; ++i) {
+            idx[i] = i < (int)indices.size() ? (float)indices[i] : first;
           }
-          idx_host[b_idx * m * nsample_ + row * nsample_ + record_idx] = col;
-          ++record_idx;
-          if (record_idx >= nsample_) break;
         }
-      }
-      if (!in_ball) {  // for one nex_xyz point, if xyz points are out of
-                       // ball,then set this idx_host to 0
-        for (int i = 0; i < nsample_; ++i) {
-          idx_host[b_idx * m * nsample_ + row * nsample_ + i] = 0;
-        }
-      }
-    }
-  }
+      });
   VLOG(4) << "BallQuery cpu compute done";
 }
 
@@ -21,13 +21,13 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *************************************************************************/
 
+#include <algorithm>
 #include <string>
+#include <vector>
 #include "dcn_backward_data.h"
-#define USE_OPENBLAS 0
-
-#if USE_OPENBLAS
-#include <openblas/cblas.h>
-#endif
+#include "cpu_gemm.h"
+#include "deform_im2col.h"
+#include "parallel_for.h"
 
 namespace mluoptest {
 
@@ -195,24 +195,6 @@ void DcnBackwardDataExecutor::cpuCompute() {
                       grad_mask_desc_, host_grad_mask);
 }
 
-void DcnBackwardDataExecutor::transposeGradOutput(const float *output,
-                                                  const int group,
-                                                  const int ndhw, const int c,
-                                                  float *transpose_output) {
-  // [1, im2col * d * h * w, group, c]
-  // ->
-  // [1, group, im2col * d * h * w, c]
-  VLOG(4) << "transposeGradOutput()";
-  for (int ndhw_iter = 0; ndhw_iter < ndhw; ndhw_iter++) {
-    for (int group_iter = 0; group_iter < group; group_iter++) {
-      for (int c_iter = 0; c_iter < c; c_iter++) {
-        transpose_output[group_iter * ndhw * c + ndhw_iter * c + c_iter] =
-            output[ndhw_iter * group * c + group_iter * c + c_iter];
-      }
-    }
-  }
-}
-
 void DcnBackwardDataExecutor::transposeGradCol(const float *dcol,
                                                const int group,
                                                const int middle, const int c,
@@ -252,12 +234,8 @@ void DcnBackwardDataExecutor::hostDCNBackwardData(
 
   int ci = mluOpGetTensordimC(weight_desc);
   int co = mluOpGetTensordimN(weight_desc) / conv_group_;
-  int c_per_deform_group = ci / deformable_group_;
   int im2col_step = im2col_step_;
 
-  float *dcol = cpu_runtime_.allocate(
-      new float[im2col_step * d_o * ho * wo * kd * kh * kw * conv_group_ * ci]);
-
   for (int iter = 0; iter < n * di * hi * wi * conv_group_ * ci; iter++) {
     grad_input[iter] = 0.0;
   }
@@ -272,129 +250,62 @@ void DcnBackwardDataExecutor::hostDCNBackwardData(
       grad_mask[iter] = 0.0;
     }
   }
-#if USE_OPENBLAS
-#else
-  auto matmul = [](float *lhs, float *rhs, float *output, bool is_trans_a,
-                   bool is_trans_b, int M, int N, int K) {
-    for (int m = 0; m < M; m++) {
-      for (int n = 0; n < N; n++) {
-        output[m * N + n] = 0.0f;
-        for (int k = 0; k < K; k++) {
-          int lhs_idx = m * K + k;
-          if (is_trans_a) lhs_idx = k * M + m;
-          int rhs_idx = k * N + n;
-          if (is_trans_b) rhs_idx = n * K + k;
-          output[m * N + n] += lhs[lhs_idx] * rhs[rhs_idx];
-        }
-      }
-    }
-  };
-#endif
-
-  for (int batch_iter = 0; batch_iter < n / im2col_step; batch_iter++) {
-    VLOG(4) << "iter: " << batch_iter << " / " << n / im2col_step << ".";
-    float *trans_grad_output;
-    if (conv_group_ == 1) {
-      trans_grad_output =
-          grad_output + batch_iter * im2col_step * d_o * ho * wo * co;
-    } else {
-      trans_grad_output = cpu_runtime_.allocate(
-          new float[conv_group_ * im2col_step * d_o * ho * wo * co]);
-      float *grad_output_iter =
-          grad_output + batch_iter * im2col_step * d_o * ho * wo * co;
-      transposeGradOutput(grad_output_iter, conv_group_,
-                          im2col_step * d_o * ho * wo, co, trans_grad_output);
-      theory_ops_ += conv_group_ * im2col_step * d_o * ho * wo, co;
-    }
 
-    for (int group_iter = 0; group_iter < conv_group_; group_iter++) {
-      float *grad_output_addr =
-          trans_grad_output + group_iter * im2col_step * ho * wo * co;
-      float *weight_addr = weight + group_iter * co * kh * kw * ci;
-      float *col_addr =
-          dcol + group_iter * im2col_step * d_o * ho * wo * kd * kh * kw * ci;
-#if USE_OPENBLAS
-      const CBLAS_ORDER Order = CblasRowMajor;
-      const CBLAS_TRANSPOSE TransA = CblasNoTrans;
-      const CBLAS_TRANSPOSE TransB = CblasNoTrans;
-      const float alpha = 1.0;
-      const float beta = 0.0;
-
-      cblas_sgemm(Order, TransA, TransB, im2col_step * d_o * ho * wo,
-                  kd * kh * kw * ci, co, alpha, grad_output_addr, co,
-                  weight_addr, kd * kh * kw * ci, beta, col_addr,
-                  kd * kh * kw * ci);
-#else
-      matmul(grad_output_addr, weight_addr, col_addr, false, false,
-             im2col_step * d_o * ho * wo, kd * kh * kw * ci, co);
-#endif
-      int coeff = getCoefficientOfLT2CT();
-      theory_ops_ += 2 * im2col_step * d_o * ho * wo * kd * kh * kw * ci * co /
-                     coeff;  // lt2ct
-    }
-
-    float *trans_grad_col;
-    if (conv_group_ != 1) {
-      trans_grad_col = cpu_runtime_.allocate(
-          new float[im2col_step * d_o * ho * wo * kh * kw * conv_group_ * ci]);
-      transposeGradCol(dcol, conv_group_,
-                       im2col_step * d_o * ho * wo * kd * kh * kw, ci,
-                       trans_grad_col);
-      theory_ops_ +=
-          conv_group_ * im2col_step * d_o * ho * wo * kd * kh * kw * ci;
-    } else {
-      trans_grad_col = dcol;
-    }
+  const int chunk_num = n / im2col_step;
+  if (dimNb_ != 4) {
+    // TODO(sunhui): reserve for 3D DCN Backward Data
+    return;
+  }
 
-    if (dimNb_ == 4) {
-      int input_deal_once = im2col_step * hi * wi * ci;
-      int offset_deal_once =
-          im2col_step * ho * wo * deformable_group_ * kh * kw * 2;
-      int mask_deal_once = im2col_step * ho * wo * deformable_group_ * kh * kw;
-      float *input_addr = input + batch_iter * input_deal_once;
-      float *offset_addr = offset + batch_iter * offset_deal_once;
-      float *mask_addr =
-          mask == nullptr ? nullptr : mask + batch_iter * mask_deal_once;
-      float *grad_input_addr = grad_input + batch_iter * input_deal_once;
-      float *grad_offset_addr = grad_offset + batch_iter * offset_deal_once;
-      float *grad_mask_addr = grad_mask == nullptr
-                                  ? nullptr
-                                  : grad_mask + batch_iter * mask_deal_once;
-
-      col2img4D(trans_grad_col, input_addr, offset_addr, mask_addr,
-                grad_input_addr, grad_offset_addr, grad_mask_addr, im2col_step,
-                hi, wi, ci, co, kh, kw, pad_, stride_, dilation_,
-                deformable_group_, conv_group_);
-      // bilinear(16) + grad_mask(2) + grad_offset(8)
-      theory_ops_ += im2col_step * ho * wo * kh * kw * deformable_group_ *
-                     c_per_deform_group * 28;
-      // grad input (2 * grad bilinear loop (4))
-      theory_ops_ += im2col_step * ho * wo * kh * kw * deformable_group_ *
-                     c_per_deform_group * 4 * 2;
-    } else {  // dimNb == 5
-      // TODO(sunhui): reserve for 3D DCN Backward Data
-    }
+  // grad columns are built for a tile of output rows at a time, the rows of
+  // all im2col steps are consecutive so tiles may cross step boundaries.
+  const DeformConvShape shape = {hi, wi, conv_group_ * ci, ho, wo, kh, kw,
+                                 pad_[0], pad_[2], stride_[0], stride_[1],
+                                 dilation_[0], dilation_[1], deformable_group_,
+                                 conv_group_};
+  const int64_t total_rows = (int64_t)chunk_num * im2col_step * ho * wo;
+  const int64_t tile_rows = std::min(total_rows, deformColumnTileRows(shape));
+  const int64_t group_k = (int64_t)kh * kw * ci;
+  float *dcol =
+      cpu_runtime_.allocate(new float[tile_rows * conv_group_ * group_k]);
+  float *trans_grad_col =
+      conv_group_ == 1
+          ? dcol
+          : cpu_runtime_.allocate(new float[tile_rows * conv_group_ * group_k]);
+  for (int64_t row_begin = 0; row_begin < total_rows; row_begin += tile_rows) {
+    const int64_t rows = std::min(tile_rows, total_rows - row_begin);
+    VLOG(4) << "rows: " << row_begin << " / " << total_rows << ".";
+    // grad_output rows are [conv_group, co], so the group slices are read
+    // in place through lda instead of being transposed first.
+    cpuSgemmBatched(false, false, rows, group_k, co, 1.0f,
+                    grad_output + row_begin * conv_group_ * co,
+                    conv_group_ * co, co, weight, group_k, co * group_k, 0.0f,
+                    dcol, group_k, rows * group_k, conv_group_);
     if (conv_group_ != 1) {
-      cpu_runtime_.deallocate(trans_grad_col);
-      cpu_runtime_.deallocate(trans_grad_output);
+      transposeGradCol(dcol, conv_group_, rows * kh * kw, ci, trans_grad_col);
     }
-  }  // end batch iteration
+    col2img4D(trans_grad_col, row_begin, row_begin + rows, input, offset, mask,
+              grad_input, grad_offset, grad_mask, hi, wi, ci, co, kh, kw, pad_,
+              stride_, dilation_, deformable_group_, conv_group_);
+  }
+  if (conv_group_ != 1) {
+    cpu_runtime_.deallocate(trans_grad_col);
+  }
   cpu_runtime_.deallocate(dcol);
 }
 
 /*
- * grad_col: n, ho, wo, kh, kw, deform_group, ci_per_deform_group
+ * grad_col: rows, kh, kw, deform_group, ci_per_deform_group
  * input: n, hi, wi, conv_group * ci
  * offset: n, ho, wo, deform_group, kh, kw, 2
  * mask: n, ho, wo, deform_group, kh, kw
+ * grad_col holds output rows [row_begin, row_end), row = (n * ho + h) * wo + w.
  */
-void DcnBackwardDataExecutor::col2img4D(float *grad_col, float *input,
-                                        float *offset, float *mask,
-                                        float *grad_input, float *grad_offset,
-                                        float *grad_mask, int n, int hi, int wi,
-                                        int ci, int co, int kh, int kw,
-                                        int pad[], int stride[], int dilation[],
-                                        int deform_group, int conv_group) {
+void DcnBackwardDataExecutor::col2img4D(
+    const float *grad_col, int64_t row_begin, int64_t row_end, float *input,
+    float *offset, float *mask, float *grad_input, float *grad_offset,
+    float *grad_mask, int hi, int wi, int ci, int co, int kh, int kw, int pad[],
+    int stride[], int dilation[], int deform_group, int conv_group) {
   int pt = pad[0];
   int pb = pad[1];
   int pl = pad[2];
@@ -402,150 +313,154 @@ void DcnBackwardDataExecutor::col2img4D(float *grad_col, float *input,
   int ho = (hi + pt + pb - dilation[0] * (kh - 1) - 1) / stride[0] + 1;
   int wo = (wi + pl + pr - dilation[1] * (kw - 1) - 1) / stride[1] + 1;
   int ci_per_deform_group = ci * conv_group / deform_group;
-
-  float *cur_top_grad = cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  float *mval = cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  float *bilinear_result =
-      cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  float *valh = cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  float *valw = cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  float *interp_weight_h =
-      cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  float *interp_weight_w =
-      cpu_runtime_.allocate(new float[ci_per_deform_group]);
-
-  for (int i_iter = 0; i_iter < n * ho * wo * kh * kw * deform_group;
-       i_iter++) {
-    int deform_iter = i_iter % deform_group;
-    int kw_iter = (i_iter / deform_group) % kw;
-    int kh_iter = (i_iter / deform_group / kw) % kh;
-    int wo_iter = (i_iter / deform_group / kw / kh) % wo;
-    int ho_iter = (i_iter / deform_group / kw / kh / wo) % ho;
-    int n_iter = (i_iter / deform_group / kw / kh / wo / ho) % n;
-
-    int offset_offset = n_iter * ho * wo * deform_group * kh * kw * 2 +
-                        ho_iter * wo * deform_group * kh * kw * 2 +
-                        wo_iter * deform_group * kh * kw * 2 +
-                        deform_iter * kh * kw * 2 + kh_iter * kw * 2 +
-                        kw_iter * 2;
-    float offset_h = offset[offset_offset + 0];
-    float offset_w = offset[offset_offset + 1];
-
-    float mask_value = 1.0;
-    if (mask != nullptr) {
-      int mask_offset = n_iter * ho * wo * deform_group * kh * kw +
-                        ho_iter * wo * deform_group * kh * kw +
-                        wo_iter * deform_group * kh * kw +
-                        deform_iter * kh * kw + kh_iter * kw + kw_iter;
-      mask_value = mask[mask_offset];
-    }
-
-    float h_im = ho_iter * stride[0] - pt + kh_iter * dilation[0] + offset_h;
-    float w_im = wo_iter * stride[1] - pl + kw_iter * dilation[1] + offset_w;
-
-    int col_offset =
-        n_iter * ho * wo * kh * kw * deform_group * ci_per_deform_group +
-        ho_iter * wo * kh * kw * deform_group * ci_per_deform_group +
-        wo_iter * kh * kw * deform_group * ci_per_deform_group +
-        kh_iter * kw * deform_group * ci_per_deform_group +
-        kw_iter * deform_group * ci_per_deform_group +
-        deform_iter * ci_per_deform_group;
-    for (int iter = 0; iter < ci_per_deform_group; iter++) {
-      cur_top_grad[iter] = grad_col[col_offset + iter];
-    }
-
-    int cur_h = int(h_im);
-    int cur_w = int(w_im);
-
-    // dcn backward data prospect
-    for (int dh_iter = -2; dh_iter < 3; dh_iter++) {
-      for (int dw_iter = -2; dw_iter < 3; dw_iter++) {
-        if (cur_h + dh_iter >= 0 && cur_h + dh_iter < hi &&
-            cur_w + dw_iter >= 0 && cur_w + dw_iter < wi &&
-            fabs(h_im - (cur_h + dh_iter)) < 1.0 &&
-            fabs(w_im - (cur_w + dw_iter)) < 1.0) {
-          float weight = 0.0;
-          if (h_im <= -1 || h_im >= hi || w_im <= -1 || w_im >= wi) {
-            continue;
-          } else {
-            int h_low = floor(h_im);
-            int w_low = floor(w_im);
-            int h_high = h_low + 1;
-            int w_high = w_low + 1;
-            int tmp_h = cur_h + dh_iter;
-            int tmp_w = cur_w + dw_iter;
-            if (tmp_h == h_low && tmp_w == w_low) {
-              weight = (tmp_h + 1.0 - h_im) * (tmp_w + 1.0 - w_im);
-            } else if (tmp_h == h_low && tmp_w == w_high) {
-              weight = (tmp_h + 1.0 - h_im) * (w_im + 1.0 - tmp_w);
-            } else if (tmp_h == h_high && tmp_w == w_low) {
-              weight = (h_im + 1.0 - tmp_h) * (tmp_w + 1.0 - w_im);
-            } else if (tmp_h == h_high && tmp_w == w_high) {
-              weight = (h_im + 1.0 - tmp_h) * (w_im + 1.0 - tmp_w);
+  if (row_end <= row_begin) {
+    return;
+  }
+  const int64_t n_begin = row_begin / ((int64_t)ho * wo);
+  const int64_t n_num = (row_end - 1) / ((int64_t)ho * wo) - n_begin + 1;
+
+  // a task is one image and one deformable group: it is the only writer of
+  // its grad_input slice and keeps the serial accumulation order.
+  auto col2img_task = [&](size_t, size_t task_begin, size_t task_end) {
+    std::vector<float> cur_top_grad(ci_per_deform_group);
+    std::vector<float> mval(ci_per_deform_group);
+    std::vector<float> bilinear_result(ci_per_deform_group);
+    std::vector<float> valh(ci_per_deform_group);
+    std::vector<float> valw(ci_per_deform_group);
+    std::vector<float> interp_weight_h(ci_per_deform_group);
+    std::vector<float> interp_weight_w(ci_per_deform_group);
+    for (size_t task = task_begin; task < task_end; ++task) {
+      const int n_iter = n_begin + task / deform_group;
+      const int deform_iter = task % deform_group;
+      const int64_t image_row = (int64_t)n_iter * ho * wo;
+      const int64_t rows_begin = std::max(row_begin, image_row);
+      const int64_t rows_end = std::min(row_end, image_row + ho * wo);
+      for (int64_t row = rows_begin; row < rows_end; ++row) {
+        const int ho_iter = row / wo % ho;
+        const int wo_iter = row % wo;
+        for (int kh_iter = 0; kh_iter < kh; kh_iter++) {
+          for (int kw_iter = 0; kw_iter < kw; kw_iter++) {
+            const int64_t mask_offset =
+                ((row * deform_group + deform_iter) * kh + kh_iter) * kw +
+                kw_iter;
+            const int64_t offset_offset = mask_offset * 2;
+            float offset_h = offset[offset_offset + 0];
+            float offset_w = offset[offset_offset + 1];
+
+            float mask_value = 1.0;
+            if (mask != nullptr) {
+              mask_value = mask[mask_offset];
             }
-          }
-          int grad_img_offset =
-              n_iter * hi * wi * deform_group * ci_per_deform_group +
-              (cur_h + dh_iter) * wi * deform_group * ci_per_deform_group +
-              (cur_w + dw_iter) * deform_group * ci_per_deform_group +
-              deform_iter * ci_per_deform_group;
-          for (int iter = 0; iter < ci_per_deform_group; iter++) {
-            grad_input[grad_img_offset + iter] +=
-                weight * cur_top_grad[iter] * mask_value;
-          }
-        }  // if cur h and cur w is valid
-      }    // dw iter
-    }      // dh iter
-    // dcn backward data end
-
-    // dcn backward mask
-
-    for (int iter = 0; iter < ci_per_deform_group; iter++) {
-      mval[iter] = 0.0;
-    }
 
-    if (h_im > -1 && h_im < hi && w_im > -1 && w_im < wi) {
-      for (int iter = 0; iter < ci_per_deform_group; iter++) {
-        im2col_bilinear(input, n_iter, h_im, w_im, deform_iter, hi, wi,
-                        deform_group, ci_per_deform_group, bilinear_result);
-        mval[iter] = cur_top_grad[iter] * bilinear_result[iter];
-      }
-    } else {
-      h_im = -2.0;
-      w_im = -2.0;
-    }
-    if (grad_mask != nullptr) {
-      int mask_offset = n_iter * ho * wo * deform_group * kh * kw +
-                        ho_iter * wo * deform_group * kh * kw +
-                        wo_iter * deform_group * kh * kw +
-                        deform_iter * kh * kw + kh_iter * kw + kw_iter;
-      float grad_mask_value = 0.0;
-      for (int iter = 0; iter < ci_per_deform_group; iter++) {
-        grad_mask_value += mval[iter];
-      }
-      grad_mask[mask_offset] = grad_mask_value;
-    }
-    // dcn backward mask end
+            float h_im =
+                ho_iter * stride[0] - pt + kh_iter * dilation[0] + offset_h;
+            float w_im =
+                wo_iter * stride[1] - pl + kw_iter * dilation[1] + offset_w;
+
+            const int64_t col_offset =
+                (((row - row_begin) * kh + kh_iter) * kw + kw_iter) *
+                    deform_group * ci_per_deform_group +
+                deform_iter * ci_per_deform_group;
+            for (int iter = 0; iter < ci_per_deform_group; iter++) {
+              cur_top_grad[iter] = grad_col[col_offset + iter];
+            }
 
-    // dcn backward offset
+            int cur_h = int(h_im);
+            int cur_w = int(w_im);
+
+            // dcn backward data prospect
+            for (int dh_iter = -2; dh_iter < 3; dh_iter++) {
+              for (int dw_iter = -2; dw_iter < 3; dw_iter++) {
+                if (cur_h + dh_iter >= 0 && cur_h + dh_iter < hi &&
+                    cur_w + dw_iter >= 0 && cur_w + dw_iter < wi &&
+                    fabs(h_im - (cur_h + dh_iter)) < 1.0 &&
+                    fabs(w_im - (cur_w + dw_iter)) < 1.0) {
+                  float weight = 0.0;
+                  if (h_im <= -1 || h_im >= hi || w_im <= -1 || w_im >= wi) {
+                    continue;
+                  } else {
+                    int h_low = floor(h_im);
+                    int w_low = floor(w_im);
+                    int h_high = h_low + 1;
+                    int w_high = w_low + 1;
+                    int tmp_h = cur_h + dh_iter;
+                    int tmp_w = cur_w + dw_iter;
+                    if (tmp_h == h_low && tmp_w == w_low) {
+                      weight = (tmp_h + 1.0 - h_im) * (tmp_w + 1.0 - w_im);
+                    } else if (tmp_h == h_low && tmp_w == w_high) {
+                      weight = (tmp_h + 1.0 - h_im) * (w_im + 1.0 - tmp_w);
+                    } else if (tmp_h == h_high && tmp_w == w_low) {
+                      weight = (h_im + 1.0 - tmp_h) * (tmp_w + 1.0 - w_im);
+                    } else if (tmp_h == h_high && tmp_w == w_high) {
+                      weight = (h_im + 1.0 - tmp_h) * (w_im + 1.0 - tmp_w);
+                    }
+                  }
+                  const int64_t grad_img_offset =
+                      (((int64_t)n_iter * hi + cur_h + dh_iter) * wi + cur_w +
+                       dw_iter) *
+                          deform_group * ci_per_deform_group +
+                      deform_iter * ci_per_deform_group;
+                  for (int iter = 0; iter < ci_per_deform_group; iter++) {
+                    grad_input[grad_img_offset + iter] +=
+                        weight * cur_top_grad[iter] * mask_value;
+                  }
+                }  // if cur h and cur w is valid
+              }    // dw iter
+            }      // dh iter
+            // dcn backward data end
+
+            // dcn backward mask
+
+            for (int iter = 0; iter < ci_per_deform_group; iter++) {
+              mval[iter] = 0.0;
+            }
 
-    col2img_coordinate(input, n_iter, h_im, w_im, deform_iter, hi, wi,
-                       deform_group, ci_per_deform_group, interp_weight_h,
-                       interp_weight_w);
-    for (int iter = 0; iter < ci_per_deform_group; iter++) {
-      valh[iter] = cur_top_grad[iter] * interp_weight_h[iter] * mask_value;
-      valw[iter] = cur_top_grad[iter] * interp_weight_w[iter] * mask_value;
-    }
-    float grad_offset_h = 0.0;
-    float grad_offset_w = 0.0;
-    for (int iter = 0; iter < ci_per_deform_group; iter++) {
-      grad_offset_h += valh[iter];
-      grad_offset_w += valw[iter];
-    }
+            if (h_im > -1 && h_im < hi && w_im > -1 && w_im < wi) {
+              im2col_bilinear(input, n_iter, h_im, w_im, deform_iter, hi, wi,
+                              deform_group, ci_per_deform_group,
+                              bilinear_result.data());
+              for (int iter = 0; iter < ci_per_deform_group; iter++) {
+                mval[iter] = cur_top_grad[iter] * bilinear_result[iter];
+              }
+            } else {
+              h_im = -2.0;
+              w_im = -2.0;
+            }
+            if (grad_mask != nullptr) {
+              float grad_mask_value = 0.0;
+              for (int iter = 0; iter < ci_per_deform_group; iter++) {
+                grad_mask_value += mval[iter];
+              }
+              grad_mask[mask_offset] = grad_mask_value;
+            }
+            // dcn backward mask end
+
+            // dcn backward offset
+
+            col2img_coordinate(input, n_iter, h_im, w_im, deform_iter, hi, wi,
+                               deform_group, ci_per_deform_group,
+                               interp_weight_h.data(), interp_weight_w.data());
+            for (int iter = 0; iter < ci_per_deform_group; iter++) {
+              valh[iter] =
+                  cur_top_grad[iter] * interp_weight_h[iter] * mask_value;
+              valw[iter] =
+                  cur_top_grad[iter] * interp_weight_w[iter] * mask_value;
+            }
+            float grad_offset_h = 0.0;
+            float grad_offset_w = 0.0;
+            for (int iter = 0; iter < ci_per_deform_group; iter++) {
+              grad_offset_h += valh[iter];
+              grad_offset_w += valw[iter];
+            }
 
-    grad_offset[offset_offset + 0] = grad_offset_h;
-    grad_offset[offset_offset + 1] = grad_offset_w;
-  }  // i iter
+            grad_offset[offset_offset + 0] = grad_offset_h;
+            grad_offset[offset_offset + 1] = grad_offset_w;
+          }  // kw iter
+        }    // kh iter
+      }      // row
+    }        // task
+  };
+  parallelForChunks(n_num * deform_group, 1, col2img_task);
 }
 
 void DcnBackwardDataExecutor::col2img_coordinate(
@@ -620,97 +535,63 @@ void DcnBackwardDataExecutor::im2col_bilinear(
   float hh = 1.0 - lh;
   float hw = 1.0 - lw;
 
-  float *v1 = cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  float *v2 = cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  float *v3 = cpu_runtime_.allocate(new float[ci_per_deform_group]);
-  float *v4 = cpu_runtime_.allocate(new float[ci_per_deform_group]);
   for (int iter = 0; iter < ci_per_deform_group; iter++) {
-    v1[iter] = 0.0;
-    v2[iter] = 0.0;
-    v3[iter] = 0.0;
-    v4[iter] = 0.0;
     bilinear_result[iter] = 0.0;
   }
 
   if (h_im > -1.0 && w_im > -1.0 && h_im < hi && w_im < wi) {
-    if (h_low >= 0 && w_low >= 0) {
-      int input_offset = n_iter * hi * wi * deform_group * ci_per_deform_group +
-                         h_low * wi * deform_group * ci_per_deform_group +
-                         w_low * deform_group * ci_per_deform_group +
-                         deform_iter * ci_per_deform_group;
-      for (int iter = 0; iter < ci_per_deform_group; iter++) {
-        v1[iter] = input[input_offset + iter];
-      }
-    }
-    if (h_low >= 0 && w_high <= wi - 1) {
-      int input_offset = n_iter * hi * wi * deform_group * ci_per_deform_group +
-                         h_low * wi * deform_group * ci_per_deform_group +
-                         w_high * deform_group * ci_per_deform_group +
-                         deform_iter * ci_per_deform_group;
-      for (int iter = 0; iter < ci_per_deform_group; iter++) {
-        v2[iter] = input[input_offset + iter];
-      }
-    }
-    if (h_high <= hi - 1 && w_low >= 0) {
-      int input_offset = n_iter * hi * wi * deform_group * ci_per_deform_group +
-                         h_high * wi * deform_group * ci_per_deform_group +
-                         w_low * deform_group * ci_per_deform_group +
-                         deform_iter * ci_per_deform_group;
-      for (int iter = 0; iter < ci_per_deform_group; iter++) {
-        v3[iter] = input[input_offset + iter];
-      }
-    }
-    if (h_high <= hi - 1 && w_high <= wi - 1) {
-      int input_offset = n_iter * hi * wi * deform_group * ci_per_deform_group +
-                         h_high * wi * deform_group * ci_per_deform_group +
-                         w_high * deform_group * ci_per_deform_group +
-                         deform_iter * ci_per_deform_group;
-      for (int iter = 0; iter < ci_per_deform_group; iter++) {
-        v4[iter] = input[input_offset + iter];
+    // corners outside the input contribute zeros, -1 marks them.
+    auto corner_offset = [&](int h, int w) -> int64_t {
+      if (h < 0 || h > hi - 1 || w < 0 || w > wi - 1) {
+        return -1;
       }
-    }
+      return (((int64_t)n_iter * hi + h) * wi + w) * deform_group *
+                 ci_per_deform_group +
+             deform_iter * ci_per_deform_group;
+    };
+    const int64_t offset1 = corner_offset(h_low, w_low);
+    const int64_t offset2 = corner_offset(h_low, w_high);
+    const int64_t offset3 = corner_offset(h_high, w_low);
+    const int64_t offset4 = corner_offset(h_high, w_high);
     float w1 = hh * hw;
     float w2 = hh * lw;
     float w3 = lh * hw;
     float w4 = lh * lw;
 
     for (int iter = 0; iter < ci_per_deform_group; iter++) {
-      bilinear_result[iter] =
-          w1 * v1[iter] + w2 * v2[iter] + w3 * v3[iter] + w4 * v4[iter];
+      float v1 = offset1 < 0 ? 0.0f : input[offset1 + iter];
+      float v2 = offset2 < 0 ? 0.0f : input[offset2 + iter];
+      float v3 = offset3 < 0 ? 0.0f : input[offset3 + iter];
+      float v4 = offset4 < 0 ? 0.0f : input[offset4 + iter];
+      bilinear_result[iter] = w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4;
     }
   }
-  cpu_runtime_.deallocate(v1);
-  cpu_runtime_.deallocate(v2);
-  cpu_runtime_.deallocate(v3);
-  cpu_runtime_.deallocate(v4);
 }
 
+// counted from the descriptors only, cpuCompute is skipped when the baseline
+// comes from the cache
 int64_t DcnBackwardDataExecutor::getTheoryOps() {
-  if (exe_config_->mlu_only) {
-    int n = mluOpGetTensordimN(input_desc_);
-    int di = dimNb_ == 5 ? mluOpGetTensordimD(input_desc_) : 1;
-    int hi = mluOpGetTensordimH(input_desc_);
-    int wi = mluOpGetTensordimW(input_desc_);
-
-    int d_o = dimNb_ == 5 ? mluOpGetTensordimD(grad_output_desc_) : 1;
-    int ho = mluOpGetTensordimH(grad_output_desc_);
-    int wo = mluOpGetTensordimW(grad_output_desc_);
+  int n = mluOpGetTensordimN(input_desc_);
+  int d_o = dimNb_ == 5 ? mluOpGetTensordimD(grad_output_desc_) : 1;
+  int ho = mluOpGetTensordimH(grad_output_desc_);
+  int wo = mluOpGetTensordimW(grad_output_desc_);
 
-    int kd = dimNb_ == 5 ? mluOpGetTensordimD(weight_desc_) : 1;
-    int kh = mluOpGetTensordimH(weight_desc_);
-    int kw = mluOpGetTensordimW(weight_desc_);
+  int kd = dimNb_ == 5 ? mluOpGetTensordimD(weight_desc_) : 1;
+  int kh = mluOpGetTensordimH(weight_desc_);
+  int kw = mluOpGetTensordimW(weight_desc_);
 
-    int ci = mluOpGetTensordimC(weight_desc_);
-    int co = mluOpGetTensordimN(weight_desc_) / conv_group_;
-    int c_per_deform_group = ci / deformable_group_;
+  int ci = mluOpGetTensordimC(weight_desc_);
+  int co = mluOpGetTensordimN(weight_desc_) / conv_group_;
+  int c_per_deform_group = ci / deformable_group_;
+  int coeff = getCoefficientOfLT2CT();
 
-    theory_ops_ = 0;
+  theory_ops_ = 0;
+  if (exe_config_->mlu_only) {
     // if conv group > 1, transpose grad output and the column data
     if (conv_group_ > 1) {
       theory_ops_ += parser_->getOutputDataCount(0);
       theory_ops_ += conv_group_ * n * d_o * ho * wo * kd * kh * kw * ci;
     }
-    int coeff = getCoefficientOfLT2CT();
     theory_ops_ +=
         2 * conv_group_ * n * d_o * ho * wo * kd * kh * kw * ci * co / coeff;
     // bilinear(16) + grad_mask(2) + grad_offset(8)
@@ -719,6 +600,30 @@ int64_t DcnBackwardDataExecutor::getTheoryOps() {
     // grad input (2 * grad bilinear loop (4))
     theory_ops_ +=
         n * ho * wo * kh * kw * deformable_group_ * c_per_deform_group * 4 * 2;
+  } else {
+    const int im2col_step = im2col_step_;
+    const int chunk_num = n / im2col_step;
+    for (int batch_iter = 0; batch_iter < chunk_num; batch_iter++) {
+      if (conv_group_ != 1) {
+        theory_ops_ += conv_group_ * im2col_step * d_o * ho * wo;
+      }
+      for (int group_iter = 0; group_iter < conv_group_; group_iter++) {
+        theory_ops_ += 2 * im2col_step * d_o * ho * wo * kd * kh * kw * ci *
+                       co / coeff;  // lt2ct
+      }
+      if (conv_group_ != 1) {
+        theory_ops_ +=
+            conv_group_ * im2col_step * d_o * ho * wo * kd * kh * kw * ci;
+      }
+      if (dimNb_ == 4) {
+        // bilinear(16) + grad_mask(2) + grad_offset(8)
+        theory_ops_ += im2col_step * ho * wo * kh * kw * deformable_group_ *
+                       c_per_deform_group * 28;
+        // grad input (2 * grad bilinear loop (4))
+        theory_ops_ += im2col_step * ho * wo * kh * kw * deformable_group_ *
+                       c_per_deform_group * 4 * 2;
+      }
+    }
   }
   VLOG(4) << "getTheoryOps: " << theory_ops_ << " ops";
   return theory_ops_;
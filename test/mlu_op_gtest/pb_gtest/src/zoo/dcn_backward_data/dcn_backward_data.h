@@ -24,6 +24,7 @@
 #ifndef TEST_MLUOP_GTEST_PBGTEST_SRC_ZOO_DCN_BACKWARD_DATA_DCN_BACKWARD_DATA_H_
 #define TEST_MLUOP_GTEST_PBGTEST_SRC_ZOO_DCN_BACKWARD_DATA_DCN_BACKWARD_DATA_H_
 #include <vector>
+#include "cpu_gemm.h"
 #include "executor.h"
 
 #define MAX_PAD_DIM 6
@@ -42,6 +43,7 @@ class DcnBackwardDataExecutor : public Executor {
   void workspaceFree();
   void cpuCompute();
   int64_t getTheoryOps() override;
+  int64_t cpuComputeVersion() override { return kCpuGemmVersion; }
 
  private:
   bool use_mask_;
@@ -71,19 +73,17 @@ class DcnBackwardDataExecutor : public Executor {
       mluOpTensorDescriptor_t grad_offset_desc, float *grad_offset,
       mluOpTensorDescriptor_t grad_mask_desc, float *grad_mask);
 
-  void transposeGradOutput(const float *output, const int group, const int ndhw,
-                           const int c, float *transpose_output);
   void transposeGradCol(const float *dcol, const int group, const int middle,
                         const int c, float *transpose_dcol);
 
   void batch_batmul(int batch, int m, int k, int n, float *mat1, float *mat2,
                     float *mat3);
 
-  void col2img4D(float *grad_col, float *input, float *offset, float *mask,
-                 float *grad_input, float *grad_offset, float *grad_mask, int n,
-                 int hi, int wi, int ci, int co, int kh, int kw, int pad[],
-                 int stride[], int dilation[], int deformable_group,
-                 int conv_group);
+  void col2img4D(const float *grad_col, int64_t row_begin, int64_t row_end,
+                 float *input, float *offset, float *mask, float *grad_input,
+                 float *grad_offset, float *grad_mask, int hi, int wi, int ci,
+                 int co, int kh, int kw, int pad[], int stride[],
+                 int dilation[], int deformable_group, int conv_group);
 
   void im2col_bilinear(float *input, int n_iter, float h_im, float w_im,
                        int deform_iter, int hi, int wi, int deform_group,
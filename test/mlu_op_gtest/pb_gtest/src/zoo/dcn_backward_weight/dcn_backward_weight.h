@@ -13,6 +13,7 @@
 #define TEST_MLUOP_GTEST_SRC_ZOO_DCN_BACKWARD_WEIGHT_DCN_BACKWARD_WEIGHT_H_
 
 #include <vector>
+#include "cpu_gemm.h"
 #include "executor.h"
 
 namespace mluoptest {
@@ -28,10 +29,9 @@ class DcnBackwardWeightExecutor : public Executor {
   void compute();
   void cpuCompute();
   int64_t getTheoryOps() override;
+  int64_t cpuComputeVersion() override { return kCpuGemmVersion; }
 
  private:
-  void transpose(float *input, float *output, const int dims[],
-                 const int dim_num, int permute[]);
   int getCoefficientOfLT2CT();
   void computeDCNBackwardWeightCPU(
       const int &dg, const int &g, const int &im2col_step,
@@ -42,8 +42,7 @@ class DcnBackwardWeightExecutor : public Executor {
       const void *cpu_grad_output,
       const mluOpTensorDescriptor_t grad_weight_desc, void *cpu_grad_weight,
       const mluOpTensorDescriptor_t grad_bias_desc, void *cpu_grad_bias,
-      float *buffer, int pad[], int stride[], int dilation[],
-      int64_t &theory_ops);
+      float *buffer, int pad[], int stride[], int dilation[]);
 
   mluOpDataType_t input_onchip_dtype;
   mluOpDataType_t grad_output_onchip_dtype;
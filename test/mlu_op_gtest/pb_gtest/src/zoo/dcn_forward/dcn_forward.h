@@ -13,6 +13,7 @@
 #define TEST_MLUOP_GTEST_SRC_ZOO_DCN_FORWARD_DCN_FORWARD_H_
 
 #include <vector>
+#include "cpu_gemm.h"
 #include "executor.h"
 
 namespace mluoptest {
@@ -28,11 +29,10 @@ class DcnForwardExecutor : public Executor {
   void compute();
   void cpuCompute();
   int64_t getTheoryOps() override;
+  int64_t cpuComputeVersion() override { return kCpuGemmVersion; }
 
  private:
   int getCoefficientOfLT2CT();
-  void transpose(float *input, float *output, const int dims[],
-                 const int dim_num, const int permute[]);
   void computeDCNForwardCPU(
       const int &dg, const int &g, const int &im2col_step,
       const mluOpTensorDescriptor_t input_desc, const void *cpu_input,
@@ -41,8 +41,7 @@ class DcnForwardExecutor : public Executor {
       const mluOpTensorDescriptor_t weight_desc, const void *cpu_weight,
       const mluOpTensorDescriptor_t bias_desc, const void *cpu_bias,
       const mluOpTensorDescriptor_t output_desc, const void *cpu_output,
-      float *buffer, int pad[], int stride[], int dilation[],
-      int64_t &theory_ops);
+      float *buffer, int pad[], int stride[], int dilation[]);
   mluOpDataType_t input_onchip_dtype;
   mluOpDataType_t weight_onchip_dtype;
 
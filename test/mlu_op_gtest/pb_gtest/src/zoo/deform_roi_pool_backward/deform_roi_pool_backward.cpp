@@ -28,6 +28,10 @@
 #include <fstream>
 #include <map>
 #include <bitset>
+#include <vector>
+
+#include "parallel_for.h"
+#include "roi_sampler.h"
 
 namespace mluoptest {
 
@@ -111,163 +115,180 @@ void DeformRoiPoolBackwardExecutor::compute() {
   interface_timer_.stop();
 }
 
-void bilinear_interpolate_gradient(const int height, const int width,
-                                   const int channels, float y, float x,
-                                   float &w1, float &w2, float &w3, float &w4,
-                                   int &x_low, int &x_high, int &y_low,
-                                   int &y_high, int64_t &theory_ops_) {
-  // deal with cases that inverse elements are out of feature map boundary
-  if (y < -1.0 || y > height || x < -1.0 || x > width) {
-    w1 = w2 = w3 = w4 = 0.;
-    x_low = x_high = y_low = y_high = -1;
-    return;
-  }
-
-  if (y <= 0) y = 0;
-  if (x <= 0) x = 0;
-
-  y_low = (int)y;
-  x_low = (int)x;
-  theory_ops_ += 2;  // cur block
-
-  if (y_low >= height - 1) {
-    y_high = y_low = height - 1;
-    y = (float)y_low;
-    theory_ops_ += 2;  // cur block
-  } else {
-    y_high = y_low + 1;
-    theory_ops_ += 1;  // cur block
-  }
-
-  if (x_low >= width - 1) {
-    x_high = x_low = width - 1;
-    x = (float)x_low;
-    theory_ops_ += 2;  // cur block
-  } else {
-    x_high = x_low + 1;
-    theory_ops_ += 1;  // cur block
-  }
-
-  float ly = y - y_low;
-  float lx = x - x_low;
-  float hy = 1. - ly, hx = 1. - lx;
-
-  w1 = hy * hx, w2 = hy * lx, w3 = ly * hx, w4 = ly * lx;
-  theory_ops_ += 8;  // cur block
-}
+namespace {
+// Sample grid of one RoI, the per-bin offset is added on top of the start.
+struct DeformRoiGrid {
+  int roi_batch_ind;
+  float roi_start_w, roi_start_h;
+  float roi_width, roi_height;
+  float bin_size_h, bin_size_w;
+  int roi_bin_grid_h, roi_bin_grid_w;
+  float count;
+};
+}  // namespace
 
 void DeformRoiPoolBackwardExecutor::cpuCompute() {
-  for (int n = 0; n < rois_num; ++n) {
+  const bool has_offset =
+      offset_desc != nullptr && cpu_fp32_input_[3] != nullptr;
+  auto roi_grid = [&](int n) {
     const float *offset_rois = cpu_fp32_input_[2] + n * 5;
-
-    const int roi_batch_ind = offset_rois[0];
-    float roi_start_w = offset_rois[1] * spatial_scale - 0.5;
-    float base_roi_start_w = roi_start_w;
-    float roi_start_h = offset_rois[2] * spatial_scale - 0.5;
-    float base_roi_start_h = roi_start_h;
+    DeformRoiGrid grid;
+    grid.roi_batch_ind = offset_rois[0];
+    grid.roi_start_w = offset_rois[1] * spatial_scale - 0.5;
+    grid.roi_start_h = offset_rois[2] * spatial_scale - 0.5;
     float roi_end_w = offset_rois[3] * spatial_scale - 0.5;
     float roi_end_h = offset_rois[4] * spatial_scale - 0.5;
-    float roi_width = roi_end_w - roi_start_w;
-    float roi_height = roi_end_h - roi_start_h;
+    grid.roi_width = roi_end_w - grid.roi_start_w;
+    grid.roi_height = roi_end_h - grid.roi_start_h;
 
-    float bin_size_h =
-        static_cast<float>(roi_height) / static_cast<float>(pooled_height);
-    float bin_size_w =
-        static_cast<float>(roi_width) / static_cast<float>(pooled_width);
-    int roi_bin_grid_h =
+    grid.bin_size_h = static_cast<float>(grid.roi_height) /
+                      static_cast<float>(pooled_height);
+    grid.bin_size_w =
+        static_cast<float>(grid.roi_width) / static_cast<float>(pooled_width);
+    grid.roi_bin_grid_h =
         (sampling_ratio > 0)
             ? sampling_ratio
-            : static_cast<int>(ceilf(roi_height / pooled_height));
-    int roi_bin_grid_w =
+            : static_cast<int>(ceilf(grid.roi_height / pooled_height));
+    grid.roi_bin_grid_w =
         (sampling_ratio > 0)
             ? sampling_ratio
-            : static_cast<int>(ceilf(roi_width / pooled_width));
-    const float count = std::max(roi_bin_grid_h * roi_bin_grid_w, 1);
-    theory_ops_ += 23.0;  // cur block
-
-    // no count theory_ops_ begin
-    const float *offset_input =
-        cpu_fp32_input_[1] + roi_batch_ind * height * width * channels;
-    float *offset_grad_input =
-        cpu_fp32_output_[0] + roi_batch_ind * height * width * channels;
-    // no count theory_ops_ end
+            : static_cast<int>(ceilf(grid.roi_width / pooled_width));
+    grid.count = std::max(grid.roi_bin_grid_h * grid.roi_bin_grid_w, 1);
+    return grid;
+  };
+  // start of bin (ph, pw) moved by its learned offset.
+  auto bin_start = [&](int n, int ph, int pw, const DeformRoiGrid &grid,
+                       float *roi_start_w, float *roi_start_h) {
+    *roi_start_w = grid.roi_start_w;
+    *roi_start_h = grid.roi_start_h;
+    if (has_offset) {
+      const float *offset_cur_w = cpu_fp32_input_[3] +
+                                  n * pooled_width * pooled_height * 2 +
+                                  ph * pooled_width + pw;
+      float offset_roi_w = gamma * grid.roi_width * offset_cur_w[0];
+      float offset_roi_h =
+          gamma * grid.roi_height * offset_cur_w[pooled_width * pooled_height];
+      *roi_start_w = grid.roi_start_w + offset_roi_w;
+      *roi_start_h = grid.roi_start_h + offset_roi_h;
+    }
+  };
 
-    for (int ph = 0; ph < pooled_height; ++ph) {
-      for (int pw = 0; pw < pooled_width; ++pw) {
-        if (offset_desc != nullptr && cpu_fp32_input_[3] != nullptr) {
-          // next stmt not count theory_ops_
-          const float *offset_cur_w = cpu_fp32_input_[3] +
-                                      n * pooled_width * pooled_height * 2 +
-                                      ph * pooled_width + pw;
-          float offset_roi_w = gamma * roi_width * offset_cur_w[0];
-          float offset_roi_h =
-              gamma * roi_height * offset_cur_w[pooled_width * pooled_height];
-          roi_start_w = base_roi_start_w + offset_roi_w;
-          roi_start_h = base_roi_start_h + offset_roi_h;
-          theory_ops_ += 6;  // cur block
-        }
-        for (int iy = 0; iy < roi_bin_grid_h; ++iy) {
-          const float y = roi_start_h + ph * bin_size_h +
-                          static_cast<float>(iy + .5f) * bin_size_h /
-                              static_cast<float>(roi_bin_grid_h);
-          theory_ops_ += 8;  // cur block
-          for (int ix = 0; ix < roi_bin_grid_w; ++ix) {
-            const float x = roi_start_w + pw * bin_size_w +
-                            static_cast<float>(ix + .5f) * bin_size_w /
-                                static_cast<float>(roi_bin_grid_w);
-            float w1, w2, w3, w4;
-            int x_low, x_high, y_low, y_high;
-            bilinear_interpolate_gradient(height, width, channels, y, x, w1, w2,
-                                          w3, w4, x_low, x_high, y_low, y_high,
-                                          theory_ops_);
-            theory_ops_ += 9;  // cur block
-            if (x_low >= 0 && x_high >= 0 && y_low >= 0 && y_high >= 0) {
+  // Pass 1, RoIs in parallel: grad_offset, which every RoI bin sums over
+  // its samples and channels, and the theory ops.
+  std::vector<int64_t> roi_ops(rois_num, 0);
+  auto offset_rois = [&](size_t, size_t begin, size_t end) {
+    BilinearTap tap;
+    for (size_t n = begin; n < end; ++n) {
+      int64_t &ops = roi_ops[n];
+      const DeformRoiGrid grid = roi_grid(n);
+      ops += 23.0;  // cur block
+      const float *offset_input =
+          cpu_fp32_input_[1] +
+          (int64_t)grid.roi_batch_ind * height * width * channels;
+      for (int ph = 0; ph < pooled_height; ++ph) {
+        for (int pw = 0; pw < pooled_width; ++pw) {
+          float roi_start_w, roi_start_h;
+          bin_start(n, ph, pw, grid, &roi_start_w, &roi_start_h);
+          if (has_offset) {
+            ops += 6;  // cur block
+          }
+          const float *grad_output = cpu_fp32_input_[0] +
+                                     ((n * pooled_height + ph) * pooled_width +
+                                      pw) * channels;
+          for (int iy = 0; iy < grid.roi_bin_grid_h; ++iy) {
+            const float y = roi_start_h + ph * grid.bin_size_h +
+                            static_cast<float>(iy + .5f) * grid.bin_size_h /
+                                static_cast<float>(grid.roi_bin_grid_h);
+            ops += 8;  // cur block
+            for (int ix = 0; ix < grid.roi_bin_grid_w; ++ix) {
+              const float x = roi_start_w + pw * grid.bin_size_w +
+                              static_cast<float>(ix + .5f) * grid.bin_size_w /
+                                  static_cast<float>(grid.roi_bin_grid_w);
+              // pixel offsets, so the corners can be read back
+              makeBilinearTap(height, width, y, x, 1, &tap, &ops);
+              ops += 9;  // cur block
+              if (tap.mask == 0) {
+                continue;
+              }
+              ops += 8 + 13 * channels;  // cur block
+              if (!has_offset) {
+                continue;
+              }
+              ops += 28 * channels;  // cur block
+              const int y_low = tap.offset[0] / width;
+              const int x_low = tap.offset[0] % width;
+              const int y_high = tap.offset[3] / width;
+              const int x_high = tap.offset[3] % width;
               for (int c = 0; c < channels; ++c) {
-                // next stmt not count theory_ops_
-                size_t index = n * pooled_height * pooled_width * channels +
-                               ph * pooled_width * channels + pw * channels + c;
-
-                float grad_output_this_bin = cpu_fp32_input_[0][index] / count;
-                offset_grad_input[y_low * width * channels + x_low * channels +
-                                  c] += grad_output_this_bin * w1;
-                offset_grad_input[y_low * width * channels + x_high * channels +
-                                  c] += grad_output_this_bin * w2;
-                offset_grad_input[y_high * width * channels + x_low * channels +
-                                  c] += grad_output_this_bin * w3;
-                offset_grad_input[y_high * width * channels +
-                                  x_high * channels + c] +=
-                    grad_output_this_bin * w4;
-                theory_ops_ += 13;  // cur block
-
-                if (offset_desc != NULL && cpu_fp32_input_[3] != NULL) {
-                  float input_00 = offset_input[y_low * width * channels +
-                                                x_low * channels + c];
-                  float input_10 = offset_input[y_low * width * channels +
-                                                x_high * channels + c];
-                  float input_01 = offset_input[y_high * width * channels +
-                                                x_low * channels + c];
-                  float input_11 = offset_input[y_high * width * channels +
-                                                x_high * channels + c];
-                  float ogx = gamma * roi_width * grad_output_this_bin *
-                          (input_11 * (y - y_low) + input_10 * (y_high - y) +
-                           input_01 * (y_low - y) + input_00 * (y - y_high));
-                  float ogy = gamma * roi_height * grad_output_this_bin *
-                          (input_11 * (x - x_low) + input_01 * (x_high - x) +
-                           input_10 * (x_low - x) + input_00 * (x - x_high));
-                  cpu_fp32_output_[1][n * pooled_width * pooled_height * 2 +
-                                      ph * pooled_width + pw] += ogx;
-                  cpu_fp32_output_[1][n * pooled_width * pooled_height * 2 +
-                                      pooled_width * pooled_height +
-                                      ph * pooled_width + pw] += ogy;
-                  theory_ops_ += 28;  // cur block
-                }
+                float grad_output_this_bin = grad_output[c] / grid.count;
+                float input_00 = offset_input[tap.offset[0] * channels + c];
+                float input_10 = offset_input[tap.offset[1] * channels + c];
+                float input_01 = offset_input[tap.offset[2] * channels + c];
+                float input_11 = offset_input[tap.offset[3] * channels + c];
+                float ogx = gamma * grid.roi_width * grad_output_this_bin *
+                            (input_11 * (y - y_low) + input_10 * (y_high - y) +
+                             input_01 * (y_low - y) + input_00 * (y - y_high));
+                float ogy = gamma * grid.roi_height * grad_output_this_bin *
+                            (input_11 * (x - x_low) + input_01 * (x_high - x) +
+                             input_10 * (x_low - x) + input_00 * (x - x_high));
+                cpu_fp32_output_[1][n * pooled_width * pooled_height * 2 +
+                                    ph * pooled_width + pw] += ogx;
+                cpu_fp32_output_[1][n * pooled_width * pooled_height * 2 +
+                                    pooled_width * pooled_height +
+                                    ph * pooled_width + pw] += ogy;
               }
             }
           }
         }
       }
     }
+  };
+  parallelForChunks(rois_num, 1, offset_rois);
+  for (int64_t ops : roi_ops) {
+    theory_ops_ += ops;
   }
+
+  // Pass 2: grad_input, scattered by slices, see roiScatterSlices.
+  auto scatter_slice = [&](int image, int c_begin, int c_end) {
+    BilinearTap tap;
+    std::vector<float> grad_output_this_bin(c_end - c_begin);
+    float *offset_grad_input = cpu_fp32_output_[0] +
+                               (int64_t)image * height * width * channels +
+                               c_begin;
+    for (int n = 0; n < rois_num; ++n) {
+      const DeformRoiGrid grid = roi_grid(n);
+      if (grid.roi_batch_ind != image) {
+        continue;
+      }
+      for (int ph = 0; ph < pooled_height; ++ph) {
+        for (int pw = 0; pw < pooled_width; ++pw) {
+          float roi_start_w, roi_start_h;
+          bin_start(n, ph, pw, grid, &roi_start_w, &roi_start_h);
+          const float *grad_output =
+              cpu_fp32_input_[0] +
+              ((n * pooled_height + ph) * pooled_width + pw) * channels +
+              c_begin;
+          for (int c = 0; c < c_end - c_begin; ++c) {
+            grad_output_this_bin[c] = grad_output[c] / grid.count;
+          }
+          for (int iy = 0; iy < grid.roi_bin_grid_h; ++iy) {
+            const float y = roi_start_h + ph * grid.bin_size_h +
+                            static_cast<float>(iy + .5f) * grid.bin_size_h /
+                                static_cast<float>(grid.roi_bin_grid_h);
+            for (int ix = 0; ix < grid.roi_bin_grid_w; ++ix) {
+              const float x = roi_start_w + pw * grid.bin_size_w +
+                              static_cast<float>(ix + .5f) * grid.bin_size_w /
+                                  static_cast<float>(grid.roi_bin_grid_w);
+              makeBilinearTap(height, width, y, x, channels, &tap);
+              bilinearScatter(tap, grad_output_this_bin.data(), 1.0f,
+                              c_end - c_begin, offset_grad_input);
+            }
+          }
+        }
+      }
+    }
+  };
+  roiScatterSlices(batchs, channels, scatter_slice);
 }
 
 int64_t DeformRoiPoolBackwardExecutor::getTheoryOps() {
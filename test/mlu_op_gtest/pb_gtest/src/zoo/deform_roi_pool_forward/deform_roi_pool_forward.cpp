@@ -25,6 +25,9 @@
 #include <algorithm>
 #include <string>
 
+#include "parallel_for.h"
+#include "roi_sampler.h"
+
 namespace mluoptest {
 
 void DeformRoiPoolForwardExecutor::printDataInfo() {
@@ -106,114 +109,80 @@ void DeformRoiPoolForwardExecutor::compute() {
   interface_timer_.stop();
 }
 
-// Modyfied from mmcv
-float bilinear_interpolate(const float *input, const int height,
-                           const int width, const int channels, float y,
-                           float x, int c,
-                           const int index /* index for debug only*/) {
-  // deal with cases that inverse elements are out of feature map boundary
-  if (y < -1.0 || y > height || x < -1.0 || x > width) return 0;
-
-  if (y <= 0) y = 0;
-  if (x <= 0) x = 0;
-
-  int y_low = (int)y;
-  int x_low = (int)x;
-  int y_high;
-  int x_high;
-
-  if (y_low >= height - 1) {
-    y_high = y_low = height - 1;
-    y = (float)y_low;
-  } else {
-    y_high = y_low + 1;
-  }
-
-  if (x_low >= width - 1) {
-    x_high = x_low = width - 1;
-    x = (float)x_low;
-  } else {
-    x_high = x_low + 1;
-  }
-
-  float ly = y - y_low;
-  float lx = x - x_low;
-  float hy = 1. - ly, hx = 1. - lx;
-
-  float v1 = input[y_low * width * channels + x_low * channels + c];
-  float v2 = input[y_low * width * channels + x_high * channels + c];
-  float v3 = input[y_high * width * channels + x_low * channels + c];
-  float v4 = input[y_high * width * channels + x_high * channels + c];
-  float w1 = hy * hx, w2 = hy * lx, w3 = ly * hx, w4 = ly * lx;
-  float val = (w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4);
-  return val;
-}
-
 void DeformRoiPoolForwardExecutor::cpuCompute() {
-  int output_size = parser_->getOutputDataCount(0);
-  for (int index = 0; index < output_size; index++) {
-    // (n, ph, pw, c) is an element in the pooled output
-    const int c = index % channels;
-    const int pw = (index / channels) % pooled_width;
-    const int ph = (index / channels / pooled_width) % pooled_height;
-    const int n = index / channels / pooled_width / pooled_height;
-    const float *offset_rois = cpu_fp32_input_[1] + n * 5;
-    const int roi_batch_ind = offset_rois[0];
-
-    // Do not using rounding; this implementation detail is critical
-    float roi_start_w = offset_rois[1] * spatial_scale - 0.5;
-    float roi_start_h = offset_rois[2] * spatial_scale - 0.5;
-    float roi_end_w = offset_rois[3] * spatial_scale - 0.5;
-    float roi_end_h = offset_rois[4] * spatial_scale - 0.5;
-
-    float roi_width = roi_end_w - roi_start_w;
-    float roi_height = roi_end_h - roi_start_h;
-    float bin_size_h =
-        static_cast<float>(roi_height) / static_cast<float>(pooled_height);
-    float bin_size_w =
-        static_cast<float>(roi_width) / static_cast<float>(pooled_width);
-    const float *offset_input =
-        cpu_fp32_input_[0] + roi_batch_ind * height * width * channels;
-
-    // We use roi_bin_grid to sample the grid and mimic integral
-    int roi_bin_grid_h =
-        (sampling_ratio > 0)
-            ? sampling_ratio
-            : static_cast<int>(ceilf(roi_height / pooled_height));
-    int roi_bin_grid_w =
-        (sampling_ratio > 0)
-            ? sampling_ratio
-            : static_cast<int>(ceilf(roi_width / pooled_width));
-
-    // Compute roi offset
-    if (offset_desc != NULL && cpu_fp32_input_[2] != NULL) {
-      const float *offset_cur_w = cpu_fp32_input_[2] +
-                                  n * pooled_width * pooled_height * 2 +
-                                  ph * pooled_width + pw;
-      float offset_roi_w = gamma * roi_width * offset_cur_w[0];
-      float offset_roi_h =
-          gamma * roi_height * offset_cur_w[pooled_width * pooled_height];
-      roi_start_w += offset_roi_w;
-      roi_start_h += offset_roi_h;
-    }
-    // We do average pooling inside a bin
-    const float count = std::max(roi_bin_grid_h * roi_bin_grid_w, 1);
-    float output_val = 0.;
-    for (int iy = 0; iy < roi_bin_grid_h; iy++) {
-      const float y = roi_start_h + ph * bin_size_h +
-                      static_cast<float>(iy + .5f) * bin_size_h /
-                          static_cast<float>(roi_bin_grid_h);
-      for (int ix = 0; ix < roi_bin_grid_w; ix++) {
-        const float x = roi_start_w + pw * bin_size_w +
-                        static_cast<float>(ix + .5f) * bin_size_w /
-                            static_cast<float>(roi_bin_grid_w);
-        float val = bilinear_interpolate(offset_input, height, width, channels,
-                                         y, x, c, index);
-        output_val += val;
+  // RoIs run in parallel, a sample is one tap applied to all channels.
+  auto pool_rois = [&](size_t, size_t begin, size_t end) {
+    BilinearTap tap;
+    for (size_t n = begin; n < end; ++n) {
+      const float *offset_rois = cpu_fp32_input_[1] + n * 5;
+      const int roi_batch_ind = offset_rois[0];
+      // Do not using rounding; this implementation detail is critical
+      const float base_roi_start_w = offset_rois[1] * spatial_scale - 0.5;
+      const float base_roi_start_h = offset_rois[2] * spatial_scale - 0.5;
+      float roi_end_w = offset_rois[3] * spatial_scale - 0.5;
+      float roi_end_h = offset_rois[4] * spatial_scale - 0.5;
+
+      float roi_width = roi_end_w - base_roi_start_w;
+      float roi_height = roi_end_h - base_roi_start_h;
+      float bin_size_h =
+          static_cast<float>(roi_height) / static_cast<float>(pooled_height);
+      float bin_size_w =
+          static_cast<float>(roi_width) / static_cast<float>(pooled_width);
+      const float *offset_input =
+          cpu_fp32_input_[0] +
+          (int64_t)roi_batch_ind * height * width * channels;
+
+      // We use roi_bin_grid to sample the grid and mimic integral
+      int roi_bin_grid_h =
+          (sampling_ratio > 0)
+              ? sampling_ratio
+              : static_cast<int>(ceilf(roi_height / pooled_height));
+      int roi_bin_grid_w =
+          (sampling_ratio > 0)
+              ? sampling_ratio
+              : static_cast<int>(ceilf(roi_width / pooled_width));
+
+      for (int ph = 0; ph < pooled_height; ++ph) {
+        for (int pw = 0; pw < pooled_width; ++pw) {
+          float roi_start_w = base_roi_start_w;
+          float roi_start_h = base_roi_start_h;
+          // Compute roi offset
+          if (offset_desc != NULL && cpu_fp32_input_[2] != NULL) {
+            const float *offset_cur_w = cpu_fp32_input_[2] +
+                                        n * pooled_width * pooled_height * 2 +
+                                        ph * pooled_width + pw;
+            float offset_roi_w = gamma * roi_width * offset_cur_w[0];
+            float offset_roi_h =
+                gamma * roi_height * offset_cur_w[pooled_width * pooled_height];
+            roi_start_w += offset_roi_w;
+            roi_start_h += offset_roi_h;
+          }
+          // We do average pooling inside a bin
+          const float count = std::max(roi_bin_grid_h * roi_bin_grid_w, 1);
+          float *output_val =
+              cpu_fp32_output_[0] +
+              ((n * pooled_height + ph) * pooled_width + pw) * channels;
+          std::fill(output_val, output_val + channels, 0.0f);
+          for (int iy = 0; iy < roi_bin_grid_h; iy++) {
+            const float y = roi_start_h + ph * bin_size_h +
+                            static_cast<float>(iy + .5f) * bin_size_h /
+                                static_cast<float>(roi_bin_grid_h);
+            for (int ix = 0; ix < roi_bin_grid_w; ix++) {
+              const float x = roi_start_w + pw * bin_size_w +
+                              static_cast<float>(ix + .5f) * bin_size_w /
+                                  static_cast<float>(roi_bin_grid_w);
+              makeBilinearTap(height, width, y, x, channels, &tap);
+              bilinearAccumulate(tap, offset_input, channels, output_val);
+            }
+          }
+          for (int c = 0; c < channels; ++c) {
+            output_val[c] = output_val[c] / count;
+          }
+        }
       }
     }
-    cpu_fp32_output_[0][index] = output_val / count;
-  }
+  };
+  parallelForChunks(rois_num, 1, pool_rois);
 }
 
 }  // namespace mluoptest
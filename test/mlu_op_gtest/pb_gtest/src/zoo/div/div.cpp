@@ -22,6 +22,8 @@
  *************************************************************************/
 #include "div.h"
 
+#include "parallel_for.h"
+
 namespace mluoptest {
 
 void DivExecutor::paramCheck() {
@@ -70,9 +72,12 @@ void DivExecutor::cpuCompute() {
                      std::vector<int>(c_desc->dims, c_desc->dims + c_desc->dim),
                      cpu_fp32_input_[1], b_broadcast);
 
-  for (size_t i = 0; i < count3; ++i) {
-    cpu_fp32_output_[0][i] = a_broadcast[i] / b_broadcast[i];
-  }
+  float *c = cpu_fp32_output_[0];
+  parallelForElements(count3, 3 * sizeof(float), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      c[i] = a_broadcast[i] / b_broadcast[i];
+    }
+  });
   VLOG(4) << "Div cpu compute done";
   cpu_runtime_.deallocate(a_broadcast);
   cpu_runtime_.deallocate(b_broadcast);
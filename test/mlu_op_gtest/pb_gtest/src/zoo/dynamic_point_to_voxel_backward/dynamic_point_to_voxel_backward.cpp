@@ -23,10 +23,16 @@
 
 #include "dynamic_point_to_voxel_backward.h"
 
-#include <algorithm>  // std::min
-#include <cstring>    // memset
+#include <cstring>  // memset
+
+#include "parallel_for.h"
+#include "voxel_segments.h"
 
 namespace mluoptest {
+
+// voxels per chunk of the parallel cpu scatter.
+constexpr size_t kDynamicPointToVoxelBackwardGrain = 256;
+
 void DynamicPointToVoxelBackwardExecutor::paramCheck() {
   VLOG(4) << "[DynamicPointToVoxelBackwardExecutor] Param check.";
   GTEST_CHECK(parser_->getInputNum() == 6,
@@ -125,45 +131,36 @@ void DynamicPointToVoxelBackwardExecutor::cpuCompute() {
   VLOG(5) << "C=" << C;
   VLOG(5) << "N=" << N;
 
-  memset(grad_feats, 0, N * C);
+  memset(grad_feats, 0, sizeof(float) * N * C);
   if (parser_->getInputDataCount(0) == 0 ||
       parser_->getInputDataCount(1) == 0 || M == 0) {
     return;
   }
-  std::vector<int32_t> voxel_from_vec(M * C, N);
-  int32_t* voxel_from = voxel_from_vec.data();
-
-  // kernel1
-  for (int32_t x = 0; x < N; x++) {
-    int32_t point_to = point2voxel_map[x];
-    const int input_offset = x * C;
-    const float* feats_offset = feats + input_offset;
-
-    if (point_to == -1) {
-      continue;
-    }
-
-    const int reduced_offset = point_to * C;
-    const float* reduced_feats_offset = voxel_feats + reduced_offset;
-    int32_t* reduce_from_offset = voxel_from + reduced_offset;
-
-    for (int32_t i = 0; i < C; i++) {
-      if (feats_offset[i] == reduced_feats_offset[i]) {
-        reduce_from_offset[i] = std::min(reduce_from_offset[i], x);
+  VoxelSegments segments;
+  segments.buildFromVoxelIds(point2voxel_map, N, M);
+  const int32_t* points = segments.points();
+
+  // The gradient of each voxel channel goes to the first point of the voxel
+  // holding the max. Points of a segment are in increasing index, so that is
+  // the first match; voxels are independent and run in parallel.
+  auto scatter_voxels = [&](size_t, size_t begin, size_t end) {
+    for (size_t x = begin; x < end; x++) {
+      const int reduced_offset = x * C;
+      const float* reduced_feats_offset = voxel_feats + reduced_offset;
+      const float* grad_reduced_feats_offset =
+          grad_voxel_feats + reduced_offset;
+      for (int32_t i = 0; i < C; i++) {
+        for (int64_t k = segments.begin(x); k < segments.end(x); ++k) {
+          const int32_t point = points[k];
+          if (feats[point * C + i] == reduced_feats_offset[i]) {
+            grad_feats[point * C + i] = grad_reduced_feats_offset[i];
+            break;
+          }
+        }
       }
     }
-  }
-
-  // kernel2
-  for (int32_t x = 0; x < M; x++) {
-    const int reduced_offset = x * C;
-    const int32_t* scatter_to_offset = voxel_from + reduced_offset;
-    const float* grad_reduced_feats_offset = grad_voxel_feats + reduced_offset;
-
-    for (int32_t i = 0; i < C; i++) {
-      grad_feats[scatter_to_offset[i] * C + i] = grad_reduced_feats_offset[i];
-    }
-  }
+  };
+  parallelForChunks(M, kDynamicPointToVoxelBackwardGrain, scatter_voxels);
 
   VLOG(4) << "[DynamicPointToVoxelBackwardExecutor] call cpuCompute() End.";
 }
@@ -23,9 +23,16 @@
 
 #include "dynamic_point_to_voxel_forward.h"
 
-#include <algorithm>
+#include <vector>
+
+#include "parallel_for.h"
+#include "voxel_segments.h"
 
 namespace mluoptest {
+
+// voxels per chunk of the parallel cpu reduction.
+constexpr size_t kDynamicPointToVoxelGrain = 256;
+
 void DynamicPointToVoxelForwardExecutor::paramCheck() {
   VLOG(4) << "[DynamicPointToVoxelForwardExecutor] Param check.";
   GTEST_CHECK(parser_->getInputNum() == 2,
@@ -140,116 +147,71 @@ void DynamicPointToVoxelForwardExecutor::cpuCompute() {
   }
 
   // step 1
-  // 1.1 Get index
-  std::vector<int> index(N);
-  std::generate(index.begin(), index.end(), [n = 0]() mutable { return n++; });
-
-  // 1.2 Sort by comparing coordinates
-  auto compareInput = [=](int32_t i, int32_t j) {
-    for (int32_t idx = 0; idx < num_coors; ++idx) {
-      const int32_t lhs = coors[idx + i * num_coors];
-      const int32_t rhs = coors[idx + j * num_coors];
-      if (lhs < rhs) {
-        return true;
-      } else if (lhs > rhs) {
-        return false;
-      }
-    }
-    return false;
-  };
-  std::sort(index.begin(), index.end(), compareInput);
-  std::vector<int> index_sorted = index;
-
-  // 1.3 Unique
-  auto diffInput = [=](int32_t i, int32_t j) {
-    for (int32_t idx = 0; idx < num_coors; ++idx) {
-      const int32_t lhs = coors[idx + i * num_coors];
-      const int32_t rhs = coors[idx + j * num_coors];
-      if (lhs != rhs) {
-        return false;
-      }
-    }
-    return true;
-  };
-  std::vector<int>::iterator it =
-      std::unique(index.begin(), index.end(), diffInput);
-  index.resize(std::distance(index.begin(), it));
+  // Group points of equal coordinates, in lexicographic order of coordinates.
+  VoxelSegments segments;
+  segments.buildFromCoors(coors, N, num_coors);
+  const int32_t *points = segments.points();
 
   // 2. Calculate voxel_num
-  const bool flag = coors[index[0] * num_coors] == -1;
-  voxel_num[0] = index.size() - static_cast<int32_t>(flag);
-  for (int32_t i = 0; i < voxel_num[0]; ++i) {
+  // rows of -1 sort first, their segment is dropped.
+  const bool flag = coors[points[0] * num_coors] == -1;
+  const int32_t num_voxels = segments.segmentNum() - static_cast<int32_t>(flag);
+  voxel_num[0] = num_voxels;
+  for (int32_t i = 0; i < num_voxels; ++i) {
+    const int32_t first = points[segments.begin(i + flag)];
     for (int32_t j = 0; j < num_coors; ++j) {
-      if (flag) {
-        voxel_coors[i * num_coors + j] = coors[index[i + 1] * num_coors + j];
-      } else {
-        voxel_coors[i * num_coors + j] = coors[index[i] * num_coors + j];
-      }
-    }
-  }
-
-  // 3. Calculate point2voxel_map
-  std::vector<int> mask(N, 0);
-  for (int32_t i = 1; i < N; ++i) {
-    if (!diffInput(index_sorted[i], index_sorted[i - 1])) {
-      mask[i] = 1;
+      voxel_coors[i * num_coors + j] = coors[first * num_coors + j];
     }
-    mask[i] += mask[i - 1];
   }
 
-  for (int32_t i = 0; i < N; ++i) {
-    point2voxel_map[index_sorted[i]] = mask[i] - static_cast<int32_t>(flag);
-  }
-
-  // 4. Calculate voxel_points_count
-  int32_t voxel_points_count_idx = 0;
-  for (int32_t i = 0; i < index_sorted.size();) {
-    int32_t count = 1;
-    for (int32_t j = i + 1; j < N; ++j) {
-      if (diffInput(index_sorted[i], index_sorted[j])) {
-        count++;
-      } else {
-        break;
-      }
+  // 3. Calculate point2voxel_map and voxel_points_count
+  for (int64_t s = 0; s < segments.segmentNum(); ++s) {
+    const int32_t voxel = s - static_cast<int32_t>(flag);
+    for (int64_t k = segments.begin(s); k < segments.end(s); ++k) {
+      point2voxel_map[points[k]] = voxel;
     }
-    i += count;
-
-    if (flag && i == count) {
-      continue;
+    if (voxel >= 0) {
+      voxel_points_count[voxel] = segments.segmentSize(s);
     }
-
-    voxel_points_count[voxel_points_count_idx] = count;
-    voxel_points_count_idx++;
   }
 
-  // 5. Calculate voxel_feats
+  // 4. Calculate voxel_feats
   const float fill_value = reduce_mode == REDUCE_MODE_MAX ? -1.17549e038 : 0x0;
   for (int32_t i = 0; i < voxel_feats_desc->dims[0] * num_features; ++i) {
     voxel_feats[i] = fill_value;
   }
 
-  for (int32_t i = 0; i < N; ++i) {
-    const int32_t point2voxel_idx = point2voxel_map[i];
-    if (point2voxel_idx == -1) {
-      continue;
-    }
-
-    const int32_t reduce_count = voxel_points_count[point2voxel_idx];
-    const float *feats_offset = feats + i * num_features;
-    float *voxel_feats_offset = voxel_feats + point2voxel_idx * num_features;
-    if (reduce_mode == REDUCE_MODE_MAX) {
-      for (int32_t j = 0; j < num_features; ++j) {
-        if (feats_offset[j] >= voxel_feats_offset[j]) {
-          voxel_feats_offset[j] = feats_offset[j];
-          theory_ops_++;
+  // voxels are reduced in parallel, the points of a voxel in index order.
+  std::vector<int64_t> chunk_ops(
+      (num_voxels + kDynamicPointToVoxelGrain - 1) / kDynamicPointToVoxelGrain);
+  auto reduce_voxels = [&](size_t chunk, size_t begin, size_t end) {
+    int64_t ops = 0;
+    for (size_t voxel = begin; voxel < end; ++voxel) {
+      const int64_t s = voxel + flag;
+      const int32_t reduce_count = segments.segmentSize(s);
+      float *voxel_feats_offset = voxel_feats + voxel * num_features;
+      for (int64_t k = segments.begin(s); k < segments.end(s); ++k) {
+        const float *feats_offset = feats + points[k] * num_features;
+        if (reduce_mode == REDUCE_MODE_MAX) {
+          for (int32_t j = 0; j < num_features; ++j) {
+            if (feats_offset[j] >= voxel_feats_offset[j]) {
+              voxel_feats_offset[j] = feats_offset[j];
+              ops++;
+            }
+          }
+        } else if (reduce_mode == REDUCE_MODE_MEAN) {
+          for (int32_t j = 0; j < num_features; ++j) {
+            voxel_feats_offset[j] += feats_offset[j] / reduce_count;
+            ops++;
+          }
         }
       }
-    } else if (reduce_mode == REDUCE_MODE_MEAN) {
-      for (int32_t j = 0; j < num_features; ++j) {
-        voxel_feats_offset[j] += feats_offset[j] / reduce_count;
-        theory_ops_++;
-      }
     }
+    chunk_ops[chunk] = ops;
+  };
+  parallelForChunks(num_voxels, kDynamicPointToVoxelGrain, reduce_voxels);
+  for (auto ops : chunk_ops) {
+    theory_ops_ += ops;
   }
   VLOG(4) << "[DynamicPointToVoxelForwardExecutor] call cpuCompute() End.";
 }
@@ -28,8 +28,16 @@
 #include <algorithm>
 #include <iostream>
 
+#include "host_math.h"
+#include "parallel_for.h"
+
 namespace mluoptest {
 
+namespace {
+// elements per block of the sigmoid, pow and log passes.
+constexpr size_t kFocalLossBlock = 256;
+}  // namespace
+
 void FocalLossSigmoidBackwardExecutor::paramCheck() {
   if (!parser_->getProtoNode()->has_focal_loss_sigmoid_backward_param()) {
     LOG(ERROR) << "Lose focal_loss_sigmoid_backward param.";
@@ -109,27 +117,48 @@ void FocalLossSigmoidBackwardExecutor::cpuCompute() {
   auto input_shape = input_tensor.shape();
   int N = input_shape.dims(0);
   int C = input_shape.dims(1);
-  for (int index = 0; index < count; ++index) {
-    int n = index / C;
-    int c = index % C;
-    int t = target_cpu[n];
-    float flag_p = (t == c);
-    float flag_n = (t != c);
-    // p = sigmoid(x) = 1. / 1. + expf(-x)
-    float p = 1.0 / (1.0 + exp(-input_cpu[index]));
-    // (1 - p)**gamma * (1 - p - gamma*p*log(p))
-    float temp_p =
-        pow(1.0 - p, gamma) * (1.0 - p - gamma * p * log(std::max(p, FLT_MIN)));
-    // p**gamma * (gamma * (1 - p) * log(1 - p) - p)
-    float temp_n =
-        pow(p, gamma) *
-        (gamma * (1.0 - p) * log(std::max((float)(1.0 - p), FLT_MIN)) - p);
-    grad_input_cpu[index] += -flag_p * alpha * temp_p;
-    grad_input_cpu[index] += -flag_n * (1.0 - alpha) * temp_n;
-    if (weight_cpu != NULL && t != C) {
-      grad_input_cpu[index] *= weight_cpu[t];
+  // one sigmoid, one pow and one log of host_math per element, the pow base
+  // and log argument depend on whether c is the target class.
+  parallelForElements(count, 3 * sizeof(float), [&](size_t begin,
+                                                    size_t end) {
+    float p[kFocalLossBlock], log_arg[kFocalLossBlock];
+    double pow_base[kFocalLossBlock];
+    for (size_t block = begin; block < end; block += kFocalLossBlock) {
+      const size_t len = std::min(kFocalLossBlock, end - block);
+      // p = sigmoid(x) = 1. / 1. + expf(-x)
+      hostSigmoid(input_cpu + block, p, len);
+      for (size_t j = 0; j < len; ++j) {
+        const int index = block + j;
+        const bool is_target = (int)target_cpu[index / C] == index % C;
+        pow_base[j] = is_target ? 1.0 - p[j] : p[j];
+        log_arg[j] =
+            is_target ? std::max(p[j], FLT_MIN)
+                      : std::max((float)(1.0 - p[j]), FLT_MIN);
+      }
+      hostPow(pow_base, gamma, pow_base, len);
+      hostLog(log_arg, log_arg, len);
+      for (size_t j = 0; j < len; ++j) {
+        const int index = block + j;
+        int n = index / C;
+        int c = index % C;
+        int t = target_cpu[n];
+        if (t == c) {
+          // (1 - p)**gamma * (1 - p - gamma*p*log(p))
+          float temp_p =
+              pow_base[j] * (1.0 - p[j] - gamma * p[j] * log_arg[j]);
+          grad_input_cpu[index] += -alpha * temp_p;
+        } else {
+          // p**gamma * (gamma * (1 - p) * log(1 - p) - p)
+          float temp_n =
+              pow_base[j] * (gamma * (1.0 - p[j]) * log_arg[j] - p[j]);
+          grad_input_cpu[index] += -(1.0 - alpha) * temp_n;
+        }
+        if (weight_cpu != NULL && t != C) {
+          grad_input_cpu[index] *= weight_cpu[t];
+        }
+      }
     }
-  }
+  });
 }
 
 int64_t FocalLossSigmoidBackwardExecutor::getTheoryOps() {
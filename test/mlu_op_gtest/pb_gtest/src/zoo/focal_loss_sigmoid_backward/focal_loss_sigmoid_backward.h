@@ -39,6 +39,8 @@ class FocalLossSigmoidBackwardExecutor : public Executor {
   void cpuCompute() override;
   void setMiscellaneousParam() override;
   int64_t getTheoryOps() override;
+  // 1: block-wise host_math kernels instead of libm
+  int64_t cpuComputeVersion() override { return 1; }
 };
 
 }  // namespace mluoptest
@@ -22,10 +22,22 @@
  *************************************************************************/
 #include "focal_loss_sigmoid_forward.h"
 
+#include <float.h>
+
+#include <algorithm>
+#include <cmath>
 #include <string>
 
+#include "host_math.h"
+#include "parallel_for.h"
+
 namespace mluoptest {
 
+namespace {
+// elements per block of the sigmoid, pow and log passes.
+constexpr size_t kFocalLossBlock = 256;
+}  // namespace
+
 mluOpComputationPreference_t
 FocalLossSigmoidForwardExecutor::getComputationPreference() {
   auto focal_proto_desc =
@@ -101,45 +113,45 @@ void FocalLossSigmoidForwardExecutor::compute() {
   interface_timer_.stop();
 }
 
+// The loss of an element is -alpha * (1 - p)^gamma * log(p) for the target
+// class and -(1 - alpha) * p^gamma * log(1 - p) otherwise, p = sigmoid(x).
+// Blocks gather the pow base and the log argument of every element, so each
+// element takes one sigmoid, one pow and one log of host_math.
 void FocalLossSigmoidForwardExecutor::focalLossSigmoidForwardCpuFast(
     const float *input, const size_t input_num, const float *target,
     const size_t target_num, const float *weight, const size_t weight_num,
     const float alpha, const float gamma, float *output) {
-  size_t N = target_num;
   size_t C = input_num / target_num;
 
-  if (weight_num == 0) {
-    for (int i = 0; i < input_num; ++i) {
-      int32_t row_num = i / C;
-      int32_t col_num = i % C;
-      int32_t t = target[row_num];
-
-      float p = float(1.) / float(float(1.) + expf(-input[i]));
-      float temp_p = powf(float(1.) - p, gamma) * logf(fmax(p, FLT_MIN));
-      float temp_n = powf(p, gamma) * logf(fmax(float(1.) - p, FLT_MIN));
-      if (t == col_num) {
-        output[i] = -alpha * temp_p;
-      } else {
-        output[i] = -(1 - alpha) * temp_n;
-      }
-    }
-
-  } else {
-    for (int i = 0; i < input_num; ++i) {
-      int32_t row_num = i / C;
-      int32_t col_num = i % C;
-      int32_t t = target[row_num];
-      float p = 1. / (1. + exp(-input[i]));
-      float temp_p = pow(1. - p, gamma) * log(fmax(p, FLT_MIN));
-      float temp_n = pow(p, gamma) * log(fmax(1. - p, FLT_MIN));
-      if (t == col_num) {
-        output[i] = -alpha * temp_p;
-      } else {
-        output[i] = -(1 - alpha) * temp_n;
-      }
-      output[i] *= weight[t];
-    }
-  }
+  parallelForElements(
+      input_num, 2 * sizeof(float), [&](size_t begin, size_t end) {
+        float p[kFocalLossBlock], base[kFocalLossBlock], arg[kFocalLossBlock];
+        for (size_t block = begin; block < end; block += kFocalLossBlock) {
+          const size_t len = std::min(kFocalLossBlock, end - block);
+          hostSigmoid(input + block, p, len);
+          for (size_t j = 0; j < len; ++j) {
+            const size_t i = block + j;
+            const bool is_target = (int32_t)target[i / C] == (int32_t)(i % C);
+            base[j] = is_target ? float(1.) - p[j] : p[j];
+            arg[j] = fmax(is_target ? p[j] : float(1.) - p[j], FLT_MIN);
+          }
+          hostPow(base, gamma, base, len);
+          hostLog(arg, arg, len);
+          for (size_t j = 0; j < len; ++j) {
+            const size_t i = block + j;
+            const int32_t t = target[i / C];
+            const float temp = base[j] * arg[j];
+            if (t == (int32_t)(i % C)) {
+              output[i] = -alpha * temp;
+            } else {
+              output[i] = -(1 - alpha) * temp;
+            }
+            if (weight_num != 0) {
+              output[i] *= weight[t];
+            }
+          }
+        }
+      });
 }
 
 void FocalLossSigmoidForwardExecutor::
@@ -147,50 +159,44 @@ void FocalLossSigmoidForwardExecutor::
         const float *input, const size_t input_num, const float *target,
         const size_t target_num, const float *weight, const size_t weight_num,
         const float alpha, const float gamma, float *output) {
-  double focal_loss_temp = 0.0;
-  size_t N = target_num;
   size_t C = input_num / target_num;
   double alpha_double = double(alpha);
   double gamma_double = double(gamma);
 
-  if (weight_num == 0) {
-    for (int i = 0; i < input_num; ++i) {
-      int32_t row_num = i / C;
-      int32_t col_num = i % C;
-      int32_t t = target[row_num];
-      double x = double(input[i]);
-      double p = 1. / (1. + exp(-x));
-      double temp_p = pow(1. - p, gamma_double) * log(fmax(p, DBL_MIN));
-      double temp_n = pow(p, gamma_double) * log(fmax(1. - p, DBL_MIN));
-      if (t == col_num) {
-        focal_loss_temp = -alpha_double * temp_p;
-      } else {
-        focal_loss_temp = -(1 - alpha_double) * temp_n;
-      }
-      output[i] = float(focal_loss_temp);
-    }
-
-  } else {
-    for (int i = 0; i < input_num; ++i) {
-      int32_t row_num = i / C;
-      int32_t col_num = i % C;
-      int32_t t = target[row_num];
-      double x = double(input[i]);
-      double p = 1. / (1. + exp(-x));
-      double temp_p = pow(1. - p, gamma_double) * log(fmax(p, DBL_MIN));
-      double temp_n = pow(p, gamma_double) * log(fmax(1. - p, DBL_MIN));
-      if (t == col_num) {
-        focal_loss_temp = -alpha_double * temp_p;
-      } else {
-        focal_loss_temp = -(1 - alpha_double) * temp_n;
-      }
-      output[i] = float(focal_loss_temp);
-      output[i] *= weight[t];
-
-      double pow_temp = pow(1. - p, gamma);
-      double log_temp = log(fmax(p, DBL_MIN));
-    }
-  }
+  parallelForElements(
+      input_num, 2 * sizeof(float), [&](size_t begin, size_t end) {
+        double p[kFocalLossBlock], base[kFocalLossBlock], arg[kFocalLossBlock];
+        for (size_t block = begin; block < end; block += kFocalLossBlock) {
+          const size_t len = std::min(kFocalLossBlock, end - block);
+          for (size_t j = 0; j < len; ++j) {
+            p[j] = double(input[block + j]);
+          }
+          hostSigmoid(p, p, len);
+          for (size_t j = 0; j < len; ++j) {
+            const size_t i = block + j;
+            const bool is_target = (int32_t)target[i / C] == (int32_t)(i % C);
+            base[j] = is_target ? 1. - p[j] : p[j];
+            arg[j] = fmax(is_target ? p[j] : 1. - p[j], DBL_MIN);
+          }
+          hostPow(base, gamma_double, base, len);
+          hostLog(arg, arg, len);
+          for (size_t j = 0; j < len; ++j) {
+            const size_t i = block + j;
+            const int32_t t = target[i / C];
+            const double temp = base[j] * arg[j];
+            double focal_loss_temp = 0.0;
+            if (t == (int32_t)(i % C)) {
+              focal_loss_temp = -alpha_double * temp;
+            } else {
+              focal_loss_temp = -(1 - alpha_double) * temp;
+            }
+            output[i] = float(focal_loss_temp);
+            if (weight_num != 0) {
+              output[i] *= weight[t];
+            }
+          }
+        }
+      });
 }
 
 void FocalLossSigmoidForwardExecutor::cpuCompute() {
@@ -42,6 +42,8 @@ class FocalLossSigmoidForwardExecutor : public Executor {
   void compute() override;
   void cpuCompute() override;
   int64_t getTheoryOps() override;
+  // 1: block-wise host_math kernels instead of libm
+  int64_t cpuComputeVersion() override { return 1; }
   std::set<Evaluator::Formula> getCriterionsUse() const override;
 
  private:
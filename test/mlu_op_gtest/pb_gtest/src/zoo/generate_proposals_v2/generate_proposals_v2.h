@@ -39,6 +39,8 @@ class GenerateProposalsV2Executor : public Executor {
   void workspaceMalloc() override;
   void workspaceFree() override;
   int64_t getTheoryOps() override;
+  // 1: NaN scores rank last in the top-k selection
+  int64_t cpuComputeVersion() override { return 1; }
 };
 
 }  // namespace mluoptest
@@ -26,7 +26,14 @@
 #include <float.h>
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "box_iou.h"
+#include "parallel_for.h"
 
 using namespace std;  // NOLINT
 
@@ -34,38 +41,6 @@ namespace GenerateProposalsV2 {
 
 #define FLOAT_MIN (-(float)FLT_MAX)
 
-template <typename T>
-void quickSort(T *arr, int low, int high) {
-  if (high <= low) return;
-  int i = low;
-  int j = high;
-  T key = arr[low];
-  while (true) {
-    while (arr[i] <= key) {
-      i++;
-      if (i == high) {
-        break;
-      }
-    }
-    while (arr[j] >= key) {
-      j--;
-      if (j == low) {
-        break;
-      }
-    }
-
-    if (i >= j) break;
-    T temp = arr[i];
-    arr[i] = arr[j];
-    arr[j] = temp;
-  }
-
-  arr[low] = arr[j];
-  arr[j] = key;
-  quickSort(arr, low, j - 1);
-  quickSort(arr, j + 1, high);
-}
-int g_count = 0;
 template <typename T>
 bool isRealBox(const T xmin, const T ymin, const T xmax, const T ymax,
                const T im_h, const T im_w, bool pixel_offset, const T min_size,
@@ -169,143 +144,110 @@ void creatAndFilterProposalsBox(T *anchors_slice, T *bbox_deltas_slice,
   }
 }
 
-template <typename T>
-void findMaxScore(T *h_scores_buf, int size, T *max_score, int *max_score_id) {
-  if (size == 0) {
-    return;
-  }
-  T max_score_local = h_scores_buf[0];
-  int max_score_id_local = 0;
-  for (int i = 1; i < size; ++i) {
-    if (h_scores_buf[i] > max_score_local) {
-      max_score_local = h_scores_buf[i];
-      max_score_id_local = i;
-    }
+namespace {
+
+// Indices of the k largest scores, by descending score and ascending index
+// on ties, which is the order of taking the first arg max k times. NaN
+// ranks last.
+std::vector<int> topKScores(const float *scores, int n, int k) {
+  std::vector<int> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  auto key = [&](int i) {
+    return std::isnan(scores[i]) ? -std::numeric_limits<float>::infinity()
+                                 : scores[i];
+  };
+  auto before = [&](int a, int b) {
+    const float key_a = key(a), key_b = key(b);
+    return key_a > key_b || (key_a == key_b && a < b);
+  };
+  if (k < n) {
+    std::nth_element(order.begin(), order.begin() + k, order.end(), before);
+    order.resize(k);
   }
-  *max_score = max_score_local;
-  *max_score_id = max_score_id_local;
-  return;
-}
-
-template <typename T>
-T calcIoU(T *a, T *b, bool pixel_offset) {
-  float offset = pixel_offset ? static_cast<float>(1.0) : 0;
-  float left = max(a[0], b[0]), right = min(a[2], b[2]);
-  float top = max(a[1], b[1]), bottom = min(a[3], b[3]);
-  float width = max(right - left + offset, 0.f),
-        height = max(bottom - top + offset, 0.f);
-  float inter_s = width * height;
-  float s_a = (a[2] - a[0] + offset) * (a[3] - a[1] + offset);
-  float s_b = (b[2] - b[0] + offset) * (b[3] - b[1] + offset);
-  return inter_s / (s_a + s_b - inter_s);
+  std::sort(order.begin(), order.end(), before);
+  return order;
 }
 
-bool equal(float a, float b) { return abs(a - b) < 0.001; }
-
-template <typename T>
-void ProposalForOneImage(T *scores_slice, T *bbox_deltas_slice,
-                         T *im_shape_slice, T *anchors_slice,
-                         T *variances_slice, int H, int W, int A, T *rpn_rois,
-                         T *rpn_roi_probs, int *one_image_proposal_num,
-                         const int rpn_rois_batch_num, const int pre_nms_top_n,
-                         const int post_nms_top_n, const T nms_thresh,
-                         const T min_size, const bool pixel_offset) {
+// Output of one image, copied to rpn_rois and rpn_roi_probs after all images
+// are done.
+struct ImageProposals {
+  std::vector<float> rois;
+  std::vector<float> probs;
+};
+
+void ProposalForOneImage(float *scores_slice, float *bbox_deltas_slice,
+                         float *im_shape_slice, float *anchors_slice,
+                         float *variances_slice, int H, int W, int A,
+                         const int pre_nms_top_n, const int post_nms_top_n,
+                         const float nms_thresh, const float min_size,
+                         const bool pixel_offset, ImageProposals *out) {
   const int HWA = A * H * W;
   int proposals_num = 0;
 
   int pre_nms_num =
       (pre_nms_top_n <= 0 || pre_nms_top_n > HWA) ? HWA : pre_nms_top_n;
-  int post_nms_num = post_nms_top_n;
-  if (post_nms_num > pre_nms_num) {
-    post_nms_num = pre_nms_num;
-  }
 
-  T k_score = 0.0f;
-  T *out_scores_buf = new T[pre_nms_num];
-  T *out_box_buf = new T[pre_nms_num * 4];
-  T *out_area_buf = new T[pre_nms_num];
-  T *temp_scores = new T[HWA];
-  memcpy(temp_scores, scores_slice, HWA * sizeof(T));
+  std::vector<float> score(pre_nms_num);
+  std::vector<float> boxes(pre_nms_num * 4);
+  std::vector<float> area(pre_nms_num);
   // top k, creatbox, filter box
-  for (int top_id = 0; top_id < pre_nms_num; ++top_id) {
-    int max_score_id = top_id;
-    T max_score = scores_slice[max_score_id];
-
-    findMaxScore(temp_scores, HWA, &max_score, &max_score_id);
-    temp_scores[max_score_id] = FLOAT_MIN;
-
-    creatAndFilterProposalsBox<T>(
+  for (int max_score_id : topKScores(scores_slice, HWA, pre_nms_num)) {
+    creatAndFilterProposalsBox<float>(
         anchors_slice, bbox_deltas_slice, im_shape_slice, variances_slice,
-        out_scores_buf, out_box_buf, out_area_buf, A, H, W, min_size, max_score,
-        max_score_id, pixel_offset, &proposals_num);
+        score.data(), boxes.data(), area.data(), A, H, W, min_size,
+        scores_slice[max_score_id], max_score_id, pixel_offset,
+        &proposals_num);
   }
 
   if (proposals_num == 0) {
-    *one_image_proposal_num = 1;
-    rpn_rois[rpn_rois_batch_num * 4 + 0] = 0;
-    rpn_rois[rpn_rois_batch_num * 4 + 1] = 0;
-    rpn_rois[rpn_rois_batch_num * 4 + 2] = 0;
-    rpn_rois[rpn_rois_batch_num * 4 + 3] = 0;
-    rpn_roi_probs[rpn_rois_batch_num] = 0;
+    out->rois.assign(4, 0.0f);
+    out->probs.assign(1, 0.0f);
     return;
   }
 
-  float offset = pixel_offset ? 1 : 0;
-  int real_proposal_num = 0;
-  int nms_num = std::min(proposals_num, post_nms_top_n);
-
-  for (int nms_id = 0; nms_id < nms_num; ++nms_id) {
-    // Find max score
-    float max_score = 0.0f;
-    int max_score_id = 0;
-    findMaxScore(out_scores_buf, proposals_num, &max_score, &max_score_id);
-    out_scores_buf[max_score_id] = FLOAT_MIN;
-
-    if (max_score <= FLOAT_MIN) {
+  // The proposals are sorted by score already. Each round keeps the first
+  // alive one and compacts the boxes it does not suppress behind it.
+  std::vector<float> x1(proposals_num), y1(proposals_num);
+  std::vector<float> x2(proposals_num), y2(proposals_num);
+  std::vector<float> iou(proposals_num);
+  for (int i = 0; i < proposals_num; ++i) {
+    x1[i] = boxes[i * 4 + 0];
+    y1[i] = boxes[i * 4 + 1];
+    x2[i] = boxes[i * 4 + 2];
+    y2[i] = boxes[i * 4 + 3];
+  }
+  const mluoptest::BoxIouSoA soa = {x1.data(), y1.data(), x2.data(),
+                                    y2.data(), area.data()};
+  const float offset = pixel_offset ? 1 : 0;
+  const int nms_num = std::min(proposals_num, post_nms_top_n);
+  int alive_num = proposals_num;
+  for (int head = 0; head < nms_num && head < alive_num; ++head) {
+    if (score[head] <= FLOAT_MIN) {
       break;
     }
-    // Compute max area
-    float max_score_x0 = out_box_buf[max_score_id * 4 + 0];
-    float max_score_y0 = out_box_buf[max_score_id * 4 + 1];
-    float max_score_x1 = out_box_buf[max_score_id * 4 + 2];
-    float max_score_y1 = out_box_buf[max_score_id * 4 + 3];
-    // save max score and box to output
-    rpn_rois[(rpn_rois_batch_num + real_proposal_num) * 4 + 0] = max_score_x0;
-    rpn_rois[(rpn_rois_batch_num + real_proposal_num) * 4 + 1] = max_score_y0;
-    rpn_rois[(rpn_rois_batch_num + real_proposal_num) * 4 + 2] = max_score_x1;
-    rpn_rois[(rpn_rois_batch_num + real_proposal_num) * 4 + 3] = max_score_y1;
-
-    rpn_roi_probs[rpn_rois_batch_num + real_proposal_num] = max_score;
-    real_proposal_num++;
-
-    float max_score_area = out_area_buf[max_score_id];
-
-    for (int inner_id = 0; inner_id < proposals_num; ++inner_id) {
-      if (inner_id == max_score_id) {
+    out->rois.insert(out->rois.end(), {x1[head], y1[head], x2[head], y2[head]});
+    out->probs.push_back(score[head]);
+    mluoptest::boxIouRange(soa, head, area[head], true, offset, head + 1,
+                           alive_num, iou.data());
+    int next_num = head + 1;
+    for (int j = head + 1; j < alive_num; ++j) {
+      if (iou[j] > nms_thresh) {
         continue;
       }
-
-      float *a = out_box_buf + max_score_id * 4;
-      float *b = out_box_buf + inner_id * 4;
-      float iou = calcIoU(a, b, pixel_offset);
-      if (iou > nms_thresh) {
-        out_scores_buf[inner_id] = FLOAT_MIN;
-      }
+      x1[next_num] = x1[j];
+      y1[next_num] = y1[j];
+      x2[next_num] = x2[j];
+      y2[next_num] = y2[j];
+      area[next_num] = area[j];
+      score[next_num] = score[j];
+      next_num++;
     }
+    alive_num = next_num;
   }
-  *one_image_proposal_num = real_proposal_num;
-
-  delete[] out_scores_buf;
-  delete[] out_box_buf;
-  delete[] out_area_buf;
-  delete[] temp_scores;
-
-  out_scores_buf = nullptr;
-  out_box_buf = nullptr;
-  out_area_buf = nullptr;
-  temp_scores = nullptr;
 }
 
+}  // namespace
+
 void generateProposalsV2CPUImpl(
     float *scores, float *bbox_deltas, float *im_shape, float *anchors,
     float *variances, const int pre_nms_top_n, const int post_nms_top_n,
@@ -313,26 +255,31 @@ void generateProposalsV2CPUImpl(
     bool pixel_offset, const int N, const int H, const int W, const int A,
     float *rpn_rois, float *rpn_roi_probs, float *rpn_rois_num,
     float *rpn_rois_batch_size) {
-  const int HWA = A * H * W;
-  int rpn_rois_batch_num = 0;
+  const int64_t HWA = A * H * W;
+  // images are independent, only their output offsets depend on each other.
+  std::vector<ImageProposals> images(N);
+  mluoptest::parallelForChunks(
+      N, 1, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          float *scores_slice = scores + i * HWA;
+          float *bbox_deltas_slice = bbox_deltas + i * HWA * 4;
+          float *im_shape_slice = im_shape + 2 * i;
+          float *anchors_slice = anchors;      // [H, W, A, 4]
+          float *variances_slice = variances;  // [H, W, A, 4]
+          ProposalForOneImage(scores_slice, bbox_deltas_slice, im_shape_slice,
+                              anchors_slice, variances_slice, H, W, A,
+                              pre_nms_top_n, post_nms_top_n, nms_thresh,
+                              min_size, pixel_offset, &images[i]);
+        }
+      });
 
+  int rpn_rois_batch_num = 0;
   for (int i = 0; i < N; ++i) {
-    float *scores_slice = scores + i * HWA;
-    float *bbox_deltas_slice = bbox_deltas + i * HWA * 4;
-    float *im_shape_slice = im_shape + 2 * i;
-    float *anchors_slice = anchors;      // [H, W, A, 4]
-    float *variances_slice = variances;  // [H, W, A, 4]
-    float *rpn_rois_slice = rpn_rois + rpn_rois_batch_num * 4;
-    float *rpn_roi_probs_slice = rpn_roi_probs + rpn_rois_batch_num * 1;
-    float *rpn_rois_num_slice = rpn_rois_num + rpn_rois_batch_num * 1;
-
-    int one_image_proposal_num = 0;
-    ProposalForOneImage<float>(
-        scores_slice, bbox_deltas_slice, im_shape_slice, anchors_slice,
-        variances_slice, H, W, A, rpn_rois, rpn_roi_probs,
-        &one_image_proposal_num, rpn_rois_batch_num, pre_nms_top_n,
-        post_nms_top_n, nms_thresh, min_size, pixel_offset);
-
+    const int one_image_proposal_num = images[i].probs.size();
+    std::copy(images[i].rois.begin(), images[i].rois.end(),
+              rpn_rois + rpn_rois_batch_num * 4);
+    std::copy(images[i].probs.begin(), images[i].probs.end(),
+              rpn_roi_probs + rpn_rois_batch_num);
     rpn_rois_batch_num += one_image_proposal_num;
     rpn_rois_num[i] = one_image_proposal_num;
   }
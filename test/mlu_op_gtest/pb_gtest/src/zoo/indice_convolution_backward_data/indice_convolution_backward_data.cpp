@@ -22,8 +22,10 @@
  *************************************************************************/
 #include "indice_convolution_backward_data.h"
 
+#include <algorithm>
 #include <vector>
 
+#include "cpu_gemm.h"
 #include "test/mlu_op_gtest/include/tools.h"
 
 namespace mluoptest {
@@ -297,27 +299,57 @@ void IndiceConvolutionBackwardDataExecutor::cpuCompute() {
     input_grad[i] = 0;
   }
   // main loop: filter_transpose K in [K, dxc, dyc]
-  for (int kk = 0; kk < K; ++kk) {
-    int filter_offset = kk * dxc * dyc;
-    int index_num = (int)(indice_num_[kk]);
-    GTEST_CHECK(L >= index_num);
-    for (int l = 0; l < index_num; ++l) {  // index_pair data loop
-      int input_idx = indice_pairs[kk * 2 * L + l];
-      int output_idx = indice_pairs[kk * 2 * L + L + l];
-      float *sub_filter = filter_transpose_cpu + filter_offset;
-      float *input_slice = input_grad + input_idx * dxc;
-      float *output_slice = output_grad + output_idx * dyc;
-      for (int dxc_i = 0; dxc_i < dxc; ++dxc_i) {
-        float *input_grad_result = input_slice + dxc_i;
-        float input_grad_accumulate = 0;
-        for (int dyc_i = 0; dyc_i < dyc; ++dyc_i) {
-          float input_grad_tmp = 0;
-          float output_grad_tmp = output_slice[dyc_i];
-          float filter_tmp = sub_filter[dxc_i * dyc + dyc_i];
-          if (is_float) {
-            input_grad_tmp = output_grad_tmp * filter_tmp;
-            input_grad_accumulate += input_grad_tmp;
-          } else {
+  if (is_float) {
+    // gather output_grad rows of kernel offset kk, multiply by the transpose
+    // of its [dxc, dyc] filter and scatter-add to input_grad rows.
+    int max_index_num = 0;
+    for (int kk = 0; kk < K; ++kk) {
+      max_index_num = std::max(max_index_num, (int)(indice_num_[kk]));
+    }
+    float *gather_output_grad = (float *)cpu_runtime_.allocate(
+        (size_t)max_index_num * dyc * sizeof(float));
+    float *gather_input_grad = (float *)cpu_runtime_.allocate(
+        (size_t)max_index_num * dxc * sizeof(float));
+    for (int kk = 0; kk < K; ++kk) {
+      int index_num = (int)(indice_num_[kk]);
+      GTEST_CHECK(L >= index_num);
+      if (index_num == 0) continue;
+      for (int l = 0; l < index_num; ++l) {
+        int output_idx = indice_pairs[kk * 2 * L + L + l];
+        memcpy(gather_output_grad + (size_t)l * dyc,
+               output_grad + (size_t)output_idx * dyc, dyc * sizeof(float));
+      }
+      cpuSgemm(false, true, index_num, dxc, dyc, 1.0f, gather_output_grad, dyc,
+               filter_transpose_cpu + kk * dxc * dyc, dyc, 0.0f,
+               gather_input_grad, dxc);
+      for (int l = 0; l < index_num; ++l) {
+        int input_idx = indice_pairs[kk * 2 * L + l];
+        float *input_slice = input_grad + (size_t)input_idx * dxc;
+        for (int dxc_i = 0; dxc_i < dxc; ++dxc_i) {
+          input_slice[dxc_i] += gather_input_grad[(size_t)l * dxc + dxc_i];
+        }
+      }
+    }
+    cpu_runtime_.deallocate(gather_input_grad);
+    cpu_runtime_.deallocate(gather_output_grad);
+  } else {
+    for (int kk = 0; kk < K; ++kk) {
+      int filter_offset = kk * dxc * dyc;
+      int index_num = (int)(indice_num_[kk]);
+      GTEST_CHECK(L >= index_num);
+      for (int l = 0; l < index_num; ++l) {  // index_pair data loop
+        int input_idx = indice_pairs[kk * 2 * L + l];
+        int output_idx = indice_pairs[kk * 2 * L + L + l];
+        float *sub_filter = filter_transpose_cpu + filter_offset;
+        float *input_slice = input_grad + input_idx * dxc;
+        float *output_slice = output_grad + output_idx * dyc;
+        for (int dxc_i = 0; dxc_i < dxc; ++dxc_i) {
+          float *input_grad_result = input_slice + dxc_i;
+          float input_grad_accumulate = 0;
+          for (int dyc_i = 0; dyc_i < dyc; ++dyc_i) {
+            float input_grad_tmp = 0;
+            float output_grad_tmp = output_slice[dyc_i];
+            float filter_tmp = sub_filter[dxc_i * dyc + dyc_i];
             // half
             uint16_t temp;
             wrapRtConvertFloatToHalf(&temp, output_grad_tmp);
@@ -331,8 +363,8 @@ void IndiceConvolutionBackwardDataExecutor::cpuCompute() {
             wrapRtConvertFloatToHalf(&temp, input_grad_accumulate);
             wrapRtConvertHalfToFloat(&input_grad_accumulate, temp);
           }
+          *input_grad_result += input_grad_accumulate;
         }
-        *input_grad_result += input_grad_accumulate;
       }
     }
   }
@@ -24,6 +24,7 @@
 #define TEST_MLU_OP_GTEST_SRC_ZOO_INDICE_CONVOLUTION_BACKWARD_DATA_INDICE_CONVOLUTION_BACKWARD_DATA_H_ // NOLINT
 #include <vector>
 
+#include "cpu_gemm.h"
 #include "executor.h"
 
 namespace mluoptest {
@@ -39,6 +40,7 @@ class IndiceConvolutionBackwardDataExecutor : public Executor {
   void workspaceFree();
   void setMiscellaneousParam() override;
   int64_t getTheoryOps() override;
+  int64_t cpuComputeVersion() override { return kCpuGemmVersion; }
 
   void getFilterDims();
   void setSpconvdataParams();
@@ -24,6 +24,8 @@
 #include <vector>
 #include <string>
 #include <set>
+#include <algorithm>
+#include "cpu_gemm.h"
 #include "mlu_op.h"
 
 namespace mluoptest {
@@ -143,30 +145,35 @@ void IndiceConvolutionBackwardFilterExecutor::cpuCompute() {
   int64_t kw = mluOpGetTensordimH(diffw_desc_);
   int64_t kernel_volume = kd * kh * kw;
 
-  for (int64_t kd_index = 0; kd_index < kd; ++kd_index) {
-    for (int64_t kh_index = 0; kh_index < kh; ++kh_index) {
-      for (int64_t kw_index = 0; kw_index < kw; ++kw_index) {
-        int64_t kernel_index = kd_index * kh * kw + kh_index * kw + kw_index;
-        for (int64_t ci_index = 0; ci_index < ci; ++ci_index) {
-          for (int64_t co_index = 0; co_index < co; ++co_index) {
-            float temp_res = 0.0;
-            for (int64_t indice_i = 0; indice_i < indice_num_[kernel_index];
-                 ++indice_i) {
-              int64_t input_pos =
-                  indice_pair[kernel_index * 2 * in_active_num + indice_i];
-              int64_t diffy_pos = indice_pair[kernel_index * 2 * in_active_num +
-                                              1 * in_active_num + indice_i];
-              temp_res += input_indices[input_pos * ci + ci_index] *
-                          diffy_indices[diffy_pos * co + co_index];
-            }
-
-            temp_diffw[kernel_index * ci * co + ci_index * co + co_index] =
-                temp_res;
-          }
-        }
-      }
+  // diffw of every kernel offset is gather(input)^T * gather(diffy)
+  int64_t max_pair_num = 0;
+  for (int64_t kernel_index = 0; kernel_index < kernel_volume;
+       ++kernel_index) {
+    max_pair_num = std::max(max_pair_num, indice_num_[kernel_index]);
+  }
+  float *gather_input =
+      (float *)cpu_runtime_.allocate(max_pair_num * ci * sizeof(float));
+  float *gather_diffy =
+      (float *)cpu_runtime_.allocate(max_pair_num * co * sizeof(float));
+  for (int64_t kernel_index = 0; kernel_index < kernel_volume;
+       ++kernel_index) {
+    int64_t pair_num = indice_num_[kernel_index];
+    for (int64_t indice_i = 0; indice_i < pair_num; ++indice_i) {
+      int64_t input_pos =
+          indice_pair[kernel_index * 2 * in_active_num + indice_i];
+      int64_t diffy_pos = indice_pair[kernel_index * 2 * in_active_num +
+                                      1 * in_active_num + indice_i];
+      memcpy(gather_input + indice_i * ci, input_indices + input_pos * ci,
+             ci * sizeof(float));
+      memcpy(gather_diffy + indice_i * co, diffy_indices + diffy_pos * co,
+             co * sizeof(float));
     }
+    // beta = 0 also clears diffw of kernel offsets without any pair.
+    cpuSgemm(true, false, ci, co, pair_num, 1.0f, gather_input, ci,
+             gather_diffy, co, 0.0f, temp_diffw + kernel_index * ci * co, co);
   }
+  cpu_runtime_.deallocate(gather_diffy);
+  cpu_runtime_.deallocate(gather_input);
   // trans
   if (diffw_trans_) {
     cpuTranspose(diffw, temp_diffw, kernel_volume, ci, co, diffw_desc_->layout);
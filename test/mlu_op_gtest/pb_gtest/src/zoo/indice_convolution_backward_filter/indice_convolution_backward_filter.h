@@ -24,6 +24,7 @@
 #define TEST_MLU_OP_GTEST_SRC_ZOO_INDICE_CONVOLUTION_BACKWARD_FILTER_INDICE_CONVOLUTION_BACKWARD_FILTER_H_  // NOLINT
 #include <string>
 #include <vector>
+#include "cpu_gemm.h"
 #include "executor.h"
 
 namespace mluoptest {
@@ -36,6 +37,7 @@ class IndiceConvolutionBackwardFilterExecutor : public Executor {
   void workspaceMalloc() override;
   void workspaceFree() override;
   int64_t getTheoryOps() override;
+  int64_t cpuComputeVersion() override { return kCpuGemmVersion; }
   int64_t getTheoryIoSize() override;
 
  private:
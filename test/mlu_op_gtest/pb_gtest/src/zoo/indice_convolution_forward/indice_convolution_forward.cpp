@@ -21,6 +21,10 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *************************************************************************/
 #include "indice_convolution_forward.h"
+
+#include <algorithm>
+
+#include "cpu_gemm.h"
 #include "mlu_op.h"
 
 namespace mluoptest {
@@ -144,30 +148,46 @@ void IndiceConvolutionForwardExecutor::cpuCompute() {
       cpu_fp32_output_[0], 0x00,
       mluOpDataTypeBytes(features_out_desc_->dtype) * features_out_data_count);
 
-  for (int64_t kdi = 0; kdi < kd; ++kdi) {
-    for (int64_t khi = 0; khi < kh; ++khi) {
-      for (int64_t kwi = 0; kwi < kw; ++kwi) {
-        int64_t filters_index = kdi * kh * kw + khi * kw + kwi;
-        for (int64_t ipi = 0; ipi < indice_num_[filters_index]; ++ipi) {
-          int64_t input_offset =
-              indice_pairs[filters_index * 2 * num_active_in + ipi];
-          int64_t output_offset =
-              indice_pairs[filters_index * 2 * num_active_in + num_active_in +
-                           ipi];
-          if (output_offset < 0 || input_offset < 0) continue;
-          for (int64_t cii = 0; cii < ci; ++cii) {
-            for (int64_t coi = 0; coi < co; ++coi) {
-              float temp_res = 0.0;
-              temp_res +=
-                  features[input_offset * ci + cii] *
-                  filters_transed[filters_index * ci * co + cii * co + coi];
-              features_out[output_offset * co + coi] += temp_res;
-            }
-          }
-        }
+  // for every kernel offset: gather the active input rows, multiply them by
+  // the [ci, co] filter of this offset, then scatter-add to output rows.
+  int64_t max_pair_num = 0;
+  for (int64_t filters_index = 0; filters_index < num_filters;
+       ++filters_index) {
+    max_pair_num = std::max(max_pair_num, indice_num_[filters_index]);
+  }
+  float *gather_features =
+      (float *)cpu_runtime_.allocate(max_pair_num * ci * sizeof(float));
+  float *gather_output =
+      (float *)cpu_runtime_.allocate(max_pair_num * co * sizeof(float));
+  std::vector<int64_t> output_offsets;
+  for (int64_t filters_index = 0; filters_index < num_filters;
+       ++filters_index) {
+    output_offsets.clear();
+    for (int64_t ipi = 0; ipi < indice_num_[filters_index]; ++ipi) {
+      int64_t input_offset =
+          indice_pairs[filters_index * 2 * num_active_in + ipi];
+      int64_t output_offset =
+          indice_pairs[filters_index * 2 * num_active_in + num_active_in +
+                       ipi];
+      if (output_offset < 0 || input_offset < 0) continue;
+      memcpy(gather_features + output_offsets.size() * ci,
+             features + input_offset * ci, ci * sizeof(float));
+      output_offsets.push_back(output_offset);
+    }
+    int64_t pair_num = output_offsets.size();
+    if (pair_num == 0) continue;
+    cpuSgemm(false, false, pair_num, co, ci, 1.0f, gather_features, ci,
+             filters_transed + filters_index * ci * co, co, 0.0f,
+             gather_output, co);
+    for (int64_t pi = 0; pi < pair_num; ++pi) {
+      float *output_row = features_out + output_offsets[pi] * co;
+      for (int64_t coi = 0; coi < co; ++coi) {
+        output_row[coi] += gather_output[pi * co + coi];
       }
     }
   }
+  cpu_runtime_.deallocate(gather_output);
+  cpu_runtime_.deallocate(gather_features);
   if (filters_need_transpose) {
     cpu_runtime_.deallocate(filters_transed);
   }
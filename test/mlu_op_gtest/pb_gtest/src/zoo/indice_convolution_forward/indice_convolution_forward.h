@@ -25,6 +25,7 @@
 #include <string>
 #include <vector>
 
+#include "cpu_gemm.h"
 #include "executor.h"
 
 namespace mluoptest {
@@ -36,6 +37,7 @@ class IndiceConvolutionForwardExecutor : public Executor {
   void workspaceMalloc() override;
   void workspaceFree() override;
   int64_t getTheoryOps() override;
+  int64_t cpuComputeVersion() override { return kCpuGemmVersion; }
   int64_t getTheoryIoSize() override;
 
  private:
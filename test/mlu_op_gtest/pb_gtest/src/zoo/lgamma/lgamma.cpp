@@ -22,6 +22,9 @@
  *************************************************************************/
 #include "lgamma.h"
 
+#include "host_math.h"
+#include "parallel_for.h"
+
 namespace mluoptest {
 
 void LgammaExecutor::paramCheck() {
@@ -58,9 +61,11 @@ void LgammaExecutor::compute() {
 void LgammaExecutor::cpuCompute() {
   auto count = parser_->input(0)->shape_count;
 
-  for (int i = 0; i < count; ++i) {
-    cpu_fp32_output_[0][i] = ::lgamma(cpu_fp32_input_[0][i]);
-  }
+  const float *x = cpu_fp32_input_[0];
+  float *y = cpu_fp32_output_[0];
+  parallelForElements(count, 2 * sizeof(float), [&](size_t begin, size_t end) {
+    hostLgamma(x + begin, y + begin, end - begin);
+  });
 }
 
 int64_t LgammaExecutor::getTheoryOps() {
@@ -36,6 +36,8 @@ class LgammaExecutor : public Executor {
   void compute();
   void cpuCompute();
   int64_t getTheoryOps() override;
+  // 1: block-wise host_math kernels instead of libm
+  int64_t cpuComputeVersion() override { return 1; }
 
  private:
   bool inplace_ = false;
@@ -22,6 +22,9 @@
  *************************************************************************/
 #include "log.h"
 
+#include "host_math.h"
+#include "parallel_for.h"
+
 namespace mluoptest {
 
 void LogExecutor::paramCheck() {
@@ -63,21 +66,21 @@ void LogExecutor::cpuCompute() {
   mluOpLogBase_t base =
       (mluOpLogBase_t)(parser_->getProtoNode()->log_param().log_base());
   VLOG(4) << "log base is " << base << " (e -> 0, 2 -> 1, 10 -> 2)";
+  void (*log_func)(const float *, float *, size_t) = nullptr;
   if (base == mluOpLogBase_t::MLUOP_LOG_E) {
-    for (size_t i = 0; i < count; ++i) {
-      cpu_fp32_output_[0][i] = log(cpu_fp32_input_[0][i]);
-    }
+    log_func = hostLog<float>;
   } else if (base == mluOpLogBase_t::MLUOP_LOG_2) {
-    for (size_t i = 0; i < count; ++i) {
-      cpu_fp32_output_[0][i] = log2(cpu_fp32_input_[0][i]);
-    }
+    log_func = hostLog2<float>;
   } else if (base == mluOpLogBase_t::MLUOP_LOG_10) {
-    for (size_t i = 0; i < count; ++i) {
-      cpu_fp32_output_[0][i] = log10(cpu_fp32_input_[0][i]);
-    }
+    log_func = hostLog10<float>;
   } else {
     GTEST_CHECK(0);
   }
+  const float *x = cpu_fp32_input_[0];
+  float *y = cpu_fp32_output_[0];
+  parallelForElements(count, 2 * sizeof(float), [&](size_t begin, size_t end) {
+    log_func(x + begin, y + begin, end - begin);
+  });
 }
 
 int64_t LogExecutor::getTheoryOps() {
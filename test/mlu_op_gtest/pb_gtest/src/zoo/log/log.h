@@ -36,6 +36,8 @@ class LogExecutor : public Executor {
   void cpuCompute();
   void setMiscellaneousParam() override;
   int64_t getTheoryOps() override;
+  // 1: block-wise host_math kernels instead of libm
+  int64_t cpuComputeVersion() override { return 1; }
 };
 
 }  // namespace mluoptest
@@ -25,74 +25,9 @@
 #include <memory>
 #include <string>
 
-namespace mluoptest {
+#include "cpu_ms_deform_attn.h"
 
-void msDeformAttnCol2imBilinear(
-    const float *bottom_data, const int32_t &height, const int32_t &width,
-    const int32_t &nheads, const int32_t &channels, const float &h,
-    const float &w, const int32_t &m, const int32_t &c, const float &top_grad,
-    const float &attn_weight, float *grad_data_value, float *grad_sampling_loc,
-    float *grad_attn_weight) {
-  const int32_t h_low = floorf(h);
-  const int32_t w_low = floorf(w);
-  const int32_t h_high = h_low + 1;
-  const int32_t w_high = w_low + 1;
-
-  const float lh = h - h_low;
-  const float lw = w - w_low;
-  const float hh = 1 - lh, hw = 1 - lw;
-
-  const int32_t w_stride = nheads * channels;
-  const int32_t h_stride = width * w_stride;
-  const int32_t h_low_ptr_offset = h_low * h_stride;
-  const int32_t h_high_ptr_offset = h_low_ptr_offset + h_stride;
-  const int32_t w_low_ptr_offset = w_low * w_stride;
-  const int32_t w_high_ptr_offset = w_low_ptr_offset + w_stride;
-  const int32_t base_ptr = m * channels + c;
-
-  const float w1 = hh * hw, w2 = hh * lw, w3 = lh * hw, w4 = lh * lw;
-  const float top_grad_value = top_grad * attn_weight;
-  float grad_h_weight = 0, grad_w_weight = 0;
-
-  float v1 = 0;
-  if (h_low >= 0 && w_low >= 0) {
-    int32_t ptr1 = h_low_ptr_offset + w_low_ptr_offset + base_ptr;
-    v1 = bottom_data[ptr1];
-    grad_h_weight -= hw * v1;
-    grad_w_weight -= hh * v1;
-
-    *(grad_data_value + ptr1) = *(grad_data_value + ptr1) + w1 * top_grad_value;
-  }
-  float v2 = 0;
-  if (h_low >= 0 && w_high <= width - 1) {
-    int32_t ptr2 = h_low_ptr_offset + w_high_ptr_offset + base_ptr;
-    v2 = bottom_data[ptr2];
-    grad_h_weight -= lw * v2;
-    grad_w_weight += hh * v2;
-    *(grad_data_value + ptr2) = *(grad_data_value + ptr2) + w2 * top_grad_value;
-  }
-  float v3 = 0;
-  if (h_high <= height - 1 && w_low >= 0) {
-    int32_t ptr3 = h_high_ptr_offset + w_low_ptr_offset + base_ptr;
-    v3 = bottom_data[ptr3];
-    grad_h_weight += hw * v3;
-    grad_w_weight -= lh * v3;
-    *(grad_data_value + ptr3) = *(grad_data_value + ptr3) + w3 * top_grad_value;
-  }
-  float v4 = 0;
-  if (h_high <= height - 1 && w_high <= width - 1) {
-    int32_t ptr4 = h_high_ptr_offset + w_high_ptr_offset + base_ptr;
-    v4 = bottom_data[ptr4];
-    grad_h_weight += lw * v4;
-    grad_w_weight += lh * v4;
-    *(grad_data_value + ptr4) = *(grad_data_value + ptr4) + w4 * top_grad_value;
-  }
-
-  float val = (w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4);
-  *grad_attn_weight += top_grad * val;
-  *grad_sampling_loc += width * grad_w_weight * top_grad_value;
-  *(grad_sampling_loc + 1) += height * grad_h_weight * top_grad_value;
-}
+namespace mluoptest {
 
 void MsDeformAttnBackwardExecutor::paramCheck() {
   GTEST_CHECK(parser_->getInputNum() == 6);
@@ -159,67 +94,13 @@ void MsDeformAttnBackwardExecutor::cpuCompute() {
   const int32_t num_heads = sampling_loc_desc->dims[2];
   const int32_t num_levels = sampling_loc_desc->dims[3];
   const int32_t num_point = sampling_loc_desc->dims[4];
-  const int32_t qid_stride = num_heads * channels;
   const int32_t spatial_size = value_desc->dims[1];
 
-  const int32_t grad_weight_stride = 1;
-  const int32_t grad_loc_stride = 2;
-  for (int32_t i = 0; i < batch * num_query * num_heads * channels; ++i) {
-    int32_t temp = i;
-    int32_t c_col = i % channels;
-    temp /= channels;
-    int32_t sampling_index = temp;
-    int32_t m_col = temp % num_heads;
-    temp /= num_heads;
-    temp /= num_query;
-    const int32_t b_col = temp;
-    float *data_value = cpu_value;
-    float *grad_data_value = cpu_grad_value;
-    float *data_sampling_loc = cpu_sampling_loc;
-    float *data_attn_weight = cpu_attn_weight;
-    float *grad_sampling_loc = cpu_grad_sampling_loc;
-    float *grad_attn_weight = cpu_grad_attn_weight;
-    int32_t grad_output_offset = b_col * num_query * num_heads * channels +
-                                 i % (num_query * num_heads * channels);
-    float top_grad = cpu_grad_output[grad_output_offset];
-    int32_t data_weight_ptr = sampling_index * num_levels * num_point;
-    int32_t data_loc_w_ptr = data_weight_ptr << 1;
-    int32_t grad_sampling_ptr = data_weight_ptr;
-    float *grad_sampling_loc_out = grad_sampling_loc + (grad_sampling_ptr << 1);
-    float *grad_attn_weight_out = grad_attn_weight + grad_sampling_ptr;
-    const int32_t data_value_ptr_init_offset =
-        b_col * spatial_size * qid_stride;
-    for (int32_t l_col = 0; l_col < num_levels; ++l_col) {
-      int32_t level_start_id = cpu_level_start_index[l_col];
-      int32_t spatial_h_ptr = l_col << 1;
-      int32_t spatial_h = cpu_spatial_shapes[spatial_h_ptr];
-      int32_t spatial_w = cpu_spatial_shapes[spatial_h_ptr + 1];
-      int32_t value_ptr_offset =
-          data_value_ptr_init_offset + level_start_id * qid_stride;
-      float *data_value_ptr = data_value + value_ptr_offset;
-
-      float *grad_value_ptr = grad_data_value + value_ptr_offset;
-
-      for (int32_t p_col = 0; p_col < num_point; ++p_col) {
-        float loc_w = data_sampling_loc[data_loc_w_ptr];
-        float loc_h = data_sampling_loc[data_loc_w_ptr + 1];
-        float weight = data_attn_weight[data_weight_ptr];
-
-        float h_im = loc_h * spatial_h - 0.5;
-        float w_im = loc_w * spatial_w - 0.5;
-        if (h_im > -1 && w_im > -1 && h_im < spatial_h && w_im < spatial_w) {
-          msDeformAttnCol2imBilinear(
-              data_value_ptr, spatial_h, spatial_w, num_heads, channels, h_im,
-              w_im, m_col, c_col, top_grad, weight, grad_value_ptr,
-              grad_sampling_loc_out, grad_attn_weight_out);
-        }
-        data_weight_ptr += 1;
-        data_loc_w_ptr += 2;
-        grad_attn_weight_out += grad_weight_stride;
-        grad_sampling_loc_out += grad_loc_stride;
-      }
-    }
-  }
+  msDeformAttnBackwardCpu(cpu_value, cpu_spatial_shapes, cpu_level_start_index,
+                          cpu_sampling_loc, cpu_attn_weight, cpu_grad_output,
+                          batch, spatial_size, num_heads, channels, num_levels,
+                          num_query, num_point, cpu_grad_value,
+                          cpu_grad_sampling_loc, cpu_grad_attn_weight);
 }
 
 int64_t MsDeformAttnBackwardExecutor::getTheoryOps() {
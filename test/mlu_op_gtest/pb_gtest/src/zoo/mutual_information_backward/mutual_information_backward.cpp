@@ -23,8 +23,16 @@
 
 #include "mutual_information_backward.h"
 
+#include <algorithm>
+#include <atomic>
+
+#include "parallel_for.h"
+
 namespace mluoptest {
 
+// cells per chunk of the row parallel passes.
+constexpr int kMutualInformationRowCells = 1 << 14;
+
 void MutualInformationBackwardExecutor::initParam() {
   overwrite_ans_grad_ = parser_->getProtoNode()
                                ->mutual_information_backward_param()
@@ -162,38 +170,36 @@ void MutualInformationBackwardExecutor::cpuCompute() {
   host_px_grad = cpu_fp32_output_[1];
   host_py_grad = cpu_fp32_output_[2];
 
-  int s_begin = 0;
-  int t_begin = 0;
-  int s_end = S_;
-  int t_end = T_;
+  std::vector<WavefrontBox> boxes(B_);
   for (int b = 0; b < B_; ++b) {
+    boxes[b] = {b, 0, S_, 0, T_};
     if (host_opt_boundary != nullptr) {
-      s_begin = (int)host_opt_boundary[b * 4];
-      t_begin = (int)host_opt_boundary[b * 4 + 1];
-      s_end = (int)host_opt_boundary[b * 4 + 2];
-      t_end = (int)host_opt_boundary[b * 4 + 3];
+      boxes[b].s_begin = (int)host_opt_boundary[b * 4];
+      boxes[b].t_begin = (int)host_opt_boundary[b * 4 + 1];
+      boxes[b].s_end = (int)host_opt_boundary[b * 4 + 2];
+      boxes[b].t_end = (int)host_opt_boundary[b * 4 + 3];
     }
-
-    computeTerm1AndTerm2(b, s_begin, s_end, t_begin, t_end, host_px, host_py,
-                         host_p);
-    computePGrad(b, s_begin, s_end, t_begin, t_end, host_px, host_py, host_p,
-                 ans_grad_in_, host_ans_grad_out);
-    computePxGradAndPyGrad(b, s_begin, s_end, t_begin, t_end, host_px, host_py,
-                           host_p, host_px_grad, host_py_grad);
   }
 
+  computeTerm1AndTerm2(boxes, host_px, host_py, host_p);
+  computePGrad(boxes, host_px, host_py, host_p, ans_grad_in_,
+               host_ans_grad_out);
+  computePxGradAndPyGrad(boxes, host_px, host_py, host_p, host_px_grad,
+                         host_py_grad);
+
   if (ans_grad_in_) {
     cpu_runtime_.deallocate(ans_grad_in_);
   }
 }
 
-float MutualInformationBackwardExecutor::safeExp(float x) {
+float MutualInformationBackwardExecutor::safeExp(float x,
+                                                 int64_t *ops) const {
   if (x - x != 0) {
-    theory_ops_ += 2;
+    *ops += 2;
     return 0;
   } else {
     float ans = std::exp(x);
-    theory_ops_ += 5;
+    *ops += 5;
     if (ans - ans != 0.0) {
       return 0;
     }
@@ -201,99 +207,149 @@ float MutualInformationBackwardExecutor::safeExp(float x) {
   }
 }
 
+void MutualInformationBackwardExecutor::forEachRow(
+    const std::function<void(int b, int s, int64_t *ops)> &func) {
+  // rows of all batches are independent, a chunk holds about
+  // kMutualInformationRowCells cells.
+  const size_t grain =
+      std::max(1, kMutualInformationRowCells / std::max(1, T_ + 1));
+  std::atomic<int64_t> ops(0);
+  parallelForChunks((size_t)B_ * (S_ + 1), grain,
+                    [&](size_t, size_t begin, size_t end) {
+                      int64_t chunk_ops = 0;
+                      for (size_t row = begin; row < end; ++row) {
+                        func(row / (S_ + 1), row % (S_ + 1), &chunk_ops);
+                      }
+                      ops += chunk_ops;
+                    });
+  theory_ops_ += ops;
+}
+
 void MutualInformationBackwardExecutor::computeTerm1AndTerm2(
-    const int b, const int s_begin, const int s_end, const int t_begin,
-    const int t_end, float *px, float *py, float *p) {
-  for (int s = s_begin; s <= s_end; ++s) {
-    for (int t = t_begin; t <= t_end; ++t) {
-      theory_ops_++;
+    const std::vector<WavefrontBox> &boxes, float *px, float *py, float *p) {
+  forEachRow([&](int b, int s, int64_t *ops) {
+    const WavefrontBox &box = boxes[b];
+    if (s < box.s_begin || s > box.s_end) {
+      return;
+    }
+    for (int t = box.t_begin; t <= box.t_end; ++t) {
+      (*ops)++;
       if (p[p_index_(b, s, t)] < large_neg_num_) {
         p[p_index_(b, s, t)] = large_neg_num_;
-        theory_ops_++;
+        (*ops)++;
       }
     }
-  }
+  });
 
-  for (int s = s_begin; s <= s_end; ++s) {
-    for (int t = t_begin; t <= t_end; ++t) {
-      if (s < s_end) {
+  // terms of row s read the clamped p of row s + 1.
+  forEachRow([&](int b, int s, int64_t *ops) {
+    const WavefrontBox &box = boxes[b];
+    if (s < box.s_begin || s > box.s_end) {
+      return;
+    }
+    for (int t = box.t_begin; t <= box.t_end; ++t) {
+      if (s < box.s_end) {
         // compute term1
-        px[px_index_(b, s, t)] = safeExp(p[p_index_(b, s, t)] +
-                                         px[px_index_(b, s, t)] -
-                                         p[p_index_(b, s + 1, t)]);
-        theory_ops_ += 2;
+        px[px_index_(b, s, t)] =
+            safeExp(p[p_index_(b, s, t)] + px[px_index_(b, s, t)] -
+                        p[p_index_(b, s + 1, t)],
+                    ops);
+        *ops += 2;
       }
 
-      if (t < t_end) {
+      if (t < box.t_end) {
         // compute term2
-        py[py_index_(b, s, t)] = safeExp(p[p_index_(b, s, t)] +
-                                         py[py_index_(b, s, t)] -
-                                         p[p_index_(b, s, t + 1)]);
-        theory_ops_ += 2;
+        py[py_index_(b, s, t)] =
+            safeExp(p[p_index_(b, s, t)] + py[py_index_(b, s, t)] -
+                        p[p_index_(b, s, t + 1)],
+                    ops);
+        *ops += 2;
       }
     }
-  }
+  });
 }
 
 void MutualInformationBackwardExecutor::computePGrad(
-    const int b, const int s_begin, const int s_end, const int t_begin,
-    const int t_end, float *term1, float *term2, float *p, float *ans_grad_in,
-    float *ans_grad_out) {
-  // compute p_grad[b][s_end][t_end]
-  p[p_index_(b, s_end, t_end)] = ans_grad_in[b];
-  theory_ops_++;
-
-  // compute p_grad[b][s_end][0:t_end]
-  for (int t = t_end - 1; t >= t_begin; --t) {
-    p[p_index_(b, s_end, t)] = term2[py_index_(b, s_end, t)] *
-                               p[p_index_(b, s_end, t + 1)];
+    const std::vector<WavefrontBox> &boxes, float *term1, float *term2,
+    float *p, float *ans_grad_in, float *ans_grad_out) {
+  // the last row and column are filled even when the beginning of the
+  // boundary is after the other end.
+  std::vector<WavefrontBox> fill_boxes(boxes);
+  for (auto &box : fill_boxes) {
+    // compute p_grad[b][s_end][t_end]
+    p[p_index_(box.b, box.s_end, box.t_end)] = ans_grad_in[box.b];
     theory_ops_++;
+    box.s_begin = std::min(box.s_begin, box.s_end);
+    box.t_begin = std::min(box.t_begin, box.t_end);
   }
 
-  // compute p_grad[b][0:s_end][t_end]
-  for (int s = s_end - 1; s >= s_begin; --s) {
-    p[p_index_(b, s, t_end)] = term1[px_index_(b, s, t_end)] *
-                               p[p_index_(b, s + 1, t_end)];
-    theory_ops_++;
-  }
-
-  for (int s = s_end - 1; s >= s_begin; --s) {
-    for (int t = t_end - 1; t >= t_begin; --t) {
-      p[p_index_(b, s, t)] = term1[px_index_(b, s, t)] *
-                             p[p_index_(b, s + 1, t)] +
-                             term2[py_index_(b, s, t)] *
-                             p[p_index_(b, s, t + 1)];
-      theory_ops_ += 3;
+  // p_grad(s, t) only needs p_grad(s + 1, t) and p_grad(s, t + 1), so tiles
+  // on the same anti-diagonal from the end corner are filled in parallel.
+  std::atomic<int64_t> ops(0);
+  wavefrontForTiles(fill_boxes, true, [&](const WavefrontBox &tile) {
+    const WavefrontBox &box = fill_boxes[tile.b];
+    const int b = box.b;
+    int64_t tile_ops = 0;
+    for (int s = tile.s_end; s >= tile.s_begin; --s) {
+      for (int t = tile.t_end; t >= tile.t_begin; --t) {
+        if (s == box.s_end && t == box.t_end) {
+          continue;
+        }
+        if (s == box.s_end) {
+          // p_grad[b][s_end][0:t_end]
+          p[p_index_(b, s, t)] =
+              term2[py_index_(b, s, t)] * p[p_index_(b, s, t + 1)];
+          tile_ops++;
+        } else if (t == box.t_end) {
+          // p_grad[b][0:s_end][t_end]
+          p[p_index_(b, s, t)] =
+              term1[px_index_(b, s, t)] * p[p_index_(b, s + 1, t)];
+          tile_ops++;
+        } else {
+          p[p_index_(b, s, t)] =
+              term1[px_index_(b, s, t)] * p[p_index_(b, s + 1, t)] +
+              term2[py_index_(b, s, t)] * p[p_index_(b, s, t + 1)];
+          tile_ops += 3;
+        }
+      }
+    }
+    ops += tile_ops;
+  });
+  theory_ops_ += ops;
+
+  for (const auto &box : boxes) {
+    if (overwrite_ans_grad_ && box.s_begin <= box.s_end &&
+        box.t_begin <= box.t_end) {
+      ans_grad_out[box.b] = p[p_index_(box.b, box.s_begin, box.t_begin)];
+      theory_ops_++;
     }
-  }
-
-  if (overwrite_ans_grad_ && s_begin <= s_end && t_begin <= t_end) {
-    ans_grad_out[b] = p[p_index_(b, s_begin, t_begin)];
-    theory_ops_++;
   }
 }
 
 void MutualInformationBackwardExecutor::computePxGradAndPyGrad(
-    const int b, const int s_begin, const int s_end, const int t_begin,
-    const int t_end, float *term1, float *term2, float *p_grad, float *px_grad,
-    float *py_grad) {
-  for (int s = s_begin; s <= s_end; ++s) {
-    for (int t = t_begin; t <= t_end; ++t) {
-      if (s < s_end) {
-        // compute px_grad
-        px_grad[px_index_(b, s, t)] = p_grad[p_index_(b, s + 1, t)] *
-                                      term1[px_index_(b, s, t)];
-      }
-
-      if (t < t_end) {
-        // compute py_grad
-        py_grad[py_index_(b, s, t)] = p_grad[p_index_(b, s, t + 1)] *
-                                      term2[py_index_(b, s, t)];
+    const std::vector<WavefrontBox> &boxes, float *term1, float *term2,
+    float *p_grad, float *px_grad, float *py_grad) {
+  forEachRow([&](int b, int s, int64_t *) {
+    const int s_begin = boxes[b].s_begin;
+    const int s_end = boxes[b].s_end;
+    const int t_begin = boxes[b].t_begin;
+    const int t_end = boxes[b].t_end;
+    if (s >= s_begin && s <= s_end) {
+      for (int t = t_begin; t <= t_end; ++t) {
+        if (s < s_end) {
+          // compute px_grad
+          px_grad[px_index_(b, s, t)] = p_grad[p_index_(b, s + 1, t)] *
+                                        term1[px_index_(b, s, t)];
+        }
+
+        if (t < t_end) {
+          // compute py_grad
+          py_grad[py_index_(b, s, t)] = p_grad[p_index_(b, s, t + 1)] *
+                                        term2[py_index_(b, s, t)];
+        }
       }
     }
-  }
 
-  for (int s = 0; s <= S_; ++s) {
     for (int t = 0; t <= T_; ++t) {
       if (s < S_ && (s < s_begin || s >= s_end) && (t < t_begin || t > t_end)) {
         px_grad[px_index_(b, s, t)] = 0;
@@ -303,9 +359,9 @@ void MutualInformationBackwardExecutor::computePxGradAndPyGrad(
         py_grad[py_index_(b, s, t)] = 0;
       }
     }
-  }
+  });
 
-  theory_ops_ += S_ * (T_ + 1) + (S_ + 1) * T_;
+  theory_ops_ += (int64_t)B_ * (S_ * (T_ + 1) + (S_ + 1) * T_);
 }
 
 int64_t MutualInformationBackwardExecutor::getTheoryOps() {
@@ -25,9 +25,13 @@ MUTUAL_INFORMATION_BACKWARD_H_
 #define TEST_MLU_OP_GTEST_SRC_ZOO_MUTUAL_INFORMATION_BACKWARD_\
 MUTUAL_INFORMATION_BACKWARD_H_
 
+#include <functional>
+#include <vector>
+
 #include "core/tensor.h"
 #include "executor.h"
 #include "mlu_op.h"
+#include "wavefront.h"
 
 namespace mluoptest {
 
@@ -61,18 +65,18 @@ class MutualInformationBackwardExecutor : public Executor {
 
  private:
   void initParam();
-  void computeTerm1AndTerm2(const int b, const int s_begin, const int s_end,
-                            const int t_begin, const int t_end, float *px,
-                            float *py, float *p);
-  void computePGrad(const int b, const int s_begin, const int s_end,
-                    const int t_begin, const int t_end, float *term1,
+  // calls func(b, s, ops) for every row s in [0, S] of every batch in
+  // parallel, ops func adds to are added to theory_ops_.
+  void forEachRow(const std::function<void(int b, int s, int64_t *ops)> &func);
+  void computeTerm1AndTerm2(const std::vector<WavefrontBox> &boxes,
+                            float *px, float *py, float *p);
+  void computePGrad(const std::vector<WavefrontBox> &boxes, float *term1,
                     float *term2, float *p, float *ans_grad_in,
                     float *ans_grad_out);
-  void computePxGradAndPyGrad(const int b, const int s_begin, const int s_end,
-                              const int t_begin, const int t_end, float *term1,
-                              float *term2, float *p_grad, float *px_grad,
-                              float *py_grad);
-  float safeExp(float x);
+  void computePxGradAndPyGrad(const std::vector<WavefrontBox> &boxes,
+                              float *term1, float *term2, float *p_grad,
+                              float *px_grad, float *py_grad);
+  float safeExp(float x, int64_t *ops) const;
 
   mluOpTensorDescriptor_t px_desc_ = nullptr;
   mluOpTensorDescriptor_t py_desc_ = nullptr;
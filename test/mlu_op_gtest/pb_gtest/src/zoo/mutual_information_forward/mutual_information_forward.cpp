@@ -23,6 +23,9 @@
 
 #include "mutual_information_forward.h"
 
+#include <algorithm>
+#include <atomic>
+
 namespace mluoptest {
 
 void MutualInformationForwardExecutor::initParam() {
@@ -132,41 +135,39 @@ void MutualInformationForwardExecutor::cpuCompute() {
   memcpy(host_p_out, p_in_, B_ * (S_ + 1) * (T_ + 1) * sizeof(float));
   float *host_ans = cpu_fp32_output_[1];
 
-  int s_begin = 0;
-  int t_begin = 0;
-  int s_end = S_;
-  int t_end = T_;
+  std::vector<WavefrontBox> boxes(B_);
   for (int b = 0; b < B_; ++b) {
+    boxes[b] = {b, 0, S_, 0, T_};
     if (host_opt_boundary != nullptr) {
-      s_begin = (int)host_opt_boundary[b * 4];
-      t_begin = (int)host_opt_boundary[b * 4 + 1];
-      s_end = (int)host_opt_boundary[b * 4 + 2];
-      t_end = (int)host_opt_boundary[b * 4 + 3];
+      boxes[b].s_begin = (int)host_opt_boundary[b * 4];
+      boxes[b].t_begin = (int)host_opt_boundary[b * 4 + 1];
+      boxes[b].s_end = (int)host_opt_boundary[b * 4 + 2];
+      boxes[b].t_end = (int)host_opt_boundary[b * 4 + 3];
     }
-    computeMutualInformation(b, s_begin, s_end, t_begin, t_end, host_px,
-                             host_py, host_p_out, host_ans);
   }
+  computeMutualInformation(boxes, host_px, host_py, host_p_out, host_ans);
 
   if (p_in_) {
     cpu_runtime_.deallocate(p_in_);
   }
 }
 
-float MutualInformationForwardExecutor::logAdd(float x, float y) {
+float MutualInformationForwardExecutor::logAdd(float x, float y,
+                                               int64_t *ops) const {
   float diff;
   if (x < y) {
     diff = x - y;
     x = y;
-    theory_ops_ += 2;
+    *ops += 2;
   } else {
     diff = y - x;
-    theory_ops_++;
+    (*ops)++;
   }
 
   if (diff >= min_log_diff_float) {
     float res;
     res = x + log1pf(expf(diff));
-    theory_ops_ += 4;
+    *ops += 4;
     return res;
   }
 
@@ -174,36 +175,61 @@ float MutualInformationForwardExecutor::logAdd(float x, float y) {
 }
 
 void MutualInformationForwardExecutor::computeMutualInformation(
-    const int b, const int s_begin, const int s_end, const int t_begin,
-    const int t_end, float *px, float *py, float *p, float *ans) {
-  p[p_index_(b, s_begin, t_begin)] = 0;
-  theory_ops_++;
-
-  for (int s = s_begin + 1; s <= s_end; ++s) {
-    p[p_index_(b, s, t_begin)] = logAdd(p[p_index_(b, s - 1, t_begin)] +
-                                        px[px_index_(b, s - 1, t_begin)],
-                                        -INFINITY);
-    theory_ops_++;
-  }
-
-  for (int t = t_begin + 1; t <= t_end; ++t) {
-    p[p_index_(b, s_begin, t)] = logAdd(-INFINITY,
-                                        p[p_index_(b, s_begin, t - 1)] +
-                                        py[py_index_(b, s_begin, t - 1)]);
+    const std::vector<WavefrontBox> &boxes, float *px, float *py, float *p,
+    float *ans) {
+  // the first row and column are filled even when the other end of the
+  // boundary is before the beginning.
+  std::vector<WavefrontBox> fill_boxes(boxes);
+  for (auto &box : fill_boxes) {
+    p[p_index_(box.b, box.s_begin, box.t_begin)] = 0;
     theory_ops_++;
+    box.s_end = std::max(box.s_begin, box.s_end);
+    box.t_end = std::max(box.t_begin, box.t_end);
   }
 
-  for (int s = s_begin + 1; s <= s_end; ++s) {
-    for (int t = t_begin + 1; t <= t_end; ++t) {
-      p[p_index_(b, s, t)] = logAdd(
-          p[p_index_(b, s - 1, t)] + px[px_index_(b, s - 1, t)],
-          p[p_index_(b, s, t - 1)] + py[py_index_(b, s, t - 1)]);
-      theory_ops_ += 2;
+  // p(s, t) only needs p(s - 1, t) and p(s, t - 1), so tiles on the same
+  // anti-diagonal, of every batch, are filled in parallel.
+  std::atomic<int64_t> ops(0);
+  wavefrontForTiles(fill_boxes, false, [&](const WavefrontBox &tile) {
+    const WavefrontBox &box = fill_boxes[tile.b];
+    const int b = box.b;
+    int64_t tile_ops = 0;
+    for (int s = tile.s_begin; s <= tile.s_end; ++s) {
+      int t = tile.t_begin;
+      if (s == box.s_begin) {
+        for (t = std::max(t, box.t_begin + 1); t <= tile.t_end; ++t) {
+          p[p_index_(b, s, t)] = logAdd(
+              -INFINITY, p[p_index_(b, s, t - 1)] + py[py_index_(b, s, t - 1)],
+              &tile_ops);
+          tile_ops++;
+        }
+        continue;
+      }
+      if (t == box.t_begin) {
+        p[p_index_(b, s, t)] =
+            logAdd(p[p_index_(b, s - 1, t)] + px[px_index_(b, s - 1, t)],
+                   -INFINITY, &tile_ops);
+        tile_ops++;
+        ++t;
+      }
+      float *p_row = p + p_index_(b, s, 0);
+      const float *p_up = p + p_index_(b, s - 1, 0);
+      const float *px_up = px + px_index_(b, s - 1, 0);
+      const float *py_row = py + py_index_(b, s, 0);
+      for (; t <= tile.t_end; ++t) {
+        p_row[t] = logAdd(p_up[t] + px_up[t], p_row[t - 1] + py_row[t - 1],
+                          &tile_ops);
+        tile_ops += 2;
+      }
     }
-  }
+    ops += tile_ops;
+  });
+  theory_ops_ += ops;
 
-  ans[b] = p[p_index_(b, s_end, t_end)];
-  theory_ops_++;
+  for (const auto &box : boxes) {
+    ans[box.b] = p[p_index_(box.b, box.s_end, box.t_end)];
+    theory_ops_++;
+  }
 }
 
 int64_t MutualInformationForwardExecutor::getTheoryOps() {
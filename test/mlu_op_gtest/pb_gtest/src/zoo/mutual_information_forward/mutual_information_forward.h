@@ -25,9 +25,12 @@ MUTUAL_INFORMATION_FORWARD_H_
 #define TEST_MLU_OP_GTEST_SRC_ZOO_MUTUAL_INFORMATION_FORWARD_\
 MUTUAL_INFORMATION_FORWARD_H_
 
+#include <vector>
+
 #include "core/tensor.h"
 #include "executor.h"
 #include "mlu_op.h"
+#include "wavefront.h"
 
 namespace mluoptest {
 namespace MutualInformationForward {
@@ -62,10 +65,10 @@ class MutualInformationForwardExecutor : public Executor {
 
  private:
   void initParam();
-  void computeMutualInformation(const int b, const int s_begin, const int s_end,
-                                const int t_begin, const int t_end, float *px,
-                                float *py, float *p, float *ans);
-  float logAdd(float x, float y);
+  void computeMutualInformation(const std::vector<WavefrontBox> &boxes,
+                                float *px, float *py, float *p, float *ans);
+  // log(exp(x) + exp(y)), ops are added to *ops.
+  float logAdd(float x, float y, int64_t *ops) const;
 
   mluOpTensorDescriptor_t px_desc_ = nullptr;
   mluOpTensorDescriptor_t py_desc_ = nullptr;
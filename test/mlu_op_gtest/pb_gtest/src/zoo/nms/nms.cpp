@@ -23,6 +23,7 @@
 #include <sys/time.h>
 #include "nms.h"
 #include "mlu_op.h"
+#include "cpu_nms.h"
 
 namespace mluoptest {
 void NmsExecutor::paramCheck() {
@@ -224,192 +225,6 @@ void NmsExecutor::nms3D_detection_cpu(float *output_data, int &output_box_num,
   cpu_runtime_.deallocate(box_b);
 }
 
-void NmsExecutor::nms_detection_cpu(
-    float *output_data, int &output_box_num, float *input_data,
-    float *input_score, int input_box_num, int keepNum, float thresh_iou,
-    float thresh_score, mluOpNmsOutputMode_t output_mode, int input_layout,
-    mluOpNmsAlgo_t algo, float offset, mluOpNmsBoxPointMode_t box_mode,
-    mluOpNmsMethodMode_t method_mode, float soft_nms_sigma, int batch_idx,
-    int class_idx) {
-  float *score = cpu_runtime_.allocate(new float[input_box_num]);
-  float *x1 = cpu_runtime_.allocate(new float[input_box_num]);
-  float *y1 = cpu_runtime_.allocate(new float[input_box_num]);
-  float *x2 = cpu_runtime_.allocate(new float[input_box_num]);
-  float *y2 = cpu_runtime_.allocate(new float[input_box_num]);
-  if (input_layout == 0) {
-    // input layout is [boxes_num, 4]
-    for (int i = 0; i < input_box_num; i++) {
-      x1[i] = input_data[0 + i * 4];
-      y1[i] = input_data[1 + i * 4];
-      x2[i] = input_data[2 + i * 4];
-      y2[i] = input_data[3 + i * 4];
-      // VLOG(4) << i << " x1:" << x1[i] << "y1:" << y1[i] << "x2:" << x2[i] <<
-      // "y2:" << y2[i];
-    }
-  } else if (input_layout == 1) {
-    // input layout is [4, boxes_num]
-    memcpy(x1, input_data, input_box_num * sizeof(float));
-    memcpy(y1, input_data + 1 * input_box_num, input_box_num * sizeof(float));
-    memcpy(x2, input_data + 2 * input_box_num, input_box_num * sizeof(float));
-    memcpy(y2, input_data + 3 * input_box_num, input_box_num * sizeof(float));
-  } else {
-    VLOG(4) << "unsupport data layout now.";
-  }
-  memcpy(score, input_score, input_box_num * sizeof(float));
-  for (int keep = 0; keep < keepNum; keep++) {
-    // find the max score
-    float max_score = score[0];
-    int max_index = 0;
-    float max_x1, max_y1, max_x2, max_y2;
-    float output_x1, output_y1, output_x2, output_y2;
-    float max_area = 0;
-
-    for (int i = 1; i < input_box_num; i++) {
-      if (score[i] > max_score) {
-        max_score = score[i];
-        max_index = i;
-      }
-    }
-    max_x1 = x1[max_index];
-    max_y1 = y1[max_index];
-    max_x2 = x2[max_index];
-    max_y2 = y2[max_index];
-
-    if (max_score <= thresh_score) {
-      break;
-    }
-
-    // VLOG(4) << "max_index:" << max_index;
-    // VLOG(4) << "max_score: " << max_score << "x1: " << max_x1 << "y1: " <<
-    // max_y1
-    //        << "x2: " << max_x2 << "y2: " << max_y2;
-    if (output_mode == 0) {
-      // save index of max score
-      output_data[output_box_num] = max_index;
-    } else if (output_mode == 1) {
-      output_data[output_box_num * 5 + 0] = max_score;
-      output_data[output_box_num * 5 + 1] = max_x1;
-      output_data[output_box_num * 5 + 2] = max_y1;
-      output_data[output_box_num * 5 + 3] = max_x2;
-      output_data[output_box_num * 5 + 4] = max_y2;
-    } else if (output_mode == 2) {
-      output_data[0 * keepNum + output_box_num] = max_score;
-      output_data[1 * keepNum + output_box_num] = max_x1;
-      output_data[2 * keepNum + output_box_num] = max_y1;
-      output_data[3 * keepNum + output_box_num] = max_x2;
-      output_data[4 * keepNum + output_box_num] = max_y2;
-    } else if (output_mode == 3) {
-      output_data[output_box_num * 3 + 0] = batch_idx;
-      output_data[output_box_num * 3 + 1] = class_idx;
-      output_data[output_box_num * 3 + 2] = max_index;
-    } else {
-      VLOG(4) << "unsupport output mode now.";
-    }
-    output_box_num++;
-    score[max_index] = 0;
-
-    if (box_mode == 0) {
-      if (max_x1 > max_x2) {
-        float tmp = max_x1;
-        max_x1 = max_x2;
-        max_x2 = tmp;
-      }
-      if (max_y1 > max_y2) {
-        float tmp = max_y1;
-        max_y1 = max_y2;
-        max_y2 = tmp;
-      }
-    } else if (box_mode == 1) {
-      max_x1 = max_x1 - max_x2 * 0.5;
-      max_x2 = max_x1 + max_x2;
-      max_y1 = max_y1 - max_y2 * 0.5;
-      max_y2 = max_y1 + max_y2;
-    }
-    if (algo == 0 || offset == 0.0) {
-      max_area = (max_x2 - max_x1) * (max_y2 - max_y1);
-    } else {
-      max_area = (max_x2 - max_x1 + offset) * (max_y2 - max_y1 + offset);
-    }
-
-    for (int i = 0; i < input_box_num; i++) {
-      // compute the IOU
-      float x1_cur = x1[i];
-      float y1_cur = y1[i];
-      float x2_cur = x2[i];
-      float y2_cur = y2[i];
-      float area_cur = 0.0;
-      if (box_mode == 0) {
-        if (x1_cur > x2_cur) {
-          float tmp = x1_cur;
-          x1_cur = x2_cur;
-          x2_cur = tmp;
-        }
-        if (y1_cur > y2_cur) {
-          float tmp = y1_cur;
-          y1_cur = y2_cur;
-          y2_cur = tmp;
-        }
-      } else if (box_mode == 1) {
-        x1_cur = x1_cur - x2_cur * 0.5;
-        x2_cur = x1_cur + x2_cur;
-        y1_cur = y1_cur - y2_cur * 0.5;
-        y2_cur = y1_cur + y2_cur;
-      }
-      if (algo == 1) {
-        area_cur = (x2_cur - x1_cur + offset) * (y2_cur - y1_cur + offset);
-      } else {
-        area_cur = (x2_cur - x1_cur) * (y2_cur - y1_cur);
-      }
-
-      // get the area_I
-      float inter_x1 = (max_x1 > x1_cur ? max_x1 : x1_cur);
-      float inter_y1 = (max_y1 > y1_cur ? max_y1 : y1_cur);
-      float inter_x2 = (max_x2 > x2_cur ? x2_cur : max_x2);
-      float inter_y2 = (max_y2 > y2_cur ? y2_cur : max_y2);
-      float inter_w = 0.0, inter_h = 0.0;
-      if (algo == 1) {
-        inter_w = inter_x2 - inter_x1 + offset;
-        inter_h = inter_y2 - inter_y1 + offset;
-      } else {
-        inter_w = inter_x2 - inter_x1;
-        inter_h = inter_y2 - inter_y1;
-      }
-      if (inter_w < 0) {
-        inter_w = 0;
-      }
-      if (inter_h < 0) {
-        inter_h = 0;
-      }
-      float area_I = inter_w * inter_h;
-      // get the area_U
-      float area_U = max_area + area_cur - area_I;
-      float iou = area_I / area_U;
-      // update the score
-      if (method_mode == 0) {
-        if (iou > thresh_iou) {
-          score[i] = 0;
-        }
-      } else if (method_mode == 1) {
-        score[i] = iou > thresh_iou ? score[i] * (1 - iou) : score[i];
-      } else {
-        // assert method_mode == 2
-        // TODO(wch): make sure the formula
-        if (soft_nms_sigma > 0.0) {
-          score[i] *= exp(-iou * iou / (2 * soft_nms_sigma));
-        } else {
-          score[i] = (iou > thresh_iou) ? 0.0 : score[i];
-        }
-      }
-    }
-  }
-  // VLOG(4) << "ouput_boxes_num:" << output_box_num;
-  cpu_runtime_.deallocate(score);
-  cpu_runtime_.deallocate(x1);
-  cpu_runtime_.deallocate(y1);
-  cpu_runtime_.deallocate(x2);
-  cpu_runtime_.deallocate(y2);
-}
-
 void NmsExecutor::cpuCompute() {
   GTEST_CHECK(parser_->getInputNum() == 2);
   // assert(parser_->getOutputNum() == 1);
@@ -479,23 +294,13 @@ void NmsExecutor::cpuCompute() {
     nms3D_detection_cpu(output_info, total_output_boxes_num, input_boxes,
                         input_boxes_num, iou_thresh, input_layout);
   } else {
-    for (int batch_idx = 0; batch_idx < input_batches_num; ++batch_idx) {
-      for (int class_idx = 0; class_idx < input_classes_num; ++class_idx) {
-        int boxes_offset = input_boxes_num * 4 * batch_idx;
-        int conf_offset = input_classes_num * input_boxes_num * batch_idx +
-                          input_boxes_num * class_idx;
-        int output_offset = mode == 3 ? 3 * total_output_boxes_num : 0;
-        int output_boxes_num = 0;
-        nms_detection_cpu((float *)output_info + output_offset,
-                          output_boxes_num, (float *)input_boxes + boxes_offset,
-                          (float *)input_conf + conf_offset, input_boxes_num,
-                          max_output_boxes, iou_thresh, confidence_threshold,
-                          mode, input_layout, algo, offset, box_mode,
-                          method_mode, soft_nms_sigma, batch_idx, class_idx);
-        total_output_boxes_num += output_boxes_num;
-        // VLOG(4) << "total_output_boxes:" << total_output_boxes_num;
-      }
-    }
+    NmsParam param = {max_output_boxes, iou_thresh,  confidence_threshold,
+                      algo,             offset,      box_mode,
+                      method_mode,      soft_nms_sigma};
+    total_output_boxes_num = nmsDetectionCpu(
+        (float *)output_info, (float *)input_boxes, (float *)input_conf,
+        input_batches_num, input_classes_num, input_boxes_num, input_layout,
+        mode, param);
   }
   // save the output boxes num, computed by CPU
   VLOG(4) << "total_output_boxes_num:" << total_output_boxes_num;
@@ -720,22 +525,12 @@ int64_t NmsExecutor::getTheoryOps() {
     nms3D_detection_cpu(output_info, total_output_boxes_num, input_boxes,
                         input_boxes_num, iou_thresh, input_layout);
   } else {
-    for (int batch_idx = 0; batch_idx < input_batches_num; ++batch_idx) {
-      for (int class_idx = 0; class_idx < input_classes_num; ++class_idx) {
-        int boxes_offset = input_boxes_num * 4 * batch_idx;
-        int conf_offset = input_classes_num * input_boxes_num * batch_idx +
-                          input_boxes_num * class_idx;
-        int output_offset = mode == 3 ? 3 * total_output_boxes_num : 0;
-        int output_boxes_num = 0;
-        nms_detection_cpu((float *)output_info + output_offset,
-                          output_boxes_num, (float *)input_boxes + boxes_offset,
-                          (float *)input_conf + conf_offset, input_boxes_num,
-                          max_output_boxes, iou_thresh, confidence_threshold,
-                          mode, input_layout, algo, offset, box_mode,
-                          method_mode, soft_nms_sigma, batch_idx, class_idx);
-        total_output_boxes_num += output_boxes_num;
-      }
-    }
+    NmsParam param = {max_output_boxes, iou_thresh,  confidence_threshold,
+                      algo,             offset,      box_mode,
+                      method_mode,      soft_nms_sigma};
+    total_output_boxes_num = nmsDetectionCpu(
+        output_info, input_boxes, input_conf, input_batches_num,
+        input_classes_num, input_boxes_num, input_layout, mode, param);
   }
   cpu_runtime_.deallocate(output_info);
   cp_count *= total_output_boxes_num;
@@ -39,14 +39,6 @@ class NmsExecutor : public Executor {
                            float *input_data, int input_box_num,
                            float thresh_iou, int input_layout);
 
-  void nms_detection_cpu(float *output_data, int &output_box_num,
-                         float *input_data, float *input_score,
-                         int input_box_num, int keepNum, float thresh_iou,
-                         float thresh_score, mluOpNmsOutputMode_t output_mode,
-                         int input_layout, mluOpNmsAlgo_t algo, float offset,
-                         mluOpNmsBoxPointMode_t box_mode,
-                         mluOpNmsMethodMode_t method_mode, float soft_nms_sigma,
-                         int batch_idx, int class_idx);
   int64_t getTheoryOps() override;
 
  private:
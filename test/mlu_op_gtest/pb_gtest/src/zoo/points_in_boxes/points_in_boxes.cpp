@@ -21,55 +21,64 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *************************************************************************/
 #include "points_in_boxes.h"
+
+#include <vector>
+
 #include "mlu_op.h"
+#include "box_grid.h"
+#include "parallel_for.h"
 
 namespace mluoptest {
-
-static void lindar_to_local_coords_cpu(float shift_x, float shift_y,
-                                       float rot_angle, float &local_x,
-                                       float &local_y) {
-  float cosa = cos(-rot_angle), sina = sin(-rot_angle);
-  local_x = shift_x * cosa + shift_y * (-sina);
-  local_y = shift_x * sina + shift_y * cosa;
-}
+constexpr size_t kPointsInBoxesGrain = 1024;
 
 static int check_pt_in_box3d_cpu(const float *pt, const float *box3d,
+                                 const BoxGrid &grid, int64_t box_idx,
                                  float &local_x, float &local_y) {
   const float MARGIN = 1e-5;
   float x = pt[0], y = pt[1], z = pt[2];
-  float cx = box3d[0], cy = box3d[1], cz = box3d[2];
-  float dx = box3d[3], dy = box3d[4], dz = box3d[5], rz = box3d[6];
+  float cz = box3d[2];
+  float dx = box3d[3], dy = box3d[4], dz = box3d[5];
 
   if (fabsf(z - cz) > dz / 2.0) return 0;
-  lindar_to_local_coords_cpu(x - cx, y - cy, rz, local_x, local_y);
+  grid.localCoords(box_idx, x, y, &local_x, &local_y);
   float in_flag =
       (fabs(local_x) < dx / 2.0 + MARGIN) & (fabs(local_y) < dy / 2.0 + MARGIN);
   return in_flag;
 }
 
 static void points_in_boxes_cpu(
-    const mluOpTensorDescriptor_t points_desc, const void *points,
-    const mluOpTensorDescriptor_t boxes_desc, const void *boxes,
-    const mluOpTensorDescriptor_t points_indices_desc, void *points_indices) {
-  for (int64_t i = 0;
-       i < points_indices_desc->dims[0] * points_indices_desc->dims[1]; i++) {
-    *((float *)points_indices + i) = -1.0;
-  }
-  for (int64_t i = 0; i < points_desc->dims[0]; i++) {
-    for (int64_t j = 0; j < points_desc->dims[1]; j++) {
-      for (int64_t m = 0; m < boxes_desc->dims[1]; m++) {
-        float local_x, local_y;
-        int cur_in_flag = check_pt_in_box3d_cpu(
-            (float *)points + (i * points_desc->dims[1] + j) * 3,
-            (float *)boxes + (i * boxes_desc->dims[1] + m) * 7, local_x,
-            local_y);
-        if (cur_in_flag) {
-          *((float *)points_indices + i * points_desc->dims[1] + j) = (float)m;
-          break;
-        }
-      }
+    const mluOpTensorDescriptor_t points_desc, const float *points,
+    const mluOpTensorDescriptor_t boxes_desc, const float *boxes,
+    float *points_indices) {
+  const int64_t batch = points_desc->dims[0];
+  const int64_t pts_num = points_desc->dims[1];
+  const int64_t boxes_num = boxes_desc->dims[1];
+  std::vector<BoxGrid> grids(batch);
+  parallelForChunks(batch, 1, [&](size_t, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      grids[i].build(boxes + i * boxes_num * 7, boxes_num);
     }
-  }
+  });
+  // the first box containing a point wins, candidates come in box order.
+  parallelForChunks(
+      batch * pts_num, kPointsInBoxesGrain,
+      [&](size_t, size_t begin, size_t end) {
+        for (size_t p = begin; p < end; ++p) {
+          const int64_t i = p / pts_num;
+          const float *pt = points + p * 3;
+          const float *batch_boxes = boxes + i * boxes_num * 7;
+          points_indices[p] = -1.0;
+          grids[i].forEachCandidate(pt[0], pt[1], [&](int64_t m) {
+            float local_x, local_y;
+            if (check_pt_in_box3d_cpu(pt, batch_boxes + m * 7, grids[i], m,
+                                      local_x, local_y)) {
+              points_indices[p] = (float)m;
+              return true;
+            }
+            return false;
+          });
+        }
+      });
 }
 
 void PointsInBoxesExecutor::paramCheck() {
@@ -101,10 +110,8 @@ void PointsInBoxesExecutor::cpuCompute() {
   VLOG(4) << "PointsInBoxesExecutor::cpuCompute() Begin.";
   auto points_desc = tensor_desc_[0].tensor;
   auto boxes_desc = tensor_desc_[1].tensor;
-  auto points_indices_desc = tensor_desc_[2].tensor;
   points_in_boxes_cpu(points_desc, cpu_fp32_input_[0], boxes_desc,
-                      cpu_fp32_input_[1], points_indices_desc,
-                      cpu_fp32_output_[0]);
+                      cpu_fp32_input_[1], cpu_fp32_output_[0]);
   VLOG(4) << "PointsInBoxesExecutor::cpuCompute() End.";
 }
 
@@ -23,13 +23,15 @@
 
 #include "poly_nms.h"
 
+#include <algorithm>
+#include <numeric>
 #include <vector>
 
-#include "pnms_impl.h"
-
-using namespace PNMS;  // NOLINT
+#include "rotated_iou.h"
 
 namespace mluoptest {
+constexpr float kPolyNmsSkipApartThresh = 0.01f;
+
 void PolyNmsExecutor::paramCheck() {
   if (!parser_->getProtoNode()->has_poly_nms_param()) {
     LOG(ERROR) << "Lose poly_nms_param. ";
@@ -95,19 +97,34 @@ void PolyNmsExecutor::pnmsComputeCPU(float *output_data, int *output_box_num,
                                      const float *input_data,
                                      const int input_box_num,
                                      const float iou_thresh) {
-  vector<vector<float>> input_vvec;
-  for (int i = 0; i < input_box_num; i++) {
-    vector<float> tmp_vec;
-    for (int j = 0; j < 9; j++) {
-      tmp_vec.push_back(input_data[j + i * 9]);
+  // boxes are (x0, y0, ..., x3, y3, score), visited by decreasing score.
+  std::vector<int> order(input_box_num);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [input_data](int a, int b) {
+    return input_data[a * 9 + 8] > input_data[b * 9 + 8];
+  });
+
+  QuadPolygons polys(input_data, input_box_num, 9);
+  // the clipping leaves a little rounding noise for disjoint polygons, so
+  // they are only skipped when the threshold is well above it.
+  const bool skip_apart = iou_thresh >= kPolyNmsSkipApartThresh;
+  std::vector<int> keep;
+  auto kept = greedyNmsKeep(input_box_num, [&](int64_t a, int64_t b) {
+    const int i = order[a];
+    const int j = order[b];
+    if (skip_apart && polys.apart(i, j)) {
+      return false;
     }
-    input_vvec.push_back(tmp_vec);
+    return quadPolygonIou(polys, i, j) > iou_thresh;
+  });
+  for (auto k : kept) {
+    keep.push_back(order[k]);
   }
 
-  vector<int> pnms_ret = PolyNmsImpl(input_vvec, iou_thresh);
-  output_box_num[0] = pnms_ret.size();
-  for (int i = 0; i < pnms_ret.size(); i++) {
-    output_data[i] = pnms_ret[i];
+  std::sort(keep.begin(), keep.end());
+  output_box_num[0] = keep.size();
+  for (int i = 0; i < keep.size(); i++) {
+    output_data[i] = keep[i];
   }
 }
 
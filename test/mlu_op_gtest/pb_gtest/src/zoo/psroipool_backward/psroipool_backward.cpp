@@ -23,6 +23,9 @@
 #include "psroipool_backward.h"
 
 #include <algorithm>
+#include <atomic>
+
+#include "roi_sampler.h"
 
 namespace mluoptest {
 void PsroipoolBackwardExecutor::paramCheck() {
@@ -85,63 +88,79 @@ void PsroipoolBackwardExecutor::cpuCompute() {
   const int rois_n = rois_desc->dims[0];
   const int rois_offset = rois_desc->dims[1];
 
-  for (int roi_id = 0; roi_id < rois_n; roi_id++) {
-    int top_batch_offset =
-        roi_id * pooled_height_ * pooled_width_ * output_dim_;
-    int roi_add = roi_id * rois_offset;
-    int batch_i = rois_cpu[roi_add];
-    int bottom_add = batch_i * bottom_h * bottom_w * bottom_c;
-
-    float roi_start_w =
-        static_cast<float>(round(rois_cpu[roi_add + 1])) * spatial_scale_;
-    float roi_start_h =
-        static_cast<float>(round(rois_cpu[roi_add + 2])) * spatial_scale_;
-    float roi_end_w =
-        static_cast<float>(round(rois_cpu[roi_add + 3]) + 1.) * spatial_scale_;
-    float roi_end_h =
-        static_cast<float>(round(rois_cpu[roi_add + 4]) + 1.) * spatial_scale_;
-
-    float roi_width = std::max(roi_end_w - roi_start_w, (float)0.1);
-    float roi_height = std::max(roi_end_h - roi_start_h, (float)0.1);
-    float bin_size_h = (float)roi_height / (float)(pooled_height_);
-    float bin_size_w = (float)roi_width / (float)(pooled_width_);
-
-    for (int top_c = 0; top_c < output_dim_; top_c++) {
-      for (int top_h = 0; top_h < pooled_height_; top_h++) {
-        for (int top_w = 0; top_w < pooled_width_; top_w++) {
-          int top_index = top_batch_offset +
-                          top_h * pooled_width_ * output_dim_ +
-                          top_w * output_dim_ + top_c;
-          int hstart =
-              floor(static_cast<float>(top_h) * bin_size_h + roi_start_h);
-          int wstart =
-              floor(static_cast<float>(top_w) * bin_size_w + roi_start_w);
-          int hend =
-              ceil(static_cast<float>(top_h + 1) * bin_size_h + roi_start_h);
-          int wend =
-              ceil(static_cast<float>(top_w + 1) * bin_size_w + roi_start_w);
-
-          hstart = std::min(std::max(hstart, 0), bottom_h);
-          hend = std::min(std::max(hend, 0), bottom_h);
-          wstart = std::min(std::max(wstart, 0), bottom_w);
-          wend = std::min(std::max(wend, 0), bottom_w);
-
-          bool is_empty = (hend <= hstart) || (wend <= wstart);
-          int c = mapping_channel_cpu[top_index];
-          float bin_area = (hend - hstart) * (wend - wstart);
-          float diff_val = is_empty ? 0. : top_input_cpu[top_index] / bin_area;
-
-          for (int h = hstart; h < hend; ++h) {
-            for (int w = wstart; w < wend; ++w) {
-              int bottom_index = h * bottom_w * bottom_c + w * bottom_c + c;
-              bottom_output_cpu[bottom_index + bottom_add] += diff_val;
-              theory_ops_ += 7;
+  // Slices of bottom_output are scattered in parallel, see roiScatterSlices;
+  // a slice takes the top elements mapped to one of its channels.
+  std::atomic<int64_t> ops_sum(0);
+  auto scatter_slice = [&](int image, int c_begin, int c_end) {
+    int64_t ops = 0;
+    for (int roi_id = 0; roi_id < rois_n; roi_id++) {
+      int roi_add = roi_id * rois_offset;
+      int batch_i = rois_cpu[roi_add];
+      if (batch_i != image) {
+        continue;
+      }
+      int top_batch_offset =
+          roi_id * pooled_height_ * pooled_width_ * output_dim_;
+      int bottom_add = batch_i * bottom_h * bottom_w * bottom_c;
+
+      float roi_start_w =
+          static_cast<float>(round(rois_cpu[roi_add + 1])) * spatial_scale_;
+      float roi_start_h =
+          static_cast<float>(round(rois_cpu[roi_add + 2])) * spatial_scale_;
+      float roi_end_w = static_cast<float>(round(rois_cpu[roi_add + 3]) + 1.) *
+                        spatial_scale_;
+      float roi_end_h = static_cast<float>(round(rois_cpu[roi_add + 4]) + 1.) *
+                        spatial_scale_;
+
+      float roi_width = std::max(roi_end_w - roi_start_w, (float)0.1);
+      float roi_height = std::max(roi_end_h - roi_start_h, (float)0.1);
+      float bin_size_h = (float)roi_height / (float)(pooled_height_);
+      float bin_size_w = (float)roi_width / (float)(pooled_width_);
+
+      for (int top_c = 0; top_c < output_dim_; top_c++) {
+        for (int top_h = 0; top_h < pooled_height_; top_h++) {
+          for (int top_w = 0; top_w < pooled_width_; top_w++) {
+            int top_index = top_batch_offset +
+                            top_h * pooled_width_ * output_dim_ +
+                            top_w * output_dim_ + top_c;
+            int c = mapping_channel_cpu[top_index];
+            if (c < c_begin || c >= c_end) {
+              continue;
+            }
+            int hstart =
+                floor(static_cast<float>(top_h) * bin_size_h + roi_start_h);
+            int wstart =
+                floor(static_cast<float>(top_w) * bin_size_w + roi_start_w);
+            int hend =
+                ceil(static_cast<float>(top_h + 1) * bin_size_h + roi_start_h);
+            int wend =
+                ceil(static_cast<float>(top_w + 1) * bin_size_w + roi_start_w);
+
+            hstart = std::min(std::max(hstart, 0), bottom_h);
+            hend = std::min(std::max(hend, 0), bottom_h);
+            wstart = std::min(std::max(wstart, 0), bottom_w);
+            wend = std::min(std::max(wend, 0), bottom_w);
+
+            bool is_empty = (hend <= hstart) || (wend <= wstart);
+            float bin_area = (hend - hstart) * (wend - wstart);
+            float diff_val =
+                is_empty ? 0. : top_input_cpu[top_index] / bin_area;
+
+            for (int h = hstart; h < hend; ++h) {
+              for (int w = wstart; w < wend; ++w) {
+                int bottom_index = h * bottom_w * bottom_c + w * bottom_c + c;
+                bottom_output_cpu[bottom_index + bottom_add] += diff_val;
+                ops += 7;
+              }
             }
           }
         }
       }
     }
-  }
+    ops_sum += ops;
+  };
+  roiScatterSlices(bottom_n, bottom_c, scatter_slice);
+  theory_ops_ += ops_sum;
 }
 
 int64_t PsroipoolBackwardExecutor::getTheoryOps() {
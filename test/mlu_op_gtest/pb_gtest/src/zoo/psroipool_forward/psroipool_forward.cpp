@@ -27,6 +27,7 @@
 #include <vector>
 
 #include "mlu_op.h"
+#include "parallel_for.h"
 
 namespace mluoptest {
 void PsroipoolForwardExecutor::paramCheck() {
@@ -103,70 +104,79 @@ void PsroipoolForwardExecutor::cpuCompute() {
   const int rois_n = rois_desc->dims[0];
   const int rois_offset = rois_desc->dims[1];
 
-  for (int roi_id = 0; roi_id < rois_n; roi_id++) {
-    int out_batch_offset =
-        roi_id * output_dim_ * pooled_height_ * pooled_width_;
-    int roi_add = roi_id * rois_offset;
-    int batch_i = rois_cpu[roi_add];
-    int input_add = batch_i * input_h * input_w * input_c;
-
-    float roi_start_w =
-        static_cast<float>(round(rois_cpu[roi_add + 1])) * spatial_scale_;
-    float roi_start_h =
-        static_cast<float>(round(rois_cpu[roi_add + 2])) * spatial_scale_;
-    float roi_end_w =
-        static_cast<float>(round(rois_cpu[roi_add + 3]) + 1.) * spatial_scale_;
-    float roi_end_h =
-        static_cast<float>(round(rois_cpu[roi_add + 4]) + 1.) * spatial_scale_;
-
-    float roi_width = std::max(roi_end_w - roi_start_w, (float)0.1);
-    float roi_height = std::max(roi_end_h - roi_start_h, (float)0.1);
-    float bin_size_h = (float)roi_height / (float)(pooled_height_);
-    float bin_size_w = (float)roi_width / (float)(pooled_width_);
-
-    for (int out_c = 0; out_c < output_dim_; out_c++) {
-      for (int out_h = 0; out_h < pooled_height_; out_h++) {
-        for (int out_w = 0; out_w < pooled_width_; out_w++) {
-          int out_index = out_batch_offset +
-                          out_h * pooled_width_ * output_dim_ +
-                          out_w * output_dim_ + out_c;
-          int hstart =
-              floor(static_cast<float>(out_h) * bin_size_h + roi_start_h);
-          int wstart =
-              floor(static_cast<float>(out_w) * bin_size_w + roi_start_w);
-          int hend =
-              ceil(static_cast<float>(out_h + 1) * bin_size_h + roi_start_h);
-          int wend =
-              ceil(static_cast<float>(out_w + 1) * bin_size_w + roi_start_w);
-
-          hstart = std::min(std::max(hstart, 0), input_h);
-          hend = std::min(std::max(hend, 0), input_h);
-          wstart = std::min(std::max(wstart, 0), input_w);
-          wend = std::min(std::max(wend, 0), input_w);
-
-          bool is_empty = (hend <= hstart) || (wend <= wstart);
-          int gw = out_w;
-          int gh = out_h;
-          int c = out_c * group_size_ * group_size_ + gh * group_size_ + gw;
-          float out_sum = 0;
-          for (int h = hstart; h < hend; ++h) {
-            for (int w = wstart; w < wend; ++w) {
-              int bottom_index = h * input_w * input_c + w * input_c + c;
-              out_sum += input_cpu[bottom_index + input_add];
-              theory_ops_ += 7;
+  // RoIs write disjoint outputs and run in parallel, each counts its ops.
+  std::vector<int64_t> roi_ops(rois_n, 0);
+  auto pool_rois = [&](size_t, size_t begin, size_t end) {
+    for (size_t roi_id = begin; roi_id < end; roi_id++) {
+      int64_t &ops = roi_ops[roi_id];
+      int out_batch_offset =
+          roi_id * output_dim_ * pooled_height_ * pooled_width_;
+      int roi_add = roi_id * rois_offset;
+      int batch_i = rois_cpu[roi_add];
+      int input_add = batch_i * input_h * input_w * input_c;
+
+      float roi_start_w =
+          static_cast<float>(round(rois_cpu[roi_add + 1])) * spatial_scale_;
+      float roi_start_h =
+          static_cast<float>(round(rois_cpu[roi_add + 2])) * spatial_scale_;
+      float roi_end_w = static_cast<float>(round(rois_cpu[roi_add + 3]) + 1.) *
+                        spatial_scale_;
+      float roi_end_h = static_cast<float>(round(rois_cpu[roi_add + 4]) + 1.) *
+                        spatial_scale_;
+
+      float roi_width = std::max(roi_end_w - roi_start_w, (float)0.1);
+      float roi_height = std::max(roi_end_h - roi_start_h, (float)0.1);
+      float bin_size_h = (float)roi_height / (float)(pooled_height_);
+      float bin_size_w = (float)roi_width / (float)(pooled_width_);
+
+      for (int out_c = 0; out_c < output_dim_; out_c++) {
+        for (int out_h = 0; out_h < pooled_height_; out_h++) {
+          for (int out_w = 0; out_w < pooled_width_; out_w++) {
+            int out_index = out_batch_offset +
+                            out_h * pooled_width_ * output_dim_ +
+                            out_w * output_dim_ + out_c;
+            int hstart =
+                floor(static_cast<float>(out_h) * bin_size_h + roi_start_h);
+            int wstart =
+                floor(static_cast<float>(out_w) * bin_size_w + roi_start_w);
+            int hend =
+                ceil(static_cast<float>(out_h + 1) * bin_size_h + roi_start_h);
+            int wend =
+                ceil(static_cast<float>(out_w + 1) * bin_size_w + roi_start_w);
+
+            hstart = std::min(std::max(hstart, 0), input_h);
+            hend = std::min(std::max(hend, 0), input_h);
+            wstart = std::min(std::max(wstart, 0), input_w);
+            wend = std::min(std::max(wend, 0), input_w);
+
+            bool is_empty = (hend <= hstart) || (wend <= wstart);
+            int gw = out_w;
+            int gh = out_h;
+            int c = out_c * group_size_ * group_size_ + gh * group_size_ + gw;
+            float out_sum = 0;
+            for (int h = hstart; h < hend; ++h) {
+              for (int w = wstart; w < wend; ++w) {
+                int bottom_index = h * input_w * input_c + w * input_c + c;
+                out_sum += input_cpu[bottom_index + input_add];
+                ops += 7;
+              }
             }
+            float bin_area = (hend - hstart) * (wend - wstart);
+            if (is_empty) {
+              output_cpu[out_index] = 0;
+            } else {
+              output_cpu[out_index] = out_sum / bin_area;
+              ops += 1;
+            }
+            mapping_channel_cpu[out_index] = c;
           }
-          float bin_area = (hend - hstart) * (wend - wstart);
-          if (is_empty) {
-            output_cpu[out_index] = 0;
-          } else {
-            output_cpu[out_index] = out_sum / bin_area;
-            theory_ops_ += 1;
-          }
-          mapping_channel_cpu[out_index] = c;
         }
       }
     }
+  };
+  parallelForChunks(rois_n, 1, pool_rois);
+  for (int64_t ops : roi_ops) {
+    theory_ops_ += ops;
   }
 }
 
@@ -26,6 +26,8 @@
 #include <iostream>
 #include <vector>
 
+#include "roi_sampler.h"
+
 namespace mluoptest {
 
 void RoiAlignBackwardExecutor::paramCheck() {
@@ -114,38 +116,6 @@ void RoiAlignBackwardExecutor::compute() {
   interface_timer_.stop();
 }
 
-void RoiAlignBackwardExecutor::bilinear_interpolate_gradient(
-    const int height, const int width, float y, float x, float &w1, float &w2,
-    float &w3, float &w4, int &x_low, int &x_high, int &y_low, int &y_high) {
-  if (y < -1.0 || y > height || x < -1.0 || x > width) {
-    w1 = w2 = w3 = w4 = 0.0;
-    x_low = x_high = y_low = y_high = -1;
-    return;
-  }
-
-  if (y <= 0) y = 0;
-  if (x <= 0) x = 0;
-  y_low = (int)y;
-  x_low = (int)x;
-  if (y_low >= height - 1) {
-    y_high = y_low = height - 1;
-    y = (float)y_low;
-  } else {
-    y_high = y_low + 1;
-  }
-  if (x_low >= width - 1) {
-    x_high = x_low = width - 1;
-    x = (float)x_low;
-  } else {
-    x_high = x_low + 1;
-  }
-
-  float ly = y - y_low, lx = x - x_low;
-  float hy = 1. - ly, hx = 1. - lx;
-  w1 = hy * hx, w2 = hy * lx, w3 = ly * hx, w4 = ly * lx;
-  return;
-}
-
 void RoiAlignBackwardExecutor::cpuCompute() {
   auto input = parser_->getMetaTensor(0).cpu_ptr;
   auto boxes = parser_->getMetaTensor(1).cpu_ptr;
@@ -168,6 +138,8 @@ void RoiAlignBackwardExecutor::cpuCompute() {
   auto output = parser_->getMetaTensor(2).cpu_ptr;
   auto output_desc = parser_->getMetaTensor(2).tensor;
 
+  // Gradients are scattered by roiScatterSlices: a task owns the channels
+  // [c_begin, c_end) of one image and walks the boxes of that image in order.
   if (pool_mode == 1) {
     int output_n = output_desc->dims[0];
     int output_h = output_desc->dims[1];
@@ -176,75 +148,57 @@ void RoiAlignBackwardExecutor::cpuCompute() {
 
     std::memset(output, 0.0, parser_->getMetaTensor(2).size_in_bytes);
     size_t output_offset_n = output_h * output_w * output_c;
-    size_t output_offset_h = output_w * output_c;
-
-    for (int idx_n = 0; idx_n < input_n; idx_n++) {
-      // check whether box_idx is valid
-      int32_t curr_idx = (int32_t)boxes[idx_n * 5];
-      if (curr_idx < 0 || curr_idx >= output_n) {
-        continue;
-      }
-      int output_offset = curr_idx * output_offset_n;
-
-      float offset = aligned ? 0.5 : 0;
-      float x1 = boxes[idx_n * 5 + 1] * spatial_scale - offset;
-      float y1 = boxes[idx_n * 5 + 2] * spatial_scale - offset;
-      float x2 = boxes[idx_n * 5 + 3] * spatial_scale - offset;
-      float y2 = boxes[idx_n * 5 + 4] * spatial_scale - offset;
-      float roi_width = x2 - x1;
-      float roi_height = y2 - y1;
-      if (!aligned) {
-        roi_width = std::max(roi_width, (float)1.0);
-        roi_height = std::max(roi_height, (float)1.0);
-      }
 
-      float bin_size_h = roi_height / input_h;
-      float bin_size_w = roi_width / input_w;
-      int roi_bin_grid_h =
-          (sampling_ratio > 0) ? sampling_ratio : ceil(roi_height / input_h);
-      int roi_bin_grid_w =
-          (sampling_ratio > 0) ? sampling_ratio : ceil(roi_width / input_w);
-      const float count = roi_bin_grid_h * roi_bin_grid_w;
-
-      for (int ih = 0; ih < input_h; ++ih) {
-        for (int iw = 0; iw < input_w; ++iw) {
-          for (int ic = 0; ic < input_c; ++ic) {
-            float input_this_bin =
-                input[idx_n * input_offset_n + ih * input_offset_h +
-                      iw * input_c + ic];
+    auto scatter_slice = [&](int curr_idx, int c_begin, int c_end) {
+      BilinearTap tap;
+      float *output_image = output + curr_idx * output_offset_n + c_begin;
+      for (int idx_n = 0; idx_n < input_n; idx_n++) {
+        // boxes out of range of output_n belong to no slice
+        if ((int32_t)boxes[idx_n * 5] != curr_idx) {
+          continue;
+        }
+
+        float offset = aligned ? 0.5 : 0;
+        float x1 = boxes[idx_n * 5 + 1] * spatial_scale - offset;
+        float y1 = boxes[idx_n * 5 + 2] * spatial_scale - offset;
+        float x2 = boxes[idx_n * 5 + 3] * spatial_scale - offset;
+        float y2 = boxes[idx_n * 5 + 4] * spatial_scale - offset;
+        float roi_width = x2 - x1;
+        float roi_height = y2 - y1;
+        if (!aligned) {
+          roi_width = std::max(roi_width, (float)1.0);
+          roi_height = std::max(roi_height, (float)1.0);
+        }
+
+        float bin_size_h = roi_height / input_h;
+        float bin_size_w = roi_width / input_w;
+        int roi_bin_grid_h =
+            (sampling_ratio > 0) ? sampling_ratio : ceil(roi_height / input_h);
+        int roi_bin_grid_w =
+            (sampling_ratio > 0) ? sampling_ratio : ceil(roi_width / input_w);
+        const float count = roi_bin_grid_h * roi_bin_grid_w;
+
+        for (int ih = 0; ih < input_h; ++ih) {
+          for (int iw = 0; iw < input_w; ++iw) {
+            const float *input_this_bin = input + idx_n * input_offset_n +
+                                          ih * input_offset_h + iw * input_c +
+                                          c_begin;
             for (int iy = 0; iy < roi_bin_grid_h; ++iy) {
               const float y = y1 + ih * bin_size_h +
                               (iy + .5) * bin_size_h / (float)roi_bin_grid_h;
               for (int ix = 0; ix < roi_bin_grid_w; ++ix) {
                 const float x = x1 + iw * bin_size_w +
                                 (ix + .5) * bin_size_w / (float)roi_bin_grid_w;
-
-                float w1, w2, w3, w4;
-                int x_low, x_high, y_low, y_high;
-                bilinear_interpolate_gradient(output_h, output_w, y, x, w1, w2,
-                                              w3, w4, x_low, x_high, y_low,
-                                              y_high);
-                float g1 = input_this_bin * w1 / count;
-                float g2 = input_this_bin * w2 / count;
-                float g3 = input_this_bin * w3 / count;
-                float g4 = input_this_bin * w4 / count;
-
-                if (x_low >= 0 && x_high >= 0 && y_low >= 0 && y_high >= 0) {
-                  output[output_offset + y_low * output_offset_h +
-                         x_low * output_c + ic] += g1;
-                  output[output_offset + y_low * output_offset_h +
-                         x_high * output_c + ic] += g2;
-                  output[output_offset + y_high * output_offset_h +
-                         x_low * output_c + ic] += g3;
-                  output[output_offset + y_high * output_offset_h +
-                         x_high * output_c + ic] += g4;
-                }
+                makeBilinearTap(output_h, output_w, y, x, output_c, &tap);
+                bilinearScatter(tap, input_this_bin, count, c_end - c_begin,
+                                output_image);
               }  // for ix
             }    // for iy
-          }      // for ic
-        }        // for iw
-      }          // for ih
-    }            // for idx_n
+          }      // for iw
+        }        // for ih
+      }          // for idx_n
+    };
+    roiScatterSlices(output_n, output_c, scatter_slice);
   } else if (pool_mode == 0) {
     auto argmax_x = parser_->getMetaTensor(2).cpu_ptr;
     auto argmax_x_desc = parser_->getMetaTensor(2).tensor;
@@ -259,7 +213,6 @@ void RoiAlignBackwardExecutor::cpuCompute() {
     size_t output_c = output_desc->dims[3];
 
     size_t output_offset_n = output_h * output_w * output_c;
-    size_t output_offset_h = output_w * output_c;
 
     // set zeros to all elements of output
     std::memset(output, 0.0, parser_->getMetaTensor(4).size_in_bytes);
@@ -270,44 +223,35 @@ void RoiAlignBackwardExecutor::cpuCompute() {
       if (curr_idx < 0 || curr_idx >= output_n) {
         LOG(ERROR)
             << "mluOpRoiAlignBackward: boxes_id is out range of output_n.";
-        continue;
       }
-      int output_offset = curr_idx * output_offset_n;
-
-      for (int ih = 0; ih < input_h; ++ih) {
-        for (int iw = 0; iw < input_w; ++iw) {
-          for (int ic = 0; ic < input_c; ++ic) {
-            int index = idx_n * input_offset_n + ih * input_offset_h +
-                        iw * input_c + ic;
-            float input_this_bin = input[index];
-            const float y = argmax_y[index];
-            const float x = argmax_x[index];
-            if (y != -1.f) {
-              float w1, w2, w3, w4;
-              int x_low, x_high, y_low, y_high;
-              bilinear_interpolate_gradient(output_h, output_w, y, x, w1, w2,
-                                            w3, w4, x_low, x_high, y_low,
-                                            y_high);
-              if (x_low >= 0 && x_high >= 0 && y_low >= 0 && y_high >= 0) {
-                float g1 = input_this_bin * w1;
-                float g2 = input_this_bin * w2;
-                float g3 = input_this_bin * w3;
-                float g4 = input_this_bin * w4;
-
-                output[output_offset + y_low * output_offset_h +
-                       x_low * output_c + ic] += g1;
-                output[output_offset + y_low * output_offset_h +
-                       x_high * output_c + ic] += g2;
-                output[output_offset + y_high * output_offset_h +
-                       x_low * output_c + ic] += g3;
-                output[output_offset + y_high * output_offset_h +
-                       x_high * output_c + ic] += g4;
-              }  // if x_low, x_high, y_low, y_high
-            }    // if y
-          }      // for ic
-        }        // for iw
-      }          // for ih
-    }            // for idx_n
+    }
+
+    // every channel has its own argmax, so a tap serves one channel here.
+    auto scatter_slice = [&](int curr_idx, int c_begin, int c_end) {
+      BilinearTap tap;
+      float *output_image = output + curr_idx * output_offset_n;
+      for (int idx_n = 0; idx_n < input_n; idx_n++) {
+        if ((int)boxes[idx_n * 5] != curr_idx) {
+          continue;
+        }
+        for (int ih = 0; ih < input_h; ++ih) {
+          for (int iw = 0; iw < input_w; ++iw) {
+            for (int ic = c_begin; ic < c_end; ++ic) {
+              int index = idx_n * input_offset_n + ih * input_offset_h +
+                          iw * input_c + ic;
+              const float y = argmax_y[index];
+              const float x = argmax_x[index];
+              if (y != -1.f) {
+                makeBilinearTap(output_h, output_w, y, x, output_c, &tap);
+                bilinearScatter(tap, input + index, 1.0f, 1,
+                                output_image + ic);
+              }  // if y
+            }    // for ic
+          }      // for iw
+        }        // for ih
+      }          // for idx_n
+    };
+    roiScatterSlices(output_n, output_c, scatter_slice);
   }              // if pool_mode
   return;
 }  // cpuCompute()
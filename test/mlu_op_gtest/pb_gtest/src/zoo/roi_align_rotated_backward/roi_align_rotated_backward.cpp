@@ -24,87 +24,11 @@
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
-namespace mluoptest {
-
-void RoiAlignRotatedBackwardExecutor::preCalcForBilinearInterpolate(
-    const int height, const int width, const int channel,
-    const int pooled_height, const int pooled_width, const int roi_bin_grid_h,
-    const int roi_bin_grid_w, const float roi_start_x, const float roi_start_y,
-    const float bin_size_h, const float bin_size_w, const float roi_center_x,
-    const float roi_center_y, const float cos_theta, const float sin_theta,
-    std::vector<PreCalc> &pre_calc) {
-  int pre_calc_idx = 0;
-  for (int ph = 0; ph < pooled_height; ++ph) {
-    for (int pw = 0; pw < pooled_width; ++pw) {
-      for (int iy = 0; iy < roi_bin_grid_h; ++iy) {
-        const float yy = roi_start_y + ph * bin_size_h +
-                         static_cast<float>(iy + 0.5) * bin_size_h /
-                             static_cast<float>(roi_bin_grid_h);
-        theory_ops_ += 8;  // cur block
-        for (int ix = 0; ix < roi_bin_grid_w; ++ix) {
-          const float xx = roi_start_x + pw * bin_size_w +
-                           static_cast<float>(ix + 0.5) * bin_size_w /
-                               static_cast<float>(roi_bin_grid_w);
-          float y = yy * cos_theta - xx * sin_theta + roi_center_y;
-          float x = yy * sin_theta + xx * cos_theta + roi_center_x;
-          theory_ops_ += 16;  // cur block
-
-          if (y < -1.0 || y > height || x < -1.0 || x > width) {
-            PreCalc pc{0, 0, 0, 0, 0, 0, 0, 0};
-            pre_calc[pre_calc_idx] = pc;
-            ++pre_calc_idx;
-            continue;
-          }
-
-          if (y < 0) y = 0;
-          if (x < 0) x = 0;
-
-          int y_low = (int)y;
-          int x_low = (int)x;
-          int y_high, x_high;
-          theory_ops_ += 2;  // cur block
+#include "roi_sampler.h"
 
-          if (y_low >= height - 1) {
-            y_high = y_low = height - 1;
-            y = (float)y_low;
-            theory_ops_ += 2;  // cur block
-          } else {
-            y_high = y_low + 1;
-            theory_ops_ += 1;  // cur block
-          }
-          if (x_low >= width - 1) {
-            x_high = x_low = width - 1;
-            x = (float)x_low;
-            theory_ops_ += 2;  // cur block
-          } else {
-            x_high = x_low + 1;
-            theory_ops_ += 1;  // cur block
-          }
-
-          float ly = y - y_low;
-          float lx = x - x_low;
-          float hy = 1. - ly, hx = 1. - lx;
-          float w1 = hy * hx, w2 = hy * lx, w3 = ly * hx, w4 = ly * lx;
-
-          PreCalc pc;
-          pc.pos1 = (y_low * width + x_low) * channel;
-          pc.pos2 = (y_low * width + x_high) * channel;
-          pc.pos3 = (y_high * width + x_low) * channel;
-          pc.pos4 = (y_high * width + x_high) * channel;
-          pc.w1 = w1;
-          pc.w2 = w2;
-          pc.w3 = w3;
-          pc.w4 = w4;
-          pre_calc[pre_calc_idx] = pc;
-          // next stmt not count theory_ops_
-          ++pre_calc_idx;
-          theory_ops_ += 20;  // cur block
-        }
-      }
-    }
-  }
-}
+namespace mluoptest {
 
 void RoiAlignRotatedBackwardExecutor::paramCheck() {
   if (!parser_->getProtoNode()->has_roi_align_rotated_backward_param()) {
@@ -201,93 +125,91 @@ void RoiAlignRotatedBackwardExecutor::cpuCompute() {
     return;
   }
 
-  for (int n_idx = 0; n_idx < rois_nums; ++n_idx) {
-    // not count theory_ops_ begin
-    const int top_grad_noffset = pooled_height * pooled_width * channel;
-
-    const float *current_roi = rois + n_idx * ROI_OFFSET;
-    // not count theory_ops_ end
-    const int roi_batch_idx = (int)current_roi[0];
-
-    const float offset = aligned ? 0.5 : 0.0;
-    const float roi_center_x = current_roi[1] * spatial_scale - offset;
-    const float roi_center_y = current_roi[2] * spatial_scale - offset;
-    float roi_width = current_roi[3] * spatial_scale;
-    float roi_height = current_roi[4] * spatial_scale;
-    float theta = current_roi[5];
-    theory_ops_ += 7;  // cur block
-    if (clockwise) {
-      theta = -theta;
-      theory_ops_ += 1;  // cur block
-    }
-    const float cos_theta = cos(theta);
-    const float sin_theta = sin(theta);
-    theory_ops_ += 2;  // cur block
+  // Slices of bottom_grad are scattered in parallel, see roiScatterSlices.
+  // The slice holding channel 0 of an image counts the ops of its RoIs.
+  std::vector<int64_t> roi_ops(rois_nums, 0);
+  auto scatter_slice = [&](int image, int c_begin, int c_end) {
+    std::vector<BilinearTap> pre_calc;
+    int64_t unused_ops = 0;
+    for (int n_idx = 0; n_idx < rois_nums; ++n_idx) {
+      const float *current_roi = rois + n_idx * ROI_OFFSET;
+      const int roi_batch_idx = (int)current_roi[0];
+      if (roi_batch_idx != image) {
+        continue;
+      }
+      int64_t &ops = c_begin == 0 ? roi_ops[n_idx] : unused_ops;
+      const int top_grad_noffset = pooled_height * pooled_width * channel;
 
-    if (aligned) {
-      if (roi_width < 0 || roi_height < 0) {
-        VLOG(4) << "ROIs do not have non-negative value.";
-        throw std::invalid_argument(std::string(__FILE__) + " +" +
-                                    std::to_string(__LINE__));
+      const float offset = aligned ? 0.5 : 0.0;
+      const float roi_center_x = current_roi[1] * spatial_scale - offset;
+      const float roi_center_y = current_roi[2] * spatial_scale - offset;
+      float roi_width = current_roi[3] * spatial_scale;
+      float roi_height = current_roi[4] * spatial_scale;
+      float theta = current_roi[5];
+      ops += 7;  // cur block
+      if (clockwise) {
+        theta = -theta;
+        ops += 1;  // cur block
       }
-    } else {
-      roi_width = std::max(roi_width, (float)1.0);
-      roi_height = std::max(roi_height, (float)1.0);
-      theory_ops_ += 4;  // cur block
-    }
+      const float cos_theta = cos(theta);
+      const float sin_theta = sin(theta);
+      ops += 2;  // cur block
 
-    const float bin_size_h = roi_height / static_cast<float>(pooled_height);
-    const float bin_size_w = roi_width / static_cast<float>(pooled_width);
-    int roi_bin_grid_h =
-        (sample_ratio > 0) ? sample_ratio : ceilf(roi_height / pooled_height);
-    int roi_bin_grid_w =
-        (sample_ratio > 0) ? sample_ratio : ceilf(roi_width / pooled_width);
-    const float count = std::max(roi_bin_grid_h * roi_bin_grid_w, 1);
-    std::vector<PreCalc> pre_calc(pooled_height * pooled_width * count);
-    const float roi_start_x = -roi_width / 2.0;
-    const float roi_start_y = -roi_height / 2.0;
+      if (aligned) {
+        if (roi_width < 0 || roi_height < 0) {
+          VLOG(4) << "ROIs do not have non-negative value.";
+          throw std::invalid_argument(std::string(__FILE__) + " +" +
+                                      std::to_string(__LINE__));
+        }
+      } else {
+        roi_width = std::max(roi_width, (float)1.0);
+        roi_height = std::max(roi_height, (float)1.0);
+        ops += 4;  // cur block
+      }
 
-    preCalcForBilinearInterpolate(
-        height, width, channel, pooled_height, pooled_width, roi_bin_grid_h,
-        roi_bin_grid_w, roi_start_x, roi_start_y, bin_size_h, bin_size_w,
-        roi_center_x, roi_center_y, cos_theta, sin_theta, pre_calc);
-    theory_ops_ += 14;  // cur block
+      const float bin_size_h = roi_height / static_cast<float>(pooled_height);
+      const float bin_size_w = roi_width / static_cast<float>(pooled_width);
+      int roi_bin_grid_h =
+          (sample_ratio > 0) ? sample_ratio : ceilf(roi_height / pooled_height);
+      int roi_bin_grid_w =
+          (sample_ratio > 0) ? sample_ratio : ceilf(roi_width / pooled_width);
+      const float count = std::max(roi_bin_grid_h * roi_bin_grid_w, 1);
+      const float roi_start_x = -roi_width / 2.0;
+      const float roi_start_y = -roi_height / 2.0;
 
-    for (int c_idx = 0; c_idx < channel; ++c_idx) {
-      // next stmt not count theory_ops_
-      int bottom_grad_offset = roi_batch_idx * height * width * channel +
-      c_idx;
-      int pre_calc_idx = 0;
+      rotatedRoiTaps(height, width, channel, pooled_height, pooled_width,
+                     roi_bin_grid_h, roi_bin_grid_w, roi_start_x, roi_start_y,
+                     bin_size_h, bin_size_w, roi_center_x, roi_center_y,
+                     cos_theta, sin_theta, &pre_calc, &ops);
+      ops += 14;  // cur block
 
+      float *bottom_grad_slice =
+          bottom_grad + (int64_t)roi_batch_idx * height * width * channel +
+          c_begin;
+      const int samples = roi_bin_grid_h * roi_bin_grid_w;
+      int64_t taken = 0;
       // loop for each bin
-      for (int ph = 0; ph < pooled_height; ++ph) {
-        for (int pw = 0; pw < pooled_width; ++pw) {
-          // next stmt not count theory_ops_
-          int top_grad_offset = n_idx * top_grad_noffset +
-                                (ph * pooled_width + pw) * channel + c_idx;
-          float top_grad_val = top_grad[top_grad_offset];
-          for (int iy = 0; iy < roi_bin_grid_h; ++iy) {
-            for (int ix = 0; ix < roi_bin_grid_w; ++ix) {
-              PreCalc pc = pre_calc[pre_calc_idx];
-              float g1 = pc.w1 * top_grad_val / count;
-              float g2 = pc.w2 * top_grad_val / count;
-              float g3 = pc.w3 * top_grad_val / count;
-              float g4 = pc.w4 * top_grad_val / count;
-              theory_ops_ += 8;  // cur block
-              if (!(pc.w1 == 0 && pc.w2 == 0 && pc.w3 == 0 && pc.w4 == 0)) {
-                bottom_grad[bottom_grad_offset + pc.pos1] += g1;
-                bottom_grad[bottom_grad_offset + pc.pos2] += g2;
-                bottom_grad[bottom_grad_offset + pc.pos3] += g3;
-                bottom_grad[bottom_grad_offset + pc.pos4] += g4;
-                theory_ops_ += 8;  // cur block
-              }
-              // next stmt not count theory_ops_
-              ++pre_calc_idx;
-            }
+      for (int bin = 0; bin < pooled_height * pooled_width; ++bin) {
+        const float *top_grad_val = top_grad +
+                                    (int64_t)n_idx * top_grad_noffset +
+                                    (int64_t)bin * channel + c_begin;
+        for (int i = 0; i < samples; ++i) {
+          const BilinearTap &pc = pre_calc[bin * samples + i];
+          if (pc.mask != 0) {
+            bilinearScatter(pc, top_grad_val, count, c_end - c_begin,
+                            bottom_grad_slice);
+            ++taken;
           }
         }
       }
+      // 8 ops per sample and 8 more per taken one, for every channel
+      ops += channel * (8 * (int64_t)pooled_height * pooled_width * samples +
+                        8 * taken);
     }
+  };
+  roiScatterSlices(batch, channel, scatter_slice);
+  for (int64_t ops : roi_ops) {
+    theory_ops_ += ops;
   }
 }
 
@@ -25,9 +25,6 @@ ROIALIGNROTATED_FORWARD_H_
 #define TEST_MLU_OP_GTEST_SRC_ZOO_ROIALIGNROTATED_BACKWARD_\
 ROIALIGNROTATED_FORWARD_H_
 
-#include <vector>
-
-#include "test/mlu_op_gtest/pb_gtest/src/zoo/roi_align_rotated_forward/roi_align_rotated_forward.h"
 #include "executor.h"
 
 #define ROI_OFFSET 6
@@ -44,14 +41,6 @@ class RoiAlignRotatedBackwardExecutor : public Executor {
   int64_t getTheoryOps() override;
 
  private:
-  void preCalcForBilinearInterpolate(
-      const int height, const int width, const int channel,
-      const int pooled_height, const int pooled_width, const int roi_bin_grid_h,
-      const int roi_bin_grid_w, const float roi_start_x,
-      const float roi_start_y, const float bin_size_h, const float bin_size_w,
-      const float roi_center_x, const float roi_center_y, const float cos_theta,
-      const float sin_theta, std::vector<PreCalc> &pre_calc);
-
   int64_t theory_ops_ = 0;
 };
 
@@ -24,87 +24,12 @@
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
-namespace mluoptest {
-
-void RoiAlignRotatedForwardExecutor::preCalcForBilinearInterpolate(
-    const int height, const int width, const int channel,
-    const int pooled_height, const int pooled_width, const int roi_bin_grid_h,
-    const int roi_bin_grid_w, const float roi_start_x, const float roi_start_y,
-    const float bin_size_h, const float bin_size_w, const float roi_center_x,
-    const float roi_center_y, const float cos_theta, const float sin_theta,
-    std::vector<PreCalc> &pre_calc) {
-  int pre_calc_idx = 0;
-  for (int ph = 0; ph < pooled_height; ++ph) {
-    for (int pw = 0; pw < pooled_width; ++pw) {
-      for (int iy = 0; iy < roi_bin_grid_h; ++iy) {
-        const float yy = roi_start_y + ph * bin_size_h +
-                         static_cast<float>(iy + 0.5) * bin_size_h /
-                             static_cast<float>(roi_bin_grid_h);
-        theory_ops_ += 8;  // cur block
-        for (int ix = 0; ix < roi_bin_grid_w; ++ix) {
-          const float xx = roi_start_x + pw * bin_size_w +
-                           static_cast<float>(ix + 0.5) * bin_size_w /
-                               static_cast<float>(roi_bin_grid_w);
-          float y = yy * cos_theta - xx * sin_theta + roi_center_y;
-          float x = yy * sin_theta + xx * cos_theta + roi_center_x;
-          theory_ops_ += 16;  // cur block
-
-          if (y < -1.0 || y > height || x < -1.0 || x > width) {
-            PreCalc pc{0, 0, 0, 0, 0, 0, 0, 0};
-            pre_calc[pre_calc_idx] = pc;
-            ++pre_calc_idx;
-            continue;
-          }
-
-          if (y < 0) y = 0;
-          if (x < 0) x = 0;
-
-          int y_low = (int)y;
-          int x_low = (int)x;
-          int y_high, x_high;
-          theory_ops_ += 2;  // cur block
-
-          if (y_low >= height - 1) {
-            y_high = y_low = height - 1;
-            y = (float)y_low;
-            theory_ops_ += 2;  // cur block
-          } else {
-            y_high = y_low + 1;
-            theory_ops_ += 1;  // cur block
-          }
-          if (x_low >= width - 1) {
-            x_high = x_low = width - 1;
-            x = (float)x_low;
-            theory_ops_ += 2;  // cur block
-          } else {
-            x_high = x_low + 1;
-            theory_ops_ += 1;  // cur block
-          }
+#include "parallel_for.h"
+#include "roi_sampler.h"
 
-          float ly = y - y_low;
-          float lx = x - x_low;
-          float hy = 1. - ly, hx = 1. - lx;
-          float w1 = hy * hx, w2 = hy * lx, w3 = ly * hx, w4 = ly * lx;
-
-          PreCalc pc;
-          pc.pos1 = (y_low * width + x_low) * channel;
-          pc.pos2 = (y_low * width + x_high) * channel;
-          pc.pos3 = (y_high * width + x_low) * channel;
-          pc.pos4 = (y_high * width + x_high) * channel;
-          pc.w1 = w1;
-          pc.w2 = w2;
-          pc.w3 = w3;
-          pc.w4 = w4;
-          pre_calc[pre_calc_idx] = pc;
-          // next stmt not count theory_ops_
-          ++pre_calc_idx;
-          theory_ops_ += 20;  // cur block
-        }
-      }
-    }
-  }
-}
+namespace mluoptest {
 
 void RoiAlignRotatedForwardExecutor::paramCheck() {
   if (!parser_->getProtoNode()->has_roi_align_rotated_forward_param()) {
@@ -194,89 +119,87 @@ void RoiAlignRotatedForwardExecutor::cpuCompute() {
     return;
   }
 
-  for (int n_idx = 0; n_idx < rois_nums; ++n_idx) {
-    // not count theory_ops_ begin
-    const int output_nidx = n_idx * pooled_height * pooled_width * channel;
-    const float *current_roi = rois + n_idx * ROI_OFFSET;
-    // not count theory_ops_ end
-
-    const int roi_batch_idx = (int)current_roi[0];
-    const float offset = aligned ? 0.5 : 0.0;
-    const float roi_center_x = current_roi[1] * spatial_scale - offset;
-    const float roi_center_y = current_roi[2] * spatial_scale - offset;
-    float roi_width = current_roi[3] * spatial_scale;
-    float roi_height = current_roi[4] * spatial_scale;
-    float theta = current_roi[5];
-    theory_ops_ += 7;  // cur block
-    if (clockwise) {
-      theta = -theta;
-      theory_ops_ += 1;  // cur block
-    }
-    const float cos_theta = cos(theta);
-    const float sin_theta = sin(theta);
-    theory_ops_ += 2;  // cur block
-
-    if (aligned) {
-      if (roi_width < 0 || roi_height < 0) {
-        VLOG(4) << "ROIs do not have non-negative value.";
-        throw std::invalid_argument(std::string(__FILE__) + " +" +
-                                    std::to_string(__LINE__));
+  // RoIs run in parallel, each counts its own theory ops.
+  std::vector<int64_t> roi_ops(rois_nums, 0);
+  auto pool_rois = [&](size_t, size_t begin, size_t end) {
+    std::vector<BilinearTap> pre_calc;
+    for (size_t n_idx = begin; n_idx < end; ++n_idx) {
+      int64_t &ops = roi_ops[n_idx];
+      // not count theory_ops_ begin
+      const int64_t output_nidx =
+          n_idx * pooled_height * pooled_width * channel;
+      const float *current_roi = rois + n_idx * ROI_OFFSET;
+      // not count theory_ops_ end
+
+      const int roi_batch_idx = (int)current_roi[0];
+      const float offset = aligned ? 0.5 : 0.0;
+      const float roi_center_x = current_roi[1] * spatial_scale - offset;
+      const float roi_center_y = current_roi[2] * spatial_scale - offset;
+      float roi_width = current_roi[3] * spatial_scale;
+      float roi_height = current_roi[4] * spatial_scale;
+      float theta = current_roi[5];
+      ops += 7;  // cur block
+      if (clockwise) {
+        theta = -theta;
+        ops += 1;  // cur block
       }
-    } else {
-      roi_width = std::max(roi_width, (float)1.0);
-      roi_height = std::max(roi_height, (float)1.0);
-      theory_ops_ += 4;  // cur block
-    }
-    const float bin_size_h = roi_height / static_cast<float>(pooled_height);
-    const float bin_size_w = roi_width / static_cast<float>(pooled_width);
-    int roi_bin_grid_h =
-        (sample_ratio > 0) ? sample_ratio : ceilf(roi_height / pooled_height);
-    int roi_bin_grid_w =
-        (sample_ratio > 0) ? sample_ratio : ceilf(roi_width / pooled_width);
-    const float count = std::max(roi_bin_grid_h * roi_bin_grid_w, 1);
-    std::vector<PreCalc> pre_calc(pooled_height * pooled_width * count);
-    const float roi_start_x = -roi_width / 2.0;
-    const float roi_start_y = -roi_height / 2.0;
-
-    preCalcForBilinearInterpolate(
-        height, width, channel, pooled_height, pooled_width, roi_bin_grid_h,
-        roi_bin_grid_w, roi_start_x, roi_start_y, bin_size_h, bin_size_w,
-        roi_center_x, roi_center_y, cos_theta, sin_theta, pre_calc);
-    theory_ops_ += 16;  // cur block
+      const float cos_theta = cos(theta);
+      const float sin_theta = sin(theta);
+      ops += 2;  // cur block
+
+      if (aligned) {
+        if (roi_width < 0 || roi_height < 0) {
+          VLOG(4) << "ROIs do not have non-negative value.";
+          throw std::invalid_argument(std::string(__FILE__) + " +" +
+                                      std::to_string(__LINE__));
+        }
+      } else {
+        roi_width = std::max(roi_width, (float)1.0);
+        roi_height = std::max(roi_height, (float)1.0);
+        ops += 4;  // cur block
+      }
+      const float bin_size_h = roi_height / static_cast<float>(pooled_height);
+      const float bin_size_w = roi_width / static_cast<float>(pooled_width);
+      int roi_bin_grid_h =
+          (sample_ratio > 0) ? sample_ratio : ceilf(roi_height / pooled_height);
+      int roi_bin_grid_w =
+          (sample_ratio > 0) ? sample_ratio : ceilf(roi_width / pooled_width);
+      const float count = std::max(roi_bin_grid_h * roi_bin_grid_w, 1);
+      const float roi_start_x = -roi_width / 2.0;
+      const float roi_start_y = -roi_height / 2.0;
+
+      rotatedRoiTaps(height, width, channel, pooled_height, pooled_width,
+                     roi_bin_grid_h, roi_bin_grid_w, roi_start_x, roi_start_y,
+                     bin_size_h, bin_size_w, roi_center_x, roi_center_y,
+                     cos_theta, sin_theta, &pre_calc, &ops);
+      ops += 16;  // cur block
 
-    for (int c_idx = 0; c_idx < channel; ++c_idx) {
       // next stmt not count theory_ops_
       const float *offset_features =
-          features + roi_batch_idx * height * width * channel;
-      int pre_calc_idx = 0;
-
-      for (int ph = 0; ph < pooled_height; ++ph) {
-        for (int pw = 0; pw < pooled_width; ++pw) {
-          // next stmt not count theory_ops_
-          int output_idx =
-              output_nidx + (ph * pooled_width + pw) * channel + c_idx;
-
-          float output_val = 0.;
-          for (int iy = 0; iy < roi_bin_grid_h; ++iy) {
-            for (int ix = 0; ix < roi_bin_grid_w; ++ix) {
-              auto pc = pre_calc[pre_calc_idx];
-              if (!(pc.w1 == 0 && pc.w2 == 0 && pc.w3 == 0 && pc.w4 == 0)) {
-                output_val += pc.w1 * offset_features[pc.pos1 + c_idx] +
-                              pc.w2 * offset_features[pc.pos2 + c_idx] +
-                              pc.w3 * offset_features[pc.pos3 + c_idx] +
-                              pc.w4 * offset_features[pc.pos4 + c_idx];
-                theory_ops_ += 9;  // cur block
-              }
-              // next stmt not count theory_ops_
-              ++pre_calc_idx;
-            }
+          features + (int64_t)roi_batch_idx * height * width * channel;
+      const int samples = roi_bin_grid_h * roi_bin_grid_w;
+      int64_t taken = 0;
+      for (int bin = 0; bin < pooled_height * pooled_width; ++bin) {
+        float *output_val = output + output_nidx + (int64_t)bin * channel;
+        std::fill(output_val, output_val + channel, 0.0f);
+        for (int i = 0; i < samples; ++i) {
+          const BilinearTap &pc = pre_calc[bin * samples + i];
+          if (pc.mask != 0) {
+            bilinearAccumulate(pc, offset_features, channel, output_val);
+            ++taken;
           }
-          output_val /= count;
-          output[output_idx] = output_val;
-          theory_ops_ += 2;  // cur block
+        }
+        for (int c_idx = 0; c_idx < channel; ++c_idx) {
+          output_val[c_idx] /= count;
         }
       }
+      // 9 ops per taken sample and 2 per output, for every channel
+      ops += channel * (9 * taken + 2 * pooled_height * pooled_width);
     }
+  };
+  parallelForChunks(rois_nums, 1, pool_rois);
+  for (int64_t ops : roi_ops) {
+    theory_ops_ += ops;
   }
 }
 
@@ -25,23 +25,10 @@ ROIALIGNROTATED_FORWARD_H_
 #define TEST_MLU_OP_GTEST_SRC_ZOO_ROIALIGNROTATED_FORWARD_\
 ROIALIGNROTATED_FORWARD_H_
 
-#include <vector>
-
 #include "executor.h"
 
 #define ROI_OFFSET 6
 
-struct PreCalc {
-  int pos1;
-  int pos2;
-  int pos3;
-  int pos4;
-  float w1;
-  float w2;
-  float w3;
-  float w4;
-};
-
 namespace mluoptest {
 class RoiAlignRotatedForwardExecutor : public Executor {
  public:
@@ -54,14 +41,6 @@ class RoiAlignRotatedForwardExecutor : public Executor {
   int64_t getTheoryOps() override;
 
  private:
-  void preCalcForBilinearInterpolate(
-      const int height, const int width, const int channel,
-      const int pooled_height, const int pooled_width, const int roi_bin_grid_h,
-      const int roi_bin_grid_w, const float roi_start_x,
-      const float roi_start_y, const float bin_size_h, const float bin_size_w,
-      const float roi_center_x, const float roi_center_y, const float cos_theta,
-      const float sin_theta, std::vector<PreCalc> &pre_calc);
-
   int64_t theory_ops_ = 0;
 };
 
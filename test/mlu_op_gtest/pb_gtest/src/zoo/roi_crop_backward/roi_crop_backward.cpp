@@ -23,6 +23,7 @@
 #include "roi_crop_backward.h"
 
 #include "mlu_op.h"
+#include "roi_sampler.h"
 
 namespace mluoptest {
 void RoiCropBackwardExecutor::paramCheck() {
@@ -87,88 +88,38 @@ void RoiCropBackwardExecutor::cpuCompute() {
   float* grad_output_cpu_ptr = cpu_fp32_input_[0];
   float* grid_cpu_ptr = cpu_fp32_input_[1];
   float* grad_input_cpu_ptr = cpu_fp32_output_[0];
-  int grad_output_nums =
-      grid_batch_roi_ * grad_output_h_ * grad_output_w_ * grad_input_c_;
   int roi_per_img = grid_batch_roi_ / grad_input_batch_;
-  int grad_output_stride_batch =
-      grad_output_h_ * grad_output_w_ * grad_input_c_;
-  int grad_output_stride_h = grad_output_w_ * grad_input_c_;
-  int grad_output_stride_w = grad_input_c_;
-  int grid_stride_batch = grad_output_h_ * grad_output_w_ * 2;
-  int grid_stride_h = grad_output_w_ * 2;
-  int gride_stride_w = 2;
-  int grad_input_stride_batch = grad_input_h_ * grad_input_w_ * grad_input_c_;
-  int grad_input_stride_h = grad_input_w_ * grad_input_c_;
-  int grad_input_stride_w = grad_input_c_;
-  int i_tl_x = 0;
-  int i_tl_y = 0;
-  float i_tl_x_weight = 0.0;
-  float i_tl_y_weight = 0.0;
-  float i_tl = 0;
-  float i_tr = 0;
-  float i_bl = 0;
-  float i_br = 0;
-  for (int index = 0; index < grad_output_nums; ++index) {
-    // coordinates of each position in grad_output data
-    int goc = index % grad_input_c_;
-    int gow = (index / grad_output_stride_w) % grad_output_w_;
-    int goh = (index / grad_output_stride_h) % grad_output_h_;
-    int gon = index / grad_output_stride_batch;
-    // data offset in grad_output
-    const int output_offset = gon * grad_output_stride_batch +
-                              goh * grad_output_stride_h +
-                              gow * grad_output_stride_w + goc;
-    float grad_output_value = grad_output_cpu_ptr[output_offset];
+  int64_t grad_input_stride_batch =
+      (int64_t)grad_input_h_ * grad_input_w_ * grad_input_c_;
+  int64_t grad_output_pixels = (int64_t)grad_output_h_ * grad_output_w_;
 
-    // batch dimension index in grad_output
-    int grad_input_n = gon / roi_per_img;
-    // data value in grid
-    float yf = grid_cpu_ptr[gon * grid_stride_batch + goh * grid_stride_h +
-                            gow * gride_stride_w];
-    float xf = grid_cpu_ptr[gon * grid_stride_batch + goh * grid_stride_h +
-                            gow * gride_stride_w + 1];
-    // grad_input data information
-    i_tl_x = getTopLeft(xf, grad_input_w_, &i_tl_x_weight);
-    i_tl_y = getTopLeft(yf, grad_input_h_, &i_tl_y_weight);
-
-    const int i_tl_offset = grad_input_n * grad_input_stride_batch +
-                            i_tl_y * grad_input_stride_h +
-                            i_tl_x * grad_input_stride_w + goc;
-    float i_tl_xy_weight = i_tl_x_weight * i_tl_y_weight;
-    bool topLeftIsIn = i_tl_x >= 0 && i_tl_x <= (grad_input_w_ - 1) &&
-                       i_tl_y >= 0 && i_tl_y <= (grad_input_h_ - 1);
-    if (topLeftIsIn) {
-      grad_input_cpu_ptr[i_tl_offset] += i_tl_xy_weight * grad_output_value;
-    }
-
-    const int i_tr_offset = i_tl_offset + grad_input_stride_w;
-    float i_tr_xy_weight = (1 - i_tl_x_weight) * i_tl_y_weight;
-    bool topRightIsIn = i_tl_x >= 0 && i_tl_x <= (grad_input_w_ - 1) &&
-                        (i_tl_y + 1) >= 0 &&
-                        (i_tl_y + 1) <= (grad_input_h_ - 1);
-    if (topRightIsIn) {
-      grad_input_cpu_ptr[i_tr_offset] += i_tr_xy_weight * grad_output_value;
-    }
-
-    const int i_bl_offset = i_tl_offset + grad_input_stride_h;
-    float i_bl_xy_weight = i_tl_x_weight * (1 - i_tl_y_weight);
-    bool bottomLeftIsIn = (i_tl_x + 1) >= 0 &&
-                          (i_tl_x + 1) <= (grad_input_w_ - 1) && i_tl_y >= 0 &&
-                          i_tl_y <= (grad_input_h_ - 1);
-    if (bottomLeftIsIn) {
-      grad_input_cpu_ptr[i_bl_offset] += i_bl_xy_weight * grad_output_value;
-    }
-
-    const int i_br_offset =
-        i_tl_offset + grad_input_stride_h + grad_input_stride_w;
-    float i_br_xy_weight = (1 - i_tl_x_weight) * (1 - i_tl_y_weight);
-    bool bottomRightIsIn =
-        (i_tl_x + 1) >= 0 && (i_tl_x + 1) <= (grad_input_w_ - 1) &&
-        (i_tl_y + 1) >= 0 && (i_tl_y + 1) <= (grad_input_h_ - 1);
-    if (bottomRightIsIn) {
-      grad_input_cpu_ptr[i_br_offset] += i_br_xy_weight * grad_output_value;
+  // each slice owns the channels [c_begin, c_end) of one grad_input image and
+  // scatters the rois of that image in order
+  auto scatter_slice = [&](int grad_input_n, int c_begin, int c_end) {
+    float* grad_input_image =
+        grad_input_cpu_ptr + grad_input_n * grad_input_stride_batch;
+    for (int gon = grad_input_n * roi_per_img;
+         gon < (grad_input_n + 1) * roi_per_img; ++gon) {
+      for (int64_t pixel = 0; pixel < grad_output_pixels; ++pixel) {
+        const int64_t pos = gon * grad_output_pixels + pixel;
+        // data value in grid
+        float yf = grid_cpu_ptr[pos * 2];
+        float xf = grid_cpu_ptr[pos * 2 + 1];
+        float i_tl_x_weight = 0.0;
+        float i_tl_y_weight = 0.0;
+        int i_tl_x = getTopLeft(xf, grad_input_w_, &i_tl_x_weight);
+        int i_tl_y = getTopLeft(yf, grad_input_h_, &i_tl_y_weight);
+        BilinearTap tap;
+        makeCornerTap(grad_input_h_, grad_input_w_, i_tl_y, i_tl_x,
+                      i_tl_y_weight, i_tl_x_weight, grad_input_c_, &tap);
+        const float* grad_output_this_pixel =
+            grad_output_cpu_ptr + pos * grad_input_c_;
+        bilinearScatter(tap, grad_output_this_pixel + c_begin, 1.0f,
+                        c_end - c_begin, grad_input_image + c_begin);
+      }
     }
-  }
+  };
+  roiScatterSlices(grad_input_batch_, grad_input_c_, scatter_slice);
   VLOG(4) << "[RoiCropBackwardExecutor] call cpuCompute() end.";
 }
 
@@ -23,6 +23,8 @@
 #include "roi_crop_forward.h"
 
 #include "mlu_op.h"
+#include "parallel_for.h"
+#include "roi_sampler.h"
 
 namespace mluoptest {
 void RoiCropForwardExecutor::paramCheck() {
@@ -87,83 +89,35 @@ void RoiCropForwardExecutor::cpuCompute() {
   float* input_c_pu_ptr = cpu_fp32_input_[0];
   float* grid_cpu_ptr = cpu_fp32_input_[1];
   float* output_cpu_ptr = cpu_fp32_output_[0];
-  int output_nums = grid_batch_roi_ * output_h_ * output_w_ * input_c_;
   int roi_per_img = grid_batch_roi_ / input_batch_;
-  int output_stride_batch = output_h_ * output_w_ * input_c_;
-  int output_stride_h = output_w_ * input_c_;
-  int output_stride_w = input_c_;
-  int grid_stride_batch = output_h_ * output_w_ * 2;
-  int grid_stride_h = output_w_ * 2;
-  int gride_stride_w = 2;
-  int input_stride_batch = input_h_ * input_w_ * input_c_;
-  int input_stride_h = input_w_ * input_c_;
-  int input_stride_w = input_c_;
-  int i_tl_x = 0;
-  int i_tl_y = 0;
-  float i_tl_x_weight = 0.0;
-  float i_tl_y_weight = 0.0;
-  float i_tl = 0;
-  float i_tr = 0;
-  float i_bl = 0;
-  float i_br = 0;
+  int64_t input_stride_batch = (int64_t)input_h_ * input_w_ * input_c_;
 
-  for (int index = 0; index < output_nums; ++index) {
-    // coordinates of each position in output data
-    int oc = index % input_c_;
-    int ow = (index / output_stride_w) % output_w_;
-    int oh = (index / output_stride_h) % output_h_;
-    int on = index / output_stride_batch;
-    // data oddset in output
-    const int output_offset = on * output_stride_batch + oh * output_stride_h +
-                              ow * output_stride_w + oc;
-    // batch dimension index in output
-    int input_n = on / roi_per_img;
-    // data value in grid
-    float yf = grid_cpu_ptr[on * grid_stride_batch + oh * grid_stride_h +
-                            ow * gride_stride_w];
-    float xf = grid_cpu_ptr[on * grid_stride_batch + oh * grid_stride_h +
-                            ow * gride_stride_w + 1];
-    // input data information
-    i_tl_x = getTopLeft(xf, input_w_, &i_tl_x_weight);
-    i_tl_y = getTopLeft(yf, input_h_, &i_tl_y_weight);
-
-    // field information
-    const int i_tl_offset = input_n * input_stride_batch +
-                            i_tl_y * input_stride_h + i_tl_x * input_stride_w +
-                            oc;
-    float i_tl_xy_weight = i_tl_x_weight * i_tl_y_weight;
-    bool topLeftIsIn = i_tl_x >= 0 && i_tl_x <= (input_w_ - 1) && i_tl_y >= 0 &&
-                       i_tl_y <= (input_h_ - 1);
-    if (topLeftIsIn) {
-      i_tl = input_c_pu_ptr[i_tl_offset];
-    }
-    const int i_tr_offset = i_tl_offset + input_stride_w;
-    float i_tr_xy_weight = (1 - i_tl_x_weight) * i_tl_y_weight;
-    bool topRightIsIn = i_tl_x >= 0 && i_tl_x <= (input_w_ - 1) &&
-                        (i_tl_y + 1) >= 0 && (i_tl_y + 1) <= (input_h_ - 1);
-    if (topRightIsIn) {
-      i_tr = input_c_pu_ptr[i_tr_offset];
-    }
-    const int i_bl_offset = i_tl_offset + input_stride_h;
-    float i_bl_xy_weight = i_tl_x_weight * (1 - i_tl_y_weight);
-    bool bottomLeftIsIn = (i_tl_x + 1) >= 0 && (i_tl_x + 1) <= (input_w_ - 1) &&
-                          i_tl_y >= 0 && i_tl_y <= (input_h_ - 1);
-    if (bottomLeftIsIn) {
-      i_bl = input_c_pu_ptr[i_bl_offset];
+  // every output pixel samples all channels through one tap, corners outside
+  // the input contribute zero as on the device
+  auto crop_rows = [&](int chunk, int64_t begin, int64_t end) {
+    for (int64_t row = begin; row < end; ++row) {
+      int on = row / output_h_;
+      // batch dimension index in output
+      int input_n = on / roi_per_img;
+      const float* input_image = input_c_pu_ptr + input_n * input_stride_batch;
+      for (int ow = 0; ow < output_w_; ++ow) {
+        const int64_t pos = row * output_w_ + ow;
+        // data value in grid
+        float yf = grid_cpu_ptr[pos * 2];
+        float xf = grid_cpu_ptr[pos * 2 + 1];
+        float i_tl_x_weight = 0.0;
+        float i_tl_y_weight = 0.0;
+        int i_tl_x = getTopLeft(xf, input_w_, &i_tl_x_weight);
+        int i_tl_y = getTopLeft(yf, input_h_, &i_tl_y_weight);
+        BilinearTap tap;
+        makeCornerTap(input_h_, input_w_, i_tl_y, i_tl_x, i_tl_y_weight,
+                      i_tl_x_weight, input_c_, &tap);
+        bilinearGather(tap, input_image, input_c_,
+                       output_cpu_ptr + pos * input_c_);
+      }
     }
-    const int i_br_offset = i_tl_offset + input_stride_h + input_stride_w;
-    float i_br_xy_weight = (1 - i_tl_x_weight) * (1 - i_tl_y_weight);
-    bool bottomRightIsIn = (i_tl_x + 1) >= 0 &&
-                           (i_tl_x + 1) <= (input_w_ - 1) &&
-                           (i_tl_y + 1) >= 0 && (i_tl_y + 1) <= (input_h_ - 1);
-    if (bottomRightIsIn) {
-      i_br = input_c_pu_ptr[i_br_offset];
-    }
-
-    output_cpu_ptr[output_offset] =
-        i_tl_xy_weight * i_tl + i_tr_xy_weight * i_tr + i_bl_xy_weight * i_bl +
-        i_br_xy_weight * i_br;
-  }
+  };
+  parallelForChunks((int64_t)grid_batch_roi_ * output_h_, 1, crop_rows);
   VLOG(4) << "[RoiCropForwardExecutor] call cpuCompute() End.";
 }
 
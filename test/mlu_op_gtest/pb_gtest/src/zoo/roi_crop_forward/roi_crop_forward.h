@@ -34,6 +34,8 @@ class RoiCropForwardExecutor : public Executor {
   void compute() override;
   void cpuCompute() override;
   int64_t getTheoryOps() override;
+  // 1: out-of-map corners are masked to zero
+  int64_t cpuComputeVersion() override { return 1; }
 
  private:
   void initData();
@@ -37,6 +37,33 @@ static char pooling_mode_str[3][64] =
                            "MLUOP_POOLING_AVERAGE_COUNT_INCLUDE_PADDING",
                            "MLUOP_POOLING_AVERAGE_COUNT_EXCLUDE_PADDING"};
 
+// input window [x1, x2) * [y1, y2) of bin (ph, pw) of one roi
+static void getRoiBin(const float *offset_rois, int ph, int pw, int height,
+                      int width, int pool_height, int pool_width,
+                      float spatial_scale, int *bin_x1, int *bin_y1,
+                      int *bin_x2, int *bin_y2) {
+  int roi_x1 = round(offset_rois[1] * spatial_scale);
+  int roi_y1 = round(offset_rois[2] * spatial_scale);
+  int roi_x2 = round(offset_rois[3] * spatial_scale);
+  int roi_y2 = round(offset_rois[4] * spatial_scale);
+
+  int roi_w = std::max(roi_x2 - roi_x1 + 1, 1);
+  int roi_h = std::max(roi_y2 - roi_y1 + 1, 1);
+  float bin_size_w = static_cast<float>(roi_w) /
+                     static_cast<float>(pool_width);
+  float bin_size_h = static_cast<float>(roi_h) /
+                     static_cast<float>(pool_height);
+
+  int x1 = floor(static_cast<float>(pw) * bin_size_w);
+  int y1 = floor(static_cast<float>(ph) * bin_size_h);
+  int x2 = ceil(static_cast<float>(pw + 1) * bin_size_w);
+  int y2 = ceil(static_cast<float>(ph + 1) * bin_size_h);
+  *bin_x1 = std::min(std::max(x1 + roi_x1, 0), width);
+  *bin_y1 = std::min(std::max(y1 + roi_y1, 0), height);
+  *bin_x2 = std::min(std::max(x2 + roi_x1, 0), width);
+  *bin_y2 = std::min(std::max(y2 + roi_y1, 0), height);
+}
+
 void RoiPoolingForwardExecutor::cpuRoiPoolingForward(float *input_v,
                                                      float *rois,
                                                      int batch_v,
@@ -50,7 +77,6 @@ void RoiPoolingForwardExecutor::cpuRoiPoolingForward(float *input_v,
                                                      float *output,
                                                      float *argmax) {
   int bin_num = rois_num * pool_height * pool_width * channels;
-  theory_ops = 0;
   for (int index = 0; index < bin_num; index++) {
     int c = index % channels;
     int pw = (index / channels) % pool_width;
@@ -59,26 +85,9 @@ void RoiPoolingForwardExecutor::cpuRoiPoolingForward(float *input_v,
 
     const float *offset_rois = rois + n * 5;
     int batch_id = (int)offset_rois[0];
-    int roi_x1 = round(offset_rois[1] * spatial_scale);
-    int roi_y1 = round(offset_rois[2] * spatial_scale);
-    int roi_x2 = round(offset_rois[3] * spatial_scale);
-    int roi_y2 = round(offset_rois[4] * spatial_scale);
-
-    int roi_w = std::max(roi_x2 - roi_x1 + 1, 1);
-    int roi_h = std::max(roi_y2 - roi_y1 + 1, 1);
-    float bin_size_w = static_cast<float>(roi_w) /
-                       static_cast<float>(pool_width);
-    float bin_size_h = static_cast<float>(roi_h) /
-                       static_cast<float>(pool_height);
-
-    int bin_x1 = floor(static_cast<float>(pw) * bin_size_w);
-    int bin_y1 = floor(static_cast<float>(ph) * bin_size_h);
-    int bin_x2 = ceil(static_cast<float>(pw + 1) * bin_size_w);
-    int bin_y2 = ceil(static_cast<float>(ph + 1) * bin_size_h);
-    bin_x1 = std::min(std::max(bin_x1 + roi_x1, 0), width);
-    bin_y1 = std::min(std::max(bin_y1 + roi_y1, 0), height);
-    bin_x2 = std::min(std::max(bin_x2 + roi_x1, 0), width);
-    bin_y2 = std::min(std::max(bin_y2 + roi_y1, 0), height);
+    int bin_x1, bin_y1, bin_x2, bin_y2;
+    getRoiBin(offset_rois, ph, pw, height, width, pool_height, pool_width,
+              spatial_scale, &bin_x1, &bin_y1, &bin_x2, &bin_y2);
     bool is_empty = (bin_y2 <= bin_y1) || (bin_x2 <= bin_x1);
 
     const float *offset_input = input_v + (batch_id * height *
@@ -92,7 +101,6 @@ void RoiPoolingForwardExecutor::cpuRoiPoolingForward(float *input_v,
           max_v = offset_input[offset];
           max_idx = (float)(offset / channels);
         }
-        theory_ops++;
       }
     }
     output[index] = max_v;
@@ -152,7 +160,29 @@ void RoiPoolingForwardExecutor::cpuCompute() {
   VLOG(4) << "############################### cpuCompute() End ##";
 }
 
+// counted from the rois here, cpuCompute is skipped when the baseline comes
+// from the cache
 int64_t RoiPoolingForwardExecutor::getTheoryOps() {
+  theory_ops = 0;
+  if (exe_config_->mlu_only) {
+    // no host copy of the rois
+    return 0;
+  }
+  const float *rois_cpu = cpu_fp32_input_[1];
+  for (int n = 0; n < rois_num_; n++) {
+    for (int ph = 0; ph < pool_height_; ph++) {
+      for (int pw = 0; pw < pool_width_; pw++) {
+        int bin_x1, bin_y1, bin_x2, bin_y2;
+        getRoiBin(rois_cpu + n * 5, ph, pw, height_, width_, pool_height_,
+                  pool_width_, spatial_scale_, &bin_x1, &bin_y1, &bin_x2,
+                  &bin_y2);
+        if (bin_y2 > bin_y1 && bin_x2 > bin_x1) {
+          theory_ops += (int64_t)(bin_y2 - bin_y1) * (bin_x2 - bin_x1);
+        }
+      }
+    }
+  }
+  theory_ops *= channels_;
   return theory_ops * 2;
 }
 
@@ -35,6 +35,7 @@ class RoiPoolingForwardExecutor : public Executor {
   void cpuCompute() override;
   void initData();
   int64_t getTheoryOps() override;
+  int64_t cpuComputeVersion() override { return 0; }
 
   void cpuRoiPoolingForward(float *input_v,
                             float *rois,
@@ -22,8 +22,11 @@
  *************************************************************************/
 #include <string>
 #include <algorithm>
+#include <vector>
 #include "roialign_forward.h"
 #include "mlu_op.h"
+#include "parallel_for.h"
+#include "roi_sampler.h"
 
 namespace mluoptest {
 
@@ -94,36 +97,6 @@ void RoialignForwardExecutor::compute() {
   mluOpDestroyRoiAlignForwardDescriptor(roialign_desc);
 }
 
-void RoialignForwardExecutor::bilinear_interpolate(
-    int height, int width, float y, float x, float &w1, float &w2, float &w3,
-    float &w4, int &x_low, int &x_high, int &y_low, int &y_high, int &empty) {
-  if (y < -1.0 || y > height || x < -1.0 || x > width) {
-    empty = 1;
-    return;
-  }
-
-  if (y <= 0) y = 0;
-  if (x <= 0) x = 0;
-  y_low = (int)y;
-  x_low = (int)x;
-  if (y_low >= height - 1) {
-    y_high = y_low = height - 1;
-    y = (float)y_low;
-  } else {
-    y_high = y_low + 1;
-  }
-  if (x_low >= width - 1) {
-    x_high = x_low = width - 1;
-    x = (float)x_low;
-  } else {
-    x_high = x_low + 1;
-  }
-  float ly = y - y_low, lx = x - x_low;
-  float hy = 1. - ly, hx = 1. - lx;
-  w1 = hy * hx, w2 = hy * lx, w3 = ly * hx, w4 = ly * lx;
-  return;
-}
-
 void RoialignForwardExecutor::cpuCompute() {
   float spatial_scale =
       parser_->getProtoNode()->roialign_param().spatial_scale();
@@ -148,15 +121,24 @@ void RoialignForwardExecutor::cpuCompute() {
   float *input = cpu_fp32_input_[0];
   float *input_rois = cpu_fp32_input_[1];  // (n, 5) { n, x0, y0, x1, y1}
   float *output = cpu_fp32_output_[0];
+  float *output_argmax_x = nullptr;
+  float *output_argmax_y = nullptr;
   if (pool_mode == 1) {
-    // roialign cpu
     VLOG(4) << "BEGIN CPU pool_mode avg";
+  } else if (pool_mode == 0) {
+    VLOG(4) << "BEGIN CPU API version 1 and pool_mode max";
+    output_argmax_x = cpu_fp32_output_[1];
+    output_argmax_y = cpu_fp32_output_[2];
+  } else {
+    return;
+  }
 
-    float *pooled_value =
-        (float *)cpu_runtime_.allocate(channels * sizeof(float));
-    int channel_idx = 0;
-
-    for (int roi_idx = 0; roi_idx < num_rois; roi_idx++) {
+  // RoIs write disjoint outputs and run in parallel. A sample is one tap
+  // applied to all channels of the bin at once.
+  auto pool_rois = [&](size_t, size_t begin, size_t end) {
+    std::vector<float> pooled_value(channels);
+    BilinearTap tap;
+    for (size_t roi_idx = begin; roi_idx < end; roi_idx++) {
       int batch_idx = int(input_rois[roi_idx * roi_offset]);
       if (batch_idx < 0 || batch_idx >= input_n) {
         LOG(ERROR) << "RoiAlign cpu : batch_id should be in [0," << input_n - 1
@@ -195,182 +177,71 @@ void RoialignForwardExecutor::cpuCompute() {
                         ? roi_bin_grid_h * roi_bin_grid_w
                         : 1;
       float count_value = 1.0f / count;
+      const float *input_temp =
+          input + (int64_t)batch_idx * width * height * channels;
 
       for (int ph = 0; ph < pooled_height; ph++) {
         for (int pw = 0; pw < pooled_width; pw++) {
-          float *output_channel_ptr =
-              output + roi_idx * pooled_height * pooled_width * channels +
-              ph * pooled_width * channels + pw * channels;
-
-          memset(pooled_value, 0, channels * sizeof(float));
-
-          for (int iy = 0; iy < roi_bin_grid_h; iy++) {
-            float y =
-                roi_start_h + ph * bin_size_h +
-                (iy + 0.5) * bin_size_h / (roi_bin_grid_h);  // center_point y
-            for (int ix = 0; ix < roi_bin_grid_w; ix++) {
-              float x =
-                  roi_start_w + pw * bin_size_w +
-                  (ix + 0.5) * bin_size_w / (roi_bin_grid_w);  // center_point x
-              int empty = 0;
-              float w1, w2, w3, w4;
-              int x_low, x_high, y_low, y_high;
-              bilinear_interpolate(height, width, y, x, w1, w2, w3, w4, x_low,
-                                   x_high, y_low, y_high, empty);
-
-              float *input_temp = input + batch_idx * width * height * channels;
-              float *input_channel_ptr_1 =
-                  input_temp + (y_low * width + x_low) * channels;
-              float *input_channel_ptr_2 =
-                  input_temp + (y_low * width + x_high) * channels;
-              float *input_channel_ptr_3 =
-                  input_temp + (y_high * width + x_low) * channels;
-              float *input_channel_ptr_4 =
-                  input_temp + (y_high * width + x_high) * channels;
-
-              for (channel_idx = 0; channel_idx < channels; channel_idx++) {
-                float value;
-                if (empty == 1) {
-                  value = 0;
-                } else {
-                  float v1 = input_channel_ptr_1[channel_idx];
-                  float v2 = input_channel_ptr_2[channel_idx];
-                  float v3 = input_channel_ptr_3[channel_idx];
-                  float v4 = input_channel_ptr_4[channel_idx];
-                  // bilinear interpolatation
-                  value = w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4;
-                }
-                pooled_value[channel_idx] += value;  // sum
-              }                                      // channels
-            }                                        // roi_bin_grid_w
-          }                                          // roi_bin_grid_h
-          for (channel_idx = 0; channel_idx < channels; channel_idx++) {
-            pooled_value[channel_idx] = pooled_value[channel_idx] * count_value;
+          const int64_t bin_offset =
+              ((roi_idx * pooled_height + ph) * pooled_width + pw) * channels;
+          float *output_channel_ptr = output + bin_offset;
+
+          if (pool_mode == 1) {
+            std::fill(pooled_value.begin(), pooled_value.end(), 0.0f);
+            for (int iy = 0; iy < roi_bin_grid_h; iy++) {
+              float y = roi_start_h + ph * bin_size_h +
+                        (iy + 0.5) * bin_size_h /
+                            (roi_bin_grid_h);  // center_point y
+              for (int ix = 0; ix < roi_bin_grid_w; ix++) {
+                float x = roi_start_w + pw * bin_size_w +
+                          (ix + 0.5) * bin_size_w /
+                              (roi_bin_grid_w);  // center_point x
+                makeBilinearTap(height, width, y, x, channels, &tap);
+                // an empty sample adds 0 to the sum
+                bilinearAccumulate(tap, input_temp, channels,
+                                   pooled_value.data());
+              }  // roi_bin_grid_w
+            }    // roi_bin_grid_h
+            for (int channel_idx = 0; channel_idx < channels; channel_idx++) {
+              output_channel_ptr[channel_idx] =
+                  pooled_value[channel_idx] * count_value;
+            }
+            continue;
           }
-          memcpy(output_channel_ptr, pooled_value, channels * sizeof(float));
-        }  // pw
-      }    // ph
-    }      // roi
-    cpu_runtime_.deallocate(pooled_value);
-  } else if (pool_mode == 0) {
-    // roialign cpu
 
-    VLOG(4) << "BEGIN CPU API version 1 and pool_mode max";
-    auto output_argmax_x_desc = parser_->getMetaTensor(3).tensor;
-    auto output_argmax_y_desc = parser_->getMetaTensor(4).tensor;
-
-    float *output_argmax_x = cpu_fp32_output_[1];
-    float *output_argmax_y = cpu_fp32_output_[2];
-    float *pooled_value =
-        (float *)cpu_runtime_.allocate(channels * sizeof(float));
-    float *argmax_x_value =
-        (float *)cpu_runtime_.allocate(channels * sizeof(float));
-    float *argmax_y_value =
-        (float *)cpu_runtime_.allocate(channels * sizeof(float));
-
-    for (int roi_idx = 0; roi_idx < num_rois; roi_idx++) {
-      int batch_idx = int(input_rois[roi_idx * roi_offset + 0]);
-      if (batch_idx < 0 || batch_idx >= input_n) {
-        LOG(ERROR) << "RoiAlign cpu : batch_id should be in [0," << input_n - 1
-                   << "]. But batch_id is " << batch_idx;
-      }
-      float roi_x1 = input_rois[roi_idx * roi_offset + 1];
-      float roi_y1 = input_rois[roi_idx * roi_offset + 2];
-      float roi_x2 = input_rois[roi_idx * roi_offset + 3];
-      float roi_y2 = input_rois[roi_idx * roi_offset + 4];
-      int height = input_height;
-      int width = input_width;
-      float offset = aligned ? 0.5 : 0.0;
-      float roi_start_w = roi_x1 * spatial_scale - offset;
-      float roi_start_h = roi_y1 * spatial_scale - offset;
-      float roi_end_w = roi_x2 * spatial_scale - offset;
-      float roi_end_h = roi_y2 * spatial_scale - offset;
-
-      float roi_width = roi_end_w - roi_start_w;
-      float roi_height = roi_end_h - roi_start_h;
-
-      if (!aligned) {
-        roi_width = roi_width > 1 ? roi_width : 1;
-        roi_height = roi_height > 1 ? roi_height : 1;
-      }
-
-      float bin_size_h = (float)roi_height / pooled_height;
-      float bin_size_w = (float)roi_width / pooled_width;
-
-      int roi_bin_grid_h =
-          (sampling_ratio > 0) ? sampling_ratio : ceil(bin_size_h);
-      int roi_bin_grid_w =
-          (sampling_ratio > 0) ? sampling_ratio : ceil(bin_size_w);
-
-      for (int ph = 0; ph < pooled_height; ph++) {
-        for (int pw = 0; pw < pooled_width; pw++) {
-          float *output_channel_ptr =
-              output + roi_idx * pooled_height * pooled_width * channels +
-              ph * pooled_width * channels + pw * channels;
-          float *output_argmax_x_channel_ptr =
-              output_argmax_x +
-              roi_idx * pooled_height * pooled_width * channels +
-              ph * pooled_width * channels + pw * channels;
-          float *output_argmax_y_channel_ptr =
-              output_argmax_y +
-              roi_idx * pooled_height * pooled_width * channels +
-              ph * pooled_width * channels + pw * channels;
-
-          std::fill(pooled_value, pooled_value + channels, -FLT_MAX);
-          std::fill(argmax_x_value, argmax_x_value + channels, -1);
-          std::fill(argmax_y_value, argmax_y_value + channels, -1);
+          float *output_argmax_x_channel_ptr = output_argmax_x + bin_offset;
+          float *output_argmax_y_channel_ptr = output_argmax_y + bin_offset;
+          std::fill(output_channel_ptr, output_channel_ptr + channels,
+                    -FLT_MAX);
+          std::fill(output_argmax_x_channel_ptr,
+                    output_argmax_x_channel_ptr + channels, -1);
+          std::fill(output_argmax_y_channel_ptr,
+                    output_argmax_y_channel_ptr + channels, -1);
           for (int iy = 0; iy < roi_bin_grid_h; iy++) {
             float y = roi_start_h + ph * bin_size_h +
                       (iy + 0.5) * bin_size_h / (roi_bin_grid_h);
             for (int ix = 0; ix < roi_bin_grid_w; ix++) {
               float x = roi_start_w + pw * bin_size_w +
                         (ix + 0.5) * bin_size_w / (roi_bin_grid_w);
-              float w1, w2, w3, w4;
-              int x_low, x_high, y_low, y_high;
-              int empty = 0;
-              bilinear_interpolate(input_height, input_width, y, x, w1, w2, w3,
-                                   w4, x_low, x_high, y_low, y_high, empty);
-              float *input_temp = input + batch_idx * width * height * channels;
-              float *input_channel_ptr_1 =
-                  input_temp + (y_low * width + x_low) * channels;
-              float *input_channel_ptr_2 =
-                  input_temp + (y_low * width + x_high) * channels;
-              float *input_channel_ptr_3 =
-                  input_temp + (y_high * width + x_low) * channels;
-              float *input_channel_ptr_4 =
-                  input_temp + (y_high * width + x_high) * channels;
-              for (int channel_idx = 0; channel_idx < channels; channel_idx++) {
-                float value;
-                if (empty == 1) {
-                  value = 0;
-                } else {
-                  float v1 = input_channel_ptr_1[channel_idx];
-                  float v2 = input_channel_ptr_2[channel_idx];
-                  float v3 = input_channel_ptr_3[channel_idx];
-                  float v4 = input_channel_ptr_4[channel_idx];
-                  // bilinear interpolatation
-                  value = w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4;
-                }
-                if (value > pooled_value[channel_idx]) {
-                  pooled_value[channel_idx] = value;
-                  argmax_x_value[channel_idx] = x;
-                  argmax_y_value[channel_idx] = y;
+              makeBilinearTap(height, width, y, x, channels, &tap);
+              // an empty sample reads 0
+              bilinearGather(tap, input_temp, channels, pooled_value.data());
+              for (int channel_idx = 0; channel_idx < channels;
+                   channel_idx++) {
+                float value = pooled_value[channel_idx];
+                if (value > output_channel_ptr[channel_idx]) {
+                  output_channel_ptr[channel_idx] = value;
+                  output_argmax_x_channel_ptr[channel_idx] = x;
+                  output_argmax_y_channel_ptr[channel_idx] = y;
                 }
               }  // channels
             }    // sample w
           }      // sample h
-          memcpy(output_channel_ptr, pooled_value, channels * sizeof(float));
-          memcpy(output_argmax_x_channel_ptr, argmax_x_value,
-                 channels * sizeof(float));
-          memcpy(output_argmax_y_channel_ptr, argmax_y_value,
-                 channels * sizeof(float));
-        }  // pw
-      }    // ph
-    }      // roi
-    cpu_runtime_.deallocate(pooled_value);
-    cpu_runtime_.deallocate(argmax_x_value);
-    cpu_runtime_.deallocate(argmax_y_value);
-  }
+        }        // pw
+      }          // ph
+    }            // roi
+  };
+  parallelForChunks(num_rois, 1, pool_rois);
 }
 
 int64_t RoialignForwardExecutor::getTheoryOps() {
@@ -23,33 +23,32 @@
 #include "roiaware_pool3d_forward.h"
 
 #include <algorithm>
+#include <array>
 #include <string>
+#include <vector>
 
 #include "mlu_op.h"
+#include "box_grid.h"
+#include "parallel_for.h"
 
 namespace mluoptest {
+constexpr size_t kRoiawareGrain = 1024;
 
-static void lidarToLocalCoords(const float shift_x, const float shift_y,
-                               const float rz, float &local_x, float &local_y) {
-  float cosa = cos(-rz), sina = sin(-rz);
-  local_x = shift_x * cosa + shift_y * (-sina);
-  local_y = shift_x * sina + shift_y * cosa;
-}
-
-static int checkPtInBox3d(const float *pt, const float *box3d, float &local_x,
+static int checkPtInBox3d(const float *pt, const float *box3d,
+                          const BoxGrid &grid, int64_t box_idx, float &local_x,
                           float &local_y) {
   // pt: [x, y, z]
   // box3d: [cx, cy, cz, dx, dy, dz, rz] in LiDAR coordinate
   // cz in the bottom center
   float x = pt[0], y = pt[1], z = pt[2];
-  float cx = box3d[0], cy = box3d[1], cz = box3d[2];
-  float dx = box3d[3], dy = box3d[4], dz = box3d[5], rz = box3d[6];
+  float cz = box3d[2];
+  float dx = box3d[3], dy = box3d[4], dz = box3d[5];
   // shift to the center since cz in box3d is the bottom center
   cz += dz / 2.0;
 
   if (fabsf(z - cz) > dz / 2.0) return 0;
 
-  lidarToLocalCoords(x - cx, y - cy, rz, local_x, local_y);
+  grid.localCoords(box_idx, x, y, &local_x, &local_y);
   int in_flag = (local_x > -dx / 2.0) & (local_x < dx / 2.0) &
                 (local_y > -dy / 2.0) & (local_y < dy / 2.0);
   return in_flag;
@@ -65,42 +64,60 @@ static void collectInsidePtsForBox3d(const int boxes_num, const int pts_num,
   // pts_idx_of_voxels: (boxes_num, out_x, out_y, out_z, max_pts_each_voxel)
 
   const int max_num_pts = max_pts_each_voxel - 1;  // index 0 is the counter
-  for (int box_idx = 0; box_idx < boxes_num; box_idx++) {
-    const float *rois_cur_box = rois + box_idx * 7;
-    int *pts_idx_of_voxels_cur_box = pts_idx_of_voxels + box_idx * out_x *
-                                                             out_y * out_z *
-                                                             max_pts_each_voxel;
-    for (int pt_idx = 0; pt_idx < pts_num; pt_idx++) {
-      const float *pts_cur_pts = pts + pt_idx * 3;
-      float local_x = 0, local_y = 0;
-      int cur_in_flag =
-          checkPtInBox3d(pts_cur_pts, rois_cur_box, local_x, local_y);
-      if (cur_in_flag > 0) {
-        // cz=rois[2] in the bottom center
-        float local_z = pts_cur_pts[2] - rois_cur_box[2];
-        float x_size = rois_cur_box[3], y_size = rois_cur_box[4],
-              z_size = rois_cur_box[5];
+  BoxGrid grid;
+  grid.build(rois, boxes_num);
+  // voxels hit by each chunk of points, as (box_idx, pt_idx, base_offset).
+  const size_t num_chunks = (pts_num + kRoiawareGrain - 1) / kRoiawareGrain;
+  std::vector<std::vector<std::array<int, 3>>> chunk_hits(num_chunks);
+  parallelForChunks(
+      pts_num, kRoiawareGrain, [&](size_t chunk, size_t begin, size_t end) {
+        for (int pt_idx = begin; pt_idx < (int)end; pt_idx++) {
+          const float *pts_cur_pts = pts + pt_idx * 3;
+          grid.forEachCandidate(
+              pts_cur_pts[0], pts_cur_pts[1], [&](int64_t box_idx) {
+                const float *rois_cur_box = rois + box_idx * 7;
+                float local_x = 0, local_y = 0;
+                int cur_in_flag = checkPtInBox3d(pts_cur_pts, rois_cur_box,
+                                                 grid, box_idx, local_x,
+                                                 local_y);
+                if (cur_in_flag > 0) {
+                  // cz=rois[2] in the bottom center
+                  float local_z = pts_cur_pts[2] - rois_cur_box[2];
+                  float x_size = rois_cur_box[3], y_size = rois_cur_box[4],
+                        z_size = rois_cur_box[5];
 
-        float x_res = x_size / out_x;
-        float y_res = y_size / out_y;
-        float z_res = z_size / out_z;
+                  float x_res = x_size / out_x;
+                  float y_res = y_size / out_y;
+                  float z_res = z_size / out_z;
 
-        int x_idx = int((local_x + x_size / 2) / x_res);
-        int y_idx = int((local_y + y_size / 2) / y_res);
-        int z_idx = int(local_z / z_res);
+                  int x_idx = int((local_x + x_size / 2) / x_res);
+                  int y_idx = int((local_y + y_size / 2) / y_res);
+                  int z_idx = int(local_z / z_res);
 
-        x_idx = std::min(std::max(x_idx, 0), out_x - 1);
-        y_idx = std::min(std::max(y_idx, 0), out_y - 1);
-        z_idx = std::min(std::max(z_idx, 0), out_z - 1);
+                  x_idx = std::min(std::max(x_idx, 0), out_x - 1);
+                  y_idx = std::min(std::max(y_idx, 0), out_y - 1);
+                  z_idx = std::min(std::max(z_idx, 0), out_z - 1);
 
-        int base_offset = x_idx * out_y * out_z * max_pts_each_voxel +
-                          y_idx * out_z * max_pts_each_voxel +
-                          z_idx * max_pts_each_voxel;
-        int cnt = pts_idx_of_voxels_cur_box[base_offset];
-        if (cnt < max_num_pts) {
-          pts_idx_of_voxels_cur_box[base_offset + cnt + 1] = pt_idx;
-          pts_idx_of_voxels_cur_box[base_offset]++;
+                  int base_offset = x_idx * out_y * out_z * max_pts_each_voxel +
+                                    y_idx * out_z * max_pts_each_voxel +
+                                    z_idx * max_pts_each_voxel;
+                  chunk_hits[chunk].push_back(
+                      {(int)box_idx, pt_idx, base_offset});
+                }
+                return false;
+              });
         }
+      });
+  // chunks are applied in point order, so every voxel keeps its first points.
+  for (const auto &hits : chunk_hits) {
+    for (const auto &hit : hits) {
+      int *pts_idx_of_voxels_cur_box =
+          pts_idx_of_voxels +
+          hit[0] * out_x * out_y * out_z * max_pts_each_voxel;
+      int cnt = pts_idx_of_voxels_cur_box[hit[2]];
+      if (cnt < max_num_pts) {
+        pts_idx_of_voxels_cur_box[hit[2] + cnt + 1] = hit[1];
+        pts_idx_of_voxels_cur_box[hit[2]]++;
       }
     }
   }
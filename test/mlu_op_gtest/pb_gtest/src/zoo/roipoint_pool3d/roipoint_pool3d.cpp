@@ -27,30 +27,27 @@
 #include <string>
 #include <vector>
 
-namespace mluoptest {
+#include "box_grid.h"
+#include "parallel_for.h"
 
-void lidarToLocalCoords(float shift_x, float shift_y, float rz, float &local_x,
-                        float &local_y) {
-  float cosa = std::cos(-rz), sina = std::sin(-rz);
-  local_x = shift_x * cosa + shift_y * (-sina);
-  local_y = shift_x * sina + shift_y * cosa;
-}
+namespace mluoptest {
+constexpr size_t kRoipointGrain = 1024;
 
-int checkPointInBox3d(const float *pt, const float *box3d, float &local_x,
-                      float &local_y) {
+int checkPointInBox3d(const float *pt, const float *box3d, const BoxGrid &grid,
+                      int64_t box_idx, float &local_x, float &local_y) {
   // param pt: (x, y, z)
   // param box3d: (cx, cy, cz, dx, dy, dz, rz) in LiDAR coordinate, cz in the
   // bottom center
   float x = pt[0], y = pt[1], z = pt[2];
-  float cx = box3d[0], cy = box3d[1], cz = box3d[2];
-  float dx = box3d[3], dy = box3d[4], dz = box3d[5], rz = box3d[6];
+  float cz = box3d[2];
+  float dx = box3d[3], dy = box3d[4], dz = box3d[5];
   // shift to the center since cz in box3d is the bottom center
   cz += dz / 2.0;
 
   if ((z - cz) > (dz / 2.0) || (z - cz) < -(dz / 2.0)) {
     return 0;
   }
-  lidarToLocalCoords(x - cx, y - cy, rz, local_x, local_y);
+  grid.localCoords(box_idx, x, y, &local_x, &local_y);
   int in_flag = (local_x > -dx / 2.0) & (local_x < dx / 2.0) &
                 (local_y > -dy / 2.0) & (local_y < dy / 2.0);
   return in_flag;
@@ -63,22 +60,32 @@ void assignPointsToBox3d(int batch_size, int pts_num, int boxes_num,
   // params boxes3d: (B, M, 7)
   // params pts_assign: (B, N, M): idx of the corresponding box3d, -1 means
   // background points
-  for (int bs_idx = 0; bs_idx < batch_size; bs_idx++) {
-    for (int box_idx = 0; box_idx < boxes_num; box_idx++) {
-      for (int pt_idx = 0; pt_idx < pts_num; pt_idx++) {
-        int assign_idx =
-            bs_idx * pts_num * boxes_num + pt_idx * boxes_num + box_idx;
-        pts_assign[assign_idx] = 0;
-
-        int box_offset = bs_idx * boxes_num * 7 + box_idx * 7;
-        int pt_offset = bs_idx * pts_num * 3 + pt_idx * 3;
-        float local_x = 0, local_y = 0;
-        int cur_in_flag = checkPointInBox3d(
-            xyz + pt_offset, boxes3d + box_offset, local_x, local_y);
-        pts_assign[assign_idx] = cur_in_flag;
-      }
+  std::vector<BoxGrid> grids(batch_size);
+  parallelForChunks(batch_size, 1, [&](size_t, size_t begin, size_t end) {
+    for (size_t bs_idx = begin; bs_idx < end; ++bs_idx) {
+      // rotation terms from std::cos(float) and std::sin(float)
+      grids[bs_idx].build(boxes3d + bs_idx * boxes_num * 7, boxes_num, true);
     }
-  }
+  });
+  parallelForChunks(
+      (size_t)batch_size * pts_num, kRoipointGrain,
+      [&](size_t, size_t begin, size_t end) {
+        for (size_t pt = begin; pt < end; ++pt) {
+          const int bs_idx = pt / pts_num;
+          const float *cur_pt = xyz + pt * 3;
+          const float *cur_boxes = boxes3d + bs_idx * boxes_num * 7;
+          int *cur_assign = pts_assign + pt * boxes_num;
+          std::fill(cur_assign, cur_assign + boxes_num, 0);
+          grids[bs_idx].forEachCandidate(
+              cur_pt[0], cur_pt[1], [&](int64_t box_idx) {
+                float local_x = 0, local_y = 0;
+                cur_assign[box_idx] =
+                    checkPointInBox3d(cur_pt, cur_boxes + box_idx * 7,
+                                      grids[bs_idx], box_idx, local_x, local_y);
+                return false;
+              });
+        }
+      });
 }
 
 void getPooledIdx(int batch_size, int pts_num, int boxes_num,
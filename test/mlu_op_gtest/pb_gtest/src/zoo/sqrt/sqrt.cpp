@@ -22,6 +22,9 @@
  *************************************************************************/
 #include "sqrt.h"
 
+#include "host_math.h"
+#include "parallel_for.h"
+
 namespace mluoptest {
 
 void SqrtExecutor::paramCheck() {
@@ -54,9 +57,12 @@ void SqrtExecutor::cpuCompute() {
   auto count1 = parser_->getInputDataCount(0);
   auto count2 = parser_->getOutputDataCount(0);
 
-  for (size_t i = 0; i < count1; ++i) {
-    cpu_fp32_output_[0][i] = sqrt(cpu_fp32_input_[0][i]);
-  }
+  const float *x = cpu_fp32_input_[0];
+  float *y = cpu_fp32_output_[0];
+  parallelForElements(count1, 2 * sizeof(float),
+                      [&](size_t begin, size_t end) {
+                        hostSqrt(x + begin, y + begin, end - begin);
+                      });
 }
 
 int64_t SqrtExecutor::getTheoryOps() {
@@ -22,6 +22,8 @@
  *************************************************************************/
 #include "sqrt_backward.h"
 
+#include "parallel_for.h"
+
 namespace mluoptest {
 
 void SqrtBackwardExecutor::paramCheck() {
@@ -53,10 +55,14 @@ void SqrtBackwardExecutor::cpuCompute() {
   auto count2 = parser_->getInputDataCount(1);
   GTEST_CHECK(count1 == count2);
 
-  for (size_t i = 0; i < count1; ++i) {
-    cpu_fp32_output_[0][i] =
-        0.5 * cpu_fp32_input_[1][i] * (1.0 / cpu_fp32_input_[0][i]);
-  }
+  const float *y = cpu_fp32_input_[0];
+  const float *dy = cpu_fp32_input_[1];
+  float *dx = cpu_fp32_output_[0];
+  parallelForElements(count1, 3 * sizeof(float), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      dx[i] = 0.5 * dy[i] * (1.0 / y[i]);
+    }
+  });
 }
 
 int64_t SqrtBackwardExecutor::getTheoryOps() {
@@ -24,6 +24,8 @@
 
 #include <memory>
 
+#include "channel_reduce.h"
+
 namespace mluoptest {
 
 void cpuSyncBatchNormBackwardElemt(const float *x, const float *diff_y,
@@ -32,21 +34,26 @@ void cpuSyncBatchNormBackwardElemt(const float *x, const float *diff_y,
                                    const float *mean_dy_xmu, float *diff_x,
                                    const int len_x, const int len_c) {
   int len_nhw = len_x / len_c;
-  for (int ci = 0; ci < len_c; ++ci) {
-    for (int i = 0; i < len_nhw; ++i) {
-      if (weight == nullptr) {
-        diff_x[i * len_c + ci] = (diff_y[i * len_c + ci] - mean_dy[ci] -
-                                  (x[i * len_c + ci] - mean[ci]) * invstd[ci] *
-                                      invstd[ci] * mean_dy_xmu[ci]) *
-                                 invstd[ci];
-      } else {
-        diff_x[i * len_c + ci] = (diff_y[i * len_c + ci] - mean_dy[ci] -
-                                  (x[i * len_c + ci] - mean[ci]) * invstd[ci] *
-                                      invstd[ci] * mean_dy_xmu[ci]) *
-                                 weight[ci] * invstd[ci];
+  // NHWC rows are walked contiguously and in parallel.
+  channelRows(len_nhw, len_c, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      for (int ci = 0; ci < len_c; ++ci) {
+        if (weight == nullptr) {
+          diff_x[i * len_c + ci] =
+              (diff_y[i * len_c + ci] - mean_dy[ci] -
+               (x[i * len_c + ci] - mean[ci]) * invstd[ci] * invstd[ci] *
+                   mean_dy_xmu[ci]) *
+              invstd[ci];
+        } else {
+          diff_x[i * len_c + ci] =
+              (diff_y[i * len_c + ci] - mean_dy[ci] -
+               (x[i * len_c + ci] - mean[ci]) * invstd[ci] * invstd[ci] *
+                   mean_dy_xmu[ci]) *
+              weight[ci] * invstd[ci];
+        }
       }
     }
-  }
+  });
 }
 
 void SyncBatchNormBackwardElemtExecutor::paramCheck() {
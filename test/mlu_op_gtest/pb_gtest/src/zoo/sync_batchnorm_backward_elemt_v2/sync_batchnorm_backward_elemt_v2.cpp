@@ -22,6 +22,10 @@
  *************************************************************************/
 #include "sync_batchnorm_backward_elemt_v2.h"
 
+#include <vector>
+
+#include "channel_reduce.h"
+
 namespace mluoptest {
 
 void cpuSyncBatchnormBackwardElemt(const float *diff_y, const float *x,
@@ -31,23 +35,31 @@ void cpuSyncBatchnormBackwardElemt(const float *diff_y, const float *x,
                                    float *diff_x, const int len_x,
                                    const int len_c) {
   int len_nhw = len_x / len_c;
+  std::vector<float> sum_dy_temp(len_c), sum_dy_xmu_temp(len_c);
   for (int ci = 0; ci < len_c; ++ci) {
-    float sum_dy_temp = sum_dy[ci] / sum;
-    float sum_dy_xmu_temp = sum_dy_xmu[ci] / sum;
-    for (int i = 0; i < len_nhw; ++i) {
-      if (weight == nullptr) {
-        diff_x[i * len_c + ci] = (diff_y[i * len_c + ci] - sum_dy_temp -
-                                  (x[i * len_c + ci] - mean[ci]) * invstd[ci] *
-                                      invstd[ci] * sum_dy_xmu_temp) *
-                                 invstd[ci];
-      } else {
-        diff_x[i * len_c + ci] = (diff_y[i * len_c + ci] - sum_dy_temp -
-                                  (x[i * len_c + ci] - mean[ci]) * invstd[ci] *
-                                      invstd[ci] * sum_dy_xmu_temp) *
-                                 weight[ci] * invstd[ci];
+    sum_dy_temp[ci] = sum_dy[ci] / sum;
+    sum_dy_xmu_temp[ci] = sum_dy_xmu[ci] / sum;
+  }
+  // NHWC rows are walked contiguously and in parallel.
+  channelRows(len_nhw, len_c, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      for (int ci = 0; ci < len_c; ++ci) {
+        if (weight == nullptr) {
+          diff_x[i * len_c + ci] =
+              (diff_y[i * len_c + ci] - sum_dy_temp[ci] -
+               (x[i * len_c + ci] - mean[ci]) * invstd[ci] * invstd[ci] *
+                   sum_dy_xmu_temp[ci]) *
+              invstd[ci];
+        } else {
+          diff_x[i * len_c + ci] =
+              (diff_y[i * len_c + ci] - sum_dy_temp[ci] -
+               (x[i * len_c + ci] - mean[ci]) * invstd[ci] * invstd[ci] *
+                   sum_dy_xmu_temp[ci]) *
+              weight[ci] * invstd[ci];
+        }
       }
     }
-  }
+  });
 }
 
 void SyncBatchnormBackwardElemtV2Executor::paramCheck() {
@@ -22,6 +22,10 @@
  *************************************************************************/
 #include "sync_batchnorm_backward_reduce.h"
 
+#include <vector>
+
+#include "channel_reduce.h"
+
 namespace mluoptest {
 
 void SyncBatchnormBackwardReduceExecutor::paramCheck() {
@@ -188,30 +192,32 @@ void cpuGetSyncBnBkwReduceOuput(
                   "should not be zero";
     return;
   }
-  int len_nhw = len_x / len_c;
-  float *x_hat = new float[len_x];
-  float *xmu = new float[len_x];
-
-  for (int ci = 0; ci < len_c; ++ci) {
-    const float *xc = x + ci;
-    float *x_hat_c = x_hat + ci;
-    float *xmu_c = xmu + ci;
-    for (int xi = 0; xi < len_nhw; ++xi) {
-      xmu_c[xi * len_c] = xc[xi * len_c] - mean[ci];
-      x_hat_c[xi * len_c] = xmu_c[xi * len_c] * invstd[ci];
+  const int64_t len_nhw = len_x / len_c;
+  // sums holds dweight, dbias and meandyxmu of every channel. NHWC rows are
+  // streamed contiguously into per-block sums, see channelSums.
+  std::vector<double> sums(3 * len_c);
+  auto add_rows = [&](int64_t begin, int64_t end, double *block) {
+    double *dweight = block;
+    double *dbias = block + len_c;
+    double *meandyxmu = block + 2 * len_c;
+    for (int64_t i = begin; i < end; ++i) {
+      const float *xr = x + i * len_c;
+      const float *dzr = diff_z + i * len_c;
+      for (int ci = 0; ci < len_c; ++ci) {
+        const float xmu = xr[ci] - mean[ci];
+        const float x_hat = xmu * invstd[ci];
+        dweight[ci] += x_hat * dzr[ci];
+        dbias[ci] += dzr[ci];
+        meandyxmu[ci] += xmu * dzr[ci];
+      }
     }
-  }
+  };
+  channelSums(len_nhw, 3 * len_c, add_rows, sums.data());
 
   for (int ci = 0; ci < len_c; ++ci) {
-    const float *x_hat_c = x_hat + ci;
-    const float *xmu_c = xmu + ci;
-    const float *dzc = diff_z + ci;
-    double dweight = 0, dbias = 0, meandyxmu = 0;
-    for (int i = 0; i < len_nhw; i++) {
-      dweight = dweight + x_hat_c[i * len_c] * dzc[i * len_c];
-      dbias = dbias + dzc[i * len_c];
-      meandyxmu = meandyxmu + xmu_c[i * len_c] * dzc[i * len_c];
-    }
+    const double dweight = sums[ci];
+    const double dbias = sums[len_c + ci];
+    const double meandyxmu = sums[2 * len_c + ci];
     if (needs_input_grad0 == true) {
       // diff_weight[ci] = dweight;
       // diff_bias[ci] = dbias;
@@ -225,8 +231,6 @@ void cpuGetSyncBnBkwReduceOuput(
       diff_bias[ci] = dbias;
     }
   }
-  delete[] x_hat;
-  delete[] xmu;
 }
 
 void SyncBatchnormBackwardReduceExecutor::cpuCompute() {
@@ -22,6 +22,8 @@
  *************************************************************************/
 #include "sync_batchnorm_elemt.h"
 
+#include "channel_reduce.h"
+
 namespace mluoptest {
 
 void SyncBatchnormElemtExecutor::paramCheck() {
@@ -69,14 +71,16 @@ void cpuSyncBNElemt(const float *x, const float *mean, const float *invstd,
                     const int len_c) {
   int len_nhw = len_x / len_c;
 
-  for (int h = 0; h < len_nhw; ++h) {
-    for (int c = 0; c < len_c; ++c) {
-      y[h * len_c + c] = (x[h * len_c + c] - mean[c]) * invstd[c];
-      if (weight != nullptr && bias != nullptr) {
-        y[h * len_c + c] = y[h * len_c + c] * weight[c] + bias[c];
+  channelRows(len_nhw, len_c, [&](int64_t begin, int64_t end) {
+    for (int64_t h = begin; h < end; ++h) {
+      for (int c = 0; c < len_c; ++c) {
+        y[h * len_c + c] = (x[h * len_c + c] - mean[c]) * invstd[c];
+        if (weight != nullptr && bias != nullptr) {
+          y[h * len_c + c] = y[h * len_c + c] * weight[c] + bias[c];
+        }
       }
     }
-  }
+  });
 }
 
 void SyncBatchnormElemtExecutor::cpuCompute() {
@@ -22,6 +22,10 @@
  *************************************************************************/
 #include "sync_batchnorm_gather_stats_with_counts.h"
 
+#include <vector>
+
+#include "channel_reduce.h"
+
 namespace mluoptest {
 
 void SyncBatchnormGatherStatsWithCountsExecutor::paramCheck() {
@@ -171,13 +175,10 @@ void SyncBatchnormGatherStatsWithCountsExecutor::setMiscellaneousParam() {
   }
 }
 
-void kahan(float input, float &sum, float &delta) {
-  float y = input - delta;
-  float t = sum + y;
-  delta = t - sum - y;
-  sum = t;
-}
-
+// Row xi of mean_all and invstd_all holds the moments of the count_all[xi]
+// elements seen by one device. The rows are streamed contiguously and
+// merged into per-channel moments with Chan's update (B.P.Welford algo),
+// see channelMoments.
 void cpuBatchNormForwardTraining(float *mean_all, float *invstd_all,
                                  float *moving_mean, float *moving_var,
                                  const float momentum, const float eps,
@@ -185,28 +186,30 @@ void cpuBatchNormForwardTraining(float *mean_all, float *invstd_all,
                                  float *mean, float *invstd,
                                  const int len_mean_all, const int len_c,
                                  const int output_num) {
-  int len_n = len_mean_all / len_c;
-  int len_all = 0;
-  for (int i = 0; i < len_n; ++i) {
-    len_all += count_all[i];
-  }
+  const int64_t len_n = len_mean_all / len_c;
+  std::vector<WelfordMoments> moments(len_c);
+  auto merge_rows = [&](int64_t begin, int64_t end, WelfordMoments *block) {
+    for (int64_t xi = begin; xi < end; ++xi) {
+      const float *mean_row = mean_all + xi * len_c;
+      const float *invstd_row = invstd_all + xi * len_c;
+      for (int ci = 0; ci < len_c; ++ci) {
+        WelfordMoments part;
+        part.count = count_all[xi];
+        part.mean = mean_row[ci];
+        const double var =
+            1.0 / ((double)invstd_row[ci] * invstd_row[ci]) - eps;
+        part.m2 = var * part.count;
+        welfordMerge(block + ci, part);
+      }
+    }
+  };
+  channelMoments(len_n, len_c, merge_rows, moments.data());
 
-  // B.P.Welford algo
   for (int ci = 0; ci < len_c; ++ci) {
-    float c_sum = 0.0, c_ssum = 0.0;
-    const float *meanc = mean_all + ci;
-    const float *invstdc = invstd_all + ci;
-    float sum = 0.0, ssum = 0.0, temp = 0.0;
-    for (int xi = 0; xi < len_n; ++xi) {
-      kahan(meanc[xi * len_c] * count_all[xi], sum, c_sum);
-      temp = 1.0f / (invstdc[xi * len_c] * invstdc[xi * len_c]) +
-             meanc[xi * len_c] * meanc[xi * len_c] - eps;
-      kahan(temp * count_all[xi], ssum, c_ssum);
-    }
-    mean[ci] = sum / len_all;
-    invstd[ci] = 1.0f / sqrt(ssum / len_all - mean[ci] * mean[ci] + eps);
-    float unbiased_var =
-        (1.0f / (invstd[ci] * invstd[ci]) - eps) * len_all / (len_all - 1);
+    const WelfordMoments &m = moments[ci];
+    mean[ci] = m.mean;
+    invstd[ci] = 1.0f / sqrt(m.variance() + eps);
+    float unbiased_var = m.m2 / (m.count - 1);
     if (moving_mean != nullptr && moving_var != nullptr && output_num == 4) {
       m_mean[ci] = momentum * mean[ci] + (1 - momentum) * moving_mean[ci];
       m_var[ci] = momentum * unbiased_var + (1 - momentum) * moving_var[ci];
@@ -42,6 +42,8 @@ class SyncBatchnormGatherStatsWithCountsExecutor : public Executor {
   void cpuCompute();
   void setMiscellaneousParam() override;
   int64_t getTheoryOps() override;
+  // 1: moments merged with Welford/Chan updates
+  int64_t cpuComputeVersion() override { return 1; }
   std::set<Evaluator::Formula> getCriterionsUse() const override;
 };
 
@@ -22,6 +22,10 @@
  *************************************************************************/
 #include "sync_batchnorm_stats.h"
 
+#include <vector>
+
+#include "channel_reduce.h"
+
 namespace mluoptest {
 
 void SyncBatchnormStatsExecutor::paramCheck() {
@@ -78,39 +82,22 @@ void SyncBatchnormStatsExecutor::compute() {
   interface_timer_.stop();
 }
 
-void kahan_stats(float input, float &sum, float &delta) {
-  float y = input - delta;
-  float t = sum + y;
-  delta = t - sum - y;
-  sum = t;
-}
-
+// NHWC rows are streamed contiguously into per-block Welford moments, see
+// channelMoments.
 void cpuSyncBatchNormStats(const float *x, const float eps, float *mean,
                            float *invstd, const int len_x, const int len_c) {
-  float len_nhw = len_x / len_c;
-
-  bool flag_free = false;
-  if (mean == nullptr && invstd == nullptr) {
-    mean = new float[len_c];
-    invstd = new float[len_c];
-    flag_free = true;
-  }
-
+  const int64_t len_nhw = len_x / len_c;
+  std::vector<WelfordMoments> moments(len_c);
+  channelMoments(len_nhw, len_c,
+                 [&](int64_t begin, int64_t end, WelfordMoments *block) {
+                   for (int64_t xi = begin; xi < end; ++xi) {
+                     welfordAddRow(x + xi * len_c, len_c, block);
+                   }
+                 },
+                 moments.data());
   for (int ci = 0; ci < len_c; ++ci) {
-    float sum = 0, ssum = 0;
-    float c_sum = 0.0, c_ssum = 0.0;
-    const float *xc = x + ci;
-    for (int xi = 0; xi < len_nhw; ++xi) {
-      kahan_stats(xc[xi * len_c], sum, c_sum);
-      kahan_stats(xc[xi * len_c] * xc[xi * len_c], ssum, c_ssum);
-    }
-    mean[ci] = sum / len_nhw;
-    invstd[ci] = 1.0f / sqrt(ssum / len_nhw - (mean[ci] * mean[ci]) + eps);
-  }
-
-  if (flag_free == true) {
-    delete[] mean;
-    delete[] invstd;
+    mean[ci] = moments[ci].mean;
+    invstd[ci] = 1.0f / sqrt(moments[ci].variance() + eps);
   }
 }
 
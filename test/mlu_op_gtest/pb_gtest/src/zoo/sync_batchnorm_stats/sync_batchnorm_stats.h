@@ -39,6 +39,8 @@ class SyncBatchnormStatsExecutor : public Executor {
   void compute();
   void cpuCompute();
   int64_t getTheoryOps() override;
+  // 1: moments merged with Welford/Chan updates
+  int64_t cpuComputeVersion() override { return 1; }
 
  private:
   size_t workspace_size_ = 0;
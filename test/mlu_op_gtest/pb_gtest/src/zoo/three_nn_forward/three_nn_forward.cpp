@@ -25,8 +25,11 @@
 #include "three_nn_forward.h"
 
 #include "mlu_op.h"
+#include "parallel_for.h"
+#include "point_grid.h"
 
 namespace mluoptest {
+constexpr size_t kThreeNnGrain = 256;
 
 void ThreeNnForwardExecutor::paramCheck() {
   GTEST_CHECK(parser_->inputs().size() == 2,
@@ -86,60 +89,29 @@ void ThreeNnForwardExecutor::cpuCompute() {
   const int64_t b = unknown_shape[0];
   const int64_t n = unknown_shape[1];
   const int64_t m = known_shape[1];
-  auto unknown = cpu_fp32_input_[0];
-  auto known = cpu_fp32_input_[1];
-  auto dist2 = cpu_fp32_output_[0];
-  float *dist2_start = (float *)cpu_fp32_output_[0];
-  float *idx = (float *)cpu_fp32_output_[1];
-  float *idx_start = (float *)cpu_fp32_output_[1];
-
-  for (int64_t i = 0; i < b; ++i) {
-    for (int64_t j = 0; j < n; ++j) {
-      float ux = unknown[j * 3 + 0];
-      float uy = unknown[j * 3 + 1];
-      float uz = unknown[j * 3 + 2];
-      double best1 = 1e40;
-      double best2 = 1e40;
-      double best3 = 1e40;
-      int besti1 = 0;
-      int besti2 = 0;
-      int besti3 = 0;
-
-      for (int k = 0; k < m; ++k) {
-        float x = known[k * 3 + 0];
-        float y = known[k * 3 + 1];
-        float z = known[k * 3 + 2];
-        double d =
-            (ux - x) * (ux - x) + (uy - y) * (uy - y) + (uz - z) * (uz - z);
-        if (d < best1) {
-          best3 = best2;
-          besti3 = besti2;
-          best2 = best1;
-          besti2 = besti1;
-          best1 = d;
-          besti1 = k;
-        } else if (d < best2) {
-          best3 = best2;
-          besti3 = besti2;
-          best2 = d;
-          besti2 = k;
-        } else if (d < best3) {
-          best3 = d;
-          besti3 = k;
-        }
-      }
-      dist2[j * 3 + 0] = float(best1);
-      dist2[j * 3 + 1] = float(best2);
-      dist2[j * 3 + 2] = float(best3);
-      idx[j * 3 + 0] = besti1;
-      idx[j * 3 + 1] = besti2;
-      idx[j * 3 + 2] = besti3;
+  const float *unknown = cpu_fp32_input_[0];
+  const float *known = cpu_fp32_input_[1];
+  float *dist2 = cpu_fp32_output_[0];
+  float *idx = cpu_fp32_output_[1];
+
+  std::vector<PointGrid> grids(b);
+  parallelForChunks(b, 1, [&](size_t, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      grids[i].build(known + i * m * 3, m);
     }
-    unknown += n * 3;
-    known += m * 3;
-    dist2 += n * 3;
-    idx += n * 3;
-  }
+  });
+  parallelForChunks(
+      (size_t)(b * n), kThreeNnGrain, [&](size_t, size_t begin, size_t end) {
+        for (size_t j = begin; j < end; ++j) {
+          double best[3];
+          int besti[3];
+          grids[j / n].threeNearest(unknown + j * 3, best, besti);
+          for (int k = 0; k < 3; ++k) {
+            dist2[j * 3 + k] = float(best[k]);
+            idx[j * 3 + k] = besti[k];
+          }
+        }
+      });
 }
 
 int64_t ThreeNnForwardExecutor::getTheoryOps() {
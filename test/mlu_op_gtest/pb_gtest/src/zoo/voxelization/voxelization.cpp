@@ -24,6 +24,7 @@
 
 #include "kernels/kernel.h"
 #include "mlu_op.h"
+#include "cpu_voxelization.h"
 
 namespace mluoptest {
 void VoxelizationExecutor::paramCheck() {
@@ -111,212 +112,6 @@ void VoxelizationExecutor::workspaceFree() {
   }
 }
 
-void dynamicVoxelize(const float *points, int32_t *coors, const float voxel_x,
-                     const float voxel_y, const float voxel_z,
-                     const float coors_x_min, const float coors_y_min,
-                     const float coors_z_min, const float coors_x_max,
-                     const float coors_y_max, const float coors_z_max,
-                     const int32_t grid_x, const int32_t grid_y,
-                     const int32_t grid_z, const size_t num_points,
-                     const size_t num_features, const size_t NDim) {
-  for (size_t index = 0; index < num_points; ++index) {
-    const float *points_offset = points + index * num_features;
-    int32_t *coors_offset = coors + index * NDim;
-    int32_t c_x = floorf((points_offset[0] - coors_x_min) / voxel_x);
-    if (c_x < 0 || c_x >= grid_x) {
-      coors_offset[0] = -1;
-      continue;
-    }
-
-    int32_t c_y = floorf((points_offset[1] - coors_y_min) / voxel_y);
-    if (c_y < 0 || c_y >= grid_y) {
-      coors_offset[0] = -1;
-      coors_offset[1] = -1;
-      continue;
-    }
-
-    int32_t c_z = floorf((points_offset[2] - coors_z_min) / voxel_z);
-    if (c_z < 0 || c_z >= grid_z) {
-      coors_offset[0] = -1;
-      coors_offset[1] = -1;
-      coors_offset[2] = -1;
-    } else {
-      coors_offset[0] = c_z;
-      coors_offset[1] = c_y;
-      coors_offset[2] = c_x;
-    }
-  }
-}
-
-void pointToVoxelidx(const int32_t *coor, int32_t *point_to_voxelidx,
-                     int32_t *point_to_pointidx, const int32_t max_points,
-                     const int32_t max_voxels, const size_t num_points,
-                     const size_t NDim) {
-  for (size_t index = 0; index < num_points; ++index) {
-    const int32_t *coor_offset = coor + index * NDim;
-    if (coor_offset[0] == -1) {
-      point_to_pointidx[index] = -1;
-      point_to_voxelidx[index] = -1;
-      continue;
-    }
-
-    int32_t num = 0;
-    int32_t coor_x = coor_offset[0];
-    int32_t coor_y = coor_offset[1];
-    int32_t coor_z = coor_offset[2];
-
-    for (int i = 0; i < index; ++i) {
-      auto prev_coor = coor + i * NDim;
-      if (prev_coor[0] == -1) {
-        continue;
-      }
-
-      if ((prev_coor[0] == coor_x) && (prev_coor[1] == coor_y) &&
-          (prev_coor[2] == coor_z)) {
-        num++;
-        if (num == 1) {
-          point_to_pointidx[index] = i;
-        } else if (num >= max_points) {
-          break;
-        }
-      }
-    }
-    if (num == 0) {
-      point_to_pointidx[index] = index;
-    }
-    if (num < max_points) {
-      point_to_voxelidx[index] = num;
-    } else {
-      point_to_voxelidx[index] = -1;
-    }
-  }
-}
-
-void determinVoxelNum(float *num_points_per_voxel, int32_t *point_to_voxelidx,
-                      int32_t *point_to_pointidx, int32_t *coor_to_voxelidx,
-                      float *voxel_num, const int32_t max_points,
-                      const int32_t max_voxels, const size_t num_points) {
-  for (size_t i = 0; i < num_points; ++i) {
-    int point_pos_in_voxel = point_to_voxelidx[i];
-    coor_to_voxelidx[i] = -1;
-
-    if (point_pos_in_voxel == -1) {
-      continue;
-    } else if (point_pos_in_voxel == 0) {
-      int voxelidx = voxel_num[0];
-      if (voxel_num[0] >= max_voxels) continue;
-      voxel_num[0] += 1;
-      coor_to_voxelidx[i] = voxelidx;
-      num_points_per_voxel[voxelidx] = 1;
-    } else {
-      int point_idx = point_to_pointidx[i];
-      int voxelidx = coor_to_voxelidx[point_idx];
-      if (voxelidx != -1) {
-        coor_to_voxelidx[i] = voxelidx;
-        num_points_per_voxel[voxelidx] += 1;
-      }
-    }
-  }
-}
-
-void assignPointToVoxel(const float *points, int32_t *point_to_voxelidx,
-                        int32_t *coor_to_voxelidx, float *voxels,
-                        const int32_t max_points, const size_t num_features,
-                        const size_t num_points, const size_t NDim) {
-  for (size_t thread_idx = 0; thread_idx < num_points * num_features;
-       ++thread_idx) {
-    int32_t index = thread_idx / num_features;
-    int32_t num = point_to_voxelidx[index];
-    int32_t voxelidx = coor_to_voxelidx[index];
-    if (num > -1 && voxelidx > -1) {
-      float *voxels_offset =
-          voxels + voxelidx * max_points * num_features + num * num_features;
-
-      int32_t k = thread_idx % num_features;
-      voxels_offset[k] = points[thread_idx];
-    }
-  }
-}
-
-void assignVoxelCoors(int32_t *temp_coors, int32_t *point_to_voxelidx,
-                      int32_t *coor_to_voxelidx, float *coors,
-                      const size_t num_points, const size_t NDim) {
-  for (size_t thread_idx = 0; thread_idx < num_points * NDim; ++thread_idx) {
-    int32_t index = thread_idx / NDim;
-    int32_t num = point_to_voxelidx[index];
-    int32_t voxelidx = coor_to_voxelidx[index];
-    if (num == 0 && voxelidx > -1) {
-      float *coors_offset = coors + voxelidx * NDim;
-      int32_t k = thread_idx % NDim;
-      coors_offset[k] = temp_coors[thread_idx];
-    }
-  }
-}
-
-void VoxelizationExecutor::deterministic_hard_voxelize(
-    const float *points, const float *voxel_size, const float *coors_range,
-    const int32_t num_points, const int32_t num_features,
-    const int32_t max_points, const int32_t max_voxels, const int32_t NDim,
-    float *voxels, float *coors, float *num_points_per_voxel,
-    float *voxel_num) {
-  const float voxel_x = voxel_size[0];
-  const float voxel_y = voxel_size[1];
-  const float voxel_z = voxel_size[2];
-  const float coors_x_min = coors_range[0];
-  const float coors_y_min = coors_range[1];
-  const float coors_z_min = coors_range[2];
-  const float coors_x_max = coors_range[3];
-  const float coors_y_max = coors_range[4];
-  const float coors_z_max = coors_range[5];
-
-  const int32_t grid_x = round((coors_x_max - coors_x_min) / voxel_x);
-  const int32_t grid_y = round((coors_y_max - coors_y_min) / voxel_y);
-  const int32_t grid_z = round((coors_z_max - coors_z_min) / voxel_z);
-
-  int32_t count = num_points * NDim;
-  int32_t *temp_coors =
-      (int32_t *)cpu_runtime_.allocate(count * sizeof(int32_t));
-
-  dynamicVoxelize(points, temp_coors, voxel_x, voxel_y, voxel_z, coors_x_min,
-                  coors_y_min, coors_z_min, coors_x_max, coors_y_max,
-                  coors_z_max, grid_x, grid_y, grid_z, num_points, num_features,
-                  NDim);
-
-  count = num_points;
-  int32_t *point_to_pointidx =
-      (int32_t *)cpu_runtime_.allocate(count * sizeof(int32_t));
-  count = num_points;
-  int32_t *point_to_voxelidx =
-      (int32_t *)cpu_runtime_.allocate(count * sizeof(int32_t));
-
-  pointToVoxelidx(temp_coors, point_to_voxelidx, point_to_pointidx, max_points,
-                  max_voxels, num_points, NDim);
-
-  count = num_points;
-  int32_t *coor_to_voxelidx =
-      (int32_t *)cpu_runtime_.allocate(count * sizeof(int32_t));
-
-  *voxel_num = 0;
-  determinVoxelNum(num_points_per_voxel, point_to_voxelidx, point_to_pointidx,
-                   coor_to_voxelidx, voxel_num, max_points, max_voxels,
-                   num_points);
-
-  assignPointToVoxel(points, point_to_voxelidx, coor_to_voxelidx, voxels,
-                     max_points, num_features, num_points, NDim);
-
-  assignVoxelCoors(temp_coors, point_to_voxelidx, coor_to_voxelidx, coors,
-                   num_points, NDim);
-
-  cpu_runtime_.deallocate(temp_coors);
-  temp_coors = nullptr;
-  cpu_runtime_.deallocate(point_to_pointidx);
-  point_to_pointidx = nullptr;
-  cpu_runtime_.deallocate(point_to_voxelidx);
-  point_to_voxelidx = nullptr;
-  cpu_runtime_.deallocate(coor_to_voxelidx);
-  coor_to_voxelidx = nullptr;
-}
-
 void VoxelizationExecutor::cpuCompute() {
   VLOG(4) << "[VoxelizationExecutor] call cpuCompute() Begin.";
   // get params
@@ -341,9 +136,9 @@ void VoxelizationExecutor::cpuCompute() {
   float *voxel_num = cpu_fp32_output_[3];
 
   if (deterministic == true) {
-    deterministic_hard_voxelize(points, voxel_size, coors_range, num_points,
-                                num_features, max_points, max_voxels, NDim,
-                                voxels, coors, num_points_per_voxel, voxel_num);
+    hardVoxelizeCpu(points, voxel_size, coors_range, num_points, num_features,
+                    max_points, max_voxels, NDim, voxels, coors,
+                    num_points_per_voxel, voxel_num);
   } else {
     VLOG(4) << "[VoxelizationExecutor] non-deterministic not supported!";
   }
@@ -39,15 +39,10 @@ class VoxelizationExecutor : public Executor {
   void workspaceFree() override;
   int64_t getTheoryIoSize() override;
   int64_t getTheoryOps() override;
+  int64_t cpuComputeVersion() override { return 0; }
 
  private:
   size_t workspace_size_ = 0;
-  void deterministic_hard_voxelize(
-      const float *points, const float *voxel_size, const float *coors_range,
-      const int32_t num_points, const int32_t num_features,
-      const int32_t max_points, const int32_t max_voxels, const int32_t NDim,
-      float *voxels, float *coors, float *num_points_per_voxel,
-      float *voxel_num);
 };
 
 }  // namespace mluoptest
@@ -0,0 +1,87 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <cstring>
+#include <vector>
+
+#include "host_bench.h"
+#include "kernels/fft/fft.h"
+
+namespace {
+
+const int kFFTLengths[] = {1000, 1024, 4096, 6000, 65536};
+const int kFFTLengthNum = sizeof(kFFTLengths) / sizeof(kFFTLengths[0]);
+
+}  // namespace
+
+// plan-time factorization, run once per fft plan and per dimension.
+HOST_BENCH(FFTTwoStepFactor) {
+  mluOpHandle_t handle = mluop_bench::getFakeHandle();
+  mluOpFFTStruct plan;
+  memset(&plan, 0, sizeof(plan));
+  plan.fft_type = CNFFT_COMPLEX_FLOAT2COMPLEX_FLOAT;
+  std::vector<int> factors(FFT_MAXFACTORS);
+  for (int i = 0; i < kFFTLengthNum; ++i) {
+    HOST_BENCH_CHECK(fftTwoStepFactor(handle, &plan, kFFTLengths[i],
+                                      factors.data(), 1, plan.fft_type) ==
+                     MLUOP_STATUS_SUCCESS);
+  }
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    fftTwoStepFactor(handle, &plan, kFFTLengths[i % kFFTLengthNum],
+                     factors.data(), 1, plan.fft_type);
+    mluop_bench::doNotOptimize(factors[0]);
+  }
+}
+
+// fftGenerateTwiddles itself writes into cnrtHostMalloc memory, so the line
+// generator it is made of is measured on a plain host buffer instead.
+HOST_BENCH(FFTGenerateTwiddlesLine) {
+  const int radix = 16, butterfly_num = 256, nfft = 4096;
+  std::vector<float> twiddles(2 * (radix - 1) * butterfly_num);
+  HOST_BENCH_CHECK(fftGenerateTwiddlesLine<float>(twiddles.data(),
+                                                  butterfly_num, 1, radix,
+                                                  nfft, FFT_FORWARD) ==
+                   MLUOP_STATUS_SUCCESS);
+  // the first butterfly does not rotate, real parts come before imaginary.
+  HOST_BENCH_CHECK(twiddles[0] == 1.f &&
+                   twiddles[butterfly_num * (radix - 1)] == 0.f);
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    fftGenerateTwiddlesLine<float>(twiddles.data(), butterfly_num, 1, radix,
+                                   nfft, FFT_FORWARD);
+    mluop_bench::doNotOptimize(twiddles[0]);
+  }
+  state.setBytesPerIteration(twiddles.size() * sizeof(float));
+}
+
+HOST_BENCH(FFTGenerateDftMatrix) {
+  const int radix = 64;
+  std::vector<float> dft_matrix(2 * radix * radix);
+  HOST_BENCH_CHECK(fftGenerateDftMatrixKernel<float>(dft_matrix.data(), radix,
+                                                     FFT_FORWARD) ==
+                   MLUOP_STATUS_SUCCESS);
+  HOST_BENCH_CHECK(dft_matrix[0] == 1.f && dft_matrix[radix * radix] == 0.f);
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    fftGenerateDftMatrixKernel<float>(dft_matrix.data(), radix, FFT_FORWARD);
+    mluop_bench::doNotOptimize(dft_matrix[0]);
+  }
+  state.setBytesPerIteration(dft_matrix.size() * sizeof(float));
+}
@@ -0,0 +1,127 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "host_bench.h"
+#include "core/gen_case.h"
+
+namespace {
+
+const int kDumpNum = 4096;
+
+// padded strides, so the dim_stride fields are dumped as well.
+mluOpStatus_t createDesc(mluOpTensorDescriptor_t *desc) {
+  const int64_t dims[4] = {8, 64, 56, 56};
+  const int64_t strides[4] = {64 * 58 * 58, 58 * 58, 58, 1};
+  mluOpStatus_t status = mluOpCreateTensorDescriptor(desc);
+  if (status != MLUOP_STATUS_SUCCESS) {
+    return status;
+  }
+  return mluOpSetTensorDescriptorEx_v2(*desc, MLUOP_LAYOUT_NCHW,
+                                       MLUOP_DTYPE_FLOAT, 4, dims, strides);
+}
+
+// the same loop gen_case runs when a case is dumped with its data inline.
+template <typename Func>
+void dumpValues(mluop::gen_case::PbNode *node, const std::vector<float> &data,
+                Func get_string, std::ostringstream *case_file) {
+  case_file->str("");
+  void *ptr = (void *)data.data();
+  for (size_t j = 0; j < data.size(); ++j) {
+    *case_file << get_string(node, ptr, j) << "\n";
+  }
+}
+
+std::vector<float> dumpData() {
+  std::vector<float> data(kDumpNum);
+  for (int i = 0; i < kDumpNum; ++i) {
+    data[i] = (i % 97) * 0.37f - 11.f;
+  }
+  return data;
+}
+
+}  // namespace
+
+HOST_BENCH(GenCaseDescToStringPrototxt) {
+  mluOpTensorDescriptor_t desc;
+  HOST_BENCH_CHECK(createDesc(&desc) == MLUOP_STATUS_SUCCESS);
+  HOST_BENCH_CHECK(mluop::gen_case::descToString(desc, '\n').find(
+                       "dim_stride") != std::string::npos);
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    std::string str = mluop::gen_case::descToString(desc, '\n');
+    mluop_bench::doNotOptimize(str);
+  }
+  mluOpDestroyTensorDescriptor(desc);
+}
+
+HOST_BENCH(GenCaseDescToStringLog) {
+  mluOpTensorDescriptor_t desc;
+  HOST_BENCH_CHECK(createDesc(&desc) == MLUOP_STATUS_SUCCESS);
+  HOST_BENCH_CHECK(mluop::gen_case::descToString(desc, ' ').find(
+                       "dim_stride") != std::string::npos);
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    std::string str = mluop::gen_case::descToString(desc, ' ');
+    mluop_bench::doNotOptimize(str);
+  }
+  mluOpDestroyTensorDescriptor(desc);
+}
+
+HOST_BENCH(GenCaseDumpValueF) {
+  mluop::gen_case::PbNode node;
+  std::vector<float> data = dumpData();
+  std::ostringstream case_file;
+  auto get_string = [](mluop::gen_case::PbNode *node, void *ptr, size_t j) {
+    return node->get_dtype_value_string(MLUOP_DTYPE_FLOAT) +
+           node->get_data_string(MLUOP_DTYPE_FLOAT, ptr, j);
+  };
+  dumpValues(&node, data, get_string, &case_file);
+  const std::string dumped = case_file.str();
+  HOST_BENCH_CHECK(std::count(dumped.begin(), dumped.end(), '\n') ==
+                   kDumpNum);
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    dumpValues(&node, data, get_string, &case_file);
+    mluop_bench::doNotOptimize(case_file);
+  }
+  state.setBytesPerIteration(data.size() * sizeof(float));
+}
+
+HOST_BENCH(GenCaseDumpValueH) {
+  mluop::gen_case::PbNode node;
+  std::vector<float> data = dumpData();
+  std::ostringstream case_file;
+  auto get_string = [](mluop::gen_case::PbNode *node, void *ptr, size_t j) {
+    return "  value_h: " + node->get_data_hex_string(MLUOP_DTYPE_FLOAT, ptr, j);
+  };
+  dumpValues(&node, data, get_string, &case_file);
+  const std::string dumped = case_file.str();
+  HOST_BENCH_CHECK(std::count(dumped.begin(), dumped.end(), '\n') ==
+                   kDumpNum);
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    dumpValues(&node, data, get_string, &case_file);
+    mluop_bench::doNotOptimize(case_file);
+  }
+  state.setBytesPerIteration(data.size() * sizeof(float));
+}
@@ -0,0 +1,88 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <google/protobuf/text_format.h>
+#include <sstream>
+#include <string>
+
+#include "host_bench.h"
+#include "core/gen_case.h"
+#include "mlu_op_test.pb.h"
+
+namespace {
+
+const int kValueNum = 64 * 1024;
+
+// an abs case as gen_case dumps it with inline data, so the parse cost is the
+// one the gtest pays reading a case of kValueNum elements.
+std::string caseText() {
+  mluOpTensorDescriptor_t desc;
+  const int64_t dims[1] = {kValueNum};
+  mluOpCreateTensorDescriptor(&desc);
+  mluOpSetTensorDescriptor_v2(desc, MLUOP_LAYOUT_ARRAY, MLUOP_DTYPE_FLOAT, 1,
+                              dims);
+  std::stringstream case_file;
+  case_file << "op_name: \"abs\"\nop_type: ABS\n";
+  case_file << "input {\n  id: \"x\"\n"
+            << mluop::gen_case::descToString(desc, '\n');
+  for (int i = 0; i < kValueNum; ++i) {
+    case_file << "  value_f: " << std::to_string((i % 97) * 0.37f - 11.f)
+              << "\n";
+  }
+  case_file << "}\n";
+  case_file << "output {\n  id: \"y\"\n"
+            << mluop::gen_case::descToString(desc, '\n') << "}\n";
+  mluOpDestroyTensorDescriptor(desc);
+  return case_file.str();
+}
+
+}  // namespace
+
+HOST_BENCH(ParserPrototxt) {
+  std::string text = caseText();
+  mluoptest::Node node;
+  HOST_BENCH_CHECK(google::protobuf::TextFormat::ParseFromString(text, &node));
+  HOST_BENCH_CHECK(node.input_size() == 1 &&
+                   node.input(0).value_f_size() == kValueNum);
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    google::protobuf::TextFormat::ParseFromString(text, &node);
+    mluop_bench::doNotOptimize(node);
+  }
+  state.setBytesPerIteration(text.size());
+}
+
+HOST_BENCH(ParserPb) {
+  mluoptest::Node node;
+  std::string binary;
+  HOST_BENCH_CHECK(
+      google::protobuf::TextFormat::ParseFromString(caseText(), &node));
+  HOST_BENCH_CHECK(node.SerializeToString(&binary));
+  node.Clear();
+  HOST_BENCH_CHECK(node.ParseFromString(binary));
+  HOST_BENCH_CHECK(node.input_size() == 1 &&
+                   node.input(0).value_f_size() == kValueNum);
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    node.ParseFromString(binary);
+    mluop_bench::doNotOptimize(node);
+  }
+  state.setBytesPerIteration(binary.size());
+}
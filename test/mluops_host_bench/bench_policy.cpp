@@ -0,0 +1,124 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <cstdint>
+
+#include "host_bench.h"
+#include "core/tensor.h"
+#include "kernels/binary_op/binary_op_host.h"
+#include "kernels/unary_op/unary_op_host.h"
+
+namespace {
+
+// policy of every element-wise launch, over a few sizes of float tensors.
+const int64_t kElementNums[] = {1, 1000, 1 << 20, (int64_t)1 << 28};
+
+class PolicyDescs {
+ public:
+  PolicyDescs() {
+    for (int i = 0; i < kNum; ++i) {
+      if (mluOpCreateTensorDescriptor(&descs_[i]) != MLUOP_STATUS_SUCCESS ||
+          mluOpSetTensorDescriptor_v2(descs_[i], MLUOP_LAYOUT_ARRAY,
+                                      MLUOP_DTYPE_FLOAT, 1,
+                                      &kElementNums[i]) !=
+              MLUOP_STATUS_SUCCESS) {
+        ok_ = false;
+      }
+    }
+  }
+  ~PolicyDescs() {
+    for (int i = 0; i < kNum; ++i) {
+      mluOpDestroyTensorDescriptor(descs_[i]);
+    }
+  }
+  mluOpTensorDescriptor_t get(size_t i) const { return descs_[i % kNum]; }
+  bool ok() const { return ok_; }
+
+ private:
+  static const int kNum = sizeof(kElementNums) / sizeof(kElementNums[0]);
+  mluOpTensorDescriptor_t descs_[kNum];
+  bool ok_ = true;
+};
+
+}  // namespace
+
+HOST_BENCH(PolicyUnaryOp) {
+  mluOpHandle_t handle = mluop_bench::getFakeHandle();
+  PolicyDescs descs;
+  HOST_BENCH_CHECK(descs.ok());
+  cnrtDim3_t k_dim = {0, 0, 0};
+  cnrtFunctionType_t k_type;
+  unaryOpPolicyFunc(handle, &k_dim, &k_type, descs.get(0));
+  HOST_BENCH_CHECK(k_dim.x * k_dim.y * k_dim.z > 0);
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    unaryOpPolicyFunc(handle, &k_dim, &k_type, descs.get(i));
+    mluop_bench::doNotOptimize(k_dim);
+  }
+}
+
+HOST_BENCH(PolicyUnaryOpBlock_v2) {
+  mluOpHandle_t handle = mluop_bench::getFakeHandle();
+  PolicyDescs descs;
+  HOST_BENCH_CHECK(descs.ok());
+  cnrtDim3_t k_dim = {0, 0, 0};
+  cnrtFunctionType_t k_type;
+  size_t normal_num = 0, tail_num = 0;
+  unaryOpPolicyFuncBlock_v2(handle, descs.get(0), 64 * 1024, k_dim, k_type,
+                            normal_num, tail_num);
+  HOST_BENCH_CHECK(k_dim.x * k_dim.y * k_dim.z > 0);
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    unaryOpPolicyFuncBlock_v2(handle, descs.get(i), 64 * 1024, k_dim, k_type,
+                              normal_num, tail_num);
+    mluop_bench::doNotOptimize(normal_num);
+  }
+}
+
+HOST_BENCH(PolicyBinaryOp) {
+  mluOpHandle_t handle = mluop_bench::getFakeHandle();
+  PolicyDescs descs;
+  HOST_BENCH_CHECK(descs.ok());
+  cnrtDim3_t k_dim = {0, 0, 0};
+  cnrtFunctionType_t k_type;
+  binaryOpPolicyFunc(handle, 128, &k_dim, &k_type, descs.get(0));
+  HOST_BENCH_CHECK(k_dim.x * k_dim.y * k_dim.z > 0);
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    binaryOpPolicyFunc(handle, 128, &k_dim, &k_type, descs.get(i));
+    mluop_bench::doNotOptimize(k_dim);
+  }
+}
+
+HOST_BENCH(PolicyBinaryOpBlock) {
+  mluOpHandle_t handle = mluop_bench::getFakeHandle();
+  PolicyDescs descs;
+  HOST_BENCH_CHECK(descs.ok());
+  cnrtDim3_t k_dim = {0, 0, 0};
+  cnrtFunctionType_t k_type;
+  size_t normal_num = 0, tail_num = 0;
+  binaryOpBlockPolicyFunc(handle, descs.get(0), 128, k_dim, k_type,
+                          normal_num, tail_num);
+  HOST_BENCH_CHECK(k_dim.x * k_dim.y * k_dim.z > 0);
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    binaryOpBlockPolicyFunc(handle, descs.get(i), 128, k_dim, k_type,
+                            normal_num, tail_num);
+    mluop_bench::doNotOptimize(normal_num);
+  }
+}
@@ -0,0 +1,175 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <cstdint>
+
+#include "host_bench.h"
+#include "core/gen_case.h"
+#include "core/tensor.h"
+#include "kernels/tensor_stride_process/tensor_stride_process_host.h"
+
+namespace {
+
+const int64_t kDims[4] = {8, 64, 56, 56};
+const int64_t kDenseStrides[4] = {64 * 56 * 56, 56 * 56, 56, 1};
+// NHWC storage of a NCHW shaped tensor, still dense.
+const int64_t kPermutedStrides[4] = {64 * 56 * 56, 1, 56 * 64, 64};
+// every row padded from 56 to 64 elements.
+const int64_t kPaddedStrides[4] = {64 * 56 * 64, 56 * 64, 64, 1};
+
+// a descriptor that lives for the whole benchmark.
+class ScopedDesc {
+ public:
+  explicit ScopedDesc(const int64_t *strides = kDenseStrides) {
+    status_ = mluOpCreateTensorDescriptor(&desc_);
+    if (status_ == MLUOP_STATUS_SUCCESS) {
+      status_ = mluOpSetTensorDescriptorEx_v2(
+          desc_, MLUOP_LAYOUT_ARRAY, MLUOP_DTYPE_FLOAT, 4, kDims, strides);
+    }
+  }
+  ~ScopedDesc() { mluOpDestroyTensorDescriptor(desc_); }
+  mluOpTensorDescriptor_t get() const { return desc_; }
+  bool ok() const { return status_ == MLUOP_STATUS_SUCCESS; }
+
+ private:
+  mluOpTensorDescriptor_t desc_ = nullptr;
+  mluOpStatus_t status_ = MLUOP_STATUS_NOT_INITIALIZED;
+};
+
+}  // namespace
+
+HOST_BENCH(TensorDescCreateSetDestroy) {
+  const int dims[4] = {8, 64, 56, 56};
+  {
+    mluOpTensorDescriptor_t desc;
+    HOST_BENCH_CHECK(mluOpCreateTensorDescriptor(&desc) ==
+                     MLUOP_STATUS_SUCCESS);
+    HOST_BENCH_CHECK(mluOpSetTensorDescriptor(desc, MLUOP_LAYOUT_NCHW,
+                                              MLUOP_DTYPE_FLOAT, 4, dims) ==
+                     MLUOP_STATUS_SUCCESS);
+    HOST_BENCH_CHECK(mluOpDestroyTensorDescriptor(desc) ==
+                     MLUOP_STATUS_SUCCESS);
+  }
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    mluOpTensorDescriptor_t desc;
+    mluOpCreateTensorDescriptor(&desc);
+    mluOpSetTensorDescriptor(desc, MLUOP_LAYOUT_NCHW, MLUOP_DTYPE_FLOAT, 4,
+                             dims);
+    mluop_bench::doNotOptimize(desc);
+    mluOpDestroyTensorDescriptor(desc);
+  }
+}
+
+HOST_BENCH(TensorDescSet_v2) {
+  ScopedDesc desc;
+  HOST_BENCH_CHECK(desc.ok());
+  HOST_BENCH_CHECK(mluOpSetTensorDescriptor_v2(desc.get(), MLUOP_LAYOUT_ARRAY,
+                                               MLUOP_DTYPE_FLOAT, 4, kDims) ==
+                   MLUOP_STATUS_SUCCESS);
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    mluOpSetTensorDescriptor_v2(desc.get(), MLUOP_LAYOUT_ARRAY,
+                                MLUOP_DTYPE_FLOAT, 4, kDims);
+    mluop_bench::doNotOptimize(desc.get()->total_element_num);
+  }
+}
+
+HOST_BENCH(TensorDescSetEx_v2) {
+  ScopedDesc desc;
+  HOST_BENCH_CHECK(desc.ok());
+  HOST_BENCH_CHECK(mluOpSetTensorDescriptorEx_v2(
+                       desc.get(), MLUOP_LAYOUT_ARRAY, MLUOP_DTYPE_FLOAT, 4,
+                       kDims, kPaddedStrides) == MLUOP_STATUS_SUCCESS);
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    mluOpSetTensorDescriptorEx_v2(desc.get(), MLUOP_LAYOUT_ARRAY,
+                                  MLUOP_DTYPE_FLOAT, 4, kDims,
+                                  kPaddedStrides);
+    mluop_bench::doNotOptimize(desc.get()->total_tensor_size);
+  }
+}
+
+HOST_BENCH(TensorDescGetElementNum) {
+  ScopedDesc desc;
+  HOST_BENCH_CHECK(desc.ok());
+  HOST_BENCH_CHECK(mluOpGetTensorElementNum(desc.get()) == 8 * 64 * 56 * 56);
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    mluop_bench::doNotOptimize(mluOpGetTensorElementNum(desc.get()));
+  }
+}
+
+HOST_BENCH(StrideIfNeedProcessDense) {
+  ScopedDesc desc;
+  HOST_BENCH_CHECK(desc.ok());
+  HOST_BENCH_CHECK(!mluop::ifNeedTensorStrideProcess(desc.get()));
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    mluop_bench::doNotOptimize(mluop::ifNeedTensorStrideProcess(desc.get()));
+  }
+}
+
+HOST_BENCH(StrideIfNeedProcessPadded) {
+  ScopedDesc desc(kPaddedStrides);
+  HOST_BENCH_CHECK(desc.ok());
+  HOST_BENCH_CHECK(mluop::ifNeedTensorStrideProcess(desc.get()));
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    mluop_bench::doNotOptimize(mluop::ifNeedTensorStrideProcess(desc.get()));
+  }
+}
+
+HOST_BENCH(StrideIsDensePermuted) {
+  ScopedDesc desc(kPermutedStrides);
+  HOST_BENCH_CHECK(desc.ok());
+  HOST_BENCH_CHECK(mluop::isDenseStrideTensor(desc.get()));
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    mluop_bench::doNotOptimize(mluop::isDenseStrideTensor(desc.get()));
+  }
+}
+
+// the check element-wise ops run on x, y and z.
+HOST_BENCH(StrideCaseNotConsistentDense) {
+  ScopedDesc x(kPermutedStrides), y(kPermutedStrides), z(kPaddedStrides);
+  HOST_BENCH_CHECK(x.ok() && y.ok() && z.ok());
+  HOST_BENCH_CHECK(
+      mluop::strideCaseWithNotConsistentDense(3, x.get(), y.get(), z.get()));
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    mluop_bench::doNotOptimize(
+        mluop::strideCaseWithNotConsistentDense(3, x.get(), y.get(), z.get()));
+  }
+}
+
+HOST_BENCH(StrideGetTensorShape) {
+  ScopedDesc desc(kPaddedStrides);
+  HOST_BENCH_CHECK(desc.ok());
+  mluop::TensorShape shape;
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    mluop::getTensorShape(desc.get(), &shape);
+    mluop_bench::doNotOptimize(shape.total_stride);
+  }
+}
+
+HOST_BENCH(StrideGenCaseIfNeedProcess) {
+  ScopedDesc desc(kPaddedStrides);
+  HOST_BENCH_CHECK(desc.ok());
+  HOST_BENCH_CHECK(mluop::gen_case::ifNeedTensorStrideProcess(desc.get()));
+  for (size_t i = 0; i < state.iterations(); ++i) {
+    mluop_bench::doNotOptimize(
+        mluop::gen_case::ifNeedTensorStrideProcess(desc.get()));
+  }
+}
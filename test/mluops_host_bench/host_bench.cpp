@@ -0,0 +1,282 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "host_bench.h"
+
+namespace mluop_bench {
+
+namespace {
+
+struct BenchEntry {
+  std::string name;
+  BenchFunc func;
+};
+
+std::vector<BenchEntry> &getRegistry() {
+  static std::vector<BenchEntry> registry;
+  return registry;
+}
+
+struct BenchResult {
+  std::string name;
+  size_t iterations = 0;
+  int repetitions = 0;
+  double median_ns = 0.;  // per iteration
+  double min_ns = 0.;
+  double bytes_per_second = 0.;
+  std::string error;  // empty if the benchmark ran
+};
+
+struct Options {
+  std::string filter;
+  std::string out;
+  double min_time = 0.05;  // seconds per repetition
+  int repetitions = 5;
+  bool list = false;
+  bool check = false;  // one iteration of each benchmark, no timing
+};
+
+double runOnce(const BenchFunc &func, size_t iterations, size_t *bytes,
+               std::string *error) {
+  State state(iterations);
+  auto start = std::chrono::steady_clock::now();
+  func(state);
+  auto stop = std::chrono::steady_clock::now();
+  *bytes = state.bytesPerIteration();
+  *error = state.errorMessage();
+  return std::chrono::duration<double>(stop - start).count();
+}
+
+BenchResult runBench(const BenchEntry &entry, const Options &opt) {
+  BenchResult res;
+  res.name = entry.name;
+  // grow the iteration count until one call takes min_time.
+  size_t iterations = 1, bytes = 0;
+  for (;;) {
+    double seconds = runOnce(entry.func, iterations, &bytes, &res.error);
+    if (!res.error.empty() || opt.check) {
+      return res;
+    }
+    if (seconds >= opt.min_time || iterations >= ((size_t)1 << 40)) {
+      break;
+    }
+    double scale = seconds <= 0. ? 100. : 1.4 * opt.min_time / seconds;
+    iterations = (size_t)(iterations * std::min(100., std::max(2., scale)));
+  }
+  std::vector<double> ns;
+  for (int r = 0; r < opt.repetitions; ++r) {
+    ns.push_back(runOnce(entry.func, iterations, &bytes, &res.error) * 1e9 /
+                 iterations);
+    if (!res.error.empty()) {
+      return res;
+    }
+  }
+  std::sort(ns.begin(), ns.end());
+  res.iterations = iterations;
+  res.repetitions = opt.repetitions;
+  res.median_ns = ns[ns.size() / 2];
+  res.min_ns = ns[0];
+  res.bytes_per_second = bytes * 1e9 / res.median_ns;
+  return res;
+}
+
+std::string getContextJson() {
+  char date[32];
+  time_t now = time(nullptr);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+  char host[256] = "";
+  gethostname(host, sizeof(host) - 1);
+  int major = 0, minor = 0, patch = 0;
+  mluOpGetLibVersion(&major, &minor, &patch);
+  char buf[512];
+  snprintf(buf, sizeof(buf),
+           "  \"context\": {\n    \"date\": \"%s\",\n    \"host_name\": "
+           "\"%s\",\n    \"num_cpus\": %ld,\n    \"mluops_version\": "
+           "\"%d.%d.%d\"\n  },\n",
+           date, host, sysconf(_SC_NPROCESSORS_ONLN), major, minor, patch);
+  return buf;
+}
+
+std::string jsonEscape(const std::string &str) {
+  std::string escaped;
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+void writeJson(const std::vector<BenchResult> &results, FILE *fp) {
+  fprintf(fp, "{\n%s  \"benchmarks\": [\n", getContextJson().c_str());
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchResult &res = results[i];
+    if (!res.error.empty()) {
+      // google benchmark's fields for a failed benchmark.
+      fprintf(fp,
+              "    {\"name\": \"%s\", \"error_occurred\": true, "
+              "\"error_message\": \"%s\"}%s\n",
+              res.name.c_str(), jsonEscape(res.error).c_str(),
+              i + 1 < results.size() ? "," : "");
+      continue;
+    }
+    fprintf(fp,
+            "    {\"name\": \"%s\", \"iterations\": %zu, \"repetitions\": %d, "
+            "\"real_time\": %.3f, \"min_time\": %.3f, \"time_unit\": \"ns\"",
+            res.name.c_str(), res.iterations, res.repetitions, res.median_ns,
+            res.min_ns);
+    if (res.bytes_per_second > 0.) {
+      fprintf(fp, ", \"bytes_per_second\": %.0f", res.bytes_per_second);
+    }
+    fprintf(fp, "}%s\n", i + 1 < results.size() ? "," : "");
+  }
+  fprintf(fp, "  ]\n}\n");
+}
+
+bool parseArg(const char *arg, const char *key, std::string *value) {
+  size_t len = strlen(key);
+  if (strncmp(arg, key, len) != 0 || arg[len] != '=') {
+    return false;
+  }
+  *value = arg + len + 1;
+  return true;
+}
+
+void printUsage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [--filter=<substr>] [--min_time=<seconds>]\n"
+          "       [--repetitions=<n>] [--out=<file.json>] [--list]"
+          " [--check]\n",
+          prog);
+}
+
+}  // namespace
+
+bool registerBench(const std::string &name, BenchFunc func) {
+  getRegistry().push_back({name, std::move(func)});
+  return true;
+}
+
+mluOpHandle_t getFakeHandle() {
+  static mluOpContext ctx = []() {
+    mluOpContext c;
+    c.arch = MLUOP_MLU370;
+    snprintf(c.device_name, sizeof(c.device_name), "MLU370-X8");
+    c.cluster_num = 8;
+    c.core_num_per_cluster = 4;
+    c.nram_size = 768 * 1024 - 128 * 1024;  // minus REM_FOR_STACK
+    c.wram_size = 1024 * 1024;
+    c.sram_size = 4 * 1024 * 1024 - 128 * 1024;
+    c.capability_cluster_num = 8;
+    c.capability_job_limit = CN_KERNEL_CLASS_UNION8;
+    c.clock_rate = 1300000;
+    c.l2cache_size = 48 * 1024 * 1024;
+    c.persisting_l2cache_maxsize = 0;
+    c.memory_band_width = 614.4;
+    c.round_mode = MLUOP_ROUND_HALF_OFF_ZERO;
+    c.atomics_mode = MLUOP_ATOMICS_NOT_ALLOWED;
+    return c;
+  }();
+  return &ctx;
+}
+
+}  // namespace mluop_bench
+
+int main(int argc, char **argv) {
+  using mluop_bench::Options;
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    std::string value;
+    if (mluop_bench::parseArg(argv[i], "--filter", &value)) {
+      opt.filter = value;
+    } else if (mluop_bench::parseArg(argv[i], "--out", &value)) {
+      opt.out = value;
+    } else if (mluop_bench::parseArg(argv[i], "--min_time", &value)) {
+      opt.min_time = std::max(1e-4, atof(value.c_str()));
+    } else if (mluop_bench::parseArg(argv[i], "--repetitions", &value)) {
+      opt.repetitions = std::max(1, atoi(value.c_str()));
+    } else if (strcmp(argv[i], "--list") == 0) {
+      opt.list = true;
+    } else if (strcmp(argv[i], "--check") == 0) {
+      opt.check = true;
+    } else {
+      mluop_bench::printUsage(argv[0]);
+      return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+    }
+  }
+
+  std::vector<mluop_bench::BenchResult> results;
+  int failed = 0;
+  for (const auto &entry : mluop_bench::getRegistry()) {
+    if (entry.name.find(opt.filter) == std::string::npos) {
+      continue;
+    }
+    if (opt.list) {
+      printf("%s\n", entry.name.c_str());
+      continue;
+    }
+    results.push_back(mluop_bench::runBench(entry, opt));
+    const auto &res = results.back();
+    if (!res.error.empty()) {
+      fprintf(stderr, "%-40s FAILED %s\n", res.name.c_str(),
+              res.error.c_str());
+      failed++;
+    } else if (opt.check) {
+      fprintf(stderr, "%-40s OK\n", res.name.c_str());
+    } else {
+      fprintf(stderr, "%-40s %12.1f ns %12zu iterations\n", res.name.c_str(),
+              res.median_ns, res.iterations);
+    }
+  }
+  if (opt.list) {
+    return 0;
+  }
+  if (opt.check) {
+    fprintf(stderr, "%zu benchmarks checked, %d failed.\n", results.size(),
+            failed);
+    return failed == 0 ? 0 : 1;
+  }
+
+  FILE *fp = opt.out.empty() ? stdout : fopen(opt.out.c_str(), "w");
+  if (fp == nullptr) {
+    fprintf(stderr, "failed to open %s\n", opt.out.c_str());
+    return 1;
+  }
+  mluop_bench::writeJson(results, fp);
+  if (fp != stdout) {
+    fclose(fp);
+  }
+  return failed == 0 ? 0 : 1;
+}
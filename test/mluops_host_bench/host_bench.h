@@ -0,0 +1,106 @@
+/*************************************************************************
+ * Copyright (C) [2024] by Cambricon, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************/
+#ifndef TEST_MLUOPS_HOST_BENCH_HOST_BENCH_H_
+#define TEST_MLUOPS_HOST_BENCH_HOST_BENCH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "mlu_op.h"
+#include "core/context.h"
+
+// A small harness timing host-only paths of the library, results are
+// written as JSON so host overhead can be tracked without a device.
+//
+//   HOST_BENCH(TensorDescSet) {
+//     ...  // setup, not timed
+//     for (size_t i = 0; i < state.iterations(); ++i) {
+//       ...  // timed body
+//     }
+//   }
+//
+// Setup checks that the timed path is the expected one, e.g. that a stride
+// classification returns what the name says, with HOST_BENCH_CHECK:
+//
+//   HOST_BENCH_CHECK(mluop::isDenseStrideTensor(desc.get()));
+//
+// Each benchmark is first calibrated until one call of it runs at least
+// --min_time seconds, then called --repetitions times with that iteration
+// count; the median and the minimum time per iteration are reported.
+namespace mluop_bench {
+
+class State {
+ public:
+  explicit State(size_t iterations) : iterations_(iterations) {}
+  inline size_t iterations() const { return iterations_; }
+  // bytes handled by one iteration, reported as bytes_per_second.
+  inline void setBytesPerIteration(size_t bytes) { bytes_ = bytes; }
+  inline size_t bytesPerIteration() const { return bytes_; }
+  // marks the benchmark as failed, it is reported and not timed further.
+  inline void skipWithError(const std::string &message) { error_ = message; }
+  inline bool errorOccurred() const { return !error_.empty(); }
+  inline const std::string &errorMessage() const { return error_; }
+
+ private:
+  size_t iterations_ = 0;
+  size_t bytes_ = 0;
+  std::string error_;
+};
+
+using BenchFunc = std::function<void(State &)>;
+
+// always returns true, so HOST_BENCH can register from a static initializer.
+bool registerBench(const std::string &name, BenchFunc func);
+
+// keeps the compiler from dropping a result computed by the timed body.
+template <typename T>
+inline void doNotOptimize(const T &value) {
+  asm volatile("" : : "r"(&value) : "memory");
+}
+
+// handle filled with the resources of a MLU370-X8 instead of a device, for
+// the policy functions which only read these fields.
+mluOpHandle_t getFakeHandle();
+
+}  // namespace mluop_bench
+
+#define HOST_BENCH(name)                                          \
+  static void bench_##name(mluop_bench::State &state);            \
+  static bool bench_##name##_registered __attribute__((unused)) = \
+      mluop_bench::registerBench(#name, bench_##name);            \
+  static void bench_##name(mluop_bench::State &state)
+
+// fails the benchmark with the condition as message; for setup, not for the
+// timed loop.
+#define HOST_BENCH_CHECK(cond)                                       \
+  do {                                                               \
+    if (!(cond)) {                                                   \
+      state.skipWithError(std::string(__FILE__) + ":" +              \
+                          std::to_string(__LINE__) + ": " #cond);    \
+      return;                                                        \
+    }                                                                \
+  } while (0)
+
+#endif  // TEST_MLUOPS_HOST_BENCH_HOST_BENCH_H_